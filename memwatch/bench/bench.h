@@ -0,0 +1,93 @@
+/*
+ * bench.h - Shared pieces of the memwatch benchmark suite
+ *
+ * - bench_hist_*(): HDR-style latency histogram. Values up to 255 are
+ *   counted exactly; above that each power of two is split into 128
+ *   buckets, so any percentile is within 1% of the true value. Fixed
+ *   size, no allocation: record() is an add and a count-leading-zeros.
+ * - bench_json_*(): streaming JSON writer for the report
+ * - bench_fault() / bench_ring() / bench_modes() / bench_storage() /
+ *   bench_sql(): the suites, each writing one member of "suites"
+ *
+ * All times are nanoseconds, CLOCK_MONOTONIC.
+ */
+
+#ifndef MEMWATCH_BENCH_H
+#define MEMWATCH_BENCH_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#define BENCH_HIST_SUB_BITS 7
+#define BENCH_HIST_SUB      (1u << BENCH_HIST_SUB_BITS)
+#define BENCH_HIST_BUCKETS  ((64 - BENCH_HIST_SUB_BITS + 1) * BENCH_HIST_SUB)
+#define BENCH_JSON_DEPTH    16
+
+typedef struct {
+    uint64_t counts[BENCH_HIST_BUCKETS];
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+    double sum;
+} bench_hist_t;
+
+void bench_hist_init(bench_hist_t *h);
+void bench_hist_record(bench_hist_t *h, uint64_t value);
+void bench_hist_merge(bench_hist_t *dst, const bench_hist_t *src);
+
+/* Smallest recorded value v such that pct percent of values are <= v */
+uint64_t bench_hist_percentile(const bench_hist_t *h, double pct);
+
+typedef struct {
+    FILE *out;
+    int depth;
+    bool first[BENCH_JSON_DEPTH];
+} bench_json_t;
+
+/* key is NULL inside arrays and for the top-level object */
+void bench_json_begin(bench_json_t *j, const char *key);
+void bench_json_end(bench_json_t *j);
+void bench_json_begin_array(bench_json_t *j, const char *key);
+void bench_json_end_array(bench_json_t *j);
+void bench_json_str(bench_json_t *j, const char *key, const char *value);
+void bench_json_u64(bench_json_t *j, const char *key, uint64_t value);
+void bench_json_f64(bench_json_t *j, const char *key, double value);
+void bench_json_bool(bench_json_t *j, const char *key, bool value);
+
+/* {"count", "min", "mean", "p50", "p90", "p99", "p999", "max"} */
+void bench_json_hist(bench_json_t *j, const char *key, const bench_hist_t *h);
+
+typedef struct {
+    double scale;            /* work per measurement (1.0 = full, --quick = 0.1) */
+    int max_threads;         /* thread counts stop here */
+    const char *only;        /* run just this suite (NULL = all) */
+    const char *tmpdir;      /* scratch directory, removed afterwards */
+} bench_opts_t;
+
+static inline uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint64_t bench_xorshift(uint64_t *x) {
+    *x ^= *x << 13; *x ^= *x >> 7; *x ^= *x << 17;
+    return *x;
+}
+
+/* n scaled by opts->scale, at least min */
+uint64_t bench_scaled(const bench_opts_t *o, uint64_t n, uint64_t min);
+
+/* Progress on stderr; stdout (or -o) gets only the JSON */
+void bench_log(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+/* Suites: 0 on success, nonzero if a measurement failed outright */
+int bench_fault(bench_json_t *j, const bench_opts_t *o);
+int bench_ring(bench_json_t *j, const bench_opts_t *o);
+int bench_modes(bench_json_t *j, const bench_opts_t *o);
+int bench_storage(bench_json_t *j, const bench_opts_t *o);
+int bench_sql(bench_json_t *j, const bench_opts_t *o);
+
+#endif /* MEMWATCH_BENCH_H */
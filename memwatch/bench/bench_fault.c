@@ -0,0 +1,552 @@
+/*
+ * bench_fault.c - Fault path benchmarks: latency, ring throughput, modes
+ *
+ * memwatch.c is the _memwatch_native Python module, so it is driven the
+ * way the Python binding drives it: the interpreter is embedded, the
+ * module registered in-process, and callbacks are Python callables
+ * written in C. Its fault-to-callback time therefore includes taking the
+ * GIL and building the event dict, as it does in production.
+ * memwatch_core_minimal.c is driven through memwatch_unified.h.
+ *
+ * Latency: one 4 KB region per page, written one at a time, each write
+ * waiting for its callback; a page is written again only after the
+ * engine has had time to re-arm it (WRITABLE_WINDOW_MS in memwatch.c).
+ * The minimal engine only arms pages itself with uffd (with mprotect
+ * the caller protects them), so mprotect is not measured there.
+ */
+
+#define _GNU_SOURCE
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "bench.h"
+#include "memwatch_unified.h"
+
+#define FAULT_PAGES        256
+#define FAULT_PAGE_SIZE    4096
+#define FAULT_TIMEOUT_NS   (100 * 1000000ULL)
+#define FAULT_PROBE        20                  /* unanswered writes before giving up */
+#define NATIVE_REARM_NS    (8 * 1000000ULL)    /* 5 ms window + 1 ms tick + slack */
+#define MINIMAL_REARM_NS   (1 * 1000000ULL)
+#define RING_PAGES         1024                /* per writer thread */
+#define RING_MAX_THREADS   64
+#define QUIET_NS           (50 * 1000000ULL)
+#define MODE_RECORDS       1024                /* 256-byte records, 16 per page */
+#define MODE_RECORD_SIZE   256
+#define MODE_WORK          64                  /* xorshift rounds between writes */
+
+PyMODINIT_FUNC PyInit__memwatch_native(void);
+
+/* ============================================================================
+ * Delivery counters, shared by every callback
+ * ============================================================================ */
+
+static _Atomic uint64_t delivered;
+static _Atomic uint64_t written_at;
+static _Atomic uint64_t last_latency;
+
+static void delivered_one(void) {
+    uint64_t t = atomic_load_explicit(&written_at, memory_order_acquire);
+    atomic_store_explicit(&last_latency, bench_now_ns() - t, memory_order_relaxed);
+    atomic_fetch_add_explicit(&delivered, 1, memory_order_release);
+}
+
+/* ============================================================================
+ * memwatch.c, embedded
+ * ============================================================================ */
+
+static PyObject *native;
+
+static PyObject *on_event(PyObject *self, PyObject *event) {
+    (void)self; (void)event;
+    delivered_one();
+    Py_RETURN_NONE;
+}
+
+static PyObject *on_batch(PyObject *self, PyObject *batch) {
+    (void)self;
+    Py_ssize_t n = PyObject_Length(batch);
+    if (n < 0) return NULL;
+    atomic_fetch_add_explicit(&delivered, (uint64_t)n, memory_order_release);
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef on_event_def = { "on_event", on_event, METH_O, NULL };
+static PyMethodDef on_batch_def = { "on_batch", on_batch, METH_O, NULL };
+
+static int native_load(void) {
+    if (native) return 0;
+    if (!Py_IsInitialized()) {
+        PyImport_AppendInittab("_memwatch_native", PyInit__memwatch_native);
+        Py_InitializeEx(0);
+    }
+    native = PyImport_ImportModule("_memwatch_native");
+    if (!native) {
+        PyErr_Print();
+        return -1;
+    }
+    PyEval_SaveThread();    /* the worker takes the GIL for callbacks */
+    return 0;
+}
+
+/* Call module.name(*args); on error, its message goes to err */
+static PyObject *native_call(const char *name, PyObject *args, char *err, size_t errlen) {
+    PyObject *fn = PyObject_GetAttrString(native, name);
+    PyObject *result = fn && args ? PyObject_CallObject(fn, args) : NULL;
+    Py_XDECREF(fn);
+    Py_XDECREF(args);
+    if (!result && err) {
+        PyObject *type, *value, *tb;
+        PyErr_Fetch(&type, &value, &tb);
+        PyObject *text = value ? PyObject_Str(value) : NULL;
+        snprintf(err, errlen, "%s", text ? PyUnicode_AsUTF8(text) : "error");
+        Py_XDECREF(text);
+        Py_XDECREF(type);
+        Py_XDECREF(value);
+        Py_XDECREF(tb);
+    }
+    PyErr_Clear();
+    return result;
+}
+
+static int native_start(const char *backend, char *err, size_t errlen) {
+    if (native_load() != 0) {
+        snprintf(err, errlen, "cannot load _memwatch_native");
+        return -1;
+    }
+    PyGILState_STATE g = PyGILState_Ensure();
+    PyObject *r = native_call("init", Py_BuildValue("(z)", backend), err, errlen);
+    int rc = r ? 0 : -1;
+    Py_XDECREF(r);
+    if (rc == 0) {
+        PyObject *cb = PyCFunction_New(&on_event_def, NULL);
+        Py_XDECREF(native_call("set_callback", Py_BuildValue("(O)", cb), NULL, 0));
+        Py_XDECREF(cb);
+    }
+    PyGILState_Release(g);
+    return rc;
+}
+
+static int native_batches(void) {
+    PyGILState_STATE g = PyGILState_Ensure();
+    PyObject *cb = PyCFunction_New(&on_batch_def, NULL);
+    PyObject *r = native_call("set_batch_callback", Py_BuildValue("(OIK)", cb, 1024u, 1000ULL), NULL, 0);
+    Py_XDECREF(cb);
+    int rc = r ? 0 : -1;
+    Py_XDECREF(r);
+    PyGILState_Release(g);
+    return rc;
+}
+
+/* Track count regions of size bytes, stride apart; 0 on success */
+static int native_track(uint8_t *base, size_t count, size_t size, size_t stride, int max_value_bytes) {
+    PyGILState_STATE g = PyGILState_Ensure();
+    PyObject *items = PyList_New((Py_ssize_t)count);
+    for (size_t i = 0; items && i < count; i++) {
+        PyList_SET_ITEM(items, (Py_ssize_t)i,
+                        Py_BuildValue("(KnIIi)", (unsigned long long)(uintptr_t)(base + i * stride),
+                                      (Py_ssize_t)size, 0u, (unsigned)i, max_value_bytes));
+    }
+    PyObject *r = items ? native_call("track_many", Py_BuildValue("(O)", items), NULL, 0) : NULL;
+    Py_XDECREF(items);
+    int rc = r ? 0 : -1;
+    Py_XDECREF(r);
+    PyGILState_Release(g);
+    return rc;
+}
+
+static uint64_t native_watch_page(void *addr) {
+    return native_track(addr, 1, FAULT_PAGE_SIZE, FAULT_PAGE_SIZE, 256) == 0;
+}
+
+static uint64_t native_stat(const char *key) {
+    PyGILState_STATE g = PyGILState_Ensure();
+    PyObject *stats = native_call("get_stats", PyTuple_New(0), NULL, 0);
+    PyObject *v = stats ? PyDict_GetItemString(stats, key) : NULL;
+    uint64_t out = v && PyLong_Check(v) ? PyLong_AsUnsignedLongLong(v) : 0;
+    PyErr_Clear();
+    Py_XDECREF(stats);
+    PyGILState_Release(g);
+    return out;
+}
+
+/* Same, from the overhead governor's section */
+static uint64_t native_governor_stat(const char *key) {
+    PyGILState_STATE g = PyGILState_Ensure();
+    PyObject *stats = native_call("get_stats", PyTuple_New(0), NULL, 0);
+    PyObject *gov = stats ? PyDict_GetItemString(stats, "governor") : NULL;
+    PyObject *v = gov ? PyDict_GetItemString(gov, key) : NULL;
+    uint64_t out = v && PyLong_Check(v) ? PyLong_AsUnsignedLongLong(v) : 0;
+    PyErr_Clear();
+    Py_XDECREF(stats);
+    PyGILState_Release(g);
+    return out;
+}
+
+static int native_set_mode(const char *mode, char *err, size_t errlen) {
+    PyGILState_STATE g = PyGILState_Ensure();
+    PyObject *r = native_call("set_mode", Py_BuildValue("(z)", mode), err, errlen);
+    int rc = r ? 0 : -1;
+    Py_XDECREF(r);
+    PyGILState_Release(g);
+    return rc;
+}
+
+static void native_stop(void) {
+    PyGILState_STATE g = PyGILState_Ensure();
+    Py_XDECREF(native_call("shutdown", PyTuple_New(0), NULL, 0));
+    PyGILState_Release(g);
+}
+
+/* ============================================================================
+ * memwatch_core_minimal.c
+ * ============================================================================ */
+
+static void minimal_callback(const memwatch_change_event_t *event, void *ctx) {
+    (void)event; (void)ctx;
+    delivered_one();
+}
+
+static int minimal_start(const char *backend, char *err, size_t errlen) {
+    int rc = memwatch_init_backend(backend);
+    if (rc != 0) {
+        snprintf(err, errlen, "memwatch_init_backend(%s) = %d", backend, rc);
+        return -1;
+    }
+    memwatch_set_callback(minimal_callback, NULL);
+    return 0;
+}
+
+static uint64_t minimal_watch_page(void *addr) {
+    return memwatch_watch((uint64_t)(uintptr_t)addr, FAULT_PAGE_SIZE, "bench", NULL);
+}
+
+static void minimal_stop(void) {
+    memwatch_shutdown();
+}
+
+/* ============================================================================
+ * Fault-to-callback latency
+ * ============================================================================ */
+
+typedef struct {
+    const char *engine;
+    const char *backend;
+    int (*start)(const char *backend, char *err, size_t errlen);
+    uint64_t (*watch_page)(void *addr);
+    void (*stop)(void);
+    uint64_t rearm_ns;
+    const char *skip;        /* not measured, and why */
+} engine_t;
+
+static const engine_t engines[] = {
+    { "memwatch.c", "mprotect", native_start, native_watch_page, native_stop, NATIVE_REARM_NS, NULL },
+    { "memwatch.c", "uffd", native_start, native_watch_page, native_stop, NATIVE_REARM_NS, NULL },
+    { "memwatch.c", "soft-dirty", native_start, native_watch_page, native_stop, NATIVE_REARM_NS, NULL },
+    { "memwatch_core_minimal.c", "mprotect", NULL, NULL, NULL, 0, "pages are protected by the caller" },
+    { "memwatch_core_minimal.c", "uffd", minimal_start, minimal_watch_page, minimal_stop, MINIMAL_REARM_NS, NULL },
+    { "memwatch_core_minimal.c", "soft-dirty", minimal_start, minimal_watch_page, minimal_stop, MINIMAL_REARM_NS, NULL },
+};
+
+/* Wait for delivered to pass target; false on timeout */
+static bool wait_delivered(uint64_t target, uint64_t timeout_ns) {
+    uint64_t deadline = bench_now_ns() + timeout_ns;
+    while (atomic_load_explicit(&delivered, memory_order_acquire) < target) {
+        if (bench_now_ns() > deadline) return false;
+        sched_yield();
+    }
+    return true;
+}
+
+static void measure_latency(bench_json_t *j, const engine_t *e, uint64_t samples) {
+    bench_json_begin(j, NULL);
+    bench_json_str(j, "engine", e->engine);
+    bench_json_str(j, "backend", e->backend);
+    if (e->skip) {
+        bench_json_bool(j, "available", false);
+        bench_json_str(j, "reason", e->skip);
+        bench_json_end(j);
+        return;
+    }
+
+    char err[256] = "";
+    uint8_t *pages = mmap(NULL, FAULT_PAGES * FAULT_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pages == MAP_FAILED || e->start(e->backend, err, sizeof(err)) != 0) {
+        bench_json_bool(j, "available", false);
+        bench_json_str(j, "reason", pages == MAP_FAILED ? "mmap failed" : err);
+        bench_json_end(j);
+        if (pages != MAP_FAILED) munmap(pages, FAULT_PAGES * FAULT_PAGE_SIZE);
+        bench_log("  %-24s %-10s unavailable: %s", e->engine, e->backend, err);
+        return;
+    }
+    memset(pages, 0, FAULT_PAGES * FAULT_PAGE_SIZE);
+    size_t watched = 0;
+    for (size_t p = 0; p < FAULT_PAGES; p++) {
+        watched += e->watch_page(pages + p * FAULT_PAGE_SIZE) != 0;
+    }
+    struct timespec settle = { 0, 20 * 1000000L };
+    nanosleep(&settle, NULL);
+
+    static bench_hist_t hist;
+    bench_hist_init(&hist);
+    uint64_t last[FAULT_PAGES] = { 0 };
+    uint64_t missed = 0;
+    for (uint64_t i = 0; i < samples && watched == FAULT_PAGES; i++) {
+        size_t p = i % FAULT_PAGES;
+        while (bench_now_ns() - last[p] < e->rearm_ns) sched_yield();
+
+        uint64_t before = atomic_load(&delivered);
+        atomic_store_explicit(&written_at, bench_now_ns(), memory_order_release);
+        ((volatile uint64_t *)(pages + p * FAULT_PAGE_SIZE))[0] = i + 1;
+        if (wait_delivered(before + 1, FAULT_TIMEOUT_NS)) {
+            bench_hist_record(&hist, atomic_load(&last_latency));
+        } else {
+            missed++;
+        }
+        last[p] = bench_now_ns();
+        if (i + 1 == FAULT_PROBE && hist.total == 0) break;
+    }
+    e->stop();
+    munmap(pages, FAULT_PAGES * FAULT_PAGE_SIZE);
+
+    bool available = hist.total > 0;
+    bench_json_bool(j, "available", available);
+    if (!available) {
+        bench_json_str(j, "reason", watched == FAULT_PAGES ? "no callbacks for written pages" : "watch failed");
+    } else {
+        bench_json_u64(j, "samples", hist.total);
+        bench_json_u64(j, "missed", missed);
+        bench_json_hist(j, "latency_ns", &hist);
+        bench_log("  %-24s %-10s p50 %8llu ns  p99 %8llu ns  (%llu missed)", e->engine, e->backend,
+                  (unsigned long long)bench_hist_percentile(&hist, 50),
+                  (unsigned long long)bench_hist_percentile(&hist, 99), (unsigned long long)missed);
+    }
+    bench_json_end(j);
+}
+
+int bench_fault(bench_json_t *j, const bench_opts_t *o) {
+    uint64_t samples = bench_scaled(o, 2000, 100);
+    bench_json_begin(j, "fault");
+    bench_json_str(j, "description", "write to a watched page until its callback runs");
+    bench_json_u64(j, "pages", FAULT_PAGES);
+    bench_json_begin_array(j, "engines");
+    for (size_t i = 0; i < sizeof(engines) / sizeof(engines[0]); i++) {
+        measure_latency(j, &engines[i], samples);
+    }
+    bench_json_end_array(j);
+    bench_json_end(j);
+    return native ? 0 : 1;
+}
+
+/* ============================================================================
+ * Fault ring throughput
+ * ============================================================================ */
+
+typedef struct {
+    uint8_t *pages;
+    uint64_t writes;
+} ring_writer_t;
+
+static atomic_bool ring_running;
+
+static void *ring_writer(void *arg) {
+    ring_writer_t *w = arg;
+    uint64_t n = 0;
+    while (atomic_load_explicit(&ring_running, memory_order_relaxed)) {
+        for (size_t p = 0; p < RING_PAGES; p++) {
+            w->pages[p * FAULT_PAGE_SIZE + (n & 63)] = (uint8_t)n;
+            n++;
+        }
+    }
+    w->writes = n;
+    return NULL;
+}
+
+/* Wait until no event has arrived for QUIET_NS (at most 2 s) */
+static void wait_quiet(void) {
+    uint64_t deadline = bench_now_ns() + 2000000000ULL;
+    uint64_t seen = atomic_load(&delivered), since = bench_now_ns();
+    while (bench_now_ns() < deadline && bench_now_ns() - since < QUIET_NS) {
+        struct timespec pause = { 0, 5 * 1000000L };
+        nanosleep(&pause, NULL);
+        uint64_t now = atomic_load(&delivered);
+        if (now != seen) {
+            seen = now;
+            since = bench_now_ns();
+        }
+    }
+}
+
+static int ring_run(bench_json_t *j, int threads, uint64_t run_ns) {
+    size_t bytes = (size_t)threads * RING_PAGES * FAULT_PAGE_SIZE;
+    uint8_t *pages = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    char err[256] = "";
+    if (pages == MAP_FAILED) return -1;
+    memset(pages, 0, bytes);
+    if (native_start(NULL, err, sizeof(err)) != 0 || native_batches() != 0 ||
+        native_track(pages, (size_t)threads * RING_PAGES, FAULT_PAGE_SIZE, FAULT_PAGE_SIZE, 0) != 0) {
+        bench_log("  ring: %s", err);
+        munmap(pages, bytes);
+        return -1;
+    }
+
+    pthread_t tids[RING_MAX_THREADS];
+    ring_writer_t writers[RING_MAX_THREADS];
+    uint64_t dropped0 = native_stat("dropped_events"), coalesced0 = native_stat("coalesced_faults");
+    uint64_t wakeups0 = native_stat("worker_wakeups"), batches0 = native_stat("batches_delivered");
+    atomic_store(&delivered, 0);
+    atomic_store(&ring_running, true);
+    uint64_t t0 = bench_now_ns();
+    for (int t = 0; t < threads; t++) {
+        writers[t] = (ring_writer_t){ pages + (size_t)t * RING_PAGES * FAULT_PAGE_SIZE, 0 };
+        pthread_create(&tids[t], NULL, ring_writer, &writers[t]);
+    }
+    struct timespec pause = { (time_t)(run_ns / 1000000000ULL), (long)(run_ns % 1000000000ULL) };
+    nanosleep(&pause, NULL);
+    atomic_store(&ring_running, false);
+    uint64_t writes = 0;
+    for (int t = 0; t < threads; t++) {
+        pthread_join(tids[t], NULL);
+        writes += writers[t].writes;
+    }
+    double secs = (double)(bench_now_ns() - t0) / 1e9;
+    wait_quiet();
+    double drained_secs = (double)(bench_now_ns() - t0) / 1e9;
+
+    uint64_t events = atomic_load(&delivered);
+    uint64_t dropped = native_stat("dropped_events") - dropped0;
+    uint64_t coalesced = native_stat("coalesced_faults") - coalesced0;
+    uint64_t wakeups = native_stat("worker_wakeups") - wakeups0;
+    uint64_t batches = native_stat("batches_delivered") - batches0;
+    native_stop();
+    munmap(pages, bytes);
+
+    bench_json_begin(j, NULL);
+    bench_json_u64(j, "threads", (uint64_t)threads);
+    bench_json_f64(j, "seconds", secs);
+    bench_json_f64(j, "writes_per_sec", (double)writes / secs);
+    bench_json_f64(j, "faults_per_sec", (double)(events + coalesced + dropped) / secs);
+    bench_json_f64(j, "events_per_sec", (double)events / drained_secs);
+    bench_json_u64(j, "events", events);
+    bench_json_u64(j, "coalesced", coalesced);
+    bench_json_u64(j, "dropped", dropped);
+    bench_json_u64(j, "worker_wakeups", wakeups);
+    bench_json_u64(j, "batches", batches);
+    bench_json_end(j);
+    bench_log("  %2d writers: %10.0f faults/s  %10.0f events/s  %llu dropped", threads,
+              (double)(events + coalesced + dropped) / secs, (double)events / drained_secs,
+              (unsigned long long)dropped);
+    return 0;
+}
+
+int bench_ring(bench_json_t *j, const bench_opts_t *o) {
+    if (native_load() != 0) return 1;
+    uint64_t run_ns = bench_scaled(o, 1000, 100) * 1000000ULL;
+    int failed = 0;
+    bench_json_begin(j, "ring");
+    bench_json_str(j, "description",
+                   "writer threads sweep their own watched pages; memwatch.c fault rings, batch delivery");
+    bench_json_u64(j, "pages_per_thread", RING_PAGES);
+    bench_json_begin_array(j, "runs");
+    for (int threads = 1; threads <= o->max_threads && threads <= RING_MAX_THREADS; threads *= 2) {
+        failed |= ring_run(j, threads, run_ns) != 0;
+    }
+    bench_json_end_array(j);
+    bench_json_end(j);
+    return failed;
+}
+
+/* ============================================================================
+ * End-to-end overhead per mode
+ * ============================================================================ */
+
+static const struct {
+    const char *mode;
+    int max_value_bytes;     /* capture level */
+    double target_pct;       /* Architecture.yaml overhead_target */
+} modes[] = {
+    { "lite", 0, 5.0 },
+    { "balanced", 256, 30.0 },
+    { "deep", -1, 100.0 },
+};
+
+/* Update random records with some work in between; returns ns taken */
+static uint64_t mode_workload(uint8_t *records, uint64_t iterations) {
+    uint64_t x = 0x9E3779B97F4A7C15ULL, sink = 0;
+    uint64_t t0 = bench_now_ns();
+    for (uint64_t i = 0; i < iterations; i++) {
+        for (int w = 0; w < MODE_WORK; w++) sink += bench_xorshift(&x);
+        uint8_t *r = records + (x % MODE_RECORDS) * MODE_RECORD_SIZE;
+        memcpy(r + (i & 31) * 8, &sink, 8);
+    }
+    uint64_t took = bench_now_ns() - t0;
+    __asm__ volatile("" : : "r"(sink));
+    return took;
+}
+
+int bench_modes(bench_json_t *j, const bench_opts_t *o) {
+    if (native_load() != 0) return 1;
+    uint64_t iterations = bench_scaled(o, 2000000, 50000);
+    size_t bytes = MODE_RECORDS * MODE_RECORD_SIZE;
+    uint8_t *records = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (records == MAP_FAILED) return 1;
+    memset(records, 0, bytes);
+
+    /* Best of three untracked runs */
+    uint64_t base = UINT64_MAX;
+    for (int r = 0; r < 3; r++) {
+        uint64_t t = mode_workload(records, iterations);
+        if (t < base) base = t;
+    }
+
+    int failed = 0;
+    bench_json_begin(j, "modes");
+    bench_json_str(j, "description", "random 8-byte updates to 1024 watched 256-byte records, "
+                   "work between writes; mode = capture level (max_value_bytes) and the "
+                   "overhead budget the governor enforces");
+    bench_json_u64(j, "iterations", iterations);
+    bench_json_f64(j, "baseline_ms", (double)base / 1e6);
+    bench_json_begin_array(j, "runs");
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        char err[256] = "";
+        if (native_start(NULL, err, sizeof(err)) != 0 || native_set_mode(modes[m].mode, err, sizeof(err)) != 0 ||
+            native_track(records, MODE_RECORDS, MODE_RECORD_SIZE, MODE_RECORD_SIZE, modes[m].max_value_bytes) != 0) {
+            bench_log("  %s: %s", modes[m].mode, err);
+            failed = 1;
+            continue;
+        }
+        atomic_store(&delivered, 0);
+        uint64_t t = mode_workload(records, iterations);
+        wait_quiet();
+        uint64_t events = atomic_load(&delivered);
+        uint64_t demotions = native_governor_stat("demotions");
+        native_stop();
+
+        double overhead = ((double)t - (double)base) * 100.0 / (double)base;
+        bench_json_begin(j, NULL);
+        bench_json_str(j, "mode", modes[m].mode);
+        bench_json_f64(j, "max_value_bytes", modes[m].max_value_bytes);
+        bench_json_f64(j, "ms", (double)t / 1e6);
+        bench_json_u64(j, "events", events);
+        bench_json_u64(j, "governor_demotions", demotions);
+        bench_json_f64(j, "overhead_pct", overhead);
+        bench_json_f64(j, "target_pct", modes[m].target_pct);
+        bench_json_bool(j, "within_target", overhead <= modes[m].target_pct);
+        bench_json_end(j);
+        bench_log("  %-8s %8.1f ms  %+7.1f%% (target %.0f%%)  %llu events  %llu demotions", modes[m].mode,
+                  (double)t / 1e6, overhead, modes[m].target_pct, (unsigned long long)events,
+                  (unsigned long long)demotions);
+    }
+    bench_json_end_array(j);
+    bench_json_end(j);
+    munmap(records, bytes);
+    return failed;
+}
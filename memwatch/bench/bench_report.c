@@ -0,0 +1,182 @@
+/*
+ * bench_report.c - Latency histogram and JSON writer for the benchmarks
+ */
+
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+
+#include "bench.h"
+
+/* ============================================================================
+ * Histogram
+ * ============================================================================ */
+
+static inline unsigned hist_index(uint64_t v) {
+    if (v < 2 * BENCH_HIST_SUB) return (unsigned)v;
+    unsigned shift = 63 - (unsigned)__builtin_clzll(v) - BENCH_HIST_SUB_BITS;
+    return shift * BENCH_HIST_SUB + (unsigned)(v >> shift);
+}
+
+/* Highest value that lands in bucket i */
+static inline uint64_t hist_value(unsigned i) {
+    if (i < 2 * BENCH_HIST_SUB) return i;
+    unsigned shift = i / BENCH_HIST_SUB - 1;
+    uint64_t base = (uint64_t)(i - shift * BENCH_HIST_SUB) << shift;
+    return base + ((1ULL << shift) - 1);
+}
+
+void bench_hist_init(bench_hist_t *h) {
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+void bench_hist_record(bench_hist_t *h, uint64_t value) {
+    h->counts[hist_index(value)]++;
+    h->total++;
+    h->sum += (double)value;
+    if (value < h->min) h->min = value;
+    if (value > h->max) h->max = value;
+}
+
+void bench_hist_merge(bench_hist_t *dst, const bench_hist_t *src) {
+    for (unsigned i = 0; i < BENCH_HIST_BUCKETS; i++) {
+        dst->counts[i] += src->counts[i];
+    }
+    dst->total += src->total;
+    dst->sum += src->sum;
+    if (src->min < dst->min) dst->min = src->min;
+    if (src->max > dst->max) dst->max = src->max;
+}
+
+uint64_t bench_hist_percentile(const bench_hist_t *h, double pct) {
+    if (h->total == 0) return 0;
+    uint64_t rank = (uint64_t)ceil(pct / 100.0 * (double)h->total);
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < BENCH_HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            uint64_t v = hist_value(i);
+            return v < h->min ? h->min : v > h->max ? h->max : v;
+        }
+    }
+    return h->max;
+}
+
+/* ============================================================================
+ * JSON
+ * ============================================================================ */
+
+static void json_key(bench_json_t *j, const char *key) {
+    if (j->depth > 0) {
+        fputs(j->first[j->depth] ? "\n" : ",\n", j->out);
+        j->first[j->depth] = false;
+    }
+    fprintf(j->out, "%*s", j->depth * 2, "");
+    if (key) fprintf(j->out, "\"%s\": ", key);
+}
+
+static void json_string(FILE *out, const char *s) {
+    fputc('"', out);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            fprintf(out, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void json_open(bench_json_t *j, const char *key, char bracket) {
+    json_key(j, key);
+    fputc(bracket, j->out);
+    if (j->depth + 1 < BENCH_JSON_DEPTH) j->depth++;
+    j->first[j->depth] = true;
+}
+
+static void json_close(bench_json_t *j, char bracket) {
+    bool empty = j->first[j->depth];
+    j->depth--;
+    if (!empty) fprintf(j->out, "\n%*s", j->depth * 2, "");
+    fputc(bracket, j->out);
+    if (j->depth == 0) fputc('\n', j->out);
+}
+
+void bench_json_begin(bench_json_t *j, const char *key) {
+    json_open(j, key, '{');
+}
+
+void bench_json_end(bench_json_t *j) {
+    json_close(j, '}');
+}
+
+void bench_json_begin_array(bench_json_t *j, const char *key) {
+    json_open(j, key, '[');
+}
+
+void bench_json_end_array(bench_json_t *j) {
+    json_close(j, ']');
+}
+
+void bench_json_str(bench_json_t *j, const char *key, const char *value) {
+    json_key(j, key);
+    if (value) {
+        json_string(j->out, value);
+    } else {
+        fputs("null", j->out);
+    }
+}
+
+void bench_json_u64(bench_json_t *j, const char *key, uint64_t value) {
+    json_key(j, key);
+    fprintf(j->out, "%llu", (unsigned long long)value);
+}
+
+void bench_json_f64(bench_json_t *j, const char *key, double value) {
+    json_key(j, key);
+    if (isfinite(value)) {
+        fprintf(j->out, "%.6g", value);
+    } else {
+        fputs("null", j->out);
+    }
+}
+
+void bench_json_bool(bench_json_t *j, const char *key, bool value) {
+    json_key(j, key);
+    fputs(value ? "true" : "false", j->out);
+}
+
+void bench_json_hist(bench_json_t *j, const char *key, const bench_hist_t *h) {
+    bench_json_begin(j, key);
+    bench_json_u64(j, "count", h->total);
+    bench_json_u64(j, "min", h->total ? h->min : 0);
+    bench_json_f64(j, "mean", h->total ? h->sum / (double)h->total : 0.0);
+    bench_json_u64(j, "p50", bench_hist_percentile(h, 50));
+    bench_json_u64(j, "p90", bench_hist_percentile(h, 90));
+    bench_json_u64(j, "p99", bench_hist_percentile(h, 99));
+    bench_json_u64(j, "p999", bench_hist_percentile(h, 99.9));
+    bench_json_u64(j, "max", h->max);
+    bench_json_end(j);
+}
+
+/* ============================================================================
+ * Options and progress
+ * ============================================================================ */
+
+uint64_t bench_scaled(const bench_opts_t *o, uint64_t n, uint64_t min) {
+    uint64_t scaled = (uint64_t)((double)n * o->scale);
+    return scaled < min ? min : scaled;
+}
+
+void bench_log(const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+}
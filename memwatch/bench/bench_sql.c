@@ -0,0 +1,112 @@
+/*
+ * bench_sql.c - sql_tracker_track_query() statements per second
+ *
+ * Statements are formatted up front (a pool of SQL_POOL, cycled) so only
+ * tracking is timed. Mixes: one UPDATE shape with changing literals (the
+ * statement cache's best case), multi-column INSERTs, UPDATE/INSERT/DELETE
+ * over eight tables with and without the cache, and the UPDATEs again
+ * with a change log, whose writer thread takes the I/O.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "sql_tracker.h"
+
+#define SQL_STATEMENTS 500000
+#define SQL_POOL       1024
+#define SQL_LEN        256
+#define SQL_RETAINED   100000
+
+typedef enum { MIX_UPDATE, MIX_INSERT, MIX_MIXED } sql_mix_t;
+
+static const struct {
+    const char *name;
+    sql_mix_t mix;
+    int cache_entries;
+    bool logged;
+} sql_runs[] = {
+    { "update", MIX_UPDATE, 0, false },
+    { "insert", MIX_INSERT, 0, false },
+    { "mixed", MIX_MIXED, 0, false },
+    { "mixed_uncached", MIX_MIXED, -1, false },
+    { "update_logged", MIX_UPDATE, 0, true },
+};
+
+static void format_statement(char *out, sql_mix_t mix, uint64_t i) {
+    static const char *tables[] = { "accounts", "orders", "users", "items",
+                                    "invoices", "events", "sessions", "carts" };
+    const char *table = tables[i % 8];
+    unsigned n = (unsigned)(i * 2654435761u % 100000);
+    switch (mix == MIX_MIXED ? (sql_mix_t)(i % 3) : mix) {
+    case MIX_UPDATE:
+        snprintf(out, SQL_LEN, "UPDATE %s SET balance = %u, status = 'active' WHERE id = %u",
+                 mix == MIX_MIXED ? table : "accounts", n, n % 997);
+        break;
+    case MIX_INSERT:
+        snprintf(out, SQL_LEN, "INSERT INTO %s (id, customer, amount, note) VALUES (%u, 'c%u', %u, 'n')",
+                 mix == MIX_MIXED ? table : "orders", n, n % 31, n * 3);
+        break;
+    default:
+        snprintf(out, SQL_LEN, "DELETE FROM %s WHERE id = %u", table, n);
+        break;
+    }
+}
+
+int bench_sql(bench_json_t *j, const bench_opts_t *o) {
+    uint64_t statements = bench_scaled(o, SQL_STATEMENTS, 20000);
+    static char pool[SQL_POOL][SQL_LEN];
+    static bench_hist_t hist;
+    int failed = 0;
+
+    bench_json_begin(j, "sql");
+    bench_json_u64(j, "statements", statements);
+    bench_json_begin_array(j, "runs");
+    for (size_t r = 0; r < sizeof(sql_runs) / sizeof(sql_runs[0]); r++) {
+        for (uint64_t i = 0; i < SQL_POOL; i++) format_statement(pool[i], sql_runs[r].mix, i);
+
+        char path[256];
+        snprintf(path, sizeof(path), "%s/%s.sqllog", o->tmpdir, sql_runs[r].name);
+        SQLTrackerConfig config = {
+            .storage_path = sql_runs[r].logged ? path : NULL,
+            .max_changes = SQL_RETAINED,
+            .retention = SQL_RETAIN_LATEST,
+            .cache_entries = sql_runs[r].cache_entries,
+        };
+        SQLTracker *tracker = sql_tracker_init_ex(&config);
+        if (!tracker) {
+            perror(sql_runs[r].name);
+            failed = 1;
+            continue;
+        }
+
+        bench_hist_init(&hist);
+        uint64_t changes = 0;
+        uint64_t t0 = bench_now_ns();
+        for (uint64_t i = 0; i < statements; i++) {
+            uint64_t s = bench_now_ns();
+            changes += (uint64_t)sql_tracker_track_query(tracker, pool[i % SQL_POOL], 1, "bench", "0", "1");
+            bench_hist_record(&hist, bench_now_ns() - s);
+        }
+        double rate = (double)statements * 1e9 / (double)(bench_now_ns() - t0);
+        sql_tracker_free(tracker);
+        if (changes == 0) failed = 1;
+
+        bench_json_begin(j, NULL);
+        bench_json_str(j, "mix", sql_runs[r].name);
+        bench_json_bool(j, "cache", sql_runs[r].cache_entries >= 0);
+        bench_json_bool(j, "change_log", sql_runs[r].logged);
+        bench_json_f64(j, "statements_per_sec", rate);
+        bench_json_u64(j, "changes", changes);
+        bench_json_hist(j, "latency_ns", &hist);
+        bench_json_end(j);
+        bench_log("  %-16s %10.0f statements/s  p99 %llu ns", sql_runs[r].name, rate,
+                  (unsigned long long)bench_hist_percentile(&hist, 99));
+    }
+    bench_json_end_array(j);
+    bench_json_end(j);
+    return failed;
+}
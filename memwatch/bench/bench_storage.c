@@ -0,0 +1,191 @@
+/*
+ * bench_storage.c - FastStorage write/read throughput and latency
+ *
+ * Every key size x value size, on one thread and on --threads threads,
+ * each thread writing its own slice of the keys and then reading random
+ * ones. The same single-threaded runs go against the older
+ * storage_utility/faststorage.c store, which is not thread-safe; its
+ * reads return a pointer into the map, so they are copied out here the
+ * way faststorage_read() copies them.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "bench.h"
+#include "faststorage_fast.h"
+
+#define STORAGE_OPS         200000
+#define STORAGE_BYTES_MAX   (256u << 20)       /* keys x values per run */
+#define STORAGE_MAX_THREADS 64
+#define STORAGE_KEY_MAX     256
+
+/* storage_utility/faststorage.c has no header */
+typedef struct legacy_store legacy_store_t;
+legacy_store_t *fast_storage_create(const char *filename, size_t size);
+void fast_storage_destroy(legacy_store_t *storage);
+int fast_storage_write(legacy_store_t *storage, const char *key, size_t key_len,
+                       const char *value, size_t value_len);
+int fast_storage_read(legacy_store_t *storage, const char *key, size_t key_len,
+                      char **value_out, size_t *value_len_out);
+
+static const size_t key_sizes[] = { 16, 64, 200 };
+static const size_t value_sizes[] = { 64, 1024, 16384 };
+
+typedef struct {
+    FastStorage *fs;
+    legacy_store_t *legacy;
+    size_t key_size;
+    size_t value_size;
+    uint64_t first, count;   /* keys written */
+    uint64_t keys;           /* keys in all, for reads */
+    bool reading;
+    uint64_t failures;
+    bench_hist_t hist;
+} storage_worker_t;
+
+static void make_key(char *key, size_t size, uint64_t i) {
+    snprintf(key, size + 1, "%0*llu", (int)size, (unsigned long long)i);
+}
+
+static void *storage_worker(void *arg) {
+    storage_worker_t *w = arg;
+    char key[STORAGE_KEY_MAX + 1];
+    uint8_t *value = malloc(w->value_size);
+    if (!value) {
+        w->failures = w->count;
+        return NULL;
+    }
+    memset(value, 'v', w->value_size);
+    uint64_t x = 0x9E3779B97F4A7C15ULL ^ (w->first + 1);
+
+    for (uint64_t n = 0; n < w->count; n++) {
+        uint64_t i = w->reading ? bench_xorshift(&x) % w->keys : w->first + n;
+        make_key(key, w->key_size, i);
+        uint64_t t0 = bench_now_ns();
+        int rc;
+        if (w->legacy && w->reading) {
+            char *ptr;
+            size_t len;
+            rc = fast_storage_read(w->legacy, key, w->key_size, &ptr, &len);
+            if (rc == 0) memcpy(value, ptr, len < w->value_size ? len : w->value_size);
+        } else if (w->legacy) {
+            rc = fast_storage_write(w->legacy, key, w->key_size, (const char *)value, w->value_size);
+        } else if (w->reading) {
+            size_t len = w->value_size;
+            rc = faststorage_read(w->fs, key, value, &len);
+        } else {
+            rc = faststorage_write(w->fs, key, value, w->value_size);
+        }
+        bench_hist_record(&w->hist, bench_now_ns() - t0);
+        w->failures += rc != 0;
+    }
+    free(value);
+    return NULL;
+}
+
+/* One phase over threads workers; ops/s into *rate, latencies into hist */
+static uint64_t storage_phase(storage_worker_t *workers, int threads, bool reading, uint64_t keys,
+                              double *rate, bench_hist_t *hist) {
+    pthread_t tids[STORAGE_MAX_THREADS];
+    uint64_t t0 = bench_now_ns();
+    for (int t = 0; t < threads; t++) {
+        storage_worker_t *w = &workers[t];
+        w->reading = reading;
+        w->first = keys * (uint64_t)t / (uint64_t)threads;
+        w->count = keys * (uint64_t)(t + 1) / (uint64_t)threads - w->first;
+        w->keys = keys;
+        w->failures = 0;
+        bench_hist_init(&w->hist);
+        pthread_create(&tids[t], NULL, storage_worker, w);
+    }
+    uint64_t failures = 0;
+    bench_hist_init(hist);
+    for (int t = 0; t < threads; t++) {
+        pthread_join(tids[t], NULL);
+        bench_hist_merge(hist, &workers[t].hist);
+        failures += workers[t].failures;
+    }
+    *rate = (double)keys * 1e9 / (double)(bench_now_ns() - t0);
+    return failures;
+}
+
+static int storage_run(bench_json_t *j, const bench_opts_t *o, bool legacy, int threads,
+                       size_t key_size, size_t value_size) {
+    uint64_t keys = bench_scaled(o, STORAGE_OPS, 2000);
+    if (keys * (key_size + value_size) > STORAGE_BYTES_MAX) keys = STORAGE_BYTES_MAX / (key_size + value_size);
+
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s_%zu_%zu_%d.fs", o->tmpdir, legacy ? "legacy" : "fast",
+             key_size, value_size, threads);
+    static storage_worker_t workers[STORAGE_MAX_THREADS];
+    static bench_hist_t write_hist, read_hist;
+    FastStorage *fs = NULL;
+    legacy_store_t *old = NULL;
+    if (legacy) {
+        old = fast_storage_create(path, keys * (32 + key_size + value_size) + (1u << 20));
+    } else {
+        fs = faststorage_create(path, 64u << 20);
+    }
+    if (!fs && !old) {
+        perror(path);
+        return -1;
+    }
+    for (int t = 0; t < threads; t++) {
+        workers[t] = (storage_worker_t){ .fs = fs, .legacy = old, .key_size = key_size, .value_size = value_size };
+    }
+
+    double write_rate, read_rate;
+    uint64_t failures = storage_phase(workers, threads, false, keys, &write_rate, &write_hist);
+    failures += storage_phase(workers, threads, true, keys, &read_rate, &read_hist);
+    if (legacy) {
+        fast_storage_destroy(old);
+    } else {
+        faststorage_destroy(fs);
+    }
+    unlink(path);
+
+    bench_json_begin(j, NULL);
+    bench_json_str(j, "impl", legacy ? "storage_utility/faststorage.c" : "faststorage_fast.c");
+    bench_json_u64(j, "threads", (uint64_t)threads);
+    bench_json_u64(j, "key_bytes", key_size);
+    bench_json_u64(j, "value_bytes", value_size);
+    bench_json_u64(j, "keys", keys);
+    bench_json_u64(j, "failures", failures);
+    bench_json_begin(j, "write");
+    bench_json_f64(j, "ops_per_sec", write_rate);
+    bench_json_hist(j, "latency_ns", &write_hist);
+    bench_json_end(j);
+    bench_json_begin(j, "read");
+    bench_json_f64(j, "ops_per_sec", read_rate);
+    bench_json_hist(j, "latency_ns", &read_hist);
+    bench_json_end(j);
+    bench_json_end(j);
+    bench_log("  %-30s %2d thr  key %3zu  value %5zu: write %9.0f/s  read %9.0f/s", legacy ?
+              "storage_utility/faststorage.c" : "faststorage_fast.c", threads, key_size, value_size,
+              write_rate, read_rate);
+    return failures ? -1 : 0;
+}
+
+int bench_storage(bench_json_t *j, const bench_opts_t *o) {
+    int threads[] = { 1, o->max_threads < STORAGE_MAX_THREADS ? o->max_threads : STORAGE_MAX_THREADS };
+    int failed = 0;
+    bench_json_begin(j, "storage");
+    bench_json_begin_array(j, "runs");
+    for (size_t k = 0; k < sizeof(key_sizes) / sizeof(key_sizes[0]); k++) {
+        for (size_t v = 0; v < sizeof(value_sizes) / sizeof(value_sizes[0]); v++) {
+            failed |= storage_run(j, o, true, 1, key_sizes[k], value_sizes[v]) != 0;
+            for (size_t t = 0; t < 2; t++) {
+                if (t == 1 && threads[1] == 1) break;
+                failed |= storage_run(j, o, false, threads[t], key_sizes[k], value_sizes[v]) != 0;
+            }
+        }
+    }
+    bench_json_end_array(j);
+    bench_json_end(j);
+    return failed;
+}
@@ -0,0 +1,164 @@
+/*
+ * faststorage_mt_bench.c - FastStorage throughput under concurrent access
+ *
+ * Runs a 90% read / 10% write mix over a preloaded key set from 1 to 32
+ * threads, once against a single store and once against a sharded one,
+ * and reports Mops/s with the speedup over one thread. Reads go through
+ * the lock-free path either way; writes contend on one lock in the single
+ * store and spread over BENCH_SHARDS locks in the sharded one. Scaling is
+ * bounded by the CPUs online, printed first.
+ *
+ * Build: make bench-faststorage-mt
+ * Run:   ./build/faststorage_mt_bench
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "faststorage_fast.h"
+
+#define BENCH_KEYS        100000
+#define BENCH_VALUE_SIZE  64
+#define BENCH_SHARDS      32
+#define BENCH_WRITE_PCT   10
+#define BENCH_RUN_MS      500
+#define BENCH_MAX_THREADS 32
+
+static const int thread_counts[] = { 1, 2, 4, 8, 16, 32 };
+
+typedef struct {
+    FastStorage *fs;
+    uint64_t seed;
+    uint64_t ops;
+    uint64_t failures;
+} Worker;
+
+static volatile int running;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t next_random(uint64_t *x) {
+    *x ^= *x << 13; *x ^= *x >> 7; *x ^= *x << 17;
+    return *x;
+}
+
+static void *worker_main(void *arg) {
+    Worker *w = arg;
+    char key[32];
+    char value[BENCH_VALUE_SIZE];
+    memset(value, 'v', sizeof(value));
+
+    while (__atomic_load_n(&running, __ATOMIC_RELAXED)) {
+        uint64_t r = next_random(&w->seed);
+        snprintf(key, sizeof(key), "key_%u", (unsigned)(r % BENCH_KEYS));
+        if ((r >> 32) % 100 < BENCH_WRITE_PCT) {
+            w->failures += faststorage_write(w->fs, key, value, sizeof(value)) != 0;
+        } else {
+            char out[BENCH_VALUE_SIZE];
+            size_t len = sizeof(out);
+            w->failures += faststorage_read(w->fs, key, out, &len) != 0;
+        }
+        w->ops++;
+    }
+    return NULL;
+}
+
+static double run(FastStorage *fs, int threads, uint64_t *failures) {
+    /* Mops/s of threads workers over BENCH_RUN_MS */
+    pthread_t tids[BENCH_MAX_THREADS];
+    Worker workers[BENCH_MAX_THREADS];
+
+    running = 1;
+    for (int i = 0; i < threads; i++) {
+        workers[i] = (Worker){ fs, 0x9E3779B97F4A7C15ULL * (i + 1), 0, 0 };
+        pthread_create(&tids[i], NULL, worker_main, &workers[i]);
+    }
+    uint64_t t0 = now_ns();
+    struct timespec pause = { BENCH_RUN_MS / 1000, (BENCH_RUN_MS % 1000) * 1000000L };
+    nanosleep(&pause, NULL);
+    __atomic_store_n(&running, 0, __ATOMIC_RELAXED);
+
+    uint64_t ops = 0;
+    for (int i = 0; i < threads; i++) {
+        pthread_join(tids[i], NULL);
+        ops += workers[i].ops;
+        *failures += workers[i].failures;
+    }
+    return (double)ops * 1000.0 / (double)(now_ns() - t0);
+}
+
+static int bench(const char *name, FastStorage *fs) {
+    if (!fs) {
+        perror(name);
+        return 1;
+    }
+
+    char key[32];
+    char value[BENCH_VALUE_SIZE];
+    memset(value, 'v', sizeof(value));
+    for (unsigned k = 0; k < BENCH_KEYS; k++) {
+        snprintf(key, sizeof(key), "key_%u", k);
+        if (faststorage_write(fs, key, value, sizeof(value)) != 0) {
+            perror("faststorage_write");
+            faststorage_destroy(fs);
+            return 1;
+        }
+    }
+
+    uint64_t failures = 0;
+    double base = 0;
+    printf("%s\n%8s  %10s  %8s\n", name, "threads", "Mops/s", "speedup");
+    for (size_t i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); i++) {
+        double mops = run(fs, thread_counts[i], &failures);
+        if (i == 0) base = mops;
+        printf("%8d  %10.2f  %7.1fx\n", thread_counts[i], mops, mops / base);
+    }
+    printf("\n");
+    faststorage_destroy(fs);
+
+    if (failures) {
+        fprintf(stderr, "%s: %llu failed operations\n", name, (unsigned long long)failures);
+        return 1;
+    }
+    return 0;
+}
+
+int main(void) {
+    char dir[] = "/tmp/faststorage_mt_bench.XXXXXX";
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    char path[64];
+
+    printf("%ld CPUs online, %d keys, %d-byte values, %d%% writes\n\n",
+           sysconf(_SC_NPROCESSORS_ONLN), BENCH_KEYS, BENCH_VALUE_SIZE, BENCH_WRITE_PCT);
+
+    int failures = 0;
+    snprintf(path, sizeof(path), "%s/single.fs", dir);
+    failures += bench("single store", faststorage_create(path, 16 * 1024 * 1024));
+    unlink(path);
+
+    char title[32];
+    snprintf(title, sizeof(title), "%d shards", BENCH_SHARDS);
+    snprintf(path, sizeof(path), "%s/sharded.fs", dir);
+    failures += bench(title, faststorage_create_sharded(path, 16 * 1024 * 1024, BENCH_SHARDS));
+    for (int i = 0; i < BENCH_SHARDS; i++) {
+        char shard[80];
+        snprintf(shard, sizeof(shard), "%s.%d", path, i);
+        unlink(shard);
+    }
+    rmdir(dir);
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,134 @@
+/*
+ * memwatch_bench.c - Native benchmark suite, one JSON report
+ *
+ * Suites (--only NAME runs one):
+ *   fault     fault-to-callback latency of memwatch.c (through its Python
+ *             module, embedded) and memwatch_core_minimal.c, per backend
+ *   ring      fault ring enqueue/drain throughput with 1..N writer threads
+ *   modes     end-to-end overhead of a synthetic workload per mode
+ *             (lite/balanced/deep) against Architecture.yaml's targets
+ *   storage   faststorage_write/read over key sizes, value sizes and
+ *             threads, next to storage_utility/faststorage.c
+ *   sql       sql_tracker_track_query statements per second
+ *
+ * The report goes to stdout (or -o FILE) and nothing else does, so it can
+ * be diffed against a baseline to gate an upgrade; progress goes to
+ * stderr. --quick runs a tenth of the work, for CI smoke runs.
+ *
+ * Build: make build/memwatch_bench
+ * Run:   make bench              (writes build/bench.json)
+ *        ./build/memwatch_bench [--quick] [--only SUITE] [--threads N] [-o FILE]
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <ftw.h>
+#include <sys/utsname.h>
+
+#include "bench.h"
+
+#define BENCH_SCHEMA "memwatch-bench/1"
+
+static const struct {
+    const char *name;
+    int (*run)(bench_json_t *j, const bench_opts_t *o);
+} suites[] = {
+    { "fault", bench_fault },
+    { "ring", bench_ring },
+    { "modes", bench_modes },
+    { "storage", bench_storage },
+    { "sql", bench_sql },
+};
+
+#define SUITE_COUNT (sizeof(suites) / sizeof(suites[0]))
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [--quick] [--only SUITE] [--threads N] [-o FILE]\n  suites:", argv0);
+    for (size_t i = 0; i < SUITE_COUNT; i++) fprintf(stderr, " %s", suites[i].name);
+    fputc('\n', stderr);
+}
+
+static int remove_entry(const char *path, const struct stat *st, int flag, struct FTW *ftw) {
+    (void)st; (void)flag; (void)ftw;
+    return remove(path);
+}
+
+int main(int argc, char **argv) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    bench_opts_t opts = { 1.0, cpus > 8 ? 8 : (int)(cpus < 1 ? 1 : cpus), NULL, NULL };
+    const char *out_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            opts.scale = 0.1;
+        } else if (strcmp(argv[i], "--only") == 0 && i + 1 < argc) {
+            opts.only = argv[++i];
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            opts.max_threads = atoi(argv[++i]);
+            if (opts.max_threads < 1) opts.max_threads = 1;
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (opts.only) {
+        size_t i = 0;
+        while (i < SUITE_COUNT && strcmp(suites[i].name, opts.only) != 0) i++;
+        if (i == SUITE_COUNT) {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    char tmpdir[] = "/tmp/memwatch_bench.XXXXXX";
+    if (!mkdtemp(tmpdir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    opts.tmpdir = tmpdir;
+
+    FILE *out = stdout;
+    if (out_path && !(out = fopen(out_path, "w"))) {
+        perror(out_path);
+        return 1;
+    }
+
+    struct utsname uts;
+    uname(&uts);
+    bench_json_t j = { out, 0, { true } };
+    bench_json_begin(&j, NULL);
+    bench_json_str(&j, "schema", BENCH_SCHEMA);
+    bench_json_u64(&j, "unix_time", (uint64_t)time(NULL));
+    bench_json_begin(&j, "host");
+    bench_json_u64(&j, "cpus", (uint64_t)cpus);
+    bench_json_str(&j, "kernel", uts.release);
+    bench_json_str(&j, "machine", uts.machine);
+    bench_json_end(&j);
+    bench_json_begin(&j, "options");
+    bench_json_f64(&j, "scale", opts.scale);
+    bench_json_u64(&j, "max_threads", (uint64_t)opts.max_threads);
+    bench_json_end(&j);
+
+    int failed = 0;
+    bench_json_begin(&j, "suites");
+    for (size_t i = 0; i < SUITE_COUNT; i++) {
+        if (opts.only && strcmp(opts.only, suites[i].name) != 0) continue;
+        bench_log("== %s", suites[i].name);
+        if (suites[i].run(&j, &opts) != 0) {
+            bench_log("%s: failed", suites[i].name);
+            failed++;
+        }
+    }
+    bench_json_end(&j);
+    bench_json_bool(&j, "ok", failed == 0);
+    bench_json_end(&j);
+
+    if (out != stdout) fclose(out);
+    nftw(tmpdir, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,109 @@
+/*
+ * page_index_bench.c - Lookup cost of the memwatch page index
+ *
+ * Inserts N tracked pages (1K .. 1M) and measures the average cost of a
+ * hit (the worker draining a fault) and a miss (the signal handler seeing
+ * a foreign page). Both should stay flat as N grows.
+ *
+ * Build: make bench-page-index
+ * Run:   ./build/page_index_bench
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "memwatch_page_index.h"
+
+#define BENCH_PAGE_SIZE 4096
+#define BENCH_LOOKUPS   (4u * 1024 * 1024)
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t xorshift64(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+static void run(size_t n_pages) {
+    mw_page_index_t idx;
+    if (mw_page_index_init(&idx, MW_PAGE_INDEX_MIN_CAPACITY) != 0) {
+        fprintf(stderr, "init failed\n");
+        exit(1);
+    }
+
+    /* Spread pages like a real heap: mostly contiguous runs with gaps */
+    uintptr_t *pages = malloc(n_pages * sizeof(uintptr_t));
+    uint64_t rng = 0x9E3779B97F4A7C15ULL;
+    uintptr_t page = 0x7f0000000000ULL;
+    for (size_t i = 0; i < n_pages; i++) {
+        page += BENCH_PAGE_SIZE * (1 + (xorshift64(&rng) % 4 == 0 ? xorshift64(&rng) % 64 : 0));
+        pages[i] = page;
+    }
+
+    uint64_t t0 = now_ns();
+    for (size_t i = 0; i < n_pages; i++) {
+        mw_page_index_put(&idx, pages[i], &pages[i]);
+    }
+    uint64_t insert_ns = now_ns() - t0;
+
+    /* Random hits */
+    uint32_t *order = malloc(BENCH_LOOKUPS * sizeof(uint32_t));
+    for (size_t i = 0; i < BENCH_LOOKUPS; i++) {
+        order[i] = (uint32_t)(xorshift64(&rng) % n_pages);
+    }
+
+    size_t found = 0;
+    t0 = now_ns();
+    for (size_t i = 0; i < BENCH_LOOKUPS; i++) {
+        found += mw_page_index_get(&idx, pages[order[i]]) != NULL;
+    }
+    uint64_t hit_ns = now_ns() - t0;
+
+    /* Misses: pages far outside the tracked range */
+    size_t missed = 0;
+    t0 = now_ns();
+    for (size_t i = 0; i < BENCH_LOOKUPS; i++) {
+        uintptr_t foreign = 0x100000000ULL + (uintptr_t)order[i] * BENCH_PAGE_SIZE;
+        missed += !mw_page_index_contains(&idx, foreign);
+    }
+    uint64_t miss_ns = now_ns() - t0;
+
+    printf("%10zu  %10.1f  %10.1f  %10.1f  %12zu  %6zu\n",
+           n_pages,
+           (double)insert_ns / n_pages,
+           (double)hit_ns / BENCH_LOOKUPS,
+           (double)miss_ns / BENCH_LOOKUPS,
+           mw_page_index_memory_bytes(&idx),
+           (size_t)atomic_load(&idx.grow_count));
+
+    if (found != BENCH_LOOKUPS || missed != BENCH_LOOKUPS) {
+        fprintf(stderr, "lookup mismatch: found=%zu missed=%zu\n", found, missed);
+        exit(1);
+    }
+
+    free(order);
+    free(pages);
+    mw_page_index_destroy(&idx);
+}
+
+int main(void) {
+    printf("%10s  %10s  %10s  %10s  %12s  %6s\n",
+           "pages", "insert_ns", "hit_ns", "miss_ns", "index_bytes", "grows");
+
+    for (size_t n = 1024; n <= 1024 * 1024; n *= 4) {
+        run(n);
+    }
+
+    return 0;
+}
@@ -0,0 +1,20 @@
+{
+  "targets": [
+    {
+      "target_name": "memwatch_native",
+      "sources": [
+        "memwatch_node.cc",
+        "../src/memwatch_core_minimal.c",
+        "../src/memwatch_backend.c",
+        "../src/memwatch_stats.c",
+        "../src/memwatch_hash.c",
+        "../src/faststorage_fast.c"
+      ],
+      "include_dirs": ["../include"],
+      "cflags": ["-Wall", "-O2"],
+      "cflags_c": ["-std=gnu11"],
+      "cflags_cc": ["-std=gnu++17"],
+      "libraries": ["-lpthread", "-lm", "-lrt"]
+    }
+  ]
+}
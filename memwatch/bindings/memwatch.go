@@ -118,6 +118,66 @@ func (w *MemWatch) Watch(data interface{}, name string) (uint32, error) {
     return uint32(region_id), nil
 }
 
+// WatchMany watches several slices with one call: the core takes its
+// locks once and protects each run of adjacent pages together.
+// names is indexed like items and may be shorter. Returns one region_id per
+// item in order, 0 where the core could not watch it.
+func (w *MemWatch) WatchMany(items []interface{}, names []string) ([]uint32, error) {
+    if len(items) == 0 {
+        return nil, nil
+    }
+    
+    specs := (*[1 << 28]C.memwatch_watch_spec_t)(C.malloc(C.size_t(len(items)) * C.size_t(unsafe.Sizeof(C.memwatch_watch_spec_t{}))))[:len(items):len(items)]
+    defer C.free(unsafe.Pointer(&specs[0]))
+    ids := make([]C.memwatch_region_id, len(items))
+    
+    for i, data := range items {
+        var addr uintptr
+        var size int
+        switch v := data.(type) {
+        case []byte:
+            if len(v) == 0 {
+                return nil, fmt.Errorf("item %d: cannot watch empty slice", i)
+            }
+            addr = uintptr(unsafe.Pointer(&v[0]))
+            size = len(v)
+        case []int:
+            if len(v) == 0 {
+                return nil, fmt.Errorf("item %d: cannot watch empty slice", i)
+            }
+            addr = uintptr(unsafe.Pointer(&v[0]))
+            size = len(v) * 8
+        default:
+            return nil, fmt.Errorf("item %d: unsupported type: %T", i, v)
+        }
+        specs[i] = C.memwatch_watch_spec_t{addr: C.uint64_t(addr), size: C.size_t(size)}
+    }
+    
+    // The core keeps name pointers for the region's lifetime, so names
+    // are only freed for specs it rejected
+    for i := range specs {
+        if i < len(names) && names[i] != "" {
+            specs[i].name = C.CString(names[i])
+        }
+    }
+    
+    watched := C.memwatch_watch_batch(&specs[0], C.size_t(len(items)), &ids[0])
+    
+    result := make([]uint32, len(items))
+    for i := range specs {
+        if watched < 0 || ids[i] == 0 {
+            C.free(unsafe.Pointer(specs[i].name))
+            continue
+        }
+        result[i] = uint32(ids[i])
+        w.trackedObjects[result[i]] = items[i]
+    }
+    if watched < 0 {
+        return nil, fmt.Errorf("memwatch_watch_batch failed: %d", int(watched))
+    }
+    return result, nil
+}
+
 // Unwatch stops watching a region
 func (w *MemWatch) Unwatch(region_id uint32) bool {
     result := C.memwatch_unwatch(C.memwatch_region_id(region_id))
@@ -9,6 +9,7 @@ const native = require('./build/Release/memwatch_native');
 class ChangeEvent {
   constructor(data) {
     this.seq = data.seq;
+    this.region_id = data.region_id;
     this.timestamp_ns = data.timestamp_ns;
     this.variable_name = data.variable_name;
     this.where = data.where;
@@ -21,6 +22,63 @@ class ChangeEvent {
   }
 }
 
+const RECORD_WORDS = 8;
+
+/**
+ * Change events delivered together, read in place: a Uint32Array of
+ * 8-word records (seq, region_id, timestamp_ns low/high, old offset/length,
+ * new offset/length) over an ArrayBuffer that also holds the previews
+ */
+class EventBatch {
+  constructor(records, regions) {
+    this.records = records;
+    this.length = records.length / RECORD_WORDS;
+    this._regions = regions;
+  }
+
+  seq(i) {
+    return this.records[i * RECORD_WORDS];
+  }
+
+  region_id(i) {
+    return this.records[i * RECORD_WORDS + 1];
+  }
+
+  timestamp_ns(i) {
+    const r = this.records;
+    return BigInt(r[i * RECORD_WORDS + 2]) | (BigInt(r[i * RECORD_WORDS + 3]) << 32n);
+  }
+
+  /** Buffer over the batch's memory, no copy */
+  old_preview(i) {
+    const r = this.records;
+    return Buffer.from(r.buffer, r[i * RECORD_WORDS + 4], r[i * RECORD_WORDS + 5]);
+  }
+
+  new_preview(i) {
+    const r = this.records;
+    return Buffer.from(r.buffer, r[i * RECORD_WORDS + 6], r[i * RECORD_WORDS + 7]);
+  }
+
+  event(i) {
+    const region = this._regions && this._regions.get(this.region_id(i));
+    return new ChangeEvent({
+      seq: this.seq(i),
+      region_id: this.region_id(i),
+      timestamp_ns: this.timestamp_ns(i),
+      variable_name: region ? region.name : undefined,
+      old_preview: this.old_preview(i),
+      new_preview: this.new_preview(i),
+    });
+  }
+
+  *[Symbol.iterator]() {
+    for (let i = 0; i < this.length; i++) {
+      yield this.event(i);
+    }
+  }
+}
+
 class MemWatch {
   constructor() {
     this._callback = null;
@@ -40,14 +98,35 @@ class MemWatch {
       throw new TypeError('Expected Buffer or TypedArray');
     }
 
-    const addr = buffer.buffer.byteOffset + (buffer.byteOffset || 0);
-    const size = buffer.byteLength;
-
-    const region_id = native.watch_with_max_value_bytes(BigInt(addr), size, name || null, max_value_bytes);
+    // The native side takes the view itself and resolves its address
+    const region_id = native.watch(buffer, buffer.byteLength, name || null);
     this._regions.set(region_id, { buffer, name, max_value_bytes });
     return region_id;
   }
 
+  /**
+   * Watch many buffers with one native call (one lock, coalesced page protection)
+   * @param {Array<Buffer|TypedArray>} buffers - Buffers to watch
+   * @param {Array<string>} names - Variable names, by index (optional)
+   * @returns {Array<number>} region_ids in input order, 0 where a buffer failed
+   */
+  watch_many(buffers, names = []) {
+    const specs = buffers.map((buffer, i) => {
+      if (!Buffer.isBuffer(buffer) && !ArrayBuffer.isView(buffer)) {
+        throw new TypeError('Expected Buffer or TypedArray');
+      }
+      return { addr: buffer, size: buffer.byteLength, name: names[i] || undefined };
+    });
+
+    const region_ids = native.watch_batch(specs);
+    region_ids.forEach((region_id, i) => {
+      if (region_id) {
+        this._regions.set(region_id, { buffer: buffers[i], name: names[i] || null, max_value_bytes: 256 });
+      }
+    });
+    return region_ids;
+  }
+
   /**
    * Stop watching a region
    * @param {number} region_id - ID from watch()
@@ -62,15 +141,38 @@ class MemWatch {
   }
 
   /**
-   * Set callback for change events
+   * Set callback for change events, called once per event
+   *
+   * Events wait for the JS thread in a bounded queue and arrive in batches.
    * @param {Function|null} fn - Callback function or null
+   * @param {object} options - queue_size (events queued, default 4096),
+   *   max_batch (events per batch, default 1024), policy: 'drop' (default;
+   *   a full queue drops, counted as callback_dropped) or 'block' (the
+   *   native worker waits for room)
    */
-  set_callback(fn) {
+  set_callback(fn, options = {}) {
     this._callback = fn;
     if (fn) {
-      native.set_callback((event) => {
-        fn(new ChangeEvent(event));
-      });
+      native.set_callback((records) => {
+        const batch = new EventBatch(records, this._regions);
+        for (let i = 0; i < batch.length; i++) {
+          fn(batch.event(i));
+        }
+      }, options);
+    } else {
+      native.set_callback(null);
+    }
+  }
+
+  /**
+   * Set callback for whole batches, without an object per event
+   * @param {Function|null} fn - Called with an EventBatch
+   * @param {object} options - As for set_callback()
+   */
+  set_batch_callback(fn, options = {}) {
+    this._callback = null;
+    if (fn) {
+      native.set_callback((records) => fn(new EventBatch(records, this._regions)), options);
     } else {
       native.set_callback(null);
     }
@@ -85,7 +187,8 @@ class MemWatch {
   }
 
   /**
-   * Get statistics
+   * Get statistics, including callback_queue_depth / callback_queue_capacity
+   * and callback_delivered / callback_dropped / callback_blocked
    * @returns {object}
    */
   get_stats() {
@@ -115,6 +218,47 @@ class MemWatch {
   }
 }
 
+/**
+ * FastStorage key-value store with zero-copy reads
+ */
+class FastStorage {
+  /**
+   * @param {string} path - Storage file
+   * @param {number} capacity - Initial capacity in bytes (default 1 MB)
+   */
+  constructor(path, capacity = 1024 * 1024) {
+    this._handle = native.storage_open(path, capacity);
+  }
+
+  /**
+   * @param {string} key
+   * @param {Buffer} value
+   * @returns {boolean}
+   */
+  write(key, value) {
+    return native.storage_write(this._handle, key, Buffer.isBuffer(value) ? value : Buffer.from(value));
+  }
+
+  /**
+   * Buffer pointing straight at the stored bytes, or null if key is missing.
+   * Read-only; it stays valid across later writes and compaction, and the
+   * store holds on to its memory until the Buffer is garbage collected.
+   * @param {string} key
+   * @returns {Buffer|null}
+   */
+  view(key) {
+    return native.storage_get_view(this._handle, key);
+  }
+
+  /**
+   * Close the store (deferred until outstanding views are collected)
+   */
+  close() {
+    native.storage_close(this._handle);
+    this._handle = null;
+  }
+}
+
 /**
  * Factory function (matches all language bindings)
  */
@@ -125,5 +269,7 @@ function create() {
 module.exports = {
   MemWatch,
   ChangeEvent,
+  EventBatch,
+  FastStorage,
   create,
 };
@@ -9,6 +9,7 @@ const native = require('./build/Release/memwatch_native');
 
 interface ChangeEventData {
   seq: number;
+  region_id?: number;
   timestamp_ns: bigint;
   variable_name?: string;
   where?: {
@@ -27,6 +28,7 @@ interface ChangeEventData {
 
 class ChangeEvent {
   seq: number;
+  region_id?: number;
   timestamp_ns: bigint;
   variable_name?: string;
   where?: {
@@ -44,6 +46,7 @@ class ChangeEvent {
 
   constructor(data: ChangeEventData) {
     this.seq = data.seq;
+    this.region_id = data.region_id;
     this.timestamp_ns = data.timestamp_ns;
     this.variable_name = data.variable_name;
     this.where = data.where;
@@ -66,6 +69,12 @@ interface StatsData {
   mprotect_page_count: number;
   worker_thread_id: number;
   worker_cycles: bigint;
+  callback_queue_depth: number;
+  callback_queue_capacity: number;
+  callback_delivered: bigint;
+  callback_dropped: bigint;
+  callback_blocked: bigint;
+  callback_batches: bigint;
 }
 
 class Stats {
@@ -78,6 +87,12 @@ class Stats {
   mprotect_page_count: number;
   worker_thread_id: number;
   worker_cycles: bigint;
+  callback_queue_depth: number;
+  callback_queue_capacity: number;
+  callback_delivered: bigint;
+  callback_dropped: bigint;
+  callback_blocked: bigint;
+  callback_batches: bigint;
 
   constructor(data: StatsData) {
     this.num_tracked_regions = data.num_tracked_regions;
@@ -89,10 +104,91 @@ class Stats {
     this.mprotect_page_count = data.mprotect_page_count;
     this.worker_thread_id = data.worker_thread_id;
     this.worker_cycles = data.worker_cycles;
+    this.callback_queue_depth = data.callback_queue_depth;
+    this.callback_queue_capacity = data.callback_queue_capacity;
+    this.callback_delivered = data.callback_delivered;
+    this.callback_dropped = data.callback_dropped;
+    this.callback_blocked = data.callback_blocked;
+    this.callback_batches = data.callback_batches;
   }
 }
 
+const RECORD_WORDS = 8;
+
+/**
+ * Change events delivered together, read in place: a Uint32Array of
+ * 8-word records (seq, region_id, timestamp_ns low/high, old offset/length,
+ * new offset/length) over an ArrayBuffer that also holds the previews
+ */
+class EventBatch {
+  readonly records: Uint32Array;
+  readonly length: number;
+  private _regions?: Map<number, WatchedRegion>;
+
+  constructor(records: Uint32Array, regions?: Map<number, WatchedRegion>) {
+    this.records = records;
+    this.length = records.length / RECORD_WORDS;
+    this._regions = regions;
+  }
+
+  seq(i: number): number {
+    return this.records[i * RECORD_WORDS];
+  }
+
+  region_id(i: number): number {
+    return this.records[i * RECORD_WORDS + 1];
+  }
+
+  timestamp_ns(i: number): bigint {
+    const r = this.records;
+    return BigInt(r[i * RECORD_WORDS + 2]) | (BigInt(r[i * RECORD_WORDS + 3]) << 32n);
+  }
+
+  /** Buffer over the batch's memory, no copy */
+  old_preview(i: number): Buffer {
+    const r = this.records;
+    return Buffer.from(r.buffer, r[i * RECORD_WORDS + 4], r[i * RECORD_WORDS + 5]);
+  }
+
+  new_preview(i: number): Buffer {
+    const r = this.records;
+    return Buffer.from(r.buffer, r[i * RECORD_WORDS + 6], r[i * RECORD_WORDS + 7]);
+  }
+
+  event(i: number): ChangeEvent {
+    const region = this._regions?.get(this.region_id(i));
+    return new ChangeEvent({
+      seq: this.seq(i),
+      region_id: this.region_id(i),
+      timestamp_ns: this.timestamp_ns(i),
+      variable_name: region?.name,
+      old_preview: this.old_preview(i),
+      new_preview: this.new_preview(i),
+    });
+  }
+
+  *[Symbol.iterator](): IterableIterator<ChangeEvent> {
+    for (let i = 0; i < this.length; i++) {
+      yield this.event(i);
+    }
+  }
+}
+
+/**
+ * Event queue between the native worker and the JS thread
+ * - queue_size: events queued (default 4096)
+ * - max_batch: events per batch (default 1024)
+ * - policy: 'drop' (default; a full queue drops, counted as callback_dropped)
+ *   or 'block' (the native worker waits for room)
+ */
+interface DeliveryOptions {
+  queue_size?: number;
+  max_batch?: number;
+  policy?: 'drop' | 'block';
+}
+
 type ChangeEventCallback = (event: ChangeEvent) => void;
+type EventBatchCallback = (batch: EventBatch) => void;
 
 interface WatchedRegion {
   buffer: Buffer | ArrayBufferView;
@@ -120,23 +216,35 @@ class MemWatch {
       throw new TypeError('Expected Buffer or TypedArray');
     }
 
-    let addr: number;
-    let size: number;
-    
-    if (Buffer.isBuffer(buffer)) {
-      addr = (buffer as any).buffer.byteOffset + buffer.byteOffset;
-      size = buffer.byteLength;
-    } else {
-      const view = buffer as ArrayBufferView;
-      addr = (view as any).buffer.byteOffset + (view.byteOffset || 0);
-      size = view.byteLength;
-    }
-
-    const region_id = native.watch_with_max_value_bytes(BigInt(addr), size, name || null, max_value_bytes) as number;
+    // The native side takes the view itself and resolves its address
+    const region_id = native.watch(buffer, buffer.byteLength, name || null) as number;
     this._regions.set(region_id, { buffer, name, max_value_bytes });
     return region_id;
   }
 
+  /**
+   * Watch many buffers with one native call (one lock, coalesced page protection)
+   * @param buffers - Buffers or TypedArrays to watch
+   * @param names - Variable names, by index (optional)
+   * @returns region_ids in input order, 0 where a buffer failed
+   */
+  watch_many(buffers: Array<Buffer | ArrayBufferView>, names: string[] = []): number[] {
+    const specs = buffers.map((buffer, i) => {
+      if (!Buffer.isBuffer(buffer) && !ArrayBuffer.isView(buffer)) {
+        throw new TypeError('Expected Buffer or TypedArray');
+      }
+      return { addr: buffer, size: buffer.byteLength, name: names[i] || undefined };
+    });
+
+    const region_ids = native.watch_batch(specs) as number[];
+    region_ids.forEach((region_id, i) => {
+      if (region_id) {
+        this._regions.set(region_id, { buffer: buffers[i], name: names[i], max_value_bytes: 256 });
+      }
+    });
+    return region_ids;
+  }
+
   /**
    * Stop watching a region
    * @param region_id - ID from watch()
@@ -151,15 +259,33 @@ class MemWatch {
   }
 
   /**
-   * Set callback for change events
+   * Set callback for change events, called once per event
    * @param fn - Callback function or null
+   * @param options - Queue size, batch size and full-queue policy
    */
-  set_callback(fn: ChangeEventCallback | null): void {
+  set_callback(fn: ChangeEventCallback | null, options: DeliveryOptions = {}): void {
     this._callback = fn;
     if (fn) {
-      native.set_callback((event: ChangeEventData) => {
-        fn(new ChangeEvent(event));
-      });
+      native.set_callback((records: Uint32Array) => {
+        const batch = new EventBatch(records, this._regions);
+        for (let i = 0; i < batch.length; i++) {
+          fn(batch.event(i));
+        }
+      }, options);
+    } else {
+      native.set_callback(null);
+    }
+  }
+
+  /**
+   * Set callback for whole batches, without an object per event
+   * @param fn - Called with an EventBatch, or null
+   * @param options - As for set_callback()
+   */
+  set_batch_callback(fn: EventBatchCallback | null, options: DeliveryOptions = {}): void {
+    this._callback = null;
+    if (fn) {
+      native.set_callback((records: Uint32Array) => fn(new EventBatch(records, this._regions)), options);
     } else {
       native.set_callback(null);
     }
@@ -208,5 +334,42 @@ class MemWatch {
   }
 }
 
-export { MemWatch, ChangeEvent, Stats, ChangeEventCallback, ChangeEventData, StatsData };
+/**
+ * FastStorage key-value store with zero-copy reads
+ */
+class FastStorage {
+  private _handle: unknown;
+
+  /**
+   * @param path - Storage file
+   * @param capacity - Initial capacity in bytes (default 1 MB)
+   */
+  constructor(path: string, capacity: number = 1024 * 1024) {
+    this._handle = native.storage_open(path, capacity);
+  }
+
+  write(key: string, value: Buffer | Uint8Array): boolean {
+    return native.storage_write(this._handle, key, Buffer.isBuffer(value) ? value : Buffer.from(value));
+  }
+
+  /**
+   * Buffer pointing straight at the stored bytes, or null if key is missing.
+   * Read-only; it stays valid across later writes and compaction, and the
+   * store holds on to its memory until the Buffer is garbage collected.
+   */
+  view(key: string): Buffer | null {
+    return native.storage_get_view(this._handle, key) as Buffer | null;
+  }
+
+  /**
+   * Close the store (deferred until outstanding views are collected)
+   */
+  close(): void {
+    native.storage_close(this._handle);
+    this._handle = null;
+  }
+}
+
+export { MemWatch, ChangeEvent, EventBatch, Stats, FastStorage, ChangeEventCallback, EventBatchCallback,
+         ChangeEventData, DeliveryOptions, StatsData };
 export default MemWatch;
@@ -2,11 +2,20 @@
  * bindings/memwatch_node.cc - Node.js native binding using N-API
  * 
  * Provides a unified API for JavaScript/TypeScript
+ *
+ * Change events reach JavaScript through a napi_threadsafe_function: the
+ * core's worker thread copies each event into a bounded queue, and the JS
+ * thread takes them out in batches, one Uint32Array per batch. A full queue
+ * drops events (or, with policy 'block', holds the worker); get_stats()
+ * reports the depth and the drops.
  */
 
 #include <node_api.h>
 #include <memwatch_unified.h>
+#include <faststorage_fast.h>
+#include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 
 /* Helper to throw error from native code */
 static napi_value throw_error(napi_env env, const char *msg) {
@@ -14,83 +23,210 @@ static napi_value throw_error(napi_env env, const char *msg) {
     return NULL;
 }
 
-/* Global state */
-static napi_ref global_callback_ref = NULL;
-static napi_env global_callback_env = NULL;
+/* ============================================================================
+ * Event delivery: worker thread -> bounded queue -> JS thread, in batches
+ * ============================================================================ */
 
-/* Change event callback that invokes JavaScript callback */
+#define DELIVERY_QUEUE_SIZE 4096          /* events held for JS by default */
+#define DELIVERY_MAX_BATCH 1024           /* events per JS call by default */
+#define DELIVERY_PREVIEW_BYTES 64         /* of each preview, per event */
+#define DELIVERY_RECORD_WORDS 8
+
+/*
+ * A batch is one ArrayBuffer, passed as a Uint32Array over its records:
+ *   record i, 8 words: seq, region_id, timestamp_ns low, timestamp_ns high,
+ *                      old_offset, old_len, new_offset, new_len
+ * then the preview bytes; offsets are into the ArrayBuffer.
+ */
+typedef struct {
+    uint32_t seq;
+    uint32_t region_id;
+    uint64_t timestamp_ns;
+    uint16_t old_len;
+    uint16_t new_len;
+    uint8_t old_preview[DELIVERY_PREVIEW_BYTES];
+    uint8_t new_preview[DELIVERY_PREVIEW_BYTES];
+} QueuedEvent;
+
+/* One per set_callback(); freed on the JS thread once the tsfn is finalized */
+typedef struct {
+    napi_threadsafe_function tsfn;
+    pthread_mutex_t mutex;
+    pthread_cond_t not_full;
+    QueuedEvent *slots;
+    uint32_t capacity;
+    uint32_t head, count;
+    uint32_t max_batch;
+    bool block;                           /* wait for room instead of dropping */
+    bool scheduled;                       /* a JS call is pending */
+    bool closing;                         /* producers stop waiting */
+} Delivery;
+
+static Delivery *g_delivery = NULL;       /* JS thread only */
+
+/* Totals over every callback, for get_stats() */
+static struct {
+    uint64_t delivered;
+    uint64_t dropped;
+    uint64_t blocked;
+    uint64_t batches;
+} g_delivery_stats = {};
+
+/* Worker thread: queue the event and make sure a JS call is pending */
 static void node_event_callback(const memwatch_change_event_t *event, void *user_ctx) {
-    if (!global_callback_ref || !global_callback_env) return;
-    
-    napi_env env = global_callback_env;
-    napi_status status;
-    
-    /* Get callback function */
-    napi_value callback;
-    status = napi_get_reference_value(env, global_callback_ref, &callback);
-    if (status != napi_ok) return;
-    
-    /* Build event object */
-    napi_value event_obj;
-    napi_create_object(env, &event_obj);
-    
-    /* seq */
-    napi_value seq;
-    napi_create_uint32(env, event->seq, &seq);
-    napi_set_named_property(env, event_obj, "seq", seq);
-    
-    /* timestamp_ns */
-    napi_value ts;
-    napi_create_bigint_uint64(env, event->timestamp_ns, &ts);
-    napi_set_named_property(env, event_obj, "timestamp_ns", ts);
-    
-    /* variable_name */
-    if (event->variable_name) {
-        napi_value name;
-        napi_create_string_utf8(env, event->variable_name, NAPI_AUTO_LENGTH, &name);
-        napi_set_named_property(env, event_obj, "variable_name", name);
+    Delivery *d = (Delivery *)user_ctx;
+    
+    pthread_mutex_lock(&d->mutex);
+    while (d->count == d->capacity) {
+        if (!d->block || d->closing) {
+            __atomic_fetch_add(&g_delivery_stats.dropped, 1, __ATOMIC_RELAXED);
+            pthread_mutex_unlock(&d->mutex);
+            return;
+        }
+        __atomic_fetch_add(&g_delivery_stats.blocked, 1, __ATOMIC_RELAXED);
+        pthread_cond_wait(&d->not_full, &d->mutex);
     }
     
-    /* location info */
-    napi_value where;
-    napi_create_object(env, &where);
-    
-    if (event->file) {
-        napi_value file;
-        napi_create_string_utf8(env, event->file, NAPI_AUTO_LENGTH, &file);
-        napi_set_named_property(env, where, "file", file);
+    QueuedEvent *q = &d->slots[(d->head + d->count) % d->capacity];
+    q->seq = event->seq;
+    q->region_id = event->region_id;
+    q->timestamp_ns = event->timestamp_ns;
+    q->old_len = event->old_preview ? (uint16_t)(event->old_preview_size < DELIVERY_PREVIEW_BYTES ?
+                                                 event->old_preview_size : DELIVERY_PREVIEW_BYTES) : 0;
+    q->new_len = event->new_preview ? (uint16_t)(event->new_preview_size < DELIVERY_PREVIEW_BYTES ?
+                                                 event->new_preview_size : DELIVERY_PREVIEW_BYTES) : 0;
+    memcpy(q->old_preview, event->old_preview, q->old_len);
+    memcpy(q->new_preview, event->new_preview, q->new_len);
+    d->count++;
+    
+    bool call = !d->scheduled;
+    d->scheduled = true;
+    pthread_mutex_unlock(&d->mutex);
+    
+    if (call) {
+        napi_call_threadsafe_function(d->tsfn, NULL, napi_tsfn_nonblocking);
+    }
+}
+
+/* JS thread: hand up to max_batch queued events to the callback as one batch */
+static void delivery_call_js(napi_env env, napi_value js_callback, void *context, void *data) {
+    (void)data;
+    Delivery *d = (Delivery *)context;
+    if (!env) return;  /* tearing down */
+    
+    /* Only this thread removes, so the first n slots stay put while unlocked */
+    pthread_mutex_lock(&d->mutex);
+    uint32_t n = d->count < d->max_batch ? d->count : d->max_batch;
+    uint32_t first = d->head;
+    pthread_mutex_unlock(&d->mutex);
+    
+    size_t bytes = (size_t)n * DELIVERY_RECORD_WORDS * sizeof(uint32_t);
+    for (uint32_t i = 0; i < n; i++) {
+        const QueuedEvent *q = &d->slots[(first + i) % d->capacity];
+        bytes += q->old_len + q->new_len;
     }
     
-    if (event->function) {
-        napi_value func;
-        napi_create_string_utf8(env, event->function, NAPI_AUTO_LENGTH, &func);
-        napi_set_named_property(env, where, "function", func);
+    napi_value buffer = NULL, records = NULL;
+    void *base = NULL;
+    if (n > 0 && napi_create_arraybuffer(env, bytes, &base, &buffer) == napi_ok) {
+        uint32_t *rec = (uint32_t *)base;
+        uint32_t offset = n * DELIVERY_RECORD_WORDS * sizeof(uint32_t);
+        for (uint32_t i = 0; i < n; i++, rec += DELIVERY_RECORD_WORDS) {
+            const QueuedEvent *q = &d->slots[(first + i) % d->capacity];
+            rec[0] = q->seq;
+            rec[1] = q->region_id;
+            rec[2] = (uint32_t)q->timestamp_ns;
+            rec[3] = (uint32_t)(q->timestamp_ns >> 32);
+            rec[4] = offset;
+            rec[5] = q->old_len;
+            memcpy((uint8_t *)base + offset, q->old_preview, q->old_len);
+            offset += q->old_len;
+            rec[6] = offset;
+            rec[7] = q->new_len;
+            memcpy((uint8_t *)base + offset, q->new_preview, q->new_len);
+            offset += q->new_len;
+        }
+        napi_create_typedarray(env, napi_uint32_array, (size_t)n * DELIVERY_RECORD_WORDS, buffer, 0, &records);
     }
     
-    napi_value line;
-    napi_create_uint32(env, event->line, &line);
-    napi_set_named_property(env, where, "line", line);
+    /* Free the slots, then schedule the rest before running JS */
+    pthread_mutex_lock(&d->mutex);
+    d->head = (d->head + n) % d->capacity;
+    d->count -= n;
+    bool again = d->count > 0;
+    d->scheduled = again;
+    pthread_cond_broadcast(&d->not_full);
+    pthread_mutex_unlock(&d->mutex);
+    if (again) {
+        napi_call_threadsafe_function(d->tsfn, NULL, napi_tsfn_nonblocking);
+    }
     
-    napi_set_named_property(env, event_obj, "where", where);
+    if (!records || !js_callback) return;
+    __atomic_fetch_add(&g_delivery_stats.delivered, n, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&g_delivery_stats.batches, 1, __ATOMIC_RELAXED);
     
-    /* old_preview */
-    if (event->old_preview && event->old_preview_size > 0) {
-        napi_value old_buf;
-        void *data;
-        napi_create_buffer_copy(env, event->old_preview_size, (void*)event->old_preview, &data, &old_buf);
-        napi_set_named_property(env, event_obj, "old_preview", old_buf);
+    napi_value undefined;
+    napi_get_undefined(env, &undefined);
+    if (napi_call_function(env, undefined, js_callback, 1, &records, NULL) == napi_pending_exception) {
+        napi_value error;
+        napi_get_and_clear_last_exception(env, &error);
+        napi_fatal_exception(env, error);  /* process 'uncaughtException' */
     }
-    
-    /* new_preview */
-    if (event->new_preview && event->new_preview_size > 0) {
-        napi_value new_buf;
-        void *data;
-        napi_create_buffer_copy(env, event->new_preview_size, (void*)event->new_preview, &data, &new_buf);
-        napi_set_named_property(env, event_obj, "new_preview", new_buf);
+}
+
+static void delivery_finalize(napi_env env, void *data, void *hint) {
+    (void)env;
+    (void)hint;
+    Delivery *d = (Delivery *)data;
+    pthread_mutex_destroy(&d->mutex);
+    pthread_cond_destroy(&d->not_full);
+    free(d->slots);
+    free(d);
+}
+
+/* Detach the current delivery; queued events are discarded */
+static void delivery_stop(void) {
+    Delivery *d = g_delivery;
+    if (!d) return;
+    
+    /* A producer blocked on a full queue holds the core's callback lock */
+    pthread_mutex_lock(&d->mutex);
+    d->closing = true;
+    pthread_cond_broadcast(&d->not_full);
+    pthread_mutex_unlock(&d->mutex);
+    memwatch_set_callback(NULL, NULL);
+    
+    g_delivery = NULL;
+    napi_release_threadsafe_function(d->tsfn, napi_tsfn_abort);
+}
+
+static uint32_t get_option_uint32(napi_env env, napi_value options, const char *name, uint32_t fallback) {
+    bool has = false;
+    napi_value val;
+    uint32_t result = fallback;
+    if (napi_has_named_property(env, options, name, &has) == napi_ok && has &&
+        napi_get_named_property(env, options, name, &val) == napi_ok) {
+        napi_get_value_uint32(env, val, &result);
     }
-    
-    /* Invoke callback */
-    napi_call_function(env, NULL, callback, 1, &event_obj, NULL);
+    return result;
+}
+
+/* A BigInt address, or where a Buffer / TypedArray / DataView starts */
+static uint64_t get_address(napi_env env, napi_value value) {
+    bool is_view = false;
+    void *data = NULL;
+    if (napi_is_typedarray(env, value, &is_view) == napi_ok && is_view) {
+        napi_get_typedarray_info(env, value, NULL, NULL, &data, NULL, NULL);
+        return (uint64_t)(uintptr_t)data;
+    }
+    if (napi_is_dataview(env, value, &is_view) == napi_ok && is_view) {
+        napi_get_dataview_info(env, value, NULL, &data, NULL, NULL);
+        return (uint64_t)(uintptr_t)data;
+    }
+    uint64_t addr = 0;
+    bool lossless;
+    napi_get_value_bigint_uint64(env, value, &addr, &lossless);
+    return addr;
 }
 
 /* init() */
@@ -104,6 +240,7 @@ static napi_value init(napi_env env, napi_callback_info info) {
 
 /* shutdown() */
 static napi_value shutdown(napi_env env, napi_callback_info info) {
+    delivery_stop();
     memwatch_shutdown();
     
     napi_value ret;
@@ -111,22 +248,23 @@ static napi_value shutdown(napi_env env, napi_callback_info info) {
     return ret;
 }
 
-/* watch(addr, size, name, user_data?) */
+/* watch(addr | buffer, size, name, user_data?) */
 static napi_value watch(napi_env env, napi_callback_info info) {
     size_t argc = 4;
     napi_value argv[4];
     napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
     
     /* Get arguments */
-    uint64_t addr;
-    napi_get_value_bigint_uint64(env, argv[0], &addr, NULL);
+    uint64_t addr = get_address(env, argv[0]);
     
     uint32_t size;
     napi_get_value_uint32(env, argv[1], &size);
     
-    size_t name_len = 256;
+    size_t name_len = 0;
     char name[256] = {0};
-    if (argc > 2 && !napi_is_null(env, argv[2])) {
+    napi_valuetype name_type = napi_undefined;
+    if (argc > 2) napi_typeof(env, argv[2], &name_type);
+    if (name_type == napi_string) {
         napi_get_value_string_utf8(env, argv[2], name, sizeof(name), &name_len);
     }
     
@@ -135,13 +273,84 @@ static napi_value watch(napi_env env, napi_callback_info info) {
         napi_get_value_external(env, argv[3], &user_data);
     }
     
-    uint32_t region_id = memwatch_watch(addr, size, name_len > 0 ? name : NULL, user_data);
+    /* The core keeps the name pointer for the region's lifetime */
+    char *kept = name_len > 0 ? strdup(name) : NULL;
+    uint32_t region_id = memwatch_watch(addr, size, kept, user_data);
+    if (region_id == 0) {
+        free(kept);
+    }
     
     napi_value ret;
     napi_create_uint32(env, region_id, &ret);
     return ret;
 }
 
+/* watch_batch([{addr | buffer, size, name}, ...]) -> [region_id, ...] */
+static napi_value watch_batch(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value argv[1];
+    napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    
+    uint32_t count = 0;
+    if (argc < 1 || napi_get_array_length(env, argv[0], &count) != napi_ok) {
+        return throw_error(env, "watch_batch expects an array");
+    }
+    
+    memwatch_watch_spec_t *specs = (memwatch_watch_spec_t *)calloc(count ? count : 1, sizeof(*specs));
+    memwatch_region_id *ids = (memwatch_region_id *)calloc(count ? count : 1, sizeof(*ids));
+    if (!specs || !ids) {
+        free(specs);
+        free(ids);
+        return throw_error(env, "Out of memory");
+    }
+    
+    for (uint32_t i = 0; i < count; i++) {
+        napi_value item, val;
+        napi_get_element(env, argv[0], i, &item);
+        
+        napi_get_named_property(env, item, "addr", &val);
+        specs[i].addr = get_address(env, val);
+        
+        uint32_t size = 0;
+        napi_get_named_property(env, item, "size", &val);
+        napi_get_value_uint32(env, val, &size);
+        specs[i].size = size;
+        
+        /* The core keeps the name pointer for the region's lifetime */
+        bool has_name = false;
+        napi_has_named_property(env, item, "name", &has_name);
+        if (has_name) {
+            char name[256] = {0};
+            size_t name_len = 0;
+            napi_get_named_property(env, item, "name", &val);
+            if (napi_get_value_string_utf8(env, val, name, sizeof(name), &name_len) == napi_ok &&
+                name_len > 0) {
+                specs[i].name = strdup(name);
+            }
+        }
+    }
+    
+    int watched = memwatch_watch_batch(specs, count, ids);
+    
+    napi_value ret;
+    napi_create_array_with_length(env, count, &ret);
+    for (uint32_t i = 0; i < count; i++) {
+        if (watched < 0 || ids[i] == 0) {
+            free((void *)specs[i].name);
+        }
+        napi_value id;
+        napi_create_uint32(env, watched < 0 ? 0 : ids[i], &id);
+        napi_set_element(env, ret, i, id);
+    }
+    
+    free(specs);
+    free(ids);
+    if (watched < 0) {
+        return throw_error(env, "watch_batch failed");
+    }
+    return ret;
+}
+
 /* unwatch(region_id) */
 static napi_value unwatch(napi_env env, napi_callback_info info) {
     size_t argc = 1;
@@ -158,24 +367,63 @@ static napi_value unwatch(napi_env env, napi_callback_info info) {
     return ret;
 }
 
-/* set_callback(fn) */
+/* set_callback(fn, {queue_size, max_batch, policy: 'drop'|'block'}?) */
 static napi_value set_callback(napi_env env, napi_callback_info info) {
-    size_t argc = 1;
-    napi_value argv[1];
+    size_t argc = 2;
+    napi_value argv[2];
     napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
     
-    /* Store callback reference */
-    if (global_callback_ref) {
-        napi_delete_reference(env, global_callback_ref);
-    }
+    delivery_stop();
     
-    if (!napi_is_null(env, argv[0])) {
-        napi_create_reference(env, argv[0], 1, &global_callback_ref);
-        global_callback_env = env;
-        memwatch_set_callback(node_event_callback, NULL);
-    } else {
-        memwatch_set_callback(NULL, NULL);
-        global_callback_ref = NULL;
+    napi_valuetype type = napi_undefined;
+    if (argc > 0) napi_typeof(env, argv[0], &type);
+    if (type == napi_function) {
+        Delivery *d = (Delivery *)calloc(1, sizeof(Delivery));
+        if (!d) return throw_error(env, "Out of memory");
+        d->capacity = DELIVERY_QUEUE_SIZE;
+        d->max_batch = DELIVERY_MAX_BATCH;
+        
+        napi_valuetype options_type = napi_undefined;
+        if (argc > 1) napi_typeof(env, argv[1], &options_type);
+        if (options_type == napi_object) {
+            d->capacity = get_option_uint32(env, argv[1], "queue_size", d->capacity);
+            d->max_batch = get_option_uint32(env, argv[1], "max_batch", d->max_batch);
+            
+            bool has = false;
+            char policy[16] = {0};
+            napi_value val;
+            if (napi_has_named_property(env, argv[1], "policy", &has) == napi_ok && has) {
+                napi_get_named_property(env, argv[1], "policy", &val);
+                napi_get_value_string_utf8(env, val, policy, sizeof(policy), NULL);
+                if (strcmp(policy, "block") == 0) {
+                    d->block = true;
+                } else if (strcmp(policy, "drop") != 0) {
+                    free(d);
+                    return throw_error(env, "policy must be 'drop' or 'block'");
+                }
+            }
+        }
+        if (d->capacity == 0 || d->max_batch == 0) {
+            free(d);
+            return throw_error(env, "queue_size and max_batch must be positive");
+        }
+        
+        d->slots = (QueuedEvent *)malloc((size_t)d->capacity * sizeof(QueuedEvent));
+        napi_value name;
+        napi_create_string_utf8(env, "memwatch_events", NAPI_AUTO_LENGTH, &name);
+        if (!d->slots ||
+            napi_create_threadsafe_function(env, argv[0], NULL, name, 0, 1, d, delivery_finalize,
+                                            d, delivery_call_js, &d->tsfn) != napi_ok) {
+            free(d->slots);
+            free(d);
+            return throw_error(env, "Cannot create event delivery");
+        }
+        pthread_mutex_init(&d->mutex, NULL);
+        pthread_cond_init(&d->not_full, NULL);
+        napi_unref_threadsafe_function(env, d->tsfn);  /* a callback alone keeps no process alive */
+        
+        g_delivery = d;
+        memwatch_set_callback(node_event_callback, d);
     }
     
     napi_value ret;
@@ -211,7 +459,7 @@ static napi_value check_changes(napi_env env, napi_callback_info info) {
 
 /* get_stats() */
 static napi_value get_stats(napi_env env, napi_callback_info info) {
-    memwatch_stats_t stats = {0};
+    memwatch_stats_t stats = {};
     memwatch_get_stats(&stats);
     
     napi_value stats_obj;
@@ -228,22 +476,204 @@ static napi_value get_stats(napi_env env, napi_callback_info info) {
     napi_create_bigint_uint64(env, stats.total_events, &val);
     napi_set_named_property(env, stats_obj, "total_events", val);
     
+    napi_create_bigint_uint64(env, stats.ring_drop_count, &val);
+    napi_set_named_property(env, stats_obj, "ring_drop_count", val);
+    
+    /* Callback queue: depth now, totals since load */
+    uint32_t depth = 0, capacity = 0;
+    if (g_delivery) {
+        pthread_mutex_lock(&g_delivery->mutex);
+        depth = g_delivery->count;
+        capacity = g_delivery->capacity;
+        pthread_mutex_unlock(&g_delivery->mutex);
+    }
+    napi_create_uint32(env, depth, &val);
+    napi_set_named_property(env, stats_obj, "callback_queue_depth", val);
+    
+    napi_create_uint32(env, capacity, &val);
+    napi_set_named_property(env, stats_obj, "callback_queue_capacity", val);
+    
+    napi_create_bigint_uint64(env, __atomic_load_n(&g_delivery_stats.delivered, __ATOMIC_RELAXED), &val);
+    napi_set_named_property(env, stats_obj, "callback_delivered", val);
+    
+    napi_create_bigint_uint64(env, __atomic_load_n(&g_delivery_stats.dropped, __ATOMIC_RELAXED), &val);
+    napi_set_named_property(env, stats_obj, "callback_dropped", val);
+    
+    napi_create_bigint_uint64(env, __atomic_load_n(&g_delivery_stats.blocked, __ATOMIC_RELAXED), &val);
+    napi_set_named_property(env, stats_obj, "callback_blocked", val);
+    
+    napi_create_bigint_uint64(env, __atomic_load_n(&g_delivery_stats.batches, __ATOMIC_RELAXED), &val);
+    napi_set_named_property(env, stats_obj, "callback_batches", val);
+    
     return stats_obj;
 }
 
+/* ============================================================================
+ * FastStorage: zero-copy views as external Buffers
+ * ============================================================================ */
+
+/* A store and the Buffers still viewing it; closed once both are done */
+typedef struct {
+    FastStorage *fs;
+    uint32_t views;
+    int closed;
+} StorageHandle;
+
+typedef struct {
+    StorageHandle *handle;
+    FastStorageView view;
+} StorageViewRef;
+
+static void storage_handle_unref(StorageHandle *handle) {
+    if (handle->closed && handle->views == 0) {
+        faststorage_destroy(handle->fs);
+        free(handle);
+    }
+}
+
+static StorageHandle *get_storage(napi_env env, napi_value value) {
+    void *data = NULL;
+    if (napi_get_value_external(env, value, &data) != napi_ok || !data ||
+        ((StorageHandle *)data)->closed) {
+        return NULL;
+    }
+    return (StorageHandle *)data;
+}
+
+/* Runs when the Buffer is garbage collected */
+static void storage_view_finalize(napi_env env, void *data, void *hint) {
+    StorageViewRef *ref = (StorageViewRef *)hint;
+    faststorage_release_view(ref->handle->fs, &ref->view);
+    ref->handle->views--;
+    storage_handle_unref(ref->handle);
+    free(ref);
+}
+
+/* storage_open(path, capacity) -> handle */
+static napi_value storage_open(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value argv[2];
+    napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    
+    char path[4096];
+    size_t path_len = 0;
+    if (argc < 1 || napi_get_value_string_utf8(env, argv[0], path, sizeof(path), &path_len) != napi_ok) {
+        return throw_error(env, "storage_open expects a path");
+    }
+    
+    int64_t capacity = 1024 * 1024;
+    if (argc > 1) {
+        napi_get_value_int64(env, argv[1], &capacity);
+    }
+    
+    StorageHandle *handle = (StorageHandle *)calloc(1, sizeof(StorageHandle));
+    if (!handle) {
+        return throw_error(env, "out of memory");
+    }
+    handle->fs = faststorage_create(path, (size_t)capacity);
+    if (!handle->fs) {
+        free(handle);
+        return throw_error(env, "cannot open storage");
+    }
+    
+    napi_value ret;
+    napi_create_external(env, handle, NULL, NULL, &ret);
+    return ret;
+}
+
+/* storage_close(handle) - the store stays open until its views are collected */
+static napi_value storage_close(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value argv[1];
+    napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    
+    StorageHandle *handle = argc > 0 ? get_storage(env, argv[0]) : NULL;
+    if (handle) {
+        handle->closed = 1;
+        storage_handle_unref(handle);
+    }
+    
+    napi_value ret;
+    napi_get_undefined(env, &ret);
+    return ret;
+}
+
+/* storage_write(handle, key, buffer) -> bool */
+static napi_value storage_write(napi_env env, napi_callback_info info) {
+    size_t argc = 3;
+    napi_value argv[3];
+    napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    
+    StorageHandle *handle = argc > 2 ? get_storage(env, argv[0]) : NULL;
+    char key[256];
+    size_t key_len = 0;
+    void *data = NULL;
+    size_t len = 0;
+    if (!handle ||
+        napi_get_value_string_utf8(env, argv[1], key, sizeof(key), &key_len) != napi_ok ||
+        napi_get_buffer_info(env, argv[2], &data, &len) != napi_ok) {
+        return throw_error(env, "storage_write expects (handle, key, buffer)");
+    }
+    
+    napi_value ret;
+    napi_get_boolean(env, faststorage_write(handle->fs, key, data ? data : "", len) == 0, &ret);
+    return ret;
+}
+
+/* storage_get_view(handle, key) -> Buffer over the stored bytes, or null */
+static napi_value storage_get_view(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value argv[2];
+    napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    
+    StorageHandle *handle = argc > 1 ? get_storage(env, argv[0]) : NULL;
+    char key[256];
+    size_t key_len = 0;
+    if (!handle || napi_get_value_string_utf8(env, argv[1], key, sizeof(key), &key_len) != napi_ok) {
+        return throw_error(env, "storage_get_view expects (handle, key)");
+    }
+    
+    StorageViewRef *ref = (StorageViewRef *)calloc(1, sizeof(StorageViewRef));
+    if (!ref) {
+        return throw_error(env, "out of memory");
+    }
+    
+    napi_value ret;
+    if (faststorage_get_view(handle->fs, key, &ref->view) < 0) {
+        free(ref);
+        napi_get_null(env, &ret);
+        return ret;
+    }
+    ref->handle = handle;
+    handle->views++;
+    
+    /* The bytes are read-only: JavaScript must not write through the Buffer */
+    if (napi_create_external_buffer(env, ref->view.len, (void *)ref->view.ptr,
+                                    storage_view_finalize, ref, &ret) != napi_ok) {
+        storage_view_finalize(env, NULL, ref);
+        return throw_error(env, "cannot create view buffer");
+    }
+    return ret;
+}
+
 /* Module init */
 static napi_value init_module(napi_env env, napi_value exports) {
     napi_property_descriptor descriptors[] = {
         {"init", NULL, init, NULL, NULL, NULL, napi_default, NULL},
         {"shutdown", NULL, shutdown, NULL, NULL, NULL, napi_default, NULL},
         {"watch", NULL, watch, NULL, NULL, NULL, napi_default, NULL},
+        {"watch_batch", NULL, watch_batch, NULL, NULL, NULL, napi_default, NULL},
         {"unwatch", NULL, unwatch, NULL, NULL, NULL, napi_default, NULL},
         {"set_callback", NULL, set_callback, NULL, NULL, NULL, napi_default, NULL},
         {"check_changes", NULL, check_changes, NULL, NULL, NULL, napi_default, NULL},
         {"get_stats", NULL, get_stats, NULL, NULL, NULL, napi_default, NULL},
+        {"storage_open", NULL, storage_open, NULL, NULL, NULL, napi_default, NULL},
+        {"storage_close", NULL, storage_close, NULL, NULL, NULL, napi_default, NULL},
+        {"storage_write", NULL, storage_write, NULL, NULL, NULL, napi_default, NULL},
+        {"storage_get_view", NULL, storage_get_view, NULL, NULL, NULL, napi_default, NULL},
     };
     
-    napi_define_properties(env, exports, 7, descriptors);
+    napi_define_properties(env, exports, sizeof(descriptors) / sizeof(descriptors[0]), descriptors);
     return exports;
 }
 
@@ -0,0 +1,153 @@
+"""
+MemWatch event ring consumer - read events published by `memwatch run --shm-ring <name>`
+
+The producer keeps a ring of 64-byte packed events (event_packed_t in
+include/memwatch_event_ring.h) in /dev/shm/memwatch-<name> and hands out an
+eventfd doorbell over the abstract unix socket "@memwatch-ring-<name>".
+Events are read straight from the mapping, without any serialization.
+
+    with EventRing("alerts") as ring:
+        for event in ring:
+            print(event.variable, event.old_value, "->", event.new_value)
+
+Plain loads and stores stand in for the C side's acquire/release atomics,
+which is sound on x86-64 (total store order) but not on weaker CPUs.
+Python has no store/load fence either, so a doorbell can in rare cases be
+missed; each sleep is capped at SLEEP_CAP_MS and the ring rechecked.
+"""
+
+import mmap
+import os
+import select
+import socket
+import struct
+import time
+from collections import namedtuple
+
+RING_MAGIC = 0x31474e4952574d           # "MWRING1"
+RING_VERSION = 1
+HEADER_SIZE = 256
+SLOT_SIZE = 64
+SLEEP_CAP_MS = 10
+
+# mw_ring_header_t offsets
+_OFF_MAGIC, _OFF_VERSION, _OFF_SLOT, _OFF_CAPACITY = 0, 8, 12, 16
+_OFF_PID, _OFF_CLOSED, _OFF_DROPPED = 24, 28, 32
+_OFF_HEAD, _OFF_TAIL, _OFF_WAITING = 64, 128, 192
+
+# event_packed_t
+_EVENT = struct.Struct('<IHIHBBiiH40s')
+
+Event = namedtuple('Event', 'timestamp thread_id var_id operation scope old_value new_value variable')
+
+
+class EventRing:
+    """Single consumer of a producer's shared-memory event ring"""
+
+    def __init__(self, name: str):
+        fd = os.open(f"/dev/shm/memwatch-{name}", os.O_RDWR)
+        try:
+            self._map = mmap.mmap(fd, 0)
+        finally:
+            os.close(fd)
+
+        magic, version, slot_size, capacity = struct.unpack_from('<QIIQ', self._map, 0)
+        if magic != RING_MAGIC or version != RING_VERSION or slot_size != SLOT_SIZE or \
+                capacity & (capacity - 1) or HEADER_SIZE + capacity * SLOT_SIZE > len(self._map):
+            self._map.close()
+            raise ValueError(f"memwatch-{name} is not a memwatch event ring")
+        self.capacity = capacity
+        self.producer_pid = struct.unpack_from('<I', self._map, _OFF_PID)[0]
+
+        sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        try:
+            sock.connect(f"\0memwatch-ring-{name}")
+            _, fds, _, _ = socket.recv_fds(sock, 1, 1)
+        finally:
+            sock.close()
+        if not fds:
+            self._map.close()
+            raise ConnectionError("producer did not send its doorbell")
+        self._doorbell = fds[0]
+        self._poll = select.poll()
+        self._poll.register(self._doorbell, select.POLLIN)
+
+    def _load(self, offset, fmt='<Q'):
+        return struct.unpack_from(fmt, self._map, offset)[0]
+
+    def _store(self, offset, value, fmt='<Q'):
+        struct.pack_into(fmt, self._map, offset, value)
+
+    @property
+    def dropped(self) -> int:
+        """Events the producer lost to a full ring"""
+        return self._load(_OFF_DROPPED)
+
+    @property
+    def closed(self) -> bool:
+        return self._load(_OFF_CLOSED, '<I') != 0
+
+    def read(self, max_events: int = 1024, timeout: float = None):
+        """
+        Take up to max_events, waiting up to timeout seconds (None = forever)
+
+        Returns a list of Event (empty on timeout), or None once the
+        producer has closed the ring and every event was read.
+        """
+        deadline = None if timeout is None else time.monotonic() + timeout
+        while True:
+            tail = self._load(_OFF_TAIL)
+            head = self._load(_OFF_HEAD)
+            if head != tail:
+                n = min(head - tail, max_events)
+                events = []
+                for seq in range(tail, tail + n):
+                    offset = HEADER_SIZE + (seq & (self.capacity - 1)) * SLOT_SIZE
+                    sec, ms, tid, var_id, op, scope, old, new, mlen, meta = _EVENT.unpack_from(self._map, offset)
+                    events.append(Event(sec + ms / 1000.0, tid, var_id, op, scope, old, new,
+                                        meta[:mlen].decode('utf-8', 'replace')))
+                self._store(_OFF_TAIL, tail + n)
+                return events
+            if self.closed:
+                if self._load(_OFF_HEAD) != tail:
+                    continue
+                return None
+            if timeout == 0:
+                return []
+
+            # Announce the sleep, then recheck before blocking on the doorbell
+            self._store(_OFF_WAITING, 1, '<I')
+            if self._load(_OFF_HEAD) != tail or self.closed:
+                self._store(_OFF_WAITING, 0, '<I')
+                continue
+            wait = SLEEP_CAP_MS
+            if deadline is not None:
+                wait = min(wait, max(0.0, deadline - time.monotonic()) * 1000)
+            ready = self._poll.poll(wait)
+            self._store(_OFF_WAITING, 0, '<I')
+            if ready:
+                try:
+                    os.read(self._doorbell, 8)
+                except BlockingIOError:
+                    pass
+            elif deadline is not None and time.monotonic() >= deadline and self._load(_OFF_HEAD) == tail:
+                return []
+
+    def __iter__(self):
+        while True:
+            events = self.read()
+            if events is None:
+                return
+            yield from events
+
+    def close(self):
+        if self._doorbell >= 0:
+            os.close(self._doorbell)
+            self._doorbell = -1
+            self._map.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
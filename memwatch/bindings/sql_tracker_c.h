@@ -26,7 +26,7 @@
  *   }
  * 
  * Compile with:
- *   gcc -o my_program my_program.c src/sql_tracker.c -I include -lm
+ *   gcc -o my_program my_program.c src/sql_tracker.c src/memwatch_hash.c src/memwatch_lz4.c -I include -lm -lpthread
  */
 
 // No additional binding needed - C uses the header directly
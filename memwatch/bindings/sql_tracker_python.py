@@ -11,7 +11,7 @@ import os
 import platform
 from pathlib import Path
 from dataclasses import dataclass
-from typing import List, Dict, Optional
+from typing import List, Dict, Iterator, Optional, Union
 from enum import IntEnum
 
 # Load the native SQL tracker library
@@ -30,6 +30,7 @@ def _load_sql_tracker():
     
     # Try multiple search paths
     search_paths = [
+        Path(__file__).parent.parent / "build" / libname,
         Path(__file__).parent.parent.parent / "build" / libname,
         Path(__file__).parent / libname,
         Path("/usr/local/lib") / libname,
@@ -84,21 +85,103 @@ class SQLChange:
             'full_query': self.full_query
         }
 
+class _SQLChangeView(ctypes.Structure):
+    """Native SQLChange: strings point into the tracker"""
+    _fields_ = [('timestamp_ns', ctypes.c_uint64),
+                ('table_name', ctypes.c_char_p),
+                ('column_name', ctypes.c_char_p),
+                ('operation', ctypes.c_int),
+                ('old_value', ctypes.c_void_p),
+                ('new_value', ctypes.c_void_p),
+                ('rows_affected', ctypes.c_int),
+                ('database', ctypes.c_char_p),
+                ('full_query', ctypes.c_void_p),
+                ('table_id', ctypes.c_uint32),
+                ('column_id', ctypes.c_uint32),
+                ('database_id', ctypes.c_uint32),
+                ('old_value_len', ctypes.c_uint32),
+                ('new_value_len', ctypes.c_uint32),
+                ('query_len', ctypes.c_uint32)]
+
+    def to_change(self) -> SQLChange:
+        def text(ptr, length):
+            return ctypes.string_at(ptr, length).decode(errors='replace') if length else None
+        return SQLChange(
+            timestamp_ns=self.timestamp_ns,
+            table_name=self.table_name.decode(errors='replace'),
+            column_name=self.column_name.decode(errors='replace'),
+            operation=SQLOperation(self.operation),
+            old_value=text(self.old_value, self.old_value_len),
+            new_value=text(self.new_value, self.new_value_len),
+            rows_affected=self.rows_affected,
+            database=self.database.decode(errors='replace') or None,
+            full_query=text(self.full_query, self.query_len) or "",
+        )
+
+class _ChangeQuery(ctypes.Structure):
+    """Native SQLChangeQuery"""
+    _fields_ = [('table', ctypes.c_char_p),
+                ('column', ctypes.c_char_p),
+                ('operation', ctypes.c_int),
+                ('since_ns', ctypes.c_uint64),
+                ('until_ns', ctypes.c_uint64)]
+
+class _Cursor(ctypes.Structure):
+    """Native SQLCursor"""
+    _fields_ = [('tracker', ctypes.c_void_p),
+                ('seqs', ctypes.c_void_p),
+                ('pos', ctypes.c_uint32),
+                ('end', ctypes.c_uint32),
+                ('table_id', ctypes.c_uint32),
+                ('column_id', ctypes.c_uint32),
+                ('operation', ctypes.c_int)]
+
+class _TrackerHead(ctypes.Structure):
+    """Leading fields of the native SQLTracker"""
+    _fields_ = [('changes', ctypes.c_void_p),
+                ('change_count', ctypes.c_int),
+                ('max_changes', ctypes.c_int)]
+
+class _Config(ctypes.Structure):
+    """Native SQLTrackerConfig"""
+    _fields_ = [('storage_path', ctypes.c_char_p),
+                ('max_changes', ctypes.c_int),
+                ('retention', ctypes.c_int),
+                ('cache_entries', ctypes.c_int),
+                ('compress_log', ctypes.c_int)]
+
+class _LogStats(ctypes.Structure):
+    """Native SQLLogStats"""
+    _fields_ = [('records', ctypes.c_uint64),
+                ('dropped', ctypes.c_uint64),
+                ('blocks', ctypes.c_uint64),
+                ('raw_bytes', ctypes.c_uint64),
+                ('written_bytes', ctypes.c_uint64),
+                ('loaded', ctypes.c_uint64),
+                ('error', ctypes.c_int),
+                ('compress_ns', ctypes.c_uint64)]
+
+_MAX_CHANGES = 10000  # sql_tracker_init() capacity
+_COMPRESS_MODES = {'off': 0, 'balanced': 1, 'lite': 2, 'deep': 3}  # mw_compress_mode_t
+
 class SQLTracker:
     """Track SQL column-level changes"""
     
-    def __init__(self, storage_path: Optional[str] = None):
+    def __init__(self, storage_path: Optional[str] = None, compress_log: Union[bool, str] = False):
         """
         Initialize SQL tracker
         
         Args:
-            storage_path: Optional file path to persist changes (JSONL format)
+            storage_path: Optional binary change log; changes already in it
+                are loaded back, new ones appended by a writer thread
+            compress_log: LZ4-compress the change log; or a mode name,
+                'lite' and 'deep' linking each block to the one before
         """
         self._lib = _load_sql_tracker()
         
         # Define C function signatures
-        self._lib.sql_tracker_init.restype = ctypes.c_void_p
-        self._lib.sql_tracker_init.argtypes = [ctypes.c_char_p]
+        self._lib.sql_tracker_init_ex.restype = ctypes.c_void_p
+        self._lib.sql_tracker_init_ex.argtypes = [ctypes.POINTER(_Config)]
         
         self._lib.sql_tracker_track_query.restype = ctypes.c_int
         self._lib.sql_tracker_track_query.argtypes = [
@@ -113,11 +196,68 @@ class SQLTracker:
         self._lib.sql_tracker_free.restype = None
         self._lib.sql_tracker_free.argtypes = [ctypes.c_void_p]
         
+        self._lib.sql_tracker_get_change.restype = ctypes.c_int
+        self._lib.sql_tracker_get_change.argtypes = [ctypes.c_void_p, ctypes.c_int,
+                                                     ctypes.POINTER(_SQLChangeView)]
+        self._lib.sql_tracker_get_changes.restype = ctypes.c_int
+        self._lib.sql_tracker_get_changes.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_char_p,
+                                                      ctypes.c_char_p, ctypes.POINTER(ctypes.c_void_p)]
+        self._lib.sql_tracker_memory_usage.restype = ctypes.c_size_t
+        self._lib.sql_tracker_memory_usage.argtypes = [ctypes.c_void_p]
+        self._lib.sql_tracker_query.argtypes = [ctypes.c_void_p, ctypes.POINTER(_ChangeQuery),
+                                                ctypes.POINTER(_Cursor)]
+        self._lib.sql_cursor_next.argtypes = [ctypes.POINTER(_Cursor), ctypes.POINTER(_SQLChangeView)]
+        self._lib.sql_tracker_cache_stats.restype = None
+        self._lib.sql_tracker_cache_stats.argtypes = [ctypes.c_void_p] + [ctypes.POINTER(ctypes.c_uint64)] * 3
+        self._lib.sql_tracker_flush.argtypes = [ctypes.c_void_p]
+        self._lib.sql_tracker_log_stats.argtypes = [ctypes.c_void_p, ctypes.POINTER(_LogStats)]
+        self._libc = ctypes.CDLL(None)
+        self._libc.free.argtypes = [ctypes.c_void_p]
+        
         # Initialize native tracker
         path_bytes = storage_path.encode() if storage_path else None
-        self._tracker = self._lib.sql_tracker_init(path_bytes)
+        mode = _COMPRESS_MODES[compress_log] if isinstance(compress_log, str) else int(compress_log)
+        config = _Config(path_bytes, _MAX_CHANGES, 0, 0, mode)
+        self._tracker = self._lib.sql_tracker_init_ex(ctypes.byref(config))
+        if not self._tracker:
+            raise RuntimeError(f"Could not open SQL change log {storage_path!r}")
         self._storage_path = storage_path
-        self._changes: List[SQLChange] = []
+    
+    def __len__(self):
+        return _TrackerHead.from_address(self._tracker).change_count
+    
+    def memory_usage(self) -> int:
+        """Bytes held by the native tracker"""
+        return self._lib.sql_tracker_memory_usage(self._tracker)
+    
+    def cache_stats(self) -> Dict:
+        """Statement cache hits, misses and evictions"""
+        counters = [ctypes.c_uint64() for _ in range(3)]
+        self._lib.sql_tracker_cache_stats(self._tracker, *[ctypes.byref(c) for c in counters])
+        return dict(zip(('hits', 'misses', 'evictions'), (c.value for c in counters)))
+    
+    def flush(self):
+        """Wait until every tracked statement is in the change log on disk"""
+        if self._lib.sql_tracker_flush(self._tracker) != 0:
+            raise OSError(f"SQL change log write failed: {self._storage_path}")
+    
+    def log_stats(self) -> Optional[Dict]:
+        """Change log counters, or None without a storage path"""
+        stats = _LogStats()
+        if self._lib.sql_tracker_log_stats(self._tracker, ctypes.byref(stats)) != 0:
+            return None
+        return {name: getattr(stats, name) for name, _ in _LogStats._fields_}
+    
+    @staticmethod
+    def export_jsonl(log_path: str, jsonl_path: str) -> int:
+        """Convert a change log to JSON lines; returns the number written"""
+        lib = _load_sql_tracker()
+        lib.sql_tracker_export_jsonl.restype = ctypes.c_long
+        lib.sql_tracker_export_jsonl.argtypes = [ctypes.c_char_p, ctypes.c_char_p]
+        lines = lib.sql_tracker_export_jsonl(log_path.encode(), jsonl_path.encode())
+        if lines < 0:
+            raise OSError(f"Could not export SQL change log {log_path!r}")
+        return lines
     
     def track_query(self, query: str, rows_affected: int = 0, 
                    database: Optional[str] = None, old_value: Optional[str] = None,
@@ -150,9 +290,14 @@ class SQLTracker:
             new_bytes
         )
         
-        # For now, return empty list (would need to read from C struct)
-        # In a full implementation, would read changes from tracker
-        return []
+        # The newest changes are this query's
+        count = len(self)
+        view = _SQLChangeView()
+        result = []
+        for index in range(max(count - created, 0), count):
+            if self._lib.sql_tracker_get_change(self._tracker, index, ctypes.byref(view)) == 0:
+                result.append(view.to_change())
+        return result
     
     def get_changes(self, table_filter: Optional[str] = None,
                    column_filter: Optional[str] = None,
@@ -168,20 +313,45 @@ class SQLTracker:
         Returns:
             List of matching SQLChange objects
         """
-        result = []
-        for change in self._changes:
-            match = True
-            if table_filter and change.table_name != table_filter:
-                match = False
-            if column_filter and change.column_name != column_filter:
-                match = False
-            if operation_filter and change.operation.name != operation_filter:
-                match = False
-            
-            if match:
-                result.append(change)
+        def arg(value):
+            return value.encode() if value else None
         
-        return result
+        views = ctypes.c_void_p()
+        count = self._lib.sql_tracker_get_changes(self._tracker, arg(table_filter), arg(column_filter),
+                                                  arg(operation_filter), ctypes.byref(views))
+        if not views.value:
+            return []
+        try:
+            array = ctypes.cast(views, ctypes.POINTER(_SQLChangeView))
+            return [array[i].to_change() for i in range(count)]
+        finally:
+            self._libc.free(views)
+    
+    def iter_changes(self, table: Optional[str] = None, column: Optional[str] = None,
+                     operation: Optional[str] = None, since_ns: int = 0,
+                     until_ns: int = 0) -> Iterator[SQLChange]:
+        """
+        Iterate matching changes in timestamp order through the native indexes
+        
+        Args:
+            table: Table name
+            column: Column name
+            operation: INSERT, UPDATE, DELETE or SELECT
+            since_ns: Changes at or after this timestamp
+            until_ns: Changes before this timestamp (0: no bound)
+        
+        Note:
+            Tracking more queries while iterating ends the iteration's validity,
+            as with the native cursor
+        """
+        query = _ChangeQuery(table.encode() if table else None, column.encode() if column else None,
+                             SQLOperation[operation].value if operation else 0, since_ns, until_ns)
+        cursor = _Cursor()
+        if self._lib.sql_tracker_query(self._tracker, ctypes.byref(query), ctypes.byref(cursor)) != 0:
+            raise ValueError("invalid change query")
+        view = _SQLChangeView()
+        while self._lib.sql_cursor_next(ctypes.byref(cursor), ctypes.byref(view)):
+            yield view.to_change()
     
     def summary(self) -> Dict:
         """Get statistics about tracked changes"""
@@ -189,7 +359,8 @@ class SQLTracker:
         tables = {}
         columns = set()
         
-        for change in self._changes:
+        changes = self.get_changes()
+        for change in changes:
             op_name = change.operation.name
             ops[op_name] = ops.get(op_name, 0) + 1
             
@@ -198,7 +369,7 @@ class SQLTracker:
             columns.add(f"{change.table_name}.{change.column_name}")
         
         return {
-            'total': len(self._changes),
+            'total': len(changes),
             'operations': ops,
             'tables': tables,
             'columns_changed': list(columns)
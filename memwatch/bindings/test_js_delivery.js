@@ -0,0 +1,193 @@
+#!/usr/bin/env node
+/**
+ * memwatch Node.js callback delivery test (needs the native addon:
+ * node-gyp rebuild, or make build-javascript)
+ *
+ * Each scenario runs in its own process, on the uffd backend (the minimal
+ * core protects pages itself only there). One region spans PAGES pages and
+ * every fault on them is one event: at least one per page written, more if
+ * a write faults again on a page re-armed before it retried, so the count
+ * to expect is the core's total_events. The JS thread spins without
+ * yielding while the worker fills the queue, so nothing is drained until
+ * it says so.
+ *
+ * 1. drop:     a full queue drops the rest, counted as callback_dropped
+ * 2. block:    a full queue stalls the worker until JS drains it; no drops
+ * 3. batch:    batches never exceed max_batch
+ * 4. shutdown: shutdown() returns while the worker is blocked on a full queue
+ */
+
+const { spawnSync } = require('child_process');
+
+const PAGE_SIZE = 4096;
+const PAGES = 256;
+const TIMEOUT_MS = 5000;
+
+function assert(cond, msg) {
+  if (!cond) {
+    console.log(`❌ FAIL - ${msg}`);
+    process.exit(1);
+  }
+}
+
+/* Spin on the JS thread (no event loop turn) until pred() holds */
+function spinUntil(pred, what) {
+  const deadline = Date.now() + TIMEOUT_MS;
+  while (!pred()) {
+    assert(Date.now() < deadline, `timed out waiting for ${what}`);
+  }
+}
+
+/* Yield to the event loop until pred() holds */
+function waitUntil(pred, what) {
+  const deadline = Date.now() + TIMEOUT_MS;
+  return new Promise((resolve) => {
+    const poll = () => {
+      if (pred()) return resolve();
+      assert(Date.now() < deadline, `timed out waiting for ${what}`);
+      setTimeout(poll, 5);
+    };
+    poll();
+  });
+}
+
+function setup() {
+  process.env.MEMWATCH_BACKEND = 'uffd';
+  const { MemWatch } = require('./memwatch');
+  let mw;
+  try {
+    mw = new MemWatch();
+  } catch (e) {
+    console.log(`⚠️  SKIP: ${e.message}`);
+    process.exit(0);
+  }
+  // Touch every page first: write protection only holds on present pages
+  const buffer = Buffer.allocUnsafeSlow(PAGES * PAGE_SIZE).fill(1);
+  const region_id = mw.watch(buffer, 'pages');
+  assert(region_id > 0, 'watch() returned no region');
+  const stats = () => mw.get_stats();
+  return { mw, buffer, region_id, stats };
+}
+
+/* Write each page once; returns the events this raised */
+function writePages(mw, buffer, value) {
+  const before = mw.get_stats().total_events;
+  for (let p = 0; p < PAGES; p++) {
+    buffer[p * PAGE_SIZE + 100] = value;
+  }
+  const events = Number(mw.get_stats().total_events - before);
+  assert(events >= PAGES, `${events} events for ${PAGES} pages written`);
+  return events;
+}
+
+const scenarios = {
+  async drop() {
+    const { mw, buffer, stats } = setup();
+    let delivered = 0;
+    mw.set_batch_callback((batch) => { delivered += batch.length; }, { queue_size: 16, policy: 'drop' });
+
+    const events = writePages(mw, buffer, 2);
+    spinUntil(() => { const s = stats(); return s.callback_queue_depth + Number(s.callback_dropped) === events; },
+              'every event queued or dropped');
+
+    let s = stats();
+    assert(s.callback_queue_depth === 16, `queue holds ${s.callback_queue_depth}, expected 16`);
+    assert(s.callback_dropped === BigInt(events - 16), `dropped ${s.callback_dropped}, expected ${events - 16}`);
+
+    await waitUntil(() => delivered === 16, 'the queued events');
+    s = stats();
+    assert(s.callback_delivered === 16n, `delivered ${s.callback_delivered}, expected 16`);
+    assert(s.callback_blocked === 0n, 'drop policy blocked the worker');
+    mw.shutdown();
+    return `16 delivered, ${events - 16} dropped`;
+  },
+
+  async block() {
+    const { mw, buffer, region_id, stats } = setup();
+    const seqs = new Set();
+    let bad = 0;
+    mw.set_callback((event) => {
+      seqs.add(event.seq);
+      if (event.region_id !== region_id || event.variable_name !== 'pages' ||
+          event.old_preview.toString() !== 'changed' || event.new_preview.toString() !== 'value' ||
+          typeof event.timestamp_ns !== 'bigint' || event.timestamp_ns === 0n) {
+        bad++;
+      }
+    }, { queue_size: 16, policy: 'block' });
+
+    const events = writePages(mw, buffer, 3);
+    spinUntil(() => stats().callback_blocked > 0n, 'the worker to block');
+    let s = stats();
+    assert(s.callback_queue_depth === 16, `blocked with ${s.callback_queue_depth} queued, expected 16`);
+
+    await waitUntil(() => seqs.size === events, 'every event');
+    s = stats();
+    assert(bad === 0, `${bad} events decoded wrong`);
+    assert(s.callback_dropped === 0n, `block policy dropped ${s.callback_dropped}`);
+    assert(s.callback_delivered === BigInt(events), `delivered ${s.callback_delivered}, expected ${events}`);
+    const blocked = s.callback_blocked;
+    mw.shutdown();
+    return `${events} delivered, worker blocked ${blocked} times, none dropped`;
+  },
+
+  async batch() {
+    const { mw, buffer, stats } = setup();
+    const MAX_BATCH = 10;
+    const sizes = [];
+    mw.set_batch_callback((batch) => { sizes.push(batch.length); }, { max_batch: MAX_BATCH });
+
+    const events = writePages(mw, buffer, 4);
+    spinUntil(() => stats().callback_queue_depth === events, 'every event queued');
+
+    await waitUntil(() => sizes.reduce((a, b) => a + b, 0) === events, 'every event');
+    const s = stats();
+    const expected = Math.ceil(events / MAX_BATCH);
+    assert(sizes.every((n) => n > 0 && n <= MAX_BATCH), `batch sizes ${sizes.join(',')} exceed ${MAX_BATCH}`);
+    assert(sizes.length === expected, `${sizes.length} batches, expected ${expected}`);
+    assert(s.callback_batches === BigInt(expected), `callback_batches ${s.callback_batches}, expected ${expected}`);
+    assert(s.callback_delivered === BigInt(events), `delivered ${s.callback_delivered}, expected ${events}`);
+    mw.shutdown();
+    return `${events} events in ${sizes.length} batches of at most ${MAX_BATCH}`;
+  },
+
+  async shutdown() {
+    const { mw, buffer, stats } = setup();
+    mw.set_batch_callback(() => {}, { queue_size: 4, policy: 'block' });
+
+    writePages(mw, buffer, 5);
+    spinUntil(() => stats().callback_blocked > 0n, 'the worker to block');
+
+    const started = Date.now();
+    mw.shutdown();  // hangs here if the blocked worker is not released
+    const s = stats();
+    assert(s.callback_dropped > 0n, 'events left behind the blocked one were not dropped');
+    return `returned in ${Date.now() - started} ms with the worker blocked`;
+  },
+};
+
+if (process.argv[2]) {
+  scenarios[process.argv[2]]().then((summary) => {
+    console.log(summary);
+    process.exit(0);
+  });
+} else {
+  console.log('🧪 Node.js Callback Delivery Test');
+  console.log('=================================');
+  let failed = 0;
+  for (const name of Object.keys(scenarios)) {
+    const run = spawnSync(process.execPath, [__filename, name], { encoding: 'utf8', timeout: 4 * TIMEOUT_MS });
+    const out = (run.stdout || '').trim() || (run.stderr || '').trim();
+    if (run.status === 0) {
+      console.log(`  ✓ ${name}: ${out}`);
+    } else {
+      console.log(`  ✗ ${name}: ${run.error ? run.error.message : out}`);
+      failed++;
+    }
+  }
+  if (failed === 0) {
+    console.log('✅ PASS - Node.js: delivery policies, batching and shutdown');
+    process.exit(0);
+  }
+  console.log(`❌ FAIL - Node.js: ${failed} scenario(s) failed`);
+  process.exit(1);
+}
@@ -44,7 +44,8 @@ print_status() {
 # ==========================================
 echo "0️⃣  Building FastStorage (Pure C Backend)..."
 cd ../storage_utility
-if gcc -O3 -march=native -fPIC -shared -o faststorage_c.so faststorage.c -lm -lpthread 2>/dev/null; then
+if gcc -O3 -march=native -fPIC -shared -I"$PROJECT_DIR/include" -o faststorage_c.so faststorage.c \
+    "$PROJECT_DIR/src/memwatch_hash.c" -lm -lpthread 2>/dev/null; then
     print_status "FastStorage" "✓"
     ls -lh faststorage_c.so | awk '{print "  → Built: " $9 " (" $5 ")"}'
 else
@@ -60,7 +61,7 @@ echo ""
 # ==========================================
 echo "0️⃣ B Building Preload Library (libmemwatch.so)..."
 mkdir -p build
-gcc -shared -fPIC -O2 -I./include src/memwatch_preload.c src/memwatch_tracker.c \
+gcc -shared -fPIC -O2 -I./include src/memwatch_preload.c src/memwatch_tracker.c src/memwatch_arena.c src/memwatch_backend.c src/memwatch_diff.c src/memwatch_sqlite_sink.c \
     -lm -lpthread $(pkg-config --cflags --libs sqlite3 2>/dev/null | echo "-lsqlite3") -o build/libmemwatch.so 2>/tmp/preload_build.log
 if [ -f build/libmemwatch.so ] && [ -s build/libmemwatch.so ]; then
     print_status "Preload Library" "✓"
@@ -333,8 +334,9 @@ echo ""
 if command -v gcc &> /dev/null; then
     echo "Building memwatch CLI (optimized with Pure C backend)..."
     
-    if gcc -O3 -march=native -o build/memwatch_cli src/memwatch_cli.c src/memwatch_core_minimal.c \
-        -I./include $(pkg-config --cflags --libs sqlite3 2>/dev/null || echo "-lsqlite3") -lpthread \
+    if gcc -O3 -march=native -o build/memwatch_cli src/memwatch_cli.c src/memwatch_core_minimal.c src/memwatch_backend.c src/memwatch_sqlite_sink.c src/memwatch_event_ring.c src/memwatch_stats.c \
+        src/memwatch_trace.c src/faststorage_fast.c src/memwatch_hash.c src/memwatch_export.c src/memwatch_lz4.c \
+        -I./include $(pkg-config --cflags --libs sqlite3 2>/dev/null || echo "-lsqlite3") -lpthread -ldl -lrt \
         > /tmp/cli_build.log 2>&1; then
         echo -e "${GREEN}✓${NC} Universal CLI built"
         echo "  Backend: Pure C FastStorage (1.77x faster, 6x faster reads)"
@@ -13,7 +13,7 @@ int main(int argc, char *argv[]) {
     printf("=== SQL Tracker Example - C ===\n\n");
     
     // Initialize tracker
-    SQLTracker *tracker = sql_tracker_init(NULL);  // Or "/tmp/sql_changes.jsonl" for persistence
+    SQLTracker *tracker = sql_tracker_init(NULL);  // Or "/tmp/sql_changes.log" for a persistent change log
     if (!tracker) {
         fprintf(stderr, "Failed to initialize tracker\n");
         return 1;
@@ -105,7 +105,7 @@ int main(int argc, char *argv[]) {
 
 /*
  * Compile with:
- *   gcc -o sql_tracker_example_c examples/sql_tracker_example_c.c src/sql_tracker.c -I include -lm
+ *   gcc -o sql_tracker_example_c examples/sql_tracker_example_c.c src/sql_tracker.c src/memwatch_hash.c src/memwatch_lz4.c -I include -lm -lpthread
  * 
  * Run with:
  *   ./sql_tracker_example_c
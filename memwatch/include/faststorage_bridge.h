@@ -6,6 +6,7 @@
 #define FASTSTORAGE_BRIDGE_H
 
 #include <stddef.h>
+#include "faststorage_fast.h"
 
 /* Initialize FastStorage backend */
 int faststorage_bridge_init(const char *db_path, size_t capacity);
@@ -13,9 +14,13 @@ int faststorage_bridge_init(const char *db_path, size_t capacity);
 /* Write to storage */
 int faststorage_bridge_write(const char *key, const char *value);
 
-/* Read from storage */
+/* Read from storage (text values; per-thread buffer, valid until the next call) */
 const char* faststorage_bridge_read(const char *key);
 
+/* Zero-copy read; release the view with faststorage_bridge_release_view */
+int faststorage_bridge_get_view(const char *key, FastStorageView *view);
+int faststorage_bridge_release_view(FastStorageView *view);
+
 /* Flush to disk */
 int faststorage_bridge_flush(void);
 
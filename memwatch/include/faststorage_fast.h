@@ -17,23 +17,89 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <pthread.h>
+#include <sys/types.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* On-disk layout types, defined in faststorage_fast.c */
+struct FSFileHeader;
+struct FSHashEntry;
+struct FSSegment;
+struct FSStream;
+struct FSView;
+struct FSRetired;
+
 /* Opaque handle to storage instance */
 typedef struct FastStorageImpl {
     int fd;
     uint8_t *mmap_ptr;
     size_t file_size;
-    void *header;
-    void *hash_table;
+    struct FSFileHeader *header;     /* points into mmap_ptr */
+    struct FSHashEntry *hash_table;  /* points into mmap_ptr */
     pthread_rwlock_t lock;
-    uint64_t reads;
+    uint32_t seq;                    /* odd while a writer holds lock; lock-free
+                                      * readers retry when it moved under them */
+    uint64_t *reads;                 /* per-thread-stripe counters, a cache line apart */
     uint64_t writes;
     uint64_t deletes;
     int resized;
+    /* Incremental rehash: a table twice the size is filled a few slots per
+     * write while the current table stays complete and authoritative */
+    struct FSHashEntry *rehash_table; /* points into mmap_ptr, NULL if idle */
+    uint64_t rehash_offset;
+    uint32_t rehash_slots;
+    uint32_t rehash_cursor;          /* current slots below this are copied */
+    uint64_t growths;
+    uint64_t rehashes;
+    /* Segmented log: records are appended into fixed-size segments with
+     * live-byte accounting, so a mostly dead segment can be emptied and reused */
+    struct FSSegment *segments;
+    uint32_t num_segments;           /* segments up to header->data_end */
+    uint32_t segments_capacity;
+    uint32_t active_segment;         /* receives appends, UINT32_MAX if none */
+    uint64_t append_offset;
+    uint64_t append_limit;
+    /* Background compactor */
+    pthread_t compactor;
+    int compactor_running;
+    int compactor_stop;
+    uint32_t victim;                 /* segment being emptied, UINT32_MAX if none */
+    uint32_t victim_cursor;          /* hash slots already checked for it */
+    uint64_t victim_table;           /* hash_table_offset the pass started on */
+    uint64_t compactions;
+    uint64_t reclaimed;
+    /* Chunked values being written; the compactor moves their chunks too */
+    struct FSStream *streams;
+    uint64_t next_serial;
+    /* Zero-copy views: segments and mappings a view may point into are
+     * retired rather than freed, until every older view is released */
+    pthread_mutex_t view_lock;       /* guards views; taken after lock */
+    struct FSView *views;
+    uint32_t views_capacity;
+    uint32_t active_views;
+    uint64_t epoch;                  /* advanced under the write lock per retirement */
+    struct FSRetired *retired;       /* oldest last */
+    struct FSRetired *mappings;      /* mappings left behind by growth, unmapped on destroy */
+    /* Sharded handle (faststorage_create_sharded): owns no file, and routes
+     * each key by hash to one of num_shards independent stores */
+    struct FastStorageImpl **shards;
+    uint32_t num_shards;
+    /* Durability (faststorage_set_durability); a sharded handle's flusher
+     * serves all its shards */
+    int durability;                  /* FastStorageDurability */
+    uint32_t flush_interval_ms;
+    uint32_t flushed_seq;            /* seq when the flusher last synced this store */
+    pthread_t flusher;
+    int flusher_running;
+    int flusher_stop;
+    pthread_mutex_t commit_lock;     /* guards the flusher's round counters */
+    pthread_cond_t commit_cond;
+    uint64_t rounds_started;
+    uint64_t rounds_done;
+    uint64_t syncs;
+    uint64_t dropped;                /* records discarded by crash recovery on open */
 } FastStorageImpl, FastStorage;
 
 /* ============================================================================
@@ -44,11 +110,26 @@ typedef struct FastStorageImpl {
  * Create or open a FastStorage instance
  * 
  * @param filename Path to the storage file
- * @param capacity Initial capacity in bytes (will auto-grow)
+ * @param capacity Initial capacity in bytes (grows geometrically in 2 MB extents)
  * @return Handle to storage, NULL on failure
  */
 FastStorage* faststorage_create(const char *filename, size_t capacity);
 
+/**
+ * Create or open a store split into independent shards
+ * Keys are spread by hash over num_shards stores in files "<filename>.0",
+ * "<filename>.1", ...; each has its own lock, index and log, so writers to
+ * different shards don't contend. The handle takes every faststorage_*
+ * call; count, stats and maintenance calls cover all shards. A store must
+ * be reopened with the shard count it was created with.
+ * 
+ * @param filename Path prefix of the shard files
+ * @param capacity Initial capacity in bytes, split over the shards
+ * @param num_shards Number of shards (1-256)
+ * @return Handle to storage, NULL on failure (EINVAL on a shard count mismatch)
+ */
+FastStorage* faststorage_create_sharded(const char *filename, size_t capacity, uint32_t num_shards);
+
 /**
  * Close and flush storage
  * 
@@ -63,6 +144,7 @@ void faststorage_destroy(FastStorage *fs);
 /**
  * Write key-value pair (overwrites if exists)
  * Returns immediately after writing to mmap buffer
+ * Values over 100 KB are stored as chunks (see faststorage_write_stream)
  * 
  * @param fs Storage handle
  * @param key Null-terminated key (max 256 bytes)
@@ -72,9 +154,59 @@ void faststorage_destroy(FastStorage *fs);
  */
 int faststorage_write(FastStorage *fs, const char *key, const void *value, size_t value_len);
 
+/**
+ * One key-value pair of a write batch
+ */
+typedef struct {
+    const char *key;                 /* Null-terminated key (max 256 bytes) */
+    const void *value;
+    size_t value_len;
+} FastStorageBatchEntry;
+
+/**
+ * Write many key-value pairs under one lock acquisition
+ * The records are appended back to back and, in FASTSTORAGE_DURABILITY_SYNC
+ * mode, made durable by one sync for the whole batch. Values over 100 KB
+ * are streamed in between, as by faststorage_write.
+ * 
+ * @param fs Storage handle
+ * @param entries Pairs to write, in order
+ * @param count Number of entries
+ * @return 0 on success, -1 on failure; entries before the failing one are
+ *         stored (per shard for a sharded store)
+ */
+int faststorage_write_batch(FastStorage *fs, const FastStorageBatchEntry *entries, size_t count);
+
+/**
+ * Produces the next bytes of a streamed value
+ * 
+ * @param ctx Caller context
+ * @param buf Destination for up to len bytes
+ * @param len Bytes wanted
+ * @return Bytes written to buf; 0 or less aborts the stream
+ */
+typedef ssize_t (*faststorage_source_fn)(void *ctx, void *buf, size_t len);
+
+/**
+ * Write a value of value_len bytes without holding it in memory
+ * The value goes to disk in 256 KB chunks as source produces them; only
+ * one chunk is buffered. The key switches to the new value atomically
+ * once all bytes are in, and keeps its old value if the stream fails.
+ * 
+ * @param fs Storage handle
+ * @param key Null-terminated key (max 256 bytes)
+ * @param value_len Total length of the value
+ * @param source Called until value_len bytes have been produced
+ * @param ctx Passed to source
+ * @return 0 on success, -1 on failure (ECANCELED if source aborted)
+ */
+int faststorage_write_stream(FastStorage *fs, const char *key, uint64_t value_len,
+                             faststorage_source_fn source, void *ctx);
+
 /**
  * Read value by key
- * O(1) lookup via internal hash map
+ * O(1) lookup via internal hash map. Takes no lock: the lookup is retried
+ * if a write overlapped it
  * 
  * @param fs Storage handle
  * @param key Null-terminated key
@@ -84,6 +216,64 @@ int faststorage_write(FastStorage *fs, const char *key, const void *value, size_
  */
 int faststorage_read(FastStorage *fs, const char *key, void *value_out, size_t *value_len_out);
 
+/**
+ * Receives the next piece of a streamed value
+ * data points into the store and is valid only during the call; the
+ * sink must not write to the store.
+ * 
+ * @return 0 to continue, nonzero to stop the stream
+ */
+typedef int (*faststorage_sink_fn)(void *ctx, const void *data, size_t len);
+
+/**
+ * Read a value piece by piece, without copying it
+ * Chunks are passed to sink in order, straight from the mapping. Writers
+ * are only held off for one chunk at a time.
+ * 
+ * @param fs Storage handle
+ * @param key Null-terminated key
+ * @param sink Called once per chunk
+ * @param ctx Passed to sink
+ * @return 0 on success, -1 if not found, stopped by sink (ECANCELED) or
+ *         overwritten mid-stream (EAGAIN)
+ */
+int faststorage_read_stream(FastStorage *fs, const char *key, faststorage_sink_fn sink, void *ctx);
+
+/**
+ * Read-only view of a value, straight from the store
+ */
+typedef struct {
+    const void *ptr;                 /* value bytes, valid until released */
+    size_t len;
+    uint64_t token;                  /* identifies the view to faststorage_release_view */
+} FastStorageView;
+
+/**
+ * Look up a value without copying it
+ * Inline values point into the store's mapping; chunked values are mapped
+ * back to back into a private read-only range (copied for files written
+ * before chunks were page aligned). The bytes stay valid across writes,
+ * file growth and compaction until the view is released: memory a view
+ * may point at is retired and only freed once every view taken before
+ * then is gone. Views must be released before faststorage_clear() or
+ * faststorage_destroy().
+ * 
+ * @param fs Storage handle
+ * @param key Null-terminated key
+ * @param view Receives the view
+ * @return 0 on success, -1 if not found (ENOENT) or out of memory
+ */
+int faststorage_get_view(FastStorage *fs, const char *key, FastStorageView *view);
+
+/**
+ * Release a view; its bytes must not be touched afterwards
+ * 
+ * @param fs Storage handle
+ * @param view View from faststorage_get_view, cleared on return
+ * @return 0 on success, -1 if the view is unknown or already released
+ */
+int faststorage_release_view(FastStorage *fs, FastStorageView *view);
+
 /**
  * Read value size without copying
  * 
@@ -115,9 +305,44 @@ int faststorage_exists(FastStorage *fs, const char *key);
  * MAINTENANCE FUNCTIONS
  * ============================================================================ */
 
+/**
+ * When writes reach the disk
+ * Every record carries a CRC-32C. A store that was not closed by
+ * faststorage_destroy() is checked on open: its log is cut at the first
+ * torn or damaged record and keys whose record is damaged are dropped.
+ */
+typedef enum {
+    FASTSTORAGE_DURABILITY_NONE = 0, /* left to the kernel (default) */
+    FASTSTORAGE_DURABILITY_ASYNC,    /* writeback started every interval */
+    FASTSTORAGE_DURABILITY_GROUP,    /* synced every interval: loses at most that much */
+    FASTSTORAGE_DURABILITY_SYNC      /* synced before each write, delete or batch returns */
+} FastStorageDurability;
+
+/**
+ * Select a durability mode
+ * ASYNC and GROUP run a background flusher, which skips stores nothing
+ * was written to since its last round.
+ * 
+ * @param fs Storage handle
+ * @param mode Durability mode
+ * @param interval_ms Flusher period for ASYNC and GROUP (0 for 10 ms)
+ * @return 0 on success, -1 on failure
+ */
+int faststorage_set_durability(FastStorage *fs, FastStorageDurability mode, uint32_t interval_ms);
+
+/**
+ * Wait until every write made before the call is on disk
+ * In GROUP mode this waits for the flusher's next round, so concurrent
+ * callers share one sync; otherwise the file is synced directly.
+ * 
+ * @param fs Storage handle
+ * @return 0 on success, -1 on failure
+ */
+int faststorage_sync(FastStorage *fs);
+
 /**
  * Flush all pending writes to disk
- * This is automatic but can be called for safety
+ * Starts writeback without waiting for it (see faststorage_sync)
  * 
  * @param fs Storage handle
  * @return 0 on success
@@ -157,8 +382,8 @@ size_t faststorage_capacity(FastStorage *fs);
 int faststorage_clear(FastStorage *fs);
 
 /**
- * Compact storage (rebuilds to remove fragmentation)
- * This may take time but speeds up future reads
+ * Compact storage now: empty every segment that is at least half dead
+ * A background thread already does this a bounded amount per tick
  * 
  * @param fs Storage handle
  * @return 0 on success
@@ -182,8 +407,13 @@ typedef struct {
     uint64_t total_deletes;
     uint64_t cache_hits;
     uint64_t cache_misses;
-    uint64_t compactions;
-    uint64_t growth_count;
+    uint64_t compactions;            /* segments emptied and freed */
+    uint64_t growth_count;           /* file extensions */
+    uint64_t rehash_count;           /* completed hash table doublings */
+    uint64_t reclaimed_bytes;        /* returned to the file system by compaction,
+                                      * once no view points into them */
+    uint64_t sync_count;             /* file syncs for durability */
+    uint64_t dropped_records;        /* damaged records discarded on open */
 } FastStorageStats;
 
 int faststorage_get_stats(FastStorage *fs, FastStorageStats *stats);
@@ -0,0 +1,94 @@
+/*
+ * memwatch_arena.h - Page-isolated arena for auto-tracked allocations
+ *
+ * A tracked allocation must own its pages: watching part of a page that
+ * also holds unrelated heap data reports (or faults on) every write to
+ * that data. The arena hands out page-aligned blocks that share no page
+ * with anything else.
+ *
+ * - One virtual reservation, split into a zone per size class (1, 2, 4 ...
+ *   pages); each slot is its class's pages followed by one PROT_NONE guard
+ *   page, so overruns fault instead of corrupting a neighbour
+ * - Freed slots go on a per-class free list and are reused without system
+ *   calls; a slot's pages are only made writable on first use
+ * - Pointer -> slot is arithmetic on the reservation, so ownership checks
+ *   in free()/realloc() cost a compare
+ * - Bookkeeping is mmap'd, never malloc'd: the arena backs a malloc hook
+ * - Thread-safe (one lock per size class)
+ */
+
+#ifndef MEMWATCH_ARENA_H
+#define MEMWATCH_ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MW_ARENA_CLASSES 9                  /* 1 .. 256 pages */
+#define MW_ARENA_ZONE_SIZE (64UL << 20)     /* address space per class */
+
+typedef struct {
+    size_t size;        /* requested bytes, 0 while free */
+    int tag;            /* caller data, e.g. a tracker region id */
+    uint32_t next_free;
+} mw_arena_slot_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    size_t pages;       /* usable pages per slot */
+    size_t stride;      /* bytes per slot, guard page included */
+    uint32_t nslots;
+    uint32_t next_unused;
+    uint32_t free_head; /* UINT32_MAX: empty */
+    mw_arena_slot_t *slots;
+} mw_arena_zone_t;
+
+typedef struct {
+    uint8_t *base;
+    size_t reserved;    /* 0: not initialized */
+    size_t page_size;
+    size_t max_size;    /* largest servable request */
+    int nzones;
+    mw_arena_zone_t zones[MW_ARENA_CLASSES];
+} mw_arena_t;
+
+/**
+ * Reserve address space for blocks of up to max_size bytes
+ *
+ * Returns: 0 on success, -1 on failure (errno set)
+ */
+int mw_arena_init(mw_arena_t *a, size_t max_size);
+
+/* Unmap everything; outstanding pointers become invalid */
+void mw_arena_destroy(mw_arena_t *a);
+
+/**
+ * Allocate a page-aligned block of size bytes (1 <= size <= max_size)
+ *
+ * Returns: block, or NULL if size is out of range or its class is full
+ */
+void *mw_arena_alloc(mw_arena_t *a, size_t size);
+
+/* Return a block to its class's free list; ptr must be owned */
+void mw_arena_free(mw_arena_t *a, void *ptr);
+
+static inline bool mw_arena_owns(const mw_arena_t *a, const void *ptr) {
+    return (uintptr_t)ptr - (uintptr_t)a->base < a->reserved;
+}
+
+/* Slot of an owned block */
+mw_arena_slot_t *mw_arena_slot(mw_arena_t *a, const void *ptr);
+
+/* Usable bytes of an owned block (its class's pages) */
+size_t mw_arena_capacity(const mw_arena_t *a, const void *ptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEMWATCH_ARENA_H */
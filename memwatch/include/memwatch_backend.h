@@ -0,0 +1,212 @@
+/*
+ * memwatch_backend.h - Write-detection backends
+ *
+ * - mprotect:   pages are PROT_READ, writes raise SIGSEGV in the writing
+ *               thread (portable, but owns a process-wide signal)
+ * - uffd-wp:    userfaultfd write-protect (Linux 5.7+). Writes block in the
+ *               kernel and are reported on a file descriptor, so faults are
+ *               handled on a memwatch thread with no signals at all and
+ *               coexist with JVM/Go/crash-reporter SIGSEGV handlers
+ * - soft-dirty: nothing is protected. A scanner clears the soft-dirty bits
+ *               (/proc/self/clear_refs) and later reads them back from
+ *               /proc/self/pagemap. Zero cost per write, latency of one
+ *               scan interval; suited to large, rarely written regions.
+ *               A write landing between a scan's read and its clear is
+ *               reported with the next write to that page.
+ *
+ * Independently of the backend, regions of 8 bytes or less may be watched
+ * with CPU debug registers (perf_event_open breakpoints): exact address,
+ * no page protection, a handful per process.
+ *
+ * The uffd and soft-dirty helpers are not thread-safe; each engine owns
+ * its handle.
+ */
+
+#ifndef MEMWATCH_BACKEND_H
+#define MEMWATCH_BACKEND_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    MW_BACKEND_MPROTECT = 0,
+    MW_BACKEND_UFFD_WP,
+    MW_BACKEND_SOFT_DIRTY,
+} mw_backend_kind_t;
+
+/**
+ * Parse a backend name ("mprotect", "uffd", "soft-dirty"; NULL = mprotect)
+ *
+ * Returns: 0 on success, -1 if the name is unknown
+ */
+int mw_backend_parse(const char *name, mw_backend_kind_t *out);
+
+const char *mw_backend_name(mw_backend_kind_t kind);
+
+/* ============================================================================
+ * USERFAULTFD WRITE-PROTECT
+ * ============================================================================ */
+
+typedef struct {
+    int fd;
+} mw_uffd_t;
+
+/* One write fault read from the descriptor */
+typedef struct {
+    uintptr_t address;
+    uint32_t thread_id;   /* 0 if the kernel does not report it */
+} mw_uffd_fault_t;
+
+/**
+ * Open a non-blocking userfaultfd with write-protect faults enabled
+ *
+ * Returns: 0 on success, -1 if unsupported or not permitted (errno set)
+ */
+int mw_uffd_open(mw_uffd_t *u);
+
+void mw_uffd_close(mw_uffd_t *u);
+
+/**
+ * Register [start, start + len) for write-protect faults (page aligned);
+ * untouched pages are read-faulted in so they can be protected
+ *
+ * Returns: 0 on success, -1 on failure (e.g. file-backed mapping)
+ */
+int mw_uffd_register(mw_uffd_t *u, uintptr_t start, size_t len);
+
+int mw_uffd_unregister(mw_uffd_t *u, uintptr_t start, size_t len);
+
+/**
+ * Write-protect (protect = true) or release a range; releasing also wakes
+ * threads blocked on it
+ *
+ * Returns: 0 on success, -1 on failure
+ */
+int mw_uffd_protect(mw_uffd_t *u, uintptr_t start, size_t len, bool protect);
+
+/**
+ * Wake threads blocked on a range without changing its protection; their
+ * write retries and faults again
+ */
+int mw_uffd_wake(mw_uffd_t *u, uintptr_t start, size_t len);
+
+/**
+ * Read pending write faults without blocking
+ *
+ * Returns: number of faults stored (0 if none), -1 on error
+ */
+int mw_uffd_read(mw_uffd_t *u, mw_uffd_fault_t *out, int max);
+
+/* ============================================================================
+ * SOFT-DIRTY SCANNER
+ * ============================================================================ */
+
+typedef struct {
+    int pagemap_fd;
+    int clear_refs_fd;
+    uint64_t *entries;    /* pagemap read buffer */
+    size_t capacity;
+} mw_soft_dirty_t;
+
+/**
+ * Open pagemap/clear_refs and check the kernel tracks soft-dirty bits
+ *
+ * Returns: 0 on success, -1 if unavailable (errno ENOTSUP if the kernel
+ *          lacks CONFIG_MEM_SOFT_DIRTY)
+ */
+int mw_soft_dirty_open(mw_soft_dirty_t *sd);
+
+void mw_soft_dirty_close(mw_soft_dirty_t *sd);
+
+/**
+ * Clear the soft-dirty bit of every page in the process
+ *
+ * Returns: 0 on success, -1 on failure
+ */
+int mw_soft_dirty_clear(mw_soft_dirty_t *sd);
+
+/* Called for each dirty page found by a scan */
+typedef void (*mw_soft_dirty_fn)(uintptr_t page_start, void *ctx);
+
+/**
+ * Report the pages of [start, start + npages * page_size) dirtied since
+ * the last clear, with one pagemap read for the whole range
+ *
+ * Returns: number of dirty pages, -1 on failure
+ */
+long mw_soft_dirty_scan(mw_soft_dirty_t *sd, uintptr_t start, size_t npages,
+                        mw_soft_dirty_fn fn, void *ctx);
+
+/* ============================================================================
+ * HARDWARE WATCHPOINTS
+ * ============================================================================ */
+
+#define MW_HWBP_MAX_LEN 8         /* widest debug-register watch */
+#define MW_HWBP_MAX_THREADS 64    /* threads covered by one watchpoint */
+
+/*
+ * One write breakpoint, opened on every thread of the process (perf cannot
+ * map the ring of an inherited per-task event, so each thread gets its
+ * own). Threads started later are picked up by mw_hwbp_refresh; a write
+ * made before that is reported with the region's next write.
+ */
+typedef struct {
+    uintptr_t addr;               /* aligned watch address */
+    uint32_t len;                 /* 1, 2, 4 or 8 */
+    int nfds;                     /* slots used, some may be dropped (-1) */
+    int fds[MW_HWBP_MAX_THREADS];
+    pid_t tids[MW_HWBP_MAX_THREADS];
+    void *rings[MW_HWBP_MAX_THREADS];
+} mw_hwbp_t;
+
+/* One write seen by a watchpoint */
+typedef struct {
+    uintptr_t ip;                 /* instruction after the write */
+    uint32_t thread_id;
+} mw_hwbp_hit_t;
+
+/**
+ * Aligned debug-register span covering [addr, addr + size)
+ *
+ * Returns: 0 if one breakpoint covers it, -1 if the region is too wide
+ */
+int mw_hwbp_span(uintptr_t addr, size_t size, uintptr_t *bp_addr, uint32_t *bp_len);
+
+/**
+ * Arm a write breakpoint over [addr, addr + size) on every current thread
+ *
+ * Returns: 0 on success, -1 on failure (errno ENOSPC once the debug
+ *          registers are used up, ENOTSUP/EACCES if perf is unavailable)
+ */
+int mw_hwbp_open(mw_hwbp_t *bp, uintptr_t addr, size_t size);
+
+/**
+ * Arm the breakpoint on threads started since the last open/refresh
+ *
+ * Returns: number of threads added, -1 on failure (errno as mw_hwbp_open)
+ */
+int mw_hwbp_refresh(mw_hwbp_t *bp);
+
+void mw_hwbp_close(mw_hwbp_t *bp);
+
+/* Release the breakpoint of one thread (POLLHUP: the thread has exited) */
+void mw_hwbp_drop(mw_hwbp_t *bp, int index);
+
+/**
+ * Read the hits queued on bp->fds[index] without blocking
+ *
+ * Returns: number of hits stored (0 if none)
+ */
+int mw_hwbp_read(mw_hwbp_t *bp, int index, mw_hwbp_hit_t *out, int max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEMWATCH_BACKEND_H */
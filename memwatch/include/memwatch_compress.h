@@ -0,0 +1,127 @@
+/*
+ * memwatch_compress.h - Dictionary compression for stored value snapshots
+ *
+ * - mw_compress_parse() / mw_compress_name(): "off", "lite", "balanced",
+ *   "deep"
+ * - mw_zstore_open(): compress the values put into a FastStorage store
+ * - mw_zstore_put(): store a value, compressed with its group's dictionary
+ * - mw_zstore_get() / mw_zstore_size(): decompress on read / the raw size
+ *   without decompressing
+ * - mw_zstore_stats(): ratio and CPU time spent either way
+ *
+ * Successive snapshots of one region are mostly the same bytes, but a
+ * snapshot of a few hundred bytes gives LZ4 nothing to match against. So
+ * values are put with a group (a region or adapter id), and once a group
+ * has seen a few values its latest one becomes a dictionary: an LZ4 block
+ * compressed against it may copy from it as if it came right before the
+ * value. A group is retrained once drift has cost it more bytes than a new
+ * dictionary takes. Dictionaries only ever reach back MW_LZ4_DICT_MAX
+ * bytes, so they pay off on values up to some tens of KB; larger ones
+ * compress fine on their own.
+ *
+ * Data that does not compress is stored raw, and a group whose values
+ * keep failing is not tried again for a while (doubling up to 64 puts),
+ * so incompressible regions cost a header and little CPU.
+ *
+ * Modes, after Architecture.yaml:
+ *   off        values stored raw (with the header, so they stay readable)
+ *   lite       LZ4 + dictionaries of up to 16 KB, from a group's 4th value
+ *              on; small regions, where they matter most
+ *   balanced   plain LZ4 for values of 256 bytes and up; no dictionaries
+ *   deep       LZ4 + dictionaries of up to 64 KB, from the 2nd value on,
+ *              also retrained every 64 values
+ *
+ * Keys: values go under the caller's key, behind a 16-byte header. The
+ * store also holds, for dictionary N and group G:
+ *   mwz.dict.N       uint32 group, then the dictionary bytes
+ *   mwz.group.G      uint32 id of the group's current dictionary
+ *   mwz.next         uint32 next dictionary id
+ * Dictionaries are never rewritten, so every value stays readable; they
+ * are loaded on the first read that needs them.
+ */
+
+#ifndef MEMWATCH_COMPRESS_H
+#define MEMWATCH_COMPRESS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include "faststorage_fast.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Values 0 and 1 match the older "compress = 0/1" flags (none / LZ4) */
+typedef enum {
+    MW_COMPRESS_OFF = 0,
+    MW_COMPRESS_BALANCED = 1,
+    MW_COMPRESS_LITE = 2,
+    MW_COMPRESS_DEEP = 3,
+} mw_compress_mode_t;
+
+/**
+ * Parse a mode name (NULL = balanced)
+ *
+ * Returns: 0 on success, -1 if the name is unknown
+ */
+int mw_compress_parse(const char *name, mw_compress_mode_t *out);
+
+const char *mw_compress_name(mw_compress_mode_t mode);
+
+typedef struct {
+    uint64_t values;              /* put */
+    uint64_t raw_bytes;           /* their size */
+    uint64_t stored_bytes;        /* what the store got, headers and dictionaries included */
+    uint64_t compressed;          /* stored LZ4 compressed */
+    uint64_t with_dict;           /* of those, against a dictionary */
+    uint64_t incompressible;      /* tried and stored raw */
+    uint64_t skipped;             /* stored raw untried: too small, mode, backoff */
+    uint64_t dicts;               /* dictionaries trained */
+    uint64_t reads;
+    uint64_t compress_ns;         /* CPU spent compressing */
+    uint64_t decompress_ns;
+} mw_compress_stats_t;
+
+typedef struct mw_zstore mw_zstore_t;
+
+/**
+ * Compress values put into fs; the store must outlive the handle
+ *
+ * Returns: handle, or NULL with errno set (EINVAL for an unknown mode)
+ */
+mw_zstore_t *mw_zstore_open(FastStorage *fs, mw_compress_mode_t mode);
+
+/**
+ * Store value under key. Thread-safe.
+ *
+ * Returns: 0 on success, -1 with errno set
+ */
+int mw_zstore_put(mw_zstore_t *z, const char *key, uint32_t group, const void *value, size_t len);
+
+/**
+ * Read and decompress the value under key into out
+ *
+ * Returns: 0 with *len_out set, or -1 with errno ENOENT (no such key),
+ *          ENOBUFS (capacity too small; *len_out is the size needed),
+ *          EBADMSG (not a compressed value, or damaged)
+ */
+int mw_zstore_get(mw_zstore_t *z, const char *key, void *out, size_t capacity, size_t *len_out);
+
+/**
+ * Raw size of the value under key, read from its header
+ *
+ * Returns: size, or -1 with errno ENOENT or EBADMSG
+ */
+ssize_t mw_zstore_size(mw_zstore_t *z, const char *key);
+
+void mw_zstore_stats(mw_zstore_t *z, mw_compress_stats_t *out);
+
+void mw_zstore_close(mw_zstore_t *z);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEMWATCH_COMPRESS_H */
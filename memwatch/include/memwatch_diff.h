@@ -0,0 +1,71 @@
+/*
+ * memwatch_diff.h - Shared snapshot comparison kernels
+ *
+ * - mw_diff_ranges(): compare a live region against its snapshot 64 bytes
+ *   (one cache line) at a time and report the changed line ranges, so
+ *   callers only look closely at memory that actually changed
+ *
+ * The fastest kernel for the running CPU (scalar, SSE2, AVX2, AVX-512 or
+ * NEON) is selected once, on first use or at library load, in the same
+ * way as the memwatch_hash kernels. Every kernel reports the same ranges.
+ *
+ * Set MEMWATCH_DIFF_KERNEL=scalar|sse2|avx2|avx512|neon to override the
+ * kernel choice (e.g. to compare kernels).
+ */
+
+#ifndef MEMWATCH_DIFF_H
+#define MEMWATCH_DIFF_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MW_DIFF_LINE 64                     /* Comparison granularity in bytes */
+
+/**
+ * A run of changed lines: [offset, offset + len) relative to the start
+ * of the compared buffers. offset is a multiple of MW_DIFF_LINE; len is
+ * too, except for a range that ends at the end of the buffers.
+ */
+typedef struct {
+    size_t offset;
+    size_t len;
+} mw_diff_range_t;
+
+/**
+ * Select a kernel for this CPU (idempotent, called automatically)
+ */
+void mw_diff_init(void);
+
+/**
+ * Find the lines where two buffers differ
+ *
+ * Adjacent changed lines are merged into one range. When max_ranges fill
+ * up, the scan stops after the last range stored; *scanned (optional)
+ * tells the caller where to resume.
+ *
+ * Returns: number of ranges stored (0 if the buffers are equal)
+ */
+size_t mw_diff_ranges(const void *a, const void *b, size_t len,
+                      mw_diff_range_t *ranges, size_t max_ranges, size_t *scanned);
+
+/**
+ * Force a kernel by name ("scalar", "sse2", "avx2", "avx512", "neon")
+ *
+ * Returns: 0 on success, -1 if the kernel is unknown or unsupported here
+ */
+int mw_diff_set_kernel(const char *name);
+
+/**
+ * Name of the selected kernel (for stats and benchmarks)
+ */
+const char *mw_diff_kernel_name(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEMWATCH_DIFF_H */
@@ -0,0 +1,132 @@
+/*
+ * memwatch_event_ring.h - Shared-memory event ring for external consumers
+ *
+ * - mw_ring_create(): producer side; a POSIX shared memory object
+ *   /memwatch-<name> holding fixed 64-byte event_packed_t slots, plus an
+ *   eventfd doorbell handed to consumers over the abstract unix socket
+ *   "@memwatch-ring-<name>"
+ * - mw_ring_publish(): copy one event into the ring (never blocks; a full
+ *   ring drops the event and counts it)
+ * - mw_ring_attach() / mw_ring_consume(): consumer side, for C; other
+ *   languages map the same layout (see bindings/memwatch_ring.py)
+ *
+ * The ring is single-producer, single-consumer. The producer only writes
+ * the eventfd when the consumer has said it is about to sleep, so a busy
+ * consumer costs no system call per event.
+ *
+ * Layout (little endian, offsets in bytes):
+ *   0    mw_ring_header_t (MW_RING_HEADER_SIZE bytes)
+ *   256  capacity slots of event_packed_t, slot i at 256 + 64 * (seq % capacity)
+ */
+
+#ifndef MEMWATCH_EVENT_RING_H
+#define MEMWATCH_EVENT_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * Packed Event Structure (64 bytes total, not 200+)
+ * ============================================================================ */
+
+typedef struct __attribute__((packed)) {
+    uint32_t timestamp_sec;          // 4 bytes (time in seconds, not nanoseconds)
+    uint16_t timestamp_ms;           // 2 bytes (milliseconds part)
+    uint32_t thread_id;              // 4 bytes
+    uint16_t var_id;                 // 2 bytes (variable ID, not full name)
+    uint8_t operation;               // 1 byte (operation type)
+    uint8_t scope;                   // 1 byte
+    int32_t old_value;               // 4 bytes (most values fit in 32-bit)
+    int32_t new_value;               // 4 bytes
+    uint16_t metadata_len;           // 2 bytes (metadata size)
+    char metadata[40];               // 40 bytes (compressed metadata)
+} event_packed_t;                    // Total: 64 bytes (instead of 200+)
+
+#define MW_RING_MAGIC       0x31474e4952574dULL    /* "MWRING1" */
+#define MW_RING_VERSION     1
+#define MW_RING_HEADER_SIZE 256
+
+/**
+ * Ring header at offset 0 of the mapping. head and tail count events
+ * since creation; the producer owns head, the consumer owns tail.
+ */
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t slot_size;              /* sizeof(event_packed_t) */
+    uint64_t capacity;               /* slots, a power of two */
+    uint32_t producer_pid;
+    uint32_t closed;                 /* set once the producer is done */
+    uint64_t dropped;                /* events lost to a full ring */
+    uint8_t pad0[64 - 40];
+    uint64_t head __attribute__((aligned(64)));     /* next sequence the producer writes */
+    uint64_t tail __attribute__((aligned(64)));     /* next sequence the consumer reads */
+    uint32_t consumer_waiting __attribute__((aligned(64)));  /* ring the doorbell */
+} mw_ring_header_t;
+
+typedef struct {
+    mw_ring_header_t *hdr;
+    event_packed_t *slots;
+    size_t map_size;
+    int doorbell;                    /* eventfd */
+    int listen_fd;                   /* producer: hands out the doorbell */
+    pthread_t server;
+    bool owner;
+    char name[64];
+} mw_ring_t;
+
+/**
+ * Create the ring and start handing its doorbell to consumers
+ *
+ * Args:
+ *   name: short name, [A-Za-z0-9_.-], at most 40 bytes
+ *   capacity: slots, rounded up to a power of two (0 = 65536)
+ *
+ * Returns: 0 on success, -1 with errno set (EEXIST if another producer
+ *          uses the name)
+ */
+int mw_ring_create(mw_ring_t *ring, const char *name, size_t capacity);
+
+/**
+ * Copy one event into the ring
+ *
+ * Returns: 0, or -1 if the ring was full (hdr->dropped is incremented)
+ */
+int mw_ring_publish(mw_ring_t *ring, const event_packed_t *event);
+
+/**
+ * Mark the ring closed, wake the consumer and unlink the ring
+ */
+void mw_ring_destroy(mw_ring_t *ring);
+
+/**
+ * Map a producer's ring and fetch its doorbell
+ *
+ * Returns: 0 on success, -1 with errno set (ENOENT if no such ring)
+ */
+int mw_ring_attach(mw_ring_t *ring, const char *name);
+
+/**
+ * Take up to max events, waiting up to timeout_ms (-1 = forever) for one
+ *
+ * Returns: number of events copied to out, 0 on timeout, or -1 with errno
+ *          EPIPE once the producer has closed and the ring is drained
+ */
+int mw_ring_consume(mw_ring_t *ring, event_packed_t *out, int max, int timeout_ms);
+
+/**
+ * Unmap a ring opened with mw_ring_attach()
+ */
+void mw_ring_detach(mw_ring_t *ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEMWATCH_EVENT_RING_H */
@@ -0,0 +1,208 @@
+/*
+ * memwatch_export.h - Streaming binary event export to a remote collector
+ *
+ * - mw_export_open(): start an exporter for a "tcp:host:port" or
+ *   "unix:/path" endpoint (memwatch_collector listens on either)
+ * - mw_export_event(): encode one event into the open batch; never waits
+ *   for the network
+ * - mw_export_flush() / mw_export_close(): wait until the collector has
+ *   acknowledged everything
+ * - mw_export_listen() / mw_export_unpack() / mw_export_read(): the
+ *   collector side
+ *
+ * Events are batched into frames of about batch_bytes, or whatever
+ * arrived within batch_interval_ms. Inside a frame each event is
+ * varint-coded: zigzag delta of its timestamp from the previous event,
+ * region and thread ids, then name, old and new value as length-prefixed
+ * bytes. The whole payload is LZ4 compressed and CRC-32C checked.
+ *
+ * A sender thread keeps at most window_frames frames in flight and frees
+ * each once acknowledged; the collector acknowledges after storing. After a
+ * reconnect the collector's hello reply names the last frame it stored, so
+ * nothing already stored is sent twice. Frames beyond max_queued_bytes go
+ * to spill_path (or are dropped and counted without one) until the
+ * collector catches up; a spill file left by a previous run is sent first,
+ * under that run's source id.
+ *
+ * Wire format (little endian): every message is an mw_frame_header_t
+ * followed by stored_len payload bytes. The exporter opens with a HELLO
+ * (payload mw_export_hello_t) and then sends EVENTS; the collector answers
+ * each with an ACK (no payload) whose seq is the last frame it stored for
+ * the source.
+ */
+
+#ifndef MEMWATCH_EXPORT_H
+#define MEMWATCH_EXPORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MW_EXPORT_MAGIC      0x3158574dU     /* "MWX1" */
+#define MW_EXPORT_VERSION    1
+#define MW_EXPORT_MAX_FRAME  (16 * 1024 * 1024)
+#define MW_EXPORT_NAME_MAX   48
+
+typedef enum {
+    MW_FRAME_HELLO = 1,
+    MW_FRAME_EVENTS = 2,
+    MW_FRAME_ACK = 3,
+} mw_frame_type_t;
+
+typedef enum {
+    MW_CODEC_NONE = 0,
+    MW_CODEC_LZ4 = 1,
+    MW_CODEC_ZSTD = 2,            /* reserved; not produced by this build */
+} mw_export_codec_t;
+
+typedef struct {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t type;                 /* mw_frame_type_t */
+    uint8_t codec;                /* mw_export_codec_t of the payload */
+    uint8_t flags;
+    uint64_t seq;                 /* EVENTS: frame number, from 1; ACK: last stored */
+    uint32_t count;               /* events in the frame */
+    uint32_t raw_len;             /* payload bytes once decompressed */
+    uint32_t stored_len;          /* payload bytes that follow */
+    uint32_t crc;                 /* CRC-32C of the stored payload */
+} mw_frame_header_t;
+
+typedef struct {
+    uint64_t source_id;           /* stable for a run and its spill file */
+    uint32_t pid;
+    uint32_t reserved;
+    char name[MW_EXPORT_NAME_MAX];  /* "host:pid" unless configured */
+} mw_export_hello_t;
+
+/**
+ * One event; name and values are copied by mw_export_event()
+ */
+typedef struct {
+    uint64_t timestamp_ns;
+    uint32_t region_id;
+    uint32_t thread_id;
+    const char *name;
+    uint32_t name_len;
+    const void *old_value;
+    uint32_t old_len;
+    const void *new_value;
+    uint32_t new_len;
+} mw_export_event_t;
+
+typedef struct {
+    const char *endpoint;         /* "tcp:host:port" or "unix:/path" */
+    const char *source_name;      /* NULL = "host:pid" */
+    size_t batch_bytes;           /* close a frame at this size (0 = 64 KB) */
+    uint32_t batch_interval_ms;   /* or this long after its first event (0 = 50) */
+    uint32_t window_frames;       /* frames sent ahead of acks (0 = 32) */
+    size_t max_queued_bytes;      /* frames held in memory (0 = 16 MB) */
+    const char *spill_path;       /* frames past that, NULL = drop them */
+    uint32_t close_timeout_ms;    /* mw_export_close() waits for acks (0 = 2000) */
+    bool uncompressed;            /* send payloads raw */
+} mw_export_config_t;
+
+typedef struct {
+    uint64_t events;              /* accepted by mw_export_event() */
+    uint64_t frames;              /* sealed */
+    uint64_t raw_bytes;           /* encoded events, before compression */
+    uint64_t stored_bytes;        /* frame payloads, after compression */
+    uint64_t frames_sent;         /* including resends */
+    uint64_t frames_acked;
+    uint64_t frames_spilled;
+    uint64_t frames_dropped;
+    uint64_t events_dropped;
+    uint64_t connects;
+    uint64_t queued_bytes;        /* in memory now */
+    uint64_t spilled_bytes;       /* in the spill file now */
+} mw_export_stats_t;
+
+typedef struct mw_exporter mw_exporter_t;
+
+/**
+ * Start exporting; the sender connects (and reconnects) in the background
+ *
+ * Returns: exporter, or NULL with errno set (EINVAL for a bad endpoint)
+ */
+mw_exporter_t *mw_export_open(const mw_export_config_t *config);
+
+/**
+ * Add one event to the open batch. Thread-safe.
+ *
+ * Returns: 0 on success, -1 with errno set (EMSGSIZE if the event alone
+ *          exceeds MW_EXPORT_MAX_FRAME)
+ */
+int mw_export_event(mw_exporter_t *x, const mw_export_event_t *event);
+
+/**
+ * Close the open batch and wait until every frame is acknowledged (or
+ * was dropped)
+ *
+ * Returns: 0, or -1 with errno ETIMEDOUT after timeout_ms (-1 = forever)
+ */
+int mw_export_flush(mw_exporter_t *x, int timeout_ms);
+
+void mw_export_stats(mw_exporter_t *x, mw_export_stats_t *out);
+
+/**
+ * Flush for up to close_timeout_ms and stop. Frames still not
+ * acknowledged are kept in the spill file, if there is one, for the next
+ * exporter that opens it.
+ */
+void mw_export_close(mw_exporter_t *x);
+
+/* ============================================================================
+ * Collector Side
+ * ============================================================================ */
+
+/**
+ * Bind and listen on a "tcp:host:port" (host may be empty) or
+ * "unix:/path" endpoint; a stale unix socket file is replaced
+ *
+ * Returns: listening socket, or -1 with errno set
+ */
+int mw_export_listen(const char *endpoint);
+
+/**
+ * Check a header read from the wire
+ *
+ * Returns: 0 if it is a well-formed frame of this version, -1 otherwise
+ */
+int mw_export_check_header(const mw_frame_header_t *header);
+
+/**
+ * Verify and decompress an EVENTS payload into raw (raw_len bytes)
+ *
+ * Returns: header->raw_len, or -1 with errno EBADMSG (bad CRC or
+ *          payload), ENOTSUP (unknown codec) or ENOBUFS (capacity)
+ */
+long mw_export_unpack(const mw_frame_header_t *header, const void *stored,
+                      void *raw, size_t capacity);
+
+/**
+ * Walks the events of a decompressed payload
+ */
+typedef struct {
+    const uint8_t *p;
+    const uint8_t *end;
+    uint64_t timestamp_ns;
+} mw_export_reader_t;
+
+void mw_export_reader_init(mw_export_reader_t *r, const void *raw, size_t len);
+
+/**
+ * Decode the next event; its name and values point into the payload
+ *
+ * Returns: 1 for an event, 0 at the end, -1 if the payload is malformed
+ */
+int mw_export_read(mw_export_reader_t *r, mw_export_event_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEMWATCH_EXPORT_H */
@@ -0,0 +1,210 @@
+/*
+ * memwatch_governor.h - Adaptive overhead governor for the tracing modes
+ *
+ * Architecture.yaml gives each mode an overhead_target: lite 5%, balanced
+ * 30%, deep 100% of one CPU. The worker charges every region for its
+ * share of the faults it took (each a trap and two protection changes,
+ * split between the regions on the page) and for the time spent diffing,
+ * copying and delivering its changes. Once per interval the governor adds
+ * the charges up and compares them with the mode's budget:
+ *
+ * - Over budget: the costliest regions step one level down the ladder,
+ *   as many as it takes to cover the excess, but never one costing less
+ *   than its fair share (budget / regions charged)
+ * - Well under budget: a demoted region whose cost one level up would
+ *   still be small steps back up once it has stayed cool for cool_needed
+ *   intervals; a region demoted again soon after a promotion waits twice
+ *   as long the next time
+ * - Mode off: every region goes straight back to full
+ *
+ * Ladder (mw_gov_level_t), each level cheaper than the one before:
+ *   full           values captured as the region was watched
+ *   preview        at most MW_GOV_PREVIEW_BYTES of value per change
+ *   hash           no value, the change and its fingerprint only
+ *   window_x4      hash, and pages stay writable 4x longer after a fault
+ *   window_x16     hash, 16x longer windows
+ *   sampled_100ms  pages not protected; the region is rehashed every 100 ms
+ *   sampled_1s     ... every second
+ *   sampled_10s    ... every 10 seconds
+ *
+ * Single-threaded: owned by the worker, no locking.
+ */
+
+#ifndef MEMWATCH_GOVERNOR_H
+#define MEMWATCH_GOVERNOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MW_GOV_LEVELS        8
+#define MW_GOV_LOG_SIZE      64       /* decisions kept for get_stats() */
+#define MW_GOV_PREVIEW_BYTES 256
+#define MW_GOV_COOL_TICKS    10       /* intervals a region must stay cool */
+#define MW_GOV_COOL_MAX      160
+
+typedef enum {
+    MW_GOV_OFF = 0,
+    MW_GOV_LITE,
+    MW_GOV_BALANCED,
+    MW_GOV_DEEP
+} mw_gov_mode_t;
+
+typedef enum {
+    MW_GOV_FULL = 0,
+    MW_GOV_PREVIEW,
+    MW_GOV_HASH,
+    MW_GOV_WINDOW_X4,
+    MW_GOV_WINDOW_X16,
+    MW_GOV_SAMPLED,
+    MW_GOV_SAMPLED_1S,
+    MW_GOV_SAMPLED_10S
+} mw_gov_level_t;
+
+typedef enum {
+    MW_GOV_OVER_BUDGET = 0,  /* demoted */
+    MW_GOV_COOLED,           /* promoted */
+    MW_GOV_MODE_OFF          /* reset to full */
+} mw_gov_reason_t;
+
+/* Per-region state, embedded in the caller's region (24 bytes) */
+typedef struct {
+    uint32_t writes;         /* this interval: faults, or changed pages when sampled */
+    uint32_t work_ns;        /* this interval: fault share, diffing, copying, delivering */
+    uint32_t cost_ns;        /* last interval's cost */
+    uint32_t event_ns;       /* smoothed cost of one write while pages were protected */
+    uint8_t level;           /* mw_gov_level_t */
+    uint8_t cool_ticks;
+    uint8_t cool_needed;     /* 0 until the region is first demoted */
+    uint8_t since_promotion; /* intervals since the last promotion plus one, saturating; 0 = never */
+    bool listed;             /* free for the caller (the worker's active list) */
+} mw_gov_region_t;
+
+/* One region handed to mw_governor_tick() */
+typedef struct {
+    mw_gov_region_t *state;
+    uint32_t region_id;
+} mw_gov_ref_t;
+
+typedef struct {
+    uint64_t time_ns;
+    uint32_t region_id;
+    uint8_t from;            /* mw_gov_level_t */
+    uint8_t to;
+    uint16_t reason;         /* mw_gov_reason_t */
+    uint64_t cost_ns;        /* region: last interval, or predicted one level up */
+    uint64_t total_ns;       /* every region, last interval */
+} mw_gov_decision_t;
+
+typedef struct {
+    mw_gov_mode_t mode;
+    uint64_t interval_ns;
+    uint64_t window_ns;      /* writable window at full */
+    uint64_t fault_cost_ns;
+    uint64_t budget_ns;      /* per interval */
+    uint64_t ticks;
+    uint64_t last_cost_ns;   /* every region, last interval */
+    uint64_t demotions;
+    uint64_t promotions;
+    uint32_t demoted;        /* regions below full */
+    uint32_t regions_at[MW_GOV_LEVELS];  /* regions passed to the last tick */
+    mw_gov_decision_t log[MW_GOV_LOG_SIZE];
+    uint64_t logged;         /* log holds the last min(logged, MW_GOV_LOG_SIZE) */
+} mw_governor_t;
+
+/* Called once per decision, after state->level changed */
+typedef void (*mw_gov_apply_fn)(uint32_t region_id, mw_gov_region_t *state,
+                                mw_gov_level_t from, void *ctx);
+
+/**
+ * Initialize a governor
+ *
+ * Args:
+ *   interval_ns: How often mw_governor_tick() is called
+ *   window_ns: Writable window after a fault at full
+ *   fault_cost_ns: What one fault costs the writing thread; the least a
+ *                  sampled region is expected to cost per changed page once
+ *                  its pages are protected again
+ */
+void mw_governor_init(mw_governor_t *g, mw_gov_mode_t mode, uint64_t interval_ns,
+                      uint64_t window_ns, uint64_t fault_cost_ns);
+
+/**
+ * Change mode; takes effect at the next tick
+ */
+void mw_governor_set_mode(mw_governor_t *g, mw_gov_mode_t mode);
+
+/**
+ * Account one interval and move regions along the ladder
+ *
+ * Args:
+ *   refs: Every region charged this interval plus every demoted one;
+ *         reordered
+ *   apply: Told about each decision (may be NULL)
+ *
+ * Returns: number of decisions
+ */
+size_t mw_governor_tick(mw_governor_t *g, mw_gov_ref_t *refs, size_t count, uint64_t now_ns,
+                        mw_gov_apply_fn apply, void *ctx);
+
+/**
+ * Decisions in the log, oldest first; copies at most max
+ *
+ * Returns: number copied
+ */
+size_t mw_governor_decisions(const mw_governor_t *g, mw_gov_decision_t *out, size_t max);
+
+/**
+ * "off", "lite", "balanced", "deep"; NULL parses as off
+ *
+ * Returns: 0, or -1 if the name is unknown
+ */
+int mw_gov_mode_parse(const char *name, mw_gov_mode_t *out);
+
+const char *mw_gov_mode_name(mw_gov_mode_t mode);
+const char *mw_gov_level_name(mw_gov_level_t level);
+const char *mw_gov_reason_name(mw_gov_reason_t reason);
+
+/* Architecture.yaml overhead_target, in percent of one CPU (0 = off) */
+unsigned mw_gov_target_pct(mw_gov_mode_t mode);
+
+static inline void mw_gov_charge(mw_gov_region_t *r, uint32_t writes, uint64_t work_ns) {
+    r->writes = r->writes + writes < r->writes ? UINT32_MAX : r->writes + writes;
+    uint64_t work = (uint64_t)r->work_ns + work_ns;
+    r->work_ns = work > UINT32_MAX ? UINT32_MAX : (uint32_t)work;
+}
+
+static inline bool mw_gov_sampled(mw_gov_level_t level) {
+    return level >= MW_GOV_SAMPLED;
+}
+
+/* Writable window after a fault at this level */
+static inline uint64_t mw_gov_window_ns(mw_gov_level_t level, uint64_t window_ns) {
+    return level == MW_GOV_WINDOW_X4 ? window_ns * 4 :
+           level >= MW_GOV_WINDOW_X16 ? window_ns * 16 : window_ns;
+}
+
+/* Rehash period of a sampled level */
+static inline uint64_t mw_gov_sample_ns(mw_gov_level_t level) {
+    return level == MW_GOV_SAMPLED ? 100000000ULL :
+           level == MW_GOV_SAMPLED_1S ? 1000000000ULL : 10000000000ULL;
+}
+
+/* max_value_bytes (-1 full, 0 none, >0 limit) to honour at this level */
+static inline int32_t mw_gov_capture(mw_gov_level_t level, int32_t max_value_bytes) {
+    if (level >= MW_GOV_HASH) return 0;
+    if (level == MW_GOV_PREVIEW && (max_value_bytes < 0 || max_value_bytes > MW_GOV_PREVIEW_BYTES)) {
+        return MW_GOV_PREVIEW_BYTES;
+    }
+    return max_value_bytes;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEMWATCH_GOVERNOR_H */
@@ -0,0 +1,65 @@
+/*
+ * memwatch_hash.h - Shared hashing kernels for memwatch and FastStorage
+ *
+ * - mw_hash64(): XXH3-class 64-bit hash (stripe accumulators + scramble),
+ *   used for region change detection and storage key hashing
+ * - mw_crc32c(): CRC-32C (Castagnoli), used for on-disk integrity checks
+ *
+ * The fastest kernel for the running CPU (scalar, SSE2, AVX2, AVX-512 or
+ * NEON for the hash; table, SSE4.2 or ARMv8 CRC for CRC-32C) is selected
+ * once, on first use or at library load. Every kernel produces identical
+ * output, so hashes may be persisted and compared across machines.
+ *
+ * Set MEMWATCH_HASH_KERNEL=scalar|sse2|avx2|avx512|neon to override the
+ * hash kernel choice (e.g. to compare kernels).
+ */
+
+#ifndef MEMWATCH_HASH_H
+#define MEMWATCH_HASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Select kernels for this CPU (idempotent, called automatically)
+ */
+void mw_hash_init(void);
+
+/**
+ * 64-bit hash of len bytes
+ *
+ * Returns: hash value, identical across kernels and platforms
+ */
+uint64_t mw_hash64(const void *data, size_t len);
+
+/**
+ * CRC-32C of len bytes, continuing from crc (pass 0 to start)
+ *
+ * mw_crc32c(mw_crc32c(0, a, n), b, m) equals the CRC of a followed by b.
+ *
+ * Returns: updated CRC
+ */
+uint32_t mw_crc32c(uint32_t crc, const void *data, size_t len);
+
+/**
+ * Force a hash kernel by name ("scalar", "sse2", "avx2", "avx512", "neon")
+ *
+ * Returns: 0 on success, -1 if the kernel is unknown or unsupported here
+ */
+int mw_hash_set_kernel(const char *name);
+
+/**
+ * Names of the selected kernels (for stats and benchmarks)
+ */
+const char *mw_hash_kernel_name(void);
+const char *mw_crc32c_kernel_name(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEMWATCH_HASH_H */
@@ -0,0 +1,84 @@
+/*
+ * memwatch_lz4.h - LZ4 block compression for memwatch logs
+ *
+ * - mw_lz4_compress(): greedy single-pass LZ4 block encoder (64 KB window,
+ *   4 KB-entry hash table on the stack, no allocation)
+ * - mw_lz4_decompress(): bounds-checked LZ4 block decoder
+ * - mw_lz4_dict_load() / mw_lz4_compress_dict() / mw_lz4_decompress_dict():
+ *   the same with a dictionary, for small blocks that resemble earlier data
+ *
+ * Output is the standard LZ4 block format, so blocks can be read by any
+ * LZ4 implementation (LZ4_decompress_safe) and vice versa. Frames,
+ * checksums and block sizes are left to the caller's container format.
+ */
+
+#ifndef MEMWATCH_LZ4_H
+#define MEMWATCH_LZ4_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MW_LZ4_DICT_MAX 65536               /* Matches reach back at most this far */
+
+/**
+ * Worst-case compressed size of len bytes
+ */
+static inline size_t mw_lz4_bound(size_t len) {
+    return len + len / 255 + 16;
+}
+
+/**
+ * Compress len bytes of src into dst
+ *
+ * Returns: compressed size, or 0 if it would not fit in capacity bytes
+ *          (callers usually store the block raw then)
+ */
+size_t mw_lz4_compress(const void *src, size_t len, void *dst, size_t capacity);
+
+/**
+ * Decompress an LZ4 block of len bytes into dst
+ *
+ * Returns: decompressed size, or -1 if the block is malformed or would
+ *          overflow capacity bytes
+ */
+long mw_lz4_decompress(const void *src, size_t len, void *dst, size_t capacity);
+
+/**
+ * A dictionary prepared for compression: its last MW_LZ4_DICT_MAX bytes,
+ * indexed. The bytes are not copied and must outlive it.
+ */
+typedef struct {
+    const uint8_t *data;
+    size_t len;
+    uint32_t table[1 << 12];
+} mw_lz4_dict_t;
+
+void mw_lz4_dict_load(mw_lz4_dict_t *dict, const void *data, size_t len);
+
+/**
+ * Compress src as a continuation of the dictionary (LZ4 "external
+ * dictionary" blocks); decompress with the same dictionary bytes
+ *
+ * Returns: compressed size, or 0 if it would not fit in capacity bytes
+ */
+size_t mw_lz4_compress_dict(const mw_lz4_dict_t *dict, const void *src, size_t len,
+                            void *dst, size_t capacity);
+
+/**
+ * Decompress a block compressed against dict (its last MW_LZ4_DICT_MAX
+ * bytes count)
+ *
+ * Returns: decompressed size, or -1 if malformed or over capacity
+ */
+long mw_lz4_decompress_dict(const void *dict, size_t dict_len, const void *src, size_t len,
+                            void *dst, size_t capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEMWATCH_LZ4_H */
@@ -0,0 +1,126 @@
+/*
+ * memwatch_page_index.h - Lock-free, signal-safe page index
+ *
+ * Open-addressed hash table keyed on page_start used by the memwatch
+ * cores to map a faulting page to its tracked regions.
+ *
+ * - Readers (signal handler, worker) never take a lock
+ * - Writers are serialized by the caller (e.g. page_table_mutex)
+ * - Every live key sits within MW_PAGE_INDEX_MAX_PROBE slots of its home
+ *   slot, so a lookup touches at most that many slots
+ * - The table grows online: a larger copy is built and published with a
+ *   single atomic pointer store. Readers announce themselves in one of two
+ *   counters picked by the current epoch; the writer flips the epoch, waits
+ *   for the old counter to drain (a few probes at most, as new readers use
+ *   the other one) and frees the old table, so only one table is ever kept
+ */
+
+#ifndef MEMWATCH_PAGE_INDEX_H
+#define MEMWATCH_PAGE_INDEX_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MW_PAGE_INDEX_MAX_PROBE     32
+#define MW_PAGE_INDEX_MIN_CAPACITY  1024
+
+/* Slot keys. Page starts are page-aligned, so 0 and 1 are never real keys */
+#define MW_PAGE_INDEX_EMPTY         ((uintptr_t)0)
+#define MW_PAGE_INDEX_TOMBSTONE     ((uintptr_t)1)
+
+typedef struct {
+    _Atomic uintptr_t key;
+    _Atomic(void *) value;
+} mw_page_slot_t;
+
+typedef struct mw_page_table {
+    size_t capacity;                /* power of two */
+    size_t mask;
+    unsigned shift;                 /* 64 - log2(capacity), for Fibonacci hashing */
+    mw_page_slot_t slots[];
+} mw_page_table_t;
+
+typedef struct {
+    _Atomic(mw_page_table_t *) table;
+    atomic_uint epoch;              /* bumped after every table swap */
+    atomic_uint readers[2];         /* inside mw_page_index_get(), by epoch parity */
+    size_t live;                    /* writer-side only */
+    size_t used;                    /* live + tombstones, writer-side only */
+    atomic_size_t grow_count;
+} mw_page_index_t;
+
+/**
+ * Initialize an index with room for at least initial_capacity pages
+ *
+ * Returns: 0 on success, -1 on allocation failure
+ */
+int mw_page_index_init(mw_page_index_t *idx, size_t initial_capacity);
+
+/**
+ * Free the table
+ *
+ * Caller must guarantee no reader is still inside mw_page_index_get().
+ */
+void mw_page_index_destroy(mw_page_index_t *idx);
+
+/**
+ * Look up a page (lock-free, async-signal-safe)
+ *
+ * Returns: value stored for page_start, or NULL if the page is not indexed
+ */
+void *mw_page_index_get(const mw_page_index_t *idx, uintptr_t page_start);
+
+/**
+ * Quick membership test for the signal handler
+ */
+static inline int mw_page_index_contains(const mw_page_index_t *idx, uintptr_t page_start) {
+    return mw_page_index_get(idx, page_start) != NULL;
+}
+
+/**
+ * Insert or replace a page (writers must be serialized by the caller)
+ *
+ * A rebuild (growth, or a table mostly made of tombstones) waits for the
+ * readers still on the old table before freeing it, so this must not be
+ * called from a signal handler that may have interrupted a reader.
+ *
+ * Returns: 0 on success, -1 on allocation failure
+ */
+int mw_page_index_put(mw_page_index_t *idx, uintptr_t page_start, void *value);
+
+/**
+ * Remove a page (writers must be serialized by the caller)
+ *
+ * The slot becomes a tombstone and is reclaimed by the next rebuild.
+ *
+ * Returns: the removed value, or NULL if the page was not indexed
+ */
+void *mw_page_index_remove(mw_page_index_t *idx, uintptr_t page_start);
+
+/**
+ * Visit every live entry (writer-side, caller holds the writer lock)
+ */
+void mw_page_index_for_each(mw_page_index_t *idx,
+                            void (*fn)(uintptr_t page_start, void *value, void *ctx),
+                            void *ctx);
+
+/**
+ * Number of live pages
+ */
+size_t mw_page_index_count(const mw_page_index_t *idx);
+
+/**
+ * Bytes held by the table
+ */
+size_t mw_page_index_memory_bytes(const mw_page_index_t *idx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEMWATCH_PAGE_INDEX_H */
@@ -0,0 +1,148 @@
+/*
+ * memwatch_sqlite_sink.h - Batched, asynchronous SQLite writer for events
+ *
+ * - mw_sink_open(): open a database in WAL mode (synchronous=NORMAL),
+ *   create its schema and start the writer thread
+ * - mw_sink_prepare(): register an INSERT once; the writer keeps the
+ *   prepared statement for the life of the sink
+ * - mw_sink_write(): queue one row (values are copied) and return
+ * - mw_sink_flush() / mw_sink_close(): wait until queued rows are stored
+ *
+ * Rows go into one half of a double buffer while the writer thread stores
+ * the other half in a single transaction, binding each row to its cached
+ * statement, so capture threads never touch SQLite. When the filling half
+ * runs out of space a producer waits for the writer to swap (or the row is
+ * dropped, with drop_when_full); both are counted in mw_sink_stats_t.
+ *
+ * The sink only calls sqlite3_prepare_v3() and the step/bind family, never
+ * sqlite3_exec() or sqlite3_prepare_v2(), so it is not seen by the SQL
+ * hooks of libmemwatch.so. Used by memwatch_tracker and the memwatch CLIs.
+ */
+
+#ifndef MEMWATCH_SQLITE_SINK_H
+#define MEMWATCH_SQLITE_SINK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MW_SINK_MAX_STATEMENTS 16
+#define MW_SINK_MAX_COLUMNS    32
+
+typedef struct mw_sink mw_sink_t;
+struct sqlite3;
+
+typedef enum {
+    MW_SINK_NULL = 0,
+    MW_SINK_INT,
+    MW_SINK_REAL,
+    MW_SINK_TEXT,
+    MW_SINK_BLOB,
+} mw_sink_type_t;
+
+/**
+ * One bound value; text and blobs are copied by mw_sink_write()
+ */
+typedef struct {
+    mw_sink_type_t type;
+    int64_t i;
+    double d;
+    const void *data;
+    int len;                      /* bytes of data; -1 = NUL-terminated text */
+} mw_sink_value_t;
+
+#define MW_SINK_I64(v)      ((mw_sink_value_t){ .type = MW_SINK_INT, .i = (int64_t)(v) })
+#define MW_SINK_F64(v)      ((mw_sink_value_t){ .type = MW_SINK_REAL, .d = (double)(v) })
+#define MW_SINK_STR(s)      mw_sink_str(s)
+#define MW_SINK_STRN(s, n)  ((mw_sink_value_t){ .type = MW_SINK_TEXT, .data = (s), .len = (int)(n) })
+#define MW_SINK_BLOBN(p, n) ((mw_sink_value_t){ .type = MW_SINK_BLOB, .data = (p), .len = (int)(n) })
+
+/* NULL binds as NULL; a function so arrays passed here don't trip -Waddress */
+static inline mw_sink_value_t mw_sink_str(const char *s) {
+    return (mw_sink_value_t){ .type = s ? MW_SINK_TEXT : MW_SINK_NULL, .data = s, .len = -1 };
+}
+
+typedef struct {
+    size_t buffer_bytes;          /* Size of each queue half (default 1 MB) */
+    int flush_interval_ms;        /* Longest a row waits for its commit (default 100) */
+    int drop_when_full;           /* Drop rows instead of waiting for the writer */
+    void (*writer_init)(void);    /* Called first on the writer thread (optional) */
+} mw_sink_config_t;
+
+typedef struct {
+    uint64_t rows_queued;
+    uint64_t rows_written;        /* Committed */
+    uint64_t rows_dropped;        /* Queue full with drop_when_full, or too large */
+    uint64_t rows_failed;         /* Rejected by SQLite, or lost with a failed commit */
+    uint64_t batches;             /* Transactions committed */
+    uint64_t max_batch_rows;
+    uint64_t waits;               /* Producers that found the queue full */
+    uint64_t wait_ns;             /* Time they spent waiting for the writer */
+    uint64_t commit_ns;           /* Writer time spent storing batches */
+    size_t max_queued_bytes;      /* High-water mark of the filling half */
+} mw_sink_stats_t;
+
+/**
+ * Open (or create) a database and start its writer thread
+ *
+ * Args:
+ *   path: database file
+ *   schema: SQL run once before any row (CREATE TABLE IF NOT EXISTS ...),
+ *           may be NULL
+ *   config: NULL for defaults
+ *
+ * Returns: the sink, or NULL with errno set (EIO if SQLite failed; the
+ *          message is printed to stderr)
+ */
+mw_sink_t *mw_sink_open(const char *path, const char *schema, const mw_sink_config_t *config);
+
+/**
+ * Prepare a statement for mw_sink_write()
+ *
+ * Returns: statement id (>= 0), or -1 if SQLite rejects it or the table
+ *          of statements is full
+ */
+int mw_sink_prepare(mw_sink_t *sink, const char *sql);
+
+/**
+ * Queue one row for statement stmt; values bind to ?1..?n in order
+ *
+ * Returns: 0 when queued, -1 if it was dropped (queue full with
+ *          drop_when_full, or the row is larger than a queue half) or the
+ *          arguments are invalid
+ */
+int mw_sink_write(mw_sink_t *sink, int stmt, const mw_sink_value_t *values, int count);
+
+/**
+ * Wait until every row queued so far is committed (or has failed)
+ *
+ * Returns: 0, or -1 if any row has failed since the sink was opened
+ */
+int mw_sink_flush(mw_sink_t *sink);
+
+/**
+ * The connection, for reads such as SELECT COUNT(*)
+ *
+ * Note: SQLite serializes it with the writer; call mw_sink_flush() first
+ *       to see every row queued so far.
+ */
+struct sqlite3 *mw_sink_db(mw_sink_t *sink);
+
+/**
+ * Copy the counters (approximate while rows are queued)
+ */
+void mw_sink_stats(mw_sink_t *sink, mw_sink_stats_t *stats);
+
+/**
+ * Store every queued row, stop the writer and close the database
+ */
+void mw_sink_close(mw_sink_t *sink);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEMWATCH_SQLITE_SINK_H */
@@ -0,0 +1,251 @@
+/*
+ * memwatch_stats.h - Live stats page: stage latencies and hot regions/pages
+ *
+ * - mw_stats_open(): tracer side, once per engine; with a name the page is
+ *   the POSIX shared memory object /memwatch-stats-<name>, otherwise a
+ *   private mapping only get_stats() reads
+ * - mw_stats_record(): one latency sample for a pipeline stage, into the
+ *   calling thread's shard (async-signal-safe)
+ * - mw_stats_count_region() / mw_stats_count_page(): per-region and
+ *   per-page counters, from the worker
+ * - mw_stats_publish(): gauges the engine keeps elsewhere (ring fill,
+ *   memory, the overhead governor), refreshed by the worker between passes
+ * - mw_stats_attach(): reader side, a read-only mapping (memwatch top,
+ *   memwatch metrics); readers never take a lock or signal the tracer
+ *
+ * Histograms are log-linear: exact below 2 * MW_STATS_HIST_SUB, then
+ * MW_STATS_HIST_SUB buckets per power of two (12.5% wide), up to 2^40 ns.
+ * A thread claims its own shard on its first sample, so samples are
+ * uncontended adds; past MW_STATS_SHARDS threads they share shards.
+ * Region and page slots are claimed by the worker alone.
+ *
+ * Layout (little endian, offsets in bytes; also in the header):
+ *   0              mw_stats_header_t (MW_STATS_HEADER_SIZE bytes)
+ *   shards_offset  shard_count x mw_stats_shard_t
+ *   regions_offset region_slots x mw_stats_region_t
+ *   pages_offset   page_slots x mw_stats_page_t
+ */
+
+#ifndef MEMWATCH_STATS_H
+#define MEMWATCH_STATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MW_STATS_MAGIC         0x3154415453574dULL   /* "MWSTAT1" */
+#define MW_STATS_VERSION       2
+#define MW_STATS_HEADER_SIZE   4096
+#define MW_STATS_SHARDS        16
+#define MW_STATS_REGIONS       4096                  /* power of two */
+#define MW_STATS_PAGES         4096                  /* power of two */
+#define MW_STATS_HIST_SUB_BITS 3
+#define MW_STATS_HIST_SUB      (1u << MW_STATS_HIST_SUB_BITS)
+#define MW_STATS_HIST_MAX_BITS 40                    /* samples clamp at 2^40 ns */
+#define MW_STATS_HIST_BUCKETS  ((MW_STATS_HIST_MAX_BITS - MW_STATS_HIST_SUB_BITS + 1) * MW_STATS_HIST_SUB)
+#define MW_STATS_NAME_LEN      40
+
+/* Pipeline stages, in the order an event passes them */
+typedef enum {
+    MW_STAGE_ENQUEUE = 0,    /* fault taken (signal, uffd read) -> queued, page released */
+    MW_STAGE_QUEUE_WAIT,     /* in a fault ring -> drained by the worker */
+    MW_STAGE_DIFF,           /* rehash / diff of one region */
+    MW_STAGE_CALLBACK,       /* one callback call (includes what it does) */
+    MW_STAGE_STORAGE,        /* one event written out by the embedder */
+    MW_STAGE_COUNT
+} mw_stage_t;
+
+typedef struct {
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+    uint64_t buckets[MW_STATS_HIST_BUCKETS];
+} mw_stats_hist_t;
+
+typedef struct {
+    int32_t owner_tid;                   /* 0 = unclaimed */
+    uint32_t pad0;
+    uint8_t pad1[56];
+    mw_stats_hist_t stages[MW_STAGE_COUNT];
+} __attribute__((aligned(64))) mw_stats_shard_t;
+
+/* A region seen by the worker; region_id 0 = free, UINT32_MAX = forgotten */
+typedef struct {
+    uint32_t region_id;
+    uint32_t adapter_id;
+    uint64_t addr;
+    uint64_t size;
+    uint64_t faults;                     /* writable windows closed on its pages */
+    uint64_t false_faults;               /* ... where its bytes had not changed */
+    uint64_t changes;
+    uint64_t bytes_diffed;
+    char name[MW_STATS_NAME_LEN];
+    uint32_t level;                      /* governor level (memwatch_governor.h), 0 = full */
+    uint32_t pad;
+} mw_stats_region_t;
+
+/* A faulting page; page 0 = free */
+typedef struct {
+    uint64_t page;
+    uint64_t faults;                     /* every fault, before coalescing */
+    uint64_t changes;
+    uint64_t pad;
+} mw_stats_page_t;
+
+/* Totals kept by the stats page itself, and gauges from mw_stats_publish() */
+typedef struct {
+    uint64_t faults;
+    uint64_t false_faults;
+    uint64_t changes;
+    uint64_t bytes_diffed;
+    uint64_t tracked_regions;
+    uint64_t tracked_pages;
+    uint64_t ring_used;
+    uint64_t ring_capacity;
+    uint64_t dropped_events;
+    uint64_t coalesced_faults;
+    uint64_t native_memory_bytes;
+    uint64_t worker_wakeups;
+    uint64_t governor_budget_ppm;        /* of one CPU; 0 = governor off */
+    uint64_t governor_overhead_ppm;      /* tracing cost over the last interval */
+    uint64_t governor_demoted;           /* regions below full */
+    uint64_t governor_demotions;
+    uint64_t governor_promotions;
+} mw_stats_counters_t;
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t pid;
+    uint32_t closed;                     /* set once the tracer shut down */
+    uint64_t started_unix_ns;
+    uint64_t updated_unix_ns;            /* last mw_stats_publish() */
+    char engine[16];                     /* "memwatch", "minimal" */
+    char backend[16];
+
+    uint32_t hist_sub_bits;
+    uint32_t hist_buckets;
+    uint32_t stage_count;
+    uint32_t shard_count;
+    uint32_t region_slots;
+    uint32_t page_slots;
+    uint32_t shard_size;
+    uint32_t region_size;
+    uint32_t page_size;
+    uint32_t pad0;
+    uint64_t shards_offset;
+    uint64_t regions_offset;
+    uint64_t pages_offset;
+    uint64_t region_overflow;            /* regions that found no free slot */
+    uint64_t page_overflow;
+
+    mw_stats_counters_t counters;
+} mw_stats_header_t;
+
+typedef struct mw_stats {
+    mw_stats_header_t *hdr;              /* NULL: stats off, every call is a no-op */
+    mw_stats_shard_t *shards;
+    mw_stats_region_t *regions;
+    mw_stats_page_t *pages;
+    size_t map_size;
+    bool owner;
+    bool shared;                         /* hdr lives in /dev/shm */
+    char name[64];                       /* "/memwatch-stats-<name>" */
+} mw_stats_t;
+
+/**
+ * Create a stats page for this process's tracer
+ *
+ * Args:
+ *   name: publish as /memwatch-stats-<name> ([A-Za-z0-9_.-], at most 40
+ *         bytes), or NULL for a private page
+ *   engine, backend: shown by readers
+ *
+ * Returns: 0 on success, -1 with errno set (EEXIST if the name is taken
+ *          by a live tracer)
+ */
+int mw_stats_open(mw_stats_t *stats, const char *name, const char *engine, const char *backend);
+
+/**
+ * Mark the page closed and unlink it; attached readers keep their mapping
+ */
+void mw_stats_close(mw_stats_t *stats);
+
+/**
+ * One latency sample - ASYNC-SIGNAL-SAFE
+ */
+void mw_stats_record(mw_stats_t *stats, mw_stage_t stage, uint64_t ns);
+
+/**
+ * One region check after a writable window (worker only)
+ *
+ * Args:
+ *   changed: the region's bytes differed; otherwise a false fault
+ *   bytes_diffed: bytes hashed or compared for this check
+ *   name: copied when the region first gets a slot; may be NULL
+ */
+void mw_stats_count_region(mw_stats_t *stats, uint32_t region_id, uint32_t adapter_id,
+                           uint64_t addr, uint64_t size, const char *name,
+                           bool changed, uint64_t bytes_diffed);
+
+/**
+ * A governor decision moved a region to level; regions without a slot
+ * (never checked) are skipped
+ */
+void mw_stats_region_level(mw_stats_t *stats, uint32_t region_id, uint32_t level);
+
+/**
+ * Drop a region's slot, e.g. when its id is about to be reused
+ */
+void mw_stats_forget_region(mw_stats_t *stats, uint32_t region_id);
+
+/**
+ * Faults and changes on one page (worker only)
+ */
+void mw_stats_count_page(mw_stats_t *stats, uint64_t page, uint64_t faults, uint64_t changes);
+
+/**
+ * Refresh the gauges in counters; faults, false_faults, changes and
+ * bytes_diffed are kept by the page and ignored here
+ */
+void mw_stats_publish(mw_stats_t *stats, const mw_stats_counters_t *gauges);
+
+/**
+ * Map a tracer's stats page read-only
+ *
+ * Returns: 0 on success, -1 with errno set (ENOENT if no such page,
+ *          EPROTO if it is not a stats page of this version)
+ */
+int mw_stats_attach(mw_stats_t *stats, const char *name);
+
+/**
+ * Unmap a page opened with mw_stats_attach()
+ */
+void mw_stats_detach(mw_stats_t *stats);
+
+/**
+ * Sum one stage over every shard
+ */
+void mw_stats_hist(const mw_stats_t *stats, mw_stage_t stage, mw_stats_hist_t *out);
+
+/**
+ * Value at percentile pct (0-100): the top of its bucket, at most
+ * max_ns; 0 for an empty histogram
+ */
+uint64_t mw_stats_hist_percentile(const mw_stats_hist_t *hist, double pct);
+
+/**
+ * "enqueue", "queue_wait", "diff", "callback", "storage"
+ */
+const char *mw_stats_stage_name(mw_stage_t stage);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEMWATCH_STATS_H */
@@ -0,0 +1,92 @@
+/*
+ * memwatch_timer_wheel.h - Hashed timer wheel for page re-protection
+ *
+ * Every fault opens a short writable window on its page. Instead of
+ * sleeping per page, the worker schedules the window's end on this wheel
+ * and expires every due page in one pass, so thousands of windows cost a
+ * single wakeup.
+ *
+ * - Fixed tick (e.g. 1 ms) and a power-of-two number of slots
+ * - Deadlines are rounded up to the next tick, so an entry never fires
+ *   early; deadlines beyond one rotation simply stay in their slot until due
+ * - Entries carry a fixed-size payload copied in at schedule time
+ * - Single-threaded: owned by the worker, no locking
+ */
+
+#ifndef MEMWATCH_TIMER_WHEEL_H
+#define MEMWATCH_TIMER_WHEEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint8_t *entries;   /* deadline_ns followed by payload, entry_size each */
+    size_t count;
+    size_t capacity;
+} mw_timer_slot_t;
+
+typedef struct {
+    uint64_t tick_ns;
+    size_t nslots;      /* power of two */
+    size_t mask;
+    size_t payload_size;
+    size_t entry_size;
+    uint64_t next_tick; /* first tick not yet expired */
+    size_t pending;
+    mw_timer_slot_t *slots;
+} mw_timer_wheel_t;
+
+/* Called once per expired entry; must not schedule onto the same wheel */
+typedef void (*mw_timer_fire_fn)(void *payload, void *ctx);
+
+/**
+ * Initialize a wheel
+ *
+ * Args:
+ *   tick_ns: Resolution of the wheel
+ *   nslots: Number of slots (rounded up to a power of two)
+ *   payload_size: Bytes copied per scheduled entry
+ *   now_ns: Current monotonic time
+ *
+ * Returns: 0 on success, -1 on allocation failure
+ */
+int mw_timer_wheel_init(mw_timer_wheel_t *w, uint64_t tick_ns, size_t nslots,
+                        size_t payload_size, uint64_t now_ns);
+
+void mw_timer_wheel_destroy(mw_timer_wheel_t *w);
+
+/**
+ * Schedule payload to fire at or after deadline_ns
+ *
+ * Returns: 0 on success, -1 on allocation failure
+ */
+int mw_timer_wheel_schedule(mw_timer_wheel_t *w, uint64_t deadline_ns, const void *payload);
+
+/**
+ * Fire every entry whose deadline is <= now_ns
+ *
+ * Returns: number of entries fired
+ */
+size_t mw_timer_wheel_advance(mw_timer_wheel_t *w, uint64_t now_ns,
+                              mw_timer_fire_fn fire, void *ctx);
+
+/**
+ * Time until the next occupied tick (a wakeup hint, may be early)
+ *
+ * Returns: nanoseconds from now_ns (0 if already due), or -1 if empty
+ */
+int64_t mw_timer_wheel_next_ns(const mw_timer_wheel_t *w, uint64_t now_ns);
+
+static inline size_t mw_timer_wheel_pending(const mw_timer_wheel_t *w) {
+    return w->pending;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEMWATCH_TIMER_WHEEL_H */
@@ -0,0 +1,188 @@
+/*
+ * memwatch_trace.h - Keyframe + delta trace index for time travel
+ *
+ * - mw_trace_writer_open(): record region changes into a FastStorage store
+ * - mw_trace_add_region() / mw_trace_record(): the initial bytes of a
+ *   region, then each write to it with its timestamp
+ * - mw_trace_open() / mw_trace_state_at(): reconstruct a region as it was
+ *   at any time
+ * - mw_trace_seek() / mw_trace_step_forward() / mw_trace_step_back():
+ *   walk a region's history one change at a time
+ *
+ * Each region's changes are cut into segments of at most keyframe_interval
+ * deltas (fewer when the deltas add up to the region's size), and a full
+ * keyframe of the region is stored before every segment. A small index of
+ * segment start times sits on top, so mw_trace_state_at() is a binary
+ * search, one keyframe copy and at most keyframe_interval delta
+ * applications, whatever the length of the trace. Deltas keep the bytes
+ * they replaced as well, which makes stepping back as cheap as stepping
+ * forward.
+ *
+ * Keys, per region id N (all values little endian):
+ *   trace.regions    uint32 ids of every region
+ *   trace.N.meta     trace_meta_t
+ *   trace.N.kS       keyframe: the region before segment S
+ *   trace.N.dS       delta block of segment S
+ *   trace.N.iC       index chunk C: segments C * 2048 ... C * 2048 + 2047
+ *
+ * Readers see the trace as of the writer's last mw_trace_writer_flush().
+ */
+
+#ifndef MEMWATCH_TRACE_H
+#define MEMWATCH_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "faststorage_fast.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MW_TRACE_DEFAULT_INTERVAL 256
+#define MW_TRACE_NAME_MAX         64
+
+typedef struct mw_trace_writer mw_trace_writer_t;
+typedef struct mw_trace mw_trace_t;
+typedef struct mw_trace_cursor mw_trace_cursor_t;
+
+typedef struct {
+    uint64_t events;              /* deltas recorded */
+    uint64_t skipped;             /* writes that changed nothing */
+    uint64_t segments;            /* segments sealed */
+    uint64_t keyframe_bytes;
+    uint64_t delta_bytes;
+} mw_trace_stats_t;
+
+typedef struct {
+    uint32_t id;
+    uint64_t size;
+    uint64_t events;
+    uint64_t created_ns;          /* timestamp of the initial bytes */
+    uint64_t first_ns;            /* first and last change, 0 if none */
+    uint64_t last_ns;
+    uint32_t keyframe_interval;
+    char name[MW_TRACE_NAME_MAX];
+} mw_trace_region_t;
+
+typedef struct {
+    uint64_t seq;                 /* changes applied: 0 = initial bytes */
+    uint64_t timestamp_ns;        /* of the last change applied, or created_ns */
+    uint32_t change_offset;       /* bytes the last seek or step touched */
+    uint32_t change_len;          /* 0 if it touched none */
+} mw_trace_position_t;
+
+/* ============================================================================
+ * Recording
+ * ============================================================================ */
+
+/**
+ * Start recording into fs (which must stay open until the writer is closed)
+ *
+ * Args:
+ *   keyframe_interval: most deltas between two keyframes (0 = default)
+ *
+ * Returns: writer, or NULL with errno set
+ */
+mw_trace_writer_t *mw_trace_writer_open(FastStorage *fs, uint32_t keyframe_interval);
+
+/**
+ * Add a region and store its initial bytes as its first keyframe
+ *
+ * Returns: 0 on success, -1 with errno set (EEXIST if the id is taken)
+ */
+int mw_trace_add_region(mw_trace_writer_t *w, uint32_t region_id, const char *name,
+                        const void *initial, size_t size, uint64_t timestamp_ns);
+
+/**
+ * Record that len bytes at offset now hold data
+ *
+ * Unchanged leading and trailing bytes are trimmed off, and a write that
+ * changes nothing is not recorded. Timestamps earlier than the region's
+ * last change are taken as that change's. Thread-safe.
+ *
+ * Returns: 0 on success, -1 with errno set (ENOENT for an unknown region,
+ *          EINVAL if the write is outside it)
+ */
+int mw_trace_record(mw_trace_writer_t *w, uint32_t region_id, uint64_t timestamp_ns,
+                    size_t offset, const void *data, size_t len);
+
+/**
+ * Store everything recorded so far, including partly filled segments
+ *
+ * Returns: 0 on success, -1 if the store rejected a write
+ */
+int mw_trace_writer_flush(mw_trace_writer_t *w);
+
+void mw_trace_writer_stats(mw_trace_writer_t *w, mw_trace_stats_t *out);
+
+/**
+ * Flush and free the writer (the store stays open)
+ */
+void mw_trace_writer_close(mw_trace_writer_t *w);
+
+/* ============================================================================
+ * Reconstruction
+ * ============================================================================ */
+
+/**
+ * Open the trace held in fs; the handle is safe to share between threads
+ *
+ * Returns: handle, or NULL with errno set (ENOENT if fs holds no trace)
+ */
+mw_trace_t *mw_trace_open(FastStorage *fs);
+
+/**
+ * Copy up to max regions into out
+ *
+ * Returns: number of regions in the trace (may exceed max)
+ */
+int mw_trace_regions(mw_trace_t *t, mw_trace_region_t *out, int max);
+
+/**
+ * Rebuild a region as it was at timestamp_ns: after every change stamped
+ * at or before it
+ *
+ * Args:
+ *   buf: receives the region; len must be at least its size
+ *
+ * Returns: number of deltas applied on top of the keyframe, or -1 with
+ *          errno set (ENOENT, EINVAL if buf is too small, EIO if the
+ *          store is missing a key)
+ */
+int mw_trace_state_at(mw_trace_t *t, uint32_t region_id, uint64_t timestamp_ns,
+                      void *buf, size_t len);
+
+/**
+ * Position a cursor on a region at timestamp_ns (0 = its initial bytes)
+ *
+ * Returns: cursor, or NULL with errno set
+ */
+mw_trace_cursor_t *mw_trace_seek(mw_trace_t *t, uint32_t region_id, uint64_t timestamp_ns);
+
+/**
+ * Apply the next change, or undo the last one
+ *
+ * Returns: 1 if the cursor moved, 0 at the end (start) of the trace, -1
+ *          with errno set
+ */
+int mw_trace_step_forward(mw_trace_cursor_t *c);
+int mw_trace_step_back(mw_trace_cursor_t *c);
+
+/**
+ * The region at the cursor; valid until the cursor moves or is freed
+ */
+const uint8_t *mw_trace_cursor_state(mw_trace_cursor_t *c, size_t *len);
+
+void mw_trace_cursor_position(mw_trace_cursor_t *c, mw_trace_position_t *out);
+
+void mw_trace_cursor_free(mw_trace_cursor_t *c);
+
+void mw_trace_close(mw_trace_t *t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEMWATCH_TRACE_H */
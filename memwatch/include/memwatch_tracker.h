@@ -9,6 +9,8 @@
 #include <stddef.h>
 #include <stdbool.h>
 
+#include "memwatch_sqlite_sink.h"
+
 /**
  * Initialize memory tracking system
  * 
@@ -30,10 +32,21 @@ int tracker_init(const char *db_path, bool track_all, bool track_sql, bool track
  * @param address Memory address to start tracking
  * @param size Size of region in bytes
  * @param name Human-readable name (e.g., "my_buffer")
- * @return Region ID on success, -1 on failure
+ * @return Region ID (>= 0, reused after tracker_unwatch) on success, -1 on failure
  */
 int tracker_watch(uint64_t address, size_t size, const char *name);
 
+/**
+ * Nonzero while the calling thread belongs to the tracker: its monitor
+ * thread (TRACKER_BUSY_THREAD) or an allocation hook calling into it
+ * (TRACKER_BUSY_HOOK - the hook may run inside stdio, so the tracker does
+ * not print then). Hooks check it so the tracker's own allocations are
+ * never auto-tracked.
+ */
+#define TRACKER_BUSY_THREAD 1
+#define TRACKER_BUSY_HOOK 2
+extern __thread int tracker_busy;
+
 /**
  * Stop tracking a memory region
  * 
@@ -56,6 +69,35 @@ void tracker_close(void);
  */
 int tracker_get_event_count(void);
 
+/**
+ * Monitor thread counters
+ */
+typedef struct {
+    uint64_t sweeps;              /* Passes over every tracked region */
+    uint64_t last_sweep_ns;       /* Duration of the latest sweep */
+    uint64_t max_sweep_ns;
+    uint64_t overruns;            /* Sweeps longer than the sampling interval */
+    uint64_t bytes_compared;      /* Snapshot bytes diffed against live memory */
+    uint64_t changes;             /* Changed 8-byte words found */
+    int scan_threads;             /* Scan pool size, monitor thread included */
+    const char *diff_kernel;      /* Comparison kernel in use */
+} tracker_scan_stats_t;
+
+/**
+ * Get monitor thread counters (approximate while sampling runs)
+ *
+ * @param stats Receives the counters
+ */
+void tracker_get_scan_stats(tracker_scan_stats_t *stats);
+
+/**
+ * Get the SQLite sink counters: rows queued, committed and dropped,
+ * batches, and how long capture waited on the writer thread
+ *
+ * @param stats Receives the counters (zeroed if no database is open)
+ */
+void tracker_get_sink_stats(mw_sink_stats_t *stats);
+
 /**
  * Log a SQL query for tracking
  * 
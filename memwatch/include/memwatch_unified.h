@@ -55,9 +55,27 @@ typedef struct {
     const void *user_data;
 } memwatch_change_event_t;
 
+/* One region for memwatch_watch_batch() */
+typedef struct {
+    uint64_t addr;
+    size_t size;
+    const char *name;        /* kept by reference, like memwatch_watch() */
+    void *user_data;
+} memwatch_watch_spec_t;
+
 /* Callback function signature - same for all languages */
 typedef void (*memwatch_callback_t)(const memwatch_change_event_t *event, void *user_ctx);
 
+/*
+ * CLI plugins (memwatch run --user-lib foo.so) export a memwatch_callback_t
+ * under MEMWATCH_PLUGIN_CALLBACK, called in process for every event. They
+ * may also export void *MEMWATCH_PLUGIN_INIT(void), whose result is passed
+ * as user_ctx, and void MEMWATCH_PLUGIN_FINI(void *user_ctx).
+ */
+#define MEMWATCH_PLUGIN_CALLBACK "memwatch_callback"
+#define MEMWATCH_PLUGIN_INIT     "memwatch_plugin_init"
+#define MEMWATCH_PLUGIN_FINI     "memwatch_plugin_fini"
+
 /* ============================================================================
  * Core API - Unified for All Languages
  * ============================================================================ */
@@ -72,6 +90,23 @@ typedef void (*memwatch_callback_t)(const memwatch_change_event_t *event, void *
  */
 int memwatch_init(void);
 
+/**
+ * Initialize memwatch with an explicit write-detection backend
+ * 
+ * backend: "mprotect", "uffd" or "soft-dirty"; NULL reads
+ * $MEMWATCH_BACKEND and falls back to mprotect. Only mprotect installs
+ * a SIGSEGV handler. memwatch_init() is memwatch_init_backend(NULL).
+ * 
+ * Returns: 0 on success, MEMWATCH_ERR_BACKEND if the name is unknown or
+ *          the kernel lacks the feature, other negative values on error
+ */
+int memwatch_init_backend(const char *backend);
+
+/**
+ * Name of the active backend ("mprotect", "uffd-wp", "soft-dirty")
+ */
+const char *memwatch_backend(void);
+
 /**
  * Shutdown memwatch and release all resources
  * 
@@ -94,6 +129,23 @@ void memwatch_shutdown(void);
 memwatch_region_id memwatch_watch(uint64_t addr, size_t size, 
                                   const char *name, void *user_data);
 
+/**
+ * Watch many regions at once
+ * 
+ * Takes the region lock once and protects each run of adjacent pages with
+ * a single call, so registering thousands of globals at startup costs
+ * about as much as registering one.
+ * 
+ * Args:
+ *   specs: Regions to watch, in any order
+ *   count: Number of specs
+ *   out_ids: Receives one region_id per spec, 0 where a spec failed
+ * 
+ * Returns: number of regions watched, negative on error
+ */
+int memwatch_watch_batch(const memwatch_watch_spec_t *specs, size_t count,
+                         memwatch_region_id *out_ids);
+
 /**
  * Stop watching a region
  * 
@@ -156,6 +208,16 @@ typedef struct {
 
 int memwatch_get_stats(memwatch_stats_t *out_stats);
 
+/**
+ * Time a pipeline stage the embedder runs, e.g. writing an event out
+ * (MW_STAGE_STORAGE in memwatch_stats.h), into the live stats page
+ *
+ * Args:
+ *   stage: an mw_stage_t
+ *   ns: how long it took
+ */
+void memwatch_record_stage(int stage, uint64_t ns);
+
 /**
  * Free event resources
  * 
@@ -191,6 +253,7 @@ void memwatch_unregister_adapter(memwatch_adapter_id adapter_id);
 #define MEMWATCH_ERR_NO_MEMORY -3
 #define MEMWATCH_ERR_MPROTECT -4
 #define MEMWATCH_ERR_NOT_FOUND -5
+#define MEMWATCH_ERR_BACKEND -6
 
 #ifdef __cplusplus
 }  /* extern "C" */
@@ -0,0 +1,106 @@
+/*
+ * memwatch_wakeup.h - Async-signal-safe worker doorbell
+ *
+ * An eventfd the signal handler can ring and the worker can block on, so
+ * the worker sleeps only while there is nothing to do and wakes within
+ * microseconds of the first fault.
+ *
+ * The "sleeping" flag keeps the fast path syscall-free: a producer only
+ * writes to the eventfd when the worker has announced it is about to
+ * block. Both sides use a seq_cst fence between publishing their own
+ * state and reading the other's, so a wakeup can never be lost:
+ *
+ *   worker:   mw_wakeup_prepare();  if (work) mw_wakeup_cancel();
+ *                                   else mw_wakeup_wait(timeout);
+ *   producer: publish event;        mw_wakeup_signal();
+ */
+
+#ifndef MEMWATCH_WAKEUP_H
+#define MEMWATCH_WAKEUP_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+typedef struct {
+    int fd;
+    atomic_int sleeping;
+    atomic_size_t wakeups;  /* eventfd writes actually issued */
+} mw_wakeup_t;
+
+/**
+ * Create the eventfd
+ *
+ * Returns: 0 on success, -1 on failure (errno set)
+ */
+static inline int mw_wakeup_init(mw_wakeup_t *w) {
+    w->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    atomic_store(&w->sleeping, 0);
+    atomic_store(&w->wakeups, 0);
+    return w->fd < 0 ? -1 : 0;
+}
+
+static inline void mw_wakeup_destroy(mw_wakeup_t *w) {
+    if (w->fd >= 0) {
+        close(w->fd);
+    }
+    w->fd = -1;
+}
+
+/* Unconditionally wake the worker (shutdown, configuration changes) */
+static inline void mw_wakeup_notify(mw_wakeup_t *w) {
+    uint64_t one = 1;
+    int saved_errno = errno;
+    ssize_t r = write(w->fd, &one, sizeof(one));
+    (void)r;  /* EAGAIN means the counter is already non-zero */
+    atomic_fetch_add_explicit(&w->wakeups, 1, memory_order_relaxed);
+    errno = saved_errno;
+}
+
+/**
+ * Wake the worker if it is (about to be) blocked - ASYNC-SIGNAL-SAFE
+ *
+ * Call after the event has been published.
+ */
+static inline void mw_wakeup_signal(mw_wakeup_t *w) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&w->sleeping, memory_order_relaxed) &&
+        atomic_exchange(&w->sleeping, 0)) {
+        mw_wakeup_notify(w);
+    }
+}
+
+/* Worker: announce intent to block, then re-check for work */
+static inline void mw_wakeup_prepare(mw_wakeup_t *w) {
+    atomic_store(&w->sleeping, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+/* Worker: found work after prepare, do not block */
+static inline void mw_wakeup_cancel(mw_wakeup_t *w) {
+    atomic_store(&w->sleeping, 0);
+}
+
+/**
+ * Worker: block until signalled or timeout_ms elapses (-1 = forever)
+ *
+ * Returns: 1 if woken by a producer, 0 on timeout
+ */
+static inline int mw_wakeup_wait(mw_wakeup_t *w, int timeout_ms) {
+    struct pollfd pfd = { .fd = w->fd, .events = POLLIN, .revents = 0 };
+    int r = poll(&pfd, 1, timeout_ms);
+    atomic_store(&w->sleeping, 0);
+
+    if (r > 0 && (pfd.revents & POLLIN)) {
+        uint64_t count;
+        ssize_t n = read(w->fd, &count, sizeof(count));
+        (void)n;
+        return 1;
+    }
+    return 0;
+}
+
+#endif /* MEMWATCH_WAKEUP_H */
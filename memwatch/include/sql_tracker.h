@@ -13,12 +13,10 @@
 extern "C" {
 #endif
 
-#define MAX_TABLE_NAME 256
+#define MAX_TABLE_NAME 256                  // Longer identifiers are truncated
 #define MAX_COLUMN_NAME 256
-#define MAX_VALUE_LENGTH 1024
-#define MAX_QUERY_LENGTH 4096
 #define MAX_DATABASE_NAME 256
-#define MAX_CHANGES 10000
+#define MAX_CHANGES 10000                   // Default capacity for sql_tracker_init()
 
 /**
  * SQL operation types
@@ -31,31 +29,127 @@ typedef enum {
     SQL_SELECT = 4
 } SQLOperation;
 
+/**
+ * What happens once max_changes are stored
+ */
+typedef enum {
+    SQL_RETAIN_FIRST = 0,                   // Keep the first max_changes, ignore later ones
+    SQL_RETAIN_LATEST = 1                   // Retention ring: drop the oldest to make room
+} SQLRetention;
+
 /**
  * Single column change from SQL operation
+ *
+ * A view of one stored change. The strings point into the tracker and
+ * stay valid until the change leaves the retention ring or the tracker
+ * is freed; missing optional values are "".
  */
 typedef struct {
     uint64_t timestamp_ns;                  // Nanosecond timestamp
-    char table_name[MAX_TABLE_NAME];        // Table affected
-    char column_name[MAX_COLUMN_NAME];      // Column affected
+    const char *table_name;                 // Table affected
+    const char *column_name;                // Column affected
     SQLOperation operation;                 // INSERT, UPDATE, DELETE, SELECT
-    char old_value[MAX_VALUE_LENGTH];       // Previous value (optional)
-    char new_value[MAX_VALUE_LENGTH];       // New value (optional)
+    const char *old_value;                  // Previous value (optional)
+    const char *new_value;                  // New value (optional)
     int rows_affected;                      // Number of rows affected
-    char database[MAX_DATABASE_NAME];       // Database name (optional)
-    char full_query[MAX_QUERY_LENGTH];      // Complete SQL query
+    const char *database;                   // Database name (optional)
+    const char *full_query;                 // Normalized SQL query, shared by its columns
+    uint32_t table_id;                      // Interned name IDs (0: none)
+    uint32_t column_id;
+    uint32_t database_id;
+    uint32_t old_value_len;                 // Value and query lengths in bytes
+    uint32_t new_value_len;
+    uint32_t query_len;
 } SQLChange;
 
+/**
+ * Stored change: a column of a tracked statement
+ *
+ * Everything the columns of one query share (timestamp, table, values,
+ * query text) lives once in its statement record in the arena.
+ */
+typedef struct {
+    const struct SQLStatement *stmt;
+    uint32_t column_id;
+} SQLChangeRecord;
+
+/**
+ * Interned name table: IDs index names[], 0 is the empty name
+ */
+typedef struct {
+    struct SQLName *names;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t *slots;                        // Open-addressed ID hash table
+    uint32_t num_slots;
+    struct SQLChunk *chunks;                // Name text, freed with the tracker
+} SQLNameTable;
+
+/**
+ * Parsed statement cache, keyed by fingerprint
+ */
+typedef struct {
+    struct SQLPlan *plans;                  // Allocated on first use
+    uint32_t *buckets;                      // Fingerprint hash chains
+    uint32_t num_buckets;
+    uint32_t capacity;                      // Plans kept (0: cache off)
+    uint32_t count;
+    uint32_t head;                          // Most recently used
+    uint32_t tail;                          // Next to evict
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+} SQLStatementCache;
+
+/**
+ * Secondary indexes over the change ring, built by the first query
+ */
+typedef struct {
+    struct SQLPostings *by_table;           // Indexed by table name ID
+    uint32_t num_tables;
+    struct SQLPairSlot *by_column;          // Open-addressed on (table ID, column ID)
+    uint32_t num_pairs;
+    uint32_t pair_slots;
+    struct SQLPostings *by_operation;       // Indexed by SQLOperation
+    int built;
+} SQLChangeIndex;
+
 /**
  * SQL Tracker instance
  */
 typedef struct {
-    SQLChange *changes;                     // Array of changes
+    SQLChangeRecord *changes;               // Ring of changes, oldest at head
     int change_count;                       // Current number of changes
-    int max_changes;                        // Maximum capacity
+    int max_changes;                        // Maximum capacity (0: unbounded)
     char *storage_path;                     // Optional file path for persistence
+    SQLRetention retention;
+    size_t head;
+    size_t capacity;                        // Slots allocated in changes
+    struct SQLChunk *oldest;                // Statement arena, oldest chunk first
+    struct SQLChunk *newest;
+    size_t arena_bytes;
+    uint64_t dropped;                       // Changes rotated out or refused at capacity
+    SQLNameTable names;
+    SQLStatementCache cache;
+    uint32_t first_seq;                     // Sequence number of the oldest retained change
+    int operation_counts[SQL_SELECT + 1];   // Retained changes per operation
+    SQLChangeIndex index;
+    struct SQLLog *log;                     // Change log writer (NULL: no storage_path)
+    uint64_t last_timestamp_ns;             // Newest timestamp stored
 } SQLTracker;
 
+/**
+ * Tracker configuration for sql_tracker_init_ex()
+ */
+typedef struct {
+    const char *storage_path;               // Optional change log, replayed on open
+    int max_changes;                        // Capacity (0: grow without bound)
+    SQLRetention retention;                 // Behaviour at capacity
+    int cache_entries;                      // Statement cache size (0: default, -1: off)
+    int compress_log;                       // mw_compress_mode_t: 0 raw, 1 LZ4 blocks,
+                                            // 2/3 (lite/deep) LZ4 blocks linked to the last
+} SQLTrackerConfig;
+
 /**
  * Summary statistics
  */
@@ -67,17 +161,78 @@ typedef struct {
     int select_count;
 } SQLTrackerSummary;
 
+/**
+ * Change log counters
+ */
+typedef struct {
+    uint64_t records;                       // Statements queued for the log
+    uint64_t dropped;                       // Statements lost: ring full or write failed
+    uint64_t blocks;                        // Blocks written
+    uint64_t raw_bytes;                     // Record bytes written, before compression
+    uint64_t written_bytes;                 // Bytes written, block headers included
+    uint64_t loaded;                        // Statements replayed when the log was opened
+    int error;                              // errno of the first failed write (0: none)
+    uint64_t compress_ns;                   // Writer time spent compressing blocks
+} SQLLogStats;
+
+/**
+ * Change query for sql_tracker_query(); zero fields match everything
+ */
+typedef struct {
+    const char *table;                      // Table name
+    const char *column;                     // Column name
+    SQLOperation operation;                 // SQL_UNKNOWN: any operation
+    uint64_t since_ns;                      // Changes at or after this timestamp
+    uint64_t until_ns;                      // Changes before this timestamp (0: no bound)
+} SQLChangeQuery;
+
+/**
+ * Iterator over the changes matching a query
+ *
+ * Walks an index posting list, or the ring itself, in timestamp order.
+ * Valid until the tracker next tracks a query or is freed.
+ */
+typedef struct {
+    const SQLTracker *tracker;
+    const uint32_t *seqs;                   // Posting list walked (NULL: the ring)
+    uint32_t pos;                           // Next entry
+    uint32_t end;
+    uint32_t table_id;                      // Filters the walk still checks (0: none)
+    uint32_t column_id;
+    SQLOperation operation;
+} SQLCursor;
+
 /**
  * Initialize SQL tracker
  * 
  * Args:
- *   storage_path - Optional file path to persist changes (JSONL format)
+ *   storage_path - Optional change log file, created or replayed
  * 
  * Returns:
  *   Pointer to SQLTracker, or NULL on error
  */
 SQLTracker *sql_tracker_init(const char *storage_path);
 
+/**
+ * Initialize SQL tracker with explicit capacity and retention
+ * 
+ * Args:
+ *   config - Capacity, retention and persistence settings
+ * 
+ * Returns:
+ *   Pointer to SQLTracker, or NULL on error
+ * 
+ * Note:
+ *   sql_tracker_init(path) keeps the first MAX_CHANGES changes. Nothing
+ *   is preallocated either way: memory grows with what is stored. Parsed
+ *   statements are cached by fingerprint, so repeats skip the parser.
+ *   With a storage_path, the changes it logged are loaded back and new
+ *   statements are appended by a writer thread; a log damaged by a crash
+ *   is cut back to its last intact block. Fails with EINVAL if the file
+ *   is not a change log.
+ */
+SQLTracker *sql_tracker_init_ex(const SQLTrackerConfig *config);
+
 /**
  * Track a SQL query and extract column changes
  * 
@@ -104,7 +259,7 @@ int sql_tracker_track_query(SQLTracker *tracker, const char *query, int rows_aff
 SQLTracker *sql_tracker_get_global(void);
 
 /**
- * Get summary statistics
+ * Get summary statistics (counters kept on insert, no scan)
  * 
  * Args:
  *   tracker - SQLTracker instance
@@ -126,12 +281,139 @@ void sql_tracker_summary(SQLTracker *tracker, SQLTrackerSummary *summary);
  *   Number of matching changes
  * 
  * Note:
- *   Caller must free out_changes with free()
+ *   Caller must free out_changes with free(); its strings belong to
+ *   the tracker (see SQLChange). sql_tracker_query() gives the same
+ *   matches without the copy.
  */
 int sql_tracker_get_changes(SQLTracker *tracker, const char *table_filter,
                             const char *column_filter, const char *operation_filter,
                             SQLChange **out_changes);
 
+/**
+ * Start iterating the changes matching a query
+ * 
+ * Args:
+ *   tracker - SQLTracker instance
+ *   query - Table, column, operation and time range filters
+ *   cursor - Receives the iterator
+ * 
+ * Returns:
+ *   0 on success, -1 with errno = EINVAL for a bad query
+ * 
+ * Note:
+ *   Table, (table, column) and operation filters use indexes built on
+ *   the first query and maintained on insert; time ranges are binary
+ *   searches. Nothing is copied: see sql_cursor_next().
+ */
+int sql_tracker_query(SQLTracker *tracker, const SQLChangeQuery *query, SQLCursor *cursor);
+
+/**
+ * Get the next matching change
+ * 
+ * Args:
+ *   cursor - Iterator from sql_tracker_query()
+ *   out - Receives a view of the change (see SQLChange)
+ * 
+ * Returns:
+ *   1 if a change was stored in out, 0 once the matches are exhausted
+ */
+int sql_cursor_next(SQLCursor *cursor, SQLChange *out);
+
+/**
+ * Get one change by position
+ * 
+ * Args:
+ *   tracker - SQLTracker instance
+ *   index - 0 for the oldest retained change, up to change_count - 1
+ *   out - Receives a view of the change
+ * 
+ * Returns:
+ *   0 on success, -1 if index is out of range
+ */
+int sql_tracker_get_change(SQLTracker *tracker, int index, SQLChange *out);
+
+/**
+ * Look up an interned name
+ * 
+ * Args:
+ *   tracker - SQLTracker instance
+ *   name - Table, column or database name
+ * 
+ * Returns:
+ *   Its ID, or 0 if the tracker has never seen it
+ */
+uint32_t sql_tracker_name_id(SQLTracker *tracker, const char *name);
+
+/**
+ * Get the name behind an interned ID
+ * 
+ * Returns:
+ *   The name, "" for ID 0, or NULL if the ID is unknown
+ */
+const char *sql_tracker_name(SQLTracker *tracker, uint32_t id);
+
+/**
+ * Bytes the tracker holds: change ring, statement arena, name table and
+ * statement cache
+ */
+size_t sql_tracker_memory_usage(SQLTracker *tracker);
+
+/**
+ * Get statement cache counters
+ * 
+ * Args:
+ *   tracker - SQLTracker instance
+ *   hits - Statements found already parsed (optional)
+ *   misses - Statements parsed (optional)
+ *   evictions - Plans dropped to make room (optional)
+ */
+void sql_tracker_cache_stats(SQLTracker *tracker, uint64_t *hits, uint64_t *misses, uint64_t *evictions);
+
+/**
+ * Fingerprint a statement
+ * 
+ * Returns:
+ *   A 64-bit hash that ignores literal values, parameters, keyword case,
+ *   whitespace and comments, so runs of one statement share it
+ */
+uint64_t sql_tracker_fingerprint(const char *query);
+
+/**
+ * Wait until every statement tracked so far is in the change log on disk
+ * 
+ * Args:
+ *   tracker - SQLTracker instance
+ * 
+ * Returns:
+ *   0 on success (or without a change log), -1 with errno set if a
+ *   write failed
+ */
+int sql_tracker_flush(SQLTracker *tracker);
+
+/**
+ * Get change log counters
+ * 
+ * Returns:
+ *   0 on success, -1 with errno = EINVAL without a change log
+ */
+int sql_tracker_log_stats(SQLTracker *tracker, SQLLogStats *stats);
+
+/**
+ * Convert a change log to JSON lines, one per column change
+ * 
+ * Args:
+ *   log_path - Change log written by a tracker
+ *   jsonl_path - Output file (NULL: stdout)
+ * 
+ * Returns:
+ *   Number of lines written, or -1 with errno set
+ * 
+ * Note:
+ *   Works on a log that is still being written: it stops at the last
+ *   complete block.
+ */
+long sql_tracker_export_jsonl(const char *log_path, const char *jsonl_path);
+
 /**
  * Free tracker and all allocated memory
  * 
@@ -6,10 +6,12 @@ variable names, file/line locations, old/new values, and minimal overhead.
 """
 
 from dataclasses import dataclass
-from typing import Optional, Dict, List, Callable, Any
+from typing import Optional, Dict, List, Tuple, Callable, Any, Iterable, Union
 from enum import Enum
 import sys
+import os
 import ctypes
+import struct
 
 # Import native core (will be compiled as extension module)
 try:
@@ -44,6 +46,11 @@ class ChangeEvent:
     storage_key_old: Optional[str]
     storage_key_new: Optional[str]
     metadata: Dict
+    # Large regions (>= 100 KB) only: changed (offset, length) ranges, the
+    # changed bytes back to back (new_value is not set), and the root hash
+    ranges: Optional[List[Tuple[int, int]]] = None
+    delta: Optional[bytes] = None
+    fingerprint: Optional[int] = None
     
     @classmethod
     def from_dict(cls, d: Dict) -> 'ChangeEvent':
@@ -63,10 +70,74 @@ class ChangeEvent:
             new_value=d.get('new_value'),
             storage_key_old=d.get('storage_key_old'),
             storage_key_new=d.get('storage_key_new'),
-            metadata=d.get('metadata', {})
+            metadata=d.get('metadata', {}),
+            ranges=d.get('ranges'),
+            delta=d.get('delta'),
+            fingerprint=d.get('fingerprint')
         )
 
 
+# One EventBatch record (BatchRecord in src/memwatch.c), native order, no padding
+BATCH_RECORD = struct.Struct('=IIQQIIQQQQIIQ')
+BATCH_FIELDS = ('seq', 'region_id', 'timestamp_ns', 'fault_ip', 'adapter_id', 'flags',
+                'how_big', 'value_offset', 'value_len', 'range_start', 'block_size',
+                'block_mask', 'fingerprint')
+# numpy.frombuffer(batch, dtype=BATCH_DTYPE) - or numpy.asarray(batch), zero-copy
+BATCH_DTYPE = [(name, '=u%d' % struct.calcsize(code))
+               for name, code in zip(BATCH_FIELDS, BATCH_RECORD.format.lstrip('='))]
+BATCH_FLAG_VALUE = 1   # value_offset/value_len index batch.values
+BATCH_FLAG_BLOCKS = 2  # large-region event: value holds the changed blocks
+
+
+def _block_ranges(range_start: int, block_size: int, mask: int,
+                  how_big: int) -> List[Tuple[int, int]]:
+    """Expand a record's block mask into merged (offset, length) ranges"""
+    ranges = []
+    bit = 0
+    while mask >> bit:
+        if not (mask >> bit) & 1:
+            bit += 1
+            continue
+        start = bit
+        while (mask >> bit) & 1:
+            bit += 1
+        offset = range_start + start * block_size
+        end = min(range_start + bit * block_size, how_big)
+        ranges.append((offset, end - offset))
+    return ranges
+
+
+def decode_batch(batch) -> List['ChangeEvent']:
+    """
+    Decode an EventBatch into ChangeEvent objects
+
+    This copies every value; hot paths should read the records directly
+    (struct or numpy) and slice batch.values, which does not copy.
+    """
+    values = batch.values
+    events = []
+    for record in BATCH_RECORD.iter_unpack(memoryview(batch).cast('B')):
+        r = dict(zip(BATCH_FIELDS, record))
+        d = {
+            'seq': r['seq'],
+            'timestamp_ns': r['timestamp_ns'],
+            'adapter_id': r['adapter_id'],
+            'region_id': r['region_id'],
+            'how_big': r['how_big'],
+            'where': {'fault_ip': hex(r['fault_ip'])},
+        }
+        blocks = r['flags'] & BATCH_FLAG_BLOCKS
+        if r['flags'] & BATCH_FLAG_VALUE:
+            value = bytes(values[r['value_offset']:r['value_offset'] + r['value_len']])
+            d['delta' if blocks else 'new_value'] = value
+        if blocks:
+            d['ranges'] = _block_ranges(r['range_start'], r['block_size'],
+                                        r['block_mask'], r['how_big'])
+            d['fingerprint'] = r['fingerprint']
+        events.append(ChangeEvent.from_dict(d))
+    return events
+
+
 class MemoryWatcher:
     """
     High-level memory change watcher
@@ -89,7 +160,8 @@ class MemoryWatcher:
     def __init__(self, adapter: Optional['TrackerAdapter'] = None, 
                  track_all: bool = False,
                  track_sql: bool = False, track_threads: bool = False,
-                 capture_old_values: bool = False):
+                 capture_old_values: bool = False, backend: Optional[str] = None,
+                 mode: Optional[str] = None):
         """
         Initialize watcher
         
@@ -99,9 +171,22 @@ class MemoryWatcher:
             track_sql: Enable SQL query tracking
             track_threads: Enable thread ID tracking in events
             capture_old_values: Capture old values before change (initial value at watch time)
+            backend: Native write detection - "mprotect" (default), "uffd"
+                (userfaultfd write-protect, no SIGSEGV handler, Linux 5.7+) or
+                "soft-dirty" (pagemap scan, nothing protected). Defaults to
+                $MEMWATCH_BACKEND. Fixed by the first watcher in a process.
+                With any backend, objects of 8 bytes or less use CPU debug
+                registers while they last (MEMWATCH_WATCHPOINTS=0 disables).
+            mode: Overhead budget enforced at runtime - "lite" (5% of one
+                CPU), "balanced" (30%), "deep" (100%) or "off". Regions that
+                cost more are demoted step by step (smaller values, no values,
+                longer writable windows, then periodic sampling) and promoted
+                back once they cool down. Defaults to $MEMWATCH_MODE, else off.
         """
         if _native:
-            _native.init()
+            _native.init(backend or os.environ.get('MEMWATCH_BACKEND'))
+            if mode is not None:
+                _native.set_mode(mode)
         
         if adapter is None:
             adapter = _create_default_adapter()
@@ -131,6 +216,8 @@ class MemoryWatcher:
                 - N > 0: Store up to N bytes
                 - -1: Store full values (no limit)
                 - Default: 256 bytes (minimal overhead)
+                For regions of 100 KB and up the limit applies to the
+                changed bytes (event.delta) rather than a prefix
         
         Returns:
             region_id for later unwatch
@@ -139,6 +226,47 @@ class MemoryWatcher:
         if name is None:
             name = _infer_variable_name(obj)
         
+        metadata, initial_value = self._prepare_watch(obj, name, max_value_bytes)
+        region_id = self.adapter.track(obj, metadata)
+        self._record_watch(region_id, obj, metadata, initial_value)
+        return region_id
+    
+    def watch_many(self, objs: Union[Dict[str, Any], Iterable[Any]],
+                   max_value_bytes: int = 256) -> List[int]:
+        """
+        Watch many objects in one call
+        
+        Much faster than calling watch() in a loop: the native core hashes
+        the objects in parallel, takes its locks once and protects each run
+        of adjacent pages with a single call.
+        
+        Args:
+            objs: {name: obj} mapping, or objects (names inferred from the
+                caller's locals)
+            max_value_bytes: As for watch(), applied to every object
+        
+        Returns:
+            region_ids in input order
+        """
+        if isinstance(objs, dict):
+            named = list(objs.items())
+        else:
+            objs = list(objs)
+            import inspect
+            frame = inspect.currentframe().f_back
+            local_names = {id(v): k for k, v in frame.f_locals.items()} if frame else {}
+            named = [(local_names.get(id(obj)), obj) for obj in objs]
+        
+        prepared = [(obj,) + self._prepare_watch(obj, name, max_value_bytes)
+                    for name, obj in named]
+        region_ids = self.adapter.track_many([(obj, metadata) for obj, metadata, _ in prepared])
+        for region_id, (obj, metadata, initial_value) in zip(region_ids, prepared):
+            self._record_watch(region_id, obj, metadata, initial_value)
+        return region_ids
+    
+    def _prepare_watch(self, obj: Any, name: Optional[str],
+                       max_value_bytes: int) -> Tuple[Dict, Optional[bytes]]:
+        """Validate obj and build its metadata (and initial value if captured)"""
         # Get memory view
         try:
             if isinstance(obj, (bytes, bytearray)):
@@ -163,20 +291,19 @@ class MemoryWatcher:
             except Exception:
                 initial_value = None
         
-        # Track with adapter
         metadata = {
             'variable_name': name,
             'type': type(obj).__name__,
             'max_value_bytes': max_value_bytes,
             'capture_old_values': self.capture_old_values
         }
-        
-        region_id = self.adapter.track(obj, metadata)
+        return metadata, initial_value
+    
+    def _record_watch(self, region_id: int, obj: Any, metadata: Dict,
+                      initial_value: Optional[bytes]) -> None:
         self._tracked_objects[region_id] = (obj, metadata)
         if initial_value is not None:
             self._initial_values[region_id] = initial_value
-        
-        return region_id
     
     def unwatch(self, region_id: int) -> bool:
         """Stop watching a region"""
@@ -197,12 +324,15 @@ class MemoryWatcher:
         frame = inspect.currentframe().f_back
         
         if level == TrackingLevel.ALL or level == TrackingLevel.HEAP:
-            # Track all local variables that support buffer protocol
+            # Track all local variables that support buffer protocol, in one batch
+            watchable = {}
             for name, obj in frame.f_locals.items():
                 try:
-                    self.watch(obj, name=name)
+                    memoryview(obj).release()
                 except (TypeError, AttributeError):
-                    pass
+                    continue
+                watchable[name] = obj
+            self.watch_many(watchable)
     
     def stop_all(self) -> None:
         """Stop watching all regions"""
@@ -225,13 +355,49 @@ class MemoryWatcher:
             else:
                 self.adapter.set_callback(None)
     
+    def set_batch_callback(self, fn: Optional[Callable[[Any], None]],
+                           max_batch: int = 256, max_latency_us: int = 1000) -> None:
+        """
+        Receive changes in batches instead of one ChangeEvent per change
+
+        fn gets one EventBatch per call: a read-only buffer of up to max_batch
+        records (layout BATCH_RECORD / BATCH_DTYPE) whose .values memoryview
+        holds the value bytes. A change waits at most max_latency_us for its
+        batch to fill. While set, the per-event callback is not called.
+        Pass fn=None to go back to per-event delivery.
+
+        Args:
+            fn: Batch callback, or None
+            max_batch: Most records per batch
+            max_latency_us: Longest a change is held back (1 ms resolution)
+        """
+        if not hasattr(self.adapter, 'set_batch_callback'):
+            raise RuntimeError("Batch delivery requires the native mprotect adapter")
+        self.adapter.set_batch_callback(fn, max_batch, max_latency_us)
+    
+    def set_mode(self, mode: Optional[str]) -> None:
+        """
+        Change the overhead budget: "lite", "balanced", "deep", or "off"/None
+
+        Takes effect at the governor's next interval (100 ms). Its decisions
+        are listed in get_stats()['governor'].
+        """
+        if not _native:
+            raise RuntimeError("Overhead modes require the native core")
+        _native.set_mode(mode)
+    
+    def events_from_batch(self, batch) -> List[ChangeEvent]:
+        """Decode an EventBatch and enrich it like per-event delivery"""
+        return [self._enrich_event(e) for e in decode_batch(batch)]
+    
     def check_changes(self) -> List[ChangeEvent]:
         """Synchronously check for changes (polling mode)"""
         events = self.adapter.check_changes()
         return [self._enrich_event(e) for e in events]
     
     def get_stats(self) -> Dict:
-        """Get statistics"""
+        """Get statistics; the native core adds per-stage latencies under
+        'stages' ($MEMWATCH_STATS=<name> also publishes them for `memwatch top`)"""
         stats = self.adapter.get_stats()
         stats['tracked_objects'] = len(self._tracked_objects)
         return stats
@@ -305,4 +471,8 @@ __all__ = [
     'MemoryWatcher',
     'ChangeEvent',
     'TrackingLevel',
+    'decode_batch',
+    'BATCH_RECORD',
+    'BATCH_FIELDS',
+    'BATCH_DTYPE',
 ]
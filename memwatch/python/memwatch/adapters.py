@@ -6,7 +6,7 @@ resolver functions. All heavy work (hashing, diffing, storage) is in the core.
 """
 
 from abc import ABC, abstractmethod
-from typing import Any, Dict, List, Optional
+from typing import Any, Dict, List, Optional, Tuple
 import sys
 import threading
 import time
@@ -42,6 +42,18 @@ class TrackerAdapter(ABC):
         """
         pass
     
+    def track_many(self, items: List[Tuple[Any, Dict]]) -> List[int]:
+        """
+        Track several (obj, metadata) pairs
+        
+        Adapters with a bulk native path override this; the default just
+        calls track() for each.
+        
+        Returns:
+            region_ids in input order
+        """
+        return [self.track(obj, metadata) for obj, metadata in items]
+    
     @abstractmethod
     def untrack(self, region_id: int) -> bool:
         """Stop tracking a region"""
@@ -75,6 +87,37 @@ class MprotectAdapter(TrackerAdapter):
     
     def track(self, obj: Any, metadata: Dict) -> int:
         """Track object using native mprotect mechanism"""
+        addr, size, mem_view = self._buffer_region(obj)
+        
+        # Create metadata ref (could be index into metadata table)
+        metadata_ref = id(metadata)
+        
+        # Get max_value_bytes from metadata (default 256)
+        max_value_bytes = metadata.get('max_value_bytes', 256)
+        
+        # Track with native core
+        region_id = _native.track(addr, size, self.adapter_id, metadata_ref, max_value_bytes)
+        
+        # Keep reference to prevent GC
+        self._region_to_obj[region_id] = (obj, mem_view, metadata)
+        
+        return region_id
+    
+    def track_many(self, items: List[Tuple[Any, Dict]]) -> List[int]:
+        """Track objects with one native call (parallel hashing, coalesced mprotect)"""
+        regions = [self._buffer_region(obj) for obj, _ in items]
+        specs = [(addr, size, self.adapter_id, id(metadata),
+                  metadata.get('max_value_bytes', 256))
+                 for (addr, size, _), (_, metadata) in zip(regions, items)]
+        
+        region_ids = _native.track_many(specs)
+        
+        for region_id, (_, _, mem_view), (obj, metadata) in zip(region_ids, regions, items):
+            self._region_to_obj[region_id] = (obj, mem_view, metadata)
+        return region_ids
+    
+    def _buffer_region(self, obj: Any):
+        """(addr, size, memoryview) of obj's buffer"""
         # Get memory address
         if isinstance(obj, (bytes, bytearray)):
             mem_view = memoryview(obj)
@@ -102,20 +145,7 @@ class MprotectAdapter(TrackerAdapter):
             addr = ctypes.addressof(arr)
         
         size = len(mem_view)
-        
-        # Create metadata ref (could be index into metadata table)
-        metadata_ref = id(metadata)
-        
-        # Get max_value_bytes from metadata (default 256)
-        max_value_bytes = metadata.get('max_value_bytes', 256)
-        
-        # Track with native core
-        region_id = _native.track(addr, size, self.adapter_id, metadata_ref, max_value_bytes)
-        
-        # Keep reference to prevent GC
-        self._region_to_obj[region_id] = (obj, mem_view, metadata)
-        
-        return region_id
+        return addr, size, mem_view
     
     def untrack(self, region_id: int) -> bool:
         """Untrack region"""
@@ -125,6 +155,10 @@ class MprotectAdapter(TrackerAdapter):
             return True
         return False
     
+    def set_batch_callback(self, fn, max_batch: int, max_latency_us: int):
+        """Deliver native EventBatch objects to fn (None restores per-event)"""
+        _native.set_batch_callback(fn, max_batch, max_latency_us)
+    
     def check_changes(self) -> List['ChangeEvent']:
         """Not needed for async mode (events via callback)"""
         return []
@@ -0,0 +1,93 @@
+"""
+CompressedStore - dictionary-compressed value snapshots in a FastStorage store
+
+Thin ctypes wrapper over memwatch_compress (include/memwatch_compress.h),
+which lives in libfaststorage.so. Values are put with a group, usually the
+region or adapter id; once a group has a few values behind it, new ones
+are LZ4 compressed against a dictionary of its recent bytes. Reads
+decompress; size() does not.
+
+    with FastStorage("snapshots.fs", 64 << 20) as store:
+        with CompressedStore(store, 'lite') as values:
+            values.put(f"region.{rid}.{seq}", rid, snapshot)
+            print(values.stats['stored_bytes'] / values.stats['raw_bytes'])
+"""
+
+import ctypes
+from typing import Optional
+
+from .faststorage import FastStorage
+
+MODES = {'off': 0, 'balanced': 1, 'lite': 2, 'deep': 3}  # mw_compress_mode_t
+
+
+class _Stats(ctypes.Structure):
+    _fields_ = [(name, ctypes.c_uint64) for name in (
+        'values', 'raw_bytes', 'stored_bytes', 'compressed', 'with_dict', 'incompressible',
+        'skipped', 'dicts', 'reads', 'compress_ns', 'decompress_ns')]
+
+
+def _bind(lib):
+    """Declare the compression functions of libfaststorage.so, once"""
+    if getattr(lib, '_compress_bound', False):
+        return lib
+    vp, sz = ctypes.c_void_p, ctypes.c_size_t
+    lib.mw_zstore_open.restype = vp
+    lib.mw_zstore_open.argtypes = [vp, ctypes.c_int]
+    lib.mw_zstore_put.argtypes = [vp, ctypes.c_char_p, ctypes.c_uint32, ctypes.c_char_p, sz]
+    lib.mw_zstore_get.argtypes = [vp, ctypes.c_char_p, ctypes.c_char_p, sz, ctypes.POINTER(sz)]
+    lib.mw_zstore_size.restype = ctypes.c_ssize_t
+    lib.mw_zstore_size.argtypes = [vp, ctypes.c_char_p]
+    lib.mw_zstore_stats.argtypes = [vp, ctypes.POINTER(_Stats)]
+    lib.mw_zstore_close.argtypes = [vp]
+    lib._compress_bound = True
+    return lib
+
+
+class CompressedStore:
+    """Compressed values in a store, which must outlive this handle"""
+
+    def __init__(self, store: FastStorage, mode: str = 'balanced'):
+        if mode not in MODES:
+            raise ValueError(f"Unknown compression mode {mode!r} (one of {', '.join(MODES)})")
+        self._store = store
+        self._lib = _bind(store._lib)
+        self._z = self._lib.mw_zstore_open(store._fs, MODES[mode])
+        if not self._z:
+            raise OSError(ctypes.get_errno(), "Cannot open compressed store")
+
+    def put(self, key: str, group: int, value: bytes) -> bool:
+        value = bytes(value)
+        return self._lib.mw_zstore_put(self._z, key.encode(), group, value, len(value)) == 0
+
+    def size(self, key: str) -> Optional[int]:
+        """Uncompressed size, or None if there is no such value"""
+        size = self._lib.mw_zstore_size(self._z, key.encode())
+        return None if size < 0 else size
+
+    def get(self, key: str) -> Optional[bytes]:
+        size = self.size(key)
+        if size is None:
+            return None
+        buf = ctypes.create_string_buffer(size or 1)
+        got = ctypes.c_size_t()
+        if self._lib.mw_zstore_get(self._z, key.encode(), buf, size, ctypes.byref(got)) != 0:
+            raise OSError(ctypes.get_errno(), f"Cannot decompress {key!r}")
+        return buf.raw[:got.value]
+
+    @property
+    def stats(self) -> dict:
+        raw = _Stats()
+        self._lib.mw_zstore_stats(self._z, ctypes.byref(raw))
+        return {name: getattr(raw, name) for name, _ in _Stats._fields_}
+
+    def close(self):
+        if self._z:
+            self._lib.mw_zstore_close(self._z)
+            self._z = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
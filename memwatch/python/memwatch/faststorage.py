@@ -0,0 +1,172 @@
+"""
+FastStorage - mmap key-value store with zero-copy reads
+
+Thin ctypes wrapper over libfaststorage.so. view() hands out a read-only
+memoryview straight over the stored bytes; the store keeps them in place
+until the view is released, even while the key is overwritten or the
+segment holding it is compacted.
+"""
+
+import ctypes
+import os
+import platform
+from pathlib import Path
+from typing import Optional
+
+
+class _BatchEntry(ctypes.Structure):
+    _fields_ = [('key', ctypes.c_char_p),
+                ('value', ctypes.c_char_p),
+                ('value_len', ctypes.c_size_t)]
+
+
+class _View(ctypes.Structure):
+    _fields_ = [('ptr', ctypes.c_void_p),
+                ('len', ctypes.c_size_t),
+                ('token', ctypes.c_uint64)]
+
+
+def _load_faststorage():
+    """Load the native faststorage library"""
+    libname = "libfaststorage.dylib" if platform.system() == "Darwin" else "libfaststorage.so"
+    search_paths = [
+        os.environ.get("MEMWATCH_FASTSTORAGE_LIB"),
+        Path(__file__).parent.parent.parent / "build" / libname,
+        Path(__file__).parent / libname,
+        Path("/usr/local/lib") / libname,
+    ]
+    for path in search_paths:
+        if path and Path(path).exists():
+            lib = ctypes.CDLL(str(path))
+            break
+    else:
+        raise RuntimeError(f"Could not find {libname}. Build it with: make build-faststorage")
+
+    lib.faststorage_create.restype = ctypes.c_void_p
+    lib.faststorage_create.argtypes = [ctypes.c_char_p, ctypes.c_size_t]
+    lib.faststorage_create_sharded.restype = ctypes.c_void_p
+    lib.faststorage_create_sharded.argtypes = [ctypes.c_char_p, ctypes.c_size_t, ctypes.c_uint32]
+    lib.faststorage_destroy.argtypes = [ctypes.c_void_p]
+    lib.faststorage_write.argtypes = [ctypes.c_void_p, ctypes.c_char_p,
+                                      ctypes.c_char_p, ctypes.c_size_t]
+    lib.faststorage_write_batch.argtypes = [ctypes.c_void_p, ctypes.POINTER(_BatchEntry), ctypes.c_size_t]
+    lib.faststorage_set_durability.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_uint32]
+    lib.faststorage_sync.argtypes = [ctypes.c_void_p]
+    lib.faststorage_delete.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+    lib.faststorage_get_view.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.POINTER(_View)]
+    lib.faststorage_release_view.argtypes = [ctypes.c_void_p, ctypes.POINTER(_View)]
+    lib.faststorage_count.restype = ctypes.c_size_t
+    lib.faststorage_count.argtypes = [ctypes.c_void_p]
+    return lib
+
+
+class View:
+    """
+    A stored value, in place
+
+    Use as a context manager, or call release(). memory is a read-only
+    memoryview; while something holds its buffer (numpy.frombuffer,
+    struct.iter_unpack) release() raises BufferError. Slices of memory
+    must not be used after release.
+    """
+
+    def __init__(self, store: 'FastStorage', raw: _View):
+        self._store = store
+        self._raw = raw
+        if raw.len:
+            self.memory = memoryview((ctypes.c_char * raw.len).from_address(raw.ptr)).cast('B').toreadonly()
+        else:
+            self.memory = memoryview(b'')
+
+    def __len__(self):
+        return self._raw.len
+
+    def __bytes__(self):
+        return self.memory.tobytes()
+
+    def release(self):
+        """Hand the bytes back to the store (BufferError while still exported)"""
+        if self._raw is None:
+            return
+        self.memory.release()
+        self._store._lib.faststorage_release_view(self._store._fs, ctypes.byref(self._raw))
+        self._store._views.discard(self)
+        self._raw = None
+
+    def __enter__(self):
+        return self.memory
+
+    def __exit__(self, *exc):
+        self.release()
+
+
+class FastStorage:
+    """mmap-backed key-value store; shards > 0 spreads it over that many files"""
+
+    DURABILITY_NONE, DURABILITY_ASYNC, DURABILITY_GROUP, DURABILITY_SYNC = range(4)
+
+    def __init__(self, path: str, capacity: int = 1024 * 1024, shards: int = 0):
+        self._lib = _load_faststorage()
+        if shards:
+            self._fs = self._lib.faststorage_create_sharded(str(path).encode(), capacity, shards)
+        else:
+            self._fs = self._lib.faststorage_create(str(path).encode(), capacity)
+        if not self._fs:
+            raise OSError(ctypes.get_errno(), f"Cannot open FastStorage file {path}")
+        self._views = set()
+
+    def write(self, key: str, value: bytes) -> bool:
+        return self._lib.faststorage_write(self._fs, key.encode(), value, len(value)) == 0
+
+    def write_batch(self, items) -> bool:
+        """Write (key, value) pairs in order under one lock; stops at the first failure"""
+        items = list(items)
+        entries = (_BatchEntry * len(items))()
+        for entry, (key, value) in zip(entries, items):
+            entry.key, entry.value, entry.value_len = key.encode(), value, len(value)
+        return self._lib.faststorage_write_batch(self._fs, entries, len(items)) == 0
+
+    def set_durability(self, mode: int, interval_ms: int = 0) -> bool:
+        """Pick a DURABILITY_* mode; interval_ms paces the async and group flusher"""
+        return self._lib.faststorage_set_durability(self._fs, mode, interval_ms) == 0
+
+    def sync(self) -> bool:
+        """Wait until every write so far is on disk"""
+        return self._lib.faststorage_sync(self._fs) == 0
+
+    def delete(self, key: str) -> bool:
+        return self._lib.faststorage_delete(self._fs, key.encode()) == 0
+
+    def view(self, key: str) -> Optional[View]:
+        """Zero-copy view of key's value, or None if missing"""
+        raw = _View()
+        if self._lib.faststorage_get_view(self._fs, key.encode(), ctypes.byref(raw)) != 0:
+            return None
+        view = View(self, raw)
+        self._views.add(view)
+        return view
+
+    def read(self, key: str) -> Optional[bytes]:
+        view = self.view(key)
+        if view is None:
+            return None
+        with view as memory:
+            return memory.tobytes()
+
+    def __len__(self):
+        return self._lib.faststorage_count(self._fs)
+
+    def close(self):
+        """Release outstanding views and close the store"""
+        if not self._fs:
+            return
+        for view in list(self._views):
+            view.release()
+        self._lib.faststorage_destroy(self._fs)
+        self._fs = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
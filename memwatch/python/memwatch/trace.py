@@ -0,0 +1,264 @@
+"""
+Trace - keyframe + delta history of watched regions, for time travel
+
+Thin ctypes wrapper over memwatch_trace (include/memwatch_trace.h), which
+lives in libfaststorage.so and keeps the history in a FastStorage store.
+state_at() is a binary search over keyframes plus at most
+keyframe_interval delta applications, however long the trace; cursors
+step forward and back one change at a time.
+
+    with FastStorage("run.trace", 64 << 20) as store:
+        writer = TraceWriter(store)
+        watcher.set_callback(writer.record_event)
+        ...
+        writer.close()
+
+        trace = Trace(store)
+        before = trace.state_at(region_id, t)
+        with trace.cursor(region_id, t) as cursor:
+            cursor.back()
+"""
+
+import ctypes
+from collections import namedtuple
+from typing import List, Optional
+
+from .faststorage import FastStorage
+
+DEFAULT_INTERVAL = 256
+NAME_MAX = 64
+
+TraceRegion = namedtuple('TraceRegion', 'id name size events created_ns first_ns last_ns keyframe_interval')
+
+
+class _Stats(ctypes.Structure):
+    _fields_ = [('events', ctypes.c_uint64),
+                ('skipped', ctypes.c_uint64),
+                ('segments', ctypes.c_uint64),
+                ('keyframe_bytes', ctypes.c_uint64),
+                ('delta_bytes', ctypes.c_uint64)]
+
+
+class _Region(ctypes.Structure):
+    _fields_ = [('id', ctypes.c_uint32),
+                ('size', ctypes.c_uint64),
+                ('events', ctypes.c_uint64),
+                ('created_ns', ctypes.c_uint64),
+                ('first_ns', ctypes.c_uint64),
+                ('last_ns', ctypes.c_uint64),
+                ('keyframe_interval', ctypes.c_uint32),
+                ('name', ctypes.c_char * NAME_MAX)]
+
+
+class _Position(ctypes.Structure):
+    _fields_ = [('seq', ctypes.c_uint64),
+                ('timestamp_ns', ctypes.c_uint64),
+                ('change_offset', ctypes.c_uint32),
+                ('change_len', ctypes.c_uint32)]
+
+
+def _bind(lib):
+    """Declare the trace functions of libfaststorage.so, once"""
+    if getattr(lib, '_trace_bound', False):
+        return lib
+    vp, u32, u64, sz = ctypes.c_void_p, ctypes.c_uint32, ctypes.c_uint64, ctypes.c_size_t
+    lib.mw_trace_writer_open.restype = vp
+    lib.mw_trace_writer_open.argtypes = [vp, u32]
+    lib.mw_trace_add_region.argtypes = [vp, u32, ctypes.c_char_p, ctypes.c_char_p, sz, u64]
+    lib.mw_trace_record.argtypes = [vp, u32, u64, sz, ctypes.c_char_p, sz]
+    lib.mw_trace_writer_flush.argtypes = [vp]
+    lib.mw_trace_writer_stats.argtypes = [vp, ctypes.POINTER(_Stats)]
+    lib.mw_trace_writer_close.argtypes = [vp]
+    lib.mw_trace_open.restype = vp
+    lib.mw_trace_open.argtypes = [vp]
+    lib.mw_trace_regions.argtypes = [vp, ctypes.POINTER(_Region), ctypes.c_int]
+    lib.mw_trace_state_at.argtypes = [vp, u32, u64, ctypes.c_char_p, sz]
+    lib.mw_trace_seek.restype = vp
+    lib.mw_trace_seek.argtypes = [vp, u32, u64]
+    lib.mw_trace_step_forward.argtypes = [vp]
+    lib.mw_trace_step_back.argtypes = [vp]
+    lib.mw_trace_cursor_state.restype = ctypes.POINTER(ctypes.c_uint8)
+    lib.mw_trace_cursor_state.argtypes = [vp, ctypes.POINTER(sz)]
+    lib.mw_trace_cursor_position.argtypes = [vp, ctypes.POINTER(_Position)]
+    lib.mw_trace_cursor_free.argtypes = [vp]
+    lib.mw_trace_close.argtypes = [vp]
+    lib._trace_bound = True
+    return lib
+
+
+class TraceWriter:
+    """Records region changes into a store; the store must outlive the writer"""
+
+    def __init__(self, store: FastStorage, keyframe_interval: int = 0):
+        self._store = store
+        self._lib = _bind(store._lib)
+        self._w = self._lib.mw_trace_writer_open(store._fs, keyframe_interval)
+        if not self._w:
+            raise OSError(ctypes.get_errno(), "Cannot start trace writer")
+
+    def add_region(self, region_id: int, initial: bytes, name: str = '', timestamp_ns: int = 0) -> bool:
+        """Add a region with its initial bytes; False if the id is taken"""
+        return self._lib.mw_trace_add_region(self._w, region_id, name.encode(), bytes(initial),
+                                             len(initial), timestamp_ns) == 0
+
+    def record(self, region_id: int, timestamp_ns: int, offset: int, data: bytes) -> bool:
+        """Record that data now sits at offset; False for an unknown region or out of range"""
+        return self._lib.mw_trace_record(self._w, region_id, timestamp_ns, offset,
+                                         bytes(data), len(data)) == 0
+
+    def record_event(self, event) -> bool:
+        """
+        Record a ChangeEvent
+
+        The first event of a region adds it, with old_value as its initial
+        bytes. Large-region events are recorded range by range from delta.
+        """
+        if event.ranges is not None and event.delta is not None:
+            pos = 0
+            for offset, length in event.ranges:
+                if not self.record(event.region_id, event.timestamp_ns, offset,
+                                   event.delta[pos:pos + length]):
+                    return False
+                pos += length
+            return True
+        new = event.new_value if event.new_value is not None else event.new_preview
+        if new is None:
+            return False
+        if self.record(event.region_id, event.timestamp_ns, 0, new):
+            return True
+        old = event.old_value if event.old_value is not None else event.old_preview
+        if old is None or not self.add_region(event.region_id, old, event.variable_name or '',
+                                              event.timestamp_ns):
+            return False
+        return self.record(event.region_id, event.timestamp_ns, 0, new[:len(old)])
+
+    def flush(self) -> bool:
+        """Make everything recorded so far visible to readers"""
+        return self._lib.mw_trace_writer_flush(self._w) == 0
+
+    @property
+    def stats(self) -> dict:
+        raw = _Stats()
+        self._lib.mw_trace_writer_stats(self._w, ctypes.byref(raw))
+        return {name: getattr(raw, name) for name, _ in _Stats._fields_}
+
+    def close(self):
+        if self._w:
+            self._lib.mw_trace_writer_close(self._w)
+            self._w = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+
+class TraceCursor:
+    """A region at one point of its history"""
+
+    def __init__(self, trace: 'Trace', handle):
+        self._lib = trace._lib
+        self._c = handle
+
+    @property
+    def state(self) -> bytes:
+        size = ctypes.c_size_t()
+        ptr = self._lib.mw_trace_cursor_state(self._c, ctypes.byref(size))
+        return ctypes.string_at(ptr, size.value)
+
+    def _position(self) -> _Position:
+        pos = _Position()
+        self._lib.mw_trace_cursor_position(self._c, ctypes.byref(pos))
+        return pos
+
+    @property
+    def seq(self) -> int:
+        """Changes applied; 0 is the initial bytes"""
+        return self._position().seq
+
+    @property
+    def timestamp_ns(self) -> int:
+        return self._position().timestamp_ns
+
+    @property
+    def change(self) -> tuple:
+        """(offset, length) touched by the last move"""
+        pos = self._position()
+        return pos.change_offset, pos.change_len
+
+    def _step(self, fn, n: int) -> int:
+        moved = 0
+        while moved < n:
+            rc = fn(self._c)
+            if rc < 0:
+                raise OSError(ctypes.get_errno(), "Trace store is damaged")
+            if rc == 0:
+                break
+            moved += 1
+        return moved
+
+    def forward(self, n: int = 1) -> int:
+        """Apply up to n changes; returns how many were applied"""
+        return self._step(self._lib.mw_trace_step_forward, n)
+
+    def back(self, n: int = 1) -> int:
+        """Undo up to n changes; returns how many were undone"""
+        return self._step(self._lib.mw_trace_step_back, n)
+
+    def close(self):
+        if self._c:
+            self._lib.mw_trace_cursor_free(self._c)
+            self._c = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+
+class Trace:
+    """Reads the trace in a store, as of the writer's last flush"""
+
+    def __init__(self, store: FastStorage):
+        self._store = store
+        self._lib = _bind(store._lib)
+        self._t = self._lib.mw_trace_open(store._fs)
+        if not self._t:
+            raise ValueError("Store holds no trace")
+        self._sizes = {r.id: r.size for r in self.regions()}
+
+    def regions(self) -> List[TraceRegion]:
+        count = self._lib.mw_trace_regions(self._t, None, 0)
+        raw = (_Region * count)()
+        self._lib.mw_trace_regions(self._t, raw, count)
+        return [TraceRegion(r.id, r.name.decode('utf-8', 'replace'), r.size, r.events,
+                            r.created_ns, r.first_ns, r.last_ns, r.keyframe_interval) for r in raw]
+
+    def state_at(self, region_id: int, timestamp_ns: int) -> Optional[bytes]:
+        """The region after every change stamped at or before timestamp_ns, or None"""
+        size = self._sizes.get(region_id)
+        if size is None:
+            return None
+        buf = ctypes.create_string_buffer(size or 1)
+        if self._lib.mw_trace_state_at(self._t, region_id, timestamp_ns, buf, size) < 0:
+            raise OSError(ctypes.get_errno(), "Trace store is damaged")
+        return buf.raw[:size]
+
+    def cursor(self, region_id: int, timestamp_ns: int = 0) -> TraceCursor:
+        handle = self._lib.mw_trace_seek(self._t, region_id, timestamp_ns)
+        if not handle:
+            raise KeyError(region_id)
+        return TraceCursor(self, handle)
+
+    def close(self):
+        if self._t:
+            self._lib.mw_trace_close(self._t)
+            self._t = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
@@ -12,8 +12,10 @@ import os
 # Native extension module
 memwatch_extension = Extension(
     '_memwatch_native',  # Renamed to avoid collision with Python package
-    sources=['src/memwatch.c'],
-    include_dirs=['/usr/include', '/usr/local/include'],
+    sources=['src/memwatch.c', 'src/memwatch_backend.c', 'src/memwatch_hash.c',
+             'src/memwatch_page_index.c', 'src/memwatch_timer_wheel.c', 'src/memwatch_stats.c',
+             'src/memwatch_governor.c'],
+    include_dirs=['include', '/usr/include', '/usr/local/include'],
     libraries=['pthread'],
     extra_compile_args=[
         '-std=c11',
@@ -51,9 +51,10 @@ const char* faststorage_bridge_read(const char *key) {
     }
 
     /* Note: This is a simplified version that doesn't handle binary data well
-       For production, use faststorage_read() directly with a buffer */
-    static char buffer[102400];
-    size_t len = sizeof(buffer);
+       For production, use faststorage_bridge_get_view() or faststorage_read().
+       One buffer per thread: valid until this thread's next call */
+    static __thread char buffer[102400];
+    size_t len = sizeof(buffer) - 1;
     
     if (faststorage_read(_default_storage, key, buffer, &len) == 0) {
         buffer[len] = 0;
@@ -63,6 +64,24 @@ const char* faststorage_bridge_read(const char *key) {
     return NULL;
 }
 
+/* Zero-copy read: view->ptr points into storage until released */
+int faststorage_bridge_get_view(const char *key, FastStorageView *view) {
+    if (!_faststorage_initialized || !_default_storage) {
+        return -1;
+    }
+
+    return faststorage_get_view(_default_storage, key, view);
+}
+
+/* Release a view from faststorage_bridge_get_view */
+int faststorage_bridge_release_view(FastStorageView *view) {
+    if (!_faststorage_initialized || !_default_storage) {
+        return -1;
+    }
+
+    return faststorage_release_view(_default_storage, view);
+}
+
 /* Flush storage to disk */
 int faststorage_bridge_flush(void) {
     if (!_faststorage_initialized || !_default_storage) {
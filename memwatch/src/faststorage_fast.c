@@ -13,7 +13,16 @@
  * - Reads: <100ns per operation
  * - No system calls during reads (after mmap)
  * 
- * Crash recovery: Automatic via header validation on open
+ * Layout: header, hash table, then a log of records appended into
+ * FS_SEGMENT_SIZE segments. Values over FS_INLINE_MAX are split into chunk
+ * records, with a blob record listing the chunks in the hash table. A background compactor moves the live records
+ * out of mostly dead segments and punches the segments out of the file.
+ * Zero-copy views hold off the punching via epochs (see EPOCH RECLAMATION).
+ * Plain reads take no lock (see OPTIMISTIC READS), and a sharded handle
+ * spreads keys over independent stores (see SHARDING).
+ * 
+ * Crash recovery: records are checksummed, and a store not closed cleanly
+ * is checked on open (see CRASH RECOVERY)
  */
 
 #define _GNU_SOURCE
@@ -26,41 +35,94 @@
 #include <unistd.h>
 #include <pthread.h>
 #include <errno.h>
+#include <sched.h>
 #include <stdint.h>
 #include <stdatomic.h>
 #include <math.h>
 #include "faststorage_fast.h"
+#include "memwatch_hash.h"
 
 /* ============================================================================
  * CONSTANTS AND STRUCTURE DEFINITIONS
  * ============================================================================ */
 
 #define FS_MAGIC              0xFDB20024      /* Magic number for validation */
-#define FS_VERSION            2               /* Format version */
+#define FS_VERSION            3               /* Format version: 64-bit offsets */
+#define FS_VERSION_V2         2               /* 32-bit offsets, upgraded on open */
 #define FS_MIN_CAPACITY       (1024 * 1024)   /* 1 MB minimum */
 #define FS_PAGE_SIZE          4096            /* System page size */
 #define FS_HASH_LOAD_FACTOR   0.75            /* Resize when 75% full */
 #define FS_INITIAL_SLOTS      16384           /* Initial hash table slots */
+#define FS_GROW_ALIGN         (2 * 1024 * 1024) /* Grow in huge-page extents */
+#define FS_REHASH_STEP        64              /* Slots migrated per write */
+
+#define FS_SEGMENT_SIZE       (1024 * 1024)   /* Log segment, holds the largest record */
+#define FS_COMPACT_THRESHOLD  0.5             /* Empty segments at most half live */
+#define FS_COMPACT_INTERVAL_MS 5              /* Background compactor tick */
+#define FS_COMPACT_SLOTS      65536           /* Hash slots checked per tick */
+#define FS_COMPACT_BYTES      (1024 * 1024)   /* Live bytes moved per tick */
+#define FS_COMPACT_BATCH      4096            /* Hash slots per lock hold */
+#define FS_NO_SEGMENT         UINT32_MAX
+
+#define FS_FLUSH_INTERVAL_MS  10              /* Default flusher period */
+
+#define FS_SEQ_SPINS          64              /* Polls of an odd seq before yielding */
+#define FS_SEQ_RETRIES        16              /* Optimistic attempts before the read lock */
+#define FS_READ_STRIPES       16              /* Read counters, one cache line each */
+#define FS_STRIPE_WORDS       (64 / sizeof(uint64_t))
+
+#define FS_MAX_SHARDS         256
+#define FS_VIEW_SHARD_SHIFT   24              /* Token bits 24-31 name a sharded view's shard */
+#define FS_MAX_VIEWS          (1u << FS_VIEW_SHARD_SHIFT)
 
 #define FS_KEY_MAX            256
-#define FS_VALUE_MAX          (100 * 1024)    /* 100 KB per value */
+#define FS_INLINE_MAX         (100 * 1024)    /* Larger values are chunked */
+#define FS_CHUNK_SIZE         (256 * 1024 - FS_PAGE_SIZE) /* Value bytes per chunk record:
+                                                        * four page-aligned chunks fill a segment */
+
+/* Record magic numbers */
+#define FS_RECORD_INLINE      FS_MAGIC        /* Value follows the key */
+#define FS_RECORD_BLOB        0xFDB2B10B      /* BlobHeader + chunk offsets follow the key */
+#define FS_RECORD_CHUNK       0xFDB2C4C4      /* No key; value is one chunk of a blob */
 
 /* Record format (packed for efficiency) */
 typedef struct __attribute__((packed)) {
     uint32_t magic;                  /* Record magic number */
     uint32_t key_len;                /* Key length (1-256) */
     uint32_t value_len;              /* Value length */
-    uint32_t padding;                /* For alignment */
+    uint32_t crc;                    /* fs_record_crc, or 0 if written before checksums */
 } RecordHeader;
 
-/* Hash table entry */
+/* Value of a blob record, followed by num_chunks uint64_t chunk offsets.
+ * Chunk i holds value bytes [i * chunk_size, (i + 1) * chunk_size) */
 typedef struct __attribute__((packed)) {
-    uint32_t offset;                 /* Offset to record in file, or 0 if empty */
+    uint64_t total_len;
+    uint64_t serial;                 /* Distinguishes successive values of a key */
+    uint32_t chunk_size;
+    uint32_t num_chunks;
+} BlobHeader;
+
+/* Hash table entry */
+typedef struct __attribute__((packed)) FSHashEntry {
+    uint64_t offset;                 /* Offset to record in file, or 0 if empty */
     uint32_t hash;                   /* Hash of key (for verification) */
+    uint32_t flags;                  /* FS_ENTRY_* */
 } HashEntry;
 
-/* File header - stored at beginning of mmap'd file */
+#define FS_ENTRY_BLOB         0x1             /* Record is a blob: chunks live elsewhere */
+
+/* Hash table entry of a version 2 file */
 typedef struct __attribute__((packed)) {
+    uint32_t offset;
+    uint32_t hash;
+} HashEntryV2;
+
+/* Offsets that cannot hold a record (the file header lives there) */
+#define FS_SLOT_EMPTY         0
+#define FS_SLOT_DELETED       1               /* Tombstone: keeps probe chains intact */
+
+/* File header - stored at beginning of mmap'd file */
+typedef struct __attribute__((packed)) FSFileHeader {
     uint32_t magic;                  /* FS_MAGIC */
     uint32_t version;                /* FS_VERSION */
     uint64_t file_size;              /* Total file size */
@@ -68,103 +130,405 @@ typedef struct __attribute__((packed)) {
     uint32_t num_entries;            /* Number of key-value pairs */
     uint32_t num_slots;              /* Hash table size */
     uint64_t hash_table_offset;      /* Where hash table starts */
-    uint32_t crc32;                  /* Checksum of header */
-    uint32_t padding;                /* Alignment */
+    uint32_t crc32;                  /* Checksum of the fields above; 0 while open,
+                                      * written by a clean shutdown */
+    uint32_t shards;                 /* Shard count of the set this file belongs to, 0 if none */
 } FileHeader;
 
 #define HEADER_SIZE sizeof(FileHeader)
 
+/* Per-segment state, kept in memory and rebuilt from the hash table on open */
+enum {
+    FS_SEG_FREE = 0,                 /* Punched out, ready for appends */
+    FS_SEG_OPEN,                     /* Receiving appends */
+    FS_SEG_SEALED,                   /* Full; a compaction candidate */
+    FS_SEG_RETIRED                   /* Emptied, but a view may still point into it */
+};
+
+typedef struct FSSegment {
+    uint32_t live;                   /* Bytes of records the hash table points at */
+    uint8_t state;
+    uint8_t pinned;                  /* Holds the file header or a hash table */
+} Segment;
+
+/* Chunk offsets of a blob being streamed in, not yet in the hash table */
+typedef struct FSStream {
+    uint64_t *chunks;
+    uint32_t count;
+    struct FSStream *next;
+} Stream;
+
+/* A live zero-copy view; the token is generation << 32 | index */
+typedef struct FSView {
+    uint64_t epoch;                  /* fs->epoch when taken */
+    uint32_t generation;
+    uint8_t used;
+    void *map;                       /* private mapping of a blob's chunks, or NULL */
+    size_t map_len;
+    void *copy;                      /* assembled value when the chunks can't be mapped */
+} View;
+
+/* Memory freed once no view older than epoch remains, or a mapping kept
+ * until destroy */
+typedef struct FSRetired {
+    uint64_t epoch;
+    uint32_t segment;                /* segment to punch, or FS_NO_SEGMENT for a mapping */
+    void *map;
+    size_t map_len;
+    struct FSRetired *next;
+} Retired;
+
+#define FS_BLOB_MAX_CHUNKS \
+    ((FS_SEGMENT_SIZE - sizeof(RecordHeader) - FS_KEY_MAX - sizeof(BlobHeader)) / sizeof(uint64_t))
+
+_Static_assert(sizeof(RecordHeader) + FS_KEY_MAX + FS_INLINE_MAX <= FS_SEGMENT_SIZE &&
+               FS_PAGE_SIZE + FS_CHUNK_SIZE <= FS_SEGMENT_SIZE,
+               "a record must fit in one segment");
+_Static_assert(FS_CHUNK_SIZE % FS_PAGE_SIZE == 0, "chunks are mapped page by page");
+
 /* ============================================================================
  * UTILITY FUNCTIONS
  * ============================================================================ */
 
 static inline uint32_t fs_hash(const char *key) {
-    /* FNV-1a hash - very fast and good distribution */
-    uint32_t h = 2166136261u;
-    const uint8_t *p = (const uint8_t *)key;
-    while (*p) {
-        h ^= *p++;
-        h *= 16777619u;
-    }
-    return h;
+    /* Shared SIMD hash, folded to the 32 bits stored per slot */
+    uint64_t h = mw_hash64(key, strlen(key));
+    return (uint32_t)(h ^ (h >> 32));
 }
 
 static inline uint32_t fs_crc32(const uint8_t *data, size_t len) {
-    /* Simple CRC32 for header validation */
-    uint32_t crc = 0xffffffff;
-    for (size_t i = 0; i < len; i++) {
-        crc = (crc >> 8) ^ ((crc ^ data[i]) & 0xff);
-    }
-    return crc ^ 0xffffffff;
+    /* CRC-32C for header validation (hardware-accelerated where available) */
+    return mw_crc32c(0, data, len);
+}
+
+static uint32_t fs_crc_record(const RecordHeader *hdr, const void *body, size_t body_len) {
+    /* Checksum of a record: header fields before crc, then key and value.
+     * Never 0, which marks records written before checksums */
+    uint32_t crc = mw_crc32c(0, hdr, offsetof(RecordHeader, crc));
+    crc = mw_crc32c(crc, body, body_len);
+    return crc ? crc : UINT32_MAX;
+}
+
+static inline uint32_t fs_record_crc(const RecordHeader *rec) {
+    return fs_crc_record(rec, rec + 1, (size_t)rec->key_len + rec->value_len);
 }
 
-static size_t fs_next_power_of_two(size_t n) {
-    /* Round up to next power of 2 */
-    if (n <= 1) return 1;
-    n--;
-    n |= n >> 1;
-    n |= n >> 2;
-    n |= n >> 4;
-    n |= n >> 8;
-    n |= n >> 16;
-    n |= n >> 32;
-    return n + 1;
+static inline uint32_t fs_header_crc(const FileHeader *hdr) {
+    /* Never 0, which marks a store that is open or was not closed cleanly */
+    uint32_t crc = fs_crc32((const uint8_t *)hdr, offsetof(FileHeader, crc32));
+    return crc ? crc : UINT32_MAX;
 }
 
 static void fs_prefault_range(uint8_t *start, size_t len) {
-    /* Pre-fault pages to avoid runtime page faults */
+    /* Pre-fault pages to avoid runtime page faults (read-only touch:
+     * the range may already hold records from a previous session) */
     if (!start || len == 0) return;
     
-    uint8_t *end = start + len;
-    for (uint8_t *p = start; p < end; p += FS_PAGE_SIZE) {
-        *p = 0;
+    volatile const uint8_t *end = start + len;
+    for (volatile const uint8_t *p = start; p < end; p += FS_PAGE_SIZE) {
+        (void)*p;
+    }
+    (void)*(end - 1);
+}
+
+static void fs_release_range(FastStorageImpl *fs, uint64_t offset, uint64_t len) {
+    /* Give the blocks back to the file system; the range reads as zeros */
+    if (fallocate(fs->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                  (off_t)offset, (off_t)len) < 0) {
+        memset(fs->mmap_ptr + offset, 0, len);
     }
-    *(end - 1) = 0;
+}
+
+static void fs_free_segment(FastStorageImpl *fs, uint32_t seg) {
+    fs_release_range(fs, (uint64_t)seg * FS_SEGMENT_SIZE, FS_SEGMENT_SIZE);
+    fs->segments[seg].state = FS_SEG_FREE;
+    fs->segments[seg].live = 0;
+    fs->reclaimed += FS_SEGMENT_SIZE;
 }
 
 /* ============================================================================
- * CORE FILE OPERATIONS
+ * EPOCH RECLAMATION
+ *
+ * A view records the epoch it was taken in, under the read lock. A segment
+ * a view could point into is retired when compaction empties it, under the
+ * write lock with the current epoch, which then advances. Views taken later
+ * can't see it, so it is punched once the oldest live view is younger than
+ * the retirement. Only the compactor, compaction and view release reclaim;
+ * readers never wait. (Old mappings are simply kept, see fs_grow_file.)
  * ============================================================================ */
 
-static int fs_grow_file(FastStorageImpl *fs, size_t new_size) {
-    /* Grow file with automatic expansion */
-    if (new_size <= fs->file_size) return 0;
+static int fs_retire(FastStorageImpl *fs, uint32_t segment) {
+    /* Called with the write lock held */
+    Retired *item = malloc(sizeof(Retired));
+    if (!item) return -1;
+    
+    item->epoch = fs->epoch++;
+    item->segment = segment;
+    item->map = NULL;
+    item->map_len = 0;
+    item->next = fs->retired;
+    fs->retired = item;
+    return 0;
+}
+
+static void fs_reclaim_locked(FastStorageImpl *fs) {
+    /* Free everything retired before the oldest live view was taken */
+    if (!fs->retired) return;
+    
+    uint64_t oldest = UINT64_MAX;
+    pthread_mutex_lock(&fs->view_lock);
+    for (uint32_t i = 0; i < fs->views_capacity; i++) {
+        if (fs->views[i].used && fs->views[i].epoch < oldest) {
+            oldest = fs->views[i].epoch;
+        }
+    }
+    pthread_mutex_unlock(&fs->view_lock);
     
-    /* Round to next power of 2 for logarithmic growth */
-    new_size = fs_next_power_of_two(new_size);
-    new_size = (new_size < FS_MIN_CAPACITY) ? FS_MIN_CAPACITY : new_size;
+    for (Retired **link = &fs->retired; *link; ) {
+        Retired *item = *link;
+        if (item->epoch >= oldest) {
+            link = &item->next;
+            continue;
+        }
+        
+        *link = item->next;
+        fs_free_segment(fs, item->segment);
+        free(item);
+    }
+}
+
+/* ============================================================================
+ * OPTIMISTIC READS
+ *
+ * Every write-locked section makes fs->seq odd on entry and even again on
+ * exit. faststorage_read, _size and _exists take no lock: they wait for an
+ * even seq, look the key up in whatever the mapping holds, and keep the
+ * result only if seq is unchanged afterwards. A lookup racing a writer can
+ * see a half-updated table or record, so every offset and length it
+ * follows is checked against the mapping size it started from. Mappings
+ * stay valid while the store is open (see fs_grow_file), so a stale base
+ * is never dangling. A reader that loses FS_SEQ_RETRIES times in a row to
+ * writers falls back to the read lock, which bounds its wait.
+ * ============================================================================ */
+
+static inline void fs_write_begin(FastStorageImpl *fs) {
+    __atomic_store_n(&fs->seq, fs->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void fs_write_lock(FastStorageImpl *fs) {
+    pthread_rwlock_wrlock(&fs->lock);
+    fs_write_begin(fs);
+}
+
+static inline int fs_write_trylock(FastStorageImpl *fs) {
+    if (pthread_rwlock_trywrlock(&fs->lock) != 0) return -1;
+    fs_write_begin(fs);
+    return 0;
+}
+
+static inline void fs_write_unlock(FastStorageImpl *fs) {
+    __atomic_store_n(&fs->seq, fs->seq + 1, __ATOMIC_RELEASE);
+    pthread_rwlock_unlock(&fs->lock);
+}
+
+static inline uint32_t fs_read_begin(FastStorageImpl *fs) {
+    /* Wait out a writer; yield so a preempted one can finish */
+    uint32_t seq;
+    uint32_t spins = 0;
+    while ((seq = __atomic_load_n(&fs->seq, __ATOMIC_ACQUIRE)) & 1) {
+        if (++spins == FS_SEQ_SPINS) {
+            sched_yield();
+            spins = 0;
+        }
+    }
+    return seq;
+}
+
+static inline int fs_read_valid(FastStorageImpl *fs, uint32_t seq) {
+    /* Nothing read since fs_read_begin was written meanwhile */
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&fs->seq, __ATOMIC_RELAXED) == seq;
+}
+
+/* The mapping as one lock-free reader sees it */
+typedef struct {
+    const uint8_t *base;
+    uint64_t size;
+} Snapshot;
+
+static inline Snapshot fs_snapshot(FastStorageImpl *fs) {
+    /* Size first: the writer publishes a mapping before its size */
+    Snapshot snap;
+    snap.size = __atomic_load_n(&fs->file_size, __ATOMIC_ACQUIRE);
+    snap.base = __atomic_load_n(&fs->mmap_ptr, __ATOMIC_ACQUIRE);
+    return snap;
+}
+
+static inline int fs_in_bounds(const Snapshot *snap, uint64_t offset, uint64_t len) {
+    return offset <= snap->size && len <= snap->size - offset;
+}
+
+static const RecordHeader *fs_lookup_snapshot(const Snapshot *snap, const char *key, size_t key_len,
+                                              uint32_t hash, int *torn) {
+    /* fs_probe over a snapshot
+     * Returns: the key's record, or NULL if absent or *torn was set
+     */
+    const FileHeader *hdr = (const FileHeader *)snap->base;
+    uint64_t table_offset = hdr->hash_table_offset;
+    uint32_t num_slots = hdr->num_slots;
+    if (num_slots == 0 || !fs_in_bounds(snap, table_offset, (uint64_t)num_slots * sizeof(HashEntry))) {
+        *torn = 1;
+        return NULL;
+    }
     
-    /* Expand file */
-    if (lseek(fs->fd, new_size - 1, SEEK_SET) < 0) {
-        perror("lseek");
-        return -1;
+    const HashEntry *table = (const HashEntry *)(snap->base + table_offset);
+    uint32_t index = hash % num_slots;
+    for (uint32_t probe = 0; probe < num_slots; probe++) {
+        uint64_t offset = table[index].offset;
+        if (offset == FS_SLOT_EMPTY) return NULL;
+        
+        if (offset != FS_SLOT_DELETED && table[index].hash == hash) {
+            if (!fs_in_bounds(snap, offset, sizeof(RecordHeader) + key_len)) {
+                *torn = 1;
+                return NULL;
+            }
+            const RecordHeader *rec = (const RecordHeader *)(snap->base + offset);
+            if (rec->key_len == key_len && rec->magic != FS_RECORD_CHUNK &&
+                memcmp((const uint8_t *)rec + sizeof(RecordHeader), key, key_len) == 0) {
+                return rec;
+            }
+        }
+        index = (index + 1) % num_slots;
     }
-    if (write(fs->fd, "", 1) != 1) {
-        perror("write");
-        return -1;
+    return NULL;
+}
+
+static int fs_read_snapshot(const Snapshot *snap, const char *key, uint32_t hash,
+                            void *value_out, size_t capacity, uint64_t *value_len) {
+    /* Find key in a snapshot, sizing its value and copying it to value_out
+     * if that is non-NULL and the value fits in capacity
+     * Returns: 1 if found, 0 if not, -1 if the snapshot is torn
+     */
+    int torn = 0;
+    size_t key_len = strlen(key) + 1;
+    const RecordHeader *rec = fs_lookup_snapshot(snap, key, key_len, hash, &torn);
+    if (!rec) return torn ? -1 : 0;
+    
+    uint64_t value_at = (uint64_t)((const uint8_t *)rec - snap->base) + sizeof(RecordHeader) + key_len;
+    if (rec->magic != FS_RECORD_BLOB) {
+        uint32_t len = rec->value_len;
+        if (!fs_in_bounds(snap, value_at, len)) return -1;
+        *value_len = len;
+        if (value_out && len <= capacity) {
+            memcpy(value_out, snap->base + value_at, len);
+        }
+        return 1;
     }
     
-    /* Re-mmap with new size */
-    if (munmap(fs->mmap_ptr, fs->file_size) < 0) {
-        perror("munmap");
+    if (!fs_in_bounds(snap, value_at, sizeof(BlobHeader))) return -1;
+    const BlobHeader *blob = (const BlobHeader *)(snap->base + value_at);
+    uint64_t total = blob->total_len;
+    uint32_t num_chunks = blob->num_chunks;
+    *value_len = total;
+    if (!value_out || total > capacity) return 1;
+    if (!fs_in_bounds(snap, value_at + sizeof(BlobHeader), (uint64_t)num_chunks * sizeof(uint64_t))) {
         return -1;
     }
     
-    fs->mmap_ptr = mmap(NULL, new_size, PROT_READ | PROT_WRITE, 
-                        MAP_SHARED | MAP_POPULATE, fs->fd, 0);
-    if (fs->mmap_ptr == MAP_FAILED) {
-        perror("mmap");
-        return -1;
+    const uint64_t *chunks = (const uint64_t *)(blob + 1);
+    uint64_t pos = 0;
+    for (uint32_t i = 0; i < num_chunks; i++) {
+        uint64_t chunk = chunks[i];
+        if (!fs_in_bounds(snap, chunk, sizeof(RecordHeader))) return -1;
+        uint32_t len = ((const RecordHeader *)(snap->base + chunk))->value_len;
+        if (len > total - pos || !fs_in_bounds(snap, chunk + sizeof(RecordHeader), len)) return -1;
+        memcpy((uint8_t *)value_out + pos, snap->base + chunk + sizeof(RecordHeader), len);
+        pos += len;
+    }
+    return (pos == total) ? 1 : -1;
+}
+
+static __thread uint32_t fs_read_stripe;            /* this thread's stripe + 1 */
+static uint32_t fs_stripes_handed_out;
+
+static inline void fs_count_read(FastStorageImpl *fs) {
+    /* Threads count into different cache lines, so reads share nothing */
+    if (!fs_read_stripe) {
+        fs_read_stripe = __atomic_fetch_add(&fs_stripes_handed_out, 1, __ATOMIC_RELAXED) %
+                         FS_READ_STRIPES + 1;
     }
+    __atomic_fetch_add(&fs->reads[(fs_read_stripe - 1) * FS_STRIPE_WORDS], 1, __ATOMIC_RELAXED);
+}
+
+/* ============================================================================
+ * CORE FILE OPERATIONS
+ * ============================================================================ */
+
+static int fs_grow_file(FastStorageImpl *fs, size_t min_size) {
+    /* Grow the file to hold at least min_size bytes.
+     *
+     * Growth is geometric (at least doubling) and rounded to huge-page
+     * extents, so appends cost amortized O(1) remaps. The mapping is
+     * extended in place with mremap. If the address space behind it is
+     * taken the file is mapped afresh, and the old mapping is kept until
+     * destroy: lock-free readers and views may still be using it. Doubling
+     * bounds the mappings kept to the size of the last one.
+     */
+    if (min_size <= fs->file_size) return 0;
     
-    /* Lock in memory to prevent swapping */
-    mlock(fs->mmap_ptr, new_size);
+    size_t old_size = fs->file_size;
+    size_t new_size = old_size * 2;
+    if (new_size < min_size) new_size = min_size;
+    new_size = (new_size + FS_GROW_ALIGN - 1) & ~(size_t)(FS_GROW_ALIGN - 1);
     
-    /* Prefault new pages */
-    fs_prefault_range(fs->mmap_ptr + fs->file_size, new_size - fs->file_size);
+    /* Expand file */
+    if (ftruncate(fs->fd, (off_t)new_size) < 0) {
+        perror("ftruncate");
+        return -1;
+    }
     
-    fs->file_size = new_size;
+    uint8_t *ptr = mremap(fs->mmap_ptr, old_size, new_size, 0);
+    if (ptr == MAP_FAILED) {
+        Retired *old = malloc(sizeof(Retired));
+        ptr = old ? mmap(NULL, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, fs->fd, 0) : MAP_FAILED;
+        if (ptr != MAP_FAILED) {
+            munlock(fs->mmap_ptr, old_size);
+            mlock(ptr, old_size);
+            old->epoch = 0;
+            old->segment = FS_NO_SEGMENT;
+            old->map = fs->mmap_ptr;
+            old->map_len = old_size;
+            old->next = fs->mappings;
+            fs->mappings = old;
+        } else {
+            free(old);
+        }
+    }
+    if (ptr == MAP_FAILED) {
+        int saved = errno;
+        perror("mremap");
+        if (ftruncate(fs->fd, (off_t)old_size) < 0) {
+            perror("ftruncate");
+        }
+        errno = saved;
+        return -1;
+    }
+    __atomic_store_n(&fs->mmap_ptr, ptr, __ATOMIC_RELEASE);
+    __atomic_store_n(&fs->file_size, new_size, __ATOMIC_RELEASE);
+    
+    /* Lock and prefault only the new extent - the rest kept its pages */
+    mlock(ptr + old_size, new_size - old_size);
+    fs_prefault_range(ptr + old_size, new_size - old_size);
+    
+    /* The mapping may have moved - re-derive pointers into it */
+    fs->header = (FileHeader *)fs->mmap_ptr;
+    fs->hash_table = (HashEntry *)(fs->mmap_ptr + fs->header->hash_table_offset);
+    if (fs->rehash_table) {
+        fs->rehash_table = (HashEntry *)(fs->mmap_ptr + fs->rehash_offset);
+    }
     fs->header->file_size = new_size;
+    fs->growths++;
     fs->resized = 1;
     
     return 0;
@@ -195,8 +559,37 @@ static int fs_init_header(FastStorageImpl *fs) {
     memset(fs->hash_table, 0, hash_size);
     
     hdr->data_end = HEADER_SIZE + hash_size;
-    hdr->crc32 = fs_crc32((uint8_t *)hdr, HEADER_SIZE - 4);
     
+    /* Any rehash in flight targeted the old contents */
+    fs->rehash_table = NULL;
+    fs->rehash_slots = 0;
+    fs->rehash_cursor = 0;
+    
+    return 0;
+}
+
+static int fs_upgrade_v2(FastStorageImpl *fs) {
+    /* Widen a version 2 hash table to 64-bit offsets. Records are unchanged
+     * and slots keep their positions; the old table becomes dead space. */
+    uint32_t num_slots = fs->header->num_slots;
+    uint64_t offset = (fs->header->data_end + FS_SEGMENT_SIZE - 1) & ~(uint64_t)(FS_SEGMENT_SIZE - 1);
+    uint64_t bytes = (uint64_t)num_slots * sizeof(HashEntry);
+    if (fs_grow_file(fs, offset + bytes) < 0) {
+        return -1;
+    }
+    
+    const HashEntryV2 *old = (const HashEntryV2 *)(fs->mmap_ptr + fs->header->hash_table_offset);
+    HashEntry *table = (HashEntry *)(fs->mmap_ptr + offset);
+    for (uint32_t i = 0; i < num_slots; i++) {
+        table[i].offset = old[i].offset;
+        table[i].hash = old[i].hash;
+        table[i].flags = 0;
+    }
+    
+    fs->header->data_end = offset + bytes;
+    fs->header->hash_table_offset = offset;
+    fs->header->version = FS_VERSION;
+    fs->hash_table = table;
     return 0;
 }
 
@@ -204,258 +597,1604 @@ static int fs_init_header(FastStorageImpl *fs) {
  * HASH TABLE OPERATIONS
  * ============================================================================ */
 
-static int fs_find_slot(FastStorageImpl *fs, const char *key, uint32_t *out_index) {
-    /* Find slot for key using linear probing
-     * Returns: 1 if found (slot contains data), 0 if empty slot, -1 on error
+static int fs_probe(FastStorageImpl *fs, const HashEntry *table, uint32_t num_slots,
+                    const char *key, uint32_t hash, uint32_t *out_index) {
+    /* Find slot for key in table using linear probing
+     * Returns: 1 if found (slot contains data), 0 if free slot (the first
+     * tombstone on the chain, else the terminating empty slot), -1 if full
      */
-    uint32_t hash = fs_hash(key);
-    uint32_t index = hash % fs->header->num_slots;
-    uint32_t probe = 0;
+    size_t key_len = strlen(key) + 1;
+    uint32_t index = hash % num_slots;
+    int64_t reusable = -1;
     
-    while (probe < fs->header->num_slots) {
-        HashEntry *entry = &fs->hash_table[index];
+    for (uint32_t probe = 0; probe < num_slots; probe++) {
+        const HashEntry *entry = &table[index];
         
-        if (entry->offset == 0) {
-            /* Empty slot */
-            *out_index = index;
+        if (entry->offset == FS_SLOT_EMPTY) {
+            *out_index = (reusable >= 0) ? (uint32_t)reusable : index;
             return 0;
         }
         
-        /* Check if this is our key */
-        RecordHeader *rec = (RecordHeader *)(fs->mmap_ptr + entry->offset);
-        if (entry->hash == hash) {
+        if (entry->offset == FS_SLOT_DELETED) {
+            if (reusable < 0) reusable = index;
+        } else if (entry->hash == hash) {
             /* Verify key matches (hash collision check) */
-            char key_buf[FS_KEY_MAX];
-            uint32_t key_len = rec->key_len;
-            if (key_len >= FS_KEY_MAX) key_len = FS_KEY_MAX - 1;
-            memcpy(key_buf, (uint8_t *)rec + sizeof(RecordHeader), key_len);
-            key_buf[key_len] = 0;
-            
-            if (strcmp(key_buf, key) == 0) {
+            const RecordHeader *rec = (const RecordHeader *)(fs->mmap_ptr + entry->offset);
+            if (rec->key_len == key_len && rec->magic != FS_RECORD_CHUNK &&
+                memcmp((const uint8_t *)rec + sizeof(RecordHeader), key, key_len) == 0) {
                 *out_index = index;
                 return 1; /* Found */
             }
         }
         
         /* Linear probing */
-        index = (index + 1) % fs->header->num_slots;
-        probe++;
+        index = (index + 1) % num_slots;
     }
     
+    if (reusable >= 0) {
+        *out_index = (uint32_t)reusable;
+        return 0;
+    }
     return -1; /* Table full */
 }
 
+static inline int fs_find_slot(FastStorageImpl *fs, const char *key, uint32_t *out_index) {
+    return fs_probe(fs, fs->hash_table, fs->header->num_slots, key, fs_hash(key), out_index);
+}
+
 /* ============================================================================
- * PUBLIC API
+ * SEGMENTS
  * ============================================================================ */
 
-FastStorage* faststorage_create(const char *filename, size_t capacity) {
-    if (!filename || capacity < FS_MIN_CAPACITY) {
-        errno = EINVAL;
-        return NULL;
+static inline uint32_t fs_segment_of(uint64_t offset) {
+    return (uint32_t)(offset / FS_SEGMENT_SIZE);
+}
+
+static inline uint64_t fs_segment_align(uint64_t offset) {
+    return (offset + FS_SEGMENT_SIZE - 1) & ~(uint64_t)(FS_SEGMENT_SIZE - 1);
+}
+
+static inline uint32_t fs_record_size(FastStorageImpl *fs, uint64_t offset) {
+    const RecordHeader *rec = (const RecordHeader *)(fs->mmap_ptr + offset);
+    return sizeof(RecordHeader) + rec->key_len + rec->value_len;
+}
+
+static inline BlobHeader *fs_blob_of(FastStorageImpl *fs, uint64_t offset) {
+    /* Blob header of a record, or NULL for an inline value */
+    RecordHeader *rec = (RecordHeader *)(fs->mmap_ptr + offset);
+    if (rec->magic != FS_RECORD_BLOB) return NULL;
+    return (BlobHeader *)((uint8_t *)rec + sizeof(RecordHeader) + rec->key_len);
+}
+
+static inline uint64_t *fs_blob_chunks(BlobHeader *blob) {
+    return (uint64_t *)(blob + 1);
+}
+
+static void fs_account_value(FastStorageImpl *fs, uint64_t offset, int sign) {
+    /* Add (sign 1) or remove (-1) a value and its chunks from live bytes */
+    fs->segments[fs_segment_of(offset)].live += sign * (int32_t)fs_record_size(fs, offset);
+    
+    BlobHeader *blob = fs_blob_of(fs, offset);
+    if (!blob) return;
+    for (uint32_t i = 0; i < blob->num_chunks; i++) {
+        uint64_t chunk = fs_blob_chunks(blob)[i];
+        fs->segments[fs_segment_of(chunk)].live += sign * (int32_t)fs_record_size(fs, chunk);
+    }
+}
+
+static int fs_track_segments(FastStorageImpl *fs, uint64_t end) {
+    /* Extend per-segment state to cover [0, end) of the file */
+    uint32_t count = fs_segment_of(fs_segment_align(end));
+    if (count <= fs->num_segments) return 0;
+    
+    if (count > fs->segments_capacity) {
+        uint32_t capacity = fs->segments_capacity ? fs->segments_capacity * 2 : 16;
+        if (capacity < count) capacity = count;
+        Segment *segments = realloc(fs->segments, capacity * sizeof(Segment));
+        if (!segments) return -1;
+        fs->segments = segments;
+        fs->segments_capacity = capacity;
+    }
+    memset(&fs->segments[fs->num_segments], 0,
+           (count - fs->num_segments) * sizeof(Segment));
+    fs->num_segments = count;
+    return 0;
+}
+
+static void fs_pin_range(FastStorageImpl *fs, uint64_t offset, uint64_t len, uint8_t pinned) {
+    for (uint32_t seg = fs_segment_of(offset); seg <= fs_segment_of(offset + len - 1); seg++) {
+        fs->segments[seg].pinned = pinned;
     }
+}
+
+static int fs_segments_rebuild(FastStorageImpl *fs) {
+    /* Derive segment state from the header and hash table */
+    fs->num_segments = 0;
+    if (fs_track_segments(fs, fs->header->data_end) < 0) return -1;
     
-    FastStorageImpl *fs = calloc(1, sizeof(FastStorageImpl));
-    if (!fs) return NULL;
+    for (uint32_t seg = 0; seg < fs->num_segments; seg++) {
+        fs->segments[seg].state = FS_SEG_SEALED;
+    }
+    fs->segments[0].pinned = 1;
+    fs_pin_range(fs, fs->header->hash_table_offset,
+                 (uint64_t)fs->header->num_slots * sizeof(HashEntry), 1);
+    
+    fs->next_serial = 1;
+    for (uint32_t i = 0; i < fs->header->num_slots; i++) {
+        uint64_t offset = fs->hash_table[i].offset;
+        if (offset <= FS_SLOT_DELETED) continue;
+        
+        fs_account_value(fs, offset, 1);
+        BlobHeader *blob = fs_blob_of(fs, offset);
+        if (blob && blob->serial >= fs->next_serial) {
+            fs->next_serial = blob->serial + 1;
+        }
+    }
     
-    pthread_rwlock_init(&fs->lock, NULL);
+    /* Keep appending behind the last record */
+    fs->active_segment = FS_NO_SEGMENT;
+    fs->append_offset = fs->append_limit = 0;
+    uint64_t data_end = fs->header->data_end;
+    if (data_end % FS_SEGMENT_SIZE != 0) {
+        fs->active_segment = fs_segment_of(data_end);
+        fs->segments[fs->active_segment].state = FS_SEG_OPEN;
+        fs->append_offset = data_end;
+        fs->append_limit = fs_segment_align(data_end);
+    }
     
-    /* Open or create file */
-    fs->fd = open(filename, O_RDWR | O_CREAT | O_NOATIME, 0644);
-    if (fs->fd < 0) {
-        fprintf(stderr, "Cannot open %s: %s\n", filename, strerror(errno));
-        goto error;
+    fs->victim = FS_NO_SEGMENT;
+    return 0;
+}
+
+static int64_t fs_claim_segment(FastStorageImpl *fs) {
+    /* Lowest free segment, else a new one at the end of the log */
+    for (uint32_t seg = 0; seg < fs->num_segments; seg++) {
+        if (fs->segments[seg].state == FS_SEG_FREE) return seg;
     }
     
-    /* Get file size */
-    struct stat st;
-    if (fstat(fs->fd, &st) < 0) {
-        goto error;
+    uint64_t start = fs_segment_align(fs->header->data_end);
+    if (fs_grow_file(fs, start + FS_SEGMENT_SIZE) < 0 ||
+        fs_track_segments(fs, start + FS_SEGMENT_SIZE) < 0) {
+        return -1;
+    }
+    return fs_segment_of(start);
+}
+
+static inline uint64_t fs_align_payload(uint64_t offset) {
+    /* First offset at or after offset whose record payload starts a page */
+    uint64_t payload = (offset + sizeof(RecordHeader) + FS_PAGE_SIZE - 1) & ~(uint64_t)(FS_PAGE_SIZE - 1);
+    return payload - sizeof(RecordHeader);
+}
+
+static int64_t fs_append_alloc(FastStorageImpl *fs, uint32_t size, int page_align) {
+    /* Reserve size bytes in the open segment; page_align places the payload
+     * after the record header on a page boundary so views can map it
+     * Returns: file offset, or -1 when the file cannot grow
+     */
+    uint64_t offset = page_align ? fs_align_payload(fs->append_offset) : fs->append_offset;
+    if (offset + size > fs->append_limit) {
+        if (fs->active_segment != FS_NO_SEGMENT) {
+            fs->segments[fs->active_segment].state = FS_SEG_SEALED;
+            fs->active_segment = FS_NO_SEGMENT;
+        }
+        int64_t seg = fs_claim_segment(fs);
+        if (seg < 0) return -1;
+        
+        fs->segments[seg].state = FS_SEG_OPEN;
+        fs->active_segment = (uint32_t)seg;
+        fs->append_offset = (uint64_t)seg * FS_SEGMENT_SIZE;
+        fs->append_limit = fs->append_offset + FS_SEGMENT_SIZE;
+        offset = page_align ? fs_align_payload(fs->append_offset) : fs->append_offset;
     }
     
-    int is_new = (st.st_size < (off_t)HEADER_SIZE);
+    fs->append_offset = offset + size;
+    if (fs->append_offset > fs->header->data_end) {
+        fs->header->data_end = fs->append_offset;
+    }
+    return (int64_t)offset;
+}
+
+/* ============================================================================
+ * INCREMENTAL REHASHING
+ *
+ * Past FS_HASH_LOAD_FACTOR a table of twice the slots is carved from the
+ * data region and filled FS_REHASH_STEP slots per write, so no write pays
+ * for the whole resize. Until the copy finishes the current table stays
+ * complete: lookups use it alone, the file on disk is always consistent,
+ * and writes to slots the cursor has already passed are mirrored into the
+ * new table. At the step rate the migration ends long before the current
+ * table could fill. Tables occupy whole pinned segments; the old table's
+ * segments are unpinned afterwards and compacted away.
+ * ============================================================================ */
+
+static int fs_rehash_begin(FastStorageImpl *fs) {
+    uint32_t old_slots = fs->header->num_slots;
+    if (old_slots > UINT32_MAX / 2) {
+        errno = ENOSPC;
+        return -1;
+    }
     
-    /* Expand file if needed */
-    fs->file_size = (st.st_size < (off_t)capacity) ? capacity : st.st_size;
-    if (is_new || fs->file_size < capacity) {
-        if (lseek(fs->fd, fs->file_size - 1, SEEK_SET) < 0) {
-            goto error;
+    uint32_t slots = old_slots * 2;
+    size_t bytes = (size_t)slots * sizeof(HashEntry);
+    uint64_t offset = fs_segment_align(fs->header->data_end);
+    uint64_t end = fs_segment_align(offset + bytes);
+    if (fs_grow_file(fs, end) < 0 || fs_track_segments(fs, end) < 0) {
+        return -1;
+    }
+    for (uint32_t seg = fs_segment_of(offset); seg < fs_segment_of(end); seg++) {
+        fs->segments[seg].state = FS_SEG_SEALED;
+    }
+    fs_pin_range(fs, offset, bytes, 1);
+    
+    memset(fs->mmap_ptr + offset, 0, bytes);
+    fs->header->data_end = offset + bytes;
+    fs->rehash_offset = offset;
+    fs->rehash_slots = slots;
+    fs->rehash_cursor = 0;
+    fs->rehash_table = (HashEntry *)(fs->mmap_ptr + offset);
+    return 0;
+}
+
+static void fs_rehash_step(FastStorageImpl *fs, uint32_t budget) {
+    /* Copy up to budget slots of the current table; switch when done */
+    uint32_t old_slots = fs->header->num_slots;
+    
+    while (budget-- > 0 && fs->rehash_cursor < old_slots) {
+        HashEntry entry = fs->hash_table[fs->rehash_cursor++];
+        if (entry.offset <= FS_SLOT_DELETED) continue;
+        
+        /* Not in the new table yet: writes only mirror passed slots */
+        uint32_t index = entry.hash % fs->rehash_slots;
+        while (fs->rehash_table[index].offset > FS_SLOT_DELETED) {
+            index = (index + 1) % fs->rehash_slots;
         }
-        if (write(fs->fd, "", 1) != 1) {
-            goto error;
+        fs->rehash_table[index] = entry;
+    }
+    
+    if (fs->rehash_cursor == old_slots) {
+        /* The old table's segments are dead now (segment 0 keeps the header) */
+        fs_pin_range(fs, fs->header->hash_table_offset,
+                     (uint64_t)old_slots * sizeof(HashEntry), 0);
+        fs->segments[0].pinned = 1;
+        
+        fs->header->hash_table_offset = fs->rehash_offset;
+        fs->header->num_slots = fs->rehash_slots;
+        fs->hash_table = fs->rehash_table;
+        fs->rehash_table = NULL;
+        fs->rehash_slots = 0;
+        fs->rehash_cursor = 0;
+        fs->rehashes++;
+    }
+}
+
+static void fs_rehash_mirror(FastStorageImpl *fs, uint32_t slot_idx, const char *key) {
+    /* Apply a change to an already-copied slot to the new table as well */
+    if (!fs->rehash_table || slot_idx >= fs->rehash_cursor) return;
+    
+    const HashEntry *entry = &fs->hash_table[slot_idx];
+    uint32_t index;
+    int status = fs_probe(fs, fs->rehash_table, fs->rehash_slots, key, entry->hash, &index);
+    if (status == 1 || (status == 0 && entry->offset != FS_SLOT_DELETED)) {
+        fs->rehash_table[index] = *entry;
+    }
+}
+
+/* ============================================================================
+ * COMPACTION
+ *
+ * The emptiest sealed segment at most FS_COMPACT_THRESHOLD live is the
+ * victim. One pass over the hash table moves every record overlapping it to
+ * the open segment and repoints the slot, or the chunk offset in its blob;
+ * records are immutable once written, so the copy is byte-for-byte. Chunks
+ * of blobs still being streamed in are moved too. Writes never target a sealed
+ * segment, so after the pass it holds nothing live and is punched out and
+ * reused. Work is split into FS_COMPACT_BATCH-slot lock holds, keeping the
+ * time a reader can wait on the compactor short and bounded.
+ * ============================================================================ */
+
+static uint32_t fs_pick_victim(FastStorageImpl *fs) {
+    uint32_t best = FS_NO_SEGMENT;
+    uint32_t best_live = (uint32_t)(FS_SEGMENT_SIZE * FS_COMPACT_THRESHOLD) + 1;
+    
+    for (uint32_t seg = 0; seg < fs->num_segments; seg++) {
+        const Segment *s = &fs->segments[seg];
+        if (s->state == FS_SEG_SEALED && !s->pinned && s->live < best_live) {
+            best = seg;
+            best_live = s->live;
+        }
+    }
+    return best;
+}
+
+static inline int fs_overlaps(FastStorageImpl *fs, uint64_t offset, uint64_t start, uint64_t end) {
+    /* Records from older layouts may straddle into [start, end) */
+    if (offset <= FS_SLOT_DELETED || offset >= end || offset + FS_SEGMENT_SIZE <= start) {
+        return 0;
+    }
+    return offset + fs_record_size(fs, offset) > start;
+}
+
+static int64_t fs_move_record(FastStorageImpl *fs, uint64_t offset, size_t *moved) {
+    /* Copy a record to the open segment
+     * Returns: new offset, or -1 when the file cannot grow
+     */
+    uint32_t size = fs_record_size(fs, offset);
+    int page_align = ((const RecordHeader *)(fs->mmap_ptr + offset))->magic == FS_RECORD_CHUNK;
+    int64_t target = fs_append_alloc(fs, size, page_align);
+    if (target < 0) return -1;
+    
+    memcpy(fs->mmap_ptr + target, fs->mmap_ptr + offset, size);
+    fs->segments[fs_segment_of(offset)].live -= size;
+    fs->segments[fs_segment_of(target)].live += size;
+    *moved += size;
+    return target;
+}
+
+static int fs_move_chunks(FastStorageImpl *fs, uint64_t blob_offset, uint64_t start, uint64_t end,
+                          size_t *moved) {
+    /* Move a blob's chunks out of [start, end); the blob may move meanwhile:
+     * re-derive it from blob_offset after every allocation */
+    uint32_t num_chunks = fs_blob_of(fs, blob_offset)->num_chunks;
+    int result = 0;
+    int changed = 0;
+    for (uint32_t i = 0; i < num_chunks; i++) {
+        uint64_t chunk = fs_blob_chunks(fs_blob_of(fs, blob_offset))[i];
+        if (!fs_overlaps(fs, chunk, start, end)) continue;
+        
+        int64_t target = fs_move_record(fs, chunk, moved);
+        if (target < 0) {
+            result = -1;
+            break;
+        }
+        fs_blob_chunks(fs_blob_of(fs, blob_offset))[i] = (uint64_t)target;
+        changed = 1;
+    }
+    if (changed) {
+        /* The chunk list is part of the blob record's checksum */
+        RecordHeader *rec = (RecordHeader *)(fs->mmap_ptr + blob_offset);
+        if (rec->crc) rec->crc = fs_record_crc(rec);
+    }
+    return result;
+}
+
+static int fs_compact_batch(FastStorageImpl *fs, uint32_t budget, size_t *moved) {
+    /* Check up to budget hash slots for records in the victim
+     * Returns: 1 if work was done, 0 if nothing needs compacting, -1 on error
+     */
+    fs_reclaim_locked(fs);
+    if (fs->victim == FS_NO_SEGMENT) {
+        fs->victim = fs_pick_victim(fs);
+        if (fs->victim == FS_NO_SEGMENT) return 0;
+        fs->victim_cursor = 0;
+        fs->victim_table = fs->header->hash_table_offset;
+    }
+    if (fs->victim_table != fs->header->hash_table_offset) {
+        /* A rehash switched tables mid-pass: start over on the new one */
+        fs->victim_cursor = 0;
+        fs->victim_table = fs->header->hash_table_offset;
+    }
+    
+    uint64_t start = (uint64_t)fs->victim * FS_SEGMENT_SIZE;
+    uint64_t end = start + FS_SEGMENT_SIZE;
+    uint32_t num_slots = fs->header->num_slots;
+    uint32_t last = (num_slots - fs->victim_cursor > budget) ? fs->victim_cursor + budget : num_slots;
+    
+    for (uint32_t i = fs->victim_cursor; i < last; i++) {
+        HashEntry entry = fs->hash_table[i];
+        if (entry.offset <= FS_SLOT_DELETED) continue;
+        
+        if (fs_overlaps(fs, entry.offset, start, end)) {
+            int64_t offset = fs_move_record(fs, entry.offset, moved);
+            if (offset < 0) {
+                fs->victim_cursor = i;
+                return -1;
+            }
+            fs->hash_table[i].offset = (uint64_t)offset;
+            fs_rehash_mirror(fs, i, (const char *)(fs->mmap_ptr + offset + sizeof(RecordHeader)));
+        }
+        if ((entry.flags & FS_ENTRY_BLOB) &&
+            fs_move_chunks(fs, fs->hash_table[i].offset, start, end, moved) < 0) {
+            fs->victim_cursor = i;
+            return -1;
+        }
+    }
+    fs->victim_cursor = last;
+    
+    if (last == num_slots) {
+        for (Stream *stream = fs->streams; stream; stream = stream->next) {
+            for (uint32_t i = 0; i < stream->count; i++) {
+                if (!fs_overlaps(fs, stream->chunks[i], start, end)) continue;
+                int64_t offset = fs_move_record(fs, stream->chunks[i], moved);
+                if (offset < 0) return -1;
+                stream->chunks[i] = (uint64_t)offset;
+            }
+        }
+        
+        /* Views may still point into it: punch it once they are released.
+         * If that can't be recorded it stays sealed and is picked again */
+        if (!__atomic_load_n(&fs->active_views, __ATOMIC_ACQUIRE)) {
+            fs_free_segment(fs, fs->victim);
+            fs->compactions++;
+        } else if (fs_retire(fs, fs->victim) == 0) {
+            fs->segments[fs->victim].state = FS_SEG_RETIRED;
+            fs->segments[fs->victim].live = 0;
+            fs->compactions++;
+        }
+        fs->victim = FS_NO_SEGMENT;
+    }
+    return 1;
+}
+
+static int fs_compact_tick(FastStorageImpl *fs) {
+    /* One tick of bounded compaction work */
+    uint32_t slots = 0;
+    size_t moved = 0;
+    
+    while (slots < FS_COMPACT_SLOTS && moved < FS_COMPACT_BYTES) {
+        fs_write_lock(fs);
+        int result = fs_compact_batch(fs, FS_COMPACT_BATCH, &moved);
+        fs_write_unlock(fs);
+        if (result <= 0) return result;
+        slots += FS_COMPACT_BATCH;
+    }
+    return 1;
+}
+
+static void *fs_compactor_main(void *arg) {
+    FastStorageImpl *fs = arg;
+    struct timespec tick = { 0, FS_COMPACT_INTERVAL_MS * 1000000L };
+    
+    while (!__atomic_load_n(&fs->compactor_stop, __ATOMIC_ACQUIRE)) {
+        if (fs->num_shards) {
+            for (uint32_t i = 0; i < fs->num_shards; i++) {
+                fs_compact_tick(fs->shards[i]);
+            }
+        } else {
+            fs_compact_tick(fs);
+        }
+        nanosleep(&tick, NULL);
+    }
+    return NULL;
+}
+
+/* ============================================================================
+ * CRASH RECOVERY
+ *
+ * Records carry a CRC-32C of their header fields, key and value. The file
+ * header's checksum doubles as a clean-shutdown mark: it is zeroed on disk
+ * as soon as a store is opened, and written again by faststorage_destroy()
+ * only after the file is synced. A store opened without the mark is
+ * checked. The segment holding data_end is scanned forward from its first
+ * record and cut at the first record that is torn or fails its checksum;
+ * the header's data_end may be stale either way, so the cut replaces it.
+ * Then every slot whose record or chunks are damaged, or lie past the cut,
+ * becomes a tombstone. Records from before checksums (crc 0) are trusted.
+ * ============================================================================ */
+
+static int fs_record_intact(FastStorageImpl *fs, uint64_t offset, uint64_t limit) {
+    /* Record at offset is well-formed, ends by limit and matches its checksum */
+    if (offset < HEADER_SIZE || offset > limit || limit - offset < sizeof(RecordHeader)) return 0;
+    
+    const RecordHeader *rec = (const RecordHeader *)(fs->mmap_ptr + offset);
+    if (rec->magic != FS_RECORD_INLINE && rec->magic != FS_RECORD_BLOB &&
+        rec->magic != FS_RECORD_CHUNK) {
+        return 0;
+    }
+    if (rec->key_len > FS_KEY_MAX || (rec->magic == FS_RECORD_CHUNK) != (rec->key_len == 0) ||
+        (uint64_t)rec->key_len + rec->value_len > limit - offset - sizeof(RecordHeader)) {
+        return 0;
+    }
+    return rec->crc == 0 || rec->crc == fs_record_crc(rec);
+}
+
+static inline uint64_t fs_recover_limit(FastStorageImpl *fs, uint64_t offset, uint64_t tail, uint64_t cut) {
+    /* Where a record at offset must end: records past the cut are lost */
+    if (offset < tail) return fs->file_size;
+    return (offset < cut) ? cut : 0;
+}
+
+static int fs_slot_intact(FastStorageImpl *fs, const HashEntry *entry, uint64_t tail, uint64_t cut) {
+    /* A slot's record, and every chunk of a blob, is intact and before the cut */
+    uint64_t offset = entry->offset;
+    if (!fs_record_intact(fs, offset, fs_recover_limit(fs, offset, tail, cut))) return 0;
+    
+    const RecordHeader *rec = (const RecordHeader *)(fs->mmap_ptr + offset);
+    const char *key = (const char *)(rec + 1);
+    if (rec->magic == FS_RECORD_CHUNK || key[rec->key_len - 1] != '\0' ||
+        fs_hash(key) != entry->hash ||
+        ((entry->flags & FS_ENTRY_BLOB) != 0) != (rec->magic == FS_RECORD_BLOB)) {
+        return 0;
+    }
+    if (rec->magic != FS_RECORD_BLOB) return 1;
+    
+    const BlobHeader *blob = (const BlobHeader *)(key + rec->key_len);
+    if (rec->value_len < sizeof(BlobHeader) ||
+        rec->value_len != sizeof(BlobHeader) + (uint64_t)blob->num_chunks * sizeof(uint64_t)) {
+        return 0;
+    }
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < blob->num_chunks; i++) {
+        uint64_t chunk = ((const uint64_t *)(blob + 1))[i];
+        if (!fs_record_intact(fs, chunk, fs_recover_limit(fs, chunk, tail, cut)) ||
+            ((const RecordHeader *)(fs->mmap_ptr + chunk))->magic != FS_RECORD_CHUNK) {
+            return 0;
+        }
+        total += ((const RecordHeader *)(fs->mmap_ptr + chunk))->value_len;
+    }
+    return total == blob->total_len;
+}
+
+static void fs_recover(FastStorageImpl *fs, const char *filename) {
+    FileHeader *hdr = fs->header;
+    uint64_t table_end = hdr->hash_table_offset + (uint64_t)hdr->num_slots * sizeof(HashEntry);
+    uint64_t data_end = (hdr->data_end < fs->file_size) ? hdr->data_end : fs->file_size;
+    uint64_t tail = data_end / FS_SEGMENT_SIZE * FS_SEGMENT_SIZE;
+    uint64_t tail_end = (tail + FS_SEGMENT_SIZE < fs->file_size) ? tail + FS_SEGMENT_SIZE : fs->file_size;
+    
+    /* The tail's first record follows the header, a table, or a record
+     * from an older layout straddling in from the segment before */
+    uint64_t pos = (tail > HEADER_SIZE) ? tail : HEADER_SIZE;
+    if (hdr->hash_table_offset < tail_end && table_end > pos) pos = table_end;
+    for (uint32_t i = 0; i < hdr->num_slots; i++) {
+        uint64_t offset = fs->hash_table[i].offset;
+        if (offset > FS_SLOT_DELETED && offset < tail && offset + FS_SEGMENT_SIZE > tail &&
+            fs_record_intact(fs, offset, fs->file_size) &&
+            offset + fs_record_size(fs, offset) > pos) {
+            pos = offset + fs_record_size(fs, offset);
+        }
+    }
+    
+    /* Scan forward; zeros before a record are the gap of a page-aligned chunk */
+    uint64_t cut = pos;
+    while (pos < tail_end) {
+        if (tail_end - pos >= sizeof(RecordHeader) &&
+            ((const RecordHeader *)(fs->mmap_ptr + pos))->magic == 0) {
+            uint64_t next = fs_align_payload(pos);
+            if (next == pos) break;
+            pos = next;
+            continue;
+        }
+        if (!fs_record_intact(fs, pos, tail_end)) break;
+        pos += fs_record_size(fs, pos);
+        cut = pos;
+    }
+    if (cut < tail_end) {
+        fs_release_range(fs, cut, tail_end - cut);
+    }
+    hdr->data_end = cut;
+    
+    uint32_t dropped = 0, entries = 0;
+    for (uint32_t i = 0; i < hdr->num_slots; i++) {
+        if (fs->hash_table[i].offset <= FS_SLOT_DELETED) continue;
+        if (fs_slot_intact(fs, &fs->hash_table[i], tail, cut)) {
+            entries++;
+        } else {
+            fs->hash_table[i].offset = FS_SLOT_DELETED;
+            dropped++;
+        }
+    }
+    hdr->num_entries = entries;
+    fs->dropped += dropped;
+    if (dropped) {
+        fprintf(stderr, "%s was not closed cleanly: dropped %u damaged record(s)\n", filename, dropped);
+    }
+}
+
+/* ============================================================================
+ * DURABILITY
+ *
+ * SYNC mode syncs in the calling thread after each mutation leaves the
+ * write lock. ASYNC and GROUP run a flusher thread per handle - for a
+ * sharded handle one thread serves every shard - that wakes each interval
+ * and starts writeback (ASYNC) or syncs (GROUP) every store whose seq moved
+ * since its last round. faststorage_sync() in GROUP mode waits for the end
+ * of a round that started after it was called, so it costs no sync of its
+ * own. Records are written through the mapping; fdatasync() covers its
+ * dirty pages.
+ * ============================================================================ */
+
+static void fs_count_sync(FastStorageImpl *fs) {
+    __atomic_add_fetch(&fs->syncs, 1, __ATOMIC_RELAXED);
+}
+
+static int fs_commit(FastStorageImpl *fs) {
+    /* After a mutation, outside the lock: sync it in SYNC mode */
+    if (__atomic_load_n(&fs->durability, __ATOMIC_RELAXED) != FASTSTORAGE_DURABILITY_SYNC) return 0;
+    fs_count_sync(fs);
+    return fdatasync(fs->fd);
+}
+
+static void fs_flush_store(FastStorageImpl *fs, int mode) {
+    uint32_t seq = __atomic_load_n(&fs->seq, __ATOMIC_ACQUIRE);
+    if (seq == fs->flushed_seq) return;
+    
+    int result;
+    if (mode == FASTSTORAGE_DURABILITY_ASYNC) {
+        result = sync_file_range(fs->fd, 0, 0, SYNC_FILE_RANGE_WRITE);
+    } else {
+        result = fdatasync(fs->fd);
+        fs_count_sync(fs);
+    }
+    if (result == 0) fs->flushed_seq = seq;
+}
+
+static void fs_flush_round(FastStorageImpl *fs) {
+    /* Called with commit_lock held, which is dropped while syncing */
+    uint64_t round = ++fs->rounds_started;
+    pthread_mutex_unlock(&fs->commit_lock);
+    
+    if (fs->num_shards) {
+        for (uint32_t i = 0; i < fs->num_shards; i++) {
+            fs_flush_store(fs->shards[i], fs->durability);
+        }
+    } else {
+        fs_flush_store(fs, fs->durability);
+    }
+    
+    pthread_mutex_lock(&fs->commit_lock);
+    fs->rounds_done = round;
+    pthread_cond_broadcast(&fs->commit_cond);
+}
+
+static void *fs_flusher_main(void *arg) {
+    FastStorageImpl *fs = arg;
+    
+    pthread_mutex_lock(&fs->commit_lock);
+    while (!fs->flusher_stop) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_nsec += (long)fs->flush_interval_ms * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        
+        /* Woken early by stop, and by rounds finishing (our own broadcasts) */
+        while (!fs->flusher_stop &&
+               pthread_cond_timedwait(&fs->commit_cond, &fs->commit_lock, &deadline) != ETIMEDOUT) {
+        }
+        fs_flush_round(fs);
+    }
+    pthread_mutex_unlock(&fs->commit_lock);
+    return NULL;
+}
+
+static void fs_stop_flusher(FastStorageImpl *fs) {
+    /* The flusher ends with a round, releasing any faststorage_sync() waiters */
+    if (!fs->flusher_running) return;
+    
+    pthread_mutex_lock(&fs->commit_lock);
+    fs->flusher_stop = 1;
+    pthread_cond_broadcast(&fs->commit_cond);
+    pthread_mutex_unlock(&fs->commit_lock);
+    pthread_join(fs->flusher, NULL);
+    
+    pthread_mutex_lock(&fs->commit_lock);
+    fs->flusher_running = 0;
+    fs->flusher_stop = 0;
+    pthread_cond_broadcast(&fs->commit_cond);
+    pthread_mutex_unlock(&fs->commit_lock);
+}
+
+static void fs_init_commit(FastStorageImpl *fs) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&fs->commit_cond, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&fs->commit_lock, NULL);
+}
+
+/* ============================================================================
+ * SHARDING
+ *
+ * A sharded handle is a router over num_shards complete stores, one file
+ * each. A key's shard comes from the high half of its 64-bit hash; the slot
+ * hash folds that with the independent low half, so keys stay spread over
+ * each shard's table. Keyed calls re-point fs at the shard and proceed as
+ * usual, so writers to different shards share no lock, append cursor or
+ * cache line. Calls without a key visit every shard. One compactor thread,
+ * the router's, works through all of them.
+ * ============================================================================ */
+
+static inline uint32_t fs_shard_of(const FastStorageImpl *fs, const char *key) {
+    uint64_t h = mw_hash64(key, strlen(key));
+    return (uint32_t)((h >> 32) % fs->num_shards);
+}
+
+static inline FastStorageImpl *fs_route(FastStorageImpl *fs, const char *key) {
+    return fs->num_shards ? fs->shards[fs_shard_of(fs, key)] : fs;
+}
+
+/* ============================================================================
+ * PUBLIC API
+ * ============================================================================ */
+
+static FastStorageImpl *fs_open(const char *filename, size_t capacity, uint32_t shards) {
+    /* Open or create one store file, shards being the size of its set
+     * (0 for a plain store); the caller starts compaction */
+    FastStorageImpl *fs = calloc(1, sizeof(FastStorageImpl));
+    if (!fs) return NULL;
+    
+    fs->reads = aligned_alloc(64, FS_READ_STRIPES * FS_STRIPE_WORDS * sizeof(uint64_t));
+    if (!fs->reads) {
+        free(fs);
+        return NULL;
+    }
+    memset(fs->reads, 0, FS_READ_STRIPES * FS_STRIPE_WORDS * sizeof(uint64_t));
+    
+    pthread_rwlock_init(&fs->lock, NULL);
+    pthread_mutex_init(&fs->view_lock, NULL);
+    fs_init_commit(fs);
+    fs->epoch = 1;
+    
+    /* Open or create file */
+    fs->fd = open(filename, O_RDWR | O_CREAT | O_NOATIME, 0644);
+    if (fs->fd < 0) {
+        fprintf(stderr, "Cannot open %s: %s\n", filename, strerror(errno));
+        goto error;
+    }
+    
+    /* Get file size */
+    struct stat st;
+    if (fstat(fs->fd, &st) < 0) {
+        goto error;
+    }
+    
+    int is_new = (st.st_size < (off_t)HEADER_SIZE);
+    
+    /* Expand file if needed */
+    fs->file_size = (st.st_size < (off_t)capacity) ? capacity : st.st_size;
+    if (is_new || st.st_size < (off_t)fs->file_size) {
+        if (lseek(fs->fd, fs->file_size - 1, SEEK_SET) < 0) {
+            goto error;
+        }
+        if (write(fs->fd, "", 1) != 1) {
+            goto error;
+        }
+    }
+    
+    /* Memory map the file */
+    fs->mmap_ptr = mmap(NULL, fs->file_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fs->fd, 0);
+    if (fs->mmap_ptr == MAP_FAILED) {
+        fprintf(stderr, "Cannot mmap %s: %s\n", filename, strerror(errno));
+        goto error;
+    }
+    
+    /* Lock in memory */
+    mlock(fs->mmap_ptr, fs->file_size);
+    
+    /* Prefault all pages */
+    fs_prefault_range(fs->mmap_ptr, fs->file_size);
+    
+    fs->header = (FileHeader *)fs->mmap_ptr;
+    
+    if (is_new) {
+        /* Initialize new file */
+        if (fs_init_header(fs) < 0) {
+            goto error;
+        }
+        fs->header->shards = shards;
+        fsync(fs->fd);
+    } else {
+        /* Validate existing file */
+        if (fs->header->magic != FS_MAGIC) {
+            fprintf(stderr, "Invalid faststore file (bad magic)\n");
+            goto error;
+        }
+        
+        if (fs->header->version == FS_VERSION_V2) {
+            if (fs_upgrade_v2(fs) < 0) {
+                fprintf(stderr, "Cannot upgrade faststore file to version %d\n", FS_VERSION);
+                goto error;
+            }
+        } else if (fs->header->version != FS_VERSION) {
+            fprintf(stderr, "Unsupported faststore version\n");
+            goto error;
+        }
+        
+        if (fs->header->shards != shards) {
+            fprintf(stderr, "%s belongs to a set of %u shards, opened as %u\n",
+                    filename, fs->header->shards, shards);
+            errno = EINVAL;
+            goto error;
+        }
+        
+        fs->hash_table = (HashEntry *)(fs->mmap_ptr + fs->header->hash_table_offset);
+        
+        if (fs->header->crc32 == 0 || fs->header->crc32 != fs_header_crc(fs->header)) {
+            fs_recover(fs, filename);
+        }
+    }
+    
+    if (fs_segments_rebuild(fs) < 0) {
+        goto error;
+    }
+    
+    /* Not clean from here on: the mark must be on disk before any record */
+    if (fs->header->crc32 != 0) {
+        fs->header->crc32 = 0;
+        msync(fs->mmap_ptr, FS_PAGE_SIZE, MS_SYNC);
+    }
+    
+    return fs;
+
+error:
+    {
+        int saved = errno;
+        if (fs->mmap_ptr && fs->mmap_ptr != MAP_FAILED) {
+            munmap(fs->mmap_ptr, fs->file_size);
+        }
+        if (fs->fd >= 0) {
+            close(fs->fd);
+        }
+        pthread_rwlock_destroy(&fs->lock);
+        pthread_mutex_destroy(&fs->view_lock);
+        pthread_mutex_destroy(&fs->commit_lock);
+        pthread_cond_destroy(&fs->commit_cond);
+        free(fs->segments);
+        free(fs->reads);
+        free(fs);
+        errno = saved;
+    }
+    return NULL;
+}
+
+FastStorage* faststorage_create(const char *filename, size_t capacity) {
+    if (!filename || capacity < FS_MIN_CAPACITY) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    FastStorageImpl *fs = fs_open(filename, capacity, 0);
+    if (!fs) return NULL;
+    
+    /* Without the thread compaction still runs through faststorage_compact() */
+    fs->compactor_running = (pthread_create(&fs->compactor, NULL, fs_compactor_main, fs) == 0);
+    
+    return (FastStorage *)fs;
+}
+
+FastStorage* faststorage_create_sharded(const char *filename, size_t capacity, uint32_t num_shards) {
+    if (!filename || capacity < FS_MIN_CAPACITY || num_shards == 0 || num_shards > FS_MAX_SHARDS) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    size_t shard_capacity = capacity / num_shards;
+    if (shard_capacity < FS_MIN_CAPACITY) shard_capacity = FS_MIN_CAPACITY;
+    
+    size_t path_len = strlen(filename) + 16;
+    char *path = malloc(path_len);
+    FastStorageImpl *fs = calloc(1, sizeof(FastStorageImpl));
+    FastStorageImpl **shards = calloc(num_shards, sizeof(FastStorageImpl *));
+    if (!path || !fs || !shards) {
+        free(path);
+        free(fs);
+        free(shards);
+        errno = ENOMEM;
+        return NULL;
+    }
+    fs->fd = -1;
+    fs->shards = shards;
+    fs->num_shards = num_shards;
+    fs_init_commit(fs);
+    
+    for (uint32_t i = 0; i < num_shards; i++) {
+        snprintf(path, path_len, "%s.%u", filename, i);
+        fs->shards[i] = fs_open(path, shard_capacity, num_shards);
+        if (!fs->shards[i]) {
+            int saved = errno;
+            faststorage_destroy((FastStorage *)fs);
+            free(path);
+            errno = saved;
+            return NULL;
+        }
+    }
+    free(path);
+    
+    fs->compactor_running = (pthread_create(&fs->compactor, NULL, fs_compactor_main, fs) == 0);
+    return (FastStorage *)fs;
+}
+
+void faststorage_destroy(FastStorage *storage) {
+    if (!storage) return;
+    
+    FastStorageImpl *fs = (FastStorageImpl *)storage;
+    
+    fs_stop_flusher(fs);
+    if (fs->compactor_running) {
+        __atomic_store_n(&fs->compactor_stop, 1, __ATOMIC_RELEASE);
+        pthread_join(fs->compactor, NULL);
+    }
+    
+    if (fs->num_shards) {
+        for (uint32_t i = 0; i < fs->num_shards; i++) {
+            faststorage_destroy((FastStorage *)fs->shards[i]);
+        }
+        pthread_mutex_destroy(&fs->commit_lock);
+        pthread_cond_destroy(&fs->commit_cond);
+        free(fs->shards);
+        free(fs);
+        return;
+    }
+    
+    /* Clean shutdown: the mark goes in only once everything else is on disk */
+    if (fdatasync(fs->fd) == 0) {
+        fs->header->crc32 = fs_header_crc(fs->header);
+    }
+    faststorage_flush(storage);
+    
+    /* Views left unreleased die with the store */
+    for (uint32_t i = 0; i < fs->views_capacity; i++) {
+        if (fs->views[i].map) munmap(fs->views[i].map, fs->views[i].map_len);
+        free(fs->views[i].copy);
+    }
+    while (fs->retired) {
+        Retired *item = fs->retired;
+        fs->retired = item->next;
+        free(item);
+    }
+    while (fs->mappings) {
+        Retired *item = fs->mappings;
+        fs->mappings = item->next;
+        munmap(item->map, item->map_len);
+        free(item);
+    }
+    
+    if (fs->mmap_ptr && fs->mmap_ptr != MAP_FAILED) {
+        munlock(fs->mmap_ptr, fs->file_size);
+        munmap(fs->mmap_ptr, fs->file_size);
+    }
+    
+    if (fs->fd >= 0) {
+        close(fs->fd);
+    }
+    
+    pthread_rwlock_destroy(&fs->lock);
+    pthread_mutex_destroy(&fs->view_lock);
+    pthread_mutex_destroy(&fs->commit_lock);
+    pthread_cond_destroy(&fs->commit_cond);
+    free(fs->views);
+    free(fs->segments);
+    free(fs->reads);
+    free(fs);
+}
+
+static int fs_put_locked(FastStorageImpl *fs, const char *key, size_t key_len, uint32_t magic,
+                         const void *head, size_t head_len, const void *body, size_t body_len) {
+    /* Append a record whose value is head then body and point key at it.
+     * Called with the write lock held; any value the key had becomes dead.
+     */
+    uint32_t hash = fs_hash(key);
+    if (fs->rehash_table) {
+        fs_rehash_step(fs, FS_REHASH_STEP);
+    }
+    
+    /* Find or allocate slot */
+    uint32_t slot_idx;
+    int slot_status = fs_probe(fs, fs->hash_table, fs->header->num_slots, key, hash, &slot_idx);
+    if (slot_status == 0 && !fs->rehash_table &&
+        fs->header->num_entries + 1 > fs->header->num_slots * FS_HASH_LOAD_FACTOR) {
+        /* Best effort: the current table still has room if this fails */
+        fs_rehash_begin(fs);
+    }
+    if (slot_status < 0) {
+        /* Table full - finish a resize on the spot */
+        if (!fs->rehash_table && fs_rehash_begin(fs) < 0) {
+            errno = ENOSPC;
+            return -1;
+        }
+        fs_rehash_step(fs, UINT32_MAX);
+        slot_status = fs_probe(fs, fs->hash_table, fs->header->num_slots, key, hash, &slot_idx);
+    }
+    
+    /* Allocate space for record */
+    uint32_t record_size = sizeof(RecordHeader) + key_len + head_len + body_len;
+    int64_t record_offset = fs_append_alloc(fs, record_size, 0);
+    if (record_offset < 0) {
+        return -1;
+    }
+    
+    /* Write record */
+    uint8_t *record_ptr = fs->mmap_ptr + record_offset;
+    RecordHeader *hdr = (RecordHeader *)record_ptr;
+    hdr->magic = magic;
+    hdr->key_len = key_len;
+    hdr->value_len = head_len + body_len;
+    
+    uint8_t *value_ptr = record_ptr + sizeof(RecordHeader) + key_len;
+    memcpy(record_ptr + sizeof(RecordHeader), key, key_len);
+    memcpy(value_ptr, head, head_len);
+    if (body_len) {
+        memcpy(value_ptr + head_len, body, body_len);
+    }
+    hdr->crc = fs_record_crc(hdr);
+    
+    /* Update hash table; an overwritten value becomes dead space */
+    if (slot_status == 1) {
+        fs_account_value(fs, fs->hash_table[slot_idx].offset, -1);
+    } else {
+        fs->header->num_entries++;
+    }
+    fs->segments[fs_segment_of(record_offset)].live += record_size;
+    fs->hash_table[slot_idx].offset = (uint64_t)record_offset;
+    fs->hash_table[slot_idx].hash = hash;
+    fs->hash_table[slot_idx].flags = (magic == FS_RECORD_BLOB) ? FS_ENTRY_BLOB : 0;
+    fs_rehash_mirror(fs, slot_idx, key);
+    
+    fs->writes++;
+    return 0;
+}
+
+typedef struct {
+    const uint8_t *data;
+    size_t left;
+} MemorySource;
+
+static ssize_t fs_memory_source(void *ctx, void *buf, size_t len) {
+    MemorySource *src = ctx;
+    if (len > src->left) len = src->left;
+    memcpy(buf, src->data, len);
+    src->data += len;
+    src->left -= len;
+    return (ssize_t)len;
+}
+
+int faststorage_write(FastStorage *storage, const char *key, const void *value, size_t value_len) {
+    if (!storage || !key || !value) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    if (value_len > FS_INLINE_MAX) {
+        MemorySource src = { value, value_len };
+        return faststorage_write_stream(storage, key, value_len, fs_memory_source, &src);
+    }
+    
+    size_t key_len = strlen(key) + 1;
+    if (key_len > FS_KEY_MAX) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    
+    FastStorageImpl *fs = fs_route((FastStorageImpl *)storage, key);
+    fs_write_lock(fs);
+    int result = fs_put_locked(fs, key, key_len, FS_RECORD_INLINE, value, value_len, NULL, 0);
+    fs_write_unlock(fs);
+    
+    if (result == 0 && fs_commit(fs) < 0) return -1;
+    return result;
+}
+
+static int fs_write_batch(FastStorageImpl *fs, const FastStorageBatchEntry *entries, size_t count) {
+    /* Inline values go in under one lock hold, which large ones interrupt
+     * to stream in between */
+    int result = 0;
+    size_t i = 0;
+    while (i < count && result == 0) {
+        fs_write_lock(fs);
+        for (; i < count; i++) {
+            const FastStorageBatchEntry *e = &entries[i];
+            if (!e->key || !e->value) {
+                errno = EINVAL;
+                result = -1;
+                break;
+            }
+            if (e->value_len > FS_INLINE_MAX) break;
+            
+            size_t key_len = strlen(e->key) + 1;
+            if (key_len > FS_KEY_MAX) {
+                errno = ENAMETOOLONG;
+                result = -1;
+                break;
+            }
+            if (fs_put_locked(fs, e->key, key_len, FS_RECORD_INLINE, e->value, e->value_len, NULL, 0) < 0) {
+                result = -1;
+                break;
+            }
+        }
+        fs_write_unlock(fs);
+        
+        if (result == 0 && i < count) {
+            MemorySource src = { entries[i].value, entries[i].value_len };
+            result = faststorage_write_stream((FastStorage *)fs, entries[i].key, entries[i].value_len,
+                                              fs_memory_source, &src);
+            i++;
+        }
+    }
+    
+    /* One sync covers whatever made it in */
+    if (fs_commit(fs) < 0) result = -1;
+    return result;
+}
+
+int faststorage_write_batch(FastStorage *storage, const FastStorageBatchEntry *entries, size_t count) {
+    if (!storage || (!entries && count)) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    FastStorageImpl *fs = (FastStorageImpl *)storage;
+    if (!fs->num_shards) {
+        return fs_write_batch(fs, entries, count);
+    }
+    
+    /* Split by shard, keeping each shard's entries in order */
+    uint32_t *shard_of = malloc(count * sizeof(uint32_t) + 1);
+    FastStorageBatchEntry *sorted = malloc(count * sizeof(FastStorageBatchEntry) + 1);
+    size_t *start = calloc(fs->num_shards + 1, sizeof(size_t));
+    if (!shard_of || !sorted || !start) {
+        free(shard_of);
+        free(sorted);
+        free(start);
+        errno = ENOMEM;
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        shard_of[i] = entries[i].key ? fs_shard_of(fs, entries[i].key) : 0;
+        start[shard_of[i] + 1]++;
+    }
+    for (uint32_t s = 0; s < fs->num_shards; s++) {
+        start[s + 1] += start[s];
+    }
+    size_t *fill = calloc(fs->num_shards, sizeof(size_t));
+    if (!fill) {
+        free(shard_of);
+        free(sorted);
+        free(start);
+        errno = ENOMEM;
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        sorted[start[shard_of[i]] + fill[shard_of[i]]++] = entries[i];
+    }
+    
+    int result = 0;
+    for (uint32_t s = 0; s < fs->num_shards; s++) {
+        if (start[s + 1] > start[s] &&
+            fs_write_batch(fs->shards[s], sorted + start[s], start[s + 1] - start[s]) < 0) {
+            result = -1;
+        }
+    }
+    free(shard_of);
+    free(sorted);
+    free(start);
+    free(fill);
+    return result;
+}
+
+static void fs_stream_drop(FastStorageImpl *fs, Stream *stream, int keep_chunks) {
+    /* Unlink a stream; its chunks stay live only if a blob now owns them */
+    fs_write_lock(fs);
+    for (Stream **link = &fs->streams; *link; link = &(*link)->next) {
+        if (*link == stream) {
+            *link = stream->next;
+            break;
+        }
+    }
+    if (!keep_chunks) {
+        for (uint32_t i = 0; i < stream->count; i++) {
+            uint64_t chunk = stream->chunks[i];
+            fs->segments[fs_segment_of(chunk)].live -= fs_record_size(fs, chunk);
         }
     }
-    
-    /* Memory map the file */
-    fs->mmap_ptr = mmap(NULL, fs->file_size, PROT_READ | PROT_WRITE,
-                        MAP_SHARED | MAP_POPULATE, fs->fd, 0);
-    if (fs->mmap_ptr == MAP_FAILED) {
-        fprintf(stderr, "Cannot mmap %s: %s\n", filename, strerror(errno));
-        goto error;
+    fs_write_unlock(fs);
+}
+
+int faststorage_write_stream(FastStorage *storage, const char *key, uint64_t value_len,
+                             faststorage_source_fn source, void *ctx) {
+    if (!storage || !key || !source) {
+        errno = EINVAL;
+        return -1;
     }
     
-    /* Lock in memory */
-    mlock(fs->mmap_ptr, fs->file_size);
+    size_t key_len = strlen(key) + 1;
+    if (key_len > FS_KEY_MAX) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
     
-    /* Prefault all pages */
-    fs_prefault_range(fs->mmap_ptr, fs->file_size);
+    uint64_t num_chunks = (value_len + FS_CHUNK_SIZE - 1) / FS_CHUNK_SIZE;
+    if (num_chunks > FS_BLOB_MAX_CHUNKS) {
+        errno = EFBIG;
+        return -1;
+    }
     
-    FastStorageImpl *impl = (FastStorageImpl *)storage;
-    impl->header = (FileHeader *)impl->mmap_ptr;
+    FastStorageImpl *fs = fs_route((FastStorageImpl *)storage, key);
+    Stream stream = { calloc(num_chunks ? num_chunks : 1, sizeof(uint64_t)), 0, NULL };
+    uint8_t *buffer = malloc(FS_CHUNK_SIZE);
+    if (!stream.chunks || !buffer) {
+        free(stream.chunks);
+        free(buffer);
+        errno = ENOMEM;
+        return -1;
+    }
     
-    if (is_new) {
-        /* Initialize new file */
-        if (fs_init_header(fs) < 0) {
-            goto error;
-        }
-        fsync(fs->fd);
-    } else {
-        /* Validate existing file */
-        if (fs->header->magic != FS_MAGIC) {
-            fprintf(stderr, "Invalid faststore file (bad magic)\n");
-            goto error;
+    fs_write_lock(fs);
+    stream.next = fs->streams;
+    fs->streams = &stream;
+    fs_write_unlock(fs);
+    
+    int result = -1;
+    for (uint64_t i = 0; i < num_chunks; i++) {
+        /* Fill one chunk without the lock: source may be slow */
+        size_t len = (i + 1 < num_chunks) ? FS_CHUNK_SIZE : value_len - i * FS_CHUNK_SIZE;
+        for (size_t filled = 0; filled < len; ) {
+            ssize_t n = source(ctx, buffer + filled, len - filled);
+            if (n <= 0 || (size_t)n > len - filled) {
+                errno = ECANCELED;
+                goto done;
+            }
+            filled += (size_t)n;
         }
         
-        if (fs->header->version != FS_VERSION) {
-            fprintf(stderr, "Unsupported faststore version\n");
-            goto error;
-        }
+        RecordHeader head = { FS_RECORD_CHUNK, 0, (uint32_t)len, 0 };
+        head.crc = fs_crc_record(&head, buffer, len);
         
-        fs->hash_table = (HashEntry *)(fs->mmap_ptr + fs->header->hash_table_offset);
+        fs_write_lock(fs);
+        int64_t offset = fs_append_alloc(fs, sizeof(RecordHeader) + len, 1);
+        if (offset < 0) {
+            fs_write_unlock(fs);
+            goto done;
+        }
+        RecordHeader *hdr = (RecordHeader *)(fs->mmap_ptr + offset);
+        *hdr = head;
+        memcpy(hdr + 1, buffer, len);
+        fs->segments[fs_segment_of(offset)].live += sizeof(RecordHeader) + len;
+        stream.chunks[stream.count++] = (uint64_t)offset;
+        fs_write_unlock(fs);
     }
     
-    return (FastStorage *)fs;
+    /* Publish: the blob record takes over the chunks */
+    fs_write_lock(fs);
+    BlobHeader blob = { value_len, fs->next_serial++, FS_CHUNK_SIZE, (uint32_t)num_chunks };
+    result = fs_put_locked(fs, key, key_len, FS_RECORD_BLOB, &blob, sizeof(blob),
+                           stream.chunks, num_chunks * sizeof(uint64_t));
+    fs_write_unlock(fs);
 
-error:
-    if (fs->mmap_ptr && fs->mmap_ptr != MAP_FAILED) {
-        munmap(fs->mmap_ptr, fs->file_size);
-    }
-    if (fs->fd >= 0) {
-        close(fs->fd);
-    }
-    free(fs);
-    return NULL;
+done:
+    fs_stream_drop(fs, &stream, result == 0);
+    free(stream.chunks);
+    free(buffer);
+    if (result == 0 && fs_commit(fs) < 0) return -1;
+    return result;
 }
 
-void faststorage_destroy(FastStorage *storage) {
-    if (!storage) return;
+static int fs_read_locked(FastStorageImpl *fs, const char *key, void *value_out, size_t *value_len_out) {
+    /* faststorage_read under the read lock, for readers writers keep beating */
+    pthread_rwlock_rdlock(&fs->lock);
     
-    FastStorageImpl *fs = (FastStorageImpl *)storage;
+    uint32_t slot_idx;
+    int slot_status = fs_find_slot(fs, key, &slot_idx);
     
-    faststorage_flush(storage);
+    if (slot_status != 1) {
+        pthread_rwlock_unlock(&fs->lock);
+        errno = ENOENT;
+        return -1;
+    }
     
-    if (fs->mmap_ptr && fs->mmap_ptr != MAP_FAILED) {
-        munlock(fs->mmap_ptr, fs->file_size);
-        munmap(fs->mmap_ptr, fs->file_size);
+    /* Read the record */
+    HashEntry *entry = &fs->hash_table[slot_idx];
+    RecordHeader *rec = (RecordHeader *)(fs->mmap_ptr + entry->offset);
+    BlobHeader *blob = fs_blob_of(fs, entry->offset);
+    
+    uint64_t actual_len = blob ? blob->total_len : rec->value_len;
+    if (actual_len > *value_len_out) {
+        *value_len_out = actual_len;
+        pthread_rwlock_unlock(&fs->lock);
+        errno = ERANGE;
+        return -1;
     }
     
-    if (fs->fd >= 0) {
-        close(fs->fd);
+    if (blob) {
+        uint8_t *out = value_out;
+        for (uint32_t i = 0; i < blob->num_chunks; i++) {
+            RecordHeader *chunk = (RecordHeader *)(fs->mmap_ptr + fs_blob_chunks(blob)[i]);
+            memcpy(out, chunk + 1, chunk->value_len);
+            out += chunk->value_len;
+        }
+    } else {
+        uint8_t *value_ptr = (uint8_t *)rec + sizeof(RecordHeader) + rec->key_len;
+        memcpy(value_out, value_ptr, actual_len);
     }
+    *value_len_out = actual_len;
     
-    pthread_rwlock_destroy(&fs->lock);
-    free(fs);
+    fs_count_read(fs);
+    pthread_rwlock_unlock(&fs->lock);
+    
+    return 0;
 }
 
-int faststorage_write(FastStorage *storage, const char *key, const void *value, size_t value_len) {
-    if (!storage || !key || !value || value_len > FS_VALUE_MAX) {
+static int fs_read_optimistic(FastStorageImpl *fs, const char *key, void *value_out,
+                              size_t capacity, uint64_t *value_len) {
+    /* fs_read_snapshot until one attempt isn't overlapped by a write
+     * Returns: 1 if found, 0 if not, -1 (EIO) if the file is damaged,
+     * -2 after FS_SEQ_RETRIES overlapped attempts
+     */
+    uint32_t hash = fs_hash(key);
+    for (int attempt = 0; attempt < FS_SEQ_RETRIES; attempt++) {
+        uint32_t seq = fs_read_begin(fs);
+        Snapshot snap = fs_snapshot(fs);
+        int found = fs_read_snapshot(&snap, key, hash, value_out, capacity, value_len);
+        if (!fs_read_valid(fs, seq)) continue;
+        
+        if (found < 0) errno = EIO;
+        return found;
+    }
+    return -2;
+}
+
+int faststorage_read(FastStorage *storage, const char *key, void *value_out, size_t *value_len_out) {
+    if (!storage || !key || !value_out || !value_len_out) {
         errno = EINVAL;
         return -1;
     }
     
-    FastStorageImpl *fs = (FastStorageImpl *)storage;
-    pthread_rwlock_wrlock(&fs->lock);
-    
-    size_t key_len = strlen(key) + 1;
-    if (key_len > FS_KEY_MAX) {
-        pthread_rwlock_unlock(&fs->lock);
-        errno = ENAMETOOLONG;
+    FastStorageImpl *fs = fs_route((FastStorageImpl *)storage, key);
+    uint64_t len = 0;
+    int found = fs_read_optimistic(fs, key, value_out, *value_len_out, &len);
+    if (found == -2) {
+        return fs_read_locked(fs, key, value_out, value_len_out);
+    }
+    if (found <= 0) {
+        if (found == 0) errno = ENOENT;
         return -1;
     }
     
-    /* Find or allocate slot */
-    uint32_t slot_idx;
-    int slot_status = fs_find_slot(fs, key, &slot_idx);
-    if (slot_status < 0) {
-        /* Table full - would need rehashing, skip for now */
-        pthread_rwlock_unlock(&fs->lock);
-        errno = ENOSPC;
+    if (len > *value_len_out) {
+        *value_len_out = len;
+        errno = ERANGE;
+        return -1;
+    }
+    *value_len_out = len;
+    fs_count_read(fs);
+    return 0;
+}
+
+int faststorage_read_stream(FastStorage *storage, const char *key, faststorage_sink_fn sink, void *ctx) {
+    if (!storage || !key || !sink) {
+        errno = EINVAL;
         return -1;
     }
     
-    /* Allocate space for record */
-    size_t record_size = sizeof(RecordHeader) + key_len + value_len;
-    uint64_t record_offset = fs->header->data_end;
+    FastStorageImpl *fs = fs_route((FastStorageImpl *)storage, key);
+    uint64_t serial = 0;
+    uint32_t num_chunks = 1;
     
-    if (record_offset + record_size > fs->file_size) {
-        if (fs_grow_file(fs, fs->file_size * 2) < 0) {
+    /* One chunk per lock hold; the blob is looked up again each time since
+     * compaction may have moved it, and must still be the same value */
+    for (uint32_t i = 0; i < num_chunks; i++) {
+        pthread_rwlock_rdlock(&fs->lock);
+        
+        uint32_t slot_idx;
+        if (fs_find_slot(fs, key, &slot_idx) != 1) {
             pthread_rwlock_unlock(&fs->lock);
+            errno = (i == 0) ? ENOENT : EAGAIN;
+            return -1;
+        }
+        
+        uint64_t offset = fs->hash_table[slot_idx].offset;
+        BlobHeader *blob = fs_blob_of(fs, offset);
+        const void *data;
+        size_t len;
+        if (i == 0 && !blob) {
+            RecordHeader *rec = (RecordHeader *)(fs->mmap_ptr + offset);
+            data = (uint8_t *)rec + sizeof(RecordHeader) + rec->key_len;
+            len = rec->value_len;
+        } else {
+            if (!blob || (i > 0 && blob->serial != serial)) {
+                pthread_rwlock_unlock(&fs->lock);
+                errno = EAGAIN;
+                return -1;
+            }
+            serial = blob->serial;
+            num_chunks = blob->num_chunks;
+            if (num_chunks == 0) {
+                data = NULL;
+                len = 0;
+            } else {
+                RecordHeader *chunk = (RecordHeader *)(fs->mmap_ptr + fs_blob_chunks(blob)[i]);
+                data = chunk + 1;
+                len = chunk->value_len;
+            }
+        }
+        
+        int stop = sink(ctx, data, len);
+        if (i == num_chunks - 1 || num_chunks == 0) {
+            fs_count_read(fs);
+        }
+        pthread_rwlock_unlock(&fs->lock);
+        
+        if (stop) {
+            errno = ECANCELED;
             return -1;
         }
-        record_offset = fs->header->data_end;
+    }
+    return 0;
+}
+
+static void *fs_map_blob(FastStorageImpl *fs, BlobHeader *blob, size_t *map_len) {
+    /* Map a blob's chunks back to back into one private read-only range
+     * Returns: the range, or NULL if a chunk isn't page aligned (written
+     * before chunks were) or the mapping fails
+     */
+    uint64_t *chunks = fs_blob_chunks(blob);
+    for (uint32_t i = 0; i < blob->num_chunks; i++) {
+        const RecordHeader *chunk = (const RecordHeader *)(fs->mmap_ptr + chunks[i]);
+        if ((chunks[i] + sizeof(RecordHeader)) % FS_PAGE_SIZE != 0 ||
+            (i + 1 < blob->num_chunks && chunk->value_len % FS_PAGE_SIZE != 0)) {
+            return NULL;
+        }
     }
     
-    /* Write record */
-    uint8_t *record_ptr = fs->mmap_ptr + record_offset;
-    RecordHeader *hdr = (RecordHeader *)record_ptr;
-    hdr->magic = FS_MAGIC;
-    hdr->key_len = key_len;
-    hdr->value_len = value_len;
-    hdr->padding = 0;
-    
-    memcpy(record_ptr + sizeof(RecordHeader), key, key_len);
-    memcpy(record_ptr + sizeof(RecordHeader) + key_len, value, value_len);
-    
-    /* Update hash table */
-    fs->hash_table[slot_idx].offset = record_offset;
-    fs->hash_table[slot_idx].hash = fs_hash(key);
+    size_t len = (blob->total_len + FS_PAGE_SIZE - 1) & ~(size_t)(FS_PAGE_SIZE - 1);
+    uint8_t *base = mmap(NULL, len, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) return NULL;
+    
+    size_t pos = 0;
+    for (uint32_t i = 0; i < blob->num_chunks; i++) {
+        const RecordHeader *chunk = (const RecordHeader *)(fs->mmap_ptr + chunks[i]);
+        size_t span = (chunk->value_len + FS_PAGE_SIZE - 1) & ~(size_t)(FS_PAGE_SIZE - 1);
+        if (mmap(base + pos, span, PROT_READ, MAP_SHARED | MAP_FIXED, fs->fd,
+                 (off_t)(chunks[i] + sizeof(RecordHeader))) == MAP_FAILED) {
+            munmap(base, len);
+            return NULL;
+        }
+        pos += chunk->value_len;
+    }
     
-    fs->header->data_end = record_offset + record_size;
-    fs->header->num_entries++;
-    fs->writes++;
+    *map_len = len;
+    return base;
+}
+
+static int64_t fs_view_slot(FastStorageImpl *fs) {
+    /* Free view slot, growing the table; called with view_lock held */
+    for (uint32_t i = 0; i < fs->views_capacity; i++) {
+        if (!fs->views[i].used) return i;
+    }
     
-    pthread_rwlock_unlock(&fs->lock);
+    uint32_t capacity = fs->views_capacity ? fs->views_capacity * 2 : 16;
+    if (capacity > FS_MAX_VIEWS) return -1;
+    View *views = realloc(fs->views, capacity * sizeof(View));
+    if (!views) return -1;
+    memset(&views[fs->views_capacity], 0, (capacity - fs->views_capacity) * sizeof(View));
     
-    return 0;
+    int64_t index = fs->views_capacity;
+    fs->views = views;
+    fs->views_capacity = capacity;
+    return index;
 }
 
-int faststorage_read(FastStorage *storage, const char *key, void *value_out, size_t *value_len_out) {
-    if (!storage || !key || !value_out || !value_len_out) {
+int faststorage_get_view(FastStorage *storage, const char *key, FastStorageView *view) {
+    if (!storage || !key || !view) {
         errno = EINVAL;
         return -1;
     }
     
     FastStorageImpl *fs = (FastStorageImpl *)storage;
+    if (fs->num_shards) {
+        uint32_t shard = fs_shard_of(fs, key);
+        if (faststorage_get_view((FastStorage *)fs->shards[shard], key, view) < 0) return -1;
+        view->token |= (uint64_t)shard << FS_VIEW_SHARD_SHIFT;
+        return 0;
+    }
     pthread_rwlock_rdlock(&fs->lock);
     
     uint32_t slot_idx;
-    int slot_status = fs_find_slot(fs, key, &slot_idx);
-    
-    if (slot_status != 1) {
+    if (fs_find_slot(fs, key, &slot_idx) != 1) {
         pthread_rwlock_unlock(&fs->lock);
         errno = ENOENT;
         return -1;
     }
     
-    /* Read the record */
-    HashEntry *entry = &fs->hash_table[slot_idx];
-    RecordHeader *rec = (RecordHeader *)(fs->mmap_ptr + entry->offset);
+    uint64_t offset = fs->hash_table[slot_idx].offset;
+    RecordHeader *rec = (RecordHeader *)(fs->mmap_ptr + offset);
+    BlobHeader *blob = fs_blob_of(fs, offset);
+    const void *ptr;
+    size_t len;
+    void *map = NULL, *copy = NULL;
+    size_t map_len = 0;
+    
+    if (!blob) {
+        ptr = (uint8_t *)rec + sizeof(RecordHeader) + rec->key_len;
+        len = rec->value_len;
+    } else if (blob->num_chunks == 0) {
+        ptr = "";
+        len = 0;
+    } else {
+        len = blob->total_len;
+        map = fs_map_blob(fs, blob, &map_len);
+        if (!map) {
+            copy = malloc(len);
+            if (!copy) {
+                pthread_rwlock_unlock(&fs->lock);
+                errno = ENOMEM;
+                return -1;
+            }
+            uint8_t *out = copy;
+            for (uint32_t i = 0; i < blob->num_chunks; i++) {
+                RecordHeader *chunk = (RecordHeader *)(fs->mmap_ptr + fs_blob_chunks(blob)[i]);
+                memcpy(out, chunk + 1, chunk->value_len);
+                out += chunk->value_len;
+            }
+        }
+        ptr = map ? map : copy;
+    }
     
-    uint32_t actual_len = rec->value_len;
-    if (actual_len > *value_len_out) {
-        *value_len_out = actual_len;
+    pthread_mutex_lock(&fs->view_lock);
+    int64_t index = fs_view_slot(fs);
+    if (index < 0) {
+        pthread_mutex_unlock(&fs->view_lock);
         pthread_rwlock_unlock(&fs->lock);
-        errno = ERANGE;
+        if (map) munmap(map, map_len);
+        free(copy);
+        errno = ENOMEM;
         return -1;
     }
     
-    uint8_t *value_ptr = (uint8_t *)rec + sizeof(RecordHeader) + rec->key_len;
-    memcpy(value_out, value_ptr, actual_len);
-    *value_len_out = actual_len;
-    
-    fs->reads++;
+    View *v = &fs->views[index];
+    v->epoch = fs->epoch;
+    v->generation++;
+    v->used = 1;
+    v->map = map;
+    v->map_len = map_len;
+    v->copy = copy;
+    __atomic_add_fetch(&fs->active_views, 1, __ATOMIC_RELEASE);
+    
+    view->ptr = ptr;
+    view->len = len;
+    view->token = ((uint64_t)v->generation << 32) | (uint64_t)index;
+    pthread_mutex_unlock(&fs->view_lock);
+    
+    fs_count_read(fs);
     pthread_rwlock_unlock(&fs->lock);
+    return 0;
+}
+
+int faststorage_release_view(FastStorage *storage, FastStorageView *view) {
+    if (!storage || !view) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    FastStorageImpl *fs = (FastStorageImpl *)storage;
+    if (fs->num_shards) {
+        uint32_t shard = (uint32_t)(view->token >> FS_VIEW_SHARD_SHIFT) & (FS_MAX_SHARDS - 1);
+        if (shard >= fs->num_shards) {
+            errno = EINVAL;
+            return -1;
+        }
+        view->token &= ~((uint64_t)(FS_MAX_SHARDS - 1) << FS_VIEW_SHARD_SHIFT);
+        return faststorage_release_view((FastStorage *)fs->shards[shard], view);
+    }
+    uint32_t index = (uint32_t)view->token;
+    
+    pthread_mutex_lock(&fs->view_lock);
+    if (index >= fs->views_capacity || !fs->views[index].used ||
+        fs->views[index].generation != (uint32_t)(view->token >> 32)) {
+        pthread_mutex_unlock(&fs->view_lock);
+        errno = EINVAL;
+        return -1;
+    }
     
+    View *v = &fs->views[index];
+    void *map = v->map, *copy = v->copy;
+    size_t map_len = v->map_len;
+    v->used = 0;
+    v->map = v->copy = NULL;
+    __atomic_sub_fetch(&fs->active_views, 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&fs->view_lock);
+    
+    if (map) munmap(map, map_len);
+    free(copy);
+    memset(view, 0, sizeof(*view));
+    
+    /* Free what this view held back now if that doesn't mean waiting;
+     * the compactor gets it otherwise */
+    if (__atomic_load_n(&fs->retired, __ATOMIC_ACQUIRE) && fs_write_trylock(fs) == 0) {
+        fs_reclaim_locked(fs);
+        fs_write_unlock(fs);
+    }
     return 0;
 }
 
@@ -465,7 +2204,13 @@ ssize_t faststorage_size(FastStorage *storage, const char *key) {
         return -1;
     }
     
-    FastStorageImpl *fs = (FastStorageImpl *)storage;
+    FastStorageImpl *fs = fs_route((FastStorageImpl *)storage, key);
+    uint64_t len = 0;
+    int found = fs_read_optimistic(fs, key, NULL, 0, &len);
+    if (found != -2) {
+        return (found == 1) ? (ssize_t)len : -1;
+    }
+    
     pthread_rwlock_rdlock(&fs->lock);
     
     uint32_t slot_idx;
@@ -478,7 +2223,8 @@ ssize_t faststorage_size(FastStorage *storage, const char *key) {
     
     HashEntry *entry = &fs->hash_table[slot_idx];
     RecordHeader *rec = (RecordHeader *)(fs->mmap_ptr + entry->offset);
-    ssize_t size = rec->value_len;
+    BlobHeader *blob = fs_blob_of(fs, entry->offset);
+    ssize_t size = blob ? (ssize_t)blob->total_len : rec->value_len;
     
     pthread_rwlock_unlock(&fs->lock);
     return size;
@@ -490,23 +2236,25 @@ int faststorage_delete(FastStorage *storage, const char *key) {
         return -1;
     }
     
-    FastStorageImpl *fs = (FastStorageImpl *)storage;
-    pthread_rwlock_wrlock(&fs->lock);
+    FastStorageImpl *fs = fs_route((FastStorageImpl *)storage, key);
+    fs_write_lock(fs);
     
     uint32_t slot_idx;
     int slot_status = fs_find_slot(fs, key, &slot_idx);
     
     if (slot_status != 1) {
-        pthread_rwlock_unlock(&fs->lock);
+        fs_write_unlock(fs);
         return -1;
     }
     
-    fs->hash_table[slot_idx].offset = 0;
+    fs_account_value(fs, fs->hash_table[slot_idx].offset, -1);
+    fs->hash_table[slot_idx].offset = FS_SLOT_DELETED;
+    fs_rehash_mirror(fs, slot_idx, key);
     fs->header->num_entries--;
     fs->deletes++;
     
-    pthread_rwlock_unlock(&fs->lock);
-    return 0;
+    fs_write_unlock(fs);
+    return fs_commit(fs);
 }
 
 int faststorage_exists(FastStorage *storage, const char *key) {
@@ -514,7 +2262,13 @@ int faststorage_exists(FastStorage *storage, const char *key) {
         return 0;
     }
     
-    FastStorageImpl *fs = (FastStorageImpl *)storage;
+    FastStorageImpl *fs = fs_route((FastStorageImpl *)storage, key);
+    uint64_t len = 0;
+    int found = fs_read_optimistic(fs, key, NULL, 0, &len);
+    if (found != -2) {
+        return (found == 1) ? 1 : 0;
+    }
+    
     pthread_rwlock_rdlock(&fs->lock);
     
     uint32_t slot_idx;
@@ -528,12 +2282,16 @@ int faststorage_flush(FastStorage *storage) {
     if (!storage) return 0;
     
     FastStorageImpl *fs = (FastStorageImpl *)storage;
+    if (fs->num_shards) {
+        int result = 0;
+        for (uint32_t i = 0; i < fs->num_shards; i++) {
+            if (faststorage_flush((FastStorage *)fs->shards[i]) < 0) result = -1;
+        }
+        return result;
+    }
     pthread_rwlock_rdlock(&fs->lock);
     
-    /* Update header CRC */
-    fs->header->crc32 = fs_crc32((uint8_t *)fs->header, HEADER_SIZE - 4);
-    
-    /* Sync to disk */
+    /* Start writeback (the header checksum is only written on a clean shutdown) */
     if (msync(fs->mmap_ptr, fs->file_size, MS_ASYNC) < 0) {
         pthread_rwlock_unlock(&fs->lock);
         return -1;
@@ -547,6 +2305,13 @@ size_t faststorage_count(FastStorage *storage) {
     if (!storage) return 0;
     
     FastStorageImpl *fs = (FastStorageImpl *)storage;
+    if (fs->num_shards) {
+        size_t count = 0;
+        for (uint32_t i = 0; i < fs->num_shards; i++) {
+            count += faststorage_count((FastStorage *)fs->shards[i]);
+        }
+        return count;
+    }
     pthread_rwlock_rdlock(&fs->lock);
     size_t count = fs->header->num_entries;
     pthread_rwlock_unlock(&fs->lock);
@@ -558,6 +2323,13 @@ size_t faststorage_bytes_used(FastStorage *storage) {
     if (!storage) return 0;
     
     FastStorageImpl *fs = (FastStorageImpl *)storage;
+    if (fs->num_shards) {
+        size_t used = 0;
+        for (uint32_t i = 0; i < fs->num_shards; i++) {
+            used += faststorage_bytes_used((FastStorage *)fs->shards[i]);
+        }
+        return used;
+    }
     pthread_rwlock_rdlock(&fs->lock);
     size_t used = fs->header->data_end;
     pthread_rwlock_unlock(&fs->lock);
@@ -569,37 +2341,102 @@ size_t faststorage_capacity(FastStorage *storage) {
     if (!storage) return 0;
     
     FastStorageImpl *fs = (FastStorageImpl *)storage;
-    return fs->file_size;
+    if (fs->num_shards) {
+        size_t capacity = 0;
+        for (uint32_t i = 0; i < fs->num_shards; i++) {
+            capacity += faststorage_capacity((FastStorage *)fs->shards[i]);
+        }
+        return capacity;
+    }
+    return __atomic_load_n(&fs->file_size, __ATOMIC_ACQUIRE);
 }
 
 int faststorage_clear(FastStorage *storage) {
     if (!storage) return -1;
     
     FastStorageImpl *fs = (FastStorageImpl *)storage;
-    pthread_rwlock_wrlock(&fs->lock);
+    if (fs->num_shards) {
+        int result = 0;
+        for (uint32_t i = 0; i < fs->num_shards; i++) {
+            if (faststorage_clear((FastStorage *)fs->shards[i]) < 0) result = -1;
+        }
+        return result;
+    }
+    fs_write_lock(fs);
     
-    return fs_init_header(fs);
+    /* No views are left, so retired segments are punched with the rest */
+    while (fs->retired) {
+        Retired *item = fs->retired;
+        fs->retired = item->next;
+        free(item);
+    }
+    
+    uint32_t shards = fs->header->shards;
+    int result = fs_init_header(fs);
+    if (result == 0) {
+        fs->header->shards = shards;
+        result = fs_segments_rebuild(fs);
+        if (fs->file_size > FS_SEGMENT_SIZE) {
+            fs_release_range(fs, FS_SEGMENT_SIZE, fs->file_size - FS_SEGMENT_SIZE);
+        }
+    }
+    
+    fs_write_unlock(fs);
+    if (result == 0 && fs_commit(fs) < 0) return -1;
+    return result;
 }
 
 int faststorage_compact(FastStorage *storage) {
-    /* Not implemented yet - would rebuild to remove fragmentation */
-    (void)storage;
-    return 0;
+    if (!storage) return -1;
+    
+    FastStorageImpl *fs = (FastStorageImpl *)storage;
+    if (fs->num_shards) {
+        int result = 0;
+        for (uint32_t i = 0; i < fs->num_shards; i++) {
+            if (faststorage_compact((FastStorage *)fs->shards[i]) < 0) result = -1;
+        }
+        return result;
+    }
+    int result;
+    while ((result = fs_compact_tick(fs)) > 0) {
+    }
+    return result;
 }
 
 int faststorage_get_stats(FastStorage *storage, FastStorageStats *stats) {
     if (!storage || !stats) return -1;
     
     FastStorageImpl *fs = (FastStorageImpl *)storage;
+    if (fs->num_shards) {
+        /* Every field is a counter: sum them */
+        memset(stats, 0, sizeof(*stats));
+        for (uint32_t i = 0; i < fs->num_shards; i++) {
+            FastStorageStats shard;
+            faststorage_get_stats((FastStorage *)fs->shards[i], &shard);
+            uint64_t *total = (uint64_t *)stats;
+            const uint64_t *part = (const uint64_t *)&shard;
+            for (size_t f = 0; f < sizeof(shard) / sizeof(uint64_t); f++) {
+                total[f] += part[f];
+            }
+        }
+        return 0;
+    }
     pthread_rwlock_rdlock(&fs->lock);
     
-    stats->total_reads = fs->reads;
+    stats->total_reads = 0;
+    for (uint32_t i = 0; i < FS_READ_STRIPES; i++) {
+        stats->total_reads += __atomic_load_n(&fs->reads[i * FS_STRIPE_WORDS], __ATOMIC_RELAXED);
+    }
     stats->total_writes = fs->writes;
     stats->total_deletes = fs->deletes;
     stats->cache_hits = 0;
     stats->cache_misses = 0;
-    stats->compactions = 0;
-    stats->growth_count = 0;
+    stats->compactions = fs->compactions;
+    stats->reclaimed_bytes = fs->reclaimed;
+    stats->growth_count = fs->growths;
+    stats->rehash_count = fs->rehashes;
+    stats->sync_count = __atomic_load_n(&fs->syncs, __ATOMIC_RELAXED);
+    stats->dropped_records = fs->dropped;
     
     pthread_rwlock_unlock(&fs->lock);
     return 0;
@@ -609,11 +2446,83 @@ void faststorage_reset_stats(FastStorage *storage) {
     if (!storage) return;
     
     FastStorageImpl *fs = (FastStorageImpl *)storage;
-    pthread_rwlock_wrlock(&fs->lock);
+    if (fs->num_shards) {
+        for (uint32_t i = 0; i < fs->num_shards; i++) {
+            faststorage_reset_stats((FastStorage *)fs->shards[i]);
+        }
+        return;
+    }
+    fs_write_lock(fs);
     
-    fs->reads = 0;
+    for (uint32_t i = 0; i < FS_READ_STRIPES; i++) {
+        __atomic_store_n(&fs->reads[i * FS_STRIPE_WORDS], 0, __ATOMIC_RELAXED);
+    }
     fs->writes = 0;
     fs->deletes = 0;
+    fs->growths = 0;
+    fs->rehashes = 0;
+    fs->compactions = 0;
+    fs->reclaimed = 0;
+    __atomic_store_n(&fs->syncs, 0, __ATOMIC_RELAXED);
+    fs->dropped = 0;
+    
+    fs_write_unlock(fs);
+}
+
+/* ============================================================================
+ * DURABILITY CONTROL
+ * ============================================================================ */
+
+int faststorage_set_durability(FastStorage *storage, FastStorageDurability mode, uint32_t interval_ms) {
+    if (!storage || mode < FASTSTORAGE_DURABILITY_NONE || mode > FASTSTORAGE_DURABILITY_SYNC) {
+        errno = EINVAL;
+        return -1;
+    }
     
-    pthread_rwlock_unlock(&fs->lock);
+    FastStorageImpl *fs = (FastStorageImpl *)storage;
+    fs_stop_flusher(fs);
+    
+    for (uint32_t i = 0; i < fs->num_shards; i++) {
+        __atomic_store_n(&fs->shards[i]->durability, mode, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&fs->durability, mode, __ATOMIC_RELAXED);
+    fs->flush_interval_ms = interval_ms ? interval_ms : FS_FLUSH_INTERVAL_MS;
+    
+    if (mode == FASTSTORAGE_DURABILITY_ASYNC || mode == FASTSTORAGE_DURABILITY_GROUP) {
+        int err = pthread_create(&fs->flusher, NULL, fs_flusher_main, fs);
+        if (err != 0) {
+            errno = err;
+            return -1;
+        }
+        fs->flusher_running = 1;
+    }
+    return 0;
+}
+
+int faststorage_sync(FastStorage *storage) {
+    if (!storage) return -1;
+    
+    FastStorageImpl *fs = (FastStorageImpl *)storage;
+    if (fs->durability == FASTSTORAGE_DURABILITY_GROUP) {
+        /* A round that starts after this call covers every earlier write */
+        pthread_mutex_lock(&fs->commit_lock);
+        uint64_t target = fs->rounds_started + 1;
+        while (fs->rounds_done < target && fs->flusher_running) {
+            pthread_cond_wait(&fs->commit_cond, &fs->commit_lock);
+        }
+        int covered = fs->rounds_done >= target;
+        pthread_mutex_unlock(&fs->commit_lock);
+        if (covered) return 0;
+    }
+    
+    if (fs->num_shards) {
+        int result = 0;
+        for (uint32_t i = 0; i < fs->num_shards; i++) {
+            fs_count_sync(fs->shards[i]);
+            if (fdatasync(fs->shards[i]->fd) < 0) result = -1;
+        }
+        return result;
+    }
+    fs_count_sync(fs);
+    return fdatasync(fs->fd);
 }
@@ -2,10 +2,27 @@
  * memwatch.c - Native core for language-agnostic memory change watcher
  * 
  * Architecture:
- * - Signal handler (async-signal-safe): O(1) ring write only
- * - Worker thread: drains ring, computes diffs, delivers events
- * - Page table: maps page_start -> list of tracked regions
- * - Tiny per-region footprint: ~96 bytes
+ * - Write detection backend chosen at init (see memwatch_backend.h):
+ *   mprotect + SIGSEGV (default), userfaultfd write-protect handled on a
+ *   fault thread (no signals), or a soft-dirty scanner (nothing protected)
+ * - Fault producers (signal handler, uffd thread): O(1) write into the
+ *   producing thread's own SPSC ring, no shared atomics on the hot path
+ * - Worker thread: sleeps on an eventfd the handler rings, drains every ring
+ *   in batches, coalesces repeated faults on the same page
+ * - Writable windows expire on a timer wheel: due pages are re-protected,
+ *   then diffed and delivered together, and the drain loop never sleeps
+ * - Page index: lock-free open-addressed map page_start -> list of tracked regions
+ * - Delivery: one dict per event, or one EventBatch per batch (fixed-size
+ *   records plus a value arena, both exported through the buffer protocol)
+ * - Large regions keep a two-level block hash tree: a fault rehashes only the
+ *   blocks under the faulting page and reports the changed byte ranges
+ * - Tiny per-region footprint: ~120 bytes
+ * - Stage latencies and per-region/per-page counters go to a stats page
+ *   (memwatch_stats.h), published in /dev/shm when $MEMWATCH_STATS names it
+ * - With a mode set ($MEMWATCH_MODE or set_mode()), an overhead governor
+ *   (memwatch_governor.h) keeps tracing within the mode's CPU budget by
+ *   demoting the costliest regions down to periodic sampling, and promotes
+ *   them back once they cool down
  */
 
 #define PY_SSIZE_T_CLEAN
@@ -20,14 +37,52 @@
 #include <time.h>
 #include <unistd.h>
 #include <errno.h>
+#include <poll.h>
+#include <sys/syscall.h>
+
+#include "memwatch_backend.h"
+#include "memwatch_governor.h"
+#include "memwatch_hash.h"
+#include "memwatch_page_index.h"
+#include "memwatch_stats.h"
+#include "memwatch_timer_wheel.h"
+#include "memwatch_wakeup.h"
 
 /* Configuration constants */
-#define RING_CAPACITY 65536
+#define FAULT_RING_CAPACITY 4096     /* events per thread, power of two */
+#define MAX_FAULT_RINGS 256          /* concurrently faulting threads */
+#define FAULT_BATCH_MAX 1024         /* events drained per worker pass */
+#define RING_RECLAIM_INTERVAL_MS 1000
+#define CACHE_LINE_SIZE 64
+#define REPROTECT_TICK_NS 1000000ULL /* timer wheel resolution: 1ms */
+#define REPROTECT_WHEEL_SLOTS 64
 #define PAGE_SIZE 4096
 #define PREVIEW_SIZE 256
 #define SMALL_COPY_THRESHOLD 4096
 #define WRITABLE_WINDOW_MS 5
+#define GOVERNOR_INTERVAL_MS 100     /* overhead accounting period */
+#define GOVERNOR_FAULT_COST_NS 4000  /* trap + two protection changes, as measured on x86-64 */
+#define SOFT_DIRTY_SCAN_MS 20        /* soft-dirty backend: pagemap scan period */
+#define STATS_PUBLISH_MS 100         /* gauges on the stats page, at most this stale */
+#define UFFD_READ_BATCH 64
+#define MAX_HW_WATCHPOINTS 4         /* x86/arm64 debug registers per thread */
+#define WATCHPOINT_READ_BATCH 64
+#define WATCHPOINT_RESCAN_MS 10      /* arm watchpoints on newly started threads */
+#define MAX_HASH_THREADS 8           /* track_many: initial hashing fan-out */
+#define HASH_BYTES_PER_THREAD (1024 * 1024)  /* below this per thread, hash serially */
 #define MAX_REGIONS_PER_PAGE 16
+#define PAGE_INDEX_INITIAL_CAPACITY 8192
+
+/* Block tracking tiers (regions below BLOCK_DIFF_THRESHOLD hash as a whole) */
+#define BLOCK_DIFF_THRESHOLD (100 * 1024)        /* block diff: 512-byte leaves */
+#define FINGERPRINT_THRESHOLD (10 * 1024 * 1024) /* fingerprint: page-sized leaves */
+#define DIFF_BLOCK_SIZE 512
+#define LEAVES_PER_NODE 64                       /* fan-out of the middle level */
+#define MAX_BLOCKS_PER_PAGE (PAGE_SIZE / DIFF_BLOCK_SIZE + 1)  /* unaligned regions */
+
+/* Batch delivery */
+#define BUFFER_POOL_SLOTS 8          /* recycled record/arena buffers */
+#define BUFFER_MIN_CAPACITY 65536
 
 /* Ring entry - written by signal handler (async-safe) */
 typedef struct {
@@ -39,7 +94,20 @@ typedef struct {
     uint32_t thread_id;
 } PageEvent;
 
-/* Tracked region metadata (~96 bytes) */
+/*
+ * Per-thread fault ring - single producer (the owning thread, from the
+ * signal handler), single consumer (the worker). Head, tail and owner live
+ * on separate cache lines so producers never share a line with each other
+ * or bounce the consumer's line.
+ */
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) atomic_uint head;   /* written by producer */
+    _Alignas(CACHE_LINE_SIZE) atomic_uint tail;   /* written by worker */
+    _Alignas(CACHE_LINE_SIZE) atomic_int owner_tid;  /* 0 = free slot */
+    PageEvent events[FAULT_RING_CAPACITY];
+} FaultRing;
+
+/* Tracked region metadata (~120 bytes) */
 typedef struct TrackedRegion {
     uint64_t addr;
     size_t size;
@@ -49,33 +117,57 @@ typedef struct TrackedRegion {
     uint32_t metadata_ref;
     uint32_t epoch;
     int32_t max_value_bytes;  /* -1: full, 0: none, >0: limit */
-    struct TrackedRegion *next_in_page;  /* linked list per page */
-    uint64_t last_check_time_ns;
+    int32_t watchpoint;       /* slot in g_state.watchpoints, -1: page protected */
+    uint64_t last_check_time_ns;  /* last sample, while the governor samples it */
+    mw_gov_region_t gov;      /* worker-private; level changes under page_table_mutex */
+    
+    /* Block hash tree, NULL for small regions: block_count leaf hashes, then
+     * one node per LEAVES_PER_NODE leaves; last_hash is the root over the nodes */
+    uint64_t *block_tree;
+    size_t block_count;
+    uint32_t block_size;
 } TrackedRegion;
 
-/* Page table entry */
+/* Page table entry (one per tracked page, owned by the page index); a
+ * region spanning several pages appears in each of their arrays */
 typedef struct {
     uintptr_t page_start;
-    TrackedRegion *regions;  /* singly-linked list */
+    TrackedRegion **regions;
     int region_count;
+    int region_capacity;
+    int armed_count;         /* regions relying on page protection (region_page_armed) */
 } PageEntry;
 
+/* Hardware watchpoint slot - writes to region_addr are reported exactly */
+typedef struct {
+    mw_hwbp_t bp;
+    uintptr_t region_addr;
+    bool used;
+} HwWatchpoint;
+
 /* Resolver function pointer type */
 typedef int (*ResolverFn)(uintptr_t fault_ip, uint32_t adapter_id, 
                           char **file, char **function, int *line, void ***stack);
 
 /* Global state */
 static struct {
-    /* Ring buffer */
-    PageEvent *ring;
-    atomic_uint ring_head;
-    atomic_uint ring_tail;
+    /* Per-thread fault rings (one mmap, pages committed on first use) */
+    FaultRing *rings;
+    size_t rings_bytes;
+    atomic_uint ring_high_water;      /* slots [0, high_water) ever claimed */
+    atomic_uint active_rings;
     atomic_uint dropped_events;
     atomic_uint seq_counter;
+    atomic_size_t coalesced_faults;
+    atomic_size_t hashed_bytes;       /* bytes rehashed looking for changes */
+    
+    /* Worker doorbell (rung by the signal handler) and re-protect schedule */
+    mw_wakeup_t wakeup;
+    mw_timer_wheel_t reprotect_wheel;   /* worker-private */
+    atomic_size_t pending_reprotect;
     
-    /* Page table (simple hash map) */
-    PageEntry *page_table;
-    size_t page_table_capacity;
+    /* Page index: lock-free reads, writers hold page_table_mutex */
+    mw_page_index_t page_index;
     pthread_mutex_t page_table_mutex;
     
     /* Region tracking */
@@ -91,6 +183,10 @@ static struct {
     
     /* Callback */
     PyObject *callback;
+    PyObject *batch_callback;         /* when set, replaces per-event dicts */
+    atomic_uint batch_max;            /* events per batch, 0 = batching off */
+    atomic_ullong batch_latency_ns;   /* longest an event may wait for its batch */
+    atomic_size_t batches_delivered;
     pthread_mutex_t callback_mutex;
     
     /* Resolvers */
@@ -100,48 +196,186 @@ static struct {
     /* Statistics */
     atomic_size_t native_memory_bytes;
     atomic_uint tracked_region_count;
+    mw_stats_t stats;                 /* stage latencies, hot regions and pages */
     
-    /* Protection support */
-    bool protection_available;
+    /* Write detection */
+    mw_backend_kind_t backend;
+    bool protection_available;        /* pages are write-protected (not soft-dirty) */
     struct sigaction old_segv_action;
+    mw_uffd_t uffd;                   /* MW_BACKEND_UFFD_WP */
+    pthread_t uffd_thread;
+    mw_wakeup_t uffd_stop;
+    mw_soft_dirty_t soft_dirty;       /* MW_BACKEND_SOFT_DIRTY, worker-private */
+    atomic_size_t arm_failures;       /* pages that could not be protected */
+    
+    /* Hardware watchpoints for regions <= MW_HWBP_MAX_LEN bytes */
+    HwWatchpoint watchpoints[MAX_HW_WATCHPOINTS];  /* under watchpoint_mutex */
+    pthread_mutex_t watchpoint_mutex;
+    atomic_uint watchpoint_gen;       /* bumped when a slot changes */
+    unsigned watchpoint_polled_gen;   /* generation the thread's poll set reflects */
+    pthread_cond_t watchpoint_cond;   /* signalled after each poll-set rebuild */
+    bool watchpoints_enabled;         /* $MEMWATCH_WATCHPOINTS != "0", perf usable */
+    pthread_t watchpoint_thread;      /* started with the first watchpoint */
+    bool watchpoint_thread_started;
+    mw_wakeup_t watchpoint_ctl;       /* rebuild the poll set / stop */
+    atomic_bool watchpoint_stop;
+    atomic_uint active_watchpoints;
+    atomic_size_t watchpoint_hits;
+    
+    /* Overhead governor: ticked by the worker, mode set from Python */
+    mw_governor_t governor;           /* under governor_mutex */
+    pthread_mutex_t governor_mutex;
+    atomic_bool governor_on;          /* mode is not off: charge regions */
+    struct {
+        uint32_t *ids;                /* charged this interval, or demoted */
+        mw_gov_ref_t *refs;
+        size_t count;
+        size_t capacity;
+    } governed;                       /* worker-private */
+    uint64_t deliver_ns_per_change;   /* smoothed, worker-private */
     
 } g_state;
 
+/*
+ * Slot of the calling thread's fault ring, plus one (0 = not registered).
+ * initial-exec keeps the access a plain %fs-relative load, which is safe
+ * inside the signal handler.
+ */
+static __thread unsigned tls_ring_slot __attribute__((tls_model("initial-exec")));
+
 /* Forward declarations */
 static void signal_handler(int sig, siginfo_t *si, void *unused);
 static void *worker_thread_func(void *arg);
 static uint64_t hash_bytes(const void *data, size_t len);
+static void region_blocks_init(TrackedRegion *region);
+static size_t region_blocks_bytes(const TrackedRegion *region);
+static size_t block_tree_update(TrackedRegion *region, size_t first, size_t last);
+static size_t block_length(const TrackedRegion *region, size_t block);
 static uint64_t get_monotonic_ns(void);
 static PageEntry *page_table_find(uintptr_t page_start);
 static void page_table_add_region(uintptr_t page_start, TrackedRegion *region);
+static void page_table_add_region_locked(uintptr_t page_start, TrackedRegion *region);
 static void page_table_remove_region(uintptr_t page_start, TrackedRegion *region);
+static void chain_to_old_handler(int sig, siginfo_t *si, void *ctx);
+static FaultRing *fault_ring_for_current_thread(void);
+static void *uffd_thread_func(void *arg);
+static void *watchpoint_thread_func(void *arg);
+static bool watchpoint_attach(TrackedRegion *region);
+static void watchpoint_detach(TrackedRegion *region);
+static void watchpoints_shutdown(void);
+static void backend_arm_page(uintptr_t page_start);
+static void backend_arm_range(uintptr_t start, size_t len);
+static void backend_reprotect_page(uintptr_t page_start);
+static void backend_disarm_page(uintptr_t page_start);
+static uint32_t fault_rings_used(void);
+static size_t native_memory_bytes(void);
+
+/* Pages of the region are write-protected for it (not a watchpoint, not sampled) */
+static bool region_page_armed(const TrackedRegion *region) {
+    return region->watchpoint < 0 && !mw_gov_sampled((mw_gov_level_t)region->gov.level);
+}
+
+/* Open the kernel interface a backend needs; sets a Python error on failure */
+static int backend_open(mw_backend_kind_t backend) {
+    g_state.uffd.fd = -1;
+    g_state.uffd_stop.fd = -1;
+    g_state.soft_dirty.pagemap_fd = -1;
+    g_state.soft_dirty.clear_refs_fd = -1;
+    
+    if (backend == MW_BACKEND_UFFD_WP) {
+        if (mw_uffd_open(&g_state.uffd) != 0) {
+            PyErr_Format(PyExc_OSError, "userfaultfd write-protect unavailable: %s",
+                         strerror(errno));
+            return -1;
+        }
+        if (mw_wakeup_init(&g_state.uffd_stop) != 0) {
+            mw_uffd_close(&g_state.uffd);
+            PyErr_SetFromErrno(PyExc_OSError);
+            return -1;
+        }
+    } else if (backend == MW_BACKEND_SOFT_DIRTY) {
+        if (mw_soft_dirty_open(&g_state.soft_dirty) != 0) {
+            PyErr_Format(PyExc_OSError, "soft-dirty tracking unavailable: %s",
+                         errno == ENOTSUP ? "kernel built without CONFIG_MEM_SOFT_DIRTY"
+                                          : strerror(errno));
+            return -1;
+        }
+    }
+    
+    g_state.backend = backend;
+    return 0;
+}
+
+static void backend_close(void) {
+    mw_uffd_close(&g_state.uffd);
+    mw_wakeup_destroy(&g_state.uffd_stop);
+    mw_soft_dirty_close(&g_state.soft_dirty);
+}
 
-/* Initialize memwatch core */
+/* Initialize memwatch core: init(backend=None) - "mprotect", "uffd" or "soft-dirty" */
 static PyObject *mw_init(PyObject *self, PyObject *args) {
     (void)self;  /* Unused in this function */
-    (void)args;  /* Unused in this function */
     
-    if (g_state.ring != NULL) {
-        Py_RETURN_NONE;  /* already initialized */
+    const char *backend_name = NULL;
+    mw_backend_kind_t backend;
+    
+    if (!PyArg_ParseTuple(args, "|z", &backend_name)) {
+        return NULL;
+    }
+    if (mw_backend_parse(backend_name, &backend) != 0) {
+        PyErr_Format(PyExc_ValueError,
+                     "Unknown backend '%s' (expected mprotect, uffd or soft-dirty)", backend_name);
+        return NULL;
+    }
+    
+    const char *mode_name = getenv("MEMWATCH_MODE");
+    mw_gov_mode_t mode;
+    if (mw_gov_mode_parse(mode_name, &mode) != 0) {
+        PyErr_Format(PyExc_ValueError,
+                     "Unknown MEMWATCH_MODE '%s' (expected off, lite, balanced or deep)", mode_name);
+        return NULL;
+    }
+    
+    if (g_state.rings != NULL) {
+        /* already initialized - the backend is fixed until shutdown */
+        if (backend_name && backend != g_state.backend) {
+            PyErr_Format(PyExc_RuntimeError, "memwatch already initialized with the %s backend",
+                         mw_backend_name(g_state.backend));
+            return NULL;
+        }
+        Py_RETURN_NONE;
+    }
+    
+    /* Open the backend first: a missing kernel feature leaves nothing to undo */
+    if (backend_open(backend) != 0) {
+        return NULL;
     }
     
-    /* Allocate ring buffer */
-    g_state.ring = calloc(RING_CAPACITY, sizeof(PageEvent));
-    if (!g_state.ring) {
-        PyErr_SetString(PyExc_MemoryError, "Failed to allocate ring buffer");
+    /*
+     * Reserve every fault ring up front: the signal handler cannot allocate.
+     * MAP_NORESERVE means a slot only costs RAM once a thread faults.
+     */
+    g_state.rings_bytes = MAX_FAULT_RINGS * sizeof(FaultRing);
+    void *rings = mmap(NULL, g_state.rings_bytes, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (rings == MAP_FAILED) {
+        g_state.rings_bytes = 0;
+        backend_close();
+        PyErr_SetString(PyExc_MemoryError, "Failed to allocate fault rings");
         return NULL;
     }
-    atomic_store(&g_state.ring_head, 0);
-    atomic_store(&g_state.ring_tail, 0);
+    g_state.rings = rings;
+    atomic_store(&g_state.ring_high_water, 0);
+    atomic_store(&g_state.active_rings, 0);
     atomic_store(&g_state.dropped_events, 0);
     atomic_store(&g_state.seq_counter, 1);
+    atomic_store(&g_state.coalesced_faults, 0);
     
-    /* Allocate page table */
-    g_state.page_table_capacity = 8192;
-    g_state.page_table = calloc(g_state.page_table_capacity, sizeof(PageEntry));
-    if (!g_state.page_table) {
-        free(g_state.ring);
-        g_state.ring = NULL;
+    /* Allocate page index */
+    if (mw_page_index_init(&g_state.page_index, PAGE_INDEX_INITIAL_CAPACITY) != 0) {
+        munmap(g_state.rings, g_state.rings_bytes);
+        g_state.rings = NULL;
+        backend_close();
         PyErr_SetString(PyExc_MemoryError, "Failed to allocate page table");
         return NULL;
     }
@@ -151,48 +385,105 @@ static PyObject *mw_init(PyObject *self, PyObject *args) {
     g_state.regions_capacity = 1024;
     g_state.regions = calloc(g_state.regions_capacity, sizeof(TrackedRegion*));
     if (!g_state.regions) {
-        free(g_state.ring);
-        free(g_state.page_table);
-        g_state.ring = NULL;
-        g_state.page_table = NULL;
+        munmap(g_state.rings, g_state.rings_bytes);
+        mw_page_index_destroy(&g_state.page_index);
+        g_state.rings = NULL;
+        backend_close();
         PyErr_SetString(PyExc_MemoryError, "Failed to allocate regions array");
         return NULL;
     }
+    
+    /* Worker doorbell and re-protect schedule */
+    if (mw_wakeup_init(&g_state.wakeup) != 0 ||
+        mw_timer_wheel_init(&g_state.reprotect_wheel, REPROTECT_TICK_NS, REPROTECT_WHEEL_SLOTS,
+                            sizeof(PageEvent), get_monotonic_ns()) != 0) {
+        mw_wakeup_destroy(&g_state.wakeup);
+        munmap(g_state.rings, g_state.rings_bytes);
+        mw_page_index_destroy(&g_state.page_index);
+        free(g_state.regions);
+        g_state.rings = NULL;
+        backend_close();
+        PyErr_SetString(PyExc_OSError, "Failed to create worker wakeup");
+        return NULL;
+    }
+    atomic_store(&g_state.pending_reprotect, 0);
+    
     g_state.next_region_id = 1;
     pthread_mutex_init(&g_state.regions_mutex, NULL);
     pthread_mutex_init(&g_state.callback_mutex, NULL);
     
-    /* Update memory stats */
-    size_t mem = RING_CAPACITY * sizeof(PageEvent) + 
-                 g_state.page_table_capacity * sizeof(PageEntry) +
-                 g_state.regions_capacity * sizeof(TrackedRegion*);
+    /* Soft-dirty never faults: regions only cost the scanning and diffing */
+    mw_governor_init(&g_state.governor, mode, (uint64_t)GOVERNOR_INTERVAL_MS * 1000000ULL,
+                     (uint64_t)WRITABLE_WINDOW_MS * 1000000ULL,
+                     backend == MW_BACKEND_SOFT_DIRTY ? 0 : GOVERNOR_FAULT_COST_NS);
+    pthread_mutex_init(&g_state.governor_mutex, NULL);
+    atomic_store(&g_state.governor_on, mode != MW_GOV_OFF);
+    
+    /* Watchpoints are opportunistic: without perf, small regions use pages */
+    const char *watchpoints_env = getenv("MEMWATCH_WATCHPOINTS");
+    pthread_mutex_init(&g_state.watchpoint_mutex, NULL);
+    pthread_cond_init(&g_state.watchpoint_cond, NULL);
+    g_state.watchpoint_ctl.fd = -1;
+    g_state.watchpoints_enabled = !(watchpoints_env && strcmp(watchpoints_env, "0") == 0) &&
+                                  mw_wakeup_init(&g_state.watchpoint_ctl) == 0;
+    
+    /* Update memory stats (page index and claimed rings are added in get_stats) */
+    size_t mem = g_state.regions_capacity * sizeof(TrackedRegion*);
     atomic_store(&g_state.native_memory_bytes, mem);
     
-    /* Install signal handler for page protection */
+    /* Stats page: a name taken by another tracer only costs the publishing */
+    const char *stats_name = getenv("MEMWATCH_STATS");
+    if (mw_stats_open(&g_state.stats, stats_name, "memwatch", mw_backend_name(backend)) != 0 &&
+        stats_name) {
+        PyErr_WarnFormat(PyExc_RuntimeWarning, 1, "memwatch stats page '%s' not published: %s",
+                         stats_name, strerror(errno));
+        mw_stats_open(&g_state.stats, NULL, "memwatch", mw_backend_name(backend));
+    }
+    
+    /* Install signal handler for page protection (mprotect backend only) */
+    if (backend == MW_BACKEND_MPROTECT) {
 #ifdef __linux__
-    struct sigaction sa;
-    sa.sa_flags = SA_SIGINFO;
-    sigemptyset(&sa.sa_mask);
-    sa.sa_sigaction = signal_handler;
-    if (sigaction(SIGSEGV, &sa, &g_state.old_segv_action) == 0) {
+        struct sigaction sa;
+        sa.sa_flags = SA_SIGINFO;
+        sigemptyset(&sa.sa_mask);
+        sa.sa_sigaction = signal_handler;
+        if (sigaction(SIGSEGV, &sa, &g_state.old_segv_action) == 0) {
+            g_state.protection_available = true;
+        }
+#endif
+    } else if (backend == MW_BACKEND_UFFD_WP) {
         g_state.protection_available = true;
     }
-#endif
     
-    /* Start worker thread */
+    /* Start the uffd fault thread (if any), then the worker */
     atomic_store(&g_state.worker_running, true);
     atomic_store(&g_state.shutdown_requested, false);
-    if (pthread_create(&g_state.worker_thread, NULL, worker_thread_func, NULL) != 0) {
+    bool uffd_started = backend == MW_BACKEND_UFFD_WP &&
+                        pthread_create(&g_state.uffd_thread, NULL, uffd_thread_func, NULL) == 0;
+    if ((backend == MW_BACKEND_UFFD_WP && !uffd_started) ||
+        pthread_create(&g_state.worker_thread, NULL, worker_thread_func, NULL) != 0) {
         /* Cleanup on failure */
-        if (g_state.protection_available) {
+        if (uffd_started) {
+            mw_wakeup_notify(&g_state.uffd_stop);
+            pthread_join(g_state.uffd_thread, NULL);
+        }
+        if (backend == MW_BACKEND_MPROTECT && g_state.protection_available) {
             sigaction(SIGSEGV, &g_state.old_segv_action, NULL);
         }
-        free(g_state.ring);
-        free(g_state.page_table);
+        backend_close();
+        munmap(g_state.rings, g_state.rings_bytes);
+        mw_page_index_destroy(&g_state.page_index);
         free(g_state.regions);
+        mw_wakeup_destroy(&g_state.wakeup);
+        mw_timer_wheel_destroy(&g_state.reprotect_wheel);
         pthread_mutex_destroy(&g_state.page_table_mutex);
         pthread_mutex_destroy(&g_state.regions_mutex);
         pthread_mutex_destroy(&g_state.callback_mutex);
+        pthread_mutex_destroy(&g_state.governor_mutex);
+        mw_wakeup_destroy(&g_state.watchpoint_ctl);
+        pthread_cond_destroy(&g_state.watchpoint_cond);
+        pthread_mutex_destroy(&g_state.watchpoint_mutex);
+        mw_stats_close(&g_state.stats);
         memset(&g_state, 0, sizeof(g_state));
         PyErr_SetString(PyExc_RuntimeError, "Failed to start worker thread");
         return NULL;
@@ -201,31 +492,65 @@ static PyObject *mw_init(PyObject *self, PyObject *args) {
     Py_RETURN_NONE;
 }
 
+/* Release a page entry during shutdown, leaving the page writable */
+static void free_page_entry(uintptr_t page_start, void *value, void *ctx) {
+    (void)ctx;
+    PageEntry *entry = (PageEntry *)value;
+    if (entry->armed_count > 0) {
+        backend_disarm_page(page_start);
+    }
+    free(entry->regions);
+    free(entry);
+}
+
 /* Shutdown memwatch core */
 static PyObject *mw_shutdown(PyObject *self, PyObject *args) {
     (void)self;  /* Unused in this function */
     (void)args;  /* Unused in this function */
     
-    if (!g_state.ring) {
+    if (!g_state.rings) {
         Py_RETURN_NONE;
     }
     
+    /* Watchpoints first: their thread feeds the rings the worker drains */
+    Py_BEGIN_ALLOW_THREADS
+    watchpoints_shutdown();
+    Py_END_ALLOW_THREADS
+    
     /* Signal worker to stop */
     atomic_store(&g_state.shutdown_requested, true);
+    mw_wakeup_notify(&g_state.wakeup);
+    Py_BEGIN_ALLOW_THREADS  /* the worker may need the GIL to flush a batch */
     pthread_join(g_state.worker_thread, NULL);
+    Py_END_ALLOW_THREADS
+    mw_wakeup_destroy(&g_state.wakeup);
+    mw_timer_wheel_destroy(&g_state.reprotect_wheel);
+    
+    /* Unprotect every page while faults can still be serviced */
+    pthread_mutex_lock(&g_state.page_table_mutex);
+    mw_page_index_for_each(&g_state.page_index, free_page_entry, NULL);
+    mw_page_index_destroy(&g_state.page_index);
+    pthread_mutex_unlock(&g_state.page_table_mutex);
+    
+    if (g_state.backend == MW_BACKEND_UFFD_WP) {
+        mw_wakeup_notify(&g_state.uffd_stop);
+        pthread_join(g_state.uffd_thread, NULL);
+    }
+    backend_close();
     
     /* Restore signal handler */
-    if (g_state.protection_available) {
+    if (g_state.backend == MW_BACKEND_MPROTECT && g_state.protection_available) {
         sigaction(SIGSEGV, &g_state.old_segv_action, NULL);
     }
     
     /* Free resources */
-    free(g_state.ring);
-    free(g_state.page_table);
+    munmap(g_state.rings, g_state.rings_bytes);
+    mw_stats_close(&g_state.stats);
     
     pthread_mutex_lock(&g_state.regions_mutex);
     for (size_t i = 0; i < g_state.regions_capacity; i++) {
         if (g_state.regions[i]) {
+            free(g_state.regions[i]->block_tree);
             free(g_state.regions[i]);
         }
     }
@@ -235,6 +560,9 @@ static PyObject *mw_shutdown(PyObject *self, PyObject *args) {
     pthread_mutex_destroy(&g_state.page_table_mutex);
     pthread_mutex_destroy(&g_state.regions_mutex);
     pthread_mutex_destroy(&g_state.callback_mutex);
+    pthread_mutex_destroy(&g_state.governor_mutex);
+    Py_CLEAR(g_state.callback);
+    Py_CLEAR(g_state.batch_callback);
     
     memset(&g_state, 0, sizeof(g_state));
     
@@ -254,7 +582,7 @@ static PyObject *mw_track(PyObject *self, PyObject *args) {
         return NULL;
     }
     
-    if (!g_state.ring) {
+    if (!g_state.rings) {
         PyErr_SetString(PyExc_RuntimeError, "memwatch not initialized");
         return NULL;
     }
@@ -294,19 +622,29 @@ static PyObject *mw_track(PyObject *self, PyObject *args) {
     region->metadata_ref = metadata_ref;
     region->epoch = 0;
     region->max_value_bytes = max_value_bytes;
+    region->watchpoint = -1;
     region->last_check_time_ns = get_monotonic_ns();
     
-    /* Compute initial hash */
+    /* Compute initial hash (and block tree for large regions) */
     Py_BEGIN_ALLOW_THREADS
-    region->last_hash = hash_bytes((void*)addr, size);
+    region_blocks_init(region);
     Py_END_ALLOW_THREADS
     
     g_state.regions[region_id] = region;
     atomic_fetch_add(&g_state.tracked_region_count, 1);
-    atomic_fetch_add(&g_state.native_memory_bytes, sizeof(TrackedRegion));
+    atomic_fetch_add(&g_state.native_memory_bytes,
+                     sizeof(TrackedRegion) + region_blocks_bytes(region));
     
     pthread_mutex_unlock(&g_state.regions_mutex);
     
+    /* Small scalars: a debug register instead of protecting a shared page */
+    bool watched = false;
+    if (size > 0 && size <= MW_HWBP_MAX_LEN && g_state.watchpoints_enabled) {
+        Py_BEGIN_ALLOW_THREADS
+        watched = watchpoint_attach(region);
+        Py_END_ALLOW_THREADS
+    }
+    
     /* Add to page table and set protection */
     uintptr_t page_start = (addr / PAGE_SIZE) * PAGE_SIZE;
     uintptr_t page_end = ((addr + size - 1) / PAGE_SIZE) * PAGE_SIZE;
@@ -314,13 +652,10 @@ static PyObject *mw_track(PyObject *self, PyObject *args) {
     for (uintptr_t page = page_start; page <= page_end; page += PAGE_SIZE) {
         page_table_add_region(page, region);
         
-        /* Set page protection if available */
-        if (g_state.protection_available) {
+        /* Start detecting writes (failures are counted in arm_failures) */
+        if (!watched) {
             Py_BEGIN_ALLOW_THREADS
-            if (mprotect((void*)page, PAGE_SIZE, PROT_READ) != 0) {
-                /* Protection failed - log but continue */
-                /* In production, might want to track this */
-            }
+            backend_arm_page(page);
             Py_END_ALLOW_THREADS
         }
     }
@@ -328,6 +663,235 @@ static PyObject *mw_track(PyObject *self, PyObject *args) {
     return PyLong_FromUnsignedLong(region_id);
 }
 
+/* Initial hashing for track_many: regions are claimed one at a time */
+typedef struct {
+    TrackedRegion **regions;
+    size_t count;
+    atomic_size_t next;
+} HashJob;
+
+static void *hash_job_func(void *arg) {
+    HashJob *job = arg;
+    for (;;) {
+        size_t i = atomic_fetch_add(&job->next, 1);
+        if (i >= job->count) break;
+        region_blocks_init(job->regions[i]);
+    }
+    return NULL;
+}
+
+/* Hash regions on up to MAX_HASH_THREADS threads, the caller being one of them */
+static void regions_blocks_init_parallel(TrackedRegion **regions, size_t count) {
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        total += regions[i]->size;
+    }
+    
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t threads = total / HASH_BYTES_PER_THREAD;
+    if (threads > (size_t)(cpus > 0 ? cpus : 1)) threads = (size_t)(cpus > 0 ? cpus : 1);
+    if (threads > MAX_HASH_THREADS) threads = MAX_HASH_THREADS;
+    if (threads > count) threads = count;
+    
+    HashJob job = { .regions = regions, .count = count };
+    atomic_init(&job.next, 0);
+    
+    pthread_t helpers[MAX_HASH_THREADS];
+    size_t started = 0;
+    while (started + 1 < threads &&
+           pthread_create(&helpers[started], NULL, hash_job_func, &job) == 0) {
+        started++;
+    }
+    hash_job_func(&job);
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(helpers[i], NULL);
+    }
+}
+
+static int compare_page(const void *a, const void *b) {
+    uintptr_t x = *(const uintptr_t *)a, y = *(const uintptr_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/*
+ * Track many regions at once:
+ *   track_many([(addr, size, adapter_id, metadata_ref[, max_value_bytes]), ...])
+ * Hashes in parallel, takes each lock once and protects every run of
+ * adjacent pages with one call.
+ *
+ * Returns: list of region ids in input order
+ */
+static PyObject *mw_track_many(PyObject *self, PyObject *args) {
+    (void)self;  /* Unused in this function */
+    
+    PyObject *specs_obj;
+    if (!PyArg_ParseTuple(args, "O", &specs_obj)) {
+        return NULL;
+    }
+    if (!g_state.rings) {
+        PyErr_SetString(PyExc_RuntimeError, "memwatch not initialized");
+        return NULL;
+    }
+    
+    PyObject *specs = PySequence_Fast(specs_obj, "track_many expects a sequence of tuples");
+    if (!specs) return NULL;
+    size_t count = (size_t)PySequence_Fast_GET_SIZE(specs);
+    
+    TrackedRegion **regions = calloc(count ? count : 1, sizeof(TrackedRegion*));
+    PyObject *ids = PyList_New((Py_ssize_t)count);
+    if (!regions || !ids) {
+        free(regions);
+        Py_XDECREF(ids);
+        Py_DECREF(specs);
+        return PyErr_NoMemory();
+    }
+    
+    /* Parse everything before touching shared state */
+    size_t total_pages = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint64_t addr;
+        size_t size;
+        uint32_t adapter_id, metadata_ref;
+        int32_t max_value_bytes = 256;
+        
+        PyObject *item = PySequence_Fast_GET_ITEM(specs, (Py_ssize_t)i);
+        if (!PyTuple_Check(item) ||
+            !PyArg_ParseTuple(item, "KnII|i", &addr, &size, &adapter_id, &metadata_ref,
+                              &max_value_bytes)) {
+            if (!PyErr_Occurred()) {
+                PyErr_SetString(PyExc_TypeError,
+                                "track_many items are (addr, size, adapter_id, metadata_ref[, max_value_bytes])");
+            }
+            goto fail;
+        }
+        
+        TrackedRegion *region = calloc(1, sizeof(TrackedRegion));
+        if (!region) {
+            PyErr_NoMemory();
+            goto fail;
+        }
+        region->addr = addr;
+        region->size = size;
+        region->adapter_id = adapter_id;
+        region->metadata_ref = metadata_ref;
+        region->max_value_bytes = max_value_bytes;
+        region->watchpoint = -1;
+        regions[i] = region;
+        
+        if (size > 0) {
+            total_pages += (addr + size - 1) / PAGE_SIZE - addr / PAGE_SIZE + 1;
+        }
+    }
+    Py_DECREF(specs);
+    specs = NULL;
+    
+    uintptr_t *pages = malloc((total_pages ? total_pages : 1) * sizeof(uintptr_t));
+    if (!pages) {
+        PyErr_NoMemory();
+        goto fail;
+    }
+    
+    /* Initial hashes (and block trees) in parallel, without the GIL */
+    Py_BEGIN_ALLOW_THREADS
+    regions_blocks_init_parallel(regions, count);
+    Py_END_ALLOW_THREADS
+    
+    /* Ids: one lock, the array grows at most once */
+    pthread_mutex_lock(&g_state.regions_mutex);
+    size_t needed = g_state.next_region_id + count;
+    if (needed >= g_state.regions_capacity) {
+        size_t new_cap = g_state.regions_capacity;
+        while (new_cap <= needed) new_cap *= 2;
+        TrackedRegion **new_regions = realloc(g_state.regions, new_cap * sizeof(TrackedRegion*));
+        if (!new_regions) {
+            pthread_mutex_unlock(&g_state.regions_mutex);
+            free(pages);
+            PyErr_SetString(PyExc_MemoryError, "Failed to expand regions array");
+            goto fail;
+        }
+        memset(new_regions + g_state.regions_capacity, 0,
+               (new_cap - g_state.regions_capacity) * sizeof(TrackedRegion*));
+        g_state.regions = new_regions;
+        g_state.regions_capacity = new_cap;
+    }
+    
+    uint64_t now = get_monotonic_ns();
+    size_t region_bytes = 0;
+    for (size_t i = 0; i < count; i++) {
+        TrackedRegion *region = regions[i];
+        region->region_id = g_state.next_region_id++;
+        region->last_check_time_ns = now;
+        g_state.regions[region->region_id] = region;
+        region_bytes += sizeof(TrackedRegion) + region_blocks_bytes(region);
+    }
+    atomic_fetch_add(&g_state.tracked_region_count, (unsigned)count);
+    atomic_fetch_add(&g_state.native_memory_bytes, region_bytes);
+    pthread_mutex_unlock(&g_state.regions_mutex);
+    
+    Py_BEGIN_ALLOW_THREADS
+    
+    /* Small scalars take debug registers while they last */
+    if (g_state.watchpoints_enabled) {
+        for (size_t i = 0; i < count; i++) {
+            TrackedRegion *region = regions[i];
+            if (region->size > 0 && region->size <= MW_HWBP_MAX_LEN &&
+                !watchpoint_attach(region) && !g_state.watchpoints_enabled) {
+                break;  /* perf unavailable */
+            }
+        }
+    }
+    
+    /* Page table: one lock for the whole batch */
+    size_t npages = 0;
+    pthread_mutex_lock(&g_state.page_table_mutex);
+    for (size_t i = 0; i < count; i++) {
+        TrackedRegion *region = regions[i];
+        if (region->size == 0) continue;
+        
+        uintptr_t page_start = (region->addr / PAGE_SIZE) * PAGE_SIZE;
+        uintptr_t page_end = ((region->addr + region->size - 1) / PAGE_SIZE) * PAGE_SIZE;
+        for (uintptr_t page = page_start; page <= page_end; page += PAGE_SIZE) {
+            page_table_add_region_locked(page, region);
+            if (region_page_armed(region)) {
+                pages[npages++] = page;
+            }
+        }
+    }
+    pthread_mutex_unlock(&g_state.page_table_mutex);
+    
+    /* Arm each run of adjacent pages with one call */
+    qsort(pages, npages, sizeof(uintptr_t), compare_page);
+    size_t run_start = 0;
+    for (size_t i = 1; i <= npages; i++) {
+        if (i < npages && pages[i] <= pages[i - 1] + PAGE_SIZE) {
+            continue;  /* duplicate or adjacent page */
+        }
+        backend_arm_range(pages[run_start], pages[i - 1] + PAGE_SIZE - pages[run_start]);
+        run_start = i;
+    }
+    
+    Py_END_ALLOW_THREADS
+    free(pages);
+    
+    for (size_t i = 0; i < count; i++) {
+        PyList_SET_ITEM(ids, (Py_ssize_t)i, PyLong_FromUnsignedLong(regions[i]->region_id));
+    }
+    free(regions);
+    return ids;
+    
+fail:
+    for (size_t i = 0; i < count; i++) {
+        if (regions[i]) {
+            free(regions[i]->block_tree);
+            free(regions[i]);
+        }
+    }
+    free(regions);
+    Py_DECREF(ids);
+    Py_XDECREF(specs);
+    return NULL;
+}
+
 /* Untrack a memory region */
 static PyObject *mw_untrack(PyObject *self, PyObject *args) {
     (void)self;  /* Unused in this function */
@@ -351,6 +915,12 @@ static PyObject *mw_untrack(PyObject *self, PyObject *args) {
     
     pthread_mutex_unlock(&g_state.regions_mutex);
     
+    if (region->watchpoint >= 0) {
+        Py_BEGIN_ALLOW_THREADS
+        watchpoint_detach(region);
+        Py_END_ALLOW_THREADS
+    }
+    
     /* Remove from page table and restore protection */
     uintptr_t page_start = (region->addr / PAGE_SIZE) * PAGE_SIZE;
     uintptr_t page_end = ((region->addr + region->size - 1) / PAGE_SIZE) * PAGE_SIZE;
@@ -359,9 +929,12 @@ static PyObject *mw_untrack(PyObject *self, PyObject *args) {
         page_table_remove_region(page, region);
     }
     
-    free(region);
     atomic_fetch_sub(&g_state.tracked_region_count, 1);
-    atomic_fetch_sub(&g_state.native_memory_bytes, sizeof(TrackedRegion));
+    atomic_fetch_sub(&g_state.native_memory_bytes,
+                     sizeof(TrackedRegion) + region_blocks_bytes(region));
+    mw_stats_forget_region(&g_state.stats, region_id);
+    free(region->block_tree);
+    free(region);
     
     Py_RETURN_NONE;
 }
@@ -397,6 +970,145 @@ static PyObject *mw_set_callback(PyObject *self, PyObject *args) {
     Py_RETURN_NONE;
 }
 
+/* Set Python callback for batches: fn(EventBatch), at most max_batch events,
+ * delivered no later than max_latency_us after the first event was found */
+static PyObject *mw_set_batch_callback(PyObject *self, PyObject *args) {
+    (void)self;  /* Unused in this function */
+    
+    PyObject *callback;
+    unsigned int max_batch = 256;
+    unsigned long long max_latency_us = 1000;
+    
+    if (!PyArg_ParseTuple(args, "O|IK", &callback, &max_batch, &max_latency_us)) {
+        return NULL;
+    }
+    
+    if (callback != Py_None && !PyCallable_Check(callback)) {
+        PyErr_SetString(PyExc_TypeError, "Callback must be callable");
+        return NULL;
+    }
+    if (max_batch == 0) {
+        PyErr_SetString(PyExc_ValueError, "max_batch must be at least 1");
+        return NULL;
+    }
+    
+    pthread_mutex_lock(&g_state.callback_mutex);
+    
+    Py_XDECREF(g_state.batch_callback);
+    if (callback == Py_None) {
+        g_state.batch_callback = NULL;
+        atomic_store(&g_state.batch_max, 0);
+    } else {
+        Py_INCREF(callback);
+        g_state.batch_callback = callback;
+        atomic_store(&g_state.batch_latency_ns, max_latency_us * 1000ULL);
+        atomic_store(&g_state.batch_max, max_batch);
+    }
+    
+    pthread_mutex_unlock(&g_state.callback_mutex);
+    
+    if (g_state.rings) {
+        mw_wakeup_notify(&g_state.wakeup);  /* re-evaluate held events */
+    }
+    
+    Py_RETURN_NONE;
+}
+
+/* Set the overhead mode: set_mode(name) - "off", "lite", "balanced" or "deep" (None = off) */
+static PyObject *mw_set_mode(PyObject *self, PyObject *args) {
+    (void)self;  /* Unused in this function */
+    
+    const char *mode_name = NULL;
+    mw_gov_mode_t mode;
+    
+    if (!PyArg_ParseTuple(args, "z", &mode_name)) {
+        return NULL;
+    }
+    if (mw_gov_mode_parse(mode_name, &mode) != 0) {
+        PyErr_Format(PyExc_ValueError, "Unknown mode '%s' (expected off, lite, balanced or deep)",
+                     mode_name);
+        return NULL;
+    }
+    if (!g_state.rings) {
+        PyErr_SetString(PyExc_RuntimeError, "memwatch not initialized");
+        return NULL;
+    }
+    
+    pthread_mutex_lock(&g_state.governor_mutex);
+    mw_governor_set_mode(&g_state.governor, mode);
+    atomic_store(&g_state.governor_on, mode != MW_GOV_OFF);
+    pthread_mutex_unlock(&g_state.governor_mutex);
+    
+    mw_wakeup_notify(&g_state.wakeup);  /* demoted regions go back at the next tick */
+    
+    Py_RETURN_NONE;
+}
+
+/* Governor section of get_stats(): budget, decisions and where regions stand */
+static PyObject *governor_stats(void) {
+    static mw_gov_decision_t log[MW_GOV_LOG_SIZE];  /* under governor_mutex */
+    
+    pthread_mutex_lock(&g_state.governor_mutex);
+    const mw_governor_t *g = &g_state.governor;
+    double interval_ns = g->interval_ns ? (double)g->interval_ns : 1.0;
+    PyObject *governor = Py_BuildValue(
+        "{s:s,s:I,s:d,s:K,s:K,s:K,s:I}",
+        "mode", mw_gov_mode_name(g->mode),
+        "budget_pct", mw_gov_target_pct(g->mode),
+        "overhead_pct", 100.0 * (double)g->last_cost_ns / interval_ns,
+        "interval_ms", (unsigned long long)(g->interval_ns / 1000000ULL),
+        "demotions", (unsigned long long)g->demotions,
+        "promotions", (unsigned long long)g->promotions,
+        "demoted_regions", g->demoted);
+    PyObject *levels = PyDict_New();
+    PyObject *decisions = PyList_New(0);
+    size_t logged = mw_governor_decisions(g, log, MW_GOV_LOG_SIZE);
+    uint32_t regions_at[MW_GOV_LEVELS];
+    memcpy(regions_at, g->regions_at, sizeof(regions_at));
+    uint32_t demoted = g->demoted;
+    pthread_mutex_unlock(&g_state.governor_mutex);
+    
+    /* The governor only keeps track of regions it charged or demoted */
+    uint32_t tracked = atomic_load(&g_state.tracked_region_count);
+    regions_at[MW_GOV_FULL] = tracked > demoted ? tracked - demoted : 0;
+    
+    if (!governor || !levels || !decisions) {
+        Py_XDECREF(governor);
+        Py_XDECREF(levels);
+        Py_XDECREF(decisions);
+        return NULL;
+    }
+    
+    for (int level = 0; level < MW_GOV_LEVELS; level++) {
+        PyObject *count_obj = PyLong_FromUnsignedLong(regions_at[level]);
+        PyDict_SetItemString(levels, mw_gov_level_name((mw_gov_level_t)level), count_obj);
+        Py_DECREF(count_obj);
+    }
+    PyDict_SetItemString(governor, "levels", levels);
+    Py_DECREF(levels);
+    
+    for (size_t i = 0; i < logged; i++) {
+        const mw_gov_decision_t *d = &log[i];
+        PyObject *item = Py_BuildValue(
+            "{s:K,s:I,s:s,s:s,s:s,s:K,s:K}",
+            "time_ns", (unsigned long long)d->time_ns,
+            "region_id", d->region_id,
+            "from", mw_gov_level_name((mw_gov_level_t)d->from),
+            "to", mw_gov_level_name((mw_gov_level_t)d->to),
+            "reason", mw_gov_reason_name((mw_gov_reason_t)d->reason),
+            "cost_ns", (unsigned long long)d->cost_ns,
+            "total_ns", (unsigned long long)d->total_ns);
+        if (item) {
+            PyList_Append(decisions, item);
+            Py_DECREF(item);
+        }
+    }
+    PyDict_SetItemString(governor, "decisions", decisions);
+    Py_DECREF(decisions);
+    
+    return governor;
+}
+
 /* Get statistics */
 static PyObject *mw_get_stats(PyObject *self, PyObject *args) {
     (void)self;  /* Unused in this function */
@@ -408,29 +1120,127 @@ static PyObject *mw_get_stats(PyObject *self, PyObject *args) {
     PyDict_SetItemString(stats, "tracked_regions", tracked_obj);
     Py_DECREF(tracked_obj);
     
-    PyObject *capacity_obj = PyLong_FromUnsignedLong(RING_CAPACITY);
+    /* Capacity is per faulting thread */
+    PyObject *capacity_obj = PyLong_FromUnsignedLong(FAULT_RING_CAPACITY);
     PyDict_SetItemString(stats, "ring_capacity", capacity_obj);
     Py_DECREF(capacity_obj);
     
-    uint32_t head = atomic_load(&g_state.ring_head);
-    uint32_t tail = atomic_load(&g_state.ring_tail);
-    uint32_t used = (head >= tail) ? (head - tail) : (RING_CAPACITY - tail + head);
-    PyObject *used_obj = PyLong_FromUnsignedLong(used);
+    PyObject *used_obj = PyLong_FromUnsignedLong(fault_rings_used());
     PyDict_SetItemString(stats, "ring_used", used_obj);
     Py_DECREF(used_obj);
     
+    PyObject *rings_obj = PyLong_FromUnsignedLong(atomic_load(&g_state.active_rings));
+    PyDict_SetItemString(stats, "fault_rings", rings_obj);
+    Py_DECREF(rings_obj);
+    
     PyObject *dropped_obj = PyLong_FromUnsignedLong(atomic_load(&g_state.dropped_events));
     PyDict_SetItemString(stats, "dropped_events", dropped_obj);
     Py_DECREF(dropped_obj);
     
-    PyObject *mem_obj = PyLong_FromSize_t(atomic_load(&g_state.native_memory_bytes));
+    PyObject *coalesced_obj = PyLong_FromSize_t(atomic_load(&g_state.coalesced_faults));
+    PyDict_SetItemString(stats, "coalesced_faults", coalesced_obj);
+    Py_DECREF(coalesced_obj);
+    
+    PyObject *hashed_obj = PyLong_FromSize_t(atomic_load(&g_state.hashed_bytes));
+    PyDict_SetItemString(stats, "hashed_bytes", hashed_obj);
+    Py_DECREF(hashed_obj);
+    
+    PyObject *batches_obj = PyLong_FromSize_t(atomic_load(&g_state.batches_delivered));
+    PyDict_SetItemString(stats, "batches_delivered", batches_obj);
+    Py_DECREF(batches_obj);
+    
+    PyObject *reprotect_obj = PyLong_FromSize_t(atomic_load(&g_state.pending_reprotect));
+    PyDict_SetItemString(stats, "pending_reprotect", reprotect_obj);
+    Py_DECREF(reprotect_obj);
+    
+    PyObject *wakeups_obj = PyLong_FromSize_t(atomic_load(&g_state.wakeup.wakeups));
+    PyDict_SetItemString(stats, "worker_wakeups", wakeups_obj);
+    Py_DECREF(wakeups_obj);
+    
+    size_t index_bytes = mw_page_index_memory_bytes(&g_state.page_index);
+    PyObject *mem_obj = PyLong_FromSize_t(native_memory_bytes());
     PyDict_SetItemString(stats, "native_memory_bytes", mem_obj);
     Py_DECREF(mem_obj);
     
+    PyObject *pages_obj = PyLong_FromSize_t(mw_page_index_count(&g_state.page_index));
+    PyDict_SetItemString(stats, "tracked_pages", pages_obj);
+    Py_DECREF(pages_obj);
+    
+    PyObject *index_obj = PyLong_FromSize_t(index_bytes);
+    PyDict_SetItemString(stats, "page_index_bytes", index_obj);
+    Py_DECREF(index_obj);
+    
+    PyObject *kernel_obj = PyUnicode_FromString(mw_hash_kernel_name());
+    PyDict_SetItemString(stats, "hash_kernel", kernel_obj);
+    Py_DECREF(kernel_obj);
+    
+    PyObject *backend_obj = PyUnicode_FromString(mw_backend_name(g_state.backend));
+    PyDict_SetItemString(stats, "backend", backend_obj);
+    Py_DECREF(backend_obj);
+    
+    PyObject *arm_obj = PyLong_FromSize_t(atomic_load(&g_state.arm_failures));
+    PyDict_SetItemString(stats, "arm_failures", arm_obj);
+    Py_DECREF(arm_obj);
+    
+    PyObject *wp_obj = PyLong_FromUnsignedLong(atomic_load(&g_state.active_watchpoints));
+    PyDict_SetItemString(stats, "watchpoints", wp_obj);
+    Py_DECREF(wp_obj);
+    
+    PyObject *hits_obj = PyLong_FromSize_t(atomic_load(&g_state.watchpoint_hits));
+    PyDict_SetItemString(stats, "watchpoint_hits", hits_obj);
+    Py_DECREF(hits_obj);
+    
     PyObject *prot_obj = PyBool_FromLong(g_state.protection_available);
     PyDict_SetItemString(stats, "protection_available", prot_obj);
     Py_DECREF(prot_obj);
     
+    /* From the stats page: fault totals and per-stage latency percentiles */
+    const mw_stats_counters_t *counters = g_state.stats.hdr ? &g_state.stats.hdr->counters : NULL;
+    PyObject *faults_obj = PyLong_FromUnsignedLongLong(counters ? counters->faults : 0);
+    PyDict_SetItemString(stats, "faults", faults_obj);
+    Py_DECREF(faults_obj);
+    
+    PyObject *false_obj = PyLong_FromUnsignedLongLong(counters ? counters->false_faults : 0);
+    PyDict_SetItemString(stats, "false_faults", false_obj);
+    Py_DECREF(false_obj);
+    
+    PyObject *page_obj = Py_None;
+    if (g_state.stats.shared) {
+        page_obj = PyUnicode_FromString(g_state.stats.name + strlen("/memwatch-stats-"));
+    } else {
+        Py_INCREF(page_obj);
+    }
+    PyDict_SetItemString(stats, "stats_page", page_obj);
+    Py_DECREF(page_obj);
+    
+    PyObject *stages = PyDict_New();
+    mw_stats_hist_t hist;
+    for (int stage = 0; stage < MW_STAGE_COUNT; stage++) {
+        mw_stats_hist(&g_state.stats, (mw_stage_t)stage, &hist);
+        PyObject *stage_obj = Py_BuildValue(
+            "{s:K,s:d,s:K,s:K,s:K,s:K}",
+            "count", (unsigned long long)hist.count,
+            "mean_ns", hist.count ? (double)hist.sum_ns / (double)hist.count : 0.0,
+            "p50_ns", (unsigned long long)mw_stats_hist_percentile(&hist, 50),
+            "p90_ns", (unsigned long long)mw_stats_hist_percentile(&hist, 90),
+            "p99_ns", (unsigned long long)mw_stats_hist_percentile(&hist, 99),
+            "max_ns", (unsigned long long)hist.max_ns);
+        if (stage_obj) {
+            PyDict_SetItemString(stages, mw_stats_stage_name((mw_stage_t)stage), stage_obj);
+            Py_DECREF(stage_obj);
+        }
+    }
+    PyDict_SetItemString(stats, "stages", stages);
+    Py_DECREF(stages);
+    
+    PyObject *governor = governor_stats();
+    if (governor) {
+        PyDict_SetItemString(stats, "governor", governor);
+        Py_DECREF(governor);
+    } else {
+        PyErr_Clear();
+    }
+    
     return stats;
 }
 
@@ -455,176 +1265,1621 @@ static PyObject *mw_register_resolver(PyObject *self, PyObject *args) {
     Py_RETURN_NONE;
 }
 
-/* Signal handler - ASYNC-SIGNAL-SAFE ONLY */
-static void signal_handler(int sig, siginfo_t *si, void *unused) {
-    (void)unused;  /* Context parameter - unused */
-    
-    if (sig != SIGSEGV || !g_state.ring) {
+/* Forward a fault we don't own to the handler that was installed before us */
+static void chain_to_old_handler(int sig, siginfo_t *si, void *ctx) {
+    struct sigaction *old = &g_state.old_segv_action;
+    
+    if (old->sa_flags & SA_SIGINFO) {
+        if (old->sa_sigaction) {
+            old->sa_sigaction(sig, si, ctx);
+            return;
+        }
+    } else if (old->sa_handler != SIG_DFL && old->sa_handler != SIG_IGN) {
+        old->sa_handler(sig);
         return;
     }
     
-    uintptr_t fault_addr = (uintptr_t)si->si_addr;
-    uintptr_t page_start = (fault_addr / PAGE_SIZE) * PAGE_SIZE;
+    /* Default action: reinstall it so the re-executed access terminates us */
+    struct sigaction dfl;
+    memset(&dfl, 0, sizeof(dfl));
+    dfl.sa_handler = SIG_DFL;
+    sigemptyset(&dfl.sa_mask);
+    sigaction(sig, &dfl, NULL);
+}
+
+/*
+ * Find (or lazily claim) the calling thread's fault ring - ASYNC-SIGNAL-SAFE
+ *
+ * Returns: the ring, or NULL if all MAX_FAULT_RINGS slots are taken
+ */
+static FaultRing *fault_ring_for_current_thread(void) {
+    int tid = (int)syscall(SYS_gettid);
+    
+    unsigned slot = tls_ring_slot;
+    if (slot) {
+        FaultRing *ring = &g_state.rings[slot - 1];
+        if (atomic_load_explicit(&ring->owner_tid, memory_order_acquire) == tid) {
+            return ring;
+        }
+    }
+    
+    /* First fault on this thread (or a fork()ed child) - claim a free slot */
+    for (unsigned i = 0; i < MAX_FAULT_RINGS; i++) {
+        FaultRing *ring = &g_state.rings[i];
+        int expected = 0;
+        if (atomic_compare_exchange_strong(&ring->owner_tid, &expected, tid)) {
+            unsigned high_water = atomic_load(&g_state.ring_high_water);
+            while (high_water < i + 1 &&
+                   !atomic_compare_exchange_weak(&g_state.ring_high_water, &high_water, i + 1)) {
+            }
+            atomic_fetch_add(&g_state.active_rings, 1);
+            tls_ring_slot = i + 1;
+            return ring;
+        }
+    }
     
-    /* Atomic ring enqueue - O(1) only */
-    uint32_t seq = atomic_fetch_add(&g_state.seq_counter, 1);
-    uint32_t head = atomic_load(&g_state.ring_head);
-    uint32_t next_head = (head + 1) % RING_CAPACITY;
+    return NULL;
+}
+
+/*
+ * Append one fault to the caller's own ring - ASYNC-SIGNAL-SAFE
+ *
+ * Returns: false if the ring is full (the fault is counted as dropped)
+ */
+static bool fault_ring_push(FaultRing *ring, uintptr_t page_start, uintptr_t fault_ip,
+                            uint32_t thread_id) {
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
     
-    if (next_head == atomic_load(&g_state.ring_tail)) {
-        /* Ring full - drop event */
+    if (head - tail >= FAULT_RING_CAPACITY) {
         atomic_fetch_add(&g_state.dropped_events, 1);
-        return;
+        return false;
     }
     
-    /* Write event */
-    PageEvent *event = &g_state.ring[head];
+    /* Write event (seq is assigned by the worker once batches are merged) */
+    PageEvent *event = &ring->events[head & (FAULT_RING_CAPACITY - 1)];
     event->page_start = page_start;
-    event->fault_ip = fault_addr;  /* Use actual fault address */
+    event->fault_ip = fault_ip;
     event->adapter_id = 0;  /* resolved by worker */
     event->timestamp_ns = get_monotonic_ns();
-    event->seq = seq;
-    event->thread_id = (uint32_t)pthread_self();
+    event->seq = 0;
+    event->thread_id = thread_id;
     
-    atomic_store(&g_state.ring_head, next_head);
-    
-    /* Temporarily allow write to this page */
-    mprotect((void*)page_start, PAGE_SIZE, PROT_READ | PROT_WRITE);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return true;
 }
 
-/* Worker thread - drains ring and processes events */
-static void *worker_thread_func(void *arg) {
-    (void)arg;  /* Unused thread argument */
+/* Signal handler - ASYNC-SIGNAL-SAFE ONLY */
+static void signal_handler(int sig, siginfo_t *si, void *unused) {
+    (void)unused;  /* Context parameter - unused */
     
-    uint8_t preview_buffer[PREVIEW_SIZE];
+    if (sig != SIGSEGV || !g_state.rings) {
+        chain_to_old_handler(sig, si, unused);
+        return;
+    }
     
-    while (!atomic_load(&g_state.shutdown_requested)) {
-        uint32_t tail = atomic_load(&g_state.ring_tail);
-        uint32_t head = atomic_load(&g_state.ring_head);
+    uintptr_t fault_addr = (uintptr_t)si->si_addr;
+    uintptr_t page_start = (fault_addr / PAGE_SIZE) * PAGE_SIZE;
+    
+    /* Not one of our pages - a genuine crash or someone else's protection */
+    if (!mw_page_index_contains(&g_state.page_index, page_start)) {
+        chain_to_old_handler(sig, si, unused);
+        return;
+    }
+    
+    int saved_errno = errno;
+    uint64_t entered_ns = get_monotonic_ns();
+    
+    /* SPSC enqueue into this thread's ring - O(1), no shared cache lines */
+    FaultRing *ring = fault_ring_for_current_thread();
+    if (!ring) {
+        /* No ring free - leave the page protected, the write retries */
+        atomic_fetch_add(&g_state.dropped_events, 1);
+        errno = saved_errno;
+        return;
+    }
+    
+    /* fault_ip carries the actual fault address */
+    uint32_t tid = (uint32_t)atomic_load_explicit(&ring->owner_tid, memory_order_relaxed);
+    if (!fault_ring_push(ring, page_start, fault_addr, tid)) {
+        /* Ring full - the write retries once the worker drains */
+        mw_wakeup_signal(&g_state.wakeup);
+        errno = saved_errno;
+        return;
+    }
+    
+    /* Temporarily allow write to this page */
+    mprotect((void*)page_start, PAGE_SIZE, PROT_READ | PROT_WRITE);
+    
+    /* Wake the worker only if it is blocked - usually no syscall */
+    mw_wakeup_signal(&g_state.wakeup);
+    mw_stats_record(&g_state.stats, MW_STAGE_ENQUEUE, get_monotonic_ns() - entered_ns);
+    
+    errno = saved_errno;
+}
+
+/*
+ * uffd fault thread - the writer is blocked in the kernel until its page is
+ * released here. Never takes a lock or the GIL, so a callback (or any thread
+ * holding the GIL) writing a watched page cannot deadlock against it.
+ */
+static void *uffd_thread_func(void *arg) {
+    (void)arg;  /* Unused thread argument */
+    
+    mw_uffd_fault_t faults[UFFD_READ_BATCH];
+    struct pollfd fds[2] = {
+        { .fd = g_state.uffd.fd, .events = POLLIN, .revents = 0 },
+        { .fd = g_state.uffd_stop.fd, .events = POLLIN, .revents = 0 },
+    };
+    
+    for (;;) {
+        if (poll(fds, 2, -1) < 0 && errno != EINTR) break;
+        if (fds[1].revents & POLLIN) break;  /* shutdown */
+        
+        int n = mw_uffd_read(&g_state.uffd, faults, UFFD_READ_BATCH);
+        if (n < 0) break;
+        uint64_t read_ns = get_monotonic_ns();
+        
+        FaultRing *ring = fault_ring_for_current_thread();
+        for (int i = 0; i < n; i++) {
+            uintptr_t page_start = (faults[i].address / PAGE_SIZE) * PAGE_SIZE;
+            
+            if (ring && fault_ring_push(ring, page_start, faults[i].address, faults[i].thread_id)) {
+                /* Releasing the page also wakes the writer */
+                mw_uffd_protect(&g_state.uffd, page_start, PAGE_SIZE, false);
+                mw_stats_record(&g_state.stats, MW_STAGE_ENQUEUE, get_monotonic_ns() - read_ns);
+            } else {
+                /* No room - wake the writer still protected, its write faults again */
+                if (!ring) atomic_fetch_add(&g_state.dropped_events, 1);
+                mw_uffd_wake(&g_state.uffd, page_start, PAGE_SIZE);
+            }
+        }
+        
+        if (n > 0) {
+            mw_wakeup_signal(&g_state.wakeup);
+        }
+    }
+    
+    return NULL;
+}
+
+/*
+ * Watchpoint thread - turns breakpoint hits into ring events. The write has
+ * already happened (breakpoints trap after it), so nothing waits on us; the
+ * event takes the same writable-window path as a page fault. Also arms the
+ * watchpoints on threads started after they were opened.
+ */
+static void *watchpoint_thread_func(void *arg) {
+    (void)arg;  /* Unused thread argument */
+    
+    enum { MAX_FDS = 1 + MAX_HW_WATCHPOINTS * MW_HWBP_MAX_THREADS };
+    struct pollfd fds[MAX_FDS];
+    uint8_t slot_of[MAX_FDS];
+    uint8_t index_of[MAX_FDS];
+    mw_hwbp_hit_t hits[WATCHPOINT_READ_BATCH];
+    uint64_t last_rescan_ns = get_monotonic_ns();
+    
+    while (!atomic_load(&g_state.watchpoint_stop)) {
+        /* Rebuild the poll set - slots change rarely, this is cheap */
+        pthread_mutex_lock(&g_state.watchpoint_mutex);
+        uint64_t now = get_monotonic_ns();
+        if (now - last_rescan_ns >= (uint64_t)WATCHPOINT_RESCAN_MS * 1000000ULL) {
+            /* Breakpoints are per thread: cover threads started since */
+            for (int slot = 0; slot < MAX_HW_WATCHPOINTS; slot++) {
+                if (g_state.watchpoints[slot].used) {
+                    mw_hwbp_refresh(&g_state.watchpoints[slot].bp);
+                }
+            }
+            last_rescan_ns = now;
+        }
+        unsigned gen = atomic_load(&g_state.watchpoint_gen);
+        nfds_t n = 0;
+        fds[n++] = (struct pollfd){ .fd = g_state.watchpoint_ctl.fd, .events = POLLIN };
+        for (int slot = 0; slot < MAX_HW_WATCHPOINTS; slot++) {
+            HwWatchpoint *wp = &g_state.watchpoints[slot];
+            if (!wp->used) continue;
+            for (int i = 0; i < wp->bp.nfds; i++) {
+                fds[n] = (struct pollfd){ .fd = wp->bp.fds[i], .events = POLLIN };
+                slot_of[n] = (uint8_t)slot;
+                index_of[n] = (uint8_t)i;
+                n++;
+            }
+        }
+        g_state.watchpoint_polled_gen = gen;
+        pthread_cond_broadcast(&g_state.watchpoint_cond);
+        pthread_mutex_unlock(&g_state.watchpoint_mutex);
         
-        if (tail == head) {
-            /* Ring empty */
-            usleep(1000);  /* 1ms */
+        int ready = poll(fds, n, WATCHPOINT_RESCAN_MS);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (ready == 0) continue;
+        if (fds[0].revents & POLLIN) {
+            mw_wakeup_wait(&g_state.watchpoint_ctl, 0);  /* consume the ring */
             continue;
         }
+        uint64_t woke_ns = get_monotonic_ns();
         
-        /* Process event */
-        PageEvent event = g_state.ring[tail];
-        atomic_store(&g_state.ring_tail, (tail + 1) % RING_CAPACITY);
+        pthread_mutex_lock(&g_state.watchpoint_mutex);
+        if (gen != atomic_load(&g_state.watchpoint_gen)) {
+            pthread_mutex_unlock(&g_state.watchpoint_mutex);
+            continue;  /* a slot changed while polling, descriptors may be stale */
+        }
         
-        /* Find regions for this page */
-        pthread_mutex_lock(&g_state.page_table_mutex);
-        PageEntry *entry = page_table_find(event.page_start);
+        FaultRing *ring = fault_ring_for_current_thread();
+        bool pushed = false;
+        for (nfds_t k = 1; k < n; k++) {
+            if (!fds[k].revents) continue;
+            HwWatchpoint *wp = &g_state.watchpoints[slot_of[k]];
+            
+            int got = mw_hwbp_read(&wp->bp, index_of[k], hits, WATCHPOINT_READ_BATCH);
+            atomic_fetch_add(&g_state.watchpoint_hits, (size_t)got);
+            
+            /* One event per wakeup: the worker rehashes the region anyway */
+            if (got > 0) {
+                uintptr_t page_start = (wp->region_addr / PAGE_SIZE) * PAGE_SIZE;
+                if (!ring) {
+                    atomic_fetch_add(&g_state.dropped_events, 1);
+                } else if (fault_ring_push(ring, page_start, wp->region_addr,
+                                           hits[got - 1].thread_id)) {
+                    mw_stats_record(&g_state.stats, MW_STAGE_ENQUEUE, get_monotonic_ns() - woke_ns);
+                    pushed = true;
+                }
+                if (got > 1) {
+                    atomic_fetch_add(&g_state.coalesced_faults, (size_t)(got - 1));
+                }
+            }
+            
+            if (fds[k].revents & (POLLHUP | POLLERR)) {
+                mw_hwbp_drop(&wp->bp, index_of[k]);  /* its thread has exited */
+            }
+        }
+        pthread_mutex_unlock(&g_state.watchpoint_mutex);
         
-        if (!entry || !entry->regions) {
-            pthread_mutex_unlock(&g_state.page_table_mutex);
+        if (pushed) {
+            mw_wakeup_signal(&g_state.wakeup);
+        }
+    }
+    
+    return NULL;
+}
+
+/*
+ * Put a small region on a debug register.
+ *
+ * Returns: false if no register is free or perf is unavailable - the
+ *          caller falls back to page protection
+ */
+static bool watchpoint_attach(TrackedRegion *region) {
+    bool attached = false;
+    
+    pthread_mutex_lock(&g_state.watchpoint_mutex);
+    for (int slot = 0; slot < MAX_HW_WATCHPOINTS && !attached; slot++) {
+        HwWatchpoint *wp = &g_state.watchpoints[slot];
+        if (wp->used) continue;
+        
+        if (mw_hwbp_open(&wp->bp, region->addr, region->size) != 0) {
+            /* Out of debug registers is expected; anything else disables them */
+            if (errno != ENOSPC) {
+                g_state.watchpoints_enabled = false;
+            }
+            break;
+        }
+        
+        if (!g_state.watchpoint_thread_started) {
+            atomic_store(&g_state.watchpoint_stop, false);
+            if (pthread_create(&g_state.watchpoint_thread, NULL, watchpoint_thread_func, NULL) != 0) {
+                mw_hwbp_close(&wp->bp);
+                g_state.watchpoints_enabled = false;
+                break;
+            }
+            g_state.watchpoint_thread_started = true;
+        }
+        
+        wp->region_addr = region->addr;
+        wp->used = true;
+        region->watchpoint = slot;
+        attached = true;
+    }
+    if (attached) {
+        atomic_fetch_add(&g_state.watchpoint_gen, 1);
+        atomic_fetch_add(&g_state.active_watchpoints, 1);
+    }
+    pthread_mutex_unlock(&g_state.watchpoint_mutex);
+    
+    if (attached) {
+        mw_wakeup_notify(&g_state.watchpoint_ctl);
+    }
+    return attached;
+}
+
+/*
+ * Free a region's debug register (region->watchpoint is left for the page
+ * table). A descriptor inside a running poll() keeps its event - and the
+ * register - alive, so close only once the thread polls without it.
+ */
+static void watchpoint_detach(TrackedRegion *region) {
+    pthread_mutex_lock(&g_state.watchpoint_mutex);
+    HwWatchpoint *wp = &g_state.watchpoints[region->watchpoint];
+    wp->used = false;
+    unsigned gen = atomic_fetch_add(&g_state.watchpoint_gen, 1) + 1;
+    mw_wakeup_notify(&g_state.watchpoint_ctl);
+    while (g_state.watchpoint_thread_started && !atomic_load(&g_state.watchpoint_stop) &&
+           (int)(g_state.watchpoint_polled_gen - gen) < 0) {
+        pthread_cond_wait(&g_state.watchpoint_cond, &g_state.watchpoint_mutex);
+    }
+    mw_hwbp_close(&wp->bp);
+    atomic_fetch_sub(&g_state.active_watchpoints, 1);
+    pthread_mutex_unlock(&g_state.watchpoint_mutex);
+}
+
+/* Stop the watchpoint thread, then close every watchpoint */
+static void watchpoints_shutdown(void) {
+    if (g_state.watchpoint_thread_started) {
+        atomic_store(&g_state.watchpoint_stop, true);
+        mw_wakeup_notify(&g_state.watchpoint_ctl);
+        pthread_join(g_state.watchpoint_thread, NULL);
+        g_state.watchpoint_thread_started = false;
+    }
+    
+    for (int slot = 0; slot < MAX_HW_WATCHPOINTS; slot++) {
+        if (g_state.watchpoints[slot].used) {
+            mw_hwbp_close(&g_state.watchpoints[slot].bp);
+            g_state.watchpoints[slot].used = false;
+        }
+    }
+    atomic_store(&g_state.active_watchpoints, 0);
+    mw_wakeup_destroy(&g_state.watchpoint_ctl);
+    pthread_cond_destroy(&g_state.watchpoint_cond);
+    pthread_mutex_destroy(&g_state.watchpoint_mutex);
+}
+
+/* Pull up to max events from all rings, starting at a rotating ring so none starves */
+static size_t drain_fault_rings(PageEvent *batch, size_t max, unsigned *cursor) {
+    unsigned high_water = atomic_load(&g_state.ring_high_water);
+    size_t n = 0;
+    
+    for (unsigned k = 0; k < high_water && n < max; k++) {
+        FaultRing *ring = &g_state.rings[(*cursor + k) % high_water];
+        uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        
+        while (tail != head && n < max) {
+            batch[n++] = ring->events[tail & (FAULT_RING_CAPACITY - 1)];
+            tail++;
+        }
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+    }
+    
+    if (high_water) {
+        *cursor = (*cursor + 1) % high_water;
+    }
+    return n;
+}
+
+/* Release rings whose owning thread has exited (worker only) */
+static void reclaim_dead_rings(void) {
+    unsigned high_water = atomic_load(&g_state.ring_high_water);
+    pid_t pid = getpid();
+    
+    for (unsigned i = 0; i < high_water; i++) {
+        FaultRing *ring = &g_state.rings[i];
+        int tid = atomic_load(&ring->owner_tid);
+        if (tid == 0) continue;
+        if (atomic_load(&ring->head) != atomic_load(&ring->tail)) continue;
+        
+        /* A dead thread can never produce again, so the slot is ours to free */
+        if (syscall(SYS_tgkill, pid, tid, 0) == -1 && errno == ESRCH) {
+            if (atomic_compare_exchange_strong(&ring->owner_tid, &tid, 0)) {
+                atomic_fetch_sub(&g_state.active_rings, 1);
+            }
+        }
+    }
+}
+
+static int compare_event_page(const void *a, const void *b) {
+    const PageEvent *x = a, *y = b;
+    if (x->page_start != y->page_start) return x->page_start < y->page_start ? -1 : 1;
+    if (x->timestamp_ns != y->timestamp_ns) return x->timestamp_ns < y->timestamp_ns ? -1 : 1;
+    return 0;
+}
+
+static int compare_event_time(const void *a, const void *b) {
+    const PageEvent *x = a, *y = b;
+    if (x->timestamp_ns != y->timestamp_ns) return x->timestamp_ns < y->timestamp_ns ? -1 : 1;
+    return 0;
+}
+
+/*
+ * Merge repeated faults on the same page into one (keeping the latest),
+ * then restore time order and assign sequence numbers.
+ *
+ * Returns: number of unique pages left at the front of batch
+ */
+static size_t coalesce_batch(PageEvent *batch, size_t n) {
+    if (n > 1) {
+        qsort(batch, n, sizeof(PageEvent), compare_event_page);
+        
+        size_t out = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (i + 1 < n && batch[i + 1].page_start == batch[i].page_start) {
+                continue;  /* a later fault on this page follows */
+            }
+            batch[out++] = batch[i];
+        }
+        n = out;
+        
+        qsort(batch, n, sizeof(PageEvent), compare_event_time);
+    }
+    
+    for (size_t i = 0; i < n; i++) {
+        batch[i].seq = atomic_fetch_add(&g_state.seq_counter, 1);
+    }
+    return n;
+}
+
+/*
+ * Batch record - one per change in an EventBatch. Every field is naturally
+ * aligned, so the native layout matches BATCH_RECORD_FORMAT (PEP 3118) and
+ * numpy.asarray(batch) yields a structured array without copying.
+ */
+typedef struct {
+    uint32_t seq;
+    uint32_t region_id;
+    uint64_t timestamp_ns;
+    uint64_t fault_ip;
+    uint32_t adapter_id;
+    uint32_t flags;         /* BATCH_FLAG_* */
+    uint64_t how_big;
+    uint64_t value_offset;  /* into batch.values */
+    uint64_t value_len;
+    uint64_t range_start;   /* block events: offset of block bit 0 */
+    uint32_t block_size;
+    uint32_t block_mask;
+    uint64_t fingerprint;
+} BatchRecord;
+
+#define BATCH_FLAG_VALUE 1u   /* value_offset/value_len are valid */
+#define BATCH_FLAG_BLOCKS 2u  /* block event: value holds the changed blocks */
+
+#define BATCH_RECORD_FORMAT \
+    "T{I:seq:I:region_id:Q:timestamp_ns:Q:fault_ip:I:adapter_id:I:flags:" \
+    "Q:how_big:Q:value_offset:Q:value_len:Q:range_start:I:block_size:" \
+    "I:block_mask:Q:fingerprint:}"
+
+_Static_assert(sizeof(BatchRecord) == 80, "BatchRecord must have no padding");
+
+/*
+ * Record and arena buffers are recycled: an EventBatch hands its memory
+ * back here when Python drops the last reference, so steady-state delivery
+ * allocates nothing. Released from any thread holding the GIL.
+ */
+static struct {
+    pthread_mutex_t lock;
+    uint8_t *data[BUFFER_POOL_SLOTS];
+    size_t capacity[BUFFER_POOL_SLOTS];
+    size_t count;
+} g_buffer_pool = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static uint8_t *buffer_pool_acquire(size_t need, size_t *capacity) {
+    uint8_t *data = NULL;
+    size_t cap = 0;
+    
+    pthread_mutex_lock(&g_buffer_pool.lock);
+    if (g_buffer_pool.count > 0) {
+        g_buffer_pool.count--;
+        data = g_buffer_pool.data[g_buffer_pool.count];
+        cap = g_buffer_pool.capacity[g_buffer_pool.count];
+    }
+    pthread_mutex_unlock(&g_buffer_pool.lock);
+    
+    if (cap < need) {
+        size_t new_cap = need > BUFFER_MIN_CAPACITY ? need : BUFFER_MIN_CAPACITY;
+        uint8_t *grown = realloc(data, new_cap);
+        if (!grown) {
+            free(data);
+            return NULL;
+        }
+        data = grown;
+        cap = new_cap;
+    }
+    *capacity = cap;
+    return data;
+}
+
+static void buffer_pool_release(uint8_t *data, size_t capacity) {
+    if (!data) return;
+    
+    pthread_mutex_lock(&g_buffer_pool.lock);
+    if (g_buffer_pool.count < BUFFER_POOL_SLOTS) {
+        g_buffer_pool.data[g_buffer_pool.count] = data;
+        g_buffer_pool.capacity[g_buffer_pool.count] = capacity;
+        g_buffer_pool.count++;
+        data = NULL;
+    }
+    pthread_mutex_unlock(&g_buffer_pool.lock);
+    
+    free(data);
+}
+
+/*
+ * EventBatch - read-only buffer over pooled memory. A record batch exports
+ * BatchRecord items and keeps its value arena (itself a byte EventBatch)
+ * alive in .values, so memoryview slices of values stay valid for as long
+ * as Python holds them.
+ */
+typedef struct {
+    PyObject_HEAD
+    uint8_t *data;
+    size_t capacity;
+    Py_ssize_t count;     /* items */
+    Py_ssize_t itemsize;
+    const char *format;
+    PyObject *values;     /* arena batch, NULL for the arena itself */
+} EventBufferObject;
+
+static int event_buffer_getbuffer(PyObject *obj, Py_buffer *view, int flags) {
+    EventBufferObject *self = (EventBufferObject *)obj;
+    
+    if ((flags & PyBUF_WRITABLE) == PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "EventBatch is read-only");
+        view->obj = NULL;
+        return -1;
+    }
+    
+    view->buf = self->data;
+    view->obj = obj;
+    view->len = self->count * self->itemsize;
+    view->readonly = 1;
+    view->itemsize = self->itemsize;
+    view->format = (flags & PyBUF_FORMAT) ? (char *)self->format : NULL;
+    view->ndim = 1;
+    view->shape = (flags & PyBUF_ND) ? &self->count : NULL;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? &self->itemsize : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    Py_INCREF(obj);
+    return 0;
+}
+
+static void event_buffer_dealloc(PyObject *obj) {
+    EventBufferObject *self = (EventBufferObject *)obj;
+    Py_XDECREF(self->values);
+    buffer_pool_release(self->data, self->capacity);
+    Py_TYPE(obj)->tp_free(obj);
+}
+
+static Py_ssize_t event_buffer_length(PyObject *obj) {
+    return ((EventBufferObject *)obj)->count;
+}
+
+static PyObject *event_buffer_get_values(PyObject *obj, void *closure) {
+    (void)closure;
+    EventBufferObject *self = (EventBufferObject *)obj;
+    if (!self->values) {
+        Py_RETURN_NONE;
+    }
+    return PyMemoryView_FromObject(self->values);
+}
+
+static PyBufferProcs event_buffer_as_buffer = {
+    .bf_getbuffer = event_buffer_getbuffer,
+    .bf_releasebuffer = NULL,
+};
+
+static PySequenceMethods event_buffer_as_sequence = {
+    .sq_length = event_buffer_length,
+};
+
+static PyGetSetDef event_buffer_getset[] = {
+    {"values", event_buffer_get_values, NULL,
+     "memoryview of the value arena (records index it by value_offset/value_len)", NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyTypeObject EventBufferType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "_memwatch_native.EventBatch",
+    .tp_doc = "Batch of change records (buffer protocol, format BATCH_RECORD_FORMAT)",
+    .tp_basicsize = sizeof(EventBufferObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_dealloc = event_buffer_dealloc,
+    .tp_as_buffer = &event_buffer_as_buffer,
+    .tp_as_sequence = &event_buffer_as_sequence,
+    .tp_getset = event_buffer_getset,
+};
+
+/* Wrap pooled memory; takes ownership of data (released even on failure) */
+static PyObject *event_buffer_new(uint8_t *data, size_t capacity, Py_ssize_t count,
+                                  Py_ssize_t itemsize, const char *format, PyObject *values) {
+    EventBufferObject *self = PyObject_New(EventBufferObject, &EventBufferType);
+    if (!self) {
+        buffer_pool_release(data, capacity);
+        return NULL;
+    }
+    self->data = data;
+    self->capacity = capacity;
+    self->count = count;
+    self->itemsize = itemsize;
+    self->format = format;
+    Py_XINCREF(values);
+    self->values = values;
+    return (PyObject *)self;
+}
+
+/* A detected change, copied out so it can be delivered without page_table_mutex */
+typedef struct {
+    uint32_t seq;
+    uint64_t timestamp_ns;
+    uintptr_t fault_ip;
+    uint32_t adapter_id;
+    uint32_t region_id;
+    size_t size;
+    bool has_value;         /* false when max_value_bytes == 0 */
+    size_t value_offset;    /* into PendingChanges.arena */
+    size_t value_len;
+    
+    /* Block-tracked regions only (block_size == 0 otherwise): value holds
+     * the changed blocks' bytes back to back instead of the region prefix */
+    uint32_t block_size;
+    uint32_t block_mask;    /* bit i set: block first_block + i changed */
+    size_t first_block;
+    uint64_t fingerprint;   /* root hash after the change */
+} PendingChange;
+
+typedef struct {
+    PendingChange *items;
+    size_t count;
+    size_t capacity;
+    uint64_t oldest_ns;     /* when the first held change was found */
+    
+    /* Value bytes of every held change, back to back (pooled) */
+    uint8_t *arena;
+    size_t arena_len;
+    size_t arena_capacity;
+} PendingChanges;
+
+static PendingChange *pending_push(PendingChanges *pending) {
+    if (pending->count == pending->capacity) {
+        size_t new_cap = pending->capacity ? pending->capacity * 2 : 64;
+        PendingChange *items = realloc(pending->items, new_cap * sizeof(PendingChange));
+        if (!items) return NULL;
+        pending->items = items;
+        pending->capacity = new_cap;
+    }
+    return &pending->items[pending->count++];
+}
+
+/* Room for len value bytes in the arena; NULL if out of memory */
+static uint8_t *pending_reserve_value(PendingChanges *pending, size_t len, size_t *offset) {
+    size_t need = pending->arena_len + len;
+    if (need > pending->arena_capacity || !pending->arena) {
+        size_t new_cap = pending->arena_capacity ? pending->arena_capacity : BUFFER_MIN_CAPACITY;
+        while (new_cap < need) new_cap *= 2;  /* need may be 0: still allocate */
+        
+        uint8_t *arena = pending->arena ? realloc(pending->arena, new_cap)
+                                        : buffer_pool_acquire(new_cap, &new_cap);
+        if (!arena) return NULL;
+        pending->arena = arena;
+        pending->arena_capacity = new_cap;
+    }
+    *offset = pending->arena_len;
+    pending->arena_len = need;
+    return pending->arena + *offset;
+}
+
+static void pending_change_init(PendingChange *change, const PageEvent *event,
+                                const TrackedRegion *region) {
+    memset(change, 0, sizeof(*change));
+    change->seq = event->seq;
+    change->timestamp_ns = event->timestamp_ns;
+    change->fault_ip = event->fault_ip;
+    change->adapter_id = region->adapter_id;
+    change->region_id = region->region_id;
+    change->size = region->size;
+}
+
+/* max_value_bytes as the governor's level for the region allows it */
+static int32_t region_max_value_bytes(const TrackedRegion *region) {
+    return mw_gov_capture((mw_gov_level_t)region->gov.level, region->max_value_bytes);
+}
+
+/* Bytes of value to keep for a change of changed_len bytes */
+static size_t value_store_len(const TrackedRegion *region, size_t changed_len) {
+    int32_t max_value_bytes = region_max_value_bytes(region);
+    if (max_value_bytes > 0 && (size_t)max_value_bytes < changed_len) {
+        return (size_t)max_value_bytes;
+    }
+    return changed_len;
+}
+
+_Static_assert(MAX_BLOCKS_PER_PAGE <= 32, "block_mask holds one bit per block");
+
+/*
+ * Rehash only the blocks under one faulting page of a block-tracked region.
+ * Leaves are committed only once the change is queued, so a change that
+ * cannot be recorded is still seen on the next fault.
+ *
+ * Returns: true if a change was queued
+ */
+static bool collect_block_change(const PageEvent *event, TrackedRegion *region,
+                                 PendingChanges *pending) {
+    uintptr_t region_end = region->addr + region->size;
+    uintptr_t lo = event->page_start > region->addr ? event->page_start : region->addr;
+    uintptr_t hi = event->page_start + PAGE_SIZE < region_end ? event->page_start + PAGE_SIZE
+                                                              : region_end;
+    if (lo >= hi) return false;
+    
+    const uint8_t *base = (const uint8_t *)region->addr;
+    size_t first = (lo - region->addr) / region->block_size;
+    size_t last = (hi - 1 - region->addr) / region->block_size;
+    uint64_t fresh[MAX_BLOCKS_PER_PAGE];
+    uint32_t mask = 0;
+    size_t changed_len = 0;
+    size_t hashed = 0;
+    uint64_t started_ns = get_monotonic_ns();
+    
+    for (size_t b = first; b <= last; b++) {
+        size_t len = block_length(region, b);
+        fresh[b - first] = hash_bytes(base + b * region->block_size, len);
+        hashed += len;
+        if (fresh[b - first] != region->block_tree[b]) {
+            mask |= 1u << (b - first);
+            changed_len += len;
+        }
+    }
+    atomic_fetch_add_explicit(&g_state.hashed_bytes, hashed, memory_order_relaxed);
+    if (!mask) {
+        mw_stats_record(&g_state.stats, MW_STAGE_DIFF, get_monotonic_ns() - started_ns);
+        mw_stats_count_region(&g_state.stats, region->region_id, region->adapter_id, region->addr,
+                              region->size, NULL, false, hashed);
+        return false;
+    }
+    
+    PendingChange *change = pending_push(pending);
+    if (!change) {
+        atomic_fetch_add(&g_state.dropped_events, 1);
+        return false;
+    }
+    
+    for (size_t b = first; b <= last; b++) {
+        region->block_tree[b] = fresh[b - first];
+    }
+    size_t tree_hashed = block_tree_update(region, first, last);
+    atomic_fetch_add_explicit(&g_state.hashed_bytes, tree_hashed, memory_order_relaxed);
+    mw_stats_record(&g_state.stats, MW_STAGE_DIFF, get_monotonic_ns() - started_ns);
+    mw_stats_count_region(&g_state.stats, region->region_id, region->adapter_id, region->addr,
+                          region->size, NULL, true, hashed + tree_hashed);
+    mw_stats_count_page(&g_state.stats, event->page_start, 0, 1);
+    
+    pending_change_init(change, event, region);
+    change->block_size = region->block_size;
+    change->block_mask = mask;
+    change->first_block = first;
+    change->fingerprint = region->last_hash;
+    
+    /* Copy only the changed blocks, up to max_value_bytes in total */
+    if (region_max_value_bytes(region) != 0) {
+        size_t store_len = value_store_len(region, changed_len);
+        uint8_t *value = pending_reserve_value(pending, store_len, &change->value_offset);
+        if (value) {
+            size_t copied = 0;
+            for (size_t b = first; b <= last && copied < store_len; b++) {
+                if (!(mask & (1u << (b - first)))) continue;
+                size_t len = block_length(region, b);
+                if (len > store_len - copied) len = store_len - copied;
+                memcpy(value + copied, base + b * region->block_size, len);
+                copied += len;
+            }
+            change->has_value = true;
+            change->value_len = copied;
+        }
+    }
+    
+    region->epoch++;
+    return true;
+}
+
+/*
+ * Rehash a whole region (no block tree) after a write to one of its pages.
+ *
+ * Returns: true if a change was queued
+ */
+static bool collect_region_change(const PageEvent *event, TrackedRegion *region,
+                                  PendingChanges *pending) {
+    uint64_t started_ns = get_monotonic_ns();
+    uint64_t current_hash = hash_bytes((void*)region->addr, region->size);
+    atomic_fetch_add_explicit(&g_state.hashed_bytes, region->size, memory_order_relaxed);
+    bool changed = current_hash != region->last_hash;
+    mw_stats_record(&g_state.stats, MW_STAGE_DIFF, get_monotonic_ns() - started_ns);
+    mw_stats_count_region(&g_state.stats, region->region_id, region->adapter_id,
+                          region->addr, region->size, NULL, changed, region->size);
+    if (!changed) return false;
+    mw_stats_count_page(&g_state.stats, event->page_start, 0, 1);
+    
+    PendingChange *change = pending_push(pending);
+    if (!change) {
+        atomic_fetch_add(&g_state.dropped_events, 1);
+        return false;
+    }
+    pending_change_init(change, event, region);
+    
+    /* Copy value based on max_value_bytes setting */
+    if (region_max_value_bytes(region) != 0) {
+        size_t store_len = value_store_len(region, region->size);
+        uint8_t *value = pending_reserve_value(pending, store_len, &change->value_offset);
+        if (value) {
+            memcpy(value, (void*)region->addr, store_len);
+            change->has_value = true;
+            change->value_len = store_len;
+        }
+    }
+    
+    /* Update region state */
+    region->last_hash = current_hash;
+    region->epoch++;
+    return true;
+}
+
+/*
+ * Bill a region for one fault's share, the work done since started_ns and
+ * delivering its change, and keep it on the governor's list for the next
+ * tick; worker only
+ */
+static void governor_charge(TrackedRegion *region, uint64_t fault_share_ns, bool changed,
+                            uint64_t started_ns) {
+    uint64_t work_ns = fault_share_ns + get_monotonic_ns() - started_ns +
+                       (changed ? g_state.deliver_ns_per_change : 0);
+    mw_gov_charge(&region->gov, 1, work_ns);
+    if (region->gov.listed) return;
+    
+    if (g_state.governed.count == g_state.governed.capacity) {
+        size_t new_cap = g_state.governed.capacity ? g_state.governed.capacity * 2 : 64;
+        uint32_t *ids = realloc(g_state.governed.ids, new_cap * sizeof(uint32_t));
+        if (ids) g_state.governed.ids = ids;
+        mw_gov_ref_t *refs = realloc(g_state.governed.refs, new_cap * sizeof(mw_gov_ref_t));
+        if (refs) g_state.governed.refs = refs;
+        if (!ids || !refs) return;  /* unlisted: tried again on its next charge */
+        g_state.governed.capacity = new_cap;
+    }
+    g_state.governed.ids[g_state.governed.count++] = region->region_id;
+    region->gov.listed = true;
+}
+
+/* Rehash every region on the batch's pages; caller holds page_table_mutex */
+static void collect_changes(const PageEvent *batch, size_t n, PendingChanges *pending) {
+    bool charging = atomic_load_explicit(&g_state.governor_on, memory_order_relaxed);
+    
+    for (size_t i = 0; i < n; i++) {
+        const PageEvent *event = &batch[i];
+        PageEntry *entry = page_table_find(event->page_start);
+        if (!entry) continue;
+        
+        /* The fault was taken for every region checked here: split it */
+        uint64_t fault_share_ns = 0;
+        if (charging) {
+            int checked = 0;
+            for (int r = 0; r < entry->region_count; r++) {
+                checked += !mw_gov_sampled((mw_gov_level_t)entry->regions[r]->gov.level);
+            }
+            fault_share_ns = checked ? g_state.governor.fault_cost_ns / (uint64_t)checked : 0;
+        }
+        
+        for (int r = 0; r < entry->region_count; r++) {
+            TrackedRegion *region = entry->regions[r];
+            if (mw_gov_sampled((mw_gov_level_t)region->gov.level)) {
+                continue;  /* a neighbour's write: the governor samples this one */
+            }
+            
+            uint64_t started_ns = charging ? get_monotonic_ns() : 0;
+            bool changed = region->block_tree ? collect_block_change(event, region, pending)
+                                              : collect_region_change(event, region, pending);
+            if (charging) {
+                governor_charge(region, fault_share_ns, changed, started_ns);
+            }
+        }
+    }
+}
+
+/* List of (offset, length) tuples for a block change, adjacent blocks merged */
+static PyObject *changed_ranges_list(const PendingChange *change) {
+    PyObject *ranges = PyList_New(0);
+    if (!ranges) return NULL;
+    
+    unsigned bit = 0;
+    while (bit < MAX_BLOCKS_PER_PAGE) {
+        if (!(change->block_mask & (1u << bit))) {
+            bit++;
+            continue;
+        }
+        unsigned start = bit;
+        while (bit < MAX_BLOCKS_PER_PAGE && (change->block_mask & (1u << bit))) bit++;
+        
+        size_t offset = (change->first_block + start) * change->block_size;
+        size_t range_end = (change->first_block + bit) * change->block_size;
+        if (range_end > change->size) range_end = change->size;
+        
+        PyObject *item = Py_BuildValue("(nn)", (Py_ssize_t)offset,
+                                       (Py_ssize_t)(range_end - offset));
+        if (item) {
+            PyList_Append(ranges, item);
+            Py_DECREF(item);
+        }
+    }
+    return ranges;
+}
+
+/* Hand held changes to the batch callback, max_batch records per call; caller holds the GIL */
+static void deliver_batches(PendingChanges *pending, PyObject *callback, size_t max_batch) {
+    /* Every batch of this delivery shares one arena, which moves to Python */
+    PyObject *values = event_buffer_new(pending->arena, pending->arena_capacity,
+                                        (Py_ssize_t)pending->arena_len, 1, "B", NULL);
+    pending->arena = NULL;
+    pending->arena_len = 0;
+    pending->arena_capacity = 0;
+    if (!values) {
+        PyErr_Clear();
+        atomic_fetch_add(&g_state.dropped_events, (unsigned)pending->count);
+        return;
+    }
+    
+    for (size_t start = 0; start < pending->count; start += max_batch) {
+        size_t count = pending->count - start;
+        if (count > max_batch) count = max_batch;
+        
+        size_t capacity;
+        BatchRecord *records = (BatchRecord *)buffer_pool_acquire(count * sizeof(BatchRecord),
+                                                                  &capacity);
+        if (!records) {
+            atomic_fetch_add(&g_state.dropped_events, (unsigned)count);
+            continue;
+        }
+        
+        for (size_t i = 0; i < count; i++) {
+            const PendingChange *change = &pending->items[start + i];
+            BatchRecord *record = &records[i];
+            record->seq = change->seq;
+            record->region_id = change->region_id;
+            record->timestamp_ns = change->timestamp_ns;
+            record->fault_ip = change->fault_ip;
+            record->adapter_id = change->adapter_id;
+            record->flags = (change->has_value ? BATCH_FLAG_VALUE : 0) |
+                            (change->block_size ? BATCH_FLAG_BLOCKS : 0);
+            record->how_big = change->size;
+            record->value_offset = change->value_offset;
+            record->value_len = change->value_len;
+            record->range_start = change->first_block * change->block_size;
+            record->block_size = change->block_size;
+            record->block_mask = change->block_mask;
+            record->fingerprint = change->fingerprint;
+        }
+        
+        PyObject *batch = event_buffer_new((uint8_t *)records, capacity, (Py_ssize_t)count,
+                                           sizeof(BatchRecord), BATCH_RECORD_FORMAT, values);
+        if (!batch) {
+            PyErr_Clear();
+            atomic_fetch_add(&g_state.dropped_events, (unsigned)count);
             continue;
         }
         
-        /* Process each region on this page */
-        for (TrackedRegion *region = entry->regions; region; region = region->next_in_page) {
-            /* Compute current hash */
-            uint64_t current_hash = hash_bytes((void*)region->addr, region->size);
+        uint64_t called_ns = get_monotonic_ns();
+        PyObject *result = PyObject_CallFunctionObjArgs(callback, batch, NULL);
+        mw_stats_record(&g_state.stats, MW_STAGE_CALLBACK, get_monotonic_ns() - called_ns);
+        if (!result) {
+            PyErr_WriteUnraisable(callback);
+        }
+        Py_XDECREF(result);
+        Py_DECREF(batch);
+        atomic_fetch_add(&g_state.batches_delivered, 1);
+    }
+    
+    Py_DECREF(values);
+}
+
+/* True once held changes must go out: batch full, oldest too old, or not batching */
+static bool pending_due(const PendingChanges *pending, uint64_t now) {
+    if (pending->count == 0) return false;
+    
+    unsigned max_batch = atomic_load(&g_state.batch_max);
+    return max_batch == 0 || pending->count >= max_batch ||
+           now - pending->oldest_ns >= atomic_load(&g_state.batch_latency_ns);
+}
+
+/* Nanoseconds until held changes are due, or -1 if none are held */
+static int64_t pending_due_in_ns(const PendingChanges *pending, uint64_t now) {
+    if (pending->count == 0) return -1;
+    
+    uint64_t deadline = pending->oldest_ns + atomic_load(&g_state.batch_latency_ns);
+    return deadline > now ? (int64_t)(deadline - now) : 0;
+}
+
+/* Smoothed cost of handing one change to Python, GIL held (the app's threads wait), for governor_charge() */
+static void deliver_cost_update(uint64_t started_ns, size_t count) {
+    uint64_t per_change = (get_monotonic_ns() - started_ns) / count;
+    uint64_t smoothed = g_state.deliver_ns_per_change;
+    g_state.deliver_ns_per_change = smoothed ? (3 * smoothed + per_change) / 4 : per_change;
+}
+
+/* Deliver held changes as one batch or one dict per change; takes the GIL once */
+static void deliver_changes(PendingChanges *pending) {
+    if (pending->count == 0) return;
+    
+    PyGILState_STATE gstate = PyGILState_Ensure();
+    uint64_t started_ns = get_monotonic_ns();
+    
+    pthread_mutex_lock(&g_state.callback_mutex);
+    PyObject *batch_callback = g_state.batch_callback;
+    Py_XINCREF(batch_callback);
+    size_t max_batch = atomic_load(&g_state.batch_max);
+    pthread_mutex_unlock(&g_state.callback_mutex);
+    
+    if (batch_callback) {
+        deliver_batches(pending, batch_callback, max_batch ? max_batch : pending->count);
+        Py_DECREF(batch_callback);
+        PyGILState_Release(gstate);
+        deliver_cost_update(started_ns, pending->count);
+        pending->count = 0;
+        return;
+    }
+    
+    for (size_t i = 0; i < pending->count; i++) {
+        PendingChange *change = &pending->items[i];
+        PyObject *event_dict = PyDict_New();
+        
+        /* Create and add seq */
+        PyObject *seq_obj = PyLong_FromUnsignedLong(change->seq);
+        PyDict_SetItemString(event_dict, "seq", seq_obj);
+        Py_DECREF(seq_obj);
+        
+        /* Create and add timestamp */
+        PyObject *ts_obj = PyLong_FromUnsignedLongLong(change->timestamp_ns);
+        PyDict_SetItemString(event_dict, "timestamp_ns", ts_obj);
+        Py_DECREF(ts_obj);
+        
+        /* Create and add adapter_id */
+        PyObject *adapter_obj = PyLong_FromUnsignedLong(change->adapter_id);
+        PyDict_SetItemString(event_dict, "adapter_id", adapter_obj);
+        Py_DECREF(adapter_obj);
+        
+        /* Create and add region_id */
+        PyObject *region_obj = PyLong_FromUnsignedLong(change->region_id);
+        PyDict_SetItemString(event_dict, "region_id", region_obj);
+        Py_DECREF(region_obj);
+        
+        /* Create and add how_big */
+        PyObject *size_obj = PyLong_FromSize_t(change->size);
+        PyDict_SetItemString(event_dict, "how_big", size_obj);
+        Py_DECREF(size_obj);
+        
+        /* Add value (absent when max_value_bytes == 0) */
+        if (change->has_value) {
+            PyObject *value_obj = PyBytes_FromStringAndSize(
+                (char*)pending->arena + change->value_offset, change->value_len);
+            PyDict_SetItemString(event_dict, change->block_size ? "delta" : "new_value", value_obj);
+            Py_DECREF(value_obj);
+        }
+        
+        /* Block-tracked regions: where the change is and the new root hash */
+        if (change->block_size) {
+            PyObject *ranges_obj = changed_ranges_list(change);
+            if (ranges_obj) {
+                PyDict_SetItemString(event_dict, "ranges", ranges_obj);
+                Py_DECREF(ranges_obj);
+            }
             
-            if (current_hash != region->last_hash) {
-                /* Change detected - build event */
-                PyGILState_STATE gstate = PyGILState_Ensure();
-                
-                PyObject *event_dict = PyDict_New();
-                
-                /* Create and add seq */
-                PyObject *seq_obj = PyLong_FromUnsignedLong(event.seq);
-                PyDict_SetItemString(event_dict, "seq", seq_obj);
-                Py_DECREF(seq_obj);
-                
-                /* Create and add timestamp */
-                PyObject *ts_obj = PyLong_FromUnsignedLongLong(event.timestamp_ns);
-                PyDict_SetItemString(event_dict, "timestamp_ns", ts_obj);
-                Py_DECREF(ts_obj);
-                
-                /* Create and add adapter_id */
-                PyObject *adapter_obj = PyLong_FromUnsignedLong(region->adapter_id);
-                PyDict_SetItemString(event_dict, "adapter_id", adapter_obj);
-                Py_DECREF(adapter_obj);
-                
-                /* Create and add region_id */
-                PyObject *region_obj = PyLong_FromUnsignedLong(region->region_id);
-                PyDict_SetItemString(event_dict, "region_id", region_obj);
-                Py_DECREF(region_obj);
-                
-                /* Create and add how_big */
-                PyObject *size_obj = PyLong_FromSize_t(region->size);
-                PyDict_SetItemString(event_dict, "how_big", size_obj);
-                Py_DECREF(size_obj);
-                
-                /* Add value based on max_value_bytes setting */
-                if (region->max_value_bytes == 0) {
-                    /* No value storage requested */
-                } else if (region->max_value_bytes == -1) {
-                    /* Full value storage */
-                    PyObject *value_obj = PyBytes_FromStringAndSize((char*)region->addr, region->size);
-                    PyDict_SetItemString(event_dict, "new_value", value_obj);
-                    Py_DECREF(value_obj);
-                } else {
-                    /* Limited value storage */
-                    size_t store_len = (region->size < (size_t)region->max_value_bytes) ? 
-                                       region->size : (size_t)region->max_value_bytes;
-                    PyObject *value_obj = PyBytes_FromStringAndSize((char*)region->addr, store_len);
-                    PyDict_SetItemString(event_dict, "new_value", value_obj);
-                    Py_DECREF(value_obj);
+            PyObject *fp_obj = PyLong_FromUnsignedLongLong(change->fingerprint);
+            PyDict_SetItemString(event_dict, "fingerprint", fp_obj);
+            Py_DECREF(fp_obj);
+        }
+        
+        /* Add where info */
+        PyObject *where = PyDict_New();
+        char ip_str[32];
+        snprintf(ip_str, sizeof(ip_str), "0x%lx", change->fault_ip);
+        PyObject *ip_obj = PyUnicode_FromString(ip_str);
+        PyDict_SetItemString(where, "fault_ip", ip_obj);
+        Py_DECREF(ip_obj);
+        
+        PyDict_SetItemString(event_dict, "where", where);
+        Py_DECREF(where);  /* Dict took a reference */
+        
+        /* Invoke callback */
+        pthread_mutex_lock(&g_state.callback_mutex);
+        if (g_state.callback) {
+            uint64_t called_ns = get_monotonic_ns();
+            PyObject *result = PyObject_CallFunctionObjArgs(g_state.callback, event_dict, NULL);
+            mw_stats_record(&g_state.stats, MW_STAGE_CALLBACK, get_monotonic_ns() - called_ns);
+            Py_XDECREF(result);
+        }
+        pthread_mutex_unlock(&g_state.callback_mutex);
+        
+        Py_DECREF(event_dict);
+    }
+    
+    PyGILState_Release(gstate);
+    deliver_cost_update(started_ns, pending->count);
+    pending->count = 0;
+    pending->arena_len = 0;
+}
+
+/* Pages whose writable window has ended, collected from the timer wheel */
+typedef struct {
+    PageEvent *items;
+    size_t count;
+    size_t capacity;
+} ExpiredPages;
+
+static void collect_expired(void *payload, void *ctx) {
+    ExpiredPages *expired = ctx;
+    if (expired->count == expired->capacity) {
+        size_t new_cap = expired->capacity ? expired->capacity * 2 : 256;
+        PageEvent *items = realloc(expired->items, new_cap * sizeof(PageEvent));
+        if (!items) {
+            /* Page stays writable until touched again - count it as lost */
+            atomic_fetch_add(&g_state.dropped_events, 1);
+            return;
+        }
+        expired->items = items;
+        expired->capacity = new_cap;
+    }
+    memcpy(&expired->items[expired->count++], payload, sizeof(PageEvent));
+}
+
+static void collect_dirty_page(uintptr_t page_start, void *ctx) {
+    PageEvent event = { .page_start = page_start };
+    collect_expired(&event, ctx);
+}
+
+/*
+ * Soft-dirty backend: read every region's dirty bits with one pagemap read
+ * each, then clear them. Pages shared by several regions are reported once.
+ */
+static void soft_dirty_scan(ExpiredPages *dirty, uint64_t now) {
+    size_t first = dirty->count;
+    
+    pthread_mutex_lock(&g_state.regions_mutex);
+    for (size_t id = 0; id < g_state.regions_capacity; id++) {
+        TrackedRegion *region = g_state.regions[id];
+        if (!region || region->size == 0 || !region_page_armed(region)) continue;
+        
+        uintptr_t page_start = (region->addr / PAGE_SIZE) * PAGE_SIZE;
+        uintptr_t page_end = ((region->addr + region->size - 1) / PAGE_SIZE) * PAGE_SIZE;
+        mw_soft_dirty_scan(&g_state.soft_dirty, page_start, (page_end - page_start) / PAGE_SIZE + 1,
+                           collect_dirty_page, dirty);
+    }
+    mw_soft_dirty_clear(&g_state.soft_dirty);
+    pthread_mutex_unlock(&g_state.regions_mutex);
+    
+    for (size_t i = first; i < dirty->count; i++) {
+        dirty->items[i].timestamp_ns = now;
+    }
+    dirty->count = first + coalesce_batch(dirty->items + first, dirty->count - first);
+    for (size_t i = first; i < dirty->count; i++) {
+        mw_stats_count_page(&g_state.stats, dirty->items[i].page_start, 1, 0);
+    }
+}
+
+/*
+ * Rehash a sampled region as if each of its pages had faulted. Sampled
+ * regions are demoted, so already on the governor's list.
+ */
+static void governor_sample(TrackedRegion *region, uint64_t now, PendingChanges *pending) {
+    region->last_check_time_ns = now;
+    if (region->size == 0) return;
+    
+    uint64_t started_ns = get_monotonic_ns();
+    uintptr_t page_start = (region->addr / PAGE_SIZE) * PAGE_SIZE;
+    uintptr_t page_end = ((region->addr + region->size - 1) / PAGE_SIZE) * PAGE_SIZE;
+    PageEvent event = { .page_start = page_start, .adapter_id = region->adapter_id,
+                        .timestamp_ns = now };
+    uint32_t changes = 0;
+    uint32_t written_pages = 0;  /* what it would have faulted while protected */
+    
+    if (region->block_tree) {
+        for (uintptr_t page = page_start; page <= page_end; page += PAGE_SIZE) {
+            event.page_start = page;
+            if (collect_block_change(&event, region, pending)) {
+                pending->items[pending->count - 1].seq = atomic_fetch_add(&g_state.seq_counter, 1);
+                changes++;
+            }
+        }
+        written_pages = changes;
+    } else if (collect_region_change(&event, region, pending)) {
+        pending->items[pending->count - 1].seq = atomic_fetch_add(&g_state.seq_counter, 1);
+        changes = 1;
+        written_pages = (uint32_t)((page_end - page_start) / PAGE_SIZE + 1);
+    }
+    
+    uint64_t work_ns = get_monotonic_ns() - started_ns + changes * g_state.deliver_ns_per_change;
+    mw_gov_charge(&region->gov, written_pages, work_ns);
+}
+
+typedef struct {
+    PendingChanges *pending;
+    uint64_t now;
+} GovernorApply;
+
+/*
+ * A governor decision moved a region to another level: switch it between
+ * page protection and sampling when that changed. Caller holds
+ * regions_mutex and page_table_mutex.
+ */
+static void governor_apply(uint32_t region_id, mw_gov_region_t *state, mw_gov_level_t from,
+                           void *ctx) {
+    GovernorApply *apply = ctx;
+    TrackedRegion *region = g_state.regions[region_id];
+    mw_gov_level_t to = (mw_gov_level_t)state->level;
+    
+    mw_stats_region_level(&g_state.stats, region_id, to);
+    if (mw_gov_sampled(from) == mw_gov_sampled(to) || region->size == 0) return;
+    
+    uintptr_t page_start = (region->addr / PAGE_SIZE) * PAGE_SIZE;
+    uintptr_t page_end = ((region->addr + region->size - 1) / PAGE_SIZE) * PAGE_SIZE;
+    
+    if (mw_gov_sampled(to)) {
+        /* Stop trapping its writes; pages other regions rely on stay armed */
+        region->last_check_time_ns = apply->now;
+        if (region->watchpoint >= 0) {
+            watchpoint_detach(region);
+            region->watchpoint = -1;
+            return;
+        }
+        for (uintptr_t page = page_start; page <= page_end; page += PAGE_SIZE) {
+            PageEntry *entry = page_table_find(page);
+            if (entry && --entry->armed_count == 0) {
+                backend_disarm_page(page);
+            }
+        }
+        return;
+    }
+    
+    /* Trap writes again, then catch up on what changed since the last sample */
+    bool watched = region->size <= MW_HWBP_MAX_LEN && g_state.watchpoints_enabled &&
+                   watchpoint_attach(region);
+    for (uintptr_t page = page_start; page <= page_end && !watched; page += PAGE_SIZE) {
+        PageEntry *entry = page_table_find(page);
+        if (entry && entry->armed_count++ == 0) {
+            backend_arm_page(page);
+        }
+    }
+    governor_sample(region, apply->now, apply->pending);
+}
+
+/*
+ * One governor interval: sample the regions that are due, account every
+ * region charged since the last tick plus every demoted one, and apply the
+ * governor's decisions
+ */
+static void governor_tick(PendingChanges *pending, uint64_t now) {
+    const uint64_t slack_ns = (uint64_t)GOVERNOR_INTERVAL_MS * 1000000ULL / 2;  /* tick jitter */
+    
+    pthread_mutex_lock(&g_state.regions_mutex);
+    pthread_mutex_lock(&g_state.governor_mutex);
+    
+    size_t count = 0;
+    for (size_t i = 0; i < g_state.governed.count; i++) {
+        uint32_t id = g_state.governed.ids[i];
+        TrackedRegion *region = id < g_state.regions_capacity ? g_state.regions[id] : NULL;
+        if (!region) continue;  /* untracked since (ids are never reused) */
+        
+        mw_gov_level_t level = (mw_gov_level_t)region->gov.level;
+        if (mw_gov_sampled(level) &&
+            now + slack_ns - region->last_check_time_ns >= mw_gov_sample_ns(level)) {
+            governor_sample(region, now, pending);
+        }
+        g_state.governed.refs[count++] = (mw_gov_ref_t){ .state = &region->gov, .region_id = id };
+    }
+    
+    GovernorApply apply = { .pending = pending, .now = now };
+    pthread_mutex_lock(&g_state.page_table_mutex);
+    mw_governor_tick(&g_state.governor, g_state.governed.refs, count, now, governor_apply, &apply);
+    pthread_mutex_unlock(&g_state.page_table_mutex);
+    
+    /* Only demoted regions stay listed; the rest rejoin on their next charge */
+    g_state.governed.count = 0;
+    for (size_t i = 0; i < count; i++) {
+        mw_gov_ref_t *ref = &g_state.governed.refs[i];
+        ref->state->listed = ref->state->level != MW_GOV_FULL;
+        if (ref->state->listed) {
+            g_state.governed.ids[g_state.governed.count++] = ref->region_id;
+        }
+    }
+    
+    pthread_mutex_unlock(&g_state.governor_mutex);
+    pthread_mutex_unlock(&g_state.regions_mutex);
+}
+
+/*
+ * Writable window for a page: the longest any region protected on it has
+ * been granted. Caller holds page_table_mutex.
+ */
+static uint64_t page_window_ns(uintptr_t page_start, uint64_t window_ns) {
+    PageEntry *entry = page_table_find(page_start);
+    uint64_t longest = window_ns;
+    for (int r = 0; entry && r < entry->region_count; r++) {
+        const TrackedRegion *region = entry->regions[r];
+        if (!region_page_armed(region)) continue;
+        uint64_t ns = mw_gov_window_ns((mw_gov_level_t)region->gov.level, window_ns);
+        if (ns > longest) longest = ns;
+    }
+    return longest;
+}
+
+/* Events waiting in the fault rings */
+static uint32_t fault_rings_used(void) {
+    uint32_t used = 0;
+    uint32_t high_water = g_state.rings ? atomic_load(&g_state.ring_high_water) : 0;
+    for (uint32_t i = 0; i < high_water; i++) {
+        FaultRing *ring = &g_state.rings[i];
+        used += atomic_load(&ring->head) - atomic_load(&ring->tail);
+    }
+    return used;
+}
+
+/* Regions, page index and claimed rings */
+static size_t native_memory_bytes(void) {
+    size_t ring_bytes = (size_t)atomic_load(&g_state.ring_high_water) * sizeof(FaultRing);
+    return atomic_load(&g_state.native_memory_bytes) +
+           mw_page_index_memory_bytes(&g_state.page_index) + ring_bytes;
+}
+
+/* Refresh the stats page's gauges (worker) */
+static void publish_stats(void) {
+    mw_stats_counters_t gauges = {
+        .tracked_regions = atomic_load(&g_state.tracked_region_count),
+        .tracked_pages = mw_page_index_count(&g_state.page_index),
+        .ring_used = fault_rings_used(),
+        .ring_capacity = (uint64_t)FAULT_RING_CAPACITY * atomic_load(&g_state.active_rings),
+        .dropped_events = atomic_load(&g_state.dropped_events),
+        .coalesced_faults = atomic_load(&g_state.coalesced_faults),
+        .native_memory_bytes = native_memory_bytes(),
+        .worker_wakeups = atomic_load(&g_state.wakeup.wakeups),
+    };
+    
+    pthread_mutex_lock(&g_state.governor_mutex);
+    const mw_governor_t *g = &g_state.governor;
+    if (g->interval_ns) {
+        gauges.governor_budget_ppm = g->budget_ns * 1000000ULL / g->interval_ns;
+        gauges.governor_overhead_ppm = g->last_cost_ns * 1000000ULL / g->interval_ns;
+    }
+    gauges.governor_demoted = g->demoted;
+    gauges.governor_demotions = g->demotions;
+    gauges.governor_promotions = g->promotions;
+    pthread_mutex_unlock(&g_state.governor_mutex);
+    
+    mw_stats_publish(&g_state.stats, &gauges);
+}
+
+/* True if any fault ring holds undrained events */
+static bool fault_rings_pending(void) {
+    unsigned high_water = atomic_load(&g_state.ring_high_water);
+    for (unsigned i = 0; i < high_water; i++) {
+        FaultRing *ring = &g_state.rings[i];
+        if (atomic_load(&ring->head) != atomic_load(&ring->tail)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Worker thread - drains all fault rings in batches and processes events */
+static void *worker_thread_func(void *arg) {
+    (void)arg;  /* Unused thread argument */
+    
+    static PageEvent batch[FAULT_BATCH_MAX];  /* one worker per process */
+    mw_timer_wheel_t *wheel = &g_state.reprotect_wheel;
+    PendingChanges pending = {0};
+    ExpiredPages expired = {0};
+    unsigned cursor = 0;
+    uint64_t last_reclaim_ns = get_monotonic_ns();
+    uint64_t next_scan_ns = last_reclaim_ns;
+    uint64_t last_publish_ns = last_reclaim_ns;
+    uint64_t next_governor_ns = last_reclaim_ns;
+    const uint64_t scan_period_ns = (uint64_t)SOFT_DIRTY_SCAN_MS * 1000000ULL;
+    const uint64_t window_ns = (uint64_t)WRITABLE_WINDOW_MS * 1000000ULL;
+    const uint64_t governor_period_ns = (uint64_t)GOVERNOR_INTERVAL_MS * 1000000ULL;
+    
+    while (!atomic_load(&g_state.shutdown_requested)) {
+        size_t n = drain_fault_rings(batch, FAULT_BATCH_MAX, &cursor);
+        uint64_t now = get_monotonic_ns();
+        
+        if (n > 0) {
+            /* Before coalescing: every fault counts for its page */
+            for (size_t i = 0; i < n; i++) {
+                mw_stats_record(&g_state.stats, MW_STAGE_QUEUE_WAIT,
+                                now > batch[i].timestamp_ns ? now - batch[i].timestamp_ns : 0);
+                mw_stats_count_page(&g_state.stats, batch[i].page_start, 1, 0);
+            }
+            size_t unique = coalesce_batch(batch, n);
+            if (unique < n) {
+                atomic_fetch_add(&g_state.coalesced_faults, n - unique);
+            }
+            
+            /* Close each page's writable window later instead of sleeping now;
+             * pages of regions the governor demoted stay writable longer */
+            bool widened = g_state.governor.demoted > 0;
+            if (widened) pthread_mutex_lock(&g_state.page_table_mutex);
+            for (size_t i = 0; i < unique; i++) {
+                uint64_t deadline = now + (widened ? page_window_ns(batch[i].page_start, window_ns)
+                                                   : window_ns);
+                if (mw_timer_wheel_schedule(wheel, deadline, &batch[i]) != 0) {
+                    collect_expired(&batch[i], &expired);  /* no memory: expire now */
                 }
-                
-                /* Add where info */
-                PyObject *where = PyDict_New();
-                char ip_str[32];
-                snprintf(ip_str, sizeof(ip_str), "0x%lx", event.fault_ip);
-                PyObject *ip_obj = PyUnicode_FromString(ip_str);
-                PyDict_SetItemString(where, "fault_ip", ip_obj);
-                Py_DECREF(ip_obj);
-                
-                PyDict_SetItemString(event_dict, "where", where);
-                Py_DECREF(where);  /* Dict took a reference */
-                
-                /* Update region state */
-                region->last_hash = current_hash;
-                region->epoch++;
-                
-                /* Invoke callback */
-                pthread_mutex_lock(&g_state.callback_mutex);
-                if (g_state.callback) {
-                    PyObject *result = PyObject_CallFunctionObjArgs(g_state.callback, event_dict, NULL);
-                    Py_XDECREF(result);
+            }
+            if (widened) pthread_mutex_unlock(&g_state.page_table_mutex);
+        }
+        
+        /* Soft-dirty: pages written since the last scan need no re-protect */
+        if (g_state.backend == MW_BACKEND_SOFT_DIRTY && now >= next_scan_ns) {
+            soft_dirty_scan(&expired, now);
+            next_scan_ns = now + scan_period_ns;
+        }
+        
+        /* Every window that has ended: re-protect, then diff what was written */
+        mw_timer_wheel_advance(wheel, now, collect_expired, &expired);
+        atomic_store(&g_state.pending_reprotect, mw_timer_wheel_pending(wheel));
+        
+        if (expired.count > 0) {
+            /* Protect before hashing: a write racing the hash either lands
+             * first or faults and opens a new window - none is lost */
+            pthread_mutex_lock(&g_state.page_table_mutex);
+            for (size_t i = 0; i < expired.count; i++) {
+                PageEntry *entry = page_table_find(expired.items[i].page_start);
+                if (entry && entry->armed_count > 0) {
+                    backend_reprotect_page(expired.items[i].page_start);
                 }
-                pthread_mutex_unlock(&g_state.callback_mutex);
-                
-                Py_DECREF(event_dict);
-                PyGILState_Release(gstate);
             }
+            size_t held = pending.count;
+            collect_changes(expired.items, expired.count, &pending);
+            pthread_mutex_unlock(&g_state.page_table_mutex);
+            
+            if (held == 0 && pending.count > 0) {
+                pending.oldest_ns = now;
+            }
+            expired.count = 0;
+        }
+        
+        /* Overhead budget: while a mode is set, or regions are still demoted */
+        bool governing = atomic_load(&g_state.governor_on) || g_state.governor.demoted > 0;
+        if (governing && now >= next_governor_ns) {
+            size_t held = pending.count;
+            governor_tick(&pending, now);
+            if (held == 0 && pending.count > 0) {
+                pending.oldest_ns = now;
+            }
+            next_governor_ns = now + governor_period_ns;
         }
         
-        pthread_mutex_unlock(&g_state.page_table_mutex);
+        /* Deliver outside the lock: mw_track holds the GIL while taking it */
+        if (pending_due(&pending, now)) {
+            deliver_changes(&pending);
+        }
         
-        /* Re-protect page after writable window */
-        if (g_state.protection_available) {
-            usleep(WRITABLE_WINDOW_MS * 1000);
-            mprotect((void*)event.page_start, PAGE_SIZE, PROT_READ);
+        if (now - last_publish_ns >= (uint64_t)STATS_PUBLISH_MS * 1000000ULL) {
+            publish_stats();
+            last_publish_ns = now;
+        }
+        
+        if (n > 0) {
+            continue;  /* keep draining until the rings are empty */
+        }
+        
+        /* Idle - a good moment to recycle rings of exited threads */
+        if (now - last_reclaim_ns >= (uint64_t)RING_RECLAIM_INTERVAL_MS * 1000000ULL) {
+            reclaim_dead_rings();
+            last_reclaim_ns = now;
+        }
+        
+        /* Block until a fault rings the doorbell, the next window ends or
+         * held changes are due */
+        uint64_t wait_from = get_monotonic_ns();
+        int64_t next_ns = mw_timer_wheel_next_ns(wheel, wait_from);
+        int64_t due_ns = pending_due_in_ns(&pending, wait_from);
+        if (due_ns >= 0 && (next_ns < 0 || due_ns < next_ns)) {
+            next_ns = due_ns;
+        }
+        if (g_state.backend == MW_BACKEND_SOFT_DIRTY) {
+            int64_t scan_ns = next_scan_ns > wait_from ? (int64_t)(next_scan_ns - wait_from) : 0;
+            if (next_ns < 0 || scan_ns < next_ns) {
+                next_ns = scan_ns;
+            }
         }
+        if (governing) {
+            int64_t tick_ns = next_governor_ns > wait_from ? (int64_t)(next_governor_ns - wait_from) : 0;
+            if (next_ns < 0 || tick_ns < next_ns) {
+                next_ns = tick_ns;
+            }
+        }
+        int timeout_ms = next_ns < 0 ? RING_RECLAIM_INTERVAL_MS
+                                     : (int)((next_ns + 999999) / 1000000);
+        if (g_state.stats.shared && timeout_ms > STATS_PUBLISH_MS) {
+            timeout_ms = STATS_PUBLISH_MS;  /* readers are watching the gauges */
+        }
+        
+        mw_wakeup_prepare(&g_state.wakeup);
+        if (fault_rings_pending() || atomic_load(&g_state.shutdown_requested)) {
+            mw_wakeup_cancel(&g_state.wakeup);
+            continue;
+        }
+        mw_wakeup_wait(&g_state.wakeup, timeout_ms);
     }
     
+    deliver_changes(&pending);  /* flush changes still held for a batch */
+    free(pending.items);
+    buffer_pool_release(pending.arena, pending.arena_capacity);
+    free(expired.items);
+    free(g_state.governed.ids);
+    free(g_state.governed.refs);
     return NULL;
 }
 
-/* Hash function - FNV-1a */
+/* Hash function - shared SIMD kernel picked for this CPU at load time */
 static uint64_t hash_bytes(const void *data, size_t len) {
-    const uint8_t *bytes = data;
-    uint64_t hash = 14695981039346656037ULL;
+    return mw_hash64(data, len);
+}
+
+/* Leaf granularity for a region of this size; 0 = hash the region as a whole */
+static uint32_t block_size_for(size_t size) {
+    if (size < BLOCK_DIFF_THRESHOLD) return 0;
+    return size < FINGERPRINT_THRESHOLD ? DIFF_BLOCK_SIZE : PAGE_SIZE;
+}
+
+static size_t block_tree_nodes(const TrackedRegion *region) {
+    return (region->block_count + LEAVES_PER_NODE - 1) / LEAVES_PER_NODE;
+}
+
+/* Bytes of the region covered by a block (the last one may be short) */
+static size_t block_length(const TrackedRegion *region, size_t block) {
+    size_t rest = region->size - block * region->block_size;
+    return rest < region->block_size ? rest : region->block_size;
+}
+
+/* Rehash the nodes above leaves [first, last], then the root; returns bytes hashed */
+static size_t block_tree_update(TrackedRegion *region, size_t first, size_t last) {
+    uint64_t *nodes = region->block_tree + region->block_count;
+    size_t hashed = 0;
+    
+    for (size_t n = first / LEAVES_PER_NODE; n <= last / LEAVES_PER_NODE; n++) {
+        size_t leaf = n * LEAVES_PER_NODE;
+        size_t count = region->block_count - leaf;
+        if (count > LEAVES_PER_NODE) count = LEAVES_PER_NODE;
+        nodes[n] = hash_bytes(region->block_tree + leaf, count * sizeof(uint64_t));
+        hashed += count * sizeof(uint64_t);
+    }
     
-    for (size_t i = 0; i < len; i++) {
-        hash ^= bytes[i];
-        hash *= 1099511628211ULL;
+    size_t node_bytes = block_tree_nodes(region) * sizeof(uint64_t);
+    region->last_hash = hash_bytes(nodes, node_bytes);
+    return hashed + node_bytes;
+}
+
+/* Hash a new region: a block tree when large enough, else one hash of the whole */
+static void region_blocks_init(TrackedRegion *region) {
+    region->block_size = block_size_for(region->size);
+    if (region->block_size) {
+        region->block_count = (region->size + region->block_size - 1) / region->block_size;
+        region->block_tree = malloc((region->block_count + block_tree_nodes(region)) *
+                                    sizeof(uint64_t));
+    }
+    
+    if (!region->block_tree) {
+        /* Small region, or no memory for the tree: diff it as a whole */
+        region->block_size = 0;
+        region->block_count = 0;
+        region->last_hash = hash_bytes((void*)region->addr, region->size);
+        return;
     }
     
-    return hash;
+    const uint8_t *base = (const uint8_t *)region->addr;
+    for (size_t b = 0; b < region->block_count; b++) {
+        region->block_tree[b] = hash_bytes(base + b * region->block_size, block_length(region, b));
+    }
+    block_tree_update(region, 0, region->block_count - 1);
+}
+
+static size_t region_blocks_bytes(const TrackedRegion *region) {
+    if (!region->block_tree) return 0;
+    return (region->block_count + block_tree_nodes(region)) * sizeof(uint64_t);
 }
 
 /* Get monotonic timestamp in nanoseconds */
@@ -634,51 +2889,107 @@ static uint64_t get_monotonic_ns(void) {
     return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
 }
 
-/* Page table functions */
-static PageEntry *page_table_find(uintptr_t page_start) {
-    size_t index = (page_start / PAGE_SIZE) % g_state.page_table_capacity;
+/* Backend page operations - callers hold page_table_mutex (or own the page) */
+static void backend_arm_page(uintptr_t page_start) {
+    backend_arm_range(page_start, PAGE_SIZE);
+}
+
+/* Start detecting writes on [start, start + len), page aligned */
+static void backend_arm_range(uintptr_t start, size_t len) {
+    int rc = 0;
     
-    for (size_t i = 0; i < g_state.page_table_capacity; i++) {
-        size_t idx = (index + i) % g_state.page_table_capacity;
-        if (g_state.page_table[idx].page_start == page_start) {
-            return &g_state.page_table[idx];
+    switch (g_state.backend) {
+    case MW_BACKEND_MPROTECT:
+        if (g_state.protection_available) {
+            rc = mprotect((void*)start, len, PROT_READ);
         }
-        if (g_state.page_table[idx].page_start == 0) {
-            return NULL;
+        break;
+    case MW_BACKEND_UFFD_WP:
+        /* Registering an already registered page is a no-op */
+        rc = mw_uffd_register(&g_state.uffd, start, len);
+        if (rc == 0) {
+            rc = mw_uffd_protect(&g_state.uffd, start, len, true);
         }
+        break;
+    case MW_BACKEND_SOFT_DIRTY:
+        break;  /* the next scan picks it up */
     }
     
-    return NULL;
+    if (rc != 0) {
+        atomic_fetch_add(&g_state.arm_failures, len / PAGE_SIZE);
+    }
+}
+
+/* End of a writable window */
+static void backend_reprotect_page(uintptr_t page_start) {
+    if (g_state.backend == MW_BACKEND_MPROTECT && g_state.protection_available) {
+        mprotect((void*)page_start, PAGE_SIZE, PROT_READ);
+    } else if (g_state.backend == MW_BACKEND_UFFD_WP) {
+        mw_uffd_protect(&g_state.uffd, page_start, PAGE_SIZE, true);
+    }
+}
+
+/* Last region on the page is gone */
+static void backend_disarm_page(uintptr_t page_start) {
+    if (g_state.backend == MW_BACKEND_MPROTECT && g_state.protection_available) {
+        mprotect((void*)page_start, PAGE_SIZE, PROT_READ | PROT_WRITE);
+    } else if (g_state.backend == MW_BACKEND_UFFD_WP) {
+        mw_uffd_protect(&g_state.uffd, page_start, PAGE_SIZE, false);
+        mw_uffd_unregister(&g_state.uffd, page_start, PAGE_SIZE);
+    }
+}
+
+/* Page table functions - callers hold page_table_mutex for the region lists */
+static PageEntry *page_table_find(uintptr_t page_start) {
+    return (PageEntry *)mw_page_index_get(&g_state.page_index, page_start);
 }
 
 static void page_table_add_region(uintptr_t page_start, TrackedRegion *region) {
     pthread_mutex_lock(&g_state.page_table_mutex);
-    
+    page_table_add_region_locked(page_start, region);
+    pthread_mutex_unlock(&g_state.page_table_mutex);
+}
+
+static void page_table_add_region_locked(uintptr_t page_start, TrackedRegion *region) {
     PageEntry *entry = page_table_find(page_start);
     
     if (!entry) {
-        /* Find empty slot */
-        size_t index = (page_start / PAGE_SIZE) % g_state.page_table_capacity;
-        for (size_t i = 0; i < g_state.page_table_capacity; i++) {
-            size_t idx = (index + i) % g_state.page_table_capacity;
-            if (g_state.page_table[idx].page_start == 0) {
-                entry = &g_state.page_table[idx];
-                entry->page_start = page_start;
-                entry->regions = NULL;
-                entry->region_count = 0;
-                break;
+        entry = calloc(1, sizeof(PageEntry));
+        if (entry) {
+            entry->page_start = page_start;
+            if (mw_page_index_put(&g_state.page_index, page_start, entry) != 0) {
+                free(entry);
+                entry = NULL;
+            } else {
+                atomic_fetch_add(&g_state.native_memory_bytes, sizeof(PageEntry));
             }
         }
     }
     
-    if (entry) {
-        /* Add to linked list */
-        region->next_in_page = entry->regions;
-        entry->regions = region;
-        entry->region_count++;
+    if (entry && entry->region_count == entry->region_capacity) {
+        int new_cap = entry->region_capacity ? entry->region_capacity * 2 : 4;
+        TrackedRegion **regions = realloc(entry->regions, new_cap * sizeof(TrackedRegion*));
+        if (regions) {
+            atomic_fetch_add(&g_state.native_memory_bytes,
+                             (new_cap - entry->region_capacity) * sizeof(TrackedRegion*));
+            entry->regions = regions;
+            entry->region_capacity = new_cap;
+        } else if (entry->region_count == 0) {
+            mw_page_index_remove(&g_state.page_index, page_start);
+            free(entry);
+            atomic_fetch_sub(&g_state.native_memory_bytes, sizeof(PageEntry));
+            entry = NULL;
+        } else {
+            entry = NULL;
+        }
     }
     
-    pthread_mutex_unlock(&g_state.page_table_mutex);
+    if (entry) {
+        entry->regions[entry->region_count++] = region;
+        if (region_page_armed(region)) {
+            entry->armed_count++;
+        }
+    }
 }
 
 static void page_table_remove_region(uintptr_t page_start, TrackedRegion *region) {
@@ -686,20 +2997,23 @@ static void page_table_remove_region(uintptr_t page_start, TrackedRegion *region
     
     PageEntry *entry = page_table_find(page_start);
     if (entry) {
-        TrackedRegion **prev = &entry->regions;
-        for (TrackedRegion *curr = entry->regions; curr; curr = curr->next_in_page) {
-            if (curr == region) {
-                *prev = curr->next_in_page;
-                entry->region_count--;
+        for (int i = 0; i < entry->region_count; i++) {
+            if (entry->regions[i] == region) {
+                entry->regions[i] = entry->regions[--entry->region_count];
+                if (region_page_armed(region) && --entry->armed_count == 0) {
+                    /* Only watchpoint or sampled regions (or none) left: restore write permission */
+                    backend_disarm_page(page_start);
+                }
                 break;
             }
-            prev = &curr->next_in_page;
         }
         
-        /* If no more regions on this page, restore write permission */
-        if (entry->region_count == 0 && g_state.protection_available) {
-            mprotect((void*)page_start, PAGE_SIZE, PROT_READ | PROT_WRITE);
-            entry->page_start = 0;
+        if (entry->region_count == 0) {
+            mw_page_index_remove(&g_state.page_index, page_start);
+            atomic_fetch_sub(&g_state.native_memory_bytes,
+                             sizeof(PageEntry) + entry->region_capacity * sizeof(TrackedRegion*));
+            free(entry->regions);
+            free(entry);
         }
     }
     
@@ -711,8 +3025,14 @@ static PyMethodDef MemwatchMethods[] = {
     {"init", mw_init, METH_VARARGS, "Initialize memwatch core"},
     {"shutdown", mw_shutdown, METH_VARARGS, "Shutdown memwatch core"},
     {"track", mw_track, METH_VARARGS, "Track a memory region"},
+    {"track_many", mw_track_many, METH_VARARGS,
+     "Track many regions: [(addr, size, adapter_id, metadata_ref[, max_value_bytes])]"},
     {"untrack", mw_untrack, METH_VARARGS, "Untrack a memory region"},
     {"set_callback", mw_set_callback, METH_VARARGS, "Set event callback"},
+    {"set_batch_callback", mw_set_batch_callback, METH_VARARGS,
+     "Set batch callback: fn(EventBatch), max_batch, max_latency_us"},
+    {"set_mode", mw_set_mode, METH_VARARGS,
+     "Set the overhead mode: off, lite (5% of a CPU), balanced (30%) or deep (100%)"},
     {"get_stats", mw_get_stats, METH_VARARGS, "Get statistics"},
     {"register_resolver", mw_register_resolver, METH_VARARGS, "Register resolver function"},
     {NULL, NULL, 0, NULL}
@@ -731,5 +3051,22 @@ static struct PyModuleDef memwatch_module = {
 };
 
 PyMODINIT_FUNC PyInit__memwatch_native(void) {  /* Function name must match module name */
-    return PyModule_Create(&memwatch_module);
+    if (PyType_Ready(&EventBufferType) < 0) {
+        return NULL;
+    }
+    
+    PyObject *module = PyModule_Create(&memwatch_module);
+    if (!module) {
+        return NULL;
+    }
+    
+    Py_INCREF(&EventBufferType);
+    if (PyModule_AddObject(module, "EventBatch", (PyObject *)&EventBufferType) < 0 ||
+        PyModule_AddStringConstant(module, "BATCH_RECORD_FORMAT", BATCH_RECORD_FORMAT) < 0 ||
+        PyModule_AddIntConstant(module, "BATCH_RECORD_SIZE", sizeof(BatchRecord)) < 0) {
+        Py_DECREF(&EventBufferType);
+        Py_DECREF(module);
+        return NULL;
+    }
+    return module;
 }
@@ -0,0 +1,133 @@
+/*
+ * memwatch_arena.c - Page-isolated arena for auto-tracked allocations
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "memwatch_arena.h"
+
+#define NO_SLOT UINT32_MAX
+
+static size_t zone_of(const mw_arena_t *a, const void *ptr) {
+    return ((uintptr_t)ptr - (uintptr_t)a->base) / MW_ARENA_ZONE_SIZE;
+}
+
+int mw_arena_init(mw_arena_t *a, size_t max_size) {
+    memset(a, 0, sizeof(*a));
+    a->page_size = (size_t)sysconf(_SC_PAGESIZE);
+
+    /* Classes up to the one holding max_size */
+    size_t max_pages = (max_size + a->page_size - 1) / a->page_size;
+    int nzones = 1;
+    while (nzones < MW_ARENA_CLASSES && ((size_t)1 << (nzones - 1)) < max_pages) {
+        nzones++;
+    }
+    size_t top_pages = (size_t)1 << (nzones - 1);
+    a->max_size = (max_pages < top_pages ? max_pages : top_pages) * a->page_size;
+
+    /* Address space only: nothing is committed until a slot is used */
+    size_t reserved = (size_t)nzones * MW_ARENA_ZONE_SIZE;
+    void *base = mmap(NULL, reserved, PROT_NONE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) return -1;
+
+    for (int c = 0; c < nzones; c++) {
+        mw_arena_zone_t *zone = &a->zones[c];
+        zone->pages = (size_t)1 << c;
+        zone->stride = (zone->pages + 1) * a->page_size;
+        zone->nslots = (uint32_t)(MW_ARENA_ZONE_SIZE / zone->stride);
+        zone->free_head = NO_SLOT;
+        zone->slots = mmap(NULL, zone->nslots * sizeof(mw_arena_slot_t), PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (zone->slots == MAP_FAILED) {
+            int saved = errno;
+            zone->slots = NULL;
+            a->nzones = c;
+            mw_arena_destroy(a);
+            munmap(base, reserved);
+            errno = saved;
+            return -1;
+        }
+        pthread_mutex_init(&zone->lock, NULL);
+    }
+
+    a->base = base;
+    a->nzones = nzones;
+    a->reserved = reserved;
+    return 0;
+}
+
+void mw_arena_destroy(mw_arena_t *a) {
+    for (int c = 0; c < a->nzones; c++) {
+        mw_arena_zone_t *zone = &a->zones[c];
+        if (zone->slots) {
+            munmap(zone->slots, zone->nslots * sizeof(mw_arena_slot_t));
+            pthread_mutex_destroy(&zone->lock);
+        }
+    }
+    if (a->base) {
+        munmap(a->base, a->reserved);
+    }
+    memset(a, 0, sizeof(*a));
+}
+
+void *mw_arena_alloc(mw_arena_t *a, size_t size) {
+    if (size == 0 || size > a->max_size) return NULL;
+
+    size_t pages = (size + a->page_size - 1) / a->page_size;
+    int c = 0;
+    while (((size_t)1 << c) < pages) c++;
+    mw_arena_zone_t *zone = &a->zones[c];
+    uint8_t *zone_base = a->base + (size_t)c * MW_ARENA_ZONE_SIZE;
+
+    pthread_mutex_lock(&zone->lock);
+    uint32_t index = zone->free_head;
+    if (index != NO_SLOT) {
+        zone->free_head = zone->slots[index].next_free;
+    } else if (zone->next_unused < zone->nslots) {
+        /* First use: commit the slot's pages, its guard page stays PROT_NONE */
+        index = zone->next_unused;
+        if (mprotect(zone_base + (size_t)index * zone->stride,
+                     zone->pages * a->page_size, PROT_READ | PROT_WRITE) != 0) {
+            pthread_mutex_unlock(&zone->lock);
+            return NULL;
+        }
+        zone->next_unused++;
+    } else {
+        pthread_mutex_unlock(&zone->lock);
+        return NULL;
+    }
+    zone->slots[index].size = size;
+    zone->slots[index].tag = -1;
+    pthread_mutex_unlock(&zone->lock);
+
+    return zone_base + (size_t)index * zone->stride;
+}
+
+void mw_arena_free(mw_arena_t *a, void *ptr) {
+    size_t c = zone_of(a, ptr);
+    mw_arena_zone_t *zone = &a->zones[c];
+    uint32_t index = (uint32_t)(((uintptr_t)ptr - (uintptr_t)a->base - c * MW_ARENA_ZONE_SIZE) /
+                                zone->stride);
+
+    pthread_mutex_lock(&zone->lock);
+    zone->slots[index].size = 0;
+    zone->slots[index].tag = -1;
+    zone->slots[index].next_free = zone->free_head;
+    zone->free_head = index;
+    pthread_mutex_unlock(&zone->lock);
+}
+
+mw_arena_slot_t *mw_arena_slot(mw_arena_t *a, const void *ptr) {
+    size_t c = zone_of(a, ptr);
+    mw_arena_zone_t *zone = &a->zones[c];
+    size_t index = ((uintptr_t)ptr - (uintptr_t)a->base - c * MW_ARENA_ZONE_SIZE) / zone->stride;
+    return &zone->slots[index];
+}
+
+size_t mw_arena_capacity(const mw_arena_t *a, const void *ptr) {
+    return a->zones[zone_of(a, ptr)].pages * a->page_size;
+}
@@ -0,0 +1,470 @@
+/*
+ * memwatch_backend.c - userfaultfd write-protect, soft-dirty and hardware
+ * watchpoint helpers
+ *
+ * Thin wrappers over the kernel interfaces; policy (what to protect, when
+ * to scan) lives in the engines.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include <dirent.h>
+
+#ifdef __linux__
+#include <linux/userfaultfd.h>
+#include <linux/perf_event.h>
+#include <linux/hw_breakpoint.h>
+#endif
+
+#include "memwatch_backend.h"
+
+#define PAGEMAP_SOFT_DIRTY (1ULL << 55)
+
+int mw_backend_parse(const char *name, mw_backend_kind_t *out) {
+    if (!name || strcmp(name, "mprotect") == 0) {
+        *out = MW_BACKEND_MPROTECT;
+    } else if (strcmp(name, "uffd") == 0 || strcmp(name, "uffd-wp") == 0) {
+        *out = MW_BACKEND_UFFD_WP;
+    } else if (strcmp(name, "soft-dirty") == 0 || strcmp(name, "soft_dirty") == 0) {
+        *out = MW_BACKEND_SOFT_DIRTY;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+const char *mw_backend_name(mw_backend_kind_t kind) {
+    switch (kind) {
+    case MW_BACKEND_UFFD_WP: return "uffd-wp";
+    case MW_BACKEND_SOFT_DIRTY: return "soft-dirty";
+    default: return "mprotect";
+    }
+}
+
+/* ============================================================================
+ * USERFAULTFD WRITE-PROTECT
+ * ============================================================================ */
+
+#if defined(__linux__) && defined(SYS_userfaultfd) && defined(UFFDIO_WRITEPROTECT)
+
+int mw_uffd_open(mw_uffd_t *u) {
+    u->fd = (int)syscall(SYS_userfaultfd, O_CLOEXEC | O_NONBLOCK);
+#ifdef UFFD_USER_MODE_ONLY
+    if (u->fd < 0 && errno == EPERM) {
+        /* vm.unprivileged_userfaultfd=0: user-mode faults are still allowed */
+        u->fd = (int)syscall(SYS_userfaultfd, O_CLOEXEC | O_NONBLOCK | UFFD_USER_MODE_ONLY);
+    }
+#endif
+    if (u->fd < 0) return -1;
+
+    struct uffdio_api api = {
+        .api = UFFD_API,
+        .features = UFFD_FEATURE_PAGEFAULT_FLAG_WP | UFFD_FEATURE_THREAD_ID,
+    };
+    if (ioctl(u->fd, UFFDIO_API, &api) != 0) {
+        /* Older kernels: retry without thread ids */
+        close(u->fd);
+        u->fd = (int)syscall(SYS_userfaultfd, O_CLOEXEC | O_NONBLOCK);
+        api.api = UFFD_API;
+        api.features = UFFD_FEATURE_PAGEFAULT_FLAG_WP;
+        if (u->fd < 0 || ioctl(u->fd, UFFDIO_API, &api) != 0) {
+            int saved = errno;
+            mw_uffd_close(u);
+            errno = saved;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void mw_uffd_close(mw_uffd_t *u) {
+    if (u->fd >= 0) {
+        close(u->fd);
+    }
+    u->fd = -1;
+}
+
+int mw_uffd_register(mw_uffd_t *u, uintptr_t start, size_t len) {
+    /* Write-protect only applies to present PTEs: read-fault untouched pages in */
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    for (uintptr_t page = start; page < start + len; page += page_size) {
+        (void)*(volatile const uint8_t *)page;
+    }
+
+    struct uffdio_register reg = {
+        .range = { .start = start, .len = len },
+        .mode = UFFDIO_REGISTER_MODE_WP,
+    };
+    return ioctl(u->fd, UFFDIO_REGISTER, &reg) == 0 ? 0 : -1;
+}
+
+int mw_uffd_unregister(mw_uffd_t *u, uintptr_t start, size_t len) {
+    struct uffdio_range range = { .start = start, .len = len };
+    return ioctl(u->fd, UFFDIO_UNREGISTER, &range) == 0 ? 0 : -1;
+}
+
+int mw_uffd_protect(mw_uffd_t *u, uintptr_t start, size_t len, bool protect) {
+    struct uffdio_writeprotect wp = {
+        .range = { .start = start, .len = len },
+        .mode = protect ? UFFDIO_WRITEPROTECT_MODE_WP : 0,
+    };
+    return ioctl(u->fd, UFFDIO_WRITEPROTECT, &wp) == 0 ? 0 : -1;
+}
+
+int mw_uffd_wake(mw_uffd_t *u, uintptr_t start, size_t len) {
+    struct uffdio_range range = { .start = start, .len = len };
+    return ioctl(u->fd, UFFDIO_WAKE, &range) == 0 ? 0 : -1;
+}
+
+int mw_uffd_read(mw_uffd_t *u, mw_uffd_fault_t *out, int max) {
+    struct uffd_msg msgs[64];
+    if (max > 64) max = 64;
+
+    ssize_t n = read(u->fd, msgs, (size_t)max * sizeof(struct uffd_msg));
+    if (n < 0) {
+        return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+    }
+
+    int count = 0;
+    for (ssize_t i = 0; i < n / (ssize_t)sizeof(struct uffd_msg); i++) {
+        if (msgs[i].event != UFFD_EVENT_PAGEFAULT ||
+            !(msgs[i].arg.pagefault.flags & UFFD_PAGEFAULT_FLAG_WP)) {
+            continue;
+        }
+        out[count].address = (uintptr_t)msgs[i].arg.pagefault.address;
+        out[count].thread_id = msgs[i].arg.pagefault.feat.ptid;
+        count++;
+    }
+    return count;
+}
+
+#else  /* no userfaultfd write-protect in this kernel's headers */
+
+int mw_uffd_open(mw_uffd_t *u) {
+    u->fd = -1;
+    errno = ENOTSUP;
+    return -1;
+}
+
+void mw_uffd_close(mw_uffd_t *u) {
+    u->fd = -1;
+}
+
+int mw_uffd_register(mw_uffd_t *u, uintptr_t start, size_t len) {
+    (void)u; (void)start; (void)len;
+    errno = ENOTSUP;
+    return -1;
+}
+
+int mw_uffd_unregister(mw_uffd_t *u, uintptr_t start, size_t len) {
+    (void)u; (void)start; (void)len;
+    errno = ENOTSUP;
+    return -1;
+}
+
+int mw_uffd_protect(mw_uffd_t *u, uintptr_t start, size_t len, bool protect) {
+    (void)u; (void)start; (void)len; (void)protect;
+    errno = ENOTSUP;
+    return -1;
+}
+
+int mw_uffd_wake(mw_uffd_t *u, uintptr_t start, size_t len) {
+    (void)u; (void)start; (void)len;
+    errno = ENOTSUP;
+    return -1;
+}
+
+int mw_uffd_read(mw_uffd_t *u, mw_uffd_fault_t *out, int max) {
+    (void)u; (void)out; (void)max;
+    errno = ENOTSUP;
+    return -1;
+}
+
+#endif
+
+/* ============================================================================
+ * SOFT-DIRTY SCANNER
+ * ============================================================================ */
+
+static int pagemap_entry(mw_soft_dirty_t *sd, uintptr_t addr, uint64_t *entry) {
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    off_t offset = (off_t)(addr / page_size * sizeof(uint64_t));
+    return pread(sd->pagemap_fd, entry, sizeof(*entry), offset) == sizeof(*entry) ? 0 : -1;
+}
+
+/* Dirty a scratch page after a clear: kernels without soft-dirty never set the bit */
+static int soft_dirty_probe(mw_soft_dirty_t *sd) {
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    volatile uint8_t *page = mmap(NULL, page_size, PROT_READ | PROT_WRITE,
+                                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (page == MAP_FAILED) return -1;
+
+    uint64_t entry = 0;
+    page[0] = 1;
+    int ok = mw_soft_dirty_clear(sd) == 0;
+    page[0] = 2;
+    ok = ok && pagemap_entry(sd, (uintptr_t)page, &entry) == 0 && (entry & PAGEMAP_SOFT_DIRTY);
+
+    munmap((void *)page, page_size);
+    if (!ok) {
+        errno = ENOTSUP;
+        return -1;
+    }
+    return 0;
+}
+
+int mw_soft_dirty_open(mw_soft_dirty_t *sd) {
+    memset(sd, 0, sizeof(*sd));
+    sd->pagemap_fd = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+    sd->clear_refs_fd = open("/proc/self/clear_refs", O_WRONLY | O_CLOEXEC);
+
+    if (sd->pagemap_fd < 0 || sd->clear_refs_fd < 0 || soft_dirty_probe(sd) != 0) {
+        int saved = errno;
+        mw_soft_dirty_close(sd);
+        errno = saved;
+        return -1;
+    }
+    return 0;
+}
+
+void mw_soft_dirty_close(mw_soft_dirty_t *sd) {
+    if (sd->pagemap_fd >= 0) close(sd->pagemap_fd);
+    if (sd->clear_refs_fd >= 0) close(sd->clear_refs_fd);
+    free(sd->entries);
+    sd->pagemap_fd = -1;
+    sd->clear_refs_fd = -1;
+    sd->entries = NULL;
+    sd->capacity = 0;
+}
+
+int mw_soft_dirty_clear(mw_soft_dirty_t *sd) {
+    /* "4" clears soft-dirty bits only; accessed bits and LRU are untouched */
+    return pwrite(sd->clear_refs_fd, "4", 1, 0) == 1 ? 0 : -1;
+}
+
+long mw_soft_dirty_scan(mw_soft_dirty_t *sd, uintptr_t start, size_t npages,
+                        mw_soft_dirty_fn fn, void *ctx) {
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+
+    if (npages > sd->capacity) {
+        uint64_t *entries = realloc(sd->entries, npages * sizeof(uint64_t));
+        if (!entries) return -1;
+        sd->entries = entries;
+        sd->capacity = npages;
+    }
+
+    size_t bytes = npages * sizeof(uint64_t);
+    off_t offset = (off_t)(start / page_size * sizeof(uint64_t));
+    if (pread(sd->pagemap_fd, sd->entries, bytes, offset) != (ssize_t)bytes) {
+        return -1;
+    }
+
+    long dirty = 0;
+    for (size_t i = 0; i < npages; i++) {
+        if (sd->entries[i] & PAGEMAP_SOFT_DIRTY) {
+            fn(start + i * page_size, ctx);
+            dirty++;
+        }
+    }
+    return dirty;
+}
+
+/* ============================================================================
+ * HARDWARE WATCHPOINTS
+ * ============================================================================ */
+
+#define HWBP_RING_PAGES 1   /* data pages per thread, after the control page */
+
+int mw_hwbp_span(uintptr_t addr, size_t size, uintptr_t *bp_addr, uint32_t *bp_len) {
+    if (size == 0 || size > MW_HWBP_MAX_LEN) return -1;
+
+    /* Smallest naturally aligned 1/2/4/8 byte window holding the region */
+    for (uint32_t len = 1; len <= MW_HWBP_MAX_LEN; len <<= 1) {
+        uintptr_t start = addr & ~(uintptr_t)(len - 1);
+        if (start + len >= addr + size) {
+            *bp_addr = start;
+            *bp_len = len;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+#if defined(__linux__) && defined(SYS_perf_event_open)
+
+static int hwbp_open_thread(mw_hwbp_t *bp, int slot, pid_t tid) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_BREAKPOINT;
+    attr.size = sizeof(attr);
+    attr.bp_type = HW_BREAKPOINT_W;
+    attr.bp_addr = bp->addr;
+    attr.bp_len = bp->len;
+    attr.sample_period = 1;
+    attr.sample_type = PERF_SAMPLE_IP | PERF_SAMPLE_TID;
+    attr.wakeup_events = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    int fd = (int)syscall(SYS_perf_event_open, &attr, tid, -1, -1, PERF_FLAG_FD_CLOEXEC);
+    if (fd < 0) return -1;
+
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    void *ring = mmap(NULL, (1 + HWBP_RING_PAGES) * page_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd, 0);
+    if (ring == MAP_FAILED) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+
+    bp->fds[slot] = fd;
+    bp->tids[slot] = tid;
+    bp->rings[slot] = ring;
+    if (slot == bp->nfds) {
+        bp->nfds++;
+    }
+    return 0;
+}
+
+static bool hwbp_covers(const mw_hwbp_t *bp, pid_t tid) {
+    for (int i = 0; i < bp->nfds; i++) {
+        if (bp->fds[i] >= 0 && bp->tids[i] == tid) return true;
+    }
+    return false;
+}
+
+int mw_hwbp_refresh(mw_hwbp_t *bp) {
+    DIR *tasks = opendir("/proc/self/task");
+    if (!tasks) return -1;
+
+    int added = 0;
+    struct dirent *entry;
+    while ((entry = readdir(tasks)) != NULL) {
+        pid_t tid = (pid_t)atoi(entry->d_name);
+        if (tid <= 0 || hwbp_covers(bp, tid)) continue;
+
+        /* Reuse a slot freed by an exited thread first */
+        int slot = 0;
+        while (slot < bp->nfds && bp->fds[slot] >= 0) slot++;
+        if (slot == MW_HWBP_MAX_THREADS) {
+            errno = ENOSPC;
+            added = -1;
+            break;
+        }
+        if (hwbp_open_thread(bp, slot, tid) != 0) {
+            if (errno == ESRCH) continue;  /* exited while listing */
+            added = -1;
+            break;
+        }
+        added++;
+    }
+    closedir(tasks);
+    return added;
+}
+
+int mw_hwbp_open(mw_hwbp_t *bp, uintptr_t addr, size_t size) {
+    memset(bp, 0, sizeof(*bp));
+    if (mw_hwbp_span(addr, size, &bp->addr, &bp->len) != 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int added = mw_hwbp_refresh(bp);
+    if (added <= 0) {
+        int saved = added < 0 ? errno : ESRCH;
+        mw_hwbp_close(bp);
+        errno = saved;
+        return -1;
+    }
+    return 0;
+}
+
+void mw_hwbp_drop(mw_hwbp_t *bp, int index) {
+    if (bp->fds[index] < 0) return;
+    munmap(bp->rings[index], (1 + HWBP_RING_PAGES) * (size_t)sysconf(_SC_PAGESIZE));
+    close(bp->fds[index]);
+    bp->fds[index] = -1;   /* poll() skips negative descriptors */
+    bp->rings[index] = NULL;
+}
+
+void mw_hwbp_close(mw_hwbp_t *bp) {
+    for (int i = 0; i < bp->nfds; i++) {
+        mw_hwbp_drop(bp, i);
+    }
+    bp->nfds = 0;
+}
+
+int mw_hwbp_read(mw_hwbp_t *bp, int index, mw_hwbp_hit_t *out, int max) {
+    if (bp->fds[index] < 0) return 0;
+
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    struct perf_event_mmap_page *meta = bp->rings[index];
+    const uint8_t *data = (const uint8_t *)meta + page_size;
+    uint64_t mask = HWBP_RING_PAGES * page_size - 1;
+
+    uint64_t head = __atomic_load_n(&meta->data_head, __ATOMIC_ACQUIRE);
+    uint64_t tail = meta->data_tail;
+    int count = 0;
+
+    /* Records and their u64 fields are 8-byte aligned: no field straddles the wrap */
+    while (tail < head && count < max) {
+        struct perf_event_header header;
+        memcpy(&header, data + (tail & mask), sizeof(header));
+        if (header.size == 0) break;
+
+        if (header.type == PERF_RECORD_SAMPLE) {
+            uint64_t ip, pid_tid;
+            memcpy(&ip, data + ((tail + 8) & mask), sizeof(ip));
+            memcpy(&pid_tid, data + ((tail + 16) & mask), sizeof(pid_tid));
+            out[count].ip = (uintptr_t)ip;
+            out[count].thread_id = (uint32_t)(pid_tid >> 32);
+            count++;
+        }
+        tail += header.size;
+    }
+
+    __atomic_store_n(&meta->data_tail, tail, __ATOMIC_RELEASE);
+    return count;
+}
+
+#else  /* no perf_event_open */
+
+int mw_hwbp_open(mw_hwbp_t *bp, uintptr_t addr, size_t size) {
+    (void)addr; (void)size;
+    memset(bp, 0, sizeof(*bp));
+    errno = ENOTSUP;
+    return -1;
+}
+
+void mw_hwbp_drop(mw_hwbp_t *bp, int index) {
+    bp->fds[index] = -1;
+}
+
+int mw_hwbp_refresh(mw_hwbp_t *bp) {
+    (void)bp;
+    errno = ENOTSUP;
+    return -1;
+}
+
+void mw_hwbp_close(mw_hwbp_t *bp) {
+    bp->nfds = 0;
+}
+
+int mw_hwbp_read(mw_hwbp_t *bp, int index, mw_hwbp_hit_t *out, int max) {
+    (void)bp; (void)index; (void)out; (void)max;
+    return 0;
+}
+
+#endif
@@ -3,7 +3,11 @@
  *
  * Usage:
  *   memwatch run <executable> [args...] --storage <path> [--scope global|local|both] [--threads]
+ *                [--export tcp:host:port|unix:/path [--export-spill <path>]] [--stats <name>]
  *   memwatch read <storage_path> [--filter name] [--format json|csv]
+ *   memwatch state <trace_path> [--region id] [--at ns] [--forward n] [--back n]
+ *   memwatch top [name] [--interval ms] [--once] [--limit n]
+ *   memwatch metrics [name] [--listen [addr:]port]
  *   memwatch monitor [--storage path] [--live]
  *
  * Supports:
@@ -30,8 +34,19 @@
 #include <time.h>
 #include <errno.h>
 #include <stdint.h>
+#include <dlfcn.h>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
 
 #include "memwatch_unified.h"
+#include "memwatch_sqlite_sink.h"
+#include "memwatch_event_ring.h"
+#include "memwatch_trace.h"
+#include "memwatch_export.h"
+#include "memwatch_stats.h"
 
 /* ============================================================================
  * Configuration
@@ -40,8 +55,14 @@
 #define MAX_ARGS 256
 #define MAX_THREADS 64
 #define MAX_VARIABLES 1024
-#define STORAGE_BUFFER_SIZE (1024 * 1024)  /* 1 MB */
+#define STORAGE_BUFFER_SIZE (1024 * 1024)  /* 1 MB per sink queue half */
 #define STORAGE_FLUSH_INTERVAL_MS 100
+#define TRACE_STORE_CAPACITY (64 * 1024 * 1024)
+#define STATE_PREVIEW_BYTES 64
+#define TOP_INTERVAL_MS 1000
+#define TOP_LIMIT 10
+#define METRICS_REGION_LIMIT 20
+#define STATS_PREFIX "memwatch-stats-"
 #define MEMWATCH_LIB_DIR "/workspaces/WaterCodeFlow/memwatch/build"
 
 /* ============================================================================
@@ -51,6 +72,9 @@
 typedef enum {
     CMD_RUN,
     CMD_READ,
+    CMD_STATE,
+    CMD_TOP,
+    CMD_METRICS,
     CMD_MONITOR,
     CMD_HELP,
     CMD_INVALID,
@@ -94,6 +118,20 @@ typedef struct {
     char *read_storage;
     char *user_func_path;
     user_func_lang_t user_func_lang;
+    char *user_lib_path;
+    char *shm_ring_name;
+    char *trace_path;
+    char *export_endpoint;
+    char *export_spill;
+    char *stats_name;
+    char *listen;
+    int interval_ms;
+    bool once;
+    bool has_region;
+    uint32_t region_id;
+    uint64_t at_ns;
+    int steps_forward;
+    int steps_back;
 } cli_args_t;
 
 typedef struct {
@@ -109,12 +147,8 @@ typedef struct {
 } stored_event_t;
 
 typedef struct {
-    sqlite3 *db;
-    FILE *buffer_fp;
-    char *buffer;
-    size_t buffer_pos;
-    pthread_mutex_t lock;
-    bool flushing;
+    mw_sink_t *sink;              /* commits on its own writer thread */
+    int insert_change;
 } storage_t;
 
 /* ============================================================================
@@ -130,6 +164,33 @@ static struct {
 } g_stats = {0};
 static cli_args_t g_cli_args = {0};
 
+/* --user-lib: callback loaded from a shared object */
+static struct {
+    void *handle;
+    memwatch_callback_t callback;
+    void *ctx;
+    void (*fini)(void *ctx);
+} g_plugin = {0};
+
+/* --shm-ring: events for an external consumer process */
+static mw_ring_t g_ring;
+static bool g_ring_open = false;
+
+/* --trace: keyframe + delta history for `memwatch state` */
+static struct {
+    FastStorage *fs;
+    mw_trace_writer_t *writer;
+} g_trace = {0};
+
+/* --export: stream events to memwatch_collector */
+static mw_exporter_t *g_exporter = NULL;
+
+static uint64_t clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
 /* ============================================================================
  * Signal Handlers
  * ============================================================================ */
@@ -155,16 +216,6 @@ static void handle_sigterm(int sig) {
  * ============================================================================ */
 
 static int storage_init(const char *path) {
-    int rc;
-    char *errmsg = NULL;
-    
-    /* Open database */
-    rc = sqlite3_open(path, &g_storage.db);
-    if (rc != SQLITE_OK) {
-        fprintf(stderr, "❌ Cannot open database %s: %s\n", path, sqlite3_errmsg(g_storage.db));
-        return -1;
-    }
-    
     /* Create schema */
     const char *schema = 
         "CREATE TABLE IF NOT EXISTS changes ("
@@ -185,97 +236,169 @@ static int storage_init(const char *path) {
         "CREATE INDEX IF NOT EXISTS idx_var_name ON changes(variable_name);"
         "CREATE INDEX IF NOT EXISTS idx_timestamp ON changes(timestamp_ns);";
     
-    rc = sqlite3_exec(g_storage.db, schema, NULL, NULL, &errmsg);
-    if (rc != SQLITE_OK) {
-        fprintf(stderr, "❌ Schema error: %s\n", errmsg);
-        sqlite3_free(errmsg);
+    mw_sink_config_t config = {
+        .buffer_bytes = STORAGE_BUFFER_SIZE,
+        .flush_interval_ms = STORAGE_FLUSH_INTERVAL_MS,
+    };
+    g_storage.sink = mw_sink_open(path, schema, &config);
+    if (!g_storage.sink) {
         return -1;
     }
     
-    /* Allocate buffer */
-    g_storage.buffer = malloc(STORAGE_BUFFER_SIZE);
-    if (!g_storage.buffer) {
-        fprintf(stderr, "❌ Memory allocation failed\n");
+    g_storage.insert_change = mw_sink_prepare(g_storage.sink,
+        "INSERT INTO changes(timestamp_ns, thread_id, thread_name, variable_name, "
+        "old_preview, new_preview, file, function, line) VALUES(?, ?, 'main', ?, ?, ?, ?, ?, ?)");
+    if (g_storage.insert_change < 0) {
+        mw_sink_close(g_storage.sink);
+        g_storage.sink = NULL;
         return -1;
     }
     
-    g_storage.buffer_pos = 0;
-    pthread_mutex_init(&g_storage.lock, NULL);
-    
     printf("✓ Storage initialized: %s\n", path);
     return 0;
 }
 
 static void storage_record_event(const memwatch_change_event_t *event) {
-    if (!g_storage.db) return;
-    
-    pthread_mutex_lock(&g_storage.lock);
+    if (!g_storage.sink) return;
     
-    /* Format as INSERT statement */
-    int len = snprintf(
-        g_storage.buffer + g_storage.buffer_pos,
-        STORAGE_BUFFER_SIZE - g_storage.buffer_pos,
-        "INSERT INTO changes(timestamp_ns, thread_id, thread_name, variable_name, "
-        "old_preview, new_preview, file, function, line) VALUES(%lu, %u, 'main', "
-        "'%s', '%.*s', '%.*s', '%s', '%s', %u);\n",
-        (unsigned long)event->timestamp_ns,
-        (unsigned)event->adapter_id,
-        event->variable_name ? event->variable_name : "unknown",
-        (int)event->old_preview_size, (char *)event->old_preview,
-        (int)event->new_preview_size, (char *)event->new_preview,
-        event->file ? event->file : "unknown",
-        event->function ? event->function : "unknown",
-        event->line
-    );
+    /* Values are bound, not formatted into SQL: previews may hold quotes */
+    mw_sink_value_t row[] = {
+        MW_SINK_I64(event->timestamp_ns),
+        MW_SINK_I64(event->adapter_id),
+        MW_SINK_STR(event->variable_name ? event->variable_name : "unknown"),
+        MW_SINK_STRN(event->old_preview, event->old_preview_size),
+        MW_SINK_STRN(event->new_preview, event->new_preview_size),
+        MW_SINK_STR(event->file ? event->file : "unknown"),
+        MW_SINK_STR(event->function ? event->function : "unknown"),
+        MW_SINK_I64(event->line),
+    };
     
-    if (len > 0 && g_storage.buffer_pos + len < STORAGE_BUFFER_SIZE) {
-        g_storage.buffer_pos += len;
-        g_stats.num_events++;
+    if (mw_sink_write(g_storage.sink, g_storage.insert_change, row, sizeof(row) / sizeof(row[0])) == 0) {
+        __atomic_fetch_add(&g_stats.num_events, 1, __ATOMIC_RELAXED);
     }
-    
-    pthread_mutex_unlock(&g_storage.lock);
 }
 
+/* Wait until every recorded event is committed */
 static int storage_flush(void) {
-    if (!g_storage.db) return 0;
+    if (!g_storage.sink) return 0;
     
-    pthread_mutex_lock(&g_storage.lock);
-    
-    if (g_storage.buffer_pos == 0) {
-        pthread_mutex_unlock(&g_storage.lock);
-        return 0;
+    if (mw_sink_flush(g_storage.sink) != 0) {
+        fprintf(stderr, "⚠️  Storage flush error: some events were not stored\n");
+        return -1;
     }
+    return 0;
+}
+
+static void storage_close(void) {
+    if (!g_storage.sink) return;
     
-    char *errmsg = NULL;
-    int rc = sqlite3_exec(g_storage.db, g_storage.buffer, NULL, NULL, &errmsg);
+    storage_flush();
     
-    if (rc != SQLITE_OK) {
-        fprintf(stderr, "⚠️  Storage flush error: %s\n", errmsg);
-        sqlite3_free(errmsg);
+    mw_sink_stats_t stats;
+    mw_sink_stats(g_storage.sink, &stats);
+    if (stats.rows_dropped || stats.waits) {
+        printf("Storage: %lu dropped, %lu waits for the writer (%.1f ms)\n",
+               (unsigned long)stats.rows_dropped, (unsigned long)stats.waits,
+               stats.wait_ns / 1e6);
     }
     
-    g_storage.buffer_pos = 0;
-    pthread_mutex_unlock(&g_storage.lock);
-    
-    return rc == SQLITE_OK ? 0 : -1;
+    mw_sink_close(g_storage.sink);
+    g_storage.sink = NULL;
 }
 
-static void storage_close(void) {
-    if (!g_storage.db) return;
+/* ============================================================================
+ * Trace Recording
+ * ============================================================================ */
+
+static int trace_init(const char *path) {
+    g_trace.fs = faststorage_create(path, TRACE_STORE_CAPACITY);
+    if (!g_trace.fs) {
+        return -1;
+    }
+    g_trace.writer = mw_trace_writer_open(g_trace.fs, 0);
+    if (!g_trace.writer) {
+        faststorage_destroy(g_trace.fs);
+        g_trace.fs = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+static void trace_record_event(const memwatch_change_event_t *event) {
+    if (!g_trace.writer) return;
     
-    storage_flush();
+    /* Values under 4 KB come whole; larger ones only as their previews */
+    const uint8_t *old_bytes = event->old_value ? event->old_value : event->old_preview;
+    size_t old_size = event->old_value ? event->old_value_size : event->old_preview_size;
+    const uint8_t *new_bytes = event->new_value ? event->new_value : event->new_preview;
+    size_t new_size = event->new_value ? event->new_value_size : event->new_preview_size;
+    if (!new_bytes) return;
     
-    if (g_storage.db) {
-        sqlite3_close(g_storage.db);
-        g_storage.db = NULL;
+    if (mw_trace_record(g_trace.writer, event->region_id, event->timestamp_ns,
+                        0, new_bytes, new_size) == 0 || errno != ENOENT || !old_bytes) {
+        return;
     }
-    
-    if (g_storage.buffer) {
-        free(g_storage.buffer);
-        g_storage.buffer = NULL;
+    /* First change of this region: its old value is the initial keyframe */
+    if (mw_trace_add_region(g_trace.writer, event->region_id, event->variable_name,
+                            old_bytes, old_size, event->timestamp_ns) == 0) {
+        mw_trace_record(g_trace.writer, event->region_id, event->timestamp_ns,
+                        0, new_bytes, new_size < old_size ? new_size : old_size);
     }
+}
+
+static void trace_close(void) {
+    if (!g_trace.writer) return;
+    
+    mw_trace_stats_t stats;
+    mw_trace_writer_stats(g_trace.writer, &stats);
+    printf("Trace: %lu changes, %lu keyframes (%.1f KB), %.1f KB of deltas\n",
+           (unsigned long)stats.events, (unsigned long)stats.segments + 1,
+           stats.keyframe_bytes / 1024.0, stats.delta_bytes / 1024.0);
+    
+    mw_trace_writer_close(g_trace.writer);
+    faststorage_destroy(g_trace.fs);
+    g_trace.writer = NULL;
+    g_trace.fs = NULL;
+}
+
+/* ============================================================================
+ * Export
+ * ============================================================================ */
+
+static void export_event(const memwatch_change_event_t *event) {
+    if (!g_exporter) return;
+    
+    const char *name = event->variable_name ? event->variable_name : "";
+    mw_export_event_t ev = {
+        .timestamp_ns = event->timestamp_ns,
+        .region_id = event->region_id,
+        .thread_id = event->adapter_id,
+        .name = name,
+        .name_len = (uint32_t)strlen(name),
+        .old_value = event->old_value ? event->old_value : event->old_preview,
+        .old_len = (uint32_t)(event->old_value ? event->old_value_size : event->old_preview_size),
+        .new_value = event->new_value ? event->new_value : event->new_preview,
+        .new_len = (uint32_t)(event->new_value ? event->new_value_size : event->new_preview_size),
+    };
+    mw_export_event(g_exporter, &ev);
+}
+
+static void export_close(void) {
+    if (!g_exporter) return;
+    
+    mw_export_stats_t stats;
+    mw_export_flush(g_exporter, 2000);
+    mw_export_stats(g_exporter, &stats);
+    printf("Export: %lu events in %lu frames (%.1f KB -> %.1f KB), %lu acknowledged",
+           (unsigned long)stats.events, (unsigned long)stats.frames,
+           stats.raw_bytes / 1024.0, stats.stored_bytes / 1024.0,
+           (unsigned long)stats.frames_acked);
+    if (stats.frames_spilled) printf(", %lu spilled", (unsigned long)stats.frames_spilled);
+    if (stats.events_dropped) printf(", %lu events dropped", (unsigned long)stats.events_dropped);
+    printf("\n");
     
-    pthread_mutex_destroy(&g_storage.lock);
+    mw_export_close(g_exporter);
+    g_exporter = NULL;
 }
 
 /* ============================================================================
@@ -295,8 +418,8 @@ static int execute_user_func(const memwatch_change_event_t *event) {
     
     /* Create temp file with event data */
     char temp_event_file[256];
-    snprintf(temp_event_file, sizeof(temp_event_file), "/tmp/memwatch_event_%lu.json",
-             (unsigned long)time(NULL));
+    snprintf(temp_event_file, sizeof(temp_event_file), "/tmp/memwatch_event_%d_%u.json",
+             (int)getpid(), event->seq);
     
     FILE *event_fp = fopen(temp_event_file, "w");
     if (event_fp) {
@@ -317,6 +440,66 @@ static int execute_user_func(const memwatch_change_event_t *event) {
     return 0;
 }
 
+/* ============================================================================
+ * Fast Delivery: In-Process Plugin and Shared-Memory Ring
+ * ============================================================================ */
+
+static int plugin_load(const char *path) {
+    g_plugin.handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!g_plugin.handle) {
+        fprintf(stderr, "❌ Cannot load user library: %s\n", dlerror());
+        return -1;
+    }
+    
+    *(void **)&g_plugin.callback = dlsym(g_plugin.handle, MEMWATCH_PLUGIN_CALLBACK);
+    if (!g_plugin.callback) {
+        fprintf(stderr, "❌ %s does not export %s()\n", path, MEMWATCH_PLUGIN_CALLBACK);
+        dlclose(g_plugin.handle);
+        g_plugin.handle = NULL;
+        return -1;
+    }
+    
+    void *(*init)(void);
+    *(void **)&init = dlsym(g_plugin.handle, MEMWATCH_PLUGIN_INIT);
+    *(void **)&g_plugin.fini = dlsym(g_plugin.handle, MEMWATCH_PLUGIN_FINI);
+    g_plugin.ctx = init ? init() : NULL;
+    return 0;
+}
+
+static void plugin_unload(void) {
+    if (!g_plugin.handle) return;
+    
+    if (g_plugin.fini) {
+        g_plugin.fini(g_plugin.ctx);
+    }
+    dlclose(g_plugin.handle);
+    memset(&g_plugin, 0, sizeof(g_plugin));
+}
+
+/* event_packed_t: first 4 bytes of each value, variable name as metadata */
+static void pack_event(const memwatch_change_event_t *event, event_packed_t *out) {
+    memset(out, 0, sizeof(*out));
+    out->timestamp_sec = (uint32_t)(event->timestamp_ns / 1000000000ULL);
+    out->timestamp_ms = (uint16_t)((event->timestamp_ns / 1000000ULL) % 1000);
+    out->thread_id = event->adapter_id;
+    out->var_id = (uint16_t)event->region_id;
+    out->scope = (uint8_t)g_cli_args.scope;
+    
+    if (event->old_preview) {
+        memcpy(&out->old_value, event->old_preview,
+               event->old_preview_size < 4 ? event->old_preview_size : 4);
+    }
+    if (event->new_preview) {
+        memcpy(&out->new_value, event->new_preview,
+               event->new_preview_size < 4 ? event->new_preview_size : 4);
+    }
+    
+    const char *name = event->variable_name ? event->variable_name : "";
+    size_t len = strnlen(name, sizeof(out->metadata));
+    memcpy(out->metadata, name, len);
+    out->metadata_len = (uint16_t)len;
+}
+
 /* ============================================================================
  * Memory Tracking Callback
  * ============================================================================ */
@@ -324,8 +507,24 @@ static int execute_user_func(const memwatch_change_event_t *event) {
 static void tracking_callback(const memwatch_change_event_t *event, void *user_ctx) {
     (void)user_ctx;
     
-    /* Record to storage */
+    /* Fastest consumers first: in-process plugin, then the shared ring */
+    if (g_plugin.callback) {
+        g_plugin.callback(event, g_plugin.ctx);
+    }
+    if (g_ring_open) {
+        event_packed_t packed;
+        pack_event(event, &packed);
+        mw_ring_publish(&g_ring, &packed);
+    }
+    
+    /* Record to storage; timed as the stats page's storage stage */
+    uint64_t stored_ns = clock_ns(CLOCK_MONOTONIC);
     storage_record_event(event);
+    trace_record_event(event);
+    export_event(event);
+    if (g_storage.sink || g_trace.writer || g_exporter) {
+        memwatch_record_stage(MW_STAGE_STORAGE, clock_ns(CLOCK_MONOTONIC) - stored_ns);
+    }
     
     /* Execute user function if provided */
     if (g_cli_args.user_func_path) {
@@ -375,6 +574,66 @@ static int cmd_run(cli_args_t *args) {
         return 1;
     }
     
+    if (args->trace_path) {
+        if (trace_init(args->trace_path) < 0) {
+            fprintf(stderr, "❌ Cannot open trace %s: %s\n", args->trace_path, strerror(errno));
+            storage_close();
+            return 1;
+        }
+        printf("   Trace: %s\n", args->trace_path);
+    }
+    
+    if (args->user_lib_path) {
+        if (plugin_load(args->user_lib_path) < 0) {
+            trace_close();
+            storage_close();
+            return 1;
+        }
+        printf("   User library: %s\n", args->user_lib_path);
+    }
+    
+    if (args->shm_ring_name) {
+        if (mw_ring_create(&g_ring, args->shm_ring_name, 0) < 0) {
+            fprintf(stderr, "❌ Cannot create event ring %s: %s\n", args->shm_ring_name, strerror(errno));
+            plugin_unload();
+            trace_close();
+            storage_close();
+            return 1;
+        }
+        g_ring_open = true;
+        printf("   Event ring: /dev/shm/memwatch-%s (%lu slots)\n", args->shm_ring_name,
+               (unsigned long)g_ring.hdr->capacity);
+    }
+    
+    if (args->export_endpoint) {
+        mw_export_config_t config = {
+            .endpoint = args->export_endpoint,
+            .spill_path = args->export_spill,
+        };
+        g_exporter = mw_export_open(&config);
+        if (!g_exporter) {
+            fprintf(stderr, "❌ Cannot export to %s: %s\n", args->export_endpoint, strerror(errno));
+            if (g_ring_open) {
+                g_ring_open = false;
+                mw_ring_destroy(&g_ring);
+            }
+            plugin_unload();
+            trace_close();
+            storage_close();
+            return 1;
+        }
+        printf("   Export: %s%s%s\n", args->export_endpoint,
+               args->export_spill ? ", spilling to " : "",
+               args->export_spill ? args->export_spill : "");
+    }
+    
+    /* The engine publishes its stats page under $MEMWATCH_STATS */
+    if (args->stats_name) {
+        setenv("MEMWATCH_STATS", args->stats_name, 1);
+        printf("   Stats: /dev/shm/%s%s (memwatch top %s)\n", STATS_PREFIX,
+               args->stats_name, args->stats_name);
+    }
+    
     /* Initialize memwatch */
     if (memwatch_init() != 0) {
         fprintf(stderr, "❌ Failed to initialize memwatch\n");
@@ -411,6 +670,7 @@ static int cmd_run(cli_args_t *args) {
                  ld_preload ? ":" : "",
                  ld_preload ? ld_preload : "");
         setenv("LD_PRELOAD", preload_buf, 1);
+        unsetenv("MEMWATCH_STATS");  /* the name belongs to this tracer */
         
         /* Pass database path to child via environment */
         if (args->storage_path) {
@@ -457,11 +717,11 @@ static int cmd_run(cli_args_t *args) {
             break;
         }
         
-        /* Flush storage periodically */
-        storage_flush();
-        
-        /* Sleep briefly */
+        /* The storage writer commits on its own; just poll the child */
         usleep(STORAGE_FLUSH_INTERVAL_MS * 1000);
+        if (g_trace.writer) {
+            mw_trace_writer_flush(g_trace.writer);
+        }
     }
     
     /* Final flush */
@@ -476,9 +736,23 @@ static int cmd_run(cli_args_t *args) {
         printf("Data saved to: %s\n", args->storage_path);
         printf("View with: memwatch read %s\n", args->storage_path);
     }
+    if (args->trace_path) {
+        printf("Travel with: memwatch state %s --region <id> --at <ns>\n", args->trace_path);
+    }
     
     /* Cleanup */
     memwatch_shutdown();
+    if (g_ring_open) {
+        if (g_ring.hdr->dropped) {
+            printf("Event ring: %lu events dropped (consumer fell behind)\n",
+                   (unsigned long)g_ring.hdr->dropped);
+        }
+        g_ring_open = false;
+        mw_ring_destroy(&g_ring);
+    }
+    plugin_unload();
+    trace_close();
+    export_close();
     storage_close();
     
     return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
@@ -558,6 +832,463 @@ static int cmd_read(cli_args_t *args) {
     return 0;
 }
 
+/* ============================================================================
+ * Command: STATE
+ * ============================================================================ */
+
+static void print_state(const cli_args_t *args, uint32_t region_id, mw_trace_cursor_t *cursor) {
+    mw_trace_position_t pos;
+    size_t len;
+    const uint8_t *state = mw_trace_cursor_state(cursor, &len);
+    mw_trace_cursor_position(cursor, &pos);
+    size_t shown = len < STATE_PREVIEW_BYTES ? len : STATE_PREVIEW_BYTES;
+    
+    if (args->format == FORMAT_JSON) {
+        printf("{\"region\": %u, \"seq\": %llu, \"timestamp_ns\": %llu, "
+               "\"change_offset\": %u, \"change_len\": %u, \"size\": %zu, \"state\": \"",
+               region_id, (unsigned long long)pos.seq, (unsigned long long)pos.timestamp_ns,
+               pos.change_offset, pos.change_len, len);
+        for (size_t i = 0; i < shown; i++) printf("%02x", state[i]);
+        printf("\"}\n");
+    } else {
+        printf("[%llu] t=%llu ns", (unsigned long long)pos.seq, (unsigned long long)pos.timestamp_ns);
+        if (pos.change_len) {
+            printf(" (bytes %u..%u)", pos.change_offset, pos.change_offset + pos.change_len - 1);
+        }
+        printf(" |");
+        for (size_t i = 0; i < shown; i++) printf(" %02x", state[i]);
+        printf("%s\n", shown < len ? " ..." : "");
+    }
+}
+
+static int cmd_state(cli_args_t *args) {
+    if (access(args->read_storage, R_OK) != 0) {
+        fprintf(stderr, "❌ Cannot open trace %s: %s\n", args->read_storage, strerror(errno));
+        return 1;
+    }
+    
+    /* The smallest capacity: an existing store keeps its own size */
+    FastStorage *fs = faststorage_create(args->read_storage, 1024 * 1024);
+    mw_trace_t *trace = fs ? mw_trace_open(fs) : NULL;
+    if (!trace) {
+        fprintf(stderr, "❌ %s holds no trace\n", args->read_storage);
+        if (fs) faststorage_destroy(fs);
+        return 1;
+    }
+    
+    int result = 0;
+    if (!args->has_region) {
+        int count = mw_trace_regions(trace, NULL, 0);
+        mw_trace_region_t *regions = calloc(count ? count : 1, sizeof(*regions));
+        mw_trace_regions(trace, regions, count);
+        printf("\n=== Traced Regions ===\n\n");
+        for (int i = 0; i < count; i++) {
+            printf("[%u] %s: %llu bytes, %llu changes, t=%llu..%llu ns\n",
+                   regions[i].id, regions[i].name[0] ? regions[i].name : "unnamed",
+                   (unsigned long long)regions[i].size, (unsigned long long)regions[i].events,
+                   (unsigned long long)regions[i].first_ns, (unsigned long long)regions[i].last_ns);
+        }
+        printf("\nTotal regions: %d\n", count);
+        free(regions);
+    } else {
+        mw_trace_cursor_t *cursor = mw_trace_seek(trace, args->region_id, args->at_ns);
+        if (!cursor) {
+            fprintf(stderr, "❌ Region %u: %s\n", args->region_id, strerror(errno));
+            result = 1;
+        } else {
+            print_state(args, args->region_id, cursor);
+            for (int i = 0; i < args->steps_forward && mw_trace_step_forward(cursor) == 1; i++) {
+                print_state(args, args->region_id, cursor);
+            }
+            for (int i = 0; i < args->steps_back && mw_trace_step_back(cursor) == 1; i++) {
+                print_state(args, args->region_id, cursor);
+            }
+            mw_trace_cursor_free(cursor);
+        }
+    }
+    
+    mw_trace_close(trace);
+    faststorage_destroy(fs);
+    return result;
+}
+
+/* ============================================================================
+ * Command: TOP / METRICS
+ * ============================================================================ */
+
+/* Attach to <name>, or to the only stats page in /dev/shm */
+static int stats_attach(const char *name, mw_stats_t *stats) {
+    char found[64] = "";
+    if (!name) {
+        int count = 0;
+        DIR *dir = opendir("/dev/shm");
+        struct dirent *entry;
+        while (dir && (entry = readdir(dir)) != NULL) {
+            if (strncmp(entry->d_name, STATS_PREFIX, strlen(STATS_PREFIX)) != 0) continue;
+            if (count++ == 0) {
+                snprintf(found, sizeof(found), "%s", entry->d_name + strlen(STATS_PREFIX));
+            } else {
+                if (count == 2) fprintf(stderr, "❌ Several stats pages, name one:\n   %s\n", found);
+                fprintf(stderr, "   %s\n", entry->d_name + strlen(STATS_PREFIX));
+            }
+        }
+        if (dir) closedir(dir);
+        if (count == 0) {
+            fprintf(stderr, "❌ No stats page in /dev/shm (run with --stats <name> or $MEMWATCH_STATS)\n");
+            return -1;
+        }
+        if (count > 1) return -1;
+        name = found;
+    }
+    if (mw_stats_attach(stats, name) != 0) {
+        fprintf(stderr, "❌ Stats page %s: %s\n", name,
+                errno == EPROTO ? "not a stats page of this version" : strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/* "live", "closed" (shut down) or "dead" (exited without closing) */
+static const char *stats_state(const mw_stats_header_t *hdr) {
+    if (__atomic_load_n(&hdr->closed, __ATOMIC_ACQUIRE)) return "closed";
+    if (kill((pid_t)hdr->pid, 0) != 0 && errno == ESRCH) return "dead";
+    return "live";
+}
+
+static int compare_region_faults(const void *a, const void *b) {
+    const mw_stats_region_t *x = *(const mw_stats_region_t *const *)a;
+    const mw_stats_region_t *y = *(const mw_stats_region_t *const *)b;
+    return x->faults < y->faults ? 1 : x->faults > y->faults ? -1 : 0;
+}
+
+static int compare_page_faults(const void *a, const void *b) {
+    const mw_stats_page_t *x = *(const mw_stats_page_t *const *)a;
+    const mw_stats_page_t *y = *(const mw_stats_page_t *const *)b;
+    return x->faults < y->faults ? 1 : x->faults > y->faults ? -1 : 0;
+}
+
+/* Regions in use, most faults first; returns how many */
+static size_t stats_top_regions(const mw_stats_t *stats, const mw_stats_region_t **out) {
+    size_t n = 0;
+    for (size_t i = 0; i < MW_STATS_REGIONS; i++) {
+        uint32_t id = __atomic_load_n(&stats->regions[i].region_id, __ATOMIC_ACQUIRE);
+        if (id != 0 && id != UINT32_MAX) out[n++] = &stats->regions[i];
+    }
+    qsort(out, n, sizeof(*out), compare_region_faults);
+    return n;
+}
+
+static size_t stats_top_pages(const mw_stats_t *stats, const mw_stats_page_t **out) {
+    size_t n = 0;
+    for (size_t i = 0; i < MW_STATS_PAGES; i++) {
+        if (__atomic_load_n(&stats->pages[i].page, __ATOMIC_ACQUIRE) != 0) out[n++] = &stats->pages[i];
+    }
+    qsort(out, n, sizeof(*out), compare_page_faults);
+    return n;
+}
+
+/* Governor ladder (memwatch_governor.h), as the stats page records it */
+static const char *stats_level_name(uint32_t level) {
+    static const char *names[] = { "full", "preview", "hash", "window_x4", "window_x16",
+                                   "sampled_100ms", "sampled_1s", "sampled_10s" };
+    return level < sizeof(names) / sizeof(names[0]) ? names[level] : "?";
+}
+
+static double rate(uint64_t now, uint64_t before, double seconds) {
+    return seconds > 0 ? (double)(now - before) / seconds : 0.0;
+}
+
+/* One screen; rates are since prev (or since the tracer started) */
+static void print_top(const cli_args_t *args, const mw_stats_t *stats, const mw_stats_counters_t *prev,
+                      const uint64_t *prev_stage_counts, double seconds) {
+    static const mw_stats_region_t *regions[MW_STATS_REGIONS];
+    static const mw_stats_page_t *pages[MW_STATS_PAGES];
+    const mw_stats_header_t *hdr = stats->hdr;
+    const mw_stats_counters_t *c = &hdr->counters;
+    uint64_t now_unix = clock_ns(CLOCK_REALTIME);
+    
+    printf("memwatch top - pid %u (%s, %s) %s, up %.1f s\n", hdr->pid, hdr->engine, hdr->backend,
+           stats_state(hdr), now_unix > hdr->started_unix_ns ? (now_unix - hdr->started_unix_ns) / 1e9 : 0.0);
+    printf("  faults %10llu %10.1f/s   false %llu (%.1f%%)   changes %llu %.1f/s\n",
+           (unsigned long long)c->faults, rate(c->faults, prev->faults, seconds),
+           (unsigned long long)c->false_faults,
+           c->false_faults + c->changes ? 100.0 * c->false_faults / (c->false_faults + c->changes) : 0.0,
+           (unsigned long long)c->changes, rate(c->changes, prev->changes, seconds));
+    printf("  diffed %.1f KB/s   regions %llu   pages %llu   ring %llu/%llu   dropped %llu   "
+           "coalesced %llu\n", rate(c->bytes_diffed, prev->bytes_diffed, seconds) / 1024.0,
+           (unsigned long long)c->tracked_regions, (unsigned long long)c->tracked_pages,
+           (unsigned long long)c->ring_used, (unsigned long long)c->ring_capacity,
+           (unsigned long long)c->dropped_events, (unsigned long long)c->coalesced_faults);
+    printf("  memory %.1f MB   worker wakeups %.1f/s\n", c->native_memory_bytes / (1024.0 * 1024.0),
+           rate(c->worker_wakeups, prev->worker_wakeups, seconds));
+    if (c->governor_budget_ppm) {
+        printf("  governor: overhead %.1f%% of %.1f%% budget   demoted %llu   demotions %llu   "
+               "promotions %llu\n", c->governor_overhead_ppm / 1e4, c->governor_budget_ppm / 1e4,
+               (unsigned long long)c->governor_demoted, (unsigned long long)c->governor_demotions,
+               (unsigned long long)c->governor_promotions);
+    }
+    
+    printf("\n  %-11s %10s %10s %9s %9s %9s %9s %9s\n", "STAGE", "COUNT", "RATE/s",
+           "MEAN us", "P50 us", "P90 us", "P99 us", "MAX us");
+    mw_stats_hist_t hist;
+    for (int stage = 0; stage < MW_STAGE_COUNT; stage++) {
+        mw_stats_hist(stats, (mw_stage_t)stage, &hist);
+        printf("  %-11s %10llu %10.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+               mw_stats_stage_name((mw_stage_t)stage), (unsigned long long)hist.count,
+               rate(hist.count, prev_stage_counts[stage], seconds),
+               hist.count ? hist.sum_ns / 1e3 / hist.count : 0.0,
+               mw_stats_hist_percentile(&hist, 50) / 1e3, mw_stats_hist_percentile(&hist, 90) / 1e3,
+               mw_stats_hist_percentile(&hist, 99) / 1e3, hist.max_ns / 1e3);
+    }
+    
+    size_t n = stats_top_regions(stats, regions);
+    printf("\n  %-6s %-24s %-18s %10s %10s %7s %10s %-13s\n", "REGION", "NAME", "ADDR", "SIZE",
+           "FAULTS", "FALSE%", "CHANGES", "LEVEL");
+    for (size_t i = 0; i < n && (int)i < args->limit; i++) {
+        const mw_stats_region_t *r = regions[i];
+        printf("  %-6u %-24.24s 0x%-16llx %10llu %10llu %6.1f%% %10llu %-13s\n", r->region_id,
+               r->name[0] ? r->name : "-", (unsigned long long)r->addr, (unsigned long long)r->size,
+               (unsigned long long)r->faults, r->faults ? 100.0 * r->false_faults / r->faults : 0.0,
+               (unsigned long long)r->changes, stats_level_name(r->level));
+    }
+    
+    n = stats_top_pages(stats, pages);
+    printf("\n  %-18s %10s %10s\n", "PAGE", "FAULTS", "CHANGES");
+    for (size_t i = 0; i < n && (int)i < args->limit; i++) {
+        printf("  0x%-16llx %10llu %10llu\n", (unsigned long long)pages[i]->page,
+               (unsigned long long)pages[i]->faults, (unsigned long long)pages[i]->changes);
+    }
+    if (hdr->region_overflow || hdr->page_overflow) {
+        printf("\n  (%llu regions and %llu pages found no slot)\n",
+               (unsigned long long)hdr->region_overflow, (unsigned long long)hdr->page_overflow);
+    }
+    fflush(stdout);
+}
+
+static int cmd_top(cli_args_t *args) {
+    mw_stats_t stats;
+    if (stats_attach(args->stats_name, &stats) != 0) {
+        return 1;
+    }
+    signal(SIGINT, handle_sigint);
+    signal(SIGTERM, handle_sigterm);
+    
+    /* First screen: averages since the tracer started */
+    mw_stats_counters_t prev = {0};
+    uint64_t prev_stage_counts[MW_STAGE_COUNT] = {0};
+    uint64_t now_unix = clock_ns(CLOCK_REALTIME);
+    double seconds = now_unix > stats.hdr->started_unix_ns ? (now_unix - stats.hdr->started_unix_ns) / 1e9 : 0.0;
+    uint64_t sampled_ns = clock_ns(CLOCK_MONOTONIC);
+    
+    for (;;) {
+        if (!args->once) printf("\033[H\033[2J");
+        mw_stats_counters_t now = stats.hdr->counters;
+        print_top(args, &stats, &prev, prev_stage_counts, seconds);
+        
+        /* A tracer that is gone stops changing; show it once and stop */
+        if (args->once || !g_running || strcmp(stats_state(stats.hdr), "live") != 0) break;
+        
+        prev = now;
+        mw_stats_hist_t hist;
+        for (int stage = 0; stage < MW_STAGE_COUNT; stage++) {
+            mw_stats_hist(&stats, (mw_stage_t)stage, &hist);
+            prev_stage_counts[stage] = hist.count;
+        }
+        usleep((useconds_t)args->interval_ms * 1000);
+        if (!g_running) break;
+        uint64_t t = clock_ns(CLOCK_MONOTONIC);
+        seconds = (t - sampled_ns) / 1e9;
+        sampled_ns = t;
+    }
+    
+    mw_stats_detach(&stats);
+    return 0;
+}
+
+/* Prometheus label value: backslash, quote and newline escaped */
+static void print_label(FILE *out, const char *value) {
+    for (; *value; value++) {
+        if (*value == '\\' || *value == '"') fputc('\\', out);
+        if (*value == '\n') {
+            fputs("\\n", out);
+        } else {
+            fputc(*value, out);
+        }
+    }
+}
+
+/* Prometheus text exposition format 0.0.4 */
+static void print_metrics(FILE *out, const cli_args_t *args, const mw_stats_t *stats) {
+    static const mw_stats_region_t *regions[MW_STATS_REGIONS];
+    static const struct {
+        const char *name;
+        const char *type;
+        const char *help;
+        size_t offset;
+    } counters[] = {
+        { "faults_total", "counter", "Write faults taken", offsetof(mw_stats_counters_t, faults) },
+        { "false_faults_total", "counter", "Region checks that found no change",
+          offsetof(mw_stats_counters_t, false_faults) },
+        { "changes_total", "counter", "Region changes found", offsetof(mw_stats_counters_t, changes) },
+        { "bytes_diffed_total", "counter", "Bytes hashed or compared",
+          offsetof(mw_stats_counters_t, bytes_diffed) },
+        { "tracked_regions", "gauge", "Regions watched", offsetof(mw_stats_counters_t, tracked_regions) },
+        { "tracked_pages", "gauge", "Pages watched", offsetof(mw_stats_counters_t, tracked_pages) },
+        { "ring_used", "gauge", "Fault ring slots in use", offsetof(mw_stats_counters_t, ring_used) },
+        { "ring_capacity", "gauge", "Fault ring slots", offsetof(mw_stats_counters_t, ring_capacity) },
+        { "dropped_events_total", "counter", "Faults dropped on a full ring",
+          offsetof(mw_stats_counters_t, dropped_events) },
+        { "coalesced_faults_total", "counter", "Faults merged into a pending one",
+          offsetof(mw_stats_counters_t, coalesced_faults) },
+        { "native_memory_bytes", "gauge", "Memory held by the engine",
+          offsetof(mw_stats_counters_t, native_memory_bytes) },
+        { "worker_wakeups_total", "counter", "Worker thread wakeups",
+          offsetof(mw_stats_counters_t, worker_wakeups) },
+        { "governor_budget_ppm", "gauge", "Overhead budget of the mode, ppm of one CPU (0 = off)",
+          offsetof(mw_stats_counters_t, governor_budget_ppm) },
+        { "governor_overhead_ppm", "gauge", "Tracing cost over the last governor interval, ppm of one CPU",
+          offsetof(mw_stats_counters_t, governor_overhead_ppm) },
+        { "governor_demoted_regions", "gauge", "Regions the governor holds below full tracing",
+          offsetof(mw_stats_counters_t, governor_demoted) },
+        { "governor_demotions_total", "counter", "Regions demoted for going over budget",
+          offsetof(mw_stats_counters_t, governor_demotions) },
+        { "governor_promotions_total", "counter", "Regions promoted after cooling down",
+          offsetof(mw_stats_counters_t, governor_promotions) },
+    };
+    const mw_stats_header_t *hdr = stats->hdr;
+    
+    fprintf(out, "# HELP memwatch_up 1 while the tracer is running\n# TYPE memwatch_up gauge\n");
+    fprintf(out, "memwatch_up{pid=\"%u\",engine=\"", hdr->pid);
+    print_label(out, hdr->engine);
+    fprintf(out, "\",backend=\"");
+    print_label(out, hdr->backend);
+    fprintf(out, "\"} %d\n", strcmp(stats_state(hdr), "live") == 0);
+    
+    for (size_t i = 0; i < sizeof(counters) / sizeof(counters[0]); i++) {
+        uint64_t value = *(const uint64_t *)((const char *)&hdr->counters + counters[i].offset);
+        fprintf(out, "# HELP memwatch_%s %s\n# TYPE memwatch_%s %s\nmemwatch_%s %llu\n",
+                counters[i].name, counters[i].help, counters[i].name, counters[i].type,
+                counters[i].name, (unsigned long long)value);
+    }
+    
+    fprintf(out, "# HELP memwatch_stage_seconds Time spent per pipeline stage\n"
+                 "# TYPE memwatch_stage_seconds summary\n");
+    static const double quantiles[] = { 0.5, 0.9, 0.99 };
+    mw_stats_hist_t hist;
+    for (int stage = 0; stage < MW_STAGE_COUNT; stage++) {
+        const char *name = mw_stats_stage_name((mw_stage_t)stage);
+        mw_stats_hist(stats, (mw_stage_t)stage, &hist);
+        for (size_t q = 0; q < sizeof(quantiles) / sizeof(quantiles[0]); q++) {
+            fprintf(out, "memwatch_stage_seconds{stage=\"%s\",quantile=\"%g\"} %.9f\n", name, quantiles[q],
+                    mw_stats_hist_percentile(&hist, quantiles[q] * 100) / 1e9);
+        }
+        fprintf(out, "memwatch_stage_seconds_sum{stage=\"%s\"} %.9f\n", name, hist.sum_ns / 1e9);
+        fprintf(out, "memwatch_stage_seconds_count{stage=\"%s\"} %llu\n", name,
+                (unsigned long long)hist.count);
+    }
+    
+    /* Only the hottest regions: one series each */
+    size_t n = stats_top_regions(stats, regions);
+    static const char *region_metrics[] = { "faults", "false_faults", "changes" };
+    for (size_t m = 0; m < 3; m++) {
+        fprintf(out, "# HELP memwatch_region_%s_total Per region, the %d with most faults\n"
+                     "# TYPE memwatch_region_%s_total counter\n",
+                region_metrics[m], args->limit, region_metrics[m]);
+        for (size_t i = 0; i < n && (int)i < args->limit; i++) {
+            const mw_stats_region_t *r = regions[i];
+            uint64_t value = m == 0 ? r->faults : m == 1 ? r->false_faults : r->changes;
+            fprintf(out, "memwatch_region_%s_total{region=\"%u\",name=\"", region_metrics[m], r->region_id);
+            print_label(out, r->name);
+            fprintf(out, "\"} %llu\n", (unsigned long long)value);
+        }
+    }
+}
+
+/* --listen: a one-request-at-a-time HTTP server for GET /metrics */
+static int serve_metrics(const cli_args_t *args, const mw_stats_t *stats) {
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    const char *port = args->listen;
+    const char *colon = strrchr(args->listen, ':');
+    if (colon) {
+        char host[64];
+        snprintf(host, sizeof(host), "%.*s", (int)(colon - args->listen), args->listen);
+        if (inet_pton(AF_INET, host, &addr.sin_addr) != 1) {
+            fprintf(stderr, "❌ Bad listen address: %s\n", host);
+            return 1;
+        }
+        port = colon + 1;
+    }
+    addr.sin_port = htons((uint16_t)atoi(port));
+    
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int one = 1;
+    socklen_t len = sizeof(addr);
+    if (fd < 0 || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+        bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0 ||
+        getsockname(fd, (struct sockaddr *)&addr, &len) != 0) {
+        fprintf(stderr, "❌ Cannot listen on %s: %s\n", args->listen, strerror(errno));
+        if (fd >= 0) close(fd);
+        return 1;
+    }
+    char host[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &addr.sin_addr, host, sizeof(host));
+    printf("Serving http://%s:%u/metrics\n", host, ntohs(addr.sin_port));
+    fflush(stdout);
+    
+    signal(SIGINT, handle_sigint);
+    signal(SIGTERM, handle_sigterm);
+    struct pollfd pfd = { .fd = fd, .events = POLLIN, .revents = 0 };
+    while (g_running) {
+        if (poll(&pfd, 1, 500) <= 0) continue;
+        int client = accept(fd, NULL, NULL);
+        if (client < 0) continue;
+        
+        struct timeval timeout = { .tv_sec = 1, .tv_usec = 0 };
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        char request[1024];
+        ssize_t got = recv(client, request, sizeof(request) - 1, 0);
+        request[got > 0 ? got : 0] = '\0';
+        
+        char *body = NULL;
+        size_t body_len = 0;
+        const char *status = "404 Not Found";
+        FILE *out = open_memstream(&body, &body_len);
+        if (out && (strncmp(request, "GET /metrics ", 13) == 0 || strncmp(request, "GET / ", 6) == 0)) {
+            status = "200 OK";
+            print_metrics(out, args, stats);
+        } else if (out) {
+            fprintf(out, "GET /metrics\n");
+        }
+        if (out) fclose(out);
+        
+        char head[256];
+        int head_len = snprintf(head, sizeof(head),
+                                "HTTP/1.0 %s\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                                "Content-Length: %zu\r\nConnection: close\r\n\r\n", status, body_len);
+        send(client, head, (size_t)head_len, MSG_NOSIGNAL);
+        if (body) send(client, body, body_len, MSG_NOSIGNAL);
+        free(body);
+        close(client);
+    }
+    close(fd);
+    return 0;
+}
+
+static int cmd_metrics(cli_args_t *args) {
+    mw_stats_t stats;
+    if (stats_attach(args->stats_name, &stats) != 0) {
+        return 1;
+    }
+    int result = 0;
+    if (args->listen) {
+        result = serve_metrics(args, &stats);
+    } else {
+        print_metrics(stdout, args, &stats);
+    }
+    mw_stats_detach(&stats);
+    return result;
+}
+
 /* ============================================================================
  * Argument Parsing
  * ============================================================================ */
@@ -576,12 +1307,23 @@ static void print_help(void) {
     printf("           [--scope global|local|both]\n");
     printf("           [--threads]\n");
     printf("           [--user-func <path> --user-func-lang <lang>]\n");
+    printf("           [--user-lib <lib.so>] [--shm-ring <name>]\n");
+    printf("           [--trace <trace_path>]\n");
+    printf("           [--export tcp:host:port|unix:/path [--export-spill <path>]]\n");
+    printf("           [--stats <name>]\n");
     printf("\n");
     printf("  memwatch read <storage_path>\n");
     printf("           [--filter <name>]\n");
     printf("           [--format json|csv|human]\n");
     printf("           [--limit <n>]\n");
     printf("\n");
+    printf("  memwatch state <trace_path>\n");
+    printf("           [--region <id> [--at <ns>] [--forward <n>] [--back <n>]]\n");
+    printf("           [--format json|human]\n");
+    printf("\n");
+    printf("  memwatch top [<name>] [--interval <ms>] [--once] [--limit <n>]\n");
+    printf("  memwatch metrics [<name>] [--listen [<addr>:]<port>]\n");
+    printf("\n");
     printf("  memwatch monitor [--storage <path>]\n");
     printf("\n");
     printf("CALLBACK FUNCTION:\n");
@@ -590,6 +1332,21 @@ static void print_help(void) {
     printf("  Function must be named 'main' in the source file.\n");
     printf("  Supported languages: python, c, javascript, java, go, rust, csharp\n");
     printf("\n");
+    printf("  Use --user-lib to call %s() from a shared object in process\n", MEMWATCH_PLUGIN_CALLBACK);
+    printf("  (optional %s() / %s()); see memwatch_unified.h.\n",
+           MEMWATCH_PLUGIN_INIT, MEMWATCH_PLUGIN_FINI);
+    printf("  Use --shm-ring to publish 64-byte packed events to /dev/shm/memwatch-<name>\n");
+    printf("  for another process (bindings/memwatch_ring.py); an eventfd wakes it.\n");
+    printf("  Use --export to stream batched, compressed events to memwatch_collector;\n");
+    printf("  --export-spill keeps what the collector cannot take yet on disk.\n");
+    printf("\n");
+    printf("LIVE STATS:\n");
+    printf("\n");
+    printf("  --stats <name> (or $MEMWATCH_STATS in any embedder) publishes stage\n");
+    printf("  latencies and hot regions/pages to /dev/shm/%s<name>.\n", STATS_PREFIX);
+    printf("  `top` shows them live; `metrics` prints them for Prometheus, or serves\n");
+    printf("  GET /metrics with --listen. Without a name, the only page is used.\n");
+    printf("\n");
     printf("EXAMPLES:\n");
     printf("\n");
     printf("  # Track Python script\n");
@@ -609,6 +1366,14 @@ static void print_help(void) {
     printf("  # View recorded data\n");
     printf("  memwatch read tracking.db --format json\n");
     printf("\n");
+    printf("  # Region 3 as it was at a point in time, then the next 5 changes\n");
+    printf("  memwatch run ./program --trace run.trace\n");
+    printf("  memwatch state run.trace --region 3 --at 1700000000000000000 --forward 5\n");
+    printf("\n");
+    printf("  # Watch the tracer's own overhead from another terminal\n");
+    printf("  memwatch run ./program --stats app\n");
+    printf("  memwatch top app\n");
+    printf("\n");
 }
 
 static int parse_args(int argc, char *argv[], cli_args_t *args) {
@@ -642,6 +1407,18 @@ static int parse_args(int argc, char *argv[], cli_args_t *args) {
                 args->track_threads = true;
             } else if (strcmp(argv[i], "--user-func") == 0) {
                 if (++i < argc) args->user_func_path = argv[i];
+            } else if (strcmp(argv[i], "--user-lib") == 0) {
+                if (++i < argc) args->user_lib_path = argv[i];
+            } else if (strcmp(argv[i], "--shm-ring") == 0) {
+                if (++i < argc) args->shm_ring_name = argv[i];
+            } else if (strcmp(argv[i], "--trace") == 0) {
+                if (++i < argc) args->trace_path = argv[i];
+            } else if (strcmp(argv[i], "--export") == 0) {
+                if (++i < argc) args->export_endpoint = argv[i];
+            } else if (strcmp(argv[i], "--export-spill") == 0) {
+                if (++i < argc) args->export_spill = argv[i];
+            } else if (strcmp(argv[i], "--stats") == 0) {
+                if (++i < argc) args->stats_name = argv[i];
             } else if (strcmp(argv[i], "--user-func-lang") == 0) {
                 if (++i < argc) {
                     char *lang = argv[i];
@@ -683,6 +1460,54 @@ static int parse_args(int argc, char *argv[], cli_args_t *args) {
             }
         }
         
+    } else if (strcmp(argv[1], "state") == 0) {
+        args->cmd = CMD_STATE;
+        args->at_ns = UINT64_MAX;
+        
+        if (argc < 3) {
+            fprintf(stderr, "❌ Trace path required\n");
+            return -1;
+        }
+        args->read_storage = argv[2];
+        
+        for (int i = 3; i < argc; i++) {
+            if (strcmp(argv[i], "--region") == 0 && i + 1 < argc) {
+                args->has_region = true;
+                args->region_id = (uint32_t)strtoul(argv[++i], NULL, 0);
+            } else if (strcmp(argv[i], "--at") == 0 && i + 1 < argc) {
+                args->at_ns = strtoull(argv[++i], NULL, 0);
+            } else if (strcmp(argv[i], "--forward") == 0 && i + 1 < argc) {
+                args->steps_forward = atoi(argv[++i]);
+            } else if (strcmp(argv[i], "--back") == 0 && i + 1 < argc) {
+                args->steps_back = atoi(argv[++i]);
+            } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+                if (strcmp(argv[++i], "json") == 0) args->format = FORMAT_JSON;
+            }
+        }
+        
+    } else if (strcmp(argv[1], "top") == 0 || strcmp(argv[1], "metrics") == 0) {
+        args->cmd = strcmp(argv[1], "top") == 0 ? CMD_TOP : CMD_METRICS;
+        args->interval_ms = TOP_INTERVAL_MS;
+        args->limit = args->cmd == CMD_TOP ? TOP_LIMIT : METRICS_REGION_LIMIT;
+        
+        for (int i = 2; i < argc; i++) {
+            if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+                args->interval_ms = atoi(argv[++i]);
+                if (args->interval_ms < 10) args->interval_ms = 10;
+            } else if (strcmp(argv[i], "--once") == 0) {
+                args->once = true;
+            } else if (strcmp(argv[i], "--limit") == 0 && i + 1 < argc) {
+                args->limit = atoi(argv[++i]);
+            } else if (strcmp(argv[i], "--listen") == 0 && i + 1 < argc) {
+                args->listen = argv[++i];
+            } else if (argv[i][0] != '-' && !args->stats_name) {
+                args->stats_name = argv[i];
+            } else {
+                fprintf(stderr, "❌ Unknown option for %s: %s\n", argv[1], argv[i]);
+                return -1;
+            }
+        }
+        
     } else if (strcmp(argv[1], "monitor") == 0) {
         args->cmd = CMD_MONITOR;
         args->live_mode = true;
@@ -715,6 +1540,15 @@ int main(int argc, char *argv[]) {
         case CMD_READ:
             result = cmd_read(&args);
             break;
+        case CMD_STATE:
+            result = cmd_state(&args);
+            break;
+        case CMD_TOP:
+            result = cmd_top(&args);
+            break;
+        case CMD_METRICS:
+            result = cmd_metrics(&args);
+            break;
         case CMD_MONITOR:
             printf("⏳ Monitor mode not yet implemented\n");
             result = 1;
@@ -37,6 +37,7 @@
 #include <dlfcn.h>
 
 #include "memwatch_unified.h"
+#include "memwatch_sqlite_sink.h"
 
 /* ============================================================================
  * Configuration
@@ -129,7 +130,9 @@ typedef struct {
     int var_count;
     sql_event_t sql_events[MAX_VARIABLES];
     int sql_count;
-    sqlite3 *db;
+    mw_sink_t *sink;              /* batched writes on its own thread */
+    int insert_memory;
+    int insert_sql;
     bool initialized;
 } storage_t;
 
@@ -150,13 +153,8 @@ static bool g_track_threads = false;
 static int init_storage(const char *path) {
     pthread_mutex_init(&g_storage.lock, NULL);
     
-    if (sqlite3_open(path, &g_storage.db) != SQLITE_OK) {
-        fprintf(stderr, "❌ Failed to open storage: %s\n", sqlite3_errmsg(g_storage.db));
-        return -1;
-    }
-    
-    // Create memory tracking table
-    const char *sql_mem = 
+    // Memory and SQL tracking tables
+    const char *schema = 
         "CREATE TABLE IF NOT EXISTS memory_changes ("
         "  id INTEGER PRIMARY KEY AUTOINCREMENT,"
         "  timestamp_ns INTEGER,"
@@ -168,17 +166,7 @@ static int init_storage(const char *path) {
         "  old_value BLOB,"
         "  new_value BLOB,"
         "  metadata TEXT"
-        ")";
-    
-    char *err = NULL;
-    if (sqlite3_exec(g_storage.db, sql_mem, NULL, NULL, &err) != SQLITE_OK) {
-        fprintf(stderr, "❌ Failed to create table: %s\n", err);
-        sqlite3_free(err);
-        return -1;
-    }
-    
-    // Create SQL tracking table
-    const char *sql_track = 
+        ");"
         "CREATE TABLE IF NOT EXISTS sql_changes ("
         "  id INTEGER PRIMARY KEY AUTOINCREMENT,"
         "  timestamp_ns INTEGER,"
@@ -191,9 +179,24 @@ static int init_storage(const char *path) {
         "  auto_detected INTEGER"
         ")";
     
-    if (sqlite3_exec(g_storage.db, sql_track, NULL, NULL, &err) != SQLITE_OK) {
-        fprintf(stderr, "❌ Failed to create SQL table: %s\n", err);
-        sqlite3_free(err);
+    g_storage.sink = mw_sink_open(path, schema, NULL);
+    if (!g_storage.sink) {
+        fprintf(stderr, "❌ Failed to open storage: %s\n", path);
+        return -1;
+    }
+    
+    g_storage.insert_memory = mw_sink_prepare(g_storage.sink,
+        "INSERT INTO memory_changes "
+        "(timestamp_ns, thread_id, variable_name, address, size, scope, old_value, new_value) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
+    g_storage.insert_sql = mw_sink_prepare(g_storage.sink,
+        "INSERT INTO sql_changes "
+        "(timestamp_ns, thread_id, operation, database, table_name, columns, rows_affected, auto_detected) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
+    if (g_storage.insert_memory < 0 || g_storage.insert_sql < 0) {
+        fprintf(stderr, "❌ Failed to prepare storage statements\n");
+        mw_sink_close(g_storage.sink);
+        g_storage.sink = NULL;
         return -1;
     }
     
@@ -204,67 +207,43 @@ static int init_storage(const char *path) {
 static void record_memory_change(const char *var_name, uint64_t address, uint64_t size,
                                  const char *old_val, const char *new_val,
                                  uint32_t thread_id, scope_t scope) {
-    if (!g_storage.db) return;
-    
-    pthread_mutex_lock(&g_storage.lock);
+    if (!g_storage.sink) return;
     
     uint64_t now_ns = (uint64_t)time(NULL) * 1000000000ULL;
     const char *scope_str = (scope == SCOPE_GLOBAL) ? "global" : 
                            (scope == SCOPE_LOCAL) ? "local" : "both";
     
-    sqlite3_stmt *stmt;
-    const char *sql = 
-        "INSERT INTO memory_changes "
-        "(timestamp_ns, thread_id, variable_name, address, size, scope, old_value, new_value) "
-        "VALUES (?, ?, ?, ?, ?, ?, ?, ?)";
-    
-    if (sqlite3_prepare_v2(g_storage.db, sql, -1, &stmt, NULL) == SQLITE_OK) {
-        sqlite3_bind_int64(stmt, 1, now_ns);
-        sqlite3_bind_int(stmt, 2, thread_id);
-        sqlite3_bind_text(stmt, 3, var_name, -1, SQLITE_STATIC);
-        sqlite3_bind_int64(stmt, 4, address);
-        sqlite3_bind_int64(stmt, 5, size);
-        sqlite3_bind_text(stmt, 6, scope_str, -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 7, old_val, -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 8, new_val, -1, SQLITE_STATIC);
-        
-        sqlite3_step(stmt);
-        sqlite3_finalize(stmt);
-    }
-    
-    pthread_mutex_unlock(&g_storage.lock);
+    mw_sink_value_t row[] = {
+        MW_SINK_I64(now_ns),
+        MW_SINK_I64(thread_id),
+        MW_SINK_STR(var_name),
+        MW_SINK_I64(address),
+        MW_SINK_I64(size),
+        MW_SINK_STR(scope_str),
+        MW_SINK_STR(old_val),
+        MW_SINK_STR(new_val),
+    };
+    mw_sink_write(g_storage.sink, g_storage.insert_memory, row, sizeof(row) / sizeof(row[0]));
 }
 
 static void record_sql_change(const char *operation, const char *table,
                               const char *columns, int rows_affected,
                               const char *database, uint32_t thread_id) {
-    if (!g_storage.db || !g_track_sql) return;
-    
-    pthread_mutex_lock(&g_storage.lock);
+    if (!g_storage.sink || !g_track_sql) return;
     
     uint64_t now_ns = (uint64_t)time(NULL) * 1000000000ULL;
     
-    sqlite3_stmt *stmt;
-    const char *sql = 
-        "INSERT INTO sql_changes "
-        "(timestamp_ns, thread_id, operation, database, table_name, columns, rows_affected, auto_detected) "
-        "VALUES (?, ?, ?, ?, ?, ?, ?, ?)";
-    
-    if (sqlite3_prepare_v2(g_storage.db, sql, -1, &stmt, NULL) == SQLITE_OK) {
-        sqlite3_bind_int64(stmt, 1, now_ns);
-        sqlite3_bind_int(stmt, 2, thread_id);
-        sqlite3_bind_text(stmt, 3, operation, -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 4, database, -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 5, table, -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 6, columns, -1, SQLITE_STATIC);
-        sqlite3_bind_int(stmt, 7, rows_affected);
-        sqlite3_bind_int(stmt, 8, 1);  // auto_detected=true
-        
-        sqlite3_step(stmt);
-        sqlite3_finalize(stmt);
-    }
-    
-    pthread_mutex_unlock(&g_storage.lock);
+    mw_sink_value_t row[] = {
+        MW_SINK_I64(now_ns),
+        MW_SINK_I64(thread_id),
+        MW_SINK_STR(operation),
+        MW_SINK_STR(database),
+        MW_SINK_STR(table),
+        MW_SINK_STR(columns),
+        MW_SINK_I64(rows_affected),
+        MW_SINK_I64(1),  // auto_detected=true
+    };
+    mw_sink_write(g_storage.sink, g_storage.insert_sql, row, sizeof(row) / sizeof(row[0]));
 }
 
 /* ============================================================================
@@ -566,8 +545,9 @@ static int cmd_run(cli_args_t *args) {
     waitpid(pid, &status, 0);
     
     // Flush storage
-    if (g_storage.db) {
-        sqlite3_close(g_storage.db);
+    if (g_storage.sink) {
+        mw_sink_close(g_storage.sink);
+        g_storage.sink = NULL;
     }
     
     printf("\n✅ Tracking complete!\n");
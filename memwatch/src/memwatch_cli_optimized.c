@@ -23,33 +23,17 @@
 #include <stdint.h>
 
 #include "memwatch_unified.h"
+#include "memwatch_sqlite_sink.h"
+#include "memwatch_event_ring.h"      // event_packed_t, shared with --shm-ring consumers
 
 /* ============================================================================
  * OPTIMIZED Configuration
  * ============================================================================ */
 
-#define RING_BUFFER_SIZE (256 * 1024)    // 256KB instead of 2MB
+#define RING_BUFFER_SIZE (256 * 1024)    // 256KB instead of 2MB (both sink halves)
 #define FLUSH_INTERVAL_MS 50              // Flush more frequently
-#define BATCH_SIZE 100                    // Flush every N events OR time
 #define MAX_VARIABLES 4096
 
-/* ============================================================================
- * Packed Event Structure (64 bytes total, not 200+)
- * ============================================================================ */
-
-typedef struct __attribute__((packed)) {
-    uint32_t timestamp_sec;          // 4 bytes (time in seconds, not nanoseconds)
-    uint16_t timestamp_ms;           // 2 bytes (milliseconds part)
-    uint32_t thread_id;              // 4 bytes
-    uint16_t var_id;                 // 2 bytes (variable ID, not full name)
-    uint8_t operation;               // 1 byte (operation type)
-    uint8_t scope;                   // 1 byte
-    int32_t old_value;               // 4 bytes (most values fit in 32-bit)
-    int32_t new_value;               // 4 bytes
-    uint16_t metadata_len;           // 2 bytes (metadata size)
-    char metadata[40];               // 40 bytes (compressed metadata)
-} event_packed_t;                    // Total: 64 bytes (instead of 200+)
-
 typedef struct {
     uint16_t id;
     char name[64];
@@ -57,18 +41,11 @@ typedef struct {
 } var_info_t;
 
 typedef struct {
-    pthread_mutex_t lock;
-    event_packed_t *ring_buffer;
-    int ring_head;
-    int ring_tail;
-    int ring_size;
-    
     var_info_t vars[MAX_VARIABLES];
     int var_count;
     
-    sqlite3 *db;
-    int pending_writes;
-    uint64_t last_flush_time;
+    mw_sink_t *sink;              // Double-buffered, commits on its own thread
+    int insert_event;
 } storage_optimized_t;
 
 /* ============================================================================
@@ -84,22 +61,6 @@ static bool g_track_sql = false;
  * ============================================================================ */
 
 static int init_storage_optimized(const char *path) {
-    pthread_mutex_init(&g_storage.lock, NULL);
-    
-    // Allocate optimized ring buffer (256KB instead of 2MB)
-    g_storage.ring_size = RING_BUFFER_SIZE / sizeof(event_packed_t);
-    g_storage.ring_buffer = malloc(RING_BUFFER_SIZE);
-    
-    if (!g_storage.ring_buffer) {
-        fprintf(stderr, "❌ Failed to allocate ring buffer\n");
-        return -1;
-    }
-    
-    if (sqlite3_open(path, &g_storage.db) != SQLITE_OK) {
-        fprintf(stderr, "❌ Failed to open storage\n");
-        return -1;
-    }
-    
     // Create optimized table (smaller indexes)
     const char *sql = 
         "CREATE TABLE IF NOT EXISTS events ("
@@ -117,88 +78,43 @@ static int init_storage_optimized(const char *path) {
         "CREATE INDEX IF NOT EXISTS idx_ts ON events(ts_sec, ts_ms);"
         "CREATE INDEX IF NOT EXISTS idx_var ON events(var_id);";
     
-    char *err = NULL;
-    if (sqlite3_exec(g_storage.db, sql, NULL, NULL, &err) != SQLITE_OK) {
-        fprintf(stderr, "❌ Failed to create table: %s\n", err);
-        sqlite3_free(err);
+    // Writes never block the traced program: a full queue drops the event
+    mw_sink_config_t config = {
+        .buffer_bytes = RING_BUFFER_SIZE / 2,
+        .flush_interval_ms = FLUSH_INTERVAL_MS,
+        .drop_when_full = 1,
+    };
+    g_storage.sink = mw_sink_open(path, sql, &config);
+    if (!g_storage.sink) {
+        fprintf(stderr, "❌ Failed to open storage\n");
         return -1;
     }
     
-    g_storage.last_flush_time = (uint64_t)time(NULL) * 1000;
-    return 0;
-}
-
-// Fast ring buffer write (non-blocking)
-static void ring_buffer_write(const event_packed_t *event) {
-    pthread_mutex_lock(&g_storage.lock);
-    
-    g_storage.ring_buffer[g_storage.ring_head] = *event;
-    g_storage.ring_head = (g_storage.ring_head + 1) % g_storage.ring_size;
-    
-    if (g_storage.ring_head == g_storage.ring_tail) {
-        g_storage.ring_tail = (g_storage.ring_tail + 1) % g_storage.ring_size;
+    g_storage.insert_event = mw_sink_prepare(g_storage.sink,
+        "INSERT INTO events (ts_sec, ts_ms, thread_id, var_id, operation, scope, old_val, new_val, metadata) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)");
+    if (g_storage.insert_event < 0) {
+        mw_sink_close(g_storage.sink);
+        g_storage.sink = NULL;
+        return -1;
     }
-    
-    g_storage.pending_writes++;
-    pthread_mutex_unlock(&g_storage.lock);
+    return 0;
 }
 
-// Batch flush to database (only when needed)
-static void flush_to_database(void) {
-    if (g_storage.pending_writes < BATCH_SIZE) {
-        uint64_t now = (uint64_t)time(NULL) * 1000;
-        if (now - g_storage.last_flush_time < FLUSH_INTERVAL_MS) {
-            return;  // Not time to flush yet
-        }
-    }
-    
-    pthread_mutex_lock(&g_storage.lock);
-    
-    if (g_storage.pending_writes == 0) {
-        pthread_mutex_unlock(&g_storage.lock);
-        return;
-    }
-    
-    sqlite3_stmt *stmt;
-    const char *sql = 
-        "INSERT INTO events (ts_sec, ts_ms, thread_id, var_id, operation, scope, old_val, new_val, metadata) "
-        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)";
-    
-    if (sqlite3_prepare_v2(g_storage.db, sql, -1, &stmt, NULL) != SQLITE_OK) {
-        pthread_mutex_unlock(&g_storage.lock);
-        return;
-    }
-    
-    int tail = g_storage.ring_tail;
-    int count = 0;
-    
-    while (tail != g_storage.ring_head && count < BATCH_SIZE) {
-        event_packed_t *evt = &g_storage.ring_buffer[tail];
-        
-        sqlite3_bind_int(stmt, 1, evt->timestamp_sec);
-        sqlite3_bind_int(stmt, 2, evt->timestamp_ms);
-        sqlite3_bind_int(stmt, 3, evt->thread_id);
-        sqlite3_bind_int(stmt, 4, evt->var_id);
-        sqlite3_bind_int(stmt, 5, evt->operation);
-        sqlite3_bind_int(stmt, 6, evt->scope);
-        sqlite3_bind_int(stmt, 7, evt->old_value);
-        sqlite3_bind_int(stmt, 8, evt->new_value);
-        sqlite3_bind_text(stmt, 9, evt->metadata, evt->metadata_len, SQLITE_STATIC);
-        
-        sqlite3_step(stmt);
-        sqlite3_reset(stmt);
-        
-        tail = (tail + 1) % g_storage.ring_size;
-        count++;
-    }
-    
-    sqlite3_finalize(stmt);
-    
-    g_storage.ring_tail = tail;
-    g_storage.pending_writes -= count;
-    g_storage.last_flush_time = (uint64_t)time(NULL) * 1000;
-    
-    pthread_mutex_unlock(&g_storage.lock);
+// Queue one packed event for the sink's writer thread (non-blocking)
+static void write_event(const event_packed_t *evt) {
+    mw_sink_value_t row[] = {
+        MW_SINK_I64(evt->timestamp_sec),
+        MW_SINK_I64(evt->timestamp_ms),
+        MW_SINK_I64(evt->thread_id),
+        MW_SINK_I64(evt->var_id),
+        MW_SINK_I64(evt->operation),
+        MW_SINK_I64(evt->scope),
+        MW_SINK_I64(evt->old_value),
+        MW_SINK_I64(evt->new_value),
+        MW_SINK_STRN(evt->metadata, evt->metadata_len),
+    };
+    mw_sink_write(g_storage.sink, g_storage.insert_event, row, sizeof(row) / sizeof(row[0]));
 }
 
 // Record memory change (compact version)
@@ -222,8 +138,7 @@ static void record_change_optimized(uint16_t var_id, int32_t old_val, int32_t ne
         strncpy(evt.metadata, metadata, sizeof(evt.metadata) - 1);
     }
     
-    ring_buffer_write(&evt);
-    flush_to_database();
+    write_event(&evt);
 }
 
 /* ============================================================================
@@ -259,17 +174,20 @@ static int cmd_run_optimized(const char *executable, char **exe_args, int argc,
         return 1;
     }
     
-    // Final flush
-    g_storage.pending_writes = 999999;
-    flush_to_database();
-    
     int status;
     waitpid(pid, &status, 0);
     
-    if (g_storage.db) {
-        sqlite3_close(g_storage.db);
+    // Final flush
+    if (g_storage.sink) {
+        mw_sink_stats_t stats;
+        mw_sink_flush(g_storage.sink);
+        mw_sink_stats(g_storage.sink, &stats);
+        if (stats.rows_dropped) {
+            printf("⚠️  %lu events dropped (writer fell behind)\n", (unsigned long)stats.rows_dropped);
+        }
+        mw_sink_close(g_storage.sink);
+        g_storage.sink = NULL;
     }
-    free(g_storage.ring_buffer);
     
     printf("\n✅ Tracking complete!\n");
     printf("📊 Results saved to: %s\n", storage_path);
@@ -0,0 +1,522 @@
+/*
+ * memwatch_collector.c - Receive exported events into a FastStorage store
+ *
+ * Usage:
+ *   memwatch_collector --listen <endpoint> [--listen ...] [--store <path>]
+ *                      [--shards N] [--capacity MB] [--sync]
+ *   memwatch_collector --dump [--store <path>] [--shards N] [--format json]
+ *
+ * Endpoints are "tcp:host:port" (empty host for every interface) or
+ * "unix:/path". Each connection gets its own thread; frames are stored as
+ * received (compressed), one key per frame, in a sharded store so that
+ * sources don't contend:
+ *
+ *   sources                   array of uint64 source ids
+ *   source.<id>               collector_source_t
+ *   frame.<id>.<seq>          mw_frame_header_t + stored payload
+ *
+ * A frame is acknowledged once stored, and frames at or below a source's
+ * last stored seq are acknowledged without storing again, so an exporter
+ * that resends after a reconnect (or a collector restart) never creates
+ * duplicates. Stores survive the collector being killed; --sync makes
+ * each frame durable before its ack, against power loss too.
+ *
+ * --dump decodes the store and prints one line per event, frame by frame.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+#include "memwatch_export.h"
+#include "faststorage_fast.h"
+
+#define MAX_LISTENERS   8
+#define MAX_SOURCES     4096
+#define POLL_MS         200
+#define STOP_WAIT_MS    2000
+
+typedef struct {
+    uint64_t id;
+    uint64_t last_seq;
+    uint64_t frames;
+    uint64_t events;
+    uint32_t pid;
+    uint32_t reserved;
+    char name[MW_EXPORT_NAME_MAX];
+} collector_source_t;
+
+typedef struct {
+    collector_source_t meta;
+    pthread_mutex_t lock;         /* one connection stores for a source at a time */
+} source_entry_t;
+
+static FastStorage *g_store;
+static volatile sig_atomic_t g_stop;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static source_entry_t *g_sources[MAX_SOURCES];
+static uint32_t g_source_count;
+static uint32_t g_active;
+
+static struct {
+    uint64_t connections;
+    uint64_t frames;
+    uint64_t duplicates;
+    uint64_t rejected;
+    uint64_t events;
+    uint64_t stored_bytes;
+} g_stats;
+
+static void on_signal(int sig) {
+    (void)sig;
+    g_stop = 1;
+}
+
+static void frame_key(char *key, size_t len, uint64_t source, uint64_t seq) {
+    snprintf(key, len, "frame.%016llx.%llu", (unsigned long long)source, (unsigned long long)seq);
+}
+
+static void source_key(char *key, size_t len, uint64_t source) {
+    snprintf(key, len, "source.%016llx", (unsigned long long)source);
+}
+
+/* ============================================================================
+ * Sources
+ * ============================================================================ */
+
+static int load_sources(void) {
+    ssize_t size = faststorage_size(g_store, "sources");
+    if (size <= 0) return 0;
+
+    uint64_t *ids = malloc((size_t)size);
+    size_t len = (size_t)size;
+    if (!ids || faststorage_read(g_store, "sources", ids, &len) != 0) {
+        free(ids);
+        return -1;
+    }
+    for (size_t i = 0; i < len / sizeof(uint64_t) && g_source_count < MAX_SOURCES; i++) {
+        char key[64];
+        source_entry_t *s = calloc(1, sizeof(*s));
+        size_t meta_len = sizeof(s->meta);
+        source_key(key, sizeof(key), ids[i]);
+        if (!s || faststorage_read(g_store, key, &s->meta, &meta_len) != 0 || meta_len != sizeof(s->meta)) {
+            free(s);
+            continue;
+        }
+        pthread_mutex_init(&s->lock, NULL);
+        g_sources[g_source_count++] = s;
+    }
+    free(ids);
+    return 0;
+}
+
+/* Find a source, registering it on first contact */
+static source_entry_t *get_source(const mw_export_hello_t *hello) {
+    pthread_mutex_lock(&g_lock);
+    for (uint32_t i = 0; i < g_source_count; i++) {
+        if (g_sources[i]->meta.id == hello->source_id) {
+            source_entry_t *s = g_sources[i];
+            pthread_mutex_unlock(&g_lock);
+            return s;
+        }
+    }
+
+    source_entry_t *s = NULL;
+    if (g_source_count < MAX_SOURCES && (s = calloc(1, sizeof(*s)))) {
+        s->meta.id = hello->source_id;
+        s->meta.pid = hello->pid;
+        memcpy(s->meta.name, hello->name, sizeof(s->meta.name));
+        s->meta.name[sizeof(s->meta.name) - 1] = '\0';
+        pthread_mutex_init(&s->lock, NULL);
+
+        uint64_t ids[MAX_SOURCES];
+        for (uint32_t i = 0; i < g_source_count; i++) ids[i] = g_sources[i]->meta.id;
+        ids[g_source_count] = s->meta.id;
+
+        char key[64];
+        source_key(key, sizeof(key), s->meta.id);
+        FastStorageBatchEntry entries[2] = {
+            { key, &s->meta, sizeof(s->meta) },
+            { "sources", ids, (g_source_count + 1) * sizeof(uint64_t) },
+        };
+        if (faststorage_write_batch(g_store, entries, 2) == 0) {
+            g_sources[g_source_count++] = s;
+        } else {
+            pthread_mutex_destroy(&s->lock);
+            free(s);
+            s = NULL;
+        }
+    }
+    pthread_mutex_unlock(&g_lock);
+    return s;
+}
+
+/* ============================================================================
+ * Connections
+ * ============================================================================ */
+
+/* Returns 0, or -1 on error, EOF or shutdown */
+static int read_exact(int fd, void *buf, size_t len) {
+    uint8_t *p = buf;
+    while (len) {
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        int ready = poll(&pfd, 1, POLL_MS);
+        if (g_stop) return -1;
+        if (ready < 0 && errno != EINTR) return -1;
+        if (ready <= 0) continue;
+        ssize_t n = recv(fd, p, len, 0);
+        if (n == 0) return -1;
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN) continue;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int send_ack(int fd, uint64_t seq) {
+    mw_frame_header_t ack = {
+        .magic = MW_EXPORT_MAGIC,
+        .version = MW_EXPORT_VERSION,
+        .type = MW_FRAME_ACK,
+        .seq = seq,
+        .crc = 0,
+    };
+    return send(fd, &ack, sizeof(ack), MSG_NOSIGNAL) == (ssize_t)sizeof(ack) ? 0 : -1;
+}
+
+/* Store one EVENTS frame (or recognise a resend); returns the seq to ack */
+static int store_frame(source_entry_t *s, const uint8_t *frame, uint64_t *ack) {
+    const mw_frame_header_t *h = (const mw_frame_header_t *)frame;
+
+    pthread_mutex_lock(&s->lock);
+    if (h->seq <= s->meta.last_seq) {
+        *ack = s->meta.last_seq;
+        pthread_mutex_unlock(&s->lock);
+        __atomic_fetch_add(&g_stats.duplicates, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    collector_source_t meta = s->meta;
+    meta.last_seq = h->seq;
+    meta.frames++;
+    meta.events += h->count;
+
+    char fkey[80], skey[64];
+    frame_key(fkey, sizeof(fkey), s->meta.id, h->seq);
+    source_key(skey, sizeof(skey), s->meta.id);
+    FastStorageBatchEntry entries[2] = {
+        { fkey, frame, sizeof(*h) + h->stored_len },
+        { skey, &meta, sizeof(meta) },
+    };
+    int rc = faststorage_write_batch(g_store, entries, 2);
+    if (rc == 0) {
+        s->meta = meta;
+        *ack = meta.last_seq;
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    if (rc == 0) {
+        __atomic_fetch_add(&g_stats.frames, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&g_stats.events, h->count, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&g_stats.stored_bytes, h->stored_len, __ATOMIC_RELAXED);
+    }
+    return rc;
+}
+
+static void *connection_main(void *arg) {
+    int fd = (int)(intptr_t)arg;
+    uint8_t *frame = NULL, *raw = NULL;
+    size_t frame_cap = 0, raw_cap = 0;
+    mw_frame_header_t h;
+    mw_export_hello_t hello;
+
+    if (read_exact(fd, &h, sizeof(h)) != 0 || mw_export_check_header(&h) != 0 ||
+        h.type != MW_FRAME_HELLO || h.stored_len != sizeof(hello) ||
+        read_exact(fd, &hello, sizeof(hello)) != 0) {
+        goto done;
+    }
+    source_entry_t *s = get_source(&hello);
+    if (!s) goto done;
+
+    pthread_mutex_lock(&s->lock);
+    uint64_t last = s->meta.last_seq;
+    pthread_mutex_unlock(&s->lock);
+    if (send_ack(fd, last) != 0) goto done;
+
+    while (!g_stop) {
+        if (read_exact(fd, &h, sizeof(h)) != 0) break;
+        if (mw_export_check_header(&h) != 0 || h.type != MW_FRAME_EVENTS) {
+            __atomic_fetch_add(&g_stats.rejected, 1, __ATOMIC_RELAXED);
+            break;
+        }
+        size_t need = sizeof(h) + h.stored_len;
+        if (need > frame_cap) {
+            uint8_t *p = realloc(frame, need);
+            if (!p) break;
+            frame = p;
+            frame_cap = need;
+        }
+        if (h.raw_len > raw_cap || !raw) {
+            uint8_t *p = realloc(raw, h.raw_len ? h.raw_len : 1);
+            if (!p) break;
+            raw = p;
+            raw_cap = h.raw_len ? h.raw_len : 1;
+        }
+        memcpy(frame, &h, sizeof(h));
+        if (read_exact(fd, frame + sizeof(h), h.stored_len) != 0) break;
+
+        /* Only frames that decode are stored; a bad one ends the
+         * connection and the exporter resends it */
+        if (mw_export_unpack(&h, frame + sizeof(h), raw, raw_cap) < 0) {
+            __atomic_fetch_add(&g_stats.rejected, 1, __ATOMIC_RELAXED);
+            break;
+        }
+        uint64_t ack;
+        if (store_frame(s, frame, &ack) != 0 || send_ack(fd, ack) != 0) break;
+    }
+
+done:
+    free(frame);
+    free(raw);
+    close(fd);
+    __atomic_fetch_sub(&g_active, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static int serve(const char **endpoints, int count) {
+    struct pollfd fds[MAX_LISTENERS];
+    for (int i = 0; i < count; i++) {
+        fds[i].fd = mw_export_listen(endpoints[i]);
+        fds[i].events = POLLIN;
+        if (fds[i].fd < 0) {
+            fprintf(stderr, "memwatch_collector: cannot listen on %s: %s\n", endpoints[i], strerror(errno));
+            return 1;
+        }
+        fprintf(stderr, "Listening on %s\n", endpoints[i]);
+    }
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    while (!g_stop) {
+        if (poll(fds, (nfds_t)count, POLL_MS) <= 0) continue;
+        for (int i = 0; i < count; i++) {
+            if (!(fds[i].revents & POLLIN)) continue;
+            int fd = accept4(fds[i].fd, NULL, NULL, SOCK_CLOEXEC);
+            if (fd < 0) continue;
+            pthread_t thread;
+            __atomic_fetch_add(&g_active, 1, __ATOMIC_ACQUIRE);
+            if (pthread_create(&thread, &attr, connection_main, (void *)(intptr_t)fd) != 0) {
+                __atomic_fetch_sub(&g_active, 1, __ATOMIC_RELEASE);
+                close(fd);
+                continue;
+            }
+            g_stats.connections++;
+        }
+    }
+    pthread_attr_destroy(&attr);
+
+    for (int i = 0; i < count; i++) {
+        close(fds[i].fd);
+        if (strncmp(endpoints[i], "unix:", 5) == 0) unlink(endpoints[i] + 5);
+    }
+    for (int waited = 0; __atomic_load_n(&g_active, __ATOMIC_ACQUIRE) && waited < STOP_WAIT_MS; waited += 10) {
+        usleep(10000);
+    }
+
+    fprintf(stderr, "\nCollector stats:\n");
+    fprintf(stderr, "  Connections: %llu\n", (unsigned long long)g_stats.connections);
+    fprintf(stderr, "  Sources:     %u\n", g_source_count);
+    fprintf(stderr, "  Frames:      %llu (%llu duplicates, %llu rejected)\n",
+            (unsigned long long)g_stats.frames, (unsigned long long)g_stats.duplicates,
+            (unsigned long long)g_stats.rejected);
+    fprintf(stderr, "  Events:      %llu\n", (unsigned long long)g_stats.events);
+    fprintf(stderr, "  Stored:      %llu bytes\n", (unsigned long long)g_stats.stored_bytes);
+    return 0;
+}
+
+/* ============================================================================
+ * Dump
+ * ============================================================================ */
+
+static void print_hex(const void *data, uint32_t len) {
+    const uint8_t *p = data;
+    for (uint32_t i = 0; i < len; i++) printf("%02x", p[i]);
+}
+
+static void print_json_string(const char *s, uint32_t len) {
+    putchar('"');
+    for (uint32_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c == '"' || c == '\\') printf("\\%c", c);
+        else if (c < 0x20) printf("\\u%04x", c);
+        else putchar(c);
+    }
+    putchar('"');
+}
+
+static int dump(bool json) {
+    uint8_t *raw = NULL;
+    size_t raw_cap = 0;
+    uint64_t total = 0, bad = 0;
+
+    for (uint32_t i = 0; i < g_source_count; i++) {
+        const collector_source_t *m = &g_sources[i]->meta;
+        if (!json) {
+            printf("# source %016llx %s pid %u: %llu frames, %llu events\n",
+                   (unsigned long long)m->id, m->name, m->pid,
+                   (unsigned long long)m->frames, (unsigned long long)m->events);
+        }
+        for (uint64_t seq = 1; seq <= m->last_seq; seq++) {
+            char key[80];
+            FastStorageView view;
+            frame_key(key, sizeof(key), m->id, seq);
+            if (faststorage_get_view(g_store, key, &view) != 0) continue;  /* dropped by the exporter */
+
+            mw_frame_header_t h;
+            memcpy(&h, view.ptr, sizeof(h));
+            if (h.raw_len > raw_cap || !raw) {
+                free(raw);
+                raw_cap = h.raw_len ? h.raw_len : 1;
+                raw = malloc(raw_cap);
+            }
+            long len = raw ? mw_export_unpack(&h, (const uint8_t *)view.ptr + sizeof(h), raw, raw_cap) : -1;
+            faststorage_release_view(g_store, &view);
+            if (len < 0) {
+                bad++;
+                continue;
+            }
+
+            mw_export_reader_t r;
+            mw_export_event_t ev;
+            int rc;
+            mw_export_reader_init(&r, raw, (size_t)len);
+            while ((rc = mw_export_read(&r, &ev)) == 1) {
+                total++;
+                if (json) {
+                    printf("{\"source\":\"%016llx\",\"seq\":%llu,\"timestamp_ns\":%llu,"
+                           "\"region_id\":%u,\"thread_id\":%u,\"name\":",
+                           (unsigned long long)m->id, (unsigned long long)seq,
+                           (unsigned long long)ev.timestamp_ns, ev.region_id, ev.thread_id);
+                    print_json_string(ev.name ? ev.name : "", ev.name_len);
+                    printf(",\"old\":\"");
+                    print_hex(ev.old_value, ev.old_len);
+                    printf("\",\"new\":\"");
+                    print_hex(ev.new_value, ev.new_len);
+                    printf("\"}\n");
+                } else {
+                    printf("%016llx %llu ts=%llu region=%u thread=%u %.*s ",
+                           (unsigned long long)m->id, (unsigned long long)seq,
+                           (unsigned long long)ev.timestamp_ns, ev.region_id, ev.thread_id,
+                           (int)ev.name_len, ev.name ? ev.name : "");
+                    print_hex(ev.old_value, ev.old_len);
+                    printf(" -> ");
+                    print_hex(ev.new_value, ev.new_len);
+                    printf("\n");
+                }
+            }
+            if (rc < 0) bad++;
+        }
+    }
+    free(raw);
+    fprintf(stderr, "%llu events from %u sources", (unsigned long long)total, g_source_count);
+    if (bad) fprintf(stderr, ", %llu damaged frames", (unsigned long long)bad);
+    fprintf(stderr, "\n");
+    return bad ? 1 : 0;
+}
+
+/* ============================================================================
+ * Main
+ * ============================================================================ */
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s --listen <endpoint> [--listen ...] [--store <path>] [--shards N]\n"
+            "          [--capacity MB] [--sync]\n"
+            "       %s --dump [--store <path>] [--shards N] [--format json]\n"
+            "Endpoints: tcp:host:port, tcp::port, unix:/path\n",
+            prog, prog);
+}
+
+int main(int argc, char **argv) {
+    const char *endpoints[MAX_LISTENERS];
+    int endpoint_count = 0;
+    const char *store_path = "memwatch_collector.store";
+    uint32_t shards = 4;
+    size_t capacity_mb = 64;
+    bool do_dump = false, json = false, sync = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--listen") == 0 && i + 1 < argc) {
+            if (endpoint_count == MAX_LISTENERS) {
+                fprintf(stderr, "%s: at most %d --listen endpoints\n", argv[0], MAX_LISTENERS);
+                return 2;
+            }
+            endpoints[endpoint_count++] = argv[++i];
+        } else if (strcmp(argv[i], "--store") == 0 && i + 1 < argc) {
+            store_path = argv[++i];
+        } else if (strcmp(argv[i], "--shards") == 0 && i + 1 < argc) {
+            shards = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--capacity") == 0 && i + 1 < argc) {
+            capacity_mb = (size_t)atol(argv[++i]);
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            json = strcmp(argv[++i], "json") == 0;
+        } else if (strcmp(argv[i], "--dump") == 0) {
+            do_dump = true;
+        } else if (strcmp(argv[i], "--sync") == 0) {
+            sync = true;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if ((!do_dump && endpoint_count == 0) || shards < 1 || shards > 256 || capacity_mb < 1) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (do_dump) {
+        char first[4096];
+        snprintf(first, sizeof(first), shards == 1 ? "%s" : "%s.0", store_path);
+        if (access(first, F_OK) != 0) {
+            fprintf(stderr, "%s: %s: no such store\n", argv[0], store_path);
+            return 1;
+        }
+    }
+
+    g_store = shards == 1 ? faststorage_create(store_path, capacity_mb << 20)
+                          : faststorage_create_sharded(store_path, capacity_mb << 20, shards);
+    if (!g_store) {
+        fprintf(stderr, "%s: cannot open store %s: %s\n", argv[0], store_path, strerror(errno));
+        return 1;
+    }
+    if (sync) faststorage_set_durability(g_store, FASTSTORAGE_DURABILITY_SYNC, 0);
+    if (load_sources() != 0) {
+        fprintf(stderr, "%s: cannot read sources from %s\n", argv[0], store_path);
+        faststorage_destroy(g_store);
+        return 1;
+    }
+
+    int rc;
+    if (do_dump) {
+        rc = dump(json);
+    } else {
+        struct sigaction sa = { .sa_handler = on_signal };
+        sigaction(SIGINT, &sa, NULL);
+        sigaction(SIGTERM, &sa, NULL);
+        signal(SIGPIPE, SIG_IGN);
+        rc = serve(endpoints, endpoint_count);
+    }
+    faststorage_destroy(g_store);
+    return rc;
+}
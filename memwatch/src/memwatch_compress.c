@@ -0,0 +1,486 @@
+/*
+ * memwatch_compress.c - Dictionary compression for stored value snapshots
+ *
+ * Each group keeps a copy of its latest value (its first dict_bytes).
+ * Once train_after values have been seen, that copy is frozen into a
+ * dictionary: persisted, hashed once by mw_lz4_dict_load(), and used for
+ * every later value of the group until the next retraining. One value
+ * makes the best dictionary for snapshots: older ones repeat most of its
+ * bytes, add to what is stored, and hold the counters that drifted most.
+ *
+ * Compression runs outside the lock; groups and dictionaries are only
+ * looked up or updated under it. Dictionaries are freed on close only.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "memwatch_compress.h"
+#include "memwatch_lz4.h"
+
+#define ZVALUE_MAGIC        0x315a574dU       /* "MWZ1" */
+#define ZSTORE_KEY_MAX      48
+#define ZSTORE_BACKOFF_MAX  64
+#define ZSTORE_STREAK       4                 /* failures in a row before backing off */
+
+enum {
+    ZCODEC_RAW = 0,
+    ZCODEC_LZ4 = 1,
+    ZCODEC_LZ4_DICT = 2,
+};
+
+typedef struct {
+    uint32_t magic;
+    uint8_t codec;
+    uint8_t reserved[3];
+    uint32_t dict_id;
+    uint32_t raw_len;
+} zvalue_header_t;
+
+_Static_assert(sizeof(zvalue_header_t) == 16, "zvalue_header_t is on disk");
+
+typedef struct {
+    size_t min_size;              /* smaller values are stored raw */
+    size_t dict_bytes;            /* dictionary size limit, 0 = no dictionaries */
+    uint32_t train_after;         /* values seen before the first dictionary */
+    uint32_t retrain_every;       /* values per dictionary, 0 = keep the first */
+} zmode_t;
+
+static const zmode_t MODES[] = {
+    [MW_COMPRESS_OFF]      = { SIZE_MAX, 0, 0, 0 },
+    [MW_COMPRESS_BALANCED] = { 256, 0, 0, 0 },
+    [MW_COMPRESS_LITE]     = { 32, 16 * 1024, 4, 0 },
+    [MW_COMPRESS_DEEP]     = { 32, MW_LZ4_DICT_MAX, 2, 64 },
+};
+
+static const char *MODE_NAMES[] = { "off", "balanced", "lite", "deep" };
+
+typedef struct {
+    uint32_t id;
+    uint32_t group;
+    uint8_t *bytes;
+    mw_lz4_dict_t lz4;
+} zdict_t;
+
+typedef struct {
+    uint32_t group;
+    bool loaded;                  /* mwz.group.G looked up */
+    zdict_t *dict;                /* current dictionary, NULL until trained */
+    uint8_t *latest;              /* latest value, at most dict_bytes of it */
+    size_t latest_len;
+    uint32_t seen;                /* values since the last training */
+    uint32_t best;                /* best stored/raw (1/1024ths) since then */
+    uint64_t lost;                /* bytes stored over that ratio since then */
+    bool stale;                   /* values drifted away from the dictionary */
+    uint32_t failures;            /* incompressible in a row */
+    uint32_t backoff;             /* puts left to store untried */
+} zgroup_t;
+
+struct mw_zstore {
+    FastStorage *fs;
+    zmode_t mode;
+    pthread_mutex_t lock;
+    zgroup_t *groups;             /* open addressing on group */
+    uint32_t group_mask;
+    uint32_t group_count;
+    zdict_t **dicts;              /* open addressing on id */
+    uint32_t dict_mask;
+    uint32_t dict_count;
+    uint32_t next_id;
+    mw_compress_stats_t stats;
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint32_t slot_of(uint32_t v, uint32_t mask) {
+    return (v * 2654435761U) & mask;
+}
+
+int mw_compress_parse(const char *name, mw_compress_mode_t *out) {
+    if (!name) {
+        *out = MW_COMPRESS_BALANCED;
+        return 0;
+    }
+    for (int i = 0; i < (int)(sizeof(MODE_NAMES) / sizeof(MODE_NAMES[0])); i++) {
+        if (strcmp(name, MODE_NAMES[i]) == 0) {
+            *out = (mw_compress_mode_t)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *mw_compress_name(mw_compress_mode_t mode) {
+    return (unsigned)mode < sizeof(MODE_NAMES) / sizeof(MODE_NAMES[0]) ? MODE_NAMES[mode] : "unknown";
+}
+
+/* ============================================================================
+ * Dictionaries (lock held)
+ * ============================================================================ */
+
+static int add_dict(mw_zstore_t *z, zdict_t *d) {
+    if ((z->dict_count + 1) * 2 > z->dict_mask + 1) {
+        uint32_t mask = z->dict_mask * 2 + 1;
+        zdict_t **table = calloc(mask + 1, sizeof(*table));
+        if (!table) return -1;
+        for (uint32_t i = 0; i <= z->dict_mask; i++) {
+            if (!z->dicts[i]) continue;
+            uint32_t s = slot_of(z->dicts[i]->id, mask);
+            while (table[s]) s = (s + 1) & mask;
+            table[s] = z->dicts[i];
+        }
+        free(z->dicts);
+        z->dicts = table;
+        z->dict_mask = mask;
+    }
+    uint32_t s = slot_of(d->id, z->dict_mask);
+    while (z->dicts[s]) s = (s + 1) & z->dict_mask;
+    z->dicts[s] = d;
+    z->dict_count++;
+    return 0;
+}
+
+static zdict_t *make_dict(uint32_t id, uint32_t group, uint8_t *bytes, size_t len) {
+    zdict_t *d = malloc(sizeof(*d));
+    if (!d) return NULL;
+    d->id = id;
+    d->group = group;
+    d->bytes = bytes;
+    mw_lz4_dict_load(&d->lz4, bytes, len);
+    return d;
+}
+
+/* Find a dictionary, loading it from the store the first time */
+static zdict_t *get_dict(mw_zstore_t *z, uint32_t id) {
+    for (uint32_t s = slot_of(id, z->dict_mask); z->dicts[s]; s = (s + 1) & z->dict_mask) {
+        if (z->dicts[s]->id == id) return z->dicts[s];
+    }
+
+    char key[ZSTORE_KEY_MAX];
+    snprintf(key, sizeof(key), "mwz.dict.%u", id);
+    ssize_t size = faststorage_size(z->fs, key);
+    if (size < (ssize_t)sizeof(uint32_t) || size > (ssize_t)(sizeof(uint32_t) + MW_LZ4_DICT_MAX)) {
+        return NULL;
+    }
+    uint8_t *buf = malloc((size_t)size);
+    size_t len = (size_t)size;
+    if (!buf || faststorage_read(z->fs, key, buf, &len) != 0 || len != (size_t)size) {
+        free(buf);
+        return NULL;
+    }
+    uint32_t group;
+    memcpy(&group, buf, sizeof(group));
+    memmove(buf, buf + sizeof(group), len - sizeof(group));
+    zdict_t *d = make_dict(id, group, buf, len - sizeof(group));
+    if (!d || add_dict(z, d) != 0) {
+        free(buf);
+        free(d);
+        return NULL;
+    }
+    return d;
+}
+
+/* Freeze the group's latest value into its next dictionary */
+static void train(mw_zstore_t *z, zgroup_t *g) {
+    size_t used = g->latest_len;
+    const uint8_t *recent = g->latest;
+    uint8_t *bytes = malloc(sizeof(uint32_t) + used);
+    if (!bytes) return;
+    memcpy(bytes, &g->group, sizeof(uint32_t));
+    memcpy(bytes + sizeof(uint32_t), recent, used);
+
+    uint32_t id = z->next_id;
+    uint32_t next = id + 1;
+    char dict_key[ZSTORE_KEY_MAX], group_key[ZSTORE_KEY_MAX];
+    snprintf(dict_key, sizeof(dict_key), "mwz.dict.%u", id);
+    snprintf(group_key, sizeof(group_key), "mwz.group.%u", g->group);
+    FastStorageBatchEntry entries[3] = {
+        { dict_key, bytes, sizeof(uint32_t) + used },
+        { group_key, &id, sizeof(id) },
+        { "mwz.next", &next, sizeof(next) },
+    };
+    if (faststorage_write_batch(z->fs, entries, 3) != 0) {
+        free(bytes);
+        return;
+    }
+    z->next_id = next;
+    memmove(bytes, bytes + sizeof(uint32_t), used);
+    zdict_t *d = make_dict(id, g->group, bytes, used);
+    if (!d || add_dict(z, d) != 0) {
+        free(bytes);
+        free(d);
+        return;
+    }
+    g->dict = d;
+    g->seen = 0;
+    g->best = UINT32_MAX;
+    g->lost = 0;
+    g->stale = false;
+    z->stats.dicts++;
+    z->stats.stored_bytes += sizeof(uint32_t) + used;
+}
+
+/* ============================================================================
+ * Groups (lock held)
+ * ============================================================================ */
+
+static zgroup_t *get_group(mw_zstore_t *z, uint32_t group) {
+    uint32_t s = slot_of(group, z->group_mask);
+    for (; z->groups[s].loaded; s = (s + 1) & z->group_mask) {
+        if (z->groups[s].group == group) return &z->groups[s];
+    }
+
+    if ((z->group_count + 1) * 2 > z->group_mask + 1) {
+        uint32_t mask = z->group_mask * 2 + 1;
+        zgroup_t *table = calloc(mask + 1, sizeof(*table));
+        if (!table) return NULL;
+        for (uint32_t i = 0; i <= z->group_mask; i++) {
+            if (!z->groups[i].loaded) continue;
+            uint32_t t = slot_of(z->groups[i].group, mask);
+            while (table[t].loaded) t = (t + 1) & mask;
+            table[t] = z->groups[i];
+        }
+        free(z->groups);
+        z->groups = table;
+        z->group_mask = mask;
+        s = slot_of(group, mask);
+        while (z->groups[s].loaded) s = (s + 1) & mask;
+    }
+
+    zgroup_t *g = &z->groups[s];
+    memset(g, 0, sizeof(*g));
+    g->group = group;
+    g->loaded = true;
+    g->best = UINT32_MAX;
+    z->group_count++;
+
+    /* A reopened store goes on with the group's last dictionary */
+    char key[ZSTORE_KEY_MAX];
+    uint32_t id;
+    size_t len = sizeof(id);
+    snprintf(key, sizeof(key), "mwz.group.%u", group);
+    if (z->mode.dict_bytes && faststorage_read(z->fs, key, &id, &len) == 0 && len == sizeof(id)) {
+        g->dict = get_dict(z, id);
+    }
+    return g;
+}
+
+static void remember(mw_zstore_t *z, zgroup_t *g, const void *value, size_t len) {
+    size_t cap = z->mode.dict_bytes;
+    if (!g->latest && !(g->latest = malloc(cap))) return;
+    if (len > cap) len = cap;
+    memcpy(g->latest, value, len);
+    g->latest_len = len;
+}
+
+/* ============================================================================
+ * Public API
+ * ============================================================================ */
+
+mw_zstore_t *mw_zstore_open(FastStorage *fs, mw_compress_mode_t mode) {
+    if (!fs || (unsigned)mode >= sizeof(MODES) / sizeof(MODES[0])) {
+        errno = EINVAL;
+        return NULL;
+    }
+    mw_zstore_t *z = calloc(1, sizeof(*z));
+    if (!z) return NULL;
+    z->fs = fs;
+    z->mode = MODES[mode];
+    z->group_mask = 63;
+    z->dict_mask = 15;
+    z->groups = calloc(z->group_mask + 1, sizeof(*z->groups));
+    z->dicts = calloc(z->dict_mask + 1, sizeof(*z->dicts));
+    if (!z->groups || !z->dicts) {
+        free(z->groups);
+        free(z->dicts);
+        free(z);
+        errno = ENOMEM;
+        return NULL;
+    }
+    uint32_t next = 1;
+    size_t len = sizeof(next);
+    if (faststorage_read(fs, "mwz.next", &next, &len) != 0 || len != sizeof(next) || next == 0) {
+        next = 1;
+    }
+    z->next_id = next;
+    pthread_mutex_init(&z->lock, NULL);
+    return z;
+}
+
+int mw_zstore_put(mw_zstore_t *z, const char *key, uint32_t group, const void *value, size_t len) {
+    if (len > UINT32_MAX) {
+        errno = EFBIG;
+        return -1;
+    }
+
+    pthread_mutex_lock(&z->lock);
+    zgroup_t *g = get_group(z, group);
+    bool try = g && len >= z->mode.min_size && g->backoff == 0;
+    if (g && g->backoff) g->backoff--;
+    zdict_t *dict = g ? g->dict : NULL;
+    if (g && z->mode.dict_bytes && len >= z->mode.min_size && g->failures == 0) {
+        remember(z, g, value, len);
+        g->seen++;
+        if ((!g->dict && g->seen >= z->mode.train_after) || g->stale ||
+            (z->mode.retrain_every && g->dict && g->seen >= z->mode.retrain_every)) {
+            train(z, g);
+        }
+    }
+    pthread_mutex_unlock(&z->lock);
+
+    size_t cap = sizeof(zvalue_header_t) + (try ? mw_lz4_bound(len) : len);
+    uint8_t *buf = malloc(cap);
+    if (!buf) return -1;
+    zvalue_header_t *h = (zvalue_header_t *)buf;
+    *h = (zvalue_header_t){ .magic = ZVALUE_MAGIC, .codec = ZCODEC_RAW, .raw_len = (uint32_t)len };
+
+    size_t stored = 0;
+    uint64_t spent = 0;
+    if (try) {
+        uint64_t start = now_ns();
+        size_t limit = len - len / 16;    /* saving less than 1/16 is a failure */
+        stored = dict ? mw_lz4_compress_dict(&dict->lz4, value, len, buf + sizeof(*h), limit)
+                      : mw_lz4_compress(value, len, buf + sizeof(*h), limit);
+        spent = now_ns() - start;
+        if (stored) {
+            h->codec = dict ? ZCODEC_LZ4_DICT : ZCODEC_LZ4;
+            h->dict_id = dict ? dict->id : 0;
+        }
+    }
+    if (!stored) {
+        memcpy(buf + sizeof(*h), value, len);
+        stored = len;
+    }
+    uint8_t codec = h->codec;
+    int rc = faststorage_write(z->fs, key, buf, sizeof(*h) + stored);
+    free(buf);
+
+    pthread_mutex_lock(&z->lock);
+    g = get_group(z, group);      /* the table may have grown meanwhile */
+    if (rc == 0 && g) {
+        z->stats.values++;
+        z->stats.raw_bytes += len;
+        z->stats.stored_bytes += sizeof(zvalue_header_t) + stored;
+        z->stats.compress_ns += spent;
+        if (!try) {
+            z->stats.skipped++;
+        } else if (codec != ZCODEC_RAW) {
+            z->stats.compressed++;
+            if (dict) z->stats.with_dict++;
+            g->failures = 0;
+            /* Retrain once drift (counters, timestamps) has cost more than
+             * a new dictionary will */
+            uint32_t ratio = (uint32_t)((stored << 10) / len);
+            if (dict && g->dict == dict) {
+                if (ratio < g->best) g->best = ratio;
+                g->lost += (uint64_t)(ratio - g->best) * len >> 10;
+                if (g->lost > sizeof(uint32_t) + dict->lz4.len) g->stale = true;
+            }
+        } else {
+            z->stats.incompressible++;
+            if (++g->failures >= ZSTORE_STREAK) {
+                uint32_t wait = 1u << (g->failures - ZSTORE_STREAK);
+                g->backoff = wait < ZSTORE_BACKOFF_MAX ? wait : ZSTORE_BACKOFF_MAX;
+            }
+        }
+    }
+    pthread_mutex_unlock(&z->lock);
+    return rc;
+}
+
+int mw_zstore_get(mw_zstore_t *z, const char *key, void *out, size_t capacity, size_t *len_out) {
+    FastStorageView view;
+    if (faststorage_get_view(z->fs, key, &view) != 0) {
+        errno = ENOENT;
+        return -1;
+    }
+
+    zvalue_header_t h = { 0 };
+    int rc = -1, err = EBADMSG;
+    if (view.len >= sizeof(h)) memcpy(&h, view.ptr, sizeof(h));
+    const uint8_t *payload = (const uint8_t *)view.ptr + sizeof(h);
+    size_t stored = view.len - sizeof(h);
+    uint64_t start = now_ns();
+
+    if (h.magic != ZVALUE_MAGIC) {
+        /* not ours */
+    } else if (h.raw_len > capacity) {
+        *len_out = h.raw_len;
+        err = ENOBUFS;
+    } else if (h.codec == ZCODEC_RAW) {
+        if (stored == h.raw_len) {
+            memcpy(out, payload, stored);
+            rc = 0;
+        }
+    } else if (h.codec == ZCODEC_LZ4) {
+        rc = mw_lz4_decompress(payload, stored, out, h.raw_len) == (long)h.raw_len ? 0 : -1;
+    } else if (h.codec == ZCODEC_LZ4_DICT) {
+        pthread_mutex_lock(&z->lock);
+        zdict_t *d = get_dict(z, h.dict_id);
+        pthread_mutex_unlock(&z->lock);
+        rc = d && mw_lz4_decompress_dict(d->bytes, d->lz4.len, payload, stored, out, h.raw_len) ==
+                  (long)h.raw_len ? 0 : -1;
+    }
+    uint64_t spent = now_ns() - start;
+    faststorage_release_view(z->fs, &view);
+
+    pthread_mutex_lock(&z->lock);
+    z->stats.reads++;
+    if (h.codec != ZCODEC_RAW) z->stats.decompress_ns += spent;
+    pthread_mutex_unlock(&z->lock);
+
+    if (rc != 0) {
+        errno = err;
+        return -1;
+    }
+    *len_out = h.raw_len;
+    return 0;
+}
+
+ssize_t mw_zstore_size(mw_zstore_t *z, const char *key) {
+    FastStorageView view;
+    if (faststorage_get_view(z->fs, key, &view) != 0) {
+        errno = ENOENT;
+        return -1;
+    }
+    zvalue_header_t h = { 0 };
+    if (view.len >= sizeof(h)) memcpy(&h, view.ptr, sizeof(h));
+    faststorage_release_view(z->fs, &view);
+    if (h.magic != ZVALUE_MAGIC) {
+        errno = EBADMSG;
+        return -1;
+    }
+    return (ssize_t)h.raw_len;
+}
+
+void mw_zstore_stats(mw_zstore_t *z, mw_compress_stats_t *out) {
+    pthread_mutex_lock(&z->lock);
+    *out = z->stats;
+    pthread_mutex_unlock(&z->lock);
+}
+
+void mw_zstore_close(mw_zstore_t *z) {
+    if (!z) return;
+    for (uint32_t i = 0; i <= z->group_mask; i++) {
+        free(z->groups[i].latest);
+    }
+    for (uint32_t i = 0; i <= z->dict_mask; i++) {
+        if (!z->dicts[i]) continue;
+        free(z->dicts[i]->bytes);
+        free(z->dicts[i]);
+    }
+    free(z->groups);
+    free(z->dicts);
+    pthread_mutex_destroy(&z->lock);
+    free(z);
+}
@@ -3,6 +3,17 @@
  * 
  * This is a simplified version that implements the unified API
  * without Python dependencies. Full-featured version is in memwatch.c
+ *
+ * The worker blocks on an eventfd doorbell rung by the signal handler and
+ * drains the whole ring per wakeup - it never sleeps between events.
+ *
+ * Backends (memwatch_init_backend / $MEMWATCH_BACKEND): mprotect records
+ * SIGSEGVs on pages the caller protects; uffd write-protects watched pages
+ * and services faults on its own thread; soft-dirty scans pagemap from the
+ * worker. Both alternatives leave SIGSEGV to the host runtime.
+ *
+ * With $MEMWATCH_STATS set, stage latencies and per-region/page counts go
+ * to /memwatch-stats-<name> for `memwatch top` and `memwatch metrics`.
  */
 
 #include <signal.h>
@@ -17,19 +28,30 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <poll.h>
 
+#include "memwatch_backend.h"
+#include "memwatch_stats.h"
 #include "memwatch_unified.h"
+#include "memwatch_wakeup.h"
 
 #define RING_CAPACITY 65536
 #define PAGE_SIZE 4096
 #define PREVIEW_SIZE 256
 #define MAX_REGIONS 4096
+#define IDLE_WAIT_MS 1000  /* upper bound on a blocked wait, shutdown also rings */
+#define SOFT_DIRTY_SCAN_MS 20
+#define UFFD_READ_BATCH 64
+#define STATS_PUBLISH_MS 100
 
 /* Ring entry */
 typedef struct {
     uintptr_t page_start;
+    uintptr_t fault_addr;   /* 0 when the backend only knows the page */
     uint32_t region_id;
     uint64_t timestamp_ns;
+    uint64_t enqueued_ns;   /* monotonic, for queue wait */
+    atomic_bool ready;  /* set by the producer once the slot is filled */
 } PageEvent;
 
 /* Tracked region */
@@ -48,6 +70,8 @@ static struct {
     PageEvent *ring;
     atomic_uint ring_head;
     atomic_uint ring_tail;
+    atomic_uint ring_drops;
+    mw_wakeup_t wakeup;
     
     TrackedRegion regions[MAX_REGIONS];
     uint32_t next_region_id;
@@ -61,39 +85,186 @@ static struct {
     void *callback_ctx;
     pthread_mutex_t callback_mutex;
     
+    /* Write detection */
+    mw_backend_kind_t backend;
+    mw_uffd_t uffd;
+    pthread_t uffd_thread;
+    mw_wakeup_t uffd_stop;
+    mw_soft_dirty_t soft_dirty;   /* worker-private */
+    
+    mw_stats_t stats;             /* stage latencies, hot regions and pages */
 } g_state = {0};
 
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* Reserve a slot (multi-producer) and record a page - ASYNC-SIGNAL-SAFE */
+static bool ring_push(uintptr_t addr, bool exact) {
+    unsigned head = atomic_load(&g_state.ring_head);
+    do {
+        if (head - atomic_load(&g_state.ring_tail) >= RING_CAPACITY) {
+            atomic_fetch_add(&g_state.ring_drops, 1);
+            return false;
+        }
+    } while (!atomic_compare_exchange_weak(&g_state.ring_head, &head, head + 1));
+    
+    PageEvent *evt = &g_state.ring[head % RING_CAPACITY];
+    evt->page_start = addr & ~(uintptr_t)(PAGE_SIZE - 1);
+    evt->fault_addr = exact ? addr : 0;
+    evt->timestamp_ns = (uint64_t)time(NULL) * 1000000000ULL;
+    evt->enqueued_ns = monotonic_ns();
+    atomic_store_explicit(&evt->ready, true, memory_order_release);
+    return true;
+}
+
 /* Signal handler */
 static void sigsegv_handler(int sig, siginfo_t *info, void *uctx) {
     (void)sig;
-    (void)info;
     (void)uctx;
+    uint64_t entered_ns = monotonic_ns();
     
-    /* Just record in ring and continue */
-    unsigned head = atomic_load(&g_state.ring_head);
-    if (head + 1 < RING_CAPACITY) {
-        g_state.ring[head].timestamp_ns = (uint64_t)time(NULL) * 1000000000ULL;
-        atomic_store(&g_state.ring_head, head + 1);
+    /* Record, then ring the doorbell (also when full, so the worker drains) */
+    ring_push((uintptr_t)(info ? info->si_addr : NULL), true);
+    mw_wakeup_signal(&g_state.wakeup);
+    mw_stats_record(&g_state.stats, MW_STAGE_ENQUEUE, monotonic_ns() - entered_ns);
+}
+
+/* uffd fault thread: record the page, then release it - this wakes the writer */
+static void *uffd_thread_fn(void *arg) {
+    (void)arg;
+    
+    mw_uffd_fault_t faults[UFFD_READ_BATCH];
+    struct pollfd fds[2] = {
+        { .fd = g_state.uffd.fd, .events = POLLIN, .revents = 0 },
+        { .fd = g_state.uffd_stop.fd, .events = POLLIN, .revents = 0 },
+    };
+    
+    for (;;) {
+        if (poll(fds, 2, -1) < 0 && errno != EINTR) break;
+        if (fds[1].revents & POLLIN) break;
+        
+        int n = mw_uffd_read(&g_state.uffd, faults, UFFD_READ_BATCH);
+        if (n < 0) break;
+        uint64_t read_ns = monotonic_ns();
+        
+        for (int i = 0; i < n; i++) {
+            uintptr_t page = faults[i].address & ~(uintptr_t)(PAGE_SIZE - 1);
+            if (ring_push(faults[i].address, true)) {
+                mw_uffd_protect(&g_state.uffd, page, PAGE_SIZE, false);
+                mw_stats_record(&g_state.stats, MW_STAGE_ENQUEUE, monotonic_ns() - read_ns);
+            } else {
+                mw_uffd_wake(&g_state.uffd, page, PAGE_SIZE);  /* retried once drained */
+            }
+        }
+        if (n > 0) {
+            mw_wakeup_signal(&g_state.wakeup);
+        }
+    }
+    
+    return NULL;
+}
+
+/* Page-aligned span of a region */
+static void region_pages(const TrackedRegion *region, uintptr_t *start, size_t *len) {
+    uintptr_t first = region->addr & ~(uintptr_t)(PAGE_SIZE - 1);
+    uintptr_t end = (region->addr + region->size + PAGE_SIZE - 1) & ~(uintptr_t)(PAGE_SIZE - 1);
+    *start = first;
+    *len = end - first;
+}
+
+/* True if another active region still covers the page; caller holds regions_mutex */
+static bool page_still_watched(uintptr_t page, const TrackedRegion *except) {
+    for (int i = 0; i < MAX_REGIONS; i++) {
+        const TrackedRegion *region = &g_state.regions[i];
+        if (region != except && region->active &&
+            region->addr < page + PAGE_SIZE && region->addr + region->size > page) {
+            return true;
+        }
     }
+    return false;
+}
+
+/* Soft-dirty: queue every dirty page of every region, then clear the bits */
+static void soft_dirty_page(uintptr_t page_start, void *ctx) {
+    (void)ctx;
+    ring_push(page_start, false);
+}
+
+static void soft_dirty_scan(void) {
+    pthread_mutex_lock(&g_state.regions_mutex);
+    for (int i = 0; i < MAX_REGIONS; i++) {
+        TrackedRegion *region = &g_state.regions[i];
+        if (!region->active || region->size == 0) continue;
+        
+        uintptr_t start;
+        size_t len;
+        region_pages(region, &start, &len);
+        mw_soft_dirty_scan(&g_state.soft_dirty, start, len / PAGE_SIZE, soft_dirty_page, NULL);
+    }
+    mw_soft_dirty_clear(&g_state.soft_dirty);
+    pthread_mutex_unlock(&g_state.regions_mutex);
+}
+
+/* Gauges for the stats page; the counts it keeps itself are left alone */
+static void publish_stats(void) {
+    uint64_t regions = 0, pages = 0;
+    pthread_mutex_lock(&g_state.regions_mutex);
+    for (int i = 0; i < MAX_REGIONS; i++) {
+        if (g_state.regions[i].active) {
+            uintptr_t start;
+            size_t len;
+            region_pages(&g_state.regions[i], &start, &len);
+            regions++;
+            pages += len / PAGE_SIZE;
+        }
+    }
+    pthread_mutex_unlock(&g_state.regions_mutex);
+    
+    mw_stats_counters_t gauges = {
+        .tracked_regions = regions,
+        .tracked_pages = pages,
+        .ring_used = atomic_load(&g_state.ring_head) - atomic_load(&g_state.ring_tail),
+        .ring_capacity = RING_CAPACITY,
+        .dropped_events = atomic_load(&g_state.ring_drops),
+        .native_memory_bytes = RING_CAPACITY * sizeof(PageEvent) + sizeof(g_state),
+        .worker_wakeups = atomic_load(&g_state.wakeup.wakeups),
+    };
+    mw_stats_publish(&g_state.stats, &gauges);
 }
 
 /* Worker thread */
 static void* worker_thread_fn(void *arg) {
     (void)arg;
+    uint64_t last_publish_ns = monotonic_ns();
     
     while (atomic_load(&g_state.worker_running)) {
         unsigned tail = atomic_load(&g_state.ring_tail);
-        unsigned head = atomic_load(&g_state.ring_head);
         
-        if (tail < head) {
-            PageEvent *evt = &g_state.ring[tail];
+        /* Drain everything published so far in one pass */
+        for (;;) {
+            PageEvent *evt = &g_state.ring[tail % RING_CAPACITY];
+            if (!atomic_load_explicit(&evt->ready, memory_order_acquire)) {
+                break;
+            }
+            mw_stats_record(&g_state.stats, MW_STAGE_QUEUE_WAIT, monotonic_ns() - evt->enqueued_ns);
             
-            /* Find region and trigger callback */
+            /* Find regions on the faulting page and trigger callbacks */
+            uint64_t changes = 0;
             for (int i = 0; i < MAX_REGIONS; i++) {
-                if (g_state.regions[i].active && 
-                    g_state.regions[i].region_id == evt->region_id) {
-                    
-                    TrackedRegion *region = &g_state.regions[i];
+                TrackedRegion *region = &g_state.regions[i];
+                if (region->active &&
+                    region->addr < evt->page_start + PAGE_SIZE &&
+                    region->addr + region->size > evt->page_start) {
+                    /* No diff here: a fault outside the region's bytes is a false one */
+                    bool hit = evt->fault_addr == 0 ||
+                               (evt->fault_addr >= region->addr &&
+                                evt->fault_addr < region->addr + region->size);
+                    mw_stats_count_region(&g_state.stats, region->region_id, 0, region->addr,
+                                          region->size, region->name, hit, 0);
+                    changes += hit;
                     
                     /* Create event */
                     memwatch_change_event_t event = {
@@ -110,18 +281,50 @@ static void* worker_thread_fn(void *arg) {
                     
                     pthread_mutex_lock(&g_state.callback_mutex);
                     if (g_state.callback) {
+                        uint64_t called_ns = monotonic_ns();
                         g_state.callback(&event, g_state.callback_ctx);
+                        mw_stats_record(&g_state.stats, MW_STAGE_CALLBACK, monotonic_ns() - called_ns);
                     }
                     pthread_mutex_unlock(&g_state.callback_mutex);
-                    
-                    break;
                 }
             }
+            mw_stats_count_page(&g_state.stats, evt->page_start, 1, changes);
+            
+            /* uffd: the fault thread released the page, arm it for the next write */
+            if (g_state.backend == MW_BACKEND_UFFD_WP) {
+                pthread_mutex_lock(&g_state.regions_mutex);
+                if (page_still_watched(evt->page_start, NULL)) {
+                    mw_uffd_protect(&g_state.uffd, evt->page_start, PAGE_SIZE, true);
+                }
+                pthread_mutex_unlock(&g_state.regions_mutex);
+            }
             
-            atomic_store(&g_state.ring_tail, tail + 1);
+            atomic_store_explicit(&evt->ready, false, memory_order_relaxed);
+            tail++;
+            atomic_store(&g_state.ring_tail, tail);
+        }
+        
+        if (g_state.stats.shared && monotonic_ns() - last_publish_ns >= STATS_PUBLISH_MS * 1000000ULL) {
+            publish_stats();
+            last_publish_ns = monotonic_ns();
         }
         
-        usleep(10000);  /* 10ms */
+        /* Ring empty - block until the handler (or shutdown) rings */
+        mw_wakeup_prepare(&g_state.wakeup);
+        if (atomic_load_explicit(&g_state.ring[tail % RING_CAPACITY].ready, memory_order_acquire) ||
+            !atomic_load(&g_state.worker_running)) {
+            mw_wakeup_cancel(&g_state.wakeup);
+            continue;
+        }
+        if (g_state.backend == MW_BACKEND_SOFT_DIRTY) {
+            /* Nothing rings for soft-dirty: the timeout is the scan period */
+            mw_wakeup_wait(&g_state.wakeup, SOFT_DIRTY_SCAN_MS);
+            if (atomic_load(&g_state.worker_running)) {
+                soft_dirty_scan();
+            }
+        } else {
+            mw_wakeup_wait(&g_state.wakeup, g_state.stats.shared ? STATS_PUBLISH_MS : IDLE_WAIT_MS);
+        }
     }
     
     return NULL;
@@ -130,14 +333,80 @@ static void* worker_thread_fn(void *arg) {
 /* API Implementation */
 
 int memwatch_init(void) {
+    return memwatch_init_backend(NULL);
+}
+
+/* Open the kernel side of the selected backend */
+static int backend_open(void) {
+    g_state.uffd.fd = -1;
+    g_state.uffd_stop.fd = -1;
+    g_state.soft_dirty.pagemap_fd = -1;
+    g_state.soft_dirty.clear_refs_fd = -1;
+    
+    switch (g_state.backend) {
+    case MW_BACKEND_UFFD_WP:
+        if (mw_uffd_open(&g_state.uffd) != 0) return -1;
+        if (mw_wakeup_init(&g_state.uffd_stop) != 0 ||
+            pthread_create(&g_state.uffd_thread, NULL, uffd_thread_fn, NULL) != 0) {
+            if (g_state.uffd_stop.fd >= 0) mw_wakeup_destroy(&g_state.uffd_stop);
+            g_state.uffd_stop.fd = -1;
+            mw_uffd_close(&g_state.uffd);
+            return -1;
+        }
+        return 0;
+    case MW_BACKEND_SOFT_DIRTY:
+        return mw_soft_dirty_open(&g_state.soft_dirty);
+    default:
+        return 0;
+    }
+}
+
+static void backend_close(void) {
+    if (g_state.backend == MW_BACKEND_UFFD_WP) {
+        mw_wakeup_notify(&g_state.uffd_stop);
+        pthread_join(g_state.uffd_thread, NULL);
+        mw_wakeup_destroy(&g_state.uffd_stop);
+        mw_uffd_close(&g_state.uffd);
+    } else if (g_state.backend == MW_BACKEND_SOFT_DIRTY) {
+        mw_soft_dirty_close(&g_state.soft_dirty);
+    }
+}
+
+int memwatch_init_backend(const char *backend) {
     if (g_state.ring) {
         return 0;  /* Already initialized */
     }
     
+    if (!backend) {
+        backend = getenv("MEMWATCH_BACKEND");
+    }
+    if (mw_backend_parse(backend, &g_state.backend) != 0) {
+        return MEMWATCH_ERR_BACKEND;
+    }
+    
     g_state.ring = calloc(RING_CAPACITY, sizeof(PageEvent));
     if (!g_state.ring) {
         return -1;
     }
+    if (mw_wakeup_init(&g_state.wakeup) != 0) {
+        free(g_state.ring);
+        g_state.ring = NULL;
+        return -1;
+    }
+    if (backend_open() != 0) {
+        mw_wakeup_destroy(&g_state.wakeup);
+        free(g_state.ring);
+        g_state.ring = NULL;
+        return MEMWATCH_ERR_BACKEND;
+    }
+    
+    /* A taken or invalid $MEMWATCH_STATS name only costs the shared page */
+    const char *stats_name = getenv("MEMWATCH_STATS");
+    if (mw_stats_open(&g_state.stats, stats_name && *stats_name ? stats_name : NULL,
+                      "minimal", mw_backend_name(g_state.backend)) != 0) {
+        fprintf(stderr, "memwatch: stats page '%s': %s\n", stats_name, strerror(errno));
+        mw_stats_open(&g_state.stats, NULL, "minimal", mw_backend_name(g_state.backend));
+    }
     
     pthread_mutex_init(&g_state.regions_mutex, NULL);
     pthread_mutex_init(&g_state.callback_mutex, NULL);
@@ -145,16 +414,22 @@ int memwatch_init(void) {
     atomic_store(&g_state.worker_running, true);
     pthread_create(&g_state.worker_thread, NULL, worker_thread_fn, NULL);
     
-    /* Install signal handler */
-    struct sigaction sa = {0};
-    sa.sa_sigaction = sigsegv_handler;
-    sigemptyset(&sa.sa_mask);
-    sa.sa_flags = SA_SIGINFO;
-    sigaction(SIGSEGV, &sa, NULL);
+    /* Install signal handler - only mprotect reports writes as SIGSEGV */
+    if (g_state.backend == MW_BACKEND_MPROTECT) {
+        struct sigaction sa = {0};
+        sa.sa_sigaction = sigsegv_handler;
+        sigemptyset(&sa.sa_mask);
+        sa.sa_flags = SA_SIGINFO;
+        sigaction(SIGSEGV, &sa, NULL);
+    }
     
     return 0;
 }
 
+const char *memwatch_backend(void) {
+    return mw_backend_name(g_state.backend);
+}
+
 void memwatch_shutdown(void) {
     if (!g_state.ring) {
         return;
@@ -162,17 +437,22 @@ void memwatch_shutdown(void) {
     
     atomic_store(&g_state.shutdown_requested, true);
     atomic_store(&g_state.worker_running, false);
+    mw_wakeup_notify(&g_state.wakeup);
     
     pthread_join(g_state.worker_thread, NULL);
+    mw_wakeup_destroy(&g_state.wakeup);
     
-    free(g_state.ring);
-    g_state.ring = NULL;
-    
+    /* Release every page before the fault thread goes away */
     for (int i = 0; i < MAX_REGIONS; i++) {
-        if (g_state.regions[i].last_snapshot) {
-            free(g_state.regions[i].last_snapshot);
+        if (g_state.regions[i].active) {
+            memwatch_unwatch(g_state.regions[i].region_id);
         }
     }
+    backend_close();
+    mw_stats_close(&g_state.stats);
+    
+    free(g_state.ring);
+    g_state.ring = NULL;
     
     pthread_mutex_destroy(&g_state.regions_mutex);
     pthread_mutex_destroy(&g_state.callback_mutex);
@@ -195,8 +475,18 @@ memwatch_region_id memwatch_watch(uint64_t addr, size_t size,
             g_state.regions[i].name = name;
             g_state.regions[i].region_id = region_id;
             g_state.regions[i].user_data = user_data;
+            mw_stats_forget_region(&g_state.stats, region_id);
             g_state.regions[i].last_snapshot = malloc(size < 256 ? size : 256);
             g_state.regions[i].active = true;
+            
+            if (g_state.backend == MW_BACKEND_UFFD_WP && size > 0) {
+                /* Already-registered pages (shared with a region) fail with EBUSY */
+                uintptr_t start;
+                size_t len;
+                region_pages(&g_state.regions[i], &start, &len);
+                mw_uffd_register(&g_state.uffd, start, len);
+                mw_uffd_protect(&g_state.uffd, start, len, true);
+            }
             break;
         }
     }
@@ -206,12 +496,101 @@ memwatch_region_id memwatch_watch(uint64_t addr, size_t size,
     return region_id;
 }
 
+typedef struct {
+    uintptr_t start;
+    size_t len;
+} PageSpan;
+
+static int compare_span(const void *a, const void *b) {
+    const PageSpan *x = a, *y = b;
+    return x->start < y->start ? -1 : x->start > y->start;
+}
+
+int memwatch_watch_batch(const memwatch_watch_spec_t *specs, size_t count,
+                         memwatch_region_id *out_ids) {
+    if (!g_state.ring) {
+        return MEMWATCH_ERR_NOT_INIT;
+    }
+    
+    /* Only uffd protects pages here; collect spans to merge them */
+    PageSpan *spans = NULL;
+    if (g_state.backend == MW_BACKEND_UFFD_WP && count > 0) {
+        spans = malloc(count * sizeof(PageSpan));
+        if (!spans) return MEMWATCH_ERR_NO_MEMORY;
+    }
+    size_t nspans = 0;
+    int watched = 0;
+    
+    pthread_mutex_lock(&g_state.regions_mutex);
+    
+    int slot = 0;
+    for (size_t k = 0; k < count; k++) {
+        while (slot < MAX_REGIONS && g_state.regions[slot].active) slot++;
+        if (slot == MAX_REGIONS) {
+            out_ids[k] = 0;
+            continue;
+        }
+        
+        TrackedRegion *region = &g_state.regions[slot];
+        region->addr = specs[k].addr;
+        region->size = specs[k].size;
+        region->name = specs[k].name;
+        region->region_id = (uint32_t)slot + 1;
+        mw_stats_forget_region(&g_state.stats, region->region_id);
+        region->user_data = specs[k].user_data;
+        region->last_snapshot = malloc(region->size < 256 ? region->size : 256);
+        region->active = true;
+        out_ids[k] = region->region_id;
+        watched++;
+        
+        if (spans && region->size > 0) {
+            region_pages(region, &spans[nspans].start, &spans[nspans].len);
+            nspans++;
+        }
+    }
+    
+    /* One register + protect per run of overlapping or adjacent pages */
+    if (nspans > 0) {
+        qsort(spans, nspans, sizeof(PageSpan), compare_span);
+        size_t run = 0;
+        for (size_t i = 1; i <= nspans; i++) {
+            if (i < nspans && spans[i].start <= spans[run].start + spans[run].len) {
+                uintptr_t end = spans[i].start + spans[i].len;
+                if (end > spans[run].start + spans[run].len) {
+                    spans[run].len = end - spans[run].start;
+                }
+                continue;
+            }
+            mw_uffd_register(&g_state.uffd, spans[run].start, spans[run].len);
+            mw_uffd_protect(&g_state.uffd, spans[run].start, spans[run].len, true);
+            run = i;
+        }
+    }
+    
+    pthread_mutex_unlock(&g_state.regions_mutex);
+    
+    free(spans);
+    return watched;
+}
+
 bool memwatch_unwatch(memwatch_region_id region_id) {
     pthread_mutex_lock(&g_state.regions_mutex);
     
     for (int i = 0; i < MAX_REGIONS; i++) {
         if (g_state.regions[i].active && g_state.regions[i].region_id == region_id) {
             g_state.regions[i].active = false;
+            
+            if (g_state.backend == MW_BACKEND_UFFD_WP && g_state.regions[i].size > 0) {
+                uintptr_t start;
+                size_t len;
+                region_pages(&g_state.regions[i], &start, &len);
+                for (uintptr_t page = start; page < start + len; page += PAGE_SIZE) {
+                    if (!page_still_watched(page, NULL)) {
+                        mw_uffd_protect(&g_state.uffd, page, PAGE_SIZE, false);
+                        mw_uffd_unregister(&g_state.uffd, page, PAGE_SIZE);
+                    }
+                }
+            }
             if (g_state.regions[i].last_snapshot) {
                 free(g_state.regions[i].last_snapshot);
                 g_state.regions[i].last_snapshot = NULL;
@@ -253,6 +632,14 @@ int memwatch_get_stats(memwatch_stats_t *out_stats) {
     pthread_mutex_unlock(&g_state.regions_mutex);
     
     out_stats->total_events = atomic_load(&g_state.ring_head);
+    out_stats->ring_write_count = atomic_load(&g_state.ring_head);
+    out_stats->ring_drop_count = atomic_load(&g_state.ring_drops);
     
     return 0;
-}
\ No newline at end of file
+}
+
+void memwatch_record_stage(int stage, uint64_t ns) {
+    if (stage >= 0 && stage < MW_STAGE_COUNT) {
+        mw_stats_record(&g_state.stats, (mw_stage_t)stage, ns);
+    }
+}
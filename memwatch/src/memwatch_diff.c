@@ -0,0 +1,322 @@
+/*
+ * memwatch_diff.c - Shared snapshot comparison kernels
+ *
+ * A kernel answers two questions about whole 64-byte lines: where the
+ * next changed line starts (find) and where the run of changed lines
+ * beginning there ends (span). Unchanged memory is the common case, so
+ * find is the hot loop: the vector kernels XOR a full line per iteration
+ * and branch once per line, four lines at a time. A trailing partial
+ * line is compared with memcmp.
+ *
+ * Kernels are compiled with per-function target attributes, so no special
+ * compiler flags are needed and the library still runs on older CPUs.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "memwatch_diff.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MW_DIFF_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__)
+#define MW_DIFF_ARM64 1
+#include <arm_neon.h>
+#endif
+
+typedef size_t (*line_fn)(const uint8_t *a, const uint8_t *b, size_t nlines);
+
+typedef struct {
+    const char *name;
+    line_fn find;                           /* First differing line, or nlines */
+    line_fn span;                           /* First equal line, or nlines */
+} diff_kernel_t;
+
+/* ============================================================================
+ * Scalar kernel
+ * ============================================================================ */
+
+static inline int line_differs_scalar(const uint8_t *a, const uint8_t *b) {
+    uint64_t x[8], y[8];
+    memcpy(x, a, MW_DIFF_LINE);
+    memcpy(y, b, MW_DIFF_LINE);
+    uint64_t d = 0;
+    for (int i = 0; i < 8; i++) d |= x[i] ^ y[i];
+    return d != 0;
+}
+
+static size_t find_scalar(const uint8_t *a, const uint8_t *b, size_t nlines) {
+    for (size_t i = 0; i < nlines; i++) {
+        if (line_differs_scalar(a + i * MW_DIFF_LINE, b + i * MW_DIFF_LINE)) return i;
+    }
+    return nlines;
+}
+
+static size_t span_scalar(const uint8_t *a, const uint8_t *b, size_t nlines) {
+    for (size_t i = 0; i < nlines; i++) {
+        if (!line_differs_scalar(a + i * MW_DIFF_LINE, b + i * MW_DIFF_LINE)) return i;
+    }
+    return nlines;
+}
+
+static const diff_kernel_t kernel_scalar = { "scalar", find_scalar, span_scalar };
+
+/* ============================================================================
+ * x86 kernels
+ * ============================================================================ */
+
+#ifdef MW_DIFF_X86
+
+static inline int line_differs_sse2(const uint8_t *a, const uint8_t *b) {
+    __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)a), _mm_loadu_si128((const __m128i *)b));
+    for (int i = 1; i < 4; i++) {
+        eq = _mm_and_si128(eq, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)a + i),
+                                              _mm_loadu_si128((const __m128i *)b + i)));
+    }
+    return _mm_movemask_epi8(eq) != 0xFFFF;
+}
+
+static size_t find_sse2(const uint8_t *a, const uint8_t *b, size_t nlines) {
+    for (size_t i = 0; i < nlines; i++) {
+        if (line_differs_sse2(a + i * MW_DIFF_LINE, b + i * MW_DIFF_LINE)) return i;
+    }
+    return nlines;
+}
+
+static size_t span_sse2(const uint8_t *a, const uint8_t *b, size_t nlines) {
+    for (size_t i = 0; i < nlines; i++) {
+        if (!line_differs_sse2(a + i * MW_DIFF_LINE, b + i * MW_DIFF_LINE)) return i;
+    }
+    return nlines;
+}
+
+__attribute__((target("avx2")))
+static inline __m256i line_xor_avx2(const uint8_t *a, const uint8_t *b) {
+    __m256i x0 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)a), _mm256_loadu_si256((const __m256i *)b));
+    __m256i x1 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)a + 1),
+                                  _mm256_loadu_si256((const __m256i *)b + 1));
+    return _mm256_or_si256(x0, x1);
+}
+
+__attribute__((target("avx2")))
+static size_t find_avx2(const uint8_t *a, const uint8_t *b, size_t nlines) {
+    size_t i = 0;
+    for (; i + 4 <= nlines; i += 4) {
+        const uint8_t *p = a + i * MW_DIFF_LINE;
+        const uint8_t *q = b + i * MW_DIFF_LINE;
+        __m256i x = _mm256_or_si256(_mm256_or_si256(line_xor_avx2(p, q), line_xor_avx2(p + 64, q + 64)),
+                                    _mm256_or_si256(line_xor_avx2(p + 128, q + 128),
+                                                    line_xor_avx2(p + 192, q + 192)));
+        if (!_mm256_testz_si256(x, x)) break;
+    }
+    for (; i < nlines; i++) {
+        __m256i x = line_xor_avx2(a + i * MW_DIFF_LINE, b + i * MW_DIFF_LINE);
+        if (!_mm256_testz_si256(x, x)) return i;
+    }
+    return nlines;
+}
+
+__attribute__((target("avx2")))
+static size_t span_avx2(const uint8_t *a, const uint8_t *b, size_t nlines) {
+    for (size_t i = 0; i < nlines; i++) {
+        __m256i x = line_xor_avx2(a + i * MW_DIFF_LINE, b + i * MW_DIFF_LINE);
+        if (_mm256_testz_si256(x, x)) return i;
+    }
+    return nlines;
+}
+
+__attribute__((target("avx512f")))
+static inline __mmask8 line_mask_avx512(const uint8_t *a, const uint8_t *b) {
+    return _mm512_cmpneq_epi64_mask(_mm512_loadu_si512(a), _mm512_loadu_si512(b));
+}
+
+__attribute__((target("avx512f")))
+static size_t find_avx512(const uint8_t *a, const uint8_t *b, size_t nlines) {
+    size_t i = 0;
+    for (; i + 4 <= nlines; i += 4) {
+        const uint8_t *p = a + i * MW_DIFF_LINE;
+        const uint8_t *q = b + i * MW_DIFF_LINE;
+        if (line_mask_avx512(p, q) | line_mask_avx512(p + 64, q + 64) |
+            line_mask_avx512(p + 128, q + 128) | line_mask_avx512(p + 192, q + 192)) {
+            break;
+        }
+    }
+    for (; i < nlines; i++) {
+        if (line_mask_avx512(a + i * MW_DIFF_LINE, b + i * MW_DIFF_LINE)) return i;
+    }
+    return nlines;
+}
+
+__attribute__((target("avx512f")))
+static size_t span_avx512(const uint8_t *a, const uint8_t *b, size_t nlines) {
+    for (size_t i = 0; i < nlines; i++) {
+        if (!line_mask_avx512(a + i * MW_DIFF_LINE, b + i * MW_DIFF_LINE)) return i;
+    }
+    return nlines;
+}
+
+static const diff_kernel_t kernel_sse2 = { "sse2", find_sse2, span_sse2 };
+static const diff_kernel_t kernel_avx2 = { "avx2", find_avx2, span_avx2 };
+static const diff_kernel_t kernel_avx512 = { "avx512", find_avx512, span_avx512 };
+
+#endif /* MW_DIFF_X86 */
+
+/* ============================================================================
+ * ARM64 kernel
+ * ============================================================================ */
+
+#ifdef MW_DIFF_ARM64
+
+static inline int line_differs_neon(const uint8_t *a, const uint8_t *b) {
+    uint8x16_t x = veorq_u8(vld1q_u8(a), vld1q_u8(b));
+    for (int i = 1; i < 4; i++) {
+        x = vorrq_u8(x, veorq_u8(vld1q_u8(a + 16 * i), vld1q_u8(b + 16 * i)));
+    }
+    return vmaxvq_u8(x) != 0;
+}
+
+static size_t find_neon(const uint8_t *a, const uint8_t *b, size_t nlines) {
+    for (size_t i = 0; i < nlines; i++) {
+        if (line_differs_neon(a + i * MW_DIFF_LINE, b + i * MW_DIFF_LINE)) return i;
+    }
+    return nlines;
+}
+
+static size_t span_neon(const uint8_t *a, const uint8_t *b, size_t nlines) {
+    for (size_t i = 0; i < nlines; i++) {
+        if (!line_differs_neon(a + i * MW_DIFF_LINE, b + i * MW_DIFF_LINE)) return i;
+    }
+    return nlines;
+}
+
+static const diff_kernel_t kernel_neon = { "neon", find_neon, span_neon };
+
+#endif /* MW_DIFF_ARM64 */
+
+/* ============================================================================
+ * Dispatch
+ * ============================================================================ */
+
+static _Atomic(const diff_kernel_t *) g_diff_kernel;
+static pthread_once_t g_init_once = PTHREAD_ONCE_INIT;
+
+static const diff_kernel_t *kernel_by_name(const char *name) {
+    if (strcmp(name, "scalar") == 0) return &kernel_scalar;
+#ifdef MW_DIFF_X86
+    __builtin_cpu_init();
+    if (strcmp(name, "sse2") == 0 && __builtin_cpu_supports("sse2")) return &kernel_sse2;
+    if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2")) return &kernel_avx2;
+    if (strcmp(name, "avx512") == 0 && __builtin_cpu_supports("avx512f")) return &kernel_avx512;
+#endif
+#ifdef MW_DIFF_ARM64
+    if (strcmp(name, "neon") == 0) return &kernel_neon;
+#endif
+    return NULL;
+}
+
+static void do_init(void) {
+    const diff_kernel_t *kernel = &kernel_scalar;
+
+#ifdef MW_DIFF_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        kernel = &kernel_avx512;
+    } else if (__builtin_cpu_supports("avx2")) {
+        kernel = &kernel_avx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        kernel = &kernel_sse2;
+    }
+#endif
+#ifdef MW_DIFF_ARM64
+    kernel = &kernel_neon;
+#endif
+
+    const char *forced = getenv("MEMWATCH_DIFF_KERNEL");
+    if (forced && kernel_by_name(forced)) {
+        kernel = kernel_by_name(forced);
+    }
+
+    atomic_store_explicit(&g_diff_kernel, kernel, memory_order_release);
+}
+
+void mw_diff_init(void) {
+    pthread_once(&g_init_once, do_init);
+}
+
+/* Select the kernel at load time so the first sample pays nothing */
+__attribute__((constructor))
+static void mw_diff_auto_init(void) {
+    mw_diff_init();
+}
+
+static inline const diff_kernel_t *current_kernel(void) {
+    const diff_kernel_t *k = atomic_load_explicit(&g_diff_kernel, memory_order_acquire);
+    if (__builtin_expect(k == NULL, 0)) {
+        mw_diff_init();
+        k = atomic_load_explicit(&g_diff_kernel, memory_order_acquire);
+    }
+    return k;
+}
+
+int mw_diff_set_kernel(const char *name) {
+    mw_diff_init();
+    const diff_kernel_t *k = name ? kernel_by_name(name) : NULL;
+    if (!k) return -1;
+    atomic_store_explicit(&g_diff_kernel, k, memory_order_release);
+    return 0;
+}
+
+const char *mw_diff_kernel_name(void) {
+    return current_kernel()->name;
+}
+
+/* ============================================================================
+ * Public entry point
+ * ============================================================================ */
+
+size_t mw_diff_ranges(const void *a, const void *b, size_t len,
+                      mw_diff_range_t *ranges, size_t max_ranges, size_t *scanned) {
+    const diff_kernel_t *k = current_kernel();
+    const uint8_t *pa = a;
+    const uint8_t *pb = b;
+    size_t nlines = len / MW_DIFF_LINE;
+    size_t tail = len % MW_DIFF_LINE;
+    size_t count = 0;
+    size_t line = 0;
+
+    while (count < max_ranges && line < nlines) {
+        line += k->find(pa + line * MW_DIFF_LINE, pb + line * MW_DIFF_LINE, nlines - line);
+        if (line == nlines) break;
+        size_t run = k->span(pa + line * MW_DIFF_LINE, pb + line * MW_DIFF_LINE, nlines - line);
+        if (run == 0) run = 1;                      /* Live memory changed back in between */
+        ranges[count].offset = line * MW_DIFF_LINE;
+        ranges[count].len = run * MW_DIFF_LINE;
+        count++;
+        line += run;
+    }
+
+    size_t done = line * MW_DIFF_LINE;
+    if (line == nlines && tail && memcmp(pa + done, pb + done, tail) != 0) {
+        if (count && ranges[count - 1].offset + ranges[count - 1].len == done) {
+            ranges[count - 1].len += tail;          /* Extend a run ending at the last line */
+            done = len;
+        } else if (count < max_ranges) {
+            ranges[count].offset = done;
+            ranges[count].len = tail;
+            count++;
+            done = len;
+        }
+    } else if (line == nlines) {
+        done = len;
+    }
+
+    if (scanned) *scanned = done;
+    return count;
+}
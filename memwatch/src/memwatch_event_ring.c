@@ -0,0 +1,361 @@
+/*
+ * memwatch_event_ring.c - Shared-memory event ring for external consumers
+ *
+ * head and tail are plain words in the shared mapping, updated with
+ * acquire/release atomics from both processes. Sleeping is negotiated
+ * through consumer_waiting: the consumer sets it, fences and rechecks head
+ * before blocking on the eventfd; the producer fences after publishing and
+ * rings only if the flag was set (and clears it), so no wakeup is lost and
+ * a consumer that keeps up costs no write() per event.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/eventfd.h>
+
+#include "memwatch_event_ring.h"
+
+#define DEFAULT_CAPACITY 65536
+#define MAX_NAME_LEN     40
+
+_Static_assert(sizeof(event_packed_t) == 64, "event_packed_t must stay 64 bytes");
+_Static_assert(sizeof(mw_ring_header_t) == MW_RING_HEADER_SIZE, "ring header layout changed");
+
+static int valid_name(const char *name) {
+    size_t len = name ? strlen(name) : 0;
+    if (len == 0 || len > MAX_NAME_LEN) return 0;
+    for (size_t i = 0; i < len; i++) {
+        char c = name[i];
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+              c == '_' || c == '.' || c == '-')) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Abstract socket "\0memwatch-ring-<name>"; returns the address length */
+static socklen_t doorbell_address(struct sockaddr_un *addr, const char *name) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    int n = snprintf(addr->sun_path + 1, sizeof(addr->sun_path) - 1, "memwatch-ring-%s", name);
+    return (socklen_t)(offsetof(struct sockaddr_un, sun_path) + 1 + n);
+}
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ULL + (uint64_t)ts.tv_nsec / 1000000ULL;
+}
+
+/* ============================================================================
+ * Producer
+ * ============================================================================ */
+
+/* Give each connecting consumer a copy of the eventfd */
+static void *doorbell_server(void *arg) {
+    mw_ring_t *ring = arg;
+    for (;;) {
+        int conn = accept4(ring->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (conn < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;                      /* listen socket shut down */
+        }
+        char byte = 'D';
+        struct iovec iov = { &byte, 1 };
+        union {
+            char buf[CMSG_SPACE(sizeof(int))];
+            struct cmsghdr align;
+        } control;
+        struct msghdr msg = { 0 };
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &ring->doorbell, sizeof(int));
+        sendmsg(conn, &msg, MSG_NOSIGNAL);
+        close(conn);
+    }
+    return NULL;
+}
+
+int mw_ring_create(mw_ring_t *ring, const char *name, size_t capacity) {
+    memset(ring, 0, sizeof(*ring));
+    ring->doorbell = -1;
+    ring->listen_fd = -1;
+    if (!valid_name(name)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (capacity == 0) capacity = DEFAULT_CAPACITY;
+    size_t slots = 1;
+    while (slots < capacity) slots <<= 1;
+
+    snprintf(ring->name, sizeof(ring->name), "/memwatch-%s", name);
+    ring->map_size = MW_RING_HEADER_SIZE + slots * sizeof(event_packed_t);
+
+    /* The doorbell socket name is the lock: only one producer per name */
+    ring->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (ring->listen_fd < 0) return -1;
+    struct sockaddr_un addr;
+    socklen_t addr_len = doorbell_address(&addr, name);
+    if (bind(ring->listen_fd, (struct sockaddr *)&addr, addr_len) != 0) {
+        int saved = errno == EADDRINUSE ? EEXIST : errno;
+        close(ring->listen_fd);
+        errno = saved;
+        return -1;
+    }
+    listen(ring->listen_fd, 8);
+
+    int fd = shm_open(ring->name, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) goto fail;
+    if (ftruncate(fd, (off_t)ring->map_size) != 0) {
+        close(fd);
+        goto fail_unlink;
+    }
+    void *map = mmap(NULL, ring->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) goto fail_unlink;
+    ring->hdr = map;
+    ring->slots = (event_packed_t *)((uint8_t *)map + MW_RING_HEADER_SIZE);
+
+    ring->hdr->version = MW_RING_VERSION;
+    ring->hdr->slot_size = sizeof(event_packed_t);
+    ring->hdr->capacity = slots;
+    ring->hdr->producer_pid = (uint32_t)getpid();
+    __atomic_store_n(&ring->hdr->magic, MW_RING_MAGIC, __ATOMIC_RELEASE);
+
+    ring->doorbell = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (ring->doorbell < 0) goto fail_unmap;
+    if (pthread_create(&ring->server, NULL, doorbell_server, ring) != 0) {
+        errno = EAGAIN;
+        goto fail_unmap;
+    }
+    ring->owner = true;
+    return 0;
+
+fail_unmap:
+    {
+        int saved = errno;
+        if (ring->doorbell >= 0) close(ring->doorbell);
+        munmap(ring->hdr, ring->map_size);
+        errno = saved;
+    }
+fail_unlink:
+    {
+        int saved = errno;
+        shm_unlink(ring->name);
+        errno = saved;
+    }
+fail:
+    {
+        int saved = errno;
+        close(ring->listen_fd);
+        memset(ring, 0, sizeof(*ring));
+        errno = saved;
+    }
+    return -1;
+}
+
+int mw_ring_publish(mw_ring_t *ring, const event_packed_t *event) {
+    mw_ring_header_t *hdr = ring->hdr;
+    uint64_t head = hdr->head;          /* only this producer writes it */
+    uint64_t tail = __atomic_load_n(&hdr->tail, __ATOMIC_ACQUIRE);
+    if (head - tail >= hdr->capacity) {
+        __atomic_fetch_add(&hdr->dropped, 1, __ATOMIC_RELAXED);
+        return -1;
+    }
+
+    memcpy(&ring->slots[head & (hdr->capacity - 1)], event, sizeof(*event));
+    __atomic_store_n(&hdr->head, head + 1, __ATOMIC_RELEASE);
+
+    /* Pairs with the consumer's fence between setting the flag and rechecking head */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&hdr->consumer_waiting, __ATOMIC_RELAXED) &&
+        __atomic_exchange_n(&hdr->consumer_waiting, 0, __ATOMIC_ACQ_REL)) {
+        uint64_t one = 1;
+        ssize_t n = write(ring->doorbell, &one, sizeof(one));
+        (void)n;
+    }
+    return 0;
+}
+
+void mw_ring_destroy(mw_ring_t *ring) {
+    if (!ring->hdr || !ring->owner) return;
+
+    __atomic_store_n(&ring->hdr->closed, 1, __ATOMIC_RELEASE);
+    uint64_t one = 1;
+    ssize_t n = write(ring->doorbell, &one, sizeof(one));
+    (void)n;
+
+    shutdown(ring->listen_fd, SHUT_RDWR);   /* ends the accept() loop */
+    pthread_join(ring->server, NULL);
+    close(ring->listen_fd);
+    close(ring->doorbell);
+
+    /* Attached consumers keep their mapping until they detach */
+    shm_unlink(ring->name);
+    munmap(ring->hdr, ring->map_size);
+    memset(ring, 0, sizeof(*ring));
+}
+
+/* ============================================================================
+ * Consumer
+ * ============================================================================ */
+
+static int fetch_doorbell(const char *name) {
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock < 0) return -1;
+    struct sockaddr_un addr;
+    socklen_t addr_len = doorbell_address(&addr, name);
+    if (connect(sock, (struct sockaddr *)&addr, addr_len) != 0) {
+        int saved = errno;
+        close(sock);
+        errno = saved;
+        return -1;
+    }
+
+    char byte;
+    struct iovec iov = { &byte, 1 };
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg = { 0 };
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    int fd = -1;
+    if (recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) > 0) {
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+        }
+    }
+    close(sock);
+    if (fd < 0) errno = EPROTO;
+    return fd;
+}
+
+int mw_ring_attach(mw_ring_t *ring, const char *name) {
+    memset(ring, 0, sizeof(*ring));
+    ring->doorbell = -1;
+    ring->listen_fd = -1;
+    if (!valid_name(name)) {
+        errno = EINVAL;
+        return -1;
+    }
+    snprintf(ring->name, sizeof(ring->name), "/memwatch-%s", name);
+
+    int fd = shm_open(ring->name, O_RDWR | O_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < MW_RING_HEADER_SIZE) {
+        close(fd);
+        errno = EPROTO;
+        return -1;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+
+    mw_ring_header_t *hdr = map;
+    uint64_t capacity = hdr->capacity;
+    if (__atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) != MW_RING_MAGIC ||
+        hdr->version != MW_RING_VERSION || hdr->slot_size != sizeof(event_packed_t) ||
+        capacity == 0 || (capacity & (capacity - 1)) ||
+        MW_RING_HEADER_SIZE + capacity * sizeof(event_packed_t) > (uint64_t)st.st_size) {
+        munmap(map, (size_t)st.st_size);
+        errno = EPROTO;
+        return -1;
+    }
+
+    ring->doorbell = fetch_doorbell(name);
+    if (ring->doorbell < 0) {
+        int saved = errno;
+        munmap(map, (size_t)st.st_size);
+        errno = saved;
+        return -1;
+    }
+    ring->hdr = hdr;
+    ring->slots = (event_packed_t *)((uint8_t *)map + MW_RING_HEADER_SIZE);
+    ring->map_size = (size_t)st.st_size;
+    return 0;
+}
+
+int mw_ring_consume(mw_ring_t *ring, event_packed_t *out, int max, int timeout_ms) {
+    mw_ring_header_t *hdr = ring->hdr;
+    uint64_t deadline = timeout_ms > 0 ? now_ms() + (uint64_t)timeout_ms : 0;
+
+    for (;;) {
+        uint64_t tail = hdr->tail;      /* only this consumer writes it */
+        uint64_t head = __atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE);
+        if (head != tail) {
+            uint64_t n = head - tail;
+            if (n > (uint64_t)max) n = (uint64_t)max;
+            for (uint64_t i = 0; i < n; i++) {
+                memcpy(&out[i], &ring->slots[(tail + i) & (hdr->capacity - 1)], sizeof(*out));
+            }
+            __atomic_store_n(&hdr->tail, tail + n, __ATOMIC_RELEASE);
+            return (int)n;
+        }
+        if (__atomic_load_n(&hdr->closed, __ATOMIC_ACQUIRE)) {
+            if (__atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE) != tail) continue;
+            errno = EPIPE;
+            return -1;
+        }
+        if (timeout_ms == 0) return 0;
+
+        /* Announce the sleep, then recheck: the producer may have just published */
+        __atomic_store_n(&hdr->consumer_waiting, 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE) != tail ||
+            __atomic_load_n(&hdr->closed, __ATOMIC_ACQUIRE)) {
+            __atomic_store_n(&hdr->consumer_waiting, 0, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        int wait = -1;
+        if (timeout_ms > 0) {
+            uint64_t now = now_ms();
+            wait = now >= deadline ? 0 : (int)(deadline - now);
+        }
+        struct pollfd pfd = { ring->doorbell, POLLIN, 0 };
+        int rc = poll(&pfd, 1, wait);
+        __atomic_store_n(&hdr->consumer_waiting, 0, __ATOMIC_RELAXED);
+        if (rc > 0) {
+            uint64_t count;
+            ssize_t n = read(ring->doorbell, &count, sizeof(count));
+            (void)n;
+        } else if (rc == 0) {
+            if (__atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE) != tail) continue;
+            return 0;
+        } else if (errno != EINTR) {
+            return -1;
+        }
+    }
+}
+
+void mw_ring_detach(mw_ring_t *ring) {
+    if (!ring->hdr || ring->owner) return;
+    if (ring->doorbell >= 0) close(ring->doorbell);
+    munmap(ring->hdr, ring->map_size);
+    memset(ring, 0, sizeof(*ring));
+}
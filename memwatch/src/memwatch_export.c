@@ -0,0 +1,953 @@
+/*
+ * memwatch_export.c - Streaming binary event export to a remote collector
+ *
+ * Producers encode events into the open batch under one mutex; a full
+ * batch is sealed on the spot (LZ4, CRC-32C, header) into a frame, and
+ * the sender thread seals batches whose interval ran out. Frames wait in a
+ * FIFO until acknowledged: head ... next_send are in flight, next_send ...
+ * tail not yet sent. Only the sender thread frees frames or touches the
+ * socket, so a frame being sent without the lock cannot vanish.
+ *
+ * Once the FIFO holds max_queued_bytes, new frames are appended to the
+ * spill file instead, and keep going there until the sender has read the
+ * file back (into the FIFO, as room appears); that keeps frames in order.
+ * The spill file starts with the source id, so a later run that opens it
+ * resends the frames as the source that produced them.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <netdb.h>
+#include <sys/random.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "memwatch_export.h"
+#include "memwatch_lz4.h"
+#include "memwatch_hash.h"
+
+#define DEFAULT_BATCH_BYTES    (64 * 1024)
+#define DEFAULT_BATCH_INTERVAL 50            /* ms */
+#define DEFAULT_WINDOW         32
+#define DEFAULT_MAX_QUEUED     (16 * 1024 * 1024)
+#define DEFAULT_CLOSE_TIMEOUT  2000          /* ms */
+#define SOCKET_TIMEOUT_MS      10000
+#define HELLO_TIMEOUT_MS       2000
+#define ACK_POLL_MS            10
+#define IDLE_WAIT_MS           100
+#define BACKOFF_MIN_MS         50
+#define BACKOFF_MAX_MS         2000
+#define SPILL_MAGIC            0x5358574dU   /* "MWXS" */
+#define SPILL_VERSION          1
+#define EVENT_OVERHEAD         (6 * 10)      /* varint fields, worst case */
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t source_id;
+    uint8_t reserved[16];
+} spill_header_t;
+
+_Static_assert(sizeof(mw_frame_header_t) == 32, "mw_frame_header_t is on the wire");
+_Static_assert(sizeof(mw_export_hello_t) == 64, "mw_export_hello_t is on the wire");
+_Static_assert(sizeof(spill_header_t) == 32, "spill_header_t is on disk");
+
+typedef struct export_frame {
+    struct export_frame *next;
+    uint64_t seq;
+    uint32_t count;
+    bool sent;
+    size_t len;                   /* header + stored payload */
+    uint8_t data[];               /* as sent */
+} export_frame_t;
+
+struct mw_exporter {
+    mw_export_config_t config;
+    char endpoint[256];
+    char spill_path[PATH_MAX];
+    mw_export_hello_t hello;
+
+    pthread_mutex_t lock;
+    pthread_cond_t wake;          /* sender: work arrived or stop */
+    pthread_cond_t progress;      /* flushers: frames acknowledged or dropped */
+
+    /* Open batch */
+    uint8_t *batch;
+    size_t batch_used;
+    size_t batch_cap;
+    uint32_t batch_count;
+    uint64_t batch_prev_ts;
+    uint64_t batch_deadline_ns;
+    uint64_t next_seq;
+
+    /* Frames in memory, oldest first */
+    export_frame_t *head;
+    export_frame_t *tail;
+    export_frame_t *next_send;
+    uint32_t in_flight;
+    uint64_t acked_seq;
+
+    int spill_fd;
+    bool spilling;                /* new frames go to the spill file */
+    uint64_t spill_read;
+    uint64_t spill_write;
+
+    bool stop;
+    pthread_t sender;
+    int sock;                     /* sender thread only */
+    mw_export_stats_t stats;
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void timed_wait(pthread_cond_t *cond, pthread_mutex_t *lock, uint32_t ms) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec += ms / 1000;
+    ts.tv_nsec += (long)(ms % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    pthread_cond_timedwait(cond, lock, &ts);
+}
+
+static inline uint8_t *put_varint(uint8_t *p, uint64_t v) {
+    while (v >= 0x80) {
+        *p++ = (uint8_t)v | 0x80;
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static inline int get_varint(const uint8_t **pp, const uint8_t *end, uint64_t *out) {
+    uint64_t v = 0;
+    const uint8_t *p = *pp;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t b = *p++;
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *pp = p;
+            *out = v;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static inline uint64_t zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static int send_all(int fd, const void *data, size_t len) {
+    const uint8_t *p = data;
+    while (len) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int pwrite_all(int fd, const void *data, size_t len, uint64_t offset) {
+    const uint8_t *p = data;
+    while (len) {
+        ssize_t n = pwrite(fd, p, len, (off_t)offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return 0;
+}
+
+/* ============================================================================
+ * Endpoints
+ * ============================================================================ */
+
+static int split_tcp(const char *spec, char *host, size_t host_len, const char **port) {
+    const char *colon = strrchr(spec, ':');
+    if (!colon || colon[1] == '\0' || (size_t)(colon - spec) >= host_len) {
+        errno = EINVAL;
+        return -1;
+    }
+    memcpy(host, spec, (size_t)(colon - spec));
+    host[colon - spec] = '\0';
+    *port = colon + 1;
+    return 0;
+}
+
+static int unix_address(const char *path, struct sockaddr_un *addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (path[0] == '\0' || strlen(path) >= sizeof(addr->sun_path)) {
+        errno = EINVAL;
+        return -1;
+    }
+    strcpy(addr->sun_path, path);
+    return 0;
+}
+
+static int valid_endpoint(const char *endpoint) {
+    char host[256];
+    const char *port;
+    struct sockaddr_un addr;
+    if (!endpoint) return 0;
+    if (strncmp(endpoint, "unix:", 5) == 0) return unix_address(endpoint + 5, &addr) == 0;
+    if (strncmp(endpoint, "tcp:", 4) == 0) return split_tcp(endpoint + 4, host, sizeof(host), &port) == 0;
+    return 0;
+}
+
+static void set_timeouts(int fd) {
+    struct timeval tv = { .tv_sec = SOCKET_TIMEOUT_MS / 1000, .tv_usec = (SOCKET_TIMEOUT_MS % 1000) * 1000 };
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+}
+
+static int connect_endpoint(const char *endpoint) {
+    if (strncmp(endpoint, "unix:", 5) == 0) {
+        struct sockaddr_un addr;
+        if (unix_address(endpoint + 5, &addr) != 0) return -1;
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        set_timeouts(fd);
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    char host[256];
+    const char *port;
+    if (split_tcp(endpoint + 4, host, sizeof(host), &port) != 0) return -1;
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+    struct addrinfo *res;
+    if (getaddrinfo(host[0] ? host : NULL, port, &hints, &res) != 0) {
+        errno = EHOSTUNREACH;
+        return -1;
+    }
+    int fd = -1;
+    for (struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) continue;
+        set_timeouts(fd);
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            break;
+        }
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+int mw_export_listen(const char *endpoint) {
+    if (!valid_endpoint(endpoint)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (strncmp(endpoint, "unix:", 5) == 0) {
+        struct sockaddr_un addr;
+        unix_address(endpoint + 5, &addr);
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        unlink(addr.sun_path);
+        if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 128) != 0) {
+            int err = errno;
+            close(fd);
+            errno = err;
+            return -1;
+        }
+        return fd;
+    }
+
+    char host[256];
+    const char *port;
+    split_tcp(endpoint + 4, host, sizeof(host), &port);
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM, .ai_flags = AI_PASSIVE };
+    struct addrinfo *res;
+    if (getaddrinfo(host[0] && strcmp(host, "*") != 0 ? host : NULL, port, &hints, &res) != 0) {
+        errno = EADDRNOTAVAIL;
+        return -1;
+    }
+    int fd = -1, err = EADDRNOTAVAIL;
+    for (struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) continue;
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && listen(fd, 128) == 0) break;
+        err = errno;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    if (fd < 0) errno = err;
+    return fd;
+}
+
+/* ============================================================================
+ * Frame Queue (lock held)
+ * ============================================================================ */
+
+static void append_frame(mw_exporter_t *x, export_frame_t *f) {
+    f->next = NULL;
+    f->sent = false;
+    if (x->tail) x->tail->next = f;
+    else x->head = f;
+    x->tail = f;
+    if (!x->next_send) x->next_send = f;
+    x->stats.queued_bytes += f->len;
+    pthread_cond_signal(&x->wake);
+}
+
+static void enqueue_frame(mw_exporter_t *x, export_frame_t *f) {
+    if (!x->spilling && x->stats.queued_bytes + f->len <= x->config.max_queued_bytes) {
+        append_frame(x, f);
+        return;
+    }
+    if (x->spill_fd >= 0 && pwrite_all(x->spill_fd, f->data, f->len, x->spill_write) == 0) {
+        x->spill_write += f->len;
+        x->stats.spilled_bytes += f->len;
+        x->stats.frames_spilled++;
+        x->spilling = true;
+        free(f);
+        pthread_cond_signal(&x->wake);
+        return;
+    }
+    x->stats.frames_dropped++;
+    x->stats.events_dropped += f->count;
+    free(f);
+    pthread_cond_broadcast(&x->progress);
+}
+
+static void reset_spill(mw_exporter_t *x) {
+    if (ftruncate(x->spill_fd, sizeof(spill_header_t)) != 0) {
+        /* The header stays valid; stale frames get deduplicated */
+    }
+    x->spill_read = x->spill_write = sizeof(spill_header_t);
+    x->stats.spilled_bytes = 0;
+    x->spilling = false;
+    pthread_cond_broadcast(&x->progress);
+}
+
+/* Move spilled frames back into the queue while there is room */
+static void refill_from_spill(mw_exporter_t *x) {
+    while (x->spilling && x->stats.queued_bytes < x->config.max_queued_bytes / 2) {
+        if (x->spill_read >= x->spill_write) {
+            reset_spill(x);
+            return;
+        }
+        mw_frame_header_t h;
+        if (pread(x->spill_fd, &h, sizeof(h), (off_t)x->spill_read) != (ssize_t)sizeof(h) ||
+            mw_export_check_header(&h) != 0 || h.type != MW_FRAME_EVENTS ||
+            x->spill_read + sizeof(h) + h.stored_len > x->spill_write) {
+            reset_spill(x);
+            return;
+        }
+        size_t len = sizeof(h) + h.stored_len;
+        export_frame_t *f = malloc(sizeof(*f) + len);
+        if (!f) return;
+        if (pread(x->spill_fd, f->data, len, (off_t)x->spill_read) != (ssize_t)len) {
+            free(f);
+            reset_spill(x);
+            return;
+        }
+        x->spill_read += len;
+        x->stats.spilled_bytes -= len;
+        f->seq = h.seq;
+        f->count = h.count;
+        f->len = len;
+        if (f->seq <= x->acked_seq) {
+            x->stats.frames_acked++;
+            free(f);
+            continue;
+        }
+        append_frame(x, f);
+    }
+}
+
+/* Seal the open batch into a frame */
+static void seal_batch(mw_exporter_t *x) {
+    if (!x->batch_count) return;
+
+    size_t raw = x->batch_used;
+    size_t room = mw_lz4_bound(raw) > raw ? mw_lz4_bound(raw) : raw;
+    export_frame_t *f = malloc(sizeof(*f) + sizeof(mw_frame_header_t) + room);
+    if (!f) {
+        x->stats.frames_dropped++;
+        x->stats.events_dropped += x->batch_count;
+    } else {
+        uint8_t *payload = f->data + sizeof(mw_frame_header_t);
+        size_t stored = 0;
+        uint8_t codec = MW_CODEC_NONE;
+        if (!x->config.uncompressed && raw > 1) {
+            stored = mw_lz4_compress(x->batch, raw, payload, raw - 1);
+            if (stored) codec = MW_CODEC_LZ4;
+        }
+        if (!stored) {
+            memcpy(payload, x->batch, raw);
+            stored = raw;
+        }
+        mw_frame_header_t *h = (mw_frame_header_t *)f->data;
+        *h = (mw_frame_header_t){
+            .magic = MW_EXPORT_MAGIC,
+            .version = MW_EXPORT_VERSION,
+            .type = MW_FRAME_EVENTS,
+            .codec = codec,
+            .seq = x->next_seq++,
+            .count = x->batch_count,
+            .raw_len = (uint32_t)raw,
+            .stored_len = (uint32_t)stored,
+            .crc = mw_crc32c(0, payload, stored),
+        };
+        f->seq = h->seq;
+        f->count = x->batch_count;
+        f->len = sizeof(*h) + stored;
+        x->stats.frames++;
+        x->stats.raw_bytes += raw;
+        x->stats.stored_bytes += stored;
+    }
+
+    x->batch_used = 0;
+    x->batch_count = 0;
+    x->batch_prev_ts = 0;
+    if (f) enqueue_frame(x, f);
+}
+
+static void handle_ack(mw_exporter_t *x, uint64_t seq) {
+    if (seq > x->acked_seq) x->acked_seq = seq;
+    while (x->head && x->head->seq <= x->acked_seq) {
+        export_frame_t *f = x->head;
+        x->head = f->next;
+        if (!x->head) x->tail = NULL;
+        if (x->next_send == f) x->next_send = f->next;
+        if (f->sent && x->in_flight) x->in_flight--;
+        x->stats.queued_bytes -= f->len;
+        x->stats.frames_acked++;
+        free(f);
+    }
+    pthread_cond_broadcast(&x->progress);
+}
+
+static void drop_connection(mw_exporter_t *x) {
+    close(x->sock);
+    x->sock = -1;
+    for (export_frame_t *f = x->head; f; f = f->next) f->sent = false;
+    x->next_send = x->head;
+    x->in_flight = 0;
+}
+
+/* ============================================================================
+ * Sender Thread
+ * ============================================================================ */
+
+static int recv_exact(int fd, void *buf, size_t len, int timeout_ms) {
+    uint8_t *p = buf;
+    while (len) {
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        if (poll(&pfd, 1, timeout_ms) <= 0) {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+        ssize_t n = recv(fd, p, len, 0);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* Introduce the source; the reply says what the collector already has */
+static int say_hello(mw_exporter_t *x, int fd, uint64_t *acked) {
+    struct {
+        mw_frame_header_t h;
+        mw_export_hello_t hello;
+    } msg = {
+        .h = {
+            .magic = MW_EXPORT_MAGIC,
+            .version = MW_EXPORT_VERSION,
+            .type = MW_FRAME_HELLO,
+            .raw_len = sizeof(mw_export_hello_t),
+            .stored_len = sizeof(mw_export_hello_t),
+            .crc = mw_crc32c(0, &x->hello, sizeof(x->hello)),
+        },
+        .hello = x->hello,
+    };
+    mw_frame_header_t reply;
+    if (send_all(fd, &msg, sizeof(msg)) != 0 ||
+        recv_exact(fd, &reply, sizeof(reply), HELLO_TIMEOUT_MS) != 0 ||
+        mw_export_check_header(&reply) != 0 || reply.type != MW_FRAME_ACK) {
+        return -1;
+    }
+    *acked = reply.seq;
+    return 0;
+}
+
+static void *sender_main(void *arg) {
+    mw_exporter_t *x = arg;
+    uint32_t backoff = BACKOFF_MIN_MS;
+    mw_frame_header_t acks[64];
+    size_t have = 0;
+
+    pthread_mutex_lock(&x->lock);
+    while (!x->stop) {
+        if (x->batch_count && now_ns() >= x->batch_deadline_ns) {
+            seal_batch(x);
+        }
+        refill_from_spill(x);
+
+        if (x->sock < 0) {
+            pthread_mutex_unlock(&x->lock);
+            uint64_t acked = 0;
+            int fd = connect_endpoint(x->config.endpoint);
+            if (fd >= 0 && say_hello(x, fd, &acked) != 0) {
+                close(fd);
+                fd = -1;
+            }
+            pthread_mutex_lock(&x->lock);
+            if (fd < 0) {
+                timed_wait(&x->wake, &x->lock, backoff);
+                backoff = backoff * 2 > BACKOFF_MAX_MS ? BACKOFF_MAX_MS : backoff * 2;
+                continue;
+            }
+            backoff = BACKOFF_MIN_MS;
+            x->sock = fd;
+            x->stats.connects++;
+            have = 0;
+            handle_ack(x, acked);
+            continue;
+        }
+
+        export_frame_t *f = x->next_send;
+        if (f && x->in_flight < x->config.window_frames) {
+            x->next_send = f->next;
+            f->sent = true;
+            x->in_flight++;
+            int fd = x->sock;
+            pthread_mutex_unlock(&x->lock);
+            int rc = send_all(fd, f->data, f->len);
+            pthread_mutex_lock(&x->lock);
+            if (rc != 0) {
+                drop_connection(x);
+            } else {
+                x->stats.frames_sent++;
+            }
+            continue;
+        }
+
+        uint32_t wait_ms = IDLE_WAIT_MS;
+        if (x->batch_count) {
+            uint64_t now = now_ns();
+            wait_ms = x->batch_deadline_ns > now ? (uint32_t)((x->batch_deadline_ns - now) / 1000000) + 1 : 0;
+        }
+        if (x->in_flight == 0) {
+            if (wait_ms) timed_wait(&x->wake, &x->lock, wait_ms);
+            continue;
+        }
+
+        /* Frames are out: listen for acks, a few ms at a time so that new
+         * frames and batch deadlines are not kept waiting */
+        int fd = x->sock;
+        pthread_mutex_unlock(&x->lock);
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        int ready = poll(&pfd, 1, wait_ms < ACK_POLL_MS ? (int)wait_ms : ACK_POLL_MS);
+        ssize_t n = 0;
+        if (ready > 0) {
+            n = recv(fd, (uint8_t *)acks + have, sizeof(acks) - have, MSG_DONTWAIT);
+        }
+        pthread_mutex_lock(&x->lock);
+        if (ready > 0 && (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR))) {
+            drop_connection(x);
+            continue;
+        }
+        if (n > 0) {
+            have += (size_t)n;
+            size_t complete = have / sizeof(mw_frame_header_t);
+            uint64_t seq = 0;
+            bool bad = false;
+            for (size_t i = 0; i < complete; i++) {
+                if (mw_export_check_header(&acks[i]) != 0 || acks[i].type != MW_FRAME_ACK) bad = true;
+                else if (acks[i].seq > seq) seq = acks[i].seq;
+            }
+            have -= complete * sizeof(mw_frame_header_t);
+            memmove(acks, (uint8_t *)acks + complete * sizeof(mw_frame_header_t), have);
+            if (bad) {
+                drop_connection(x);
+                continue;
+            }
+            handle_ack(x, seq);
+        }
+    }
+    if (x->sock >= 0) {
+        close(x->sock);
+        x->sock = -1;
+    }
+    pthread_mutex_unlock(&x->lock);
+    return NULL;
+}
+
+/* ============================================================================
+ * Public API
+ * ============================================================================ */
+
+/* Open (or take over) the spill file. A valid one left by an earlier run
+ * supplies the source id and the sequence to continue from. */
+static int spill_open(mw_exporter_t *x) {
+    x->spill_fd = open(x->spill_path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (x->spill_fd < 0) return -1;
+
+    struct stat st;
+    spill_header_t sh;
+    if (fstat(x->spill_fd, &st) == 0 &&
+        pread(x->spill_fd, &sh, sizeof(sh), 0) == (ssize_t)sizeof(sh) &&
+        sh.magic == SPILL_MAGIC && sh.version == SPILL_VERSION) {
+        x->hello.source_id = sh.source_id;
+        uint64_t off = sizeof(sh), max_seq = 0;
+        mw_frame_header_t h;
+        while (pread(x->spill_fd, &h, sizeof(h), (off_t)off) == (ssize_t)sizeof(h) &&
+               mw_export_check_header(&h) == 0 && h.type == MW_FRAME_EVENTS &&
+               off + sizeof(h) + h.stored_len <= (uint64_t)st.st_size) {
+            if (h.seq > max_seq) max_seq = h.seq;
+            off += sizeof(h) + h.stored_len;
+        }
+        if (off < (uint64_t)st.st_size && ftruncate(x->spill_fd, (off_t)off) != 0) {
+            return -1;
+        }
+        x->spill_read = sizeof(sh);
+        x->spill_write = off;
+        x->spilling = off > sizeof(sh);
+        x->stats.spilled_bytes = off - sizeof(sh);
+        x->next_seq = max_seq + 1;
+        return 0;
+    }
+
+    sh = (spill_header_t){ .magic = SPILL_MAGIC, .version = SPILL_VERSION, .source_id = x->hello.source_id };
+    if (ftruncate(x->spill_fd, 0) != 0 || pwrite_all(x->spill_fd, &sh, sizeof(sh), 0) != 0) {
+        return -1;
+    }
+    x->spill_read = x->spill_write = sizeof(sh);
+    return 0;
+}
+
+mw_exporter_t *mw_export_open(const mw_export_config_t *config) {
+    if (!config || !valid_endpoint(config->endpoint) ||
+        (config->spill_path && strlen(config->spill_path) >= PATH_MAX - 8)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    mw_exporter_t *x = calloc(1, sizeof(*x));
+    if (!x) return NULL;
+
+    x->config = *config;
+    snprintf(x->endpoint, sizeof(x->endpoint), "%s", config->endpoint);
+    x->config.endpoint = x->endpoint;
+    if (!x->config.batch_bytes) x->config.batch_bytes = DEFAULT_BATCH_BYTES;
+    if (x->config.batch_bytes > MW_EXPORT_MAX_FRAME / 2) x->config.batch_bytes = MW_EXPORT_MAX_FRAME / 2;
+    if (!x->config.batch_interval_ms) x->config.batch_interval_ms = DEFAULT_BATCH_INTERVAL;
+    if (!x->config.window_frames) x->config.window_frames = DEFAULT_WINDOW;
+    if (!x->config.max_queued_bytes) x->config.max_queued_bytes = DEFAULT_MAX_QUEUED;
+    if (!x->config.close_timeout_ms) x->config.close_timeout_ms = DEFAULT_CLOSE_TIMEOUT;
+    x->sock = -1;
+    x->spill_fd = -1;
+    x->next_seq = 1;
+
+    x->hello.pid = (uint32_t)getpid();
+    if (config->source_name) {
+        snprintf(x->hello.name, sizeof(x->hello.name), "%s", config->source_name);
+    } else {
+        char host[32] = "localhost";
+        gethostname(host, sizeof(host) - 1);
+        snprintf(x->hello.name, sizeof(x->hello.name), "%s:%u", host, x->hello.pid);
+    }
+    if (getrandom(&x->hello.source_id, sizeof(x->hello.source_id), 0) != sizeof(x->hello.source_id)) {
+        uint64_t seed[2] = { now_ns(), (uint64_t)getpid() };
+        x->hello.source_id = mw_hash64(seed, sizeof(seed));
+    }
+
+    if (config->spill_path) {
+        snprintf(x->spill_path, sizeof(x->spill_path), "%s", config->spill_path);
+        x->config.spill_path = x->spill_path;
+        if (spill_open(x) != 0) {
+            int err = errno;
+            if (x->spill_fd >= 0) close(x->spill_fd);
+            free(x);
+            errno = err;
+            return NULL;
+        }
+    }
+
+    x->batch_cap = x->config.batch_bytes + 4096;
+    x->batch = malloc(x->batch_cap);
+    if (!x->batch) {
+        if (x->spill_fd >= 0) close(x->spill_fd);
+        free(x);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&x->lock, NULL);
+    pthread_cond_init(&x->wake, &attr);
+    pthread_cond_init(&x->progress, &attr);
+    pthread_condattr_destroy(&attr);
+
+    if (pthread_create(&x->sender, NULL, sender_main, x) != 0) {
+        if (x->spill_fd >= 0) close(x->spill_fd);
+        free(x->batch);
+        free(x);
+        errno = EAGAIN;
+        return NULL;
+    }
+    return x;
+}
+
+int mw_export_event(mw_exporter_t *x, const mw_export_event_t *event) {
+    uint32_t name_len = event->name ? event->name_len : 0;
+    uint32_t old_len = event->old_value ? event->old_len : 0;
+    uint32_t new_len = event->new_value ? event->new_len : 0;
+    size_t need = EVENT_OVERHEAD + (size_t)name_len + old_len + new_len;
+    if (need > MW_EXPORT_MAX_FRAME) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    pthread_mutex_lock(&x->lock);
+    if (x->batch_count && x->batch_used + need > x->config.batch_bytes) {
+        seal_batch(x);
+    }
+    if (x->batch_used + need > x->batch_cap) {
+        uint8_t *batch = realloc(x->batch, x->batch_used + need);
+        if (!batch) {
+            pthread_mutex_unlock(&x->lock);
+            return -1;
+        }
+        x->batch = batch;
+        x->batch_cap = x->batch_used + need;
+    }
+
+    uint8_t *p = x->batch + x->batch_used;
+    p = put_varint(p, zigzag((int64_t)(event->timestamp_ns - x->batch_prev_ts)));
+    p = put_varint(p, event->region_id);
+    p = put_varint(p, event->thread_id);
+    p = put_varint(p, name_len);
+    if (name_len) memcpy(p, event->name, name_len);
+    p += name_len;
+    p = put_varint(p, old_len);
+    if (old_len) memcpy(p, event->old_value, old_len);
+    p += old_len;
+    p = put_varint(p, new_len);
+    if (new_len) memcpy(p, event->new_value, new_len);
+    p += new_len;
+    x->batch_used = (size_t)(p - x->batch);
+    x->batch_prev_ts = event->timestamp_ns;
+    x->stats.events++;
+
+    if (x->batch_count++ == 0) {
+        x->batch_deadline_ns = now_ns() + (uint64_t)x->config.batch_interval_ms * 1000000ULL;
+        pthread_cond_signal(&x->wake);
+    }
+    if (x->batch_used >= x->config.batch_bytes) {
+        seal_batch(x);
+    }
+    pthread_mutex_unlock(&x->lock);
+    return 0;
+}
+
+int mw_export_flush(mw_exporter_t *x, int timeout_ms) {
+    uint64_t deadline = timeout_ms < 0 ? UINT64_MAX : now_ns() + (uint64_t)timeout_ms * 1000000ULL;
+
+    pthread_mutex_lock(&x->lock);
+    seal_batch(x);
+    uint64_t target = x->next_seq - 1;
+    while ((x->head && x->head->seq <= target) || x->spilling) {
+        uint64_t now = now_ns();
+        if (now >= deadline) {
+            pthread_mutex_unlock(&x->lock);
+            errno = ETIMEDOUT;
+            return -1;
+        }
+        uint64_t left = (deadline - now) / 1000000 + 1;
+        timed_wait(&x->progress, &x->lock, left < IDLE_WAIT_MS ? (uint32_t)left : IDLE_WAIT_MS);
+    }
+    pthread_mutex_unlock(&x->lock);
+    return 0;
+}
+
+void mw_export_stats(mw_exporter_t *x, mw_export_stats_t *out) {
+    pthread_mutex_lock(&x->lock);
+    *out = x->stats;
+    pthread_mutex_unlock(&x->lock);
+}
+
+/* Rewrite the spill file as: header, frames still in memory, frames not
+ * yet read back, so that the next run resends them in order */
+static void spill_keep_unacked(mw_exporter_t *x) {
+    char tmp[PATH_MAX + 8];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", x->spill_path);
+    int fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return;
+
+    spill_header_t sh = { .magic = SPILL_MAGIC, .version = SPILL_VERSION, .source_id = x->hello.source_id };
+    uint64_t off = 0;
+    int rc = pwrite_all(fd, &sh, sizeof(sh), off);
+    off += sizeof(sh);
+    for (export_frame_t *f = x->head; f && rc == 0; f = f->next) {
+        rc = pwrite_all(fd, f->data, f->len, off);
+        off += f->len;
+    }
+    uint8_t buf[65536];
+    for (uint64_t at = x->spill_read; rc == 0 && at < x->spill_write; ) {
+        size_t n = x->spill_write - at < sizeof(buf) ? (size_t)(x->spill_write - at) : sizeof(buf);
+        if (pread(x->spill_fd, buf, n, (off_t)at) != (ssize_t)n) {
+            rc = -1;
+            break;
+        }
+        rc = pwrite_all(fd, buf, n, off);
+        at += n;
+        off += n;
+    }
+    if (rc == 0 && fsync(fd) == 0) {
+        rename(tmp, x->spill_path);
+    } else {
+        unlink(tmp);
+    }
+    close(fd);
+}
+
+void mw_export_close(mw_exporter_t *x) {
+    if (!x) return;
+    mw_export_flush(x, (int)x->config.close_timeout_ms);
+
+    pthread_mutex_lock(&x->lock);
+    x->stop = true;
+    pthread_cond_signal(&x->wake);
+    pthread_mutex_unlock(&x->lock);
+    pthread_join(x->sender, NULL);
+
+    if (x->spill_fd >= 0) {
+        if (x->head) {
+            spill_keep_unacked(x);
+        }
+        close(x->spill_fd);
+    }
+    for (export_frame_t *f = x->head; f; ) {
+        export_frame_t *next = f->next;
+        free(f);
+        f = next;
+    }
+    free(x->batch);
+    pthread_mutex_destroy(&x->lock);
+    pthread_cond_destroy(&x->wake);
+    pthread_cond_destroy(&x->progress);
+    free(x);
+}
+
+/* ============================================================================
+ * Decoding
+ * ============================================================================ */
+
+int mw_export_check_header(const mw_frame_header_t *h) {
+    if (h->magic != MW_EXPORT_MAGIC || h->version != MW_EXPORT_VERSION ||
+        h->type < MW_FRAME_HELLO || h->type > MW_FRAME_ACK ||
+        h->stored_len > MW_EXPORT_MAX_FRAME || h->raw_len > MW_EXPORT_MAX_FRAME) {
+        return -1;
+    }
+    return 0;
+}
+
+long mw_export_unpack(const mw_frame_header_t *h, const void *stored, void *raw, size_t capacity) {
+    if (h->raw_len > capacity) {
+        errno = ENOBUFS;
+        return -1;
+    }
+    if (mw_crc32c(0, stored, h->stored_len) != h->crc) {
+        errno = EBADMSG;
+        return -1;
+    }
+    switch (h->codec) {
+    case MW_CODEC_NONE:
+        if (h->stored_len != h->raw_len) break;
+        memcpy(raw, stored, h->raw_len);
+        return h->raw_len;
+    case MW_CODEC_LZ4:
+        if (mw_lz4_decompress(stored, h->stored_len, raw, h->raw_len) != (long)h->raw_len) break;
+        return h->raw_len;
+    default:
+        errno = ENOTSUP;
+        return -1;
+    }
+    errno = EBADMSG;
+    return -1;
+}
+
+void mw_export_reader_init(mw_export_reader_t *r, const void *raw, size_t len) {
+    r->p = raw;
+    r->end = (const uint8_t *)raw + len;
+    r->timestamp_ns = 0;
+}
+
+static int get_bytes(mw_export_reader_t *r, const void **data, uint32_t *len) {
+    uint64_t n;
+    if (get_varint(&r->p, r->end, &n) != 0 || n > (uint64_t)(r->end - r->p)) return -1;
+    *data = n ? r->p : NULL;
+    *len = (uint32_t)n;
+    r->p += n;
+    return 0;
+}
+
+int mw_export_read(mw_export_reader_t *r, mw_export_event_t *out) {
+    if (r->p == r->end) return 0;
+    uint64_t delta, region, thread;
+    const void *name;
+    if (get_varint(&r->p, r->end, &delta) != 0 ||
+        get_varint(&r->p, r->end, &region) != 0 || region > UINT32_MAX ||
+        get_varint(&r->p, r->end, &thread) != 0 || thread > UINT32_MAX ||
+        get_bytes(r, &name, &out->name_len) != 0 ||
+        get_bytes(r, &out->old_value, &out->old_len) != 0 ||
+        get_bytes(r, &out->new_value, &out->new_len) != 0) {
+        return -1;
+    }
+    r->timestamp_ns += (uint64_t)unzigzag(delta);
+    out->timestamp_ns = r->timestamp_ns;
+    out->region_id = (uint32_t)region;
+    out->thread_id = (uint32_t)thread;
+    out->name = name;
+    return 1;
+}
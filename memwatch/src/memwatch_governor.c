@@ -0,0 +1,213 @@
+/*
+ * memwatch_governor.c - Adaptive overhead governor for the tracing modes
+ *
+ * Costs are estimates: the caller bills each region for its share of a
+ * fault at a cost measured up front, plus the worker time it took.
+ * Demoting a region is assumed to save half its cost; the next interval
+ * shows what it really saved. A demoted region's cost one level up is its
+ * cost now scaled by how much more often it would be checked there.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "memwatch_governor.h"
+
+static const char *mode_names[] = { "off", "lite", "balanced", "deep" };
+static const unsigned target_pct[] = { 0, 5, 30, 100 };
+
+static const char *level_names[MW_GOV_LEVELS] = {
+    "full", "preview", "hash", "window_x4", "window_x16",
+    "sampled_100ms", "sampled_1s", "sampled_10s",
+};
+
+static const char *reason_names[] = { "over_budget", "cooled", "mode_off" };
+
+void mw_governor_init(mw_governor_t *g, mw_gov_mode_t mode, uint64_t interval_ns,
+                      uint64_t window_ns, uint64_t fault_cost_ns) {
+    memset(g, 0, sizeof(*g));
+    g->interval_ns = interval_ns;
+    g->window_ns = window_ns;
+    g->fault_cost_ns = fault_cost_ns;
+    mw_governor_set_mode(g, mode);
+}
+
+void mw_governor_set_mode(mw_governor_t *g, mw_gov_mode_t mode) {
+    g->mode = mode;
+    g->budget_ns = g->interval_ns * mw_gov_target_pct(mode) / 100;
+}
+
+/* How often a level looks at a busy region: its window, or its sample period */
+static uint64_t level_period_ns(const mw_governor_t *g, mw_gov_level_t level) {
+    return mw_gov_sampled(level) ? mw_gov_sample_ns(level) : mw_gov_window_ns(level, g->window_ns);
+}
+
+/* The region's cost one level up, were it as busy as in the last interval */
+static uint64_t predicted_up(const mw_governor_t *g, const mw_gov_region_t *s) {
+    mw_gov_level_t level = (mw_gov_level_t)s->level;
+    double scale = (double)level_period_ns(g, level) / (double)level_period_ns(g, level - 1);
+    if (mw_gov_sampled(level)) {
+        uint64_t per_write = s->event_ns > g->fault_cost_ns ? s->event_ns : g->fault_cost_ns;
+        return (uint64_t)((double)s->writes * (double)per_write * scale);
+    }
+    return (uint64_t)((double)s->cost_ns * scale);
+}
+
+static int compare_cost(const void *a, const void *b) {
+    uint32_t x = ((const mw_gov_ref_t *)a)->state->cost_ns;
+    uint32_t y = ((const mw_gov_ref_t *)b)->state->cost_ns;
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+static void decide(mw_governor_t *g, const mw_gov_ref_t *ref, mw_gov_level_t to,
+                   mw_gov_reason_t reason, uint64_t cost_ns, uint64_t now_ns,
+                   mw_gov_apply_fn apply, void *ctx) {
+    mw_gov_region_t *s = ref->state;
+    mw_gov_level_t from = (mw_gov_level_t)s->level;
+    s->level = (uint8_t)to;
+    s->cool_ticks = 0;
+    if (to > from) {
+        g->demotions++;
+    } else {
+        g->promotions++;
+    }
+
+    mw_gov_decision_t *d = &g->log[g->logged % MW_GOV_LOG_SIZE];
+    d->time_ns = now_ns;
+    d->region_id = ref->region_id;
+    d->from = (uint8_t)from;
+    d->to = (uint8_t)to;
+    d->reason = (uint16_t)reason;
+    d->cost_ns = cost_ns;
+    d->total_ns = g->last_cost_ns;
+    g->logged++;
+
+    if (apply) {
+        apply(ref->region_id, s, from, ctx);
+    }
+}
+
+size_t mw_governor_tick(mw_governor_t *g, mw_gov_ref_t *refs, size_t count, uint64_t now_ns,
+                        mw_gov_apply_fn apply, void *ctx) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        mw_gov_region_t *s = refs[i].state;
+        uint64_t cost = s->work_ns;
+        if (!mw_gov_sampled((mw_gov_level_t)s->level) && s->writes > 0) {
+            uint64_t per_write = cost / s->writes;
+            s->event_ns = (uint32_t)(s->event_ns ? (3 * (uint64_t)s->event_ns + per_write) / 4
+                                                 : per_write);
+        }
+        s->cost_ns = cost > UINT32_MAX ? UINT32_MAX : (uint32_t)cost;
+        total += cost;
+    }
+    g->last_cost_ns = total;
+    g->ticks++;
+
+    size_t decisions = 0;
+    if (g->mode == MW_GOV_OFF) {
+        for (size_t i = 0; i < count; i++) {
+            if (refs[i].state->level != MW_GOV_FULL) {
+                decide(g, &refs[i], MW_GOV_FULL, MW_GOV_MODE_OFF, refs[i].state->cost_ns, now_ns,
+                       apply, ctx);
+                decisions++;
+            }
+        }
+    } else if (total > g->budget_ns) {
+        /* Costliest first, until the excess is covered; a region within its
+         * fair share of the budget is left alone (the average is not) */
+        qsort(refs, count, sizeof(mw_gov_ref_t), compare_cost);
+        uint64_t excess = total - g->budget_ns;
+        uint64_t fair_share = g->budget_ns / count;
+        for (size_t i = 0; i < count && excess > 0; i++) {
+            mw_gov_region_t *s = refs[i].state;
+            if (s->cost_ns <= fair_share) break;
+            if (s->level == MW_GOV_SAMPLED_10S) continue;  /* nothing cheaper left */
+
+            if (s->cool_needed == 0) {
+                s->cool_needed = MW_GOV_COOL_TICKS;
+            } else if (s->since_promotion && s->since_promotion <= s->cool_needed) {
+                /* Promoted too early last time */
+                s->cool_needed = s->cool_needed * 2 > MW_GOV_COOL_MAX ? MW_GOV_COOL_MAX
+                                                                      : s->cool_needed * 2;
+            }
+            decide(g, &refs[i], (mw_gov_level_t)(s->level + 1), MW_GOV_OVER_BUDGET, s->cost_ns,
+                   now_ns, apply, ctx);
+            decisions++;
+
+            uint64_t saved = s->cost_ns / 2 ? s->cost_ns / 2 : 1;
+            excess = saved < excess ? excess - saved : 0;
+        }
+    } else if (total <= g->budget_ns / 2) {
+        /* Headroom: let regions that stayed cool back up, one level at a time */
+        for (size_t i = 0; i < count; i++) {
+            mw_gov_region_t *s = refs[i].state;
+            if (s->level == MW_GOV_FULL) continue;
+
+            uint64_t predicted = predicted_up(g, s);
+            uint64_t after = total - s->cost_ns + predicted;
+            if (predicted > g->budget_ns / 4 || after > g->budget_ns / 2) {
+                s->cool_ticks = 0;
+                continue;
+            }
+            if (++s->cool_ticks < s->cool_needed) continue;
+
+            decide(g, &refs[i], (mw_gov_level_t)(s->level - 1), MW_GOV_COOLED, predicted, now_ns,
+                   apply, ctx);
+            s->since_promotion = 1;
+            total = after;
+            decisions++;
+        }
+    }
+
+    memset(g->regions_at, 0, sizeof(g->regions_at));
+    g->demoted = 0;
+    for (size_t i = 0; i < count; i++) {
+        mw_gov_region_t *s = refs[i].state;
+        g->regions_at[s->level]++;
+        g->demoted += s->level != MW_GOV_FULL;
+        s->writes = 0;
+        s->work_ns = 0;
+        if (s->since_promotion && s->since_promotion < UINT8_MAX) s->since_promotion++;
+    }
+    return decisions;
+}
+
+size_t mw_governor_decisions(const mw_governor_t *g, mw_gov_decision_t *out, size_t max) {
+    uint64_t kept = g->logged < MW_GOV_LOG_SIZE ? g->logged : MW_GOV_LOG_SIZE;
+    if (kept > max) kept = max;
+    for (uint64_t i = 0; i < kept; i++) {
+        out[i] = g->log[(g->logged - kept + i) % MW_GOV_LOG_SIZE];
+    }
+    return (size_t)kept;
+}
+
+int mw_gov_mode_parse(const char *name, mw_gov_mode_t *out) {
+    if (!name || !*name) {
+        *out = MW_GOV_OFF;
+        return 0;
+    }
+    for (size_t i = 0; i < sizeof(mode_names) / sizeof(mode_names[0]); i++) {
+        if (strcmp(name, mode_names[i]) == 0) {
+            *out = (mw_gov_mode_t)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *mw_gov_mode_name(mw_gov_mode_t mode) {
+    return (unsigned)mode < sizeof(mode_names) / sizeof(mode_names[0]) ? mode_names[mode] : "unknown";
+}
+
+const char *mw_gov_level_name(mw_gov_level_t level) {
+    return (unsigned)level < MW_GOV_LEVELS ? level_names[level] : "unknown";
+}
+
+const char *mw_gov_reason_name(mw_gov_reason_t reason) {
+    return (unsigned)reason < sizeof(reason_names) / sizeof(reason_names[0]) ? reason_names[reason]
+                                                                              : "unknown";
+}
+
+unsigned mw_gov_target_pct(mw_gov_mode_t mode) {
+    return (unsigned)mode < sizeof(target_pct) / sizeof(target_pct[0]) ? target_pct[mode] : 0;
+}
@@ -0,0 +1,611 @@
+/*
+ * memwatch_hash.c - Shared hashing kernels for memwatch and FastStorage
+ *
+ * mw_hash64 follows the XXH3 construction: inputs up to 240 bytes take a
+ * scalar mixing path; longer inputs are cut into 64-byte stripes feeding
+ * eight 64-bit accumulators (32x32->64 multiply of data^secret plus the
+ * neighbouring lane's data), scrambled once per 1 KB block. The stripe loop
+ * is the only part that depends on the kernel, and the vector kernels
+ * compute exactly what the scalar one does, lane for lane.
+ *
+ * Kernels are compiled with per-function target attributes, so no special
+ * compiler flags are needed and the library still runs on older CPUs.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "memwatch_hash.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MW_HASH_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__)
+#define MW_HASH_ARM64 1
+#include <arm_neon.h>
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+/* ============================================================================
+ * Constants
+ * ============================================================================ */
+
+#define MW_PRIME32_1 0x9E3779B1U
+#define MW_PRIME32_2 0x85EBCA77U
+#define MW_PRIME32_3 0xC2B2AE3DU
+#define MW_PRIME64_1 0x9E3779B185EBCA87ULL
+#define MW_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define MW_PRIME64_3 0x165667B19E3779F9ULL
+#define MW_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define MW_PRIME64_5 0x27D4EB2F165667C5ULL
+
+#define MW_STRIPE_LEN        64
+#define MW_SECRET_SIZE       192
+#define MW_SECRET_CONSUME    8
+#define MW_STRIPES_PER_BLOCK ((MW_SECRET_SIZE - MW_STRIPE_LEN) / MW_SECRET_CONSUME)
+#define MW_BLOCK_LEN         (MW_STRIPE_LEN * MW_STRIPES_PER_BLOCK)
+#define MW_MIDSIZE_MAX       240
+#define MW_PREFETCH_DIST     384
+
+/* Fixed key material (splitmix64 stream seeded with "memwatch") */
+static const uint8_t mw_secret[MW_SECRET_SIZE] __attribute__((aligned(64))) = {
+    0x47, 0x75, 0x5d, 0xb5, 0x2f, 0x19, 0xfc, 0x7b, 0xa6, 0x1b, 0x21, 0xfa,
+    0xef, 0x75, 0x99, 0xa8, 0xb9, 0xe0, 0x43, 0x26, 0x8d, 0xbe, 0x74, 0x3c,
+    0x7c, 0x36, 0xab, 0xbb, 0x48, 0x0b, 0x34, 0x1c, 0x9d, 0x15, 0xc4, 0xe2,
+    0xf2, 0x77, 0x20, 0x4b, 0x61, 0x10, 0x40, 0x7e, 0x7f, 0xa9, 0x29, 0x5d,
+    0xb9, 0x70, 0x55, 0x79, 0xa5, 0x5e, 0x2f, 0x32, 0x8e, 0xc0, 0x2d, 0xc8,
+    0xc0, 0xa6, 0x86, 0x3d, 0xc7, 0x1e, 0x90, 0x93, 0x8c, 0xcc, 0x95, 0x26,
+    0x9d, 0x1a, 0x51, 0xf0, 0x18, 0x25, 0xfd, 0x88, 0x4e, 0x9c, 0xd3, 0x60,
+    0x42, 0xe1, 0xa8, 0xa6, 0x5a, 0xdb, 0x83, 0x0c, 0xad, 0x4f, 0x66, 0xe0,
+    0x8c, 0x04, 0x9e, 0x2c, 0xa3, 0x56, 0xa6, 0x64, 0x6a, 0xf8, 0x5c, 0xb7,
+    0x7c, 0x92, 0x0f, 0xcd, 0x55, 0x95, 0xbd, 0xfd, 0x31, 0xb6, 0x4a, 0x04,
+    0x3d, 0x1e, 0x1d, 0x57, 0x18, 0x27, 0x21, 0xb9, 0xf1, 0x8d, 0xd2, 0x31,
+    0xa7, 0xac, 0xca, 0x8a, 0x23, 0x79, 0xb1, 0x45, 0x43, 0xcc, 0xdd, 0xab,
+    0xf1, 0x56, 0x4b, 0x07, 0x8c, 0x09, 0x71, 0x6b, 0x1e, 0xc3, 0xa3, 0x04,
+    0x2b, 0x0c, 0xd5, 0x29, 0xd5, 0xbb, 0x71, 0x11, 0xa6, 0x3f, 0xbd, 0x5e,
+    0x4c, 0x7c, 0x22, 0x7b, 0x14, 0xea, 0xe6, 0x47, 0xe3, 0x98, 0x2a, 0xc2,
+    0xed, 0x8f, 0xef, 0x9d, 0x5a, 0x13, 0x6d, 0x97, 0x85, 0xb3, 0x43, 0xdb,
+};
+
+/* ============================================================================
+ * Scalar helpers (little-endian reads; unaligned-safe)
+ * ============================================================================ */
+
+static inline uint64_t read64(const void *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t read32(const void *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t mul128_fold64(uint64_t a, uint64_t b) {
+    __uint128_t product = (__uint128_t)a * b;
+    return (uint64_t)product ^ (uint64_t)(product >> 64);
+}
+
+static inline uint64_t avalanche(uint64_t h) {
+    h ^= h >> 37;
+    h *= 0x165667919E3779F9ULL;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline uint64_t xxh64_avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= MW_PRIME64_2;
+    h ^= h >> 29;
+    h *= MW_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline uint64_t rrmxmx(uint64_t h, uint64_t len) {
+    h ^= rotl64(h, 49) ^ rotl64(h, 24);
+    h *= 0x9FB21C651E98DF25ULL;
+    h ^= (h >> 35) + len;
+    h *= 0x9FB21C651E98DF25ULL;
+    h ^= h >> 28;
+    return h;
+}
+
+static inline uint64_t mix16(const uint8_t *p, const uint8_t *s) {
+    return mul128_fold64(read64(p) ^ read64(s), read64(p + 8) ^ read64(s + 8));
+}
+
+/* ============================================================================
+ * Short inputs (0..240 bytes) - scalar on every kernel
+ * ============================================================================ */
+
+static uint64_t hash_0to16(const uint8_t *p, size_t len, const uint8_t *s) {
+    if (len > 8) {
+        uint64_t lo = read64(p) ^ (read64(s + 24) ^ read64(s + 32));
+        uint64_t hi = read64(p + len - 8) ^ (read64(s + 40) ^ read64(s + 48));
+        uint64_t acc = len + __builtin_bswap64(lo) + hi + mul128_fold64(lo, hi);
+        return avalanche(acc);
+    }
+    if (len >= 4) {
+        uint64_t input64 = read32(p + len - 4) + ((uint64_t)read32(p) << 32);
+        return rrmxmx(input64 ^ (read64(s + 8) ^ read64(s + 16)), len);
+    }
+    if (len > 0) {
+        uint32_t combined = ((uint32_t)p[0] << 16) | ((uint32_t)p[len >> 1] << 24) |
+                            (uint32_t)p[len - 1] | ((uint32_t)len << 8);
+        uint64_t bitflip = read32(s) ^ read32(s + 4);
+        return xxh64_avalanche((uint64_t)combined ^ bitflip);
+    }
+    return xxh64_avalanche(read64(s + 56) ^ read64(s + 64));
+}
+
+static uint64_t hash_17to128(const uint8_t *p, size_t len, const uint8_t *s) {
+    uint64_t acc = len * MW_PRIME64_1;
+    if (len > 32) {
+        if (len > 64) {
+            if (len > 96) {
+                acc += mix16(p + 48, s + 96);
+                acc += mix16(p + len - 64, s + 112);
+            }
+            acc += mix16(p + 32, s + 64);
+            acc += mix16(p + len - 48, s + 80);
+        }
+        acc += mix16(p + 16, s + 32);
+        acc += mix16(p + len - 32, s + 48);
+    }
+    acc += mix16(p, s);
+    acc += mix16(p + len - 16, s + 16);
+    return avalanche(acc);
+}
+
+static uint64_t hash_129to240(const uint8_t *p, size_t len, const uint8_t *s) {
+    uint64_t acc = len * MW_PRIME64_1;
+    size_t rounds = len / 16;
+
+    for (size_t i = 0; i < 8; i++) {
+        acc += mix16(p + 16 * i, s + 16 * i);
+    }
+    acc = avalanche(acc);
+
+    for (size_t i = 8; i < rounds; i++) {
+        acc += mix16(p + 16 * i, s + 16 * (i - 8) + 3);
+    }
+    acc += mix16(p + len - 16, s + MW_SECRET_SIZE - 17 - 40);
+    return avalanche(acc);
+}
+
+/* ============================================================================
+ * Long-input kernels: accumulate nb_stripes stripes, scramble accumulators
+ * ============================================================================ */
+
+typedef void (*accumulate_fn)(uint64_t *acc, const uint8_t *in, const uint8_t *secret,
+                              size_t nb_stripes);
+typedef void (*scramble_fn)(uint64_t *acc, const uint8_t *secret);
+
+typedef struct {
+    const char *name;
+    accumulate_fn accumulate;
+    scramble_fn scramble;
+} hash_kernel_t;
+
+static void accumulate_scalar(uint64_t *acc, const uint8_t *in, const uint8_t *secret,
+                              size_t nb_stripes) {
+    for (size_t n = 0; n < nb_stripes; n++) {
+        const uint8_t *p = in + n * MW_STRIPE_LEN;
+        const uint8_t *s = secret + n * MW_SECRET_CONSUME;
+        for (size_t i = 0; i < 8; i++) {
+            uint64_t data_val = read64(p + 8 * i);
+            uint64_t data_key = data_val ^ read64(s + 8 * i);
+            acc[i ^ 1] += data_val;
+            acc[i] += (uint64_t)(uint32_t)data_key * (data_key >> 32);
+        }
+    }
+}
+
+static void scramble_scalar(uint64_t *acc, const uint8_t *secret) {
+    for (size_t i = 0; i < 8; i++) {
+        uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= read64(secret + 8 * i);
+        a *= MW_PRIME32_1;
+        acc[i] = a;
+    }
+}
+
+static const hash_kernel_t kernel_scalar = { "scalar", accumulate_scalar, scramble_scalar };
+
+#ifdef MW_HASH_X86
+
+static void accumulate_sse2(uint64_t *acc, const uint8_t *in, const uint8_t *secret,
+                            size_t nb_stripes) {
+    __m128i *xacc = (__m128i *)acc;
+    __m128i a0 = _mm_loadu_si128(xacc + 0), a1 = _mm_loadu_si128(xacc + 1);
+    __m128i a2 = _mm_loadu_si128(xacc + 2), a3 = _mm_loadu_si128(xacc + 3);
+
+    for (size_t n = 0; n < nb_stripes; n++) {
+        const __m128i *p = (const __m128i *)(in + n * MW_STRIPE_LEN);
+        const __m128i *s = (const __m128i *)(secret + n * MW_SECRET_CONSUME);
+        __m128i *lanes[4] = { &a0, &a1, &a2, &a3 };
+        __builtin_prefetch(in + n * MW_STRIPE_LEN + MW_PREFETCH_DIST);
+
+        for (int i = 0; i < 4; i++) {
+            __m128i data_vec = _mm_loadu_si128(p + i);
+            __m128i data_key = _mm_xor_si128(data_vec, _mm_loadu_si128(s + i));
+            __m128i product = _mm_mul_epu32(data_key, _mm_srli_epi64(data_key, 32));
+            __m128i swapped = _mm_shuffle_epi32(data_vec, _MM_SHUFFLE(1, 0, 3, 2));
+            *lanes[i] = _mm_add_epi64(*lanes[i], _mm_add_epi64(product, swapped));
+        }
+    }
+
+    _mm_storeu_si128(xacc + 0, a0);
+    _mm_storeu_si128(xacc + 1, a1);
+    _mm_storeu_si128(xacc + 2, a2);
+    _mm_storeu_si128(xacc + 3, a3);
+}
+
+static void scramble_sse2(uint64_t *acc, const uint8_t *secret) {
+    __m128i *xacc = (__m128i *)acc;
+    const __m128i prime = _mm_set1_epi32((int)MW_PRIME32_1);
+
+    for (int i = 0; i < 4; i++) {
+        __m128i a = _mm_loadu_si128(xacc + i);
+        a = _mm_xor_si128(a, _mm_srli_epi64(a, 47));
+        a = _mm_xor_si128(a, _mm_loadu_si128((const __m128i *)secret + i));
+        __m128i lo = _mm_mul_epu32(a, prime);
+        __m128i hi = _mm_mul_epu32(_mm_srli_epi64(a, 32), prime);
+        _mm_storeu_si128(xacc + i, _mm_add_epi64(lo, _mm_slli_epi64(hi, 32)));
+    }
+}
+
+__attribute__((target("avx2")))
+static void accumulate_avx2(uint64_t *acc, const uint8_t *in, const uint8_t *secret,
+                            size_t nb_stripes) {
+    __m256i a0 = _mm256_loadu_si256((const __m256i *)acc);
+    __m256i a1 = _mm256_loadu_si256((const __m256i *)acc + 1);
+
+    for (size_t n = 0; n < nb_stripes; n++) {
+        const __m256i *p = (const __m256i *)(in + n * MW_STRIPE_LEN);
+        const __m256i *s = (const __m256i *)(secret + n * MW_SECRET_CONSUME);
+        __builtin_prefetch(in + n * MW_STRIPE_LEN + MW_PREFETCH_DIST);
+
+        __m256i d0 = _mm256_loadu_si256(p);
+        __m256i k0 = _mm256_xor_si256(d0, _mm256_loadu_si256(s));
+        __m256i m0 = _mm256_mul_epu32(k0, _mm256_srli_epi64(k0, 32));
+        a0 = _mm256_add_epi64(a0, _mm256_add_epi64(m0, _mm256_shuffle_epi32(d0, _MM_SHUFFLE(1, 0, 3, 2))));
+
+        __m256i d1 = _mm256_loadu_si256(p + 1);
+        __m256i k1 = _mm256_xor_si256(d1, _mm256_loadu_si256(s + 1));
+        __m256i m1 = _mm256_mul_epu32(k1, _mm256_srli_epi64(k1, 32));
+        a1 = _mm256_add_epi64(a1, _mm256_add_epi64(m1, _mm256_shuffle_epi32(d1, _MM_SHUFFLE(1, 0, 3, 2))));
+    }
+
+    _mm256_storeu_si256((__m256i *)acc, a0);
+    _mm256_storeu_si256((__m256i *)acc + 1, a1);
+}
+
+__attribute__((target("avx2")))
+static void scramble_avx2(uint64_t *acc, const uint8_t *secret) {
+    const __m256i prime = _mm256_set1_epi32((int)MW_PRIME32_1);
+
+    for (int i = 0; i < 2; i++) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)acc + i);
+        a = _mm256_xor_si256(a, _mm256_srli_epi64(a, 47));
+        a = _mm256_xor_si256(a, _mm256_loadu_si256((const __m256i *)secret + i));
+        __m256i lo = _mm256_mul_epu32(a, prime);
+        __m256i hi = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), prime);
+        _mm256_storeu_si256((__m256i *)acc + i, _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32)));
+    }
+}
+
+__attribute__((target("avx512f")))
+static void accumulate_avx512(uint64_t *acc, const uint8_t *in, const uint8_t *secret,
+                              size_t nb_stripes) {
+    __m512i a = _mm512_loadu_si512(acc);
+
+    for (size_t n = 0; n < nb_stripes; n++) {
+        __builtin_prefetch(in + n * MW_STRIPE_LEN + MW_PREFETCH_DIST);
+        __m512i d = _mm512_loadu_si512(in + n * MW_STRIPE_LEN);
+        __m512i k = _mm512_xor_si512(d, _mm512_loadu_si512(secret + n * MW_SECRET_CONSUME));
+        __m512i m = _mm512_mul_epu32(k, _mm512_srli_epi64(k, 32));
+        a = _mm512_add_epi64(a, _mm512_add_epi64(m, _mm512_shuffle_epi32(d, (_MM_PERM_ENUM)_MM_SHUFFLE(1, 0, 3, 2))));
+    }
+
+    _mm512_storeu_si512(acc, a);
+}
+
+__attribute__((target("avx512f")))
+static void scramble_avx512(uint64_t *acc, const uint8_t *secret) {
+    const __m512i prime = _mm512_set1_epi32((int)MW_PRIME32_1);
+    __m512i a = _mm512_loadu_si512(acc);
+    a = _mm512_xor_si512(a, _mm512_srli_epi64(a, 47));
+    a = _mm512_xor_si512(a, _mm512_loadu_si512(secret));
+    __m512i lo = _mm512_mul_epu32(a, prime);
+    __m512i hi = _mm512_mul_epu32(_mm512_srli_epi64(a, 32), prime);
+    _mm512_storeu_si512(acc, _mm512_add_epi64(lo, _mm512_slli_epi64(hi, 32)));
+}
+
+static const hash_kernel_t kernel_sse2 = { "sse2", accumulate_sse2, scramble_sse2 };
+static const hash_kernel_t kernel_avx2 = { "avx2", accumulate_avx2, scramble_avx2 };
+static const hash_kernel_t kernel_avx512 = { "avx512", accumulate_avx512, scramble_avx512 };
+
+#endif /* MW_HASH_X86 */
+
+#ifdef MW_HASH_ARM64
+
+static void accumulate_neon(uint64_t *acc, const uint8_t *in, const uint8_t *secret,
+                            size_t nb_stripes) {
+    uint64x2_t a[4];
+    for (int i = 0; i < 4; i++) a[i] = vld1q_u64(acc + 2 * i);
+
+    for (size_t n = 0; n < nb_stripes; n++) {
+        const uint8_t *p = in + n * MW_STRIPE_LEN;
+        const uint8_t *s = secret + n * MW_SECRET_CONSUME;
+        __builtin_prefetch(p + MW_PREFETCH_DIST);
+
+        for (int i = 0; i < 4; i++) {
+            uint64x2_t data_vec = vreinterpretq_u64_u8(vld1q_u8(p + 16 * i));
+            uint64x2_t data_key = veorq_u64(data_vec, vreinterpretq_u64_u8(vld1q_u8(s + 16 * i)));
+            uint32x2_t key_lo = vmovn_u64(data_key);
+            uint32x2_t key_hi = vshrn_n_u64(data_key, 32);
+            uint64x2_t swapped = vextq_u64(data_vec, data_vec, 1);
+            a[i] = vaddq_u64(a[i], vaddq_u64(vmull_u32(key_lo, key_hi), swapped));
+        }
+    }
+
+    for (int i = 0; i < 4; i++) vst1q_u64(acc + 2 * i, a[i]);
+}
+
+static void scramble_neon(uint64_t *acc, const uint8_t *secret) {
+    for (int i = 0; i < 4; i++) {
+        uint64x2_t a = vld1q_u64(acc + 2 * i);
+        a = veorq_u64(a, vshrq_n_u64(a, 47));
+        a = veorq_u64(a, vreinterpretq_u64_u8(vld1q_u8(secret + 16 * i)));
+        uint32x2_t lo = vmovn_u64(a);
+        uint32x2_t hi = vshrn_n_u64(a, 32);
+        uint64x2_t prod_hi = vshlq_n_u64(vmull_n_u32(hi, MW_PRIME32_1), 32);
+        vst1q_u64(acc + 2 * i, vmlal_n_u32(prod_hi, lo, MW_PRIME32_1));
+    }
+}
+
+static const hash_kernel_t kernel_neon = { "neon", accumulate_neon, scramble_neon };
+
+#endif /* MW_HASH_ARM64 */
+
+/* ============================================================================
+ * CRC-32C kernels
+ * ============================================================================ */
+
+#define MW_CRC32C_POLY 0x82F63B78U  /* Castagnoli, reflected */
+
+typedef uint32_t (*crc_fn)(uint32_t crc, const uint8_t *p, size_t len);
+
+static uint32_t crc_table[8][256];
+
+static void crc_table_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c >> 1) ^ (MW_CRC32C_POLY & (0U - (c & 1)));
+        }
+        crc_table[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int t = 1; t < 8; t++) {
+            uint32_t prev = crc_table[t - 1][i];
+            crc_table[t][i] = (prev >> 8) ^ crc_table[0][prev & 0xff];
+        }
+    }
+}
+
+/* Slicing-by-8 fallback */
+static uint32_t crc_sw(uint32_t crc, const uint8_t *p, size_t len) {
+    while (len >= 8) {
+        uint64_t w = read64(p) ^ crc;
+        crc = crc_table[7][w & 0xff] ^ crc_table[6][(w >> 8) & 0xff] ^
+              crc_table[5][(w >> 16) & 0xff] ^ crc_table[4][(w >> 24) & 0xff] ^
+              crc_table[3][(w >> 32) & 0xff] ^ crc_table[2][(w >> 40) & 0xff] ^
+              crc_table[1][(w >> 48) & 0xff] ^ crc_table[0][w >> 56];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = (crc >> 8) ^ crc_table[0][(crc ^ *p++) & 0xff];
+    }
+    return crc;
+}
+
+#ifdef MW_HASH_X86
+__attribute__((target("sse4.2")))
+static uint32_t crc_sse42(uint32_t crc, const uint8_t *p, size_t len) {
+#ifdef __x86_64__
+    uint64_t c = crc;
+    while (len >= 8) {
+        c = _mm_crc32_u64(c, read64(p));
+        p += 8;
+        len -= 8;
+    }
+    crc = (uint32_t)c;
+#endif
+    while (len >= 4) {
+        crc = _mm_crc32_u32(crc, read32(p));
+        p += 4;
+        len -= 4;
+    }
+    while (len--) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return crc;
+}
+#endif
+
+#ifdef MW_HASH_ARM64
+__attribute__((target("+crc")))
+static uint32_t crc_armv8(uint32_t crc, const uint8_t *p, size_t len) {
+    while (len >= 8) {
+        crc = __crc32cd(crc, read64(p));
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = __crc32cb(crc, *p++);
+    }
+    return crc;
+}
+#endif
+
+/* ============================================================================
+ * Dispatch
+ * ============================================================================ */
+
+static _Atomic(const hash_kernel_t *) g_hash_kernel;
+static _Atomic(crc_fn) g_crc_kernel;
+static const char *g_crc_name = "table";
+static pthread_once_t g_init_once = PTHREAD_ONCE_INIT;
+
+static const hash_kernel_t *kernel_by_name(const char *name) {
+    if (strcmp(name, "scalar") == 0) return &kernel_scalar;
+#ifdef MW_HASH_X86
+    __builtin_cpu_init();
+    if (strcmp(name, "sse2") == 0 && __builtin_cpu_supports("sse2")) return &kernel_sse2;
+    if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2")) return &kernel_avx2;
+    if (strcmp(name, "avx512") == 0 && __builtin_cpu_supports("avx512f")) return &kernel_avx512;
+#endif
+#ifdef MW_HASH_ARM64
+    if (strcmp(name, "neon") == 0) return &kernel_neon;
+#endif
+    return NULL;
+}
+
+static void do_init(void) {
+    const hash_kernel_t *kernel = &kernel_scalar;
+    crc_fn crc = crc_sw;
+
+    crc_table_init();
+
+#ifdef MW_HASH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        kernel = &kernel_avx512;
+    } else if (__builtin_cpu_supports("avx2")) {
+        kernel = &kernel_avx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        kernel = &kernel_sse2;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        crc = crc_sse42;
+        g_crc_name = "sse4.2";
+    }
+#endif
+#ifdef MW_HASH_ARM64
+    kernel = &kernel_neon;
+    if (getauxval(AT_HWCAP) & HWCAP_CRC32) {
+        crc = crc_armv8;
+        g_crc_name = "armv8";
+    }
+#endif
+
+    const char *forced = getenv("MEMWATCH_HASH_KERNEL");
+    if (forced && kernel_by_name(forced)) {
+        kernel = kernel_by_name(forced);
+    }
+
+    atomic_store_explicit(&g_crc_kernel, crc, memory_order_release);
+    atomic_store_explicit(&g_hash_kernel, kernel, memory_order_release);
+}
+
+void mw_hash_init(void) {
+    pthread_once(&g_init_once, do_init);
+}
+
+/* Select kernels at load time so the first hash pays nothing */
+__attribute__((constructor))
+static void mw_hash_auto_init(void) {
+    mw_hash_init();
+}
+
+static inline const hash_kernel_t *current_kernel(void) {
+    const hash_kernel_t *k = atomic_load_explicit(&g_hash_kernel, memory_order_acquire);
+    if (__builtin_expect(k == NULL, 0)) {
+        mw_hash_init();
+        k = atomic_load_explicit(&g_hash_kernel, memory_order_acquire);
+    }
+    return k;
+}
+
+int mw_hash_set_kernel(const char *name) {
+    mw_hash_init();
+    const hash_kernel_t *k = name ? kernel_by_name(name) : NULL;
+    if (!k) return -1;
+    atomic_store_explicit(&g_hash_kernel, k, memory_order_release);
+    return 0;
+}
+
+const char *mw_hash_kernel_name(void) {
+    return current_kernel()->name;
+}
+
+const char *mw_crc32c_kernel_name(void) {
+    mw_hash_init();
+    return g_crc_name;
+}
+
+/* ============================================================================
+ * Public entry points
+ * ============================================================================ */
+
+static uint64_t hash_long(const uint8_t *p, size_t len, const hash_kernel_t *k) {
+    uint64_t acc[8] __attribute__((aligned(64))) = {
+        MW_PRIME32_3, MW_PRIME64_1, MW_PRIME64_2, MW_PRIME64_3,
+        MW_PRIME64_4, MW_PRIME32_2, MW_PRIME64_5, MW_PRIME32_1
+    };
+
+    size_t nb_blocks = (len - 1) / MW_BLOCK_LEN;
+    for (size_t b = 0; b < nb_blocks; b++) {
+        k->accumulate(acc, p + b * MW_BLOCK_LEN, mw_secret, MW_STRIPES_PER_BLOCK);
+        k->scramble(acc, mw_secret + MW_SECRET_SIZE - MW_STRIPE_LEN);
+    }
+
+    /* Partial last block, then the final (possibly overlapping) stripe */
+    size_t nb_stripes = ((len - 1) - MW_BLOCK_LEN * nb_blocks) / MW_STRIPE_LEN;
+    k->accumulate(acc, p + nb_blocks * MW_BLOCK_LEN, mw_secret, nb_stripes);
+    k->accumulate(acc, p + len - MW_STRIPE_LEN, mw_secret + MW_SECRET_SIZE - MW_STRIPE_LEN - 7, 1);
+
+    uint64_t result = len * MW_PRIME64_1;
+    for (size_t i = 0; i < 4; i++) {
+        const uint8_t *s = mw_secret + 11 + 16 * i;
+        result += mul128_fold64(acc[2 * i] ^ read64(s), acc[2 * i + 1] ^ read64(s + 8));
+    }
+    return avalanche(result);
+}
+
+uint64_t mw_hash64(const void *data, size_t len) {
+    const uint8_t *p = data;
+
+    if (len <= 16) return hash_0to16(p, len, mw_secret);
+    if (len <= 128) return hash_17to128(p, len, mw_secret);
+    if (len <= MW_MIDSIZE_MAX) return hash_129to240(p, len, mw_secret);
+    return hash_long(p, len, current_kernel());
+}
+
+uint32_t mw_crc32c(uint32_t crc, const void *data, size_t len) {
+    crc_fn fn = atomic_load_explicit(&g_crc_kernel, memory_order_acquire);
+    if (__builtin_expect(fn == NULL, 0)) {
+        mw_hash_init();
+        fn = atomic_load_explicit(&g_crc_kernel, memory_order_acquire);
+    }
+    return ~fn(~crc, data, len);
+}
@@ -0,0 +1,271 @@
+/*
+ * memwatch_lz4.c - LZ4 block compression for memwatch logs
+ *
+ * A block is a run of sequences: a token byte (literal count in the high
+ * nibble, match length - 4 in the low one, 15 meaning "more length bytes
+ * follow"), the literals, then a 16-bit little-endian match offset. The
+ * last sequence is literals only; the format requires the last 5 bytes to
+ * be literals and no match to start in the last 12.
+ *
+ * The encoder hashes each 4-byte position into a table of recent offsets
+ * and takes the first verified match, skipping ahead faster the longer it
+ * goes without one, so incompressible data costs little.
+ *
+ * With a dictionary the block behaves as if the dictionary came right
+ * before it: offsets may reach back into it, and a match found there may
+ * run on into the block. Its positions are hashed once, into a table of
+ * its own that the encoder consults when the block's table misses.
+ */
+
+#include <string.h>
+#include "memwatch_lz4.h"
+
+#define LZ4_MIN_MATCH 4
+#define LZ4_MF_LIMIT 12                     /* No match starts in the last 12 bytes */
+#define LZ4_LAST_LITERALS 5
+#define LZ4_MAX_OFFSET 65535
+#define LZ4_HASH_LOG 12
+#define LZ4_SKIP_TRIGGER 6                  /* Step grows every 2^6 misses */
+
+static inline uint32_t read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t lz4_hash(uint32_t v) {
+    return (v * 2654435761U) >> (32 - LZ4_HASH_LOG);
+}
+
+static uint8_t *put_length(uint8_t *op, size_t len) {
+    for (len -= 15; len >= 255; len -= 255) {
+        *op++ = 255;
+    }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+/* Room for a sequence: token, length bytes, literals, offset */
+static inline int fits(const uint8_t *op, const uint8_t *oend, size_t literals, size_t match) {
+    size_t need = 1 + literals + literals / 255 + 1 + 2 + match / 255 + 1;
+    return (size_t)(oend - op) >= need;
+}
+
+void mw_lz4_dict_load(mw_lz4_dict_t *dict, const void *data, size_t len) {
+    if (len > MW_LZ4_DICT_MAX) {
+        data = (const uint8_t *)data + (len - MW_LZ4_DICT_MAX);
+        len = MW_LZ4_DICT_MAX;
+    }
+    dict->data = (const uint8_t *)data;
+    dict->len = len;
+    memset(dict->table, 0, sizeof(dict->table));
+    for (size_t i = 0; i + LZ4_MIN_MATCH <= len; i++) {
+        dict->table[lz4_hash(read32(dict->data + i))] = (uint32_t)i + 1;
+    }
+}
+
+/* Always inlined, so that without a dictionary its branches fold away */
+static inline __attribute__((always_inline))
+size_t lz4_compress(const mw_lz4_dict_t *dict, const void *src, size_t len, void *dst, size_t capacity) {
+    const uint8_t *base = (const uint8_t *)src;
+    const uint8_t *ip = base;
+    const uint8_t *anchor = base;
+    const uint8_t *iend = base + len;
+    uint8_t *op = (uint8_t *)dst;
+    uint8_t *oend = op + capacity;
+    
+    if (len > LZ4_MF_LIMIT) {
+        const uint8_t *mf_limit = iend - LZ4_MF_LIMIT;
+        const uint8_t *match_limit = iend - LZ4_LAST_LITERALS;
+        uint32_t table[1 << LZ4_HASH_LOG];
+        memset(table, 0, sizeof(table));
+        unsigned misses = 1 << LZ4_SKIP_TRIGGER;
+        
+        ip++;
+        while (ip < mf_limit) {
+            uint32_t seq = read32(ip);
+            uint32_t h = lz4_hash(seq);
+            const uint8_t *ref = base + table[h];
+            table[h] = (uint32_t)(ip - base);
+            
+            /* Candidates in the block and in the dictionary, each extended
+             * backwards into the pending literals, then forwards; the
+             * longer one wins */
+            const uint8_t *start = NULL, *mp = NULL;
+            uint32_t offset = 0;
+            if (ref < ip && ip - ref <= LZ4_MAX_OFFSET && read32(ref) == seq) {
+                const uint8_t *sp = ip;
+                while (sp > anchor && ref > base && sp[-1] == ref[-1]) {
+                    sp--;
+                    ref--;
+                }
+                const uint8_t *ep = ip + LZ4_MIN_MATCH;
+                const uint8_t *rp = ref + (ep - sp);
+                while (ep < match_limit && *ep == *rp) {
+                    ep++;
+                    rp++;
+                }
+                start = sp;
+                mp = ep;
+                offset = (uint32_t)(sp - ref);
+            }
+            if (dict && dict->table[h] &&
+                (size_t)(ip - base) + dict->len - (dict->table[h] - 1) <= LZ4_MAX_OFFSET &&
+                read32(dict->data + dict->table[h] - 1) == seq) {
+                const uint8_t *dend = dict->data + dict->len;
+                const uint8_t *dref = dict->data + dict->table[h] - 1;
+                const uint8_t *sp = ip;
+                while (sp > anchor && dref > dict->data && sp[-1] == dref[-1]) {
+                    sp--;
+                    dref--;
+                }
+                const uint8_t *ep = ip + LZ4_MIN_MATCH;
+                const uint8_t *rp = dref + (ep - sp);
+                while (ep < match_limit && rp < dend && *ep == *rp) {
+                    ep++;
+                    rp++;
+                }
+                if (rp == dend) {
+                    for (rp = base; ep < match_limit && *ep == *rp; ep++, rp++) {
+                    }
+                }
+                if (!mp || ep - sp > mp - start) {
+                    start = sp;
+                    mp = ep;
+                    offset = (uint32_t)((size_t)(sp - base) + (size_t)(dend - dref));
+                }
+            }
+            if (!mp) {
+                ip += misses++ >> LZ4_SKIP_TRIGGER;
+                continue;
+            }
+            ip = start;
+            misses = 1 << LZ4_SKIP_TRIGGER;
+            
+            size_t literals = (size_t)(ip - anchor);
+            size_t match = (size_t)(mp - ip) - LZ4_MIN_MATCH;
+            if (!fits(op, oend, literals, match)) return 0;
+            
+            uint8_t *token = op++;
+            if (literals >= 15) {
+                *token = 15 << 4;
+                op = put_length(op, literals);
+            } else {
+                *token = (uint8_t)(literals << 4);
+            }
+            memcpy(op, anchor, literals);
+            op += literals;
+            *op++ = (uint8_t)offset;
+            *op++ = (uint8_t)(offset >> 8);
+            if (match >= 15) {
+                *token |= 15;
+                op = put_length(op, match);
+            } else {
+                *token |= (uint8_t)match;
+            }
+            
+            ip = anchor = mp;
+            if (ip < mf_limit) {
+                table[lz4_hash(read32(ip - 2))] = (uint32_t)(ip - 2 - base);
+            }
+        }
+    }
+    
+    /* Final literals-only sequence */
+    size_t literals = (size_t)(iend - anchor);
+    if ((size_t)(oend - op) < 1 + literals + literals / 255 + 1) return 0;
+    if (literals >= 15) {
+        *op++ = 15 << 4;
+        op = put_length(op, literals);
+    } else {
+        *op++ = (uint8_t)(literals << 4);
+    }
+    memcpy(op, anchor, literals);
+    op += literals;
+    return (size_t)(op - (uint8_t *)dst);
+}
+
+size_t mw_lz4_compress(const void *src, size_t len, void *dst, size_t capacity) {
+    return lz4_compress(NULL, src, len, dst, capacity);
+}
+
+size_t mw_lz4_compress_dict(const mw_lz4_dict_t *dict, const void *src, size_t len,
+                            void *dst, size_t capacity) {
+    return lz4_compress(dict && dict->len >= LZ4_MIN_MATCH ? dict : NULL, src, len, dst, capacity);
+}
+
+/* Read a length continuation; -1 if it runs off the input */
+static inline int get_length(const uint8_t **ip, const uint8_t *iend, size_t *len) {
+    uint8_t b;
+    do {
+        if (*ip >= iend) return -1;
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+    return 0;
+}
+
+static inline __attribute__((always_inline))
+long lz4_decompress(const uint8_t *dict, size_t dict_len, const void *src, size_t len,
+                    void *dst, size_t capacity) {
+    const uint8_t *ip = (const uint8_t *)src;
+    const uint8_t *iend = ip + len;
+    uint8_t *out = (uint8_t *)dst;
+    uint8_t *op = out;
+    uint8_t *oend = out + capacity;
+    
+    while (ip < iend) {
+        uint8_t token = *ip++;
+        
+        size_t literals = token >> 4;
+        if (literals == 15 && get_length(&ip, iend, &literals) < 0) return -1;
+        if (literals > (size_t)(iend - ip) || literals > (size_t)(oend - op)) return -1;
+        memcpy(op, ip, literals);
+        op += literals;
+        ip += literals;
+        if (ip == iend) break;              /* Last sequence: literals only */
+        
+        if (iend - ip < 2) return -1;
+        size_t offset = (size_t)ip[0] | (size_t)ip[1] << 8;
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - out) + dict_len) return -1;
+        
+        size_t match = token & 15;
+        if (match == 15 && get_length(&ip, iend, &match) < 0) return -1;
+        match += LZ4_MIN_MATCH;
+        if (match > (size_t)(oend - op)) return -1;
+        
+        if (offset > (size_t)(op - out)) {
+            /* Starts in the dictionary, may run on into the block */
+            size_t back = offset - (size_t)(op - out);
+            size_t from_dict = back < match ? back : match;
+            memcpy(op, dict + dict_len - back, from_dict);
+            op += from_dict;
+            match -= from_dict;
+            for (const uint8_t *ref = out; match--; ) *op++ = *ref++;
+            continue;
+        }
+        
+        const uint8_t *ref = op - offset;
+        if (offset >= match) {
+            memcpy(op, ref, match);
+            op += match;
+        } else {
+            while (match--) *op++ = *ref++;     /* Overlapping: repeats the last offset bytes */
+        }
+    }
+    return (long)(op - out);
+}
+
+long mw_lz4_decompress(const void *src, size_t len, void *dst, size_t capacity) {
+    return lz4_decompress(NULL, 0, src, len, dst, capacity);
+}
+
+long mw_lz4_decompress_dict(const void *dict, size_t dict_len, const void *src, size_t len,
+                            void *dst, size_t capacity) {
+    if (dict_len > MW_LZ4_DICT_MAX) {
+        dict = (const uint8_t *)dict + (dict_len - MW_LZ4_DICT_MAX);
+        dict_len = MW_LZ4_DICT_MAX;
+    }
+    return lz4_decompress((const uint8_t *)dict, dict ? dict_len : 0, src, len, dst, capacity);
+}
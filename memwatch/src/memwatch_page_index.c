@@ -0,0 +1,263 @@
+/*
+ * memwatch_page_index.c - Lock-free, signal-safe page index
+ *
+ * Readers load the table pointer once and probe at most
+ * MW_PAGE_INDEX_MAX_PROBE slots using only atomic loads, which is safe
+ * from a SIGSEGV handler. Writers (serialized by the caller) never reuse
+ * a tombstone in place: an empty slot therefore always terminates a probe
+ * sequence, and a reader can never observe a key paired with another
+ * key's value. Tombstones are reclaimed when the table is rebuilt.
+ *
+ * A rebuilt table replaces the old one under a grace period: a reader
+ * counts itself in readers[epoch & 1] and re-checks the epoch before it
+ * loads the table pointer. The writer publishes the new table, bumps the
+ * epoch and waits for the old parity's count to reach zero; anyone still
+ * counted there may hold the old table, anyone after the bump sees the new
+ * one. All of it is sequentially consistent, which the handshake needs.
+ */
+
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include "memwatch_page_index.h"
+
+#define MW_PAGE_SHIFT 12
+#define MW_FIB_MULT   0x9E3779B97F4A7C15ULL
+
+static size_t next_power_of_two(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+static unsigned log2_of(size_t pow2) {
+    unsigned r = 0;
+    while (pow2 > 1) {
+        pow2 >>= 1;
+        r++;
+    }
+    return r;
+}
+
+static inline size_t home_slot(const mw_page_table_t *t, uintptr_t page_start) {
+    /* Fibonacci hashing on the page number spreads sequential pages evenly */
+    uint64_t h = (uint64_t)(page_start >> MW_PAGE_SHIFT) * MW_FIB_MULT;
+    return (size_t)(h >> t->shift) & t->mask;
+}
+
+static size_t table_bytes(size_t capacity) {
+    return sizeof(mw_page_table_t) + capacity * sizeof(mw_page_slot_t);
+}
+
+static mw_page_table_t *table_alloc(size_t capacity) {
+    mw_page_table_t *t = calloc(1, table_bytes(capacity));
+    if (!t) return NULL;
+    t->capacity = capacity;
+    t->mask = capacity - 1;
+    t->shift = 64 - log2_of(capacity);
+    return t;
+}
+
+/* Place a key into a private (not yet published) table */
+static int table_place(mw_page_table_t *t, uintptr_t page_start, void *value) {
+    size_t home = home_slot(t, page_start);
+    for (size_t i = 0; i < MW_PAGE_INDEX_MAX_PROBE; i++) {
+        mw_page_slot_t *slot = &t->slots[(home + i) & t->mask];
+        if (atomic_load_explicit(&slot->key, memory_order_relaxed) == MW_PAGE_INDEX_EMPTY) {
+            atomic_store_explicit(&slot->value, value, memory_order_relaxed);
+            atomic_store_explicit(&slot->key, page_start, memory_order_relaxed);
+            return 0;
+        }
+    }
+    return -1;  /* probe bound exceeded */
+}
+
+/* Grace period: return once no reader can still hold a table unpublished before the call */
+static void wait_for_readers(mw_page_index_t *idx) {
+    unsigned epoch = atomic_fetch_add(&idx->epoch, 1);
+    while (atomic_load(&idx->readers[epoch & 1]) != 0) {
+        sched_yield();
+    }
+}
+
+/* Rebuild into a table of at least min_capacity slots, publish it, free the old one */
+static int index_rebuild(mw_page_index_t *idx, size_t min_capacity) {
+    mw_page_table_t *old = atomic_load_explicit(&idx->table, memory_order_relaxed);
+    size_t capacity = next_power_of_two(min_capacity);
+
+    for (;;) {
+        mw_page_table_t *t = table_alloc(capacity);
+        if (!t) return -1;
+
+        int ok = 1;
+        for (size_t i = 0; i < old->capacity && ok; i++) {
+            uintptr_t key = atomic_load_explicit(&old->slots[i].key, memory_order_relaxed);
+            if (key == MW_PAGE_INDEX_EMPTY || key == MW_PAGE_INDEX_TOMBSTONE) continue;
+            void *value = atomic_load_explicit(&old->slots[i].value, memory_order_relaxed);
+            ok = (table_place(t, key, value) == 0);
+        }
+
+        if (!ok) {
+            /* Pathological clustering - try again with more room */
+            free(t);
+            capacity <<= 1;
+            continue;
+        }
+
+        atomic_store(&idx->table, t);
+        wait_for_readers(idx);
+        free(old);
+        idx->used = idx->live;
+        atomic_fetch_add(&idx->grow_count, 1);
+        return 0;
+    }
+}
+
+int mw_page_index_init(mw_page_index_t *idx, size_t initial_capacity) {
+    if (initial_capacity < MW_PAGE_INDEX_MIN_CAPACITY) {
+        initial_capacity = MW_PAGE_INDEX_MIN_CAPACITY;
+    }
+
+    mw_page_table_t *t = table_alloc(next_power_of_two(initial_capacity));
+    if (!t) return -1;
+
+    atomic_store(&idx->table, t);
+    atomic_store(&idx->epoch, 0);
+    atomic_store(&idx->readers[0], 0);
+    atomic_store(&idx->readers[1], 0);
+    idx->live = 0;
+    idx->used = 0;
+    atomic_store(&idx->grow_count, 0);
+    return 0;
+}
+
+void mw_page_index_destroy(mw_page_index_t *idx) {
+    free(atomic_load(&idx->table));
+    atomic_store(&idx->table, NULL);
+    idx->live = 0;
+    idx->used = 0;
+}
+
+void *mw_page_index_get(const mw_page_index_t *idx, uintptr_t page_start) {
+    if (page_start <= MW_PAGE_INDEX_TOMBSTONE) return NULL;
+
+    /* Enter the read side: counted under an epoch no swap has moved past yet */
+    atomic_uint *readers;
+    for (;;) {
+        unsigned epoch = atomic_load((atomic_uint *)&idx->epoch);
+        readers = (atomic_uint *)&idx->readers[epoch & 1];
+        atomic_fetch_add(readers, 1);
+        if (atomic_load((atomic_uint *)&idx->epoch) == epoch) break;
+        atomic_fetch_sub(readers, 1);  /* the table was swapped meanwhile */
+    }
+
+    void *value = NULL;
+    mw_page_table_t *t = atomic_load((_Atomic(mw_page_table_t *) *)&idx->table);
+    if (t) {
+        size_t home = home_slot(t, page_start);
+        for (size_t i = 0; i < MW_PAGE_INDEX_MAX_PROBE; i++) {
+            mw_page_slot_t *slot = &t->slots[(home + i) & t->mask];
+            uintptr_t key = atomic_load_explicit(&slot->key, memory_order_acquire);
+            if (key == page_start) {
+                value = atomic_load_explicit(&slot->value, memory_order_acquire);
+                break;
+            }
+            if (key == MW_PAGE_INDEX_EMPTY) break;
+        }
+    }
+
+    atomic_fetch_sub(readers, 1);
+    return value;
+}
+
+int mw_page_index_put(mw_page_index_t *idx, uintptr_t page_start, void *value) {
+    if (page_start <= MW_PAGE_INDEX_TOMBSTONE || !value) return -1;
+
+    mw_page_table_t *t = atomic_load_explicit(&idx->table, memory_order_relaxed);
+
+    /* Replace in place if already indexed */
+    size_t home = home_slot(t, page_start);
+    for (size_t i = 0; i < MW_PAGE_INDEX_MAX_PROBE; i++) {
+        mw_page_slot_t *slot = &t->slots[(home + i) & t->mask];
+        uintptr_t key = atomic_load_explicit(&slot->key, memory_order_relaxed);
+        if (key == page_start) {
+            atomic_store_explicit(&slot->value, value, memory_order_release);
+            return 0;
+        }
+        if (key == MW_PAGE_INDEX_EMPTY) break;
+    }
+
+    /* Keep the load factor (live + tombstones) at or below 1/2 */
+    if ((idx->used + 1) * 2 > t->capacity) {
+        size_t want = (idx->live + 1) * 2;
+        if (want < t->capacity && idx->used > idx->live * 2) {
+            want = t->capacity;              /* mostly tombstones: same size */
+        } else if (want <= t->capacity) {
+            want = t->capacity << 1;
+        }
+        if (index_rebuild(idx, want) < 0) return -1;
+        t = atomic_load_explicit(&idx->table, memory_order_relaxed);
+    }
+
+    for (;;) {
+        home = home_slot(t, page_start);
+        for (size_t i = 0; i < MW_PAGE_INDEX_MAX_PROBE; i++) {
+            mw_page_slot_t *slot = &t->slots[(home + i) & t->mask];
+            if (atomic_load_explicit(&slot->key, memory_order_relaxed) == MW_PAGE_INDEX_EMPTY) {
+                /* Value first, then key: readers that see the key see the value */
+                atomic_store_explicit(&slot->value, value, memory_order_relaxed);
+                atomic_store_explicit(&slot->key, page_start, memory_order_release);
+                idx->live++;
+                idx->used++;
+                return 0;
+            }
+        }
+
+        /* No empty slot within the probe bound - grow and retry */
+        if (index_rebuild(idx, t->capacity << 1) < 0) return -1;
+        t = atomic_load_explicit(&idx->table, memory_order_relaxed);
+    }
+}
+
+void *mw_page_index_remove(mw_page_index_t *idx, uintptr_t page_start) {
+    if (page_start <= MW_PAGE_INDEX_TOMBSTONE) return NULL;
+
+    mw_page_table_t *t = atomic_load_explicit(&idx->table, memory_order_relaxed);
+    size_t home = home_slot(t, page_start);
+
+    for (size_t i = 0; i < MW_PAGE_INDEX_MAX_PROBE; i++) {
+        mw_page_slot_t *slot = &t->slots[(home + i) & t->mask];
+        uintptr_t key = atomic_load_explicit(&slot->key, memory_order_relaxed);
+        if (key == page_start) {
+            void *value = atomic_load_explicit(&slot->value, memory_order_relaxed);
+            atomic_store_explicit(&slot->key, MW_PAGE_INDEX_TOMBSTONE, memory_order_release);
+            idx->live--;
+            return value;
+        }
+        if (key == MW_PAGE_INDEX_EMPTY) break;
+    }
+    return NULL;
+}
+
+void mw_page_index_for_each(mw_page_index_t *idx,
+                            void (*fn)(uintptr_t page_start, void *value, void *ctx),
+                            void *ctx) {
+    mw_page_table_t *t = atomic_load_explicit(&idx->table, memory_order_relaxed);
+    if (!t) return;
+
+    for (size_t i = 0; i < t->capacity; i++) {
+        uintptr_t key = atomic_load_explicit(&t->slots[i].key, memory_order_relaxed);
+        if (key == MW_PAGE_INDEX_EMPTY || key == MW_PAGE_INDEX_TOMBSTONE) continue;
+        fn(key, atomic_load_explicit(&t->slots[i].value, memory_order_relaxed), ctx);
+    }
+}
+
+size_t mw_page_index_count(const mw_page_index_t *idx) {
+    return idx->live;
+}
+
+size_t mw_page_index_memory_bytes(const mw_page_index_t *idx) {
+    mw_page_table_t *t = atomic_load_explicit((_Atomic(mw_page_table_t *) *)&idx->table,
+                                              memory_order_relaxed);
+    return t ? table_bytes(t->capacity) : 0;
+}
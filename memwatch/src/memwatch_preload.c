@@ -2,16 +2,74 @@
  * memwatch_preload.c - LD_PRELOAD library for automatic program instrumentation
  * 
  * Usage: LD_PRELOAD=./libmemwatch.so MEMWATCH_DB=data.db MEMWATCH_VARS=1 ./program
+ *
+ * With MEMWATCH_AUTO_TRACK=1, heap allocations are tracked automatically.
+ * Selected allocations are served from a page-isolated arena (see
+ * memwatch_arena.h) so watching them never catches unrelated heap writes;
+ * free()/realloc() stop tracking them. Selection, read once at startup:
+ *   MEMWATCH_TRACK_MIN_SIZE  smallest tracked request (default: page size)
+ *   MEMWATCH_TRACK_MAX_SIZE  largest tracked request (default/cap: 1 MB)
+ *   MEMWATCH_TRACK_SAMPLE    track every Nth eligible allocation per thread
+ *                            (default: 1, every one)
+ * Everything else goes straight to glibc.
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <dlfcn.h>
 #include "memwatch_tracker.h"
+#include "memwatch_arena.h"
+
+#define AUTO_TRACK_MAX_SIZE (1024 * 1024)
+
+extern void *__libc_malloc(size_t);
+extern void *__libc_calloc(size_t, size_t);
+extern void *__libc_realloc(void *, size_t);
+extern void __libc_free(void *);
 
 static int initialized = 0;
 
+/* Auto-track configuration, fixed once the constructor has run */
+static struct {
+    bool enabled;
+    size_t min_size;
+    size_t max_size;
+    unsigned sample_every;
+} g_auto;
+
+static mw_arena_t g_arena;
+static __thread unsigned tl_sample_skip;
+
+static size_t env_size(const char *name, size_t fallback) {
+    const char *value = getenv(name);
+    return value && *value ? (size_t)strtoull(value, NULL, 0) : fallback;
+}
+
+/* Read the auto-track settings and reserve the arena */
+static void auto_track_init(void) {
+    const char *auto_str = getenv("MEMWATCH_AUTO_TRACK");
+    if (!auto_str || !atoi(auto_str)) return;
+
+    g_auto.min_size = env_size("MEMWATCH_TRACK_MIN_SIZE", (size_t)getpagesize());
+    g_auto.max_size = env_size("MEMWATCH_TRACK_MAX_SIZE", AUTO_TRACK_MAX_SIZE);
+    g_auto.sample_every = (unsigned)env_size("MEMWATCH_TRACK_SAMPLE", 1);
+    if (g_auto.min_size == 0) g_auto.min_size = 1;
+    if (g_auto.sample_every == 0) g_auto.sample_every = 1;
+
+    if (mw_arena_init(&g_arena, g_auto.max_size) != 0) {
+        fprintf(stderr, "[memwatch] Auto-track arena unavailable, allocations not tracked\n");
+        return;
+    }
+    g_auto.max_size = g_arena.max_size;
+
+    fprintf(stderr, "[memwatch] Auto-tracking allocations of %zu-%zu bytes, 1 in %u\n",
+            g_auto.min_size, g_auto.max_size, g_auto.sample_every);
+    g_auto.enabled = true;
+}
+
 __attribute__((constructor))
 static void memwatch_init(void) {
     const char *db_path = getenv("MEMWATCH_DB");
@@ -39,6 +97,7 @@ static void memwatch_init(void) {
     }
 
     initialized = 1;
+    auto_track_init();
     fprintf(stderr, "[memwatch] Ready for tracking\n");
 }
 
@@ -46,29 +105,112 @@ __attribute__((destructor))
 static void memwatch_fini(void) {
     if (initialized) {
         fprintf(stderr, "[memwatch] Finalizing...\n");
+        g_auto.enabled = false;  /* arena blocks stay valid for late free() */
         tracker_close();
     }
 }
 
-/* Hook malloc to auto-track allocations if --track-all-vars is enabled */
-void* malloc(size_t size) {
-    extern void *__libc_malloc(size_t);
-    void *ptr = __libc_malloc(size);
-    
-    if (initialized && getenv("MEMWATCH_AUTO_TRACK")) {
+/* Fast path: a few compares, no locks, no system calls */
+static inline bool auto_track_selects(size_t size) {
+    if (__builtin_expect(!g_auto.enabled || tracker_busy, 1) ||
+        size < g_auto.min_size || size > g_auto.max_size) {
+        return false;
+    }
+    if (tl_sample_skip > 0) {
+        tl_sample_skip--;
+        return false;
+    }
+    tl_sample_skip = g_auto.sample_every - 1;
+    return true;
+}
+
+/* Serve a selected allocation from the arena and watch it; NULL on failure */
+static void *tracked_alloc(size_t size) {
+    tracker_busy = TRACKER_BUSY_HOOK;  /* the tracker's own allocations go to glibc */
+
+    void *ptr = mw_arena_alloc(&g_arena, size);
+    if (ptr) {
         char name[64];
         snprintf(name, sizeof(name), "malloc_%p", ptr);
-        
-        /* Allocate in page-aligned chunks for mprotect to work */
-        size_t pagesize = getpagesize();
-        if (size >= pagesize) {
-            tracker_watch((uint64_t)ptr, (size / pagesize) * pagesize, name);
+        int region_id = tracker_watch((uint64_t)(uintptr_t)ptr, size, name);
+        if (region_id < 0) {
+            mw_arena_free(&g_arena, ptr);
+            ptr = NULL;
+        } else {
+            mw_arena_slot(&g_arena, ptr)->tag = region_id;
         }
     }
-    
+
+    tracker_busy = 0;
     return ptr;
 }
 
+static void tracked_free(void *ptr) {
+    int busy = tracker_busy;
+    tracker_busy = busy ? busy : TRACKER_BUSY_HOOK;
+    tracker_unwatch(mw_arena_slot(&g_arena, ptr)->tag);
+    mw_arena_free(&g_arena, ptr);
+    tracker_busy = busy;
+}
+
+/* Hook malloc to auto-track allocations if MEMWATCH_AUTO_TRACK is enabled */
+void* malloc(size_t size) {
+    if (auto_track_selects(size)) {
+        void *ptr = tracked_alloc(size);
+        if (ptr) return ptr;
+    }
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    size_t total;
+    if (!__builtin_mul_overflow(count, size, &total) && auto_track_selects(total)) {
+        void *ptr = tracked_alloc(total);
+        if (ptr) {
+            memset(ptr, 0, total);  /* reused slots keep old contents */
+            return ptr;
+        }
+    }
+    return __libc_calloc(count, size);
+}
+
+void free(void *ptr) {
+    if (mw_arena_owns(&g_arena, ptr)) {
+        tracked_free(ptr);
+        return;
+    }
+    __libc_free(ptr);
+}
+
+void* realloc(void *ptr, size_t size) {
+    if (!mw_arena_owns(&g_arena, ptr)) {
+        return __libc_realloc(ptr, size);
+    }
+    if (size == 0) {
+        tracked_free(ptr);
+        return NULL;
+    }
+
+    /* Move: the new block is selected (and watched) like any allocation */
+    size_t old_size = mw_arena_slot(&g_arena, ptr)->size;
+    void *moved = malloc(size);
+    if (!moved) return NULL;
+    memcpy(moved, ptr, old_size < size ? old_size : size);
+    tracked_free(ptr);
+    return moved;
+}
+
+size_t malloc_usable_size(void *ptr) {
+    static size_t (*real_usable_size)(void *) = NULL;
+    if (mw_arena_owns(&g_arena, ptr)) {
+        return mw_arena_capacity(&g_arena, ptr);
+    }
+    if (!real_usable_size) {
+        real_usable_size = (size_t (*)(void *))dlsym(RTLD_NEXT, "malloc_usable_size");
+    }
+    return real_usable_size ? real_usable_size(ptr) : 0;
+}
+
 /* Hook sqlite3_exec to capture SQL queries */
 typedef int (*sqlite3_exec_func)(void *, const char *, void *, void *, char **);
 static sqlite3_exec_func real_sqlite3_exec = NULL;
@@ -0,0 +1,471 @@
+/*
+ * memwatch_sqlite_sink.c - Batched, asynchronous SQLite writer for events
+ *
+ * Producers encode each row (statement id, then its values) into the
+ * filling half of a double buffer under one mutex. The writer thread
+ * wakes every flush_interval_ms, when the half is half full, or when
+ * someone flushes or waits for space; it swaps the halves, then stores the
+ * full one without the mutex: BEGIN, bind/step/reset each row on its
+ * cached statement, COMMIT. Producers keep filling the other half while
+ * the batch commits.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+#include <sqlite3.h>
+
+#include "memwatch_sqlite_sink.h"
+
+#define DEFAULT_BUFFER_BYTES   (1024 * 1024)
+#define DEFAULT_FLUSH_INTERVAL 100          /* ms */
+#define MIN_BUFFER_BYTES       4096
+
+/* Encoded row: header, then one sink_cell_t per value with its payload */
+typedef struct {
+    uint16_t stmt;
+    uint16_t count;
+    uint32_t size;                /* whole row, header included, 8-aligned */
+} sink_row_t;
+
+typedef struct {
+    uint8_t type;
+    uint8_t pad[3];
+    uint32_t len;                 /* payload bytes (8 for numbers) */
+} sink_cell_t;
+
+typedef struct {
+    uint8_t *data;
+    size_t used;
+    uint64_t rows;
+} sink_buffer_t;
+
+struct mw_sink {
+    sqlite3 *db;
+    sqlite3_stmt *stmts[MW_SINK_MAX_STATEMENTS];
+    int stmt_count;
+    sqlite3_stmt *begin;
+    sqlite3_stmt *commit;
+    sqlite3_stmt *rollback;
+    mw_sink_config_t config;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work;          /* writer: something to do */
+    pthread_cond_t space;         /* producers: the halves were swapped */
+    pthread_cond_t done;          /* flushers: a batch was stored */
+    sink_buffer_t halves[2];
+    sink_buffer_t *fill;          /* under lock */
+    size_t capacity;              /* bytes per half */
+    bool stop;
+    bool urgent;                  /* wake the writer before its interval */
+    pthread_t writer;
+
+    uint64_t queued_seq;          /* rows accepted */
+    uint64_t done_seq;            /* rows stored or failed */
+    mw_sink_stats_t stats;        /* under lock */
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static inline size_t align8(size_t n) {
+    return (n + 7) & ~(size_t)7;
+}
+
+static size_t value_len(const mw_sink_value_t *v) {
+    switch (v->type) {
+    case MW_SINK_INT:
+    case MW_SINK_REAL:
+        return 8;
+    case MW_SINK_TEXT:
+        if (!v->data) return 0;
+        return v->len < 0 ? strlen((const char *)v->data) : (size_t)v->len;
+    case MW_SINK_BLOB:
+        return v->data && v->len > 0 ? (size_t)v->len : 0;
+    default:
+        return 0;
+    }
+}
+
+/* ============================================================================
+ * Writer Thread
+ * ============================================================================ */
+
+/* Run every statement in sql (no sqlite3_exec: see the header) */
+static int exec_simple(sqlite3 *db, const char *sql) {
+    int rc = SQLITE_OK;
+    while (sql && *sql) {
+        sqlite3_stmt *stmt = NULL;
+        const char *tail = NULL;
+        rc = sqlite3_prepare_v3(db, sql, -1, 0, &stmt, &tail);
+        if (rc == SQLITE_OK && stmt) {
+            while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {}
+            if (rc == SQLITE_DONE) rc = SQLITE_OK;
+        }
+        if (rc != SQLITE_OK) {
+            fprintf(stderr, "⚠️  SQLite sink: %s\n", sqlite3_errmsg(db));
+        }
+        sqlite3_finalize(stmt);
+        if (rc != SQLITE_OK) break;
+        sql = tail;
+    }
+    return rc;
+}
+
+static int step_once(sqlite3_stmt *stmt) {
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    return rc == SQLITE_DONE ? SQLITE_OK : rc;
+}
+
+static int bind_row(sqlite3_stmt *stmt, const sink_row_t *row) {
+    const uint8_t *p = (const uint8_t *)row + sizeof(sink_row_t);
+    for (int i = 0; i < row->count; i++) {
+        sink_cell_t cell;
+        memcpy(&cell, p, sizeof(cell));
+        p += sizeof(cell);
+
+        int rc;
+        switch (cell.type) {
+        case MW_SINK_INT: {
+            int64_t v;
+            memcpy(&v, p, 8);
+            rc = sqlite3_bind_int64(stmt, i + 1, v);
+            break;
+        }
+        case MW_SINK_REAL: {
+            double v;
+            memcpy(&v, p, 8);
+            rc = sqlite3_bind_double(stmt, i + 1, v);
+            break;
+        }
+        case MW_SINK_TEXT:
+            /* The half is not reused until the batch is done */
+            rc = sqlite3_bind_text(stmt, i + 1, (const char *)p, (int)cell.len, SQLITE_STATIC);
+            break;
+        case MW_SINK_BLOB:
+            rc = sqlite3_bind_blob(stmt, i + 1, p, (int)cell.len, SQLITE_STATIC);
+            break;
+        default:
+            rc = sqlite3_bind_null(stmt, i + 1);
+            break;
+        }
+        if (rc != SQLITE_OK) return rc;
+        p += align8(cell.len);
+    }
+    return SQLITE_OK;
+}
+
+/* Store one half in a single transaction; returns rows that failed */
+static uint64_t store_batch(mw_sink_t *sink, const sink_buffer_t *batch) {
+    uint64_t failed = 0;
+    bool in_txn = step_once(sink->begin) == SQLITE_OK;
+
+    size_t pos = 0;
+    while (pos < batch->used) {
+        sink_row_t row;
+        memcpy(&row, batch->data + pos, sizeof(row));
+        sqlite3_stmt *stmt = sink->stmts[row.stmt];
+
+        int rc = bind_row(stmt, (const sink_row_t *)(batch->data + pos));
+        if (rc == SQLITE_OK) rc = sqlite3_step(stmt);
+        if (rc != SQLITE_DONE && rc != SQLITE_ROW) {
+            failed++;
+            if (failed == 1) {
+                fprintf(stderr, "⚠️  SQLite sink: insert failed: %s\n", sqlite3_errmsg(sink->db));
+            }
+        }
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+        pos += row.size;
+    }
+
+    if (in_txn && step_once(sink->commit) != SQLITE_OK) {
+        fprintf(stderr, "⚠️  SQLite sink: commit failed: %s\n", sqlite3_errmsg(sink->db));
+        step_once(sink->rollback);
+        failed = batch->rows;
+    }
+    return failed;
+}
+
+static void *writer_main(void *arg) {
+    mw_sink_t *sink = arg;
+    if (sink->config.writer_init) {
+        sink->config.writer_init();
+    }
+
+    pthread_mutex_lock(&sink->lock);
+    for (;;) {
+        if (!sink->stop && !sink->urgent) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            uint64_t ns = (uint64_t)deadline.tv_nsec + (uint64_t)sink->config.flush_interval_ms * 1000000ULL;
+            deadline.tv_sec += (time_t)(ns / 1000000000ULL);
+            deadline.tv_nsec = (long)(ns % 1000000000ULL);
+            while (!sink->stop && !sink->urgent) {
+                if (pthread_cond_timedwait(&sink->work, &sink->lock, &deadline) == ETIMEDOUT) break;
+            }
+        }
+        sink->urgent = false;
+
+        sink_buffer_t *batch = sink->fill;
+        if (batch->rows == 0) {
+            if (sink->stop) break;
+            continue;
+        }
+        sink->fill = batch == &sink->halves[0] ? &sink->halves[1] : &sink->halves[0];
+        pthread_cond_broadcast(&sink->space);
+        pthread_mutex_unlock(&sink->lock);
+
+        uint64_t start = now_ns();
+        uint64_t failed = store_batch(sink, batch);
+        uint64_t elapsed = now_ns() - start;
+
+        pthread_mutex_lock(&sink->lock);
+        sink->stats.rows_written += batch->rows - failed;
+        sink->stats.rows_failed += failed;
+        sink->stats.batches++;
+        sink->stats.commit_ns += elapsed;
+        if (batch->rows > sink->stats.max_batch_rows) sink->stats.max_batch_rows = batch->rows;
+        sink->done_seq += batch->rows;
+        batch->used = 0;
+        batch->rows = 0;
+        pthread_cond_broadcast(&sink->done);
+    }
+    pthread_mutex_unlock(&sink->lock);
+    return NULL;
+}
+
+/* ============================================================================
+ * Public API
+ * ============================================================================ */
+
+mw_sink_t *mw_sink_open(const char *path, const char *schema, const mw_sink_config_t *config) {
+    mw_sink_t *sink = calloc(1, sizeof(*sink));
+    if (!sink) return NULL;
+
+    if (config) sink->config = *config;
+    if (sink->config.buffer_bytes == 0) sink->config.buffer_bytes = DEFAULT_BUFFER_BYTES;
+    if (sink->config.buffer_bytes < MIN_BUFFER_BYTES) sink->config.buffer_bytes = MIN_BUFFER_BYTES;
+    if (sink->config.flush_interval_ms <= 0) sink->config.flush_interval_ms = DEFAULT_FLUSH_INTERVAL;
+    sink->capacity = align8(sink->config.buffer_bytes);
+
+    if (sqlite3_open(path, &sink->db) != SQLITE_OK) {
+        fprintf(stderr, "❌ Cannot open database %s: %s\n", path, sqlite3_errmsg(sink->db));
+        goto fail_db;
+    }
+    sqlite3_busy_timeout(sink->db, 5000);
+
+    /* WAL: readers never block the writer; NORMAL syncs at checkpoints only */
+    exec_simple(sink->db, "PRAGMA journal_mode=WAL");
+    exec_simple(sink->db, "PRAGMA synchronous=NORMAL");
+    if (schema && exec_simple(sink->db, schema) != SQLITE_OK) {
+        goto fail_db;
+    }
+    if (sqlite3_prepare_v3(sink->db, "BEGIN", -1, SQLITE_PREPARE_PERSISTENT, &sink->begin, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v3(sink->db, "COMMIT", -1, SQLITE_PREPARE_PERSISTENT, &sink->commit, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v3(sink->db, "ROLLBACK", -1, SQLITE_PREPARE_PERSISTENT, &sink->rollback, NULL) != SQLITE_OK) {
+        fprintf(stderr, "❌ SQLite sink: %s\n", sqlite3_errmsg(sink->db));
+        goto fail_db;
+    }
+
+    sink->halves[0].data = malloc(sink->capacity);
+    sink->halves[1].data = malloc(sink->capacity);
+    if (!sink->halves[0].data || !sink->halves[1].data) {
+        errno = ENOMEM;
+        goto fail_mem;
+    }
+    sink->fill = &sink->halves[0];
+
+    pthread_mutex_init(&sink->lock, NULL);
+    pthread_cond_init(&sink->work, NULL);
+    pthread_cond_init(&sink->space, NULL);
+    pthread_cond_init(&sink->done, NULL);
+
+    int rc = pthread_create(&sink->writer, NULL, writer_main, sink);
+    if (rc != 0) {
+        pthread_mutex_destroy(&sink->lock);
+        pthread_cond_destroy(&sink->work);
+        pthread_cond_destroy(&sink->space);
+        pthread_cond_destroy(&sink->done);
+        errno = rc;
+        goto fail_mem;
+    }
+    return sink;
+
+fail_db:
+    errno = EIO;
+fail_mem:
+    {
+        int saved = errno;
+        free(sink->halves[0].data);
+        free(sink->halves[1].data);
+        sqlite3_finalize(sink->begin);
+        sqlite3_finalize(sink->commit);
+        sqlite3_finalize(sink->rollback);
+        sqlite3_close(sink->db);
+        free(sink);
+        errno = saved;
+    }
+    return NULL;
+}
+
+int mw_sink_prepare(mw_sink_t *sink, const char *sql) {
+    pthread_mutex_lock(&sink->lock);
+    if (sink->stmt_count >= MW_SINK_MAX_STATEMENTS) {
+        pthread_mutex_unlock(&sink->lock);
+        errno = ENOSPC;
+        return -1;
+    }
+    sqlite3_stmt *stmt = NULL;
+    if (sqlite3_prepare_v3(sink->db, sql, -1, SQLITE_PREPARE_PERSISTENT, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "❌ SQLite sink: cannot prepare %s: %s\n", sql, sqlite3_errmsg(sink->db));
+        pthread_mutex_unlock(&sink->lock);
+        errno = EINVAL;
+        return -1;
+    }
+    int id = sink->stmt_count++;
+    sink->stmts[id] = stmt;
+    pthread_mutex_unlock(&sink->lock);
+    return id;
+}
+
+int mw_sink_write(mw_sink_t *sink, int stmt, const mw_sink_value_t *values, int count) {
+    if (!sink || stmt < 0 || count < 0 || count > MW_SINK_MAX_COLUMNS) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    size_t lens[MW_SINK_MAX_COLUMNS];
+    size_t need = sizeof(sink_row_t);
+    for (int i = 0; i < count; i++) {
+        lens[i] = value_len(&values[i]);
+        need += sizeof(sink_cell_t) + align8(lens[i]);
+    }
+
+    pthread_mutex_lock(&sink->lock);
+    if (stmt >= sink->stmt_count || need > sink->capacity || need > UINT32_MAX) {
+        sink->stats.rows_dropped++;
+        pthread_mutex_unlock(&sink->lock);
+        errno = stmt >= sink->stmt_count ? EINVAL : E2BIG;
+        return -1;
+    }
+
+    if (sink->fill->used + need > sink->capacity) {
+        /* The writer itself (e.g. a callback of SQLite) must never wait on itself */
+        if (sink->config.drop_when_full || pthread_equal(pthread_self(), sink->writer)) {
+            sink->stats.rows_dropped++;
+            sink->urgent = true;
+            pthread_cond_signal(&sink->work);
+            pthread_mutex_unlock(&sink->lock);
+            errno = ENOBUFS;
+            return -1;
+        }
+        /* Backpressure: wait for the writer to take this half */
+        uint64_t start = now_ns();
+        sink->stats.waits++;
+        while (sink->fill->used + need > sink->capacity) {
+            sink->urgent = true;
+            pthread_cond_signal(&sink->work);
+            pthread_cond_wait(&sink->space, &sink->lock);
+        }
+        sink->stats.wait_ns += now_ns() - start;
+    }
+
+    sink_buffer_t *buf = sink->fill;
+    uint8_t *p = buf->data + buf->used;
+    sink_row_t row = { (uint16_t)stmt, (uint16_t)count, (uint32_t)need };
+    memcpy(p, &row, sizeof(row));
+    p += sizeof(row);
+    for (int i = 0; i < count; i++) {
+        sink_cell_t cell = { (uint8_t)values[i].type, {0}, (uint32_t)lens[i] };
+        if (values[i].type == MW_SINK_TEXT && !values[i].data) cell.type = MW_SINK_NULL;
+        memcpy(p, &cell, sizeof(cell));
+        p += sizeof(cell);
+        if (cell.type == MW_SINK_INT) {
+            memcpy(p, &values[i].i, 8);
+        } else if (cell.type == MW_SINK_REAL) {
+            memcpy(p, &values[i].d, 8);
+        } else if (lens[i]) {
+            memcpy(p, values[i].data, lens[i]);
+        }
+        p += align8(lens[i]);
+    }
+
+    size_t before = buf->used;
+    buf->used += need;
+    buf->rows++;
+    sink->queued_seq++;
+    sink->stats.rows_queued++;
+    if (buf->used > sink->stats.max_queued_bytes) sink->stats.max_queued_bytes = buf->used;
+
+    /* Start a commit early once the half is half full */
+    if (before < sink->capacity / 2 && buf->used >= sink->capacity / 2) {
+        sink->urgent = true;
+        pthread_cond_signal(&sink->work);
+    }
+    pthread_mutex_unlock(&sink->lock);
+    return 0;
+}
+
+int mw_sink_flush(mw_sink_t *sink) {
+    if (!sink) return 0;
+    pthread_mutex_lock(&sink->lock);
+    uint64_t target = sink->queued_seq;
+    while (sink->done_seq < target) {
+        sink->urgent = true;
+        pthread_cond_signal(&sink->work);
+        pthread_cond_wait(&sink->done, &sink->lock);
+    }
+    int rc = sink->stats.rows_failed ? -1 : 0;
+    pthread_mutex_unlock(&sink->lock);
+    return rc;
+}
+
+sqlite3 *mw_sink_db(mw_sink_t *sink) {
+    return sink ? sink->db : NULL;
+}
+
+void mw_sink_stats(mw_sink_t *sink, mw_sink_stats_t *stats) {
+    if (!sink) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    pthread_mutex_lock(&sink->lock);
+    *stats = sink->stats;
+    pthread_mutex_unlock(&sink->lock);
+}
+
+void mw_sink_close(mw_sink_t *sink) {
+    if (!sink) return;
+
+    pthread_mutex_lock(&sink->lock);
+    sink->stop = true;
+    pthread_cond_signal(&sink->work);
+    pthread_mutex_unlock(&sink->lock);
+    pthread_join(sink->writer, NULL);   /* stores what is still queued first */
+
+    for (int i = 0; i < sink->stmt_count; i++) {
+        sqlite3_finalize(sink->stmts[i]);
+    }
+    sqlite3_finalize(sink->begin);
+    sqlite3_finalize(sink->commit);
+    sqlite3_finalize(sink->rollback);
+    sqlite3_close(sink->db);
+
+    pthread_mutex_destroy(&sink->lock);
+    pthread_cond_destroy(&sink->work);
+    pthread_cond_destroy(&sink->space);
+    pthread_cond_destroy(&sink->done);
+    free(sink->halves[0].data);
+    free(sink->halves[1].data);
+    free(sink);
+}
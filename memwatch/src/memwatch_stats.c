@@ -0,0 +1,445 @@
+/*
+ * memwatch_stats.c - Live stats page: stage latencies and hot regions/pages
+ *
+ * Every field a reader looks at is written with relaxed atomic stores and
+ * read with relaxed loads, so a reader sees each counter whole but not a
+ * snapshot across counters - good enough for rates and percentiles, and it
+ * never stalls the tracer. Shard counters use atomic adds because threads
+ * past MW_STATS_SHARDS share shards; region and page slots have a single
+ * writer (the worker) and are bumped with a load and a store.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include "memwatch_stats.h"
+
+#define MAX_NAME_LEN     40
+#define MAX_REGION_PROBE 64
+#define MAX_PAGE_PROBE   64
+#define FORGOTTEN        UINT32_MAX
+
+_Static_assert(sizeof(mw_stats_header_t) <= MW_STATS_HEADER_SIZE, "stats header outgrew its page");
+_Static_assert(sizeof(mw_stats_region_t) == 104, "mw_stats_region_t layout changed");
+_Static_assert(sizeof(mw_stats_page_t) == 32, "mw_stats_page_t layout changed");
+_Static_assert((MW_STATS_REGIONS & (MW_STATS_REGIONS - 1)) == 0, "region slots must be a power of two");
+_Static_assert((MW_STATS_PAGES & (MW_STATS_PAGES - 1)) == 0, "page slots must be a power of two");
+
+/* Shard of the calling thread, plus one (0 = none claimed yet) */
+static __thread unsigned tls_shard __attribute__((tls_model("initial-exec")));
+
+static const char *stage_names[MW_STAGE_COUNT] = {
+    "enqueue", "queue_wait", "diff", "callback", "storage",
+};
+
+static int valid_name(const char *name) {
+    size_t len = name ? strlen(name) : 0;
+    if (len == 0 || len > MAX_NAME_LEN) return 0;
+    for (size_t i = 0; i < len; i++) {
+        char c = name[i];
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+              c == '_' || c == '.' || c == '-')) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static size_t shards_offset(void) {
+    return MW_STATS_HEADER_SIZE;
+}
+
+static size_t regions_offset(void) {
+    return shards_offset() + MW_STATS_SHARDS * sizeof(mw_stats_shard_t);
+}
+
+static size_t pages_offset(void) {
+    return regions_offset() + MW_STATS_REGIONS * sizeof(mw_stats_region_t);
+}
+
+static size_t map_size(void) {
+    return pages_offset() + MW_STATS_PAGES * sizeof(mw_stats_page_t);
+}
+
+static void bind_sections(mw_stats_t *stats, void *map) {
+    stats->hdr = map;
+    stats->shards = (mw_stats_shard_t *)((uint8_t *)map + stats->hdr->shards_offset);
+    stats->regions = (mw_stats_region_t *)((uint8_t *)map + stats->hdr->regions_offset);
+    stats->pages = (mw_stats_page_t *)((uint8_t *)map + stats->hdr->pages_offset);
+}
+
+static uint64_t unix_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* Single-writer counter bump, readable mid-update */
+static inline void bump(uint64_t *counter, uint64_t n) {
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+}
+
+/* ============================================================================
+ * Tracer
+ * ============================================================================ */
+
+/* O_EXCL create; a page left behind by a dead or finished tracer is replaced */
+static int create_shared(const char *shm_name) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+        int fd = shm_open(shm_name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+        if (fd >= 0 || errno != EEXIST) return fd;
+
+        int old = shm_open(shm_name, O_RDONLY | O_CLOEXEC, 0);
+        if (old < 0) continue;          /* unlinked meanwhile */
+        mw_stats_header_t hdr = { 0 };
+        ssize_t n = pread(old, &hdr, sizeof(hdr), 0);
+        close(old);
+        bool stale = n != (ssize_t)sizeof(hdr) || hdr.magic != MW_STATS_MAGIC || hdr.closed ||
+                     (kill((pid_t)hdr.pid, 0) != 0 && errno == ESRCH);
+        if (!stale) {
+            errno = EEXIST;
+            return -1;
+        }
+        shm_unlink(shm_name);
+    }
+    errno = EEXIST;
+    return -1;
+}
+
+int mw_stats_open(mw_stats_t *stats, const char *name, const char *engine, const char *backend) {
+    memset(stats, 0, sizeof(*stats));
+    size_t size = map_size();
+    void *map;
+
+    if (name) {
+        if (!valid_name(name)) {
+            errno = EINVAL;
+            return -1;
+        }
+        snprintf(stats->name, sizeof(stats->name), "/memwatch-stats-%s", name);
+        int fd = create_shared(stats->name);
+        if (fd < 0) return -1;
+        if (ftruncate(fd, (off_t)size) != 0) {
+            int saved = errno;
+            close(fd);
+            shm_unlink(stats->name);
+            errno = saved;
+            return -1;
+        }
+        map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (map == MAP_FAILED) {
+            int saved = errno;
+            shm_unlink(stats->name);
+            errno = saved;
+            return -1;
+        }
+        stats->shared = true;
+    } else {
+        /* Untouched slots cost no memory either way */
+        map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (map == MAP_FAILED) return -1;
+    }
+
+    mw_stats_header_t *hdr = map;
+    hdr->version = MW_STATS_VERSION;
+    hdr->header_size = MW_STATS_HEADER_SIZE;
+    hdr->pid = (uint32_t)getpid();
+    hdr->started_unix_ns = unix_ns();
+    hdr->updated_unix_ns = hdr->started_unix_ns;
+    snprintf(hdr->engine, sizeof(hdr->engine), "%s", engine ? engine : "");
+    snprintf(hdr->backend, sizeof(hdr->backend), "%s", backend ? backend : "");
+    hdr->hist_sub_bits = MW_STATS_HIST_SUB_BITS;
+    hdr->hist_buckets = MW_STATS_HIST_BUCKETS;
+    hdr->stage_count = MW_STAGE_COUNT;
+    hdr->shard_count = MW_STATS_SHARDS;
+    hdr->region_slots = MW_STATS_REGIONS;
+    hdr->page_slots = MW_STATS_PAGES;
+    hdr->shard_size = sizeof(mw_stats_shard_t);
+    hdr->region_size = sizeof(mw_stats_region_t);
+    hdr->page_size = sizeof(mw_stats_page_t);
+    hdr->shards_offset = shards_offset();
+    hdr->regions_offset = regions_offset();
+    hdr->pages_offset = pages_offset();
+    __atomic_store_n(&hdr->magic, MW_STATS_MAGIC, __ATOMIC_RELEASE);
+
+    bind_sections(stats, map);
+    stats->map_size = size;
+    stats->owner = true;
+    return 0;
+}
+
+void mw_stats_close(mw_stats_t *stats) {
+    if (!stats->hdr || !stats->owner) return;
+
+    __atomic_store_n(&stats->hdr->closed, 1, __ATOMIC_RELEASE);
+    if (stats->shared) {
+        shm_unlink(stats->name);
+    }
+    munmap(stats->hdr, stats->map_size);
+    memset(stats, 0, sizeof(*stats));
+}
+
+static inline unsigned hist_index(uint64_t v) {
+    if (v < 2 * MW_STATS_HIST_SUB) return (unsigned)v;
+    if (v >> MW_STATS_HIST_MAX_BITS) return MW_STATS_HIST_BUCKETS - 1;
+    unsigned shift = 63 - (unsigned)__builtin_clzll(v) - MW_STATS_HIST_SUB_BITS;
+    return shift * MW_STATS_HIST_SUB + (unsigned)(v >> shift);
+}
+
+/* Highest value that lands in bucket i */
+static inline uint64_t hist_value(unsigned i) {
+    if (i < 2 * MW_STATS_HIST_SUB) return i;
+    unsigned shift = i / MW_STATS_HIST_SUB - 1;
+    uint64_t base = (uint64_t)(i - shift * MW_STATS_HIST_SUB) << shift;
+    return base + ((1ULL << shift) - 1);
+}
+
+/* The calling thread's shard; claims a free one on first use (async-signal-safe) */
+static mw_stats_shard_t *current_shard(mw_stats_t *stats) {
+    int tid = (int)syscall(SYS_gettid);
+    unsigned slot = tls_shard;
+    if (slot && __atomic_load_n(&stats->shards[slot - 1].owner_tid, __ATOMIC_RELAXED) == tid) {
+        return &stats->shards[slot - 1];
+    }
+
+    for (unsigned i = 0; i < MW_STATS_SHARDS; i++) {
+        int32_t expected = 0;
+        if (__atomic_compare_exchange_n(&stats->shards[i].owner_tid, &expected, tid, false,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            tls_shard = i + 1;
+            return &stats->shards[i];
+        }
+    }
+    /* All claimed: share one, picked by thread id */
+    return &stats->shards[(unsigned)tid % MW_STATS_SHARDS];
+}
+
+void mw_stats_record(mw_stats_t *stats, mw_stage_t stage, uint64_t ns) {
+    if (!stats->hdr || (unsigned)stage >= MW_STAGE_COUNT) return;
+
+    mw_stats_hist_t *h = &current_shard(stats)->stages[stage];
+    __atomic_fetch_add(&h->buckets[hist_index(ns)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->sum_ns, ns, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->count, 1, __ATOMIC_RELAXED);
+    uint64_t max = __atomic_load_n(&h->max_ns, __ATOMIC_RELAXED);
+    while (ns > max && !__atomic_compare_exchange_n(&h->max_ns, &max, ns, true,
+                                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+/* Slot of region_id, claiming one if claim; NULL if absent or the table is full */
+static mw_stats_region_t *region_slot(mw_stats_t *stats, uint32_t region_id, bool claim) {
+    uint32_t start = region_id * 2654435761u;
+    mw_stats_region_t *reuse = NULL;
+
+    for (uint32_t k = 0; k < MAX_REGION_PROBE; k++) {
+        mw_stats_region_t *slot = &stats->regions[(start + k) & (MW_STATS_REGIONS - 1)];
+        uint32_t id = __atomic_load_n(&slot->region_id, __ATOMIC_ACQUIRE);
+        if (id == region_id) return slot;
+        if (id == FORGOTTEN && !reuse) reuse = slot;
+        if (id == 0) {
+            if (!reuse) reuse = slot;
+            break;
+        }
+    }
+    if (!claim) return NULL;
+    if (!reuse) {
+        __atomic_fetch_add(&stats->hdr->region_overflow, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    /* Zero the counters before publishing the id: readers skip free slots */
+    __atomic_store_n(&reuse->faults, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&reuse->false_faults, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&reuse->changes, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&reuse->bytes_diffed, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&reuse->level, 0, __ATOMIC_RELAXED);
+    return reuse;
+}
+
+void mw_stats_count_region(mw_stats_t *stats, uint32_t region_id, uint32_t adapter_id,
+                           uint64_t addr, uint64_t size, const char *name,
+                           bool changed, uint64_t bytes_diffed) {
+    if (!stats->hdr || region_id == 0 || region_id == FORGOTTEN) return;
+
+    mw_stats_counters_t *c = &stats->hdr->counters;
+    bump(changed ? &c->changes : &c->false_faults, 1);
+    bump(&c->bytes_diffed, bytes_diffed);
+
+    mw_stats_region_t *slot = region_slot(stats, region_id, true);
+    if (!slot) return;
+    if (__atomic_load_n(&slot->region_id, __ATOMIC_RELAXED) != region_id) {
+        slot->adapter_id = adapter_id;
+        slot->addr = addr;
+        slot->size = size;
+        memset(slot->name, 0, sizeof(slot->name));
+        if (name) strncpy(slot->name, name, sizeof(slot->name) - 1);
+        __atomic_store_n(&slot->region_id, region_id, __ATOMIC_RELEASE);
+    }
+    bump(&slot->faults, 1);
+    bump(changed ? &slot->changes : &slot->false_faults, 1);
+    bump(&slot->bytes_diffed, bytes_diffed);
+}
+
+void mw_stats_region_level(mw_stats_t *stats, uint32_t region_id, uint32_t level) {
+    if (!stats->hdr || region_id == 0 || region_id == FORGOTTEN) return;
+
+    mw_stats_region_t *slot = region_slot(stats, region_id, false);
+    if (slot) {
+        __atomic_store_n(&slot->level, level, __ATOMIC_RELAXED);
+    }
+}
+
+void mw_stats_forget_region(mw_stats_t *stats, uint32_t region_id) {
+    if (!stats->hdr || region_id == 0) return;
+
+    mw_stats_region_t *slot = region_slot(stats, region_id, false);
+    if (slot) {
+        uint32_t expected = region_id;
+        __atomic_compare_exchange_n(&slot->region_id, &expected, FORGOTTEN, false,
+                                    __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+    }
+}
+
+void mw_stats_count_page(mw_stats_t *stats, uint64_t page, uint64_t faults, uint64_t changes) {
+    if (!stats->hdr || page == 0) return;
+
+    bump(&stats->hdr->counters.faults, faults);
+
+    uint32_t start = (uint32_t)((page >> 12) * 2654435761u);
+    for (uint32_t k = 0; k < MAX_PAGE_PROBE; k++) {
+        mw_stats_page_t *slot = &stats->pages[(start + k) & (MW_STATS_PAGES - 1)];
+        uint64_t key = __atomic_load_n(&slot->page, __ATOMIC_ACQUIRE);
+        if (key == 0) {
+            __atomic_store_n(&slot->page, page, __ATOMIC_RELEASE);
+        } else if (key != page) {
+            continue;
+        }
+        bump(&slot->faults, faults);
+        bump(&slot->changes, changes);
+        return;
+    }
+    __atomic_fetch_add(&stats->hdr->page_overflow, 1, __ATOMIC_RELAXED);
+}
+
+void mw_stats_publish(mw_stats_t *stats, const mw_stats_counters_t *gauges) {
+    if (!stats->hdr) return;
+
+    mw_stats_counters_t *c = &stats->hdr->counters;
+    __atomic_store_n(&c->tracked_regions, gauges->tracked_regions, __ATOMIC_RELAXED);
+    __atomic_store_n(&c->tracked_pages, gauges->tracked_pages, __ATOMIC_RELAXED);
+    __atomic_store_n(&c->ring_used, gauges->ring_used, __ATOMIC_RELAXED);
+    __atomic_store_n(&c->ring_capacity, gauges->ring_capacity, __ATOMIC_RELAXED);
+    __atomic_store_n(&c->dropped_events, gauges->dropped_events, __ATOMIC_RELAXED);
+    __atomic_store_n(&c->coalesced_faults, gauges->coalesced_faults, __ATOMIC_RELAXED);
+    __atomic_store_n(&c->native_memory_bytes, gauges->native_memory_bytes, __ATOMIC_RELAXED);
+    __atomic_store_n(&c->worker_wakeups, gauges->worker_wakeups, __ATOMIC_RELAXED);
+    __atomic_store_n(&c->governor_budget_ppm, gauges->governor_budget_ppm, __ATOMIC_RELAXED);
+    __atomic_store_n(&c->governor_overhead_ppm, gauges->governor_overhead_ppm, __ATOMIC_RELAXED);
+    __atomic_store_n(&c->governor_demoted, gauges->governor_demoted, __ATOMIC_RELAXED);
+    __atomic_store_n(&c->governor_demotions, gauges->governor_demotions, __ATOMIC_RELAXED);
+    __atomic_store_n(&c->governor_promotions, gauges->governor_promotions, __ATOMIC_RELAXED);
+    __atomic_store_n(&stats->hdr->updated_unix_ns, unix_ns(), __ATOMIC_RELAXED);
+}
+
+/* ============================================================================
+ * Readers
+ * ============================================================================ */
+
+int mw_stats_attach(mw_stats_t *stats, const char *name) {
+    memset(stats, 0, sizeof(*stats));
+    if (!valid_name(name)) {
+        errno = EINVAL;
+        return -1;
+    }
+    snprintf(stats->name, sizeof(stats->name), "/memwatch-stats-%s", name);
+
+    int fd = shm_open(stats->name, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < MW_STATS_HEADER_SIZE) {
+        close(fd);
+        errno = EPROTO;
+        return -1;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+
+    const mw_stats_header_t *hdr = map;
+    if (__atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) != MW_STATS_MAGIC ||
+        hdr->version != MW_STATS_VERSION || hdr->hist_buckets != MW_STATS_HIST_BUCKETS ||
+        hdr->stage_count != MW_STAGE_COUNT || hdr->shard_count != MW_STATS_SHARDS ||
+        hdr->region_slots != MW_STATS_REGIONS || hdr->page_slots != MW_STATS_PAGES ||
+        hdr->pages_offset + MW_STATS_PAGES * sizeof(mw_stats_page_t) > (uint64_t)st.st_size) {
+        munmap(map, (size_t)st.st_size);
+        errno = EPROTO;
+        return -1;
+    }
+
+    bind_sections(stats, map);
+    stats->map_size = (size_t)st.st_size;
+    stats->shared = true;
+    return 0;
+}
+
+void mw_stats_detach(mw_stats_t *stats) {
+    if (!stats->hdr || stats->owner) return;
+    munmap(stats->hdr, stats->map_size);
+    memset(stats, 0, sizeof(*stats));
+}
+
+void mw_stats_hist(const mw_stats_t *stats, mw_stage_t stage, mw_stats_hist_t *out) {
+    memset(out, 0, sizeof(*out));
+    if (!stats->hdr || (unsigned)stage >= MW_STAGE_COUNT) return;
+
+    for (unsigned s = 0; s < MW_STATS_SHARDS; s++) {
+        const mw_stats_hist_t *h = &stats->shards[s].stages[stage];
+        uint64_t count = __atomic_load_n(&h->count, __ATOMIC_RELAXED);
+        if (count == 0) continue;
+        out->count += count;
+        out->sum_ns += __atomic_load_n(&h->sum_ns, __ATOMIC_RELAXED);
+        uint64_t max = __atomic_load_n(&h->max_ns, __ATOMIC_RELAXED);
+        if (max > out->max_ns) out->max_ns = max;
+        for (unsigned i = 0; i < MW_STATS_HIST_BUCKETS; i++) {
+            out->buckets[i] += __atomic_load_n(&h->buckets[i], __ATOMIC_RELAXED);
+        }
+    }
+}
+
+uint64_t mw_stats_hist_percentile(const mw_stats_hist_t *hist, double pct) {
+    uint64_t total = 0;
+    for (unsigned i = 0; i < MW_STATS_HIST_BUCKETS; i++) total += hist->buckets[i];
+    if (total == 0) return 0;
+
+    /* Buckets, not count: a sample may be mid-record while a reader sums */
+    uint64_t rank = (uint64_t)(pct / 100.0 * (double)total + 0.999999);
+    if (rank == 0) rank = 1;
+    if (rank > total) rank = total;
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < MW_STATS_HIST_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen >= rank) {
+            uint64_t v = hist_value(i);
+            return v < hist->max_ns || hist->max_ns == 0 ? v : hist->max_ns;
+        }
+    }
+    return hist->max_ns;
+}
+
+const char *mw_stats_stage_name(mw_stage_t stage) {
+    return (unsigned)stage < MW_STAGE_COUNT ? stage_names[stage] : "unknown";
+}
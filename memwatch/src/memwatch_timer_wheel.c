@@ -0,0 +1,128 @@
+/*
+ * memwatch_timer_wheel.c - Hashed timer wheel for page re-protection
+ *
+ * Each slot is a growable array that keeps its capacity between
+ * rotations, so a steady fault rate schedules without allocating.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "memwatch_timer_wheel.h"
+
+#define ENTRY_ALIGN 8
+
+static size_t next_power_of_two(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+static inline uint64_t entry_deadline(const uint8_t *entry) {
+    uint64_t deadline;
+    memcpy(&deadline, entry, sizeof(deadline));
+    return deadline;
+}
+
+int mw_timer_wheel_init(mw_timer_wheel_t *w, uint64_t tick_ns, size_t nslots,
+                        size_t payload_size, uint64_t now_ns) {
+    memset(w, 0, sizeof(*w));
+    if (tick_ns == 0 || nslots == 0) return -1;
+
+    w->nslots = next_power_of_two(nslots);
+    w->slots = calloc(w->nslots, sizeof(mw_timer_slot_t));
+    if (!w->slots) return -1;
+
+    w->tick_ns = tick_ns;
+    w->mask = w->nslots - 1;
+    w->payload_size = payload_size;
+    w->entry_size = (sizeof(uint64_t) + payload_size + ENTRY_ALIGN - 1) & ~(size_t)(ENTRY_ALIGN - 1);
+    w->next_tick = now_ns / tick_ns;
+    return 0;
+}
+
+void mw_timer_wheel_destroy(mw_timer_wheel_t *w) {
+    if (w->slots) {
+        for (size_t i = 0; i < w->nslots; i++) {
+            free(w->slots[i].entries);
+        }
+        free(w->slots);
+    }
+    memset(w, 0, sizeof(*w));
+}
+
+int mw_timer_wheel_schedule(mw_timer_wheel_t *w, uint64_t deadline_ns, const void *payload) {
+    /* Round up: the slot for tick t is only visited once now >= t * tick_ns */
+    uint64_t tick = (deadline_ns + w->tick_ns - 1) / w->tick_ns;
+    if (tick < w->next_tick) {
+        tick = w->next_tick;
+    }
+
+    mw_timer_slot_t *slot = &w->slots[tick & w->mask];
+    if (slot->count == slot->capacity) {
+        size_t new_cap = slot->capacity ? slot->capacity * 2 : 16;
+        uint8_t *entries = realloc(slot->entries, new_cap * w->entry_size);
+        if (!entries) return -1;
+        slot->entries = entries;
+        slot->capacity = new_cap;
+    }
+
+    uint8_t *entry = slot->entries + slot->count * w->entry_size;
+    memcpy(entry, &deadline_ns, sizeof(deadline_ns));
+    memcpy(entry + sizeof(uint64_t), payload, w->payload_size);
+    slot->count++;
+    w->pending++;
+    return 0;
+}
+
+size_t mw_timer_wheel_advance(mw_timer_wheel_t *w, uint64_t now_ns,
+                              mw_timer_fire_fn fire, void *ctx) {
+    uint64_t now_tick = now_ns / w->tick_ns;
+    if (now_tick < w->next_tick) return 0;
+
+    if (w->pending == 0) {
+        w->next_tick = now_tick + 1;
+        return 0;
+    }
+
+    /* After a long stall one full rotation visits every slot */
+    uint64_t span = now_tick - w->next_tick + 1;
+    if (span > w->nslots) span = w->nslots;
+
+    size_t fired = 0;
+    for (uint64_t k = 0; k < span && w->pending > 0; k++) {
+        mw_timer_slot_t *slot = &w->slots[(w->next_tick + k) & w->mask];
+        size_t keep = 0;
+
+        for (size_t i = 0; i < slot->count; i++) {
+            uint8_t *entry = slot->entries + i * w->entry_size;
+            if (entry_deadline(entry) <= now_ns) {
+                fire(entry + sizeof(uint64_t), ctx);
+                fired++;
+                w->pending--;
+            } else {
+                /* A later rotation's entry - keep it in place */
+                if (keep != i) {
+                    memcpy(slot->entries + keep * w->entry_size, entry, w->entry_size);
+                }
+                keep++;
+            }
+        }
+        slot->count = keep;
+    }
+
+    w->next_tick = now_tick + 1;
+    return fired;
+}
+
+int64_t mw_timer_wheel_next_ns(const mw_timer_wheel_t *w, uint64_t now_ns) {
+    if (w->pending == 0) return -1;
+
+    for (size_t k = 0; k < w->nslots; k++) {
+        uint64_t tick = w->next_tick + k;
+        if (w->slots[tick & w->mask].count > 0) {
+            uint64_t at = tick * w->tick_ns;
+            return at > now_ns ? (int64_t)(at - now_ns) : 0;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,858 @@
+/*
+ * memwatch_trace.c - Keyframe + delta trace index for time travel
+ *
+ * The writer keeps a shadow copy of every region. A write is trimmed
+ * against the shadow, then appended to the region's open segment as
+ * (timestamp, offset, len, old bytes, new bytes). When the segment holds
+ * keyframe_interval deltas, or as many delta bytes as the region itself,
+ * it is sealed: its delta block and the next keyframe (the shadow) go to
+ * the store in one batch. Index entries are kept in memory per chunk of
+ * 2048 segments and written when the chunk fills or on flush, together
+ * with the region's meta, which is what tells readers how far to look.
+ *
+ * The reader holds, per region, only the start time of each index chunk.
+ * Everything else is looked up through zero-copy views.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "memwatch_trace.h"
+
+#define TRACE_MAGIC          0x5254574dU      /* "MWTR" */
+#define TRACE_VERSION        1
+#define TRACE_INDEX_CHUNK    2048             /* segments per index key */
+#define TRACE_MIN_SEGMENT    (64 * 1024)      /* delta bytes before a size-based seal */
+#define TRACE_KEY_MAX        64
+
+/* One index entry */
+typedef struct {
+    uint64_t first_ns;
+    uint64_t last_ns;
+    uint64_t first_seq;           /* changes before this segment */
+    uint32_t count;               /* deltas in its block */
+    uint32_t pad;
+} trace_segment_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t size;
+    uint64_t created_ns;
+    uint64_t first_ns;
+    uint64_t last_ns;
+    uint64_t events;
+    uint64_t segments;            /* index entries readers may use */
+    uint32_t interval;
+    uint32_t pad;
+    char name[MW_TRACE_NAME_MAX];
+} trace_meta_t;
+
+/* Delta record; old then new bytes follow, padded to 8 */
+typedef struct {
+    uint64_t timestamp_ns;
+    uint32_t offset;
+    uint32_t len;
+} trace_delta_t;
+
+_Static_assert(sizeof(trace_segment_t) == 32, "trace_segment_t is on disk");
+_Static_assert(sizeof(trace_meta_t) == 128, "trace_meta_t is on disk");
+_Static_assert(sizeof(trace_delta_t) == 16, "trace_delta_t is on disk");
+
+static inline size_t align8(size_t n) {
+    return (n + 7) & ~(size_t)7;
+}
+
+static inline size_t delta_size(uint32_t len) {
+    return sizeof(trace_delta_t) + align8((size_t)len * 2);
+}
+
+static void key_regions(char *key) {
+    snprintf(key, TRACE_KEY_MAX, "trace.regions");
+}
+
+static void key_of(char *key, uint32_t region, char kind, uint64_t n) {
+    if (kind == 'm') {
+        snprintf(key, TRACE_KEY_MAX, "trace.%u.meta", region);
+    } else {
+        snprintf(key, TRACE_KEY_MAX, "trace.%u.%c%llu", region, kind, (unsigned long long)n);
+    }
+}
+
+/* ============================================================================
+ * Writer
+ * ============================================================================ */
+
+typedef struct {
+    uint32_t id;
+    trace_meta_t meta;
+    uint8_t *shadow;              /* the region now */
+    uint8_t *block;               /* deltas of the open segment */
+    size_t block_used;
+    size_t block_cap;
+    size_t block_payload;         /* new bytes in the open segment */
+    uint64_t segment;             /* number of the open segment */
+    trace_segment_t *chunk;       /* index chunk holding it */
+    bool dirty;
+} writer_region_t;
+
+struct mw_trace_writer {
+    FastStorage *fs;
+    uint32_t interval;
+    pthread_mutex_t lock;
+    writer_region_t *regions;
+    uint32_t count;
+    uint32_t capacity;
+    int32_t *slots;               /* open addressing: region index or -1 */
+    uint32_t slot_mask;
+    mw_trace_stats_t stats;
+};
+
+static inline uint32_t slot_of(uint32_t id, uint32_t mask) {
+    return (id * 2654435761U) & mask;
+}
+
+static writer_region_t *find_region(mw_trace_writer_t *w, uint32_t id) {
+    for (uint32_t s = slot_of(id, w->slot_mask); w->slots[s] >= 0; s = (s + 1) & w->slot_mask) {
+        if (w->regions[w->slots[s]].id == id) {
+            return &w->regions[w->slots[s]];
+        }
+    }
+    return NULL;
+}
+
+static int grow_slots(mw_trace_writer_t *w) {
+    uint32_t size = (w->slot_mask + 1) * 2;
+    int32_t *slots = malloc(sizeof(int32_t) * size);
+    if (!slots) return -1;
+    memset(slots, 0xff, sizeof(int32_t) * size);
+    for (uint32_t i = 0; i < w->count; i++) {
+        uint32_t s = slot_of(w->regions[i].id, size - 1);
+        while (slots[s] >= 0) s = (s + 1) & (size - 1);
+        slots[s] = (int32_t)i;
+    }
+    free(w->slots);
+    w->slots = slots;
+    w->slot_mask = size - 1;
+    return 0;
+}
+
+mw_trace_writer_t *mw_trace_writer_open(FastStorage *fs, uint32_t keyframe_interval) {
+    if (!fs) {
+        errno = EINVAL;
+        return NULL;
+    }
+    mw_trace_writer_t *w = calloc(1, sizeof(*w));
+    if (!w) return NULL;
+    w->fs = fs;
+    w->interval = keyframe_interval ? keyframe_interval : MW_TRACE_DEFAULT_INTERVAL;
+    w->slot_mask = 15;
+    w->slots = malloc(sizeof(int32_t) * 16);
+    if (!w->slots) {
+        free(w);
+        return NULL;
+    }
+    memset(w->slots, 0xff, sizeof(int32_t) * 16);
+    pthread_mutex_init(&w->lock, NULL);
+    return w;
+}
+
+static int write_region_list(mw_trace_writer_t *w) {
+    uint32_t *ids = malloc(sizeof(uint32_t) * (w->count ? w->count : 1));
+    if (!ids) return -1;
+    for (uint32_t i = 0; i < w->count; i++) ids[i] = w->regions[i].id;
+    char key[TRACE_KEY_MAX];
+    key_regions(key);
+    int rc = faststorage_write(w->fs, key, ids, sizeof(uint32_t) * w->count);
+    free(ids);
+    return rc;
+}
+
+int mw_trace_add_region(mw_trace_writer_t *w, uint32_t region_id, const char *name,
+                        const void *initial, size_t size, uint64_t timestamp_ns) {
+    if (!w || (!initial && size) || size > UINT32_MAX) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    pthread_mutex_lock(&w->lock);
+    if (find_region(w, region_id)) {
+        pthread_mutex_unlock(&w->lock);
+        errno = EEXIST;
+        return -1;
+    }
+    if ((w->count + 1) * 2 > w->slot_mask + 1 && grow_slots(w) < 0) {
+        pthread_mutex_unlock(&w->lock);
+        return -1;
+    }
+    if (w->count == w->capacity) {
+        uint32_t capacity = w->capacity ? w->capacity * 2 : 8;
+        writer_region_t *regions = realloc(w->regions, sizeof(*regions) * capacity);
+        if (!regions) {
+            pthread_mutex_unlock(&w->lock);
+            return -1;
+        }
+        w->regions = regions;
+        w->capacity = capacity;
+    }
+
+    writer_region_t *r = &w->regions[w->count];
+    memset(r, 0, sizeof(*r));
+    r->id = region_id;
+    r->meta.magic = TRACE_MAGIC;
+    r->meta.version = TRACE_VERSION;
+    r->meta.size = size;
+    r->meta.created_ns = timestamp_ns;
+    r->meta.interval = w->interval;
+    if (name) {
+        strncpy(r->meta.name, name, MW_TRACE_NAME_MAX - 1);
+    }
+    r->shadow = malloc(size ? size : 1);
+    r->chunk = calloc(TRACE_INDEX_CHUNK, sizeof(trace_segment_t));
+    if (!r->shadow || !r->chunk) {
+        free(r->shadow);
+        free(r->chunk);
+        pthread_mutex_unlock(&w->lock);
+        errno = ENOMEM;
+        return -1;
+    }
+    if (size) memcpy(r->shadow, initial, size);
+
+    char key_k[TRACE_KEY_MAX], key_m[TRACE_KEY_MAX];
+    key_of(key_k, region_id, 'k', 0);
+    key_of(key_m, region_id, 'm', 0);
+    FastStorageBatchEntry entries[] = {
+        { key_k, r->shadow, size },
+        { key_m, &r->meta, sizeof(r->meta) },
+    };
+    if (faststorage_write_batch(w->fs, entries, 2) != 0) {
+        free(r->shadow);
+        free(r->chunk);
+        pthread_mutex_unlock(&w->lock);
+        return -1;
+    }
+
+    uint32_t s = slot_of(region_id, w->slot_mask);
+    while (w->slots[s] >= 0) s = (s + 1) & w->slot_mask;
+    w->slots[s] = (int32_t)w->count;
+    w->count++;
+    w->stats.keyframe_bytes += size;
+    int rc = write_region_list(w);
+    pthread_mutex_unlock(&w->lock);
+    return rc;
+}
+
+/* Store the open segment's deltas and the keyframe after them, then open
+ * the next segment. Called with the lock held. */
+static int seal_segment(mw_trace_writer_t *w, writer_region_t *r) {
+    uint32_t slot = (uint32_t)(r->segment % TRACE_INDEX_CHUNK);
+    r->chunk[slot].first_ns = ((trace_delta_t *)r->block)->timestamp_ns;
+    r->chunk[slot].last_ns = r->meta.last_ns;
+    r->chunk[slot].first_seq = r->meta.events - r->chunk[slot].count;
+
+    char key_d[TRACE_KEY_MAX], key_k[TRACE_KEY_MAX], key_i[TRACE_KEY_MAX];
+    key_of(key_d, r->id, 'd', r->segment);
+    key_of(key_k, r->id, 'k', r->segment + 1);
+    key_of(key_i, r->id, 'i', r->segment / TRACE_INDEX_CHUNK);
+    FastStorageBatchEntry entries[3] = {
+        { key_d, r->block, r->block_used },
+        { key_k, r->shadow, r->meta.size },
+        { key_i, r->chunk, sizeof(trace_segment_t) * TRACE_INDEX_CHUNK },
+    };
+    /* A full index chunk is final; partial ones are written by flush */
+    size_t n = slot == TRACE_INDEX_CHUNK - 1 ? 3 : 2;
+    if (faststorage_write_batch(w->fs, entries, n) != 0) {
+        return -1;
+    }
+
+    w->stats.segments++;
+    w->stats.keyframe_bytes += r->meta.size;
+    r->segment++;
+    r->block_used = 0;
+    r->block_payload = 0;
+    if (slot == TRACE_INDEX_CHUNK - 1) {
+        memset(r->chunk, 0, sizeof(trace_segment_t) * TRACE_INDEX_CHUNK);
+    }
+    return 0;
+}
+
+int mw_trace_record(mw_trace_writer_t *w, uint32_t region_id, uint64_t timestamp_ns,
+                    size_t offset, const void *data, size_t len) {
+    if (!w || (!data && len)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    pthread_mutex_lock(&w->lock);
+    writer_region_t *r = find_region(w, region_id);
+    if (!r) {
+        pthread_mutex_unlock(&w->lock);
+        errno = ENOENT;
+        return -1;
+    }
+    if (offset > r->meta.size || len > r->meta.size - offset) {
+        pthread_mutex_unlock(&w->lock);
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* Keep only the bytes that changed */
+    const uint8_t *src = data;
+    while (len && r->shadow[offset] == *src) {
+        offset++;
+        src++;
+        len--;
+    }
+    while (len && r->shadow[offset + len - 1] == src[len - 1]) {
+        len--;
+    }
+    if (len == 0) {
+        w->stats.skipped++;
+        pthread_mutex_unlock(&w->lock);
+        return 0;
+    }
+
+    size_t need = delta_size((uint32_t)len);
+    if (r->block_used + need > r->block_cap) {
+        size_t cap = r->block_cap ? r->block_cap : 4096;
+        while (cap < r->block_used + need) cap *= 2;
+        uint8_t *block = realloc(r->block, cap);
+        if (!block) {
+            pthread_mutex_unlock(&w->lock);
+            return -1;
+        }
+        r->block = block;
+        r->block_cap = cap;
+    }
+
+    if (timestamp_ns < r->meta.last_ns) {
+        timestamp_ns = r->meta.last_ns;
+    }
+    trace_delta_t *d = (trace_delta_t *)(r->block + r->block_used);
+    d->timestamp_ns = timestamp_ns;
+    d->offset = (uint32_t)offset;
+    d->len = (uint32_t)len;
+    uint8_t *payload = (uint8_t *)(d + 1);
+    memcpy(payload, r->shadow + offset, len);
+    memcpy(payload + len, src, len);
+    memset(payload + len * 2, 0, need - sizeof(*d) - len * 2);
+    memcpy(r->shadow + offset, src, len);
+    r->block_used += need;
+    r->block_payload += len;
+
+    uint32_t slot = (uint32_t)(r->segment % TRACE_INDEX_CHUNK);
+    r->chunk[slot].count++;
+    if (r->meta.events == 0) {
+        r->meta.first_ns = timestamp_ns;
+    }
+    r->meta.last_ns = timestamp_ns;
+    r->meta.events++;
+    r->dirty = true;
+    w->stats.events++;
+    w->stats.delta_bytes += need;
+
+    size_t seal_bytes = r->meta.size > TRACE_MIN_SEGMENT ? r->meta.size : TRACE_MIN_SEGMENT;
+    int rc = 0;
+    if (r->chunk[slot].count >= w->interval || r->block_payload >= seal_bytes) {
+        rc = seal_segment(w, r);
+    }
+    pthread_mutex_unlock(&w->lock);
+    return rc;
+}
+
+/* Write the open segment, its index chunk and the meta. Lock held. */
+static int flush_region(mw_trace_writer_t *w, writer_region_t *r) {
+    uint32_t slot = (uint32_t)(r->segment % TRACE_INDEX_CHUNK);
+    uint32_t open = r->chunk[slot].count;
+    FastStorageBatchEntry entries[3];
+    char key_d[TRACE_KEY_MAX], key_i[TRACE_KEY_MAX], key_m[TRACE_KEY_MAX];
+    size_t n = 0;
+
+    if (open) {
+        r->chunk[slot].first_ns = ((trace_delta_t *)r->block)->timestamp_ns;
+        r->chunk[slot].last_ns = r->meta.last_ns;
+        r->chunk[slot].first_seq = r->meta.events - open;
+        key_of(key_d, r->id, 'd', r->segment);
+        entries[n++] = (FastStorageBatchEntry){ key_d, r->block, r->block_used };
+    }
+    size_t used = slot + (open ? 1 : 0);
+    if (used) {
+        key_of(key_i, r->id, 'i', r->segment / TRACE_INDEX_CHUNK);
+        entries[n++] = (FastStorageBatchEntry){ key_i, r->chunk, sizeof(trace_segment_t) * used };
+    }
+    r->meta.segments = r->segment + (open ? 1 : 0);
+    key_of(key_m, r->id, 'm', 0);
+    entries[n++] = (FastStorageBatchEntry){ key_m, &r->meta, sizeof(r->meta) };
+
+    if (faststorage_write_batch(w->fs, entries, n) != 0) {
+        return -1;
+    }
+    r->dirty = false;
+    return 0;
+}
+
+int mw_trace_writer_flush(mw_trace_writer_t *w) {
+    if (!w) return 0;
+    int rc = 0;
+    pthread_mutex_lock(&w->lock);
+    for (uint32_t i = 0; i < w->count; i++) {
+        if (w->regions[i].dirty && flush_region(w, &w->regions[i]) != 0) {
+            rc = -1;
+        }
+    }
+    pthread_mutex_unlock(&w->lock);
+    return rc;
+}
+
+void mw_trace_writer_stats(mw_trace_writer_t *w, mw_trace_stats_t *out) {
+    pthread_mutex_lock(&w->lock);
+    *out = w->stats;
+    pthread_mutex_unlock(&w->lock);
+}
+
+void mw_trace_writer_close(mw_trace_writer_t *w) {
+    if (!w) return;
+    mw_trace_writer_flush(w);
+    for (uint32_t i = 0; i < w->count; i++) {
+        free(w->regions[i].shadow);
+        free(w->regions[i].block);
+        free(w->regions[i].chunk);
+    }
+    free(w->regions);
+    free(w->slots);
+    pthread_mutex_destroy(&w->lock);
+    free(w);
+}
+
+/* ============================================================================
+ * Reader
+ * ============================================================================ */
+
+typedef struct {
+    uint32_t id;
+    trace_meta_t meta;
+    uint64_t *chunk_first;        /* first_ns of each index chunk */
+    uint64_t chunks;
+} reader_region_t;
+
+struct mw_trace {
+    FastStorage *fs;
+    reader_region_t *regions;     /* sorted by id */
+    int count;
+};
+
+struct mw_trace_cursor {
+    mw_trace_t *trace;
+    reader_region_t *region;
+    uint8_t *state;
+    uint64_t segment;
+    trace_segment_t entry;
+    uint8_t *block;               /* copy of the segment's deltas */
+    size_t block_cap;
+    uint32_t *offsets;            /* of each delta in block */
+    uint32_t offsets_cap;
+    uint32_t pos;                 /* deltas of the segment applied */
+    mw_trace_position_t position;
+};
+
+static int cmp_region(const void *a, const void *b) {
+    uint32_t x = ((const reader_region_t *)a)->id, y = ((const reader_region_t *)b)->id;
+    return x < y ? -1 : x > y;
+}
+
+static int load_region(mw_trace_t *t, reader_region_t *r) {
+    char key[TRACE_KEY_MAX];
+    size_t len = sizeof(r->meta);
+    key_of(key, r->id, 'm', 0);
+    if (faststorage_read(t->fs, key, &r->meta, &len) != 0 || len != sizeof(r->meta) ||
+        r->meta.magic != TRACE_MAGIC || r->meta.version != TRACE_VERSION) {
+        errno = EIO;
+        return -1;
+    }
+
+    r->chunks = (r->meta.segments + TRACE_INDEX_CHUNK - 1) / TRACE_INDEX_CHUNK;
+    r->chunk_first = malloc(sizeof(uint64_t) * (r->chunks ? r->chunks : 1));
+    if (!r->chunk_first) return -1;
+    for (uint64_t c = 0; c < r->chunks; c++) {
+        FastStorageView view;
+        key_of(key, r->id, 'i', c);
+        if (faststorage_get_view(t->fs, key, &view) != 0) {
+            errno = EIO;
+            return -1;
+        }
+        if (view.len < sizeof(trace_segment_t)) {
+            faststorage_release_view(t->fs, &view);
+            errno = EIO;
+            return -1;
+        }
+        r->chunk_first[c] = ((const trace_segment_t *)view.ptr)->first_ns;
+        faststorage_release_view(t->fs, &view);
+    }
+    return 0;
+}
+
+mw_trace_t *mw_trace_open(FastStorage *fs) {
+    if (!fs) {
+        errno = EINVAL;
+        return NULL;
+    }
+    char key[TRACE_KEY_MAX];
+    key_regions(key);
+    FastStorageView view;
+    if (faststorage_get_view(fs, key, &view) != 0) {
+        errno = ENOENT;
+        return NULL;
+    }
+
+    mw_trace_t *t = calloc(1, sizeof(*t));
+    int count = (int)(view.len / sizeof(uint32_t));
+    if (t) t->regions = calloc(count ? count : 1, sizeof(reader_region_t));
+    if (!t || !t->regions) {
+        faststorage_release_view(fs, &view);
+        free(t);
+        errno = ENOMEM;
+        return NULL;
+    }
+    t->fs = fs;
+    for (int i = 0; i < count; i++) {
+        memcpy(&t->regions[i].id, (const uint8_t *)view.ptr + i * sizeof(uint32_t), sizeof(uint32_t));
+    }
+    faststorage_release_view(fs, &view);
+    t->count = count;
+
+    for (int i = 0; i < count; i++) {
+        if (load_region(t, &t->regions[i]) != 0) {
+            int err = errno;
+            mw_trace_close(t);
+            errno = err;
+            return NULL;
+        }
+    }
+    qsort(t->regions, count, sizeof(reader_region_t), cmp_region);
+    return t;
+}
+
+int mw_trace_regions(mw_trace_t *t, mw_trace_region_t *out, int max) {
+    for (int i = 0; i < t->count && i < max; i++) {
+        const trace_meta_t *m = &t->regions[i].meta;
+        out[i] = (mw_trace_region_t){
+            .id = t->regions[i].id,
+            .size = m->size,
+            .events = m->events,
+            .created_ns = m->created_ns,
+            .first_ns = m->first_ns,
+            .last_ns = m->last_ns,
+            .keyframe_interval = m->interval,
+        };
+        memcpy(out[i].name, m->name, MW_TRACE_NAME_MAX);
+        out[i].name[MW_TRACE_NAME_MAX - 1] = '\0';
+    }
+    return t->count;
+}
+
+static reader_region_t *lookup(mw_trace_t *t, uint32_t id) {
+    int lo = 0, hi = t->count - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (t->regions[mid].id == id) return &t->regions[mid];
+        if (t->regions[mid].id < id) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    errno = ENOENT;
+    return NULL;
+}
+
+static int get_entry(mw_trace_t *t, reader_region_t *r, uint64_t segment, trace_segment_t *out) {
+    char key[TRACE_KEY_MAX];
+    FastStorageView view;
+    key_of(key, r->id, 'i', segment / TRACE_INDEX_CHUNK);
+    if (faststorage_get_view(t->fs, key, &view) != 0) {
+        errno = EIO;
+        return -1;
+    }
+    size_t slot = segment % TRACE_INDEX_CHUNK;
+    int rc = 0;
+    if (view.len < (slot + 1) * sizeof(trace_segment_t)) {
+        errno = EIO;
+        rc = -1;
+    } else {
+        memcpy(out, (const trace_segment_t *)view.ptr + slot, sizeof(*out));
+    }
+    faststorage_release_view(t->fs, &view);
+    return rc;
+}
+
+/* Last segment starting at or before timestamp_ns; -1 if there is none
+ * (the keyframe of segment 0 is the answer), -2 on error */
+static int64_t locate(mw_trace_t *t, reader_region_t *r, uint64_t timestamp_ns, trace_segment_t *entry) {
+    if (r->meta.segments == 0 || timestamp_ns < r->chunk_first[0]) {
+        return -1;
+    }
+    uint64_t lo = 0, hi = r->chunks - 1;
+    while (lo < hi) {
+        uint64_t mid = (lo + hi + 1) / 2;
+        if (r->chunk_first[mid] <= timestamp_ns) lo = mid;
+        else hi = mid - 1;
+    }
+    uint64_t chunk = lo;
+
+    char key[TRACE_KEY_MAX];
+    FastStorageView view;
+    key_of(key, r->id, 'i', chunk);
+    if (faststorage_get_view(t->fs, key, &view) != 0) {
+        errno = EIO;
+        return -2;
+    }
+    uint64_t n = r->meta.segments - chunk * TRACE_INDEX_CHUNK;
+    if (n > TRACE_INDEX_CHUNK) n = TRACE_INDEX_CHUNK;
+    if (view.len < n * sizeof(trace_segment_t)) {
+        faststorage_release_view(t->fs, &view);
+        errno = EIO;
+        return -2;
+    }
+    const trace_segment_t *entries = view.ptr;
+    lo = 0;
+    hi = n - 1;
+    while (lo < hi) {
+        uint64_t mid = (lo + hi + 1) / 2;
+        if (entries[mid].first_ns <= timestamp_ns) lo = mid;
+        else hi = mid - 1;
+    }
+    *entry = entries[lo];
+    faststorage_release_view(t->fs, &view);
+    return (int64_t)(chunk * TRACE_INDEX_CHUNK + lo);
+}
+
+static int load_keyframe(mw_trace_t *t, reader_region_t *r, uint64_t segment, uint8_t *buf) {
+    char key[TRACE_KEY_MAX];
+    FastStorageView view;
+    key_of(key, r->id, 'k', segment);
+    if (faststorage_get_view(t->fs, key, &view) != 0) {
+        errno = EIO;
+        return -1;
+    }
+    int rc = 0;
+    if (view.len != r->meta.size) {
+        errno = EIO;
+        rc = -1;
+    } else if (view.len) {
+        memcpy(buf, view.ptr, view.len);
+    }
+    faststorage_release_view(t->fs, &view);
+    return rc;
+}
+
+/* Check that a block holds count well-formed deltas inside the region */
+static int delta_at(const uint8_t *block, size_t block_len, size_t at, uint64_t size,
+                    const trace_delta_t **out) {
+    if (at + sizeof(trace_delta_t) > block_len) return -1;
+    const trace_delta_t *d = (const trace_delta_t *)(block + at);
+    if ((uint64_t)d->offset + d->len > size || at + delta_size(d->len) > block_len) return -1;
+    *out = d;
+    return 0;
+}
+
+int mw_trace_state_at(mw_trace_t *t, uint32_t region_id, uint64_t timestamp_ns,
+                      void *buf, size_t len) {
+    reader_region_t *r = lookup(t, region_id);
+    if (!r) return -1;
+    if (len < r->meta.size) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    trace_segment_t entry;
+    int64_t segment = locate(t, r, timestamp_ns, &entry);
+    if (segment == -2 || load_keyframe(t, r, segment < 0 ? 0 : (uint64_t)segment, buf) != 0) {
+        return -1;
+    }
+    if (segment < 0) {
+        return 0;
+    }
+
+    char key[TRACE_KEY_MAX];
+    FastStorageView view;
+    key_of(key, r->id, 'd', (uint64_t)segment);
+    if (faststorage_get_view(t->fs, key, &view) != 0) {
+        errno = EIO;
+        return -1;
+    }
+    int applied = 0;
+    size_t at = 0;
+    for (uint32_t i = 0; i < entry.count; i++) {
+        const trace_delta_t *d;
+        if (delta_at(view.ptr, view.len, at, r->meta.size, &d) != 0) {
+            faststorage_release_view(t->fs, &view);
+            errno = EIO;
+            return -1;
+        }
+        if (d->timestamp_ns > timestamp_ns) break;
+        memcpy((uint8_t *)buf + d->offset, (const uint8_t *)(d + 1) + d->len, d->len);
+        applied++;
+        at += delta_size(d->len);
+    }
+    faststorage_release_view(t->fs, &view);
+    return applied;
+}
+
+/* Make segment the cursor's, copying its deltas; the state is untouched */
+static int cursor_load(mw_trace_cursor_t *c, uint64_t segment) {
+    mw_trace_t *t = c->trace;
+    reader_region_t *r = c->region;
+    trace_segment_t entry;
+    if (get_entry(t, r, segment, &entry) != 0) return -1;
+
+    char key[TRACE_KEY_MAX];
+    FastStorageView view;
+    key_of(key, r->id, 'd', segment);
+    if (faststorage_get_view(t->fs, key, &view) != 0) {
+        errno = EIO;
+        return -1;
+    }
+    if (view.len > c->block_cap) {
+        uint8_t *block = realloc(c->block, view.len);
+        if (!block) {
+            faststorage_release_view(t->fs, &view);
+            return -1;
+        }
+        c->block = block;
+        c->block_cap = view.len;
+    }
+    if (entry.count > c->offsets_cap) {
+        uint32_t *offsets = realloc(c->offsets, sizeof(uint32_t) * entry.count);
+        if (!offsets) {
+            faststorage_release_view(t->fs, &view);
+            return -1;
+        }
+        c->offsets = offsets;
+        c->offsets_cap = entry.count;
+    }
+    memcpy(c->block, view.ptr, view.len);
+    size_t block_len = view.len;
+    faststorage_release_view(t->fs, &view);
+
+    size_t at = 0;
+    for (uint32_t i = 0; i < entry.count; i++) {
+        const trace_delta_t *d;
+        if (delta_at(c->block, block_len, at, r->meta.size, &d) != 0) {
+            errno = EIO;
+            return -1;
+        }
+        c->offsets[i] = (uint32_t)at;
+        at += delta_size(d->len);
+    }
+    c->segment = segment;
+    c->entry = entry;
+    return 0;
+}
+
+static inline const trace_delta_t *cursor_delta(mw_trace_cursor_t *c, uint32_t i) {
+    return (const trace_delta_t *)(c->block + c->offsets[i]);
+}
+
+static void cursor_apply(mw_trace_cursor_t *c, uint32_t i, bool forward) {
+    const trace_delta_t *d = cursor_delta(c, i);
+    const uint8_t *bytes = (const uint8_t *)(d + 1) + (forward ? d->len : 0);
+    memcpy(c->state + d->offset, bytes, d->len);
+    c->position.change_offset = d->offset;
+    c->position.change_len = d->len;
+}
+
+static void cursor_settle(mw_trace_cursor_t *c) {
+    c->position.seq = c->entry.first_seq + c->pos;
+    c->position.timestamp_ns = c->pos ? cursor_delta(c, c->pos - 1)->timestamp_ns
+                                      : c->region->meta.created_ns;
+}
+
+mw_trace_cursor_t *mw_trace_seek(mw_trace_t *t, uint32_t region_id, uint64_t timestamp_ns) {
+    reader_region_t *r = lookup(t, region_id);
+    if (!r) return NULL;
+
+    mw_trace_cursor_t *c = calloc(1, sizeof(*c));
+    if (!c) return NULL;
+    c->trace = t;
+    c->region = r;
+    c->state = malloc(r->meta.size ? r->meta.size : 1);
+    if (!c->state) {
+        free(c);
+        return NULL;
+    }
+
+    trace_segment_t entry;
+    int64_t segment = locate(t, r, timestamp_ns, &entry);
+    if (segment == -2 ||
+        load_keyframe(t, r, segment < 0 ? 0 : (uint64_t)segment, c->state) != 0 ||
+        (r->meta.segments && cursor_load(c, segment < 0 ? 0 : (uint64_t)segment) != 0)) {
+        int err = errno;
+        mw_trace_cursor_free(c);
+        errno = err;
+        return NULL;
+    }
+    if (segment >= 0) {
+        while (c->pos < c->entry.count && cursor_delta(c, c->pos)->timestamp_ns <= timestamp_ns) {
+            cursor_apply(c, c->pos++, true);
+        }
+    }
+    cursor_settle(c);
+    return c;
+}
+
+int mw_trace_step_forward(mw_trace_cursor_t *c) {
+    if (c->pos == c->entry.count) {
+        if (c->segment + 1 >= c->region->meta.segments) {
+            return 0;
+        }
+        /* The state after a segment is the keyframe of the next one */
+        if (cursor_load(c, c->segment + 1) != 0) return -1;
+        c->pos = 0;
+    }
+    cursor_apply(c, c->pos++, true);
+    cursor_settle(c);
+    return 1;
+}
+
+int mw_trace_step_back(mw_trace_cursor_t *c) {
+    if (c->pos == 0) {
+        return 0;
+    }
+    cursor_apply(c, --c->pos, false);
+    /* Only segment 0 rests at position 0: elsewhere that is the end of the
+     * previous segment, which can be stepped back from directly */
+    if (c->pos == 0 && c->segment > 0) {
+        if (cursor_load(c, c->segment - 1) != 0) return -1;
+        c->pos = c->entry.count;
+    }
+    cursor_settle(c);
+    return 1;
+}
+
+const uint8_t *mw_trace_cursor_state(mw_trace_cursor_t *c, size_t *len) {
+    if (len) *len = c->region->meta.size;
+    return c->state;
+}
+
+void mw_trace_cursor_position(mw_trace_cursor_t *c, mw_trace_position_t *out) {
+    *out = c->position;
+}
+
+void mw_trace_cursor_free(mw_trace_cursor_t *c) {
+    if (!c) return;
+    free(c->state);
+    free(c->block);
+    free(c->offsets);
+    free(c);
+}
+
+void mw_trace_close(mw_trace_t *t) {
+    if (!t) return;
+    for (int i = 0; i < t->count; i++) {
+        free(t->regions[i].chunk_first);
+    }
+    free(t->regions);
+    free(t);
+}
@@ -8,6 +8,20 @@
  * - Store in FastStorage (ultra-fast mmap-based KV store)
  * 
  * This avoids the instruction-pointer stepping problem entirely!
+ *
+ * With MEMWATCH_BACKEND=soft-dirty each sample only compares the pages the
+ * kernel marked dirty since the previous sample instead of every byte.
+ *
+ * Each region keeps one snapshot, diffed in place against live memory by
+ * the shared SIMD kernels (memwatch_diff): unchanged 64-byte lines are
+ * skipped, and only words inside changed lines are compared, reported and
+ * copied into the snapshot. Regions are spread over a small scan pool
+ * (MEMWATCH_SCAN_THREADS, the monitor thread included) and each has its
+ * own lock, so watch/unwatch of one region never waits for a whole sweep.
+ * Workers batch events locally; printing and storage happen on a swapped
+ * out event buffer, with no region lock held. Storage only queues rows on
+ * the shared SQLite sink (memwatch_sqlite_sink), whose writer thread
+ * commits them in batches.
  */
 
 #define _GNU_SOURCE
@@ -21,18 +35,30 @@
 #include <errno.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdatomic.h>
 
-#define MAX_TRACKED_REGIONS 256
+#include "memwatch_tracker.h"
+#include "memwatch_backend.h"
+#include "memwatch_diff.h"
+#include "memwatch_sqlite_sink.h"
+
+#define MAX_TRACKED_REGIONS 65536
+#define REGION_CHUNK 256            /* regions allocated together, never moved */
 #define MAX_EVENTS_BEFORE_FLUSH 1000
 #define SAMPLING_INTERVAL_US 10000  /* 10ms */
+#define MAX_SCAN_THREADS 8
+#define DEFAULT_SCAN_THREADS 4
+#define SCAN_BATCH 64               /* events a worker collects before publishing */
+#define SCAN_RANGES 64              /* changed ranges taken per diff call */
 
 typedef struct {
+    pthread_mutex_t lock;         /* held while the region is sampled */
     uint64_t address;
     size_t size;
-    uint8_t *old_data;
-    uint8_t *current_data;
+    uint8_t *snapshot;            /* contents as of the last sample */
     char name[64];
     uint32_t region_id;
+    uint32_t watch_gen;           /* bumped when the slot is reused */
     bool is_tracking;
     uint32_t change_count;
 } tracked_region_t;
@@ -46,6 +72,8 @@ typedef struct {
     uint32_t offset;
     uint8_t thread_id;
     char scope[16];
+    char region_name[64];         /* copied: the slot may be reused before flush */
+    uint32_t change_count;
     /* Enhanced execution context */
     uint64_t step_id;
     char file_name[256];
@@ -53,16 +81,48 @@ typedef struct {
     int line_number;
 } memory_event_t;
 
+/* One scan thread: its event batch and private pagemap buffer */
+typedef struct {
+    pthread_t thread;
+    memory_event_t events[SCAN_BATCH];
+    int event_count;
+    uint64_t timestamp_ms;        /* of the current sweep */
+    mw_soft_dirty_t soft_dirty;   /* shares the tracker's fds */
+    uint64_t bytes_compared;
+    uint64_t changes;
+} scan_worker_t;
+
 typedef struct {
-    tracked_region_t regions[MAX_TRACKED_REGIONS];
-    int region_count;
+    scan_worker_t workers[MAX_SCAN_THREADS];    /* [0] is the monitor thread */
+    int nthreads;
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    uint64_t generation;          /* sweep number, wakes helpers */
+    int active;                   /* helpers still scanning this sweep */
+    bool stop;
+    _Atomic int next;             /* next region to claim */
+    int limit;                    /* regions in this sweep */
+} scan_pool_t;
+
+typedef struct {
+    tracked_region_t *chunks[MAX_TRACKED_REGIONS / REGION_CHUNK];
+    _Atomic int region_count;
+    int free_hint;                /* no free slot below this one */
     
-    memory_event_t event_buffer[MAX_EVENTS_BEFORE_FLUSH];
+    memory_event_t event_buffers[2][MAX_EVENTS_BEFORE_FLUSH];
+    memory_event_t *event_buffer; /* filling, under events_lock */
+    memory_event_t *spare_buffer; /* being flushed, under flush_lock */
     int event_count;
+    int events_printed;
+    pthread_mutex_t events_lock;
+    pthread_mutex_t flush_lock;
     
-    sqlite3 *db;
+    mw_sink_t *sink;
+    int insert_change;            /* sink statement ids */
+    int insert_query;
     int use_faststorage;  /* Use FastStorage instead of SQLite */
-    pthread_mutex_t lock;
+    pthread_mutex_t lock; /* region table and slot allocation */
     
     bool track_all_vars;
     bool track_sql;
@@ -71,6 +131,15 @@ typedef struct {
     
     bool monitoring_active;
     pthread_t monitor_thread;
+    scan_pool_t pool;
+    
+    bool use_soft_dirty;          /* sample dirty pages only */
+    mw_soft_dirty_t soft_dirty;   /* cleared by the monitor thread */
+    
+    uint64_t sweeps;
+    uint64_t last_sweep_ns;
+    uint64_t max_sweep_ns;
+    uint64_t overruns;
 } tracker_state_t;
 
 static tracker_state_t g_tracker = {0};
@@ -81,20 +150,21 @@ static __thread char tl_current_file[256] = {0};
 static __thread char tl_current_function[256] = {0};
 static __thread int tl_current_line = 0;
 
+__thread int tracker_busy = 0;
+
 /* ============================================================================
  * Database Functions
  * ============================================================================ */
 
+/* The sink's writer allocates too (sqlite); keep that out of auto-tracking */
+static void sink_writer_init(void) {
+    tracker_busy = TRACKER_BUSY_THREAD;
+}
+
 static int init_database(const char *path) {
     /* Using SQLite for C code */
     printf("✅ Using SQLite backend\n");
     g_tracker.use_faststorage = 0;
-    
-    int rc = sqlite3_open(path, &g_tracker.db);
-    if (rc) {
-        fprintf(stderr, "❌ Database open failed: %s\n", sqlite3_errmsg(g_tracker.db));
-        return -1;
-    }
 
     const char *sql = 
         "CREATE TABLE IF NOT EXISTS memory_changes (" \
@@ -111,6 +181,22 @@ static int init_database(const char *path) {
         ");" \
         "CREATE INDEX IF NOT EXISTS idx_timestamp ON memory_changes(timestamp_ms);" \
         "CREATE INDEX IF NOT EXISTS idx_region ON memory_changes(region_id);" \
+        "CREATE TABLE IF NOT EXISTS memory_changes_detailed (" \
+        "    id INTEGER PRIMARY KEY AUTOINCREMENT," \
+        "    timestamp_ms INTEGER," \
+        "    region_id INTEGER," \
+        "    region_name TEXT," \
+        "    offset INTEGER," \
+        "    old_value TEXT," \
+        "    new_value TEXT," \
+        "    thread_id INTEGER," \
+        "    scope TEXT," \
+        "    change_count INTEGER," \
+        "    step_id INTEGER," \
+        "    file_name TEXT," \
+        "    function_name TEXT," \
+        "    line_number INTEGER" \
+        ");" \
         "CREATE TABLE IF NOT EXISTS sql_queries (" \
         "    id INTEGER PRIMARY KEY AUTOINCREMENT," \
         "    timestamp_ms INTEGER NOT NULL," \
@@ -120,11 +206,23 @@ static int init_database(const char *path) {
         ");" \
         "CREATE INDEX IF NOT EXISTS idx_sql_timestamp ON sql_queries(timestamp_ms);";
 
-    char *err = NULL;
-    rc = sqlite3_exec(g_tracker.db, sql, NULL, NULL, &err);
-    if (rc != SQLITE_OK) {
-        fprintf(stderr, "❌ SQL error: %s\n", err);
-        sqlite3_free(err);
+    mw_sink_config_t config = { .writer_init = sink_writer_init };
+    g_tracker.sink = mw_sink_open(path, sql, &config);
+    if (!g_tracker.sink) {
+        fprintf(stderr, "❌ Database open failed: %s\n", path);
+        return -1;
+    }
+
+    g_tracker.insert_change = mw_sink_prepare(g_tracker.sink,
+        "INSERT INTO memory_changes_detailed "
+        "(timestamp_ms, region_id, region_name, offset, old_value, new_value, thread_id, scope, change_count, step_id, file_name, function_name, line_number) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+    g_tracker.insert_query = mw_sink_prepare(g_tracker.sink,
+        "INSERT INTO sql_queries (timestamp_ms, query_text, query_type, thread_id) "
+        "VALUES (?, ?, ?, ?)");
+    if (g_tracker.insert_change < 0 || g_tracker.insert_query < 0) {
+        mw_sink_close(g_tracker.sink);
+        g_tracker.sink = NULL;
         return -1;
     }
 
@@ -132,9 +230,14 @@ static int init_database(const char *path) {
 }
 
 static int get_event_count_from_database(void) {
+    if (!g_tracker.sink) {
+        return 0;
+    }
+    mw_sink_flush(g_tracker.sink);
+
     sqlite3_stmt *stmt;
     const char *sql = "SELECT COUNT(*) FROM memory_changes";
-    int rc = sqlite3_prepare_v2(g_tracker.db, sql, -1, &stmt, NULL);
+    int rc = sqlite3_prepare_v2(mw_sink_db(g_tracker.sink), sql, -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
         return 0;
     }
@@ -149,12 +252,57 @@ static int get_event_count_from_database(void) {
     return count;
 }
 
+/* Console lines for events; called with no region lock held */
+static void print_events(const memory_event_t *events, int count) {
+    if (count <= 0) return;
+    flockfile(stdout);
+    for (int i = 0; i < count; i++) {
+        const memory_event_t *evt = &events[i];
+        printf("  [TRACKED] %s[%u]: 0x%lx -> 0x%lx | step:%ld | %s:%d in %s()\n",
+               evt->region_name, evt->offset, evt->old_value, evt->new_value, evt->step_id,
+               evt->file_name[0] ? evt->file_name : "?",
+               evt->line_number,
+               evt->function_name[0] ? evt->function_name : "?");
+    }
+    funlockfile(stdout);
+}
+
+/* Print the events published since the last report (between sweeps) */
+static void report_events(void) {
+    pthread_mutex_lock(&g_tracker.events_lock);
+    print_events(g_tracker.event_buffer + g_tracker.events_printed,
+                 g_tracker.event_count - g_tracker.events_printed);
+    g_tracker.events_printed = g_tracker.event_count;
+    pthread_mutex_unlock(&g_tracker.events_lock);
+}
+
+/*
+ * Swap the filling buffer for the spare and store the full one; scanning
+ * continues into the other buffer meanwhile. Called with no region lock
+ * held.
+ */
 static void flush_events_to_database(void) {
-    if (g_tracker.event_count == 0) return;
+    pthread_mutex_lock(&g_tracker.flush_lock);
+
+    pthread_mutex_lock(&g_tracker.events_lock);
+    memory_event_t *batch = g_tracker.event_buffer;
+    int count = g_tracker.event_count;
+    int printed = g_tracker.events_printed;
+    if (!batch) {
+        pthread_mutex_unlock(&g_tracker.events_lock);
+        pthread_mutex_unlock(&g_tracker.flush_lock);
+        return;
+    }
+    g_tracker.event_buffer = g_tracker.spare_buffer;
+    g_tracker.spare_buffer = batch;
+    g_tracker.event_count = 0;
+    g_tracker.events_printed = 0;
+    pthread_mutex_unlock(&g_tracker.events_lock);
+
+    print_events(batch + printed, count - printed);
 
-    for (int i = 0; i < g_tracker.event_count; i++) {
-        memory_event_t *evt = &g_tracker.event_buffer[i];
-        tracked_region_t *region = &g_tracker.regions[evt->region_id];
+    for (int i = 0; i < count; i++) {
+        memory_event_t *evt = &batch[i];
 
         char old_str[32], new_str[32];
         snprintf(old_str, sizeof(old_str), "0x%016lx", evt->old_value);
@@ -166,144 +314,335 @@ static void flush_events_to_database(void) {
             static int event_id = 0;
             snprintf(key, sizeof(key), "mem:%d", event_id++);
             snprintf(value, sizeof(value), "%ld|%d|%s|%d|%s|%s|%d|%s|%d|%ld|%s|%s|%d",
-                     evt->timestamp_ms, evt->region_id, region->name, evt->offset,
-                     old_str, new_str, evt->thread_id, evt->scope, region->change_count,
+                     evt->timestamp_ms, evt->region_id, evt->region_name, evt->offset,
+                     old_str, new_str, evt->thread_id, evt->scope, evt->change_count,
                      evt->step_id, 
                      evt->file_name[0] ? evt->file_name : "none",
                      evt->function_name[0] ? evt->function_name : "none",
                      evt->line_number);
-        } else {
-            /* Store in SQLite (traditional SQL) - create table if needed */
-            const char *create_table = 
-                "CREATE TABLE IF NOT EXISTS memory_changes_detailed ("
-                "    id INTEGER PRIMARY KEY AUTOINCREMENT,"
-                "    timestamp_ms INTEGER,"
-                "    region_id INTEGER,"
-                "    region_name TEXT,"
-                "    offset INTEGER,"
-                "    old_value TEXT,"
-                "    new_value TEXT,"
-                "    thread_id INTEGER,"
-                "    scope TEXT,"
-                "    change_count INTEGER,"
-                "    step_id INTEGER,"
-                "    file_name TEXT,"
-                "    function_name TEXT,"
-                "    line_number INTEGER"
-                ");";
-            
-            sqlite3_exec(g_tracker.db, create_table, NULL, NULL, NULL);
-            
-            const char *sql = "INSERT INTO memory_changes_detailed "
-                "(timestamp_ms, region_id, region_name, offset, old_value, new_value, thread_id, scope, change_count, step_id, file_name, function_name, line_number) "
-                "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
-            sqlite3_stmt *stmt;
-            int rc = sqlite3_prepare_v2(g_tracker.db, sql, -1, &stmt, NULL);
-            if (rc != SQLITE_OK) {
-                fprintf(stderr, "Prepare error: %s\n", sqlite3_errmsg(g_tracker.db));
-                continue;
-            }
-
-            sqlite3_bind_int64(stmt, 1, evt->timestamp_ms);
-            sqlite3_bind_int(stmt, 2, evt->region_id);
-            sqlite3_bind_text(stmt, 3, region->name, -1, SQLITE_STATIC);
-            sqlite3_bind_int(stmt, 4, evt->offset);
-            sqlite3_bind_text(stmt, 5, old_str, -1, SQLITE_TRANSIENT);
-            sqlite3_bind_text(stmt, 6, new_str, -1, SQLITE_TRANSIENT);
-            sqlite3_bind_int(stmt, 7, evt->thread_id);
-            sqlite3_bind_text(stmt, 8, evt->scope, -1, SQLITE_STATIC);
-            sqlite3_bind_int(stmt, 9, region->change_count);
-            sqlite3_bind_int64(stmt, 10, evt->step_id);
-            sqlite3_bind_text(stmt, 11, evt->file_name[0] ? evt->file_name : "none", -1, SQLITE_TRANSIENT);
-            sqlite3_bind_text(stmt, 12, evt->function_name[0] ? evt->function_name : "none", -1, SQLITE_TRANSIENT);
-            sqlite3_bind_int(stmt, 13, evt->line_number);
-
-            rc = sqlite3_step(stmt);
-            if (rc != SQLITE_DONE) {
-                fprintf(stderr, "Step error: %s\n", sqlite3_errmsg(g_tracker.db));
-            }
-            sqlite3_finalize(stmt);
+        } else if (g_tracker.sink) {
+            /* Queue for the sink's writer thread (copied, committed in batches) */
+            mw_sink_value_t row[] = {
+                MW_SINK_I64(evt->timestamp_ms),
+                MW_SINK_I64(evt->region_id),
+                MW_SINK_STR(evt->region_name),
+                MW_SINK_I64(evt->offset),
+                MW_SINK_STR(old_str),
+                MW_SINK_STR(new_str),
+                MW_SINK_I64(evt->thread_id),
+                MW_SINK_STR(evt->scope),
+                MW_SINK_I64(evt->change_count),
+                MW_SINK_I64(evt->step_id),
+                MW_SINK_STR(evt->file_name[0] ? evt->file_name : "none"),
+                MW_SINK_STR(evt->function_name[0] ? evt->function_name : "none"),
+                MW_SINK_I64(evt->line_number),
+            };
+            mw_sink_write(g_tracker.sink, g_tracker.insert_change, row, sizeof(row) / sizeof(row[0]));
         }
     }
 
-    g_tracker.event_count = 0;
+    pthread_mutex_unlock(&g_tracker.flush_lock);
 }
 
 /* ============================================================================
  * Memory Monitoring Thread
  * ============================================================================ */
 
-static void* monitor_thread_func(void *arg) {
-    (void)arg;
+static inline tracked_region_t *region_at(int slot) {
+    return &g_tracker.chunks[slot / REGION_CHUNK][slot % REGION_CHUNK];
+}
 
-    while (g_tracker.monitoring_active) {
-        usleep(SAMPLING_INTERVAL_US);  /* Sample every 10ms */
+/* Move a worker's batch into the shared buffer; false if it did not all fit */
+static bool publish_events(scan_worker_t *w) {
+    if (w->event_count == 0) return true;
 
-        pthread_mutex_lock(&g_tracker.lock);
+    pthread_mutex_lock(&g_tracker.events_lock);
+    int room = MAX_EVENTS_BEFORE_FLUSH - g_tracker.event_count;
+    int n = w->event_count < room ? w->event_count : room;
+    memcpy(&g_tracker.event_buffer[g_tracker.event_count], w->events, n * sizeof(memory_event_t));
+    g_tracker.event_count += n;
+    pthread_mutex_unlock(&g_tracker.events_lock);
 
-        /* Check each tracked region for changes */
-        for (int i = 0; i < g_tracker.region_count; i++) {
-            tracked_region_t *region = &g_tracker.regions[i];
-            if (!region->is_tracking) continue;
+    w->event_count -= n;
+    memmove(w->events, w->events + n, w->event_count * sizeof(memory_event_t));
+    return w->event_count == 0;
+}
 
-            /* Copy current memory state */
-            memcpy(region->current_data, (void *)region->address, region->size);
+static void record_change(scan_worker_t *w, tracked_region_t *region, size_t offset,
+                          uint64_t old_val, uint64_t new_val) {
+    memory_event_t *evt = &w->events[w->event_count++];
+
+    evt->timestamp_ms = w->timestamp_ms;
+    evt->region_id = region->region_id;
+    evt->fault_address = region->address + offset;
+    evt->old_value = old_val;
+    evt->new_value = new_val;
+    evt->offset = offset;
+    evt->thread_id = (uint32_t)(pthread_self() & 0xFF);
+    strcpy(evt->scope, g_tracker.scope_filter);
+    memcpy(evt->region_name, region->name, sizeof(evt->region_name));
+
+    /* Capture execution context */
+    evt->step_id = tl_step_id;
+    strncpy(evt->file_name, tl_current_file, sizeof(evt->file_name) - 1);
+    strncpy(evt->function_name, tl_current_function, sizeof(evt->function_name) - 1);
+    evt->line_number = tl_current_line;
+
+    evt->change_count = ++region->change_count;
+    w->changes++;
+}
 
-            /* Compare with previous state */
-            for (size_t offset = 0; offset < region->size; offset += 8) {
+/*
+ * Diff [begin, end) of a region against its snapshot in place; caller
+ * holds region->lock. Returns false if the region was unwatched while the
+ * lock was dropped to flush events.
+ */
+static bool sample_range(scan_worker_t *w, tracked_region_t *region, size_t begin, size_t end) {
+    mw_diff_range_t ranges[SCAN_RANGES];
+    size_t pos = begin;
+
+    w->bytes_compared += end - begin;
+    while (pos < end) {
+        const uint8_t *live = (const uint8_t *)region->address;
+        uint8_t *snap = region->snapshot;
+        size_t scanned;
+        size_t count = mw_diff_ranges(snap + pos, live + pos, end - pos, ranges, SCAN_RANGES, &scanned);
+
+        for (size_t r = 0; r < count; r++) {
+            size_t lo = pos + ranges[r].offset;
+            size_t hi = lo + ranges[r].len;
+
+            /* Inside a changed line, compare on the 8-byte grid */
+            for (size_t offset = lo; offset < hi; offset += 8) {
                 size_t cmp_size = (region->size - offset < 8) ? (region->size - offset) : 8;
-                
+
                 uint64_t old_val = 0, new_val = 0;
-                memcpy(&old_val, &region->old_data[offset], cmp_size);
-                memcpy(&new_val, &region->current_data[offset], cmp_size);
-
-                if (old_val != new_val) {
-                    /* Change detected */
-                    if (g_tracker.event_count < MAX_EVENTS_BEFORE_FLUSH) {
-                        memory_event_t *evt = &g_tracker.event_buffer[g_tracker.event_count++];
-                        
-                        evt->timestamp_ms = (uint64_t)time(NULL) * 1000;
-                        evt->region_id = region->region_id;
-                        evt->fault_address = region->address + offset;
-                        evt->old_value = old_val;
-                        evt->new_value = new_val;
-                        evt->offset = offset;
-                        evt->thread_id = (uint32_t)(pthread_self() & 0xFF);
-                        strcpy(evt->scope, g_tracker.scope_filter);
-                        
-                        /* Capture execution context */
-                        evt->step_id = tl_step_id;
-                        strncpy(evt->file_name, tl_current_file, sizeof(evt->file_name) - 1);
-                        strncpy(evt->function_name, tl_current_function, sizeof(evt->function_name) - 1);
-                        evt->line_number = tl_current_line;
-
-                        region->change_count++;
-
-                        printf("  [TRACKED] %s[%zu]: 0x%lx -> 0x%lx | step:%ld | %s:%d in %s()\n", 
-                               region->name, offset, old_val, new_val, evt->step_id,
-                               evt->file_name[0] ? evt->file_name : "?",
-                               evt->line_number,
-                               evt->function_name[0] ? evt->function_name : "?");
-                    }
-
-                    /* Update old data */
-                    memcpy(&region->old_data[offset], &new_val, cmp_size);
-
-                    if (g_tracker.event_count >= MAX_EVENTS_BEFORE_FLUSH) {
-                        pthread_mutex_unlock(&g_tracker.lock);
+                memcpy(&old_val, snap + offset, cmp_size);
+                memcpy(&new_val, live + offset, cmp_size);
+                if (old_val == new_val) continue;
+
+                memcpy(snap + offset, &new_val, cmp_size);
+                record_change(w, region, offset, old_val, new_val);
+
+                if (w->event_count == SCAN_BATCH && !publish_events(w)) {
+                    /* Shared buffer full: store it without holding the region */
+                    uint32_t gen = region->watch_gen;
+                    do {
+                        pthread_mutex_unlock(&region->lock);
                         flush_events_to_database();
-                        pthread_mutex_lock(&g_tracker.lock);
-                    }
+                        pthread_mutex_lock(&region->lock);
+                    } while (!publish_events(w));
+                    if (!region->is_tracking || region->watch_gen != gen) return false;
                 }
             }
         }
+        pos += scanned;
+    }
+    return true;
+}
+
+typedef struct {
+    scan_worker_t *worker;
+    tracked_region_t *region;
+    bool lost;
+} dirty_scan_t;
+
+/* Soft-dirty scan hit: sample the part of the region on this page */
+static void sample_dirty_page(uintptr_t page_start, void *ctx) {
+    dirty_scan_t *scan = ctx;
+    tracked_region_t *region = scan->region;
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    if (scan->lost) return;
+
+    uintptr_t lo = page_start > region->address ? page_start : region->address;
+    uintptr_t hi = page_start + page_size;
+    if (hi > region->address + region->size) hi = region->address + region->size;
+
+    /* Keep the 8-byte comparison grid of a full sample */
+    size_t begin = (lo - region->address) & ~(size_t)7;
+    size_t end = (hi - region->address + 7) & ~(size_t)7;
+    if (end > region->size) end = region->size;
+    if (begin < end) {
+        scan->lost = !sample_range(scan->worker, region, begin, end);
+    }
+}
+
+static void sample_region(scan_worker_t *w, tracked_region_t *region) {
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+
+    pthread_mutex_lock(&region->lock);
+    if (!region->is_tracking || region->size == 0) {
+        pthread_mutex_unlock(&region->lock);
+        return;
+    }
+
+    if (g_tracker.use_soft_dirty) {
+        uintptr_t start = region->address & ~(uintptr_t)(page_size - 1);
+        uintptr_t end = region->address + region->size;
+        size_t npages = (end - start + page_size - 1) / page_size;
+        dirty_scan_t scan = { w, region, false };
+        if (mw_soft_dirty_scan(&w->soft_dirty, start, npages, sample_dirty_page, &scan) >= 0) {
+            pthread_mutex_unlock(&region->lock);
+            return;
+        }
+        /* pagemap read failed: fall through to a full sample */
+    }
+    sample_range(w, region, 0, region->size);
+    pthread_mutex_unlock(&region->lock);
+}
 
-        pthread_mutex_unlock(&g_tracker.lock);
+/* Claim regions until the sweep runs out, then hand over the last events */
+static void scan_regions(scan_worker_t *w) {
+    scan_pool_t *pool = &g_tracker.pool;
+    int slot;
+    while ((slot = atomic_fetch_add_explicit(&pool->next, 1, memory_order_relaxed)) < pool->limit) {
+        sample_region(w, region_at(slot));
+    }
+    while (!publish_events(w)) {
+        flush_events_to_database();
     }
+}
+
+static void *scan_helper_func(void *arg) {
+    scan_worker_t *w = arg;
+    scan_pool_t *pool = &g_tracker.pool;
+    uint64_t seen = 0;
+
+    tracker_busy = TRACKER_BUSY_THREAD;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->stop && pool->generation == seen) {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->stop) break;
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        scan_regions(w);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->active == 0) {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    free(w->soft_dirty.entries);
+    return NULL;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* One pass over every region, shared with the helpers */
+static void sweep(void) {
+    scan_pool_t *pool = &g_tracker.pool;
+    uint64_t timestamp_ms = (uint64_t)time(NULL) * 1000;
+
+    for (int i = 0; i < pool->nthreads; i++) {
+        pool->workers[i].timestamp_ms = timestamp_ms;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    atomic_store_explicit(&pool->next, 0, memory_order_relaxed);
+    pool->limit = atomic_load_explicit(&g_tracker.region_count, memory_order_acquire);
+    pool->active = pool->nthreads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    scan_regions(&pool->workers[0]);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->active > 0) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void* monitor_thread_func(void *arg) {
+    (void)arg;
+    scan_pool_t *pool = &g_tracker.pool;
+
+    /* Allocations made here (stdio, sqlite) must never be auto-tracked */
+    tracker_busy = TRACKER_BUSY_THREAD;
+
+    uint64_t next = now_ns();
+    while (g_tracker.monitoring_active) {
+        /* Sample every 10ms, measured from the start of the last sweep */
+        next += SAMPLING_INTERVAL_US * 1000ULL;
+        struct timespec deadline = { (time_t)(next / 1000000000ULL), (long)(next % 1000000000ULL) };
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR) {}
+        if (!g_tracker.monitoring_active) break;
+
+        uint64_t start = now_ns();
+        sweep();
+
+        if (g_tracker.use_soft_dirty) {
+            mw_soft_dirty_clear(&g_tracker.soft_dirty);
+        }
+
+        uint64_t elapsed = now_ns() - start;
+        g_tracker.sweeps++;
+        g_tracker.last_sweep_ns = elapsed;
+        if (elapsed > g_tracker.max_sweep_ns) g_tracker.max_sweep_ns = elapsed;
+        if (elapsed > SAMPLING_INTERVAL_US * 1000ULL) {
+            g_tracker.overruns++;
+            next = start + elapsed;         /* skip the missed ticks */
+        }
+
+        /* Console output waits until no region is being scanned */
+        report_events();
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 1; i < pool->nthreads; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+    free(pool->workers[0].soft_dirty.entries);
 
     return NULL;
 }
 
+/* Helpers for the monitor thread: MEMWATCH_SCAN_THREADS, or one per CPU up to 4 */
+static void start_scan_pool(void) {
+    scan_pool_t *pool = &g_tracker.pool;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int nthreads = cpus > DEFAULT_SCAN_THREADS ? DEFAULT_SCAN_THREADS : (cpus > 0 ? (int)cpus : 1);
+
+    const char *env = getenv("MEMWATCH_SCAN_THREADS");
+    if (env && atoi(env) > 0) {
+        nthreads = atoi(env);
+    }
+    if (nthreads > MAX_SCAN_THREADS) nthreads = MAX_SCAN_THREADS;
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    pool->stop = false;
+    pool->generation = 0;
+
+    pool->nthreads = 1;
+    for (int i = 0; i < nthreads; i++) {
+        scan_worker_t *w = &pool->workers[i];
+        w->event_count = 0;
+        w->soft_dirty = g_tracker.soft_dirty;
+        w->soft_dirty.entries = NULL;       /* each worker reads pagemap into its own buffer */
+        w->soft_dirty.capacity = 0;
+        if (i > 0) {
+            if (pthread_create(&w->thread, NULL, scan_helper_func, w) != 0) break;
+            pool->nthreads++;
+        }
+    }
+}
+
 /* ============================================================================
  * Public API
  * ============================================================================ */
@@ -318,6 +657,22 @@ int tracker_init(const char *db_path, bool track_all, bool track_sql, bool track
     g_tracker.track_threads = track_threads;
     strncpy(g_tracker.scope_filter, scope, sizeof(g_tracker.scope_filter) - 1);
 
+    /* Sampling needs no protection; soft-dirty only narrows what is compared */
+    mw_backend_kind_t backend = MW_BACKEND_MPROTECT;
+    const char *backend_env = getenv("MEMWATCH_BACKEND");
+    if (backend_env && mw_backend_parse(backend_env, &backend) == 0 &&
+        backend == MW_BACKEND_SOFT_DIRTY) {
+        g_tracker.use_soft_dirty = mw_soft_dirty_open(&g_tracker.soft_dirty) == 0;
+        if (!g_tracker.use_soft_dirty) {
+            fprintf(stderr, "⚠️  soft-dirty unavailable (%s), sampling full regions\n",
+                    strerror(errno));
+        }
+    }
+
+    g_tracker.event_buffer = g_tracker.event_buffers[0];
+    g_tracker.spare_buffer = g_tracker.event_buffers[1];
+    start_scan_pool();
+
     g_tracker.monitoring_active = true;
 
     /* Start monitoring thread */
@@ -331,44 +686,95 @@ int tracker_init(const char *db_path, bool track_all, bool track_sql, bool track
 }
 
 int tracker_watch(uint64_t address, size_t size, const char *name) {
-    if (g_tracker.region_count >= MAX_TRACKED_REGIONS) {
-        fprintf(stderr, "❌ Too many tracked regions\n");
+    uint8_t *snapshot = malloc(size ? size : 1);
+    if (!snapshot) {
         return -1;
     }
 
-    tracked_region_t *region = &g_tracker.regions[g_tracker.region_count];
+    pthread_mutex_lock(&g_tracker.lock);
 
+    /* Reuse the slot of an unwatched region before growing the table */
+    int count = atomic_load_explicit(&g_tracker.region_count, memory_order_relaxed);
+    int slot = g_tracker.free_hint;
+    while (slot < count && region_at(slot)->is_tracking) slot++;
+    if (slot >= MAX_TRACKED_REGIONS) {
+        pthread_mutex_unlock(&g_tracker.lock);
+        free(snapshot);
+        if (tracker_busy != TRACKER_BUSY_HOOK) {
+            fprintf(stderr, "❌ Too many tracked regions\n");
+        }
+        return -1;
+    }
+
+    if (!g_tracker.chunks[slot / REGION_CHUNK]) {
+        tracked_region_t *chunk = calloc(REGION_CHUNK, sizeof(tracked_region_t));
+        if (!chunk) {
+            pthread_mutex_unlock(&g_tracker.lock);
+            free(snapshot);
+            return -1;
+        }
+        for (int i = 0; i < REGION_CHUNK; i++) {
+            pthread_mutex_init(&chunk[i].lock, NULL);
+        }
+        g_tracker.chunks[slot / REGION_CHUNK] = chunk;
+    }
+
+    tracked_region_t *region = region_at(slot);
+
+    pthread_mutex_lock(&region->lock);
     region->address = address;
     region->size = size;
-    region->region_id = g_tracker.region_count;
+    region->region_id = slot;
+    region->watch_gen++;
     region->change_count = 0;
     strncpy(region->name, name, sizeof(region->name) - 1);
+    region->name[sizeof(region->name) - 1] = '\0';
 
     /* Copy initial data */
-    region->old_data = malloc(size);
-    region->current_data = malloc(size);
-    memcpy(region->old_data, (void *)address, size);
-    memcpy(region->current_data, (void *)address, size);
+    region->snapshot = snapshot;
+    memcpy(region->snapshot, (void *)address, size);
 
     region->is_tracking = true;
-    g_tracker.region_count++;
+    pthread_mutex_unlock(&region->lock);
 
-    printf("✅ Tracking: %s @ 0x%lx (%zu bytes)\n", name, address, size);
-    return 0;
+    g_tracker.free_hint = slot + 1;
+    if (slot == count) {
+        /* Publish after the slot is set up: the scan reads the table unlocked */
+        atomic_store_explicit(&g_tracker.region_count, count + 1, memory_order_release);
+    }
+
+    pthread_mutex_unlock(&g_tracker.lock);
+
+    if (tracker_busy != TRACKER_BUSY_HOOK) {
+        printf("✅ Tracking: %s @ 0x%lx (%zu bytes)\n", name, address, size);
+    }
+    return slot;
 }
 
 int tracker_unwatch(int region_id) {
-    if (region_id < 0 || region_id >= g_tracker.region_count) {
+    pthread_mutex_lock(&g_tracker.lock);
+
+    if (region_id < 0 || region_id >= atomic_load(&g_tracker.region_count) ||
+        !region_at(region_id)->is_tracking) {
+        pthread_mutex_unlock(&g_tracker.lock);
         return -1;
     }
 
-    tracked_region_t *region = &g_tracker.regions[region_id];
-    if (!region->is_tracking) return -1;
+    /* Waits for a scan of this region only, not for the whole sweep */
+    tracked_region_t *region = region_at(region_id);
+    pthread_mutex_lock(&region->lock);
+    region->is_tracking = false;
+    uint8_t *snapshot = region->snapshot;
+    region->snapshot = NULL;
+    pthread_mutex_unlock(&region->lock);
+
+    if (region_id < g_tracker.free_hint) {
+        g_tracker.free_hint = region_id;
+    }
 
-    free(region->old_data);
-    free(region->current_data);
+    pthread_mutex_unlock(&g_tracker.lock);
 
-    region->is_tracking = false;
+    free(snapshot);
     return 0;
 }
 
@@ -380,21 +786,48 @@ void tracker_close(void) {
     flush_events_to_database();
 
     /* Restore all regions */
-    for (int i = 0; i < g_tracker.region_count; i++) {
-        if (g_tracker.regions[i].is_tracking) {
+    int count = atomic_load(&g_tracker.region_count);
+    for (int i = 0; i < count; i++) {
+        if (region_at(i)->is_tracking) {
             tracker_unwatch(i);
         }
     }
 
-    /* Close storage backend */
-    if (g_tracker.db) {
-        sqlite3_close(g_tracker.db);
+    if (g_tracker.use_soft_dirty) {
+        mw_soft_dirty_close(&g_tracker.soft_dirty);
+        g_tracker.use_soft_dirty = false;
+    }
+
+    /* Close storage backend (commits everything still queued) */
+    if (g_tracker.sink) {
+        mw_sink_close(g_tracker.sink);
+        g_tracker.sink = NULL;
     }
 
     printf("\n✅ Tracking stopped\n");
     printf("   Total events: %d\n", g_tracker.event_count);
 }
 
+void tracker_get_scan_stats(tracker_scan_stats_t *stats) {
+    scan_pool_t *pool = &g_tracker.pool;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->sweeps = g_tracker.sweeps;
+    stats->last_sweep_ns = g_tracker.last_sweep_ns;
+    stats->max_sweep_ns = g_tracker.max_sweep_ns;
+    stats->overruns = g_tracker.overruns;
+    for (int i = 0; i < pool->nthreads; i++) {
+        stats->bytes_compared += pool->workers[i].bytes_compared;
+        stats->changes += pool->workers[i].changes;
+    }
+    stats->scan_threads = pool->nthreads;
+    stats->diff_kernel = mw_diff_kernel_name();
+}
+
+void tracker_get_sink_stats(mw_sink_stats_t *stats) {
+    mw_sink_stats(g_tracker.sink, stats);
+}
+
 int tracker_get_event_count(void) {
     return get_event_count_from_database();
 }
@@ -405,7 +838,7 @@ void tracker_log_sql_query(const char *query_text) {
     }
 
     /* Check if we have a storage backend */
-    if (!g_tracker.use_faststorage && !g_tracker.db) {
+    if (!g_tracker.use_faststorage && !g_tracker.sink) {
         return;
     }
 
@@ -435,20 +868,15 @@ void tracker_log_sql_query(const char *query_text) {
     clock_gettime(CLOCK_MONOTONIC, &ts);
     long long timestamp_ms = (ts.tv_sec * 1000LL) + (ts.tv_nsec / 1000000LL);
 
-    if (g_tracker.db) {
-        /* Store in SQLite */
-        char query[2048];
-        snprintf(query, sizeof(query),
-                 "INSERT INTO sql_queries (timestamp_ms, query_text, query_type, thread_id) "
-                 "VALUES (%lld, '%s', '%s', %ld);",
-                 timestamp_ms, query_text, query_type, thread_id);
-
-        char *err_msg = NULL;
-        if (sqlite3_exec(g_tracker.db, query, NULL, NULL, &err_msg) != SQLITE_OK) {
-            if (err_msg) {
-                sqlite3_free(err_msg);
-            }
-        }
+    if (g_tracker.sink) {
+        /* Store in SQLite; bound, so quotes in the query are harmless */
+        mw_sink_value_t row[] = {
+            MW_SINK_I64(timestamp_ms),
+            MW_SINK_STR(query_text),
+            MW_SINK_STR(query_type),
+            MW_SINK_I64(thread_id),
+        };
+        mw_sink_write(g_tracker.sink, g_tracker.insert_query, row, sizeof(row) / sizeof(row[0]));
     }
 }
 
@@ -0,0 +1,33 @@
+/*
+ * sql_log_to_jsonl.c - Convert a SQL tracker change log to JSON lines
+ *
+ * Usage:
+ *   sql_log_to_jsonl <change_log> [output.jsonl]
+ *
+ * Writes one JSON object per column change (stdout without an output
+ * path). Safe on a log that is still being written: conversion stops at
+ * the last complete block.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include "sql_tracker.h"
+
+int main(int argc, char **argv) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s <change_log> [output.jsonl]\n", argv[0]);
+        return 2;
+    }
+    
+    long lines = sql_tracker_export_jsonl(argv[1], argc == 3 ? argv[2] : NULL);
+    if (lines < 0) {
+        fprintf(stderr, "%s: %s: %s\n", argv[0], argv[1],
+                errno == EINVAL ? "not a SQL change log" : strerror(errno));
+        return 1;
+    }
+    if (argc == 3) {
+        fprintf(stderr, "%ld changes written to %s\n", lines, argv[2]);
+    }
+    return 0;
+}
@@ -5,418 +5,2037 @@
  * Supports: INSERT, UPDATE, DELETE, SELECT operations.
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
 #include <string.h>
 #include <ctype.h>
 #include <time.h>
-#include <regex.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "../include/sql_tracker.h"
+#include "../include/memwatch_hash.h"
+#include "../include/memwatch_lz4.h"
+#include "../include/memwatch_compress.h"
 
 // Global tracker instance
 static SQLTracker *g_tracker = NULL;
 
+/* ============================================================================
+ * TOKENIZER
+ * ============================================================================
+ *
+ * One forward pass over the caller's text, no copies: whitespace and
+ * comments are skipped, quoted strings and identifiers are single tokens
+ * (doubled quotes and backslash escapes included), and everything else is
+ * a word, number, parameter or one-character symbol.
+ */
+
+typedef enum {
+    TOK_END = 0,
+    TOK_WORD,                               // Keyword or bare identifier
+    TOK_QUOTED,                             // "ident", `ident` or [ident]
+    TOK_STRING,                             // 'literal', N'...', X'...'
+    TOK_NUMBER,
+    TOK_PARAM,                              // ?, ?1, :name, @name, $1
+    TOK_SYMBOL                              // Any other single character
+} TokenType;
+
+typedef struct {
+    const char *p;
+    const char *end;
+} Lexer;
+
+typedef struct {
+    TokenType type;
+    const char *start;
+    size_t len;                             // Whole token, quotes included
+} Token;
+
+static inline int is_word_start(unsigned char c) {
+    return isalpha(c) || c == '_' || c >= 0x80;
+}
+
+static inline int is_word_char(unsigned char c) {
+    return isalnum(c) || c == '_' || c == '$' || c >= 0x80;
+}
+
+static void lex_skip(Lexer *lx) {
+    while (lx->p < lx->end) {
+        if (isspace((unsigned char)*lx->p)) {
+            lx->p++;
+        } else if (lx->p[0] == '-' && lx->p + 1 < lx->end && lx->p[1] == '-') {
+            while (lx->p < lx->end && *lx->p != '\n') lx->p++;
+        } else if (lx->p[0] == '/' && lx->p + 1 < lx->end && lx->p[1] == '*') {
+            lx->p += 2;
+            while (lx->p + 1 < lx->end && !(lx->p[0] == '*' && lx->p[1] == '/')) lx->p++;
+            lx->p = lx->p + 1 < lx->end ? lx->p + 2 : lx->end;
+        } else {
+            break;
+        }
+    }
+}
+
 /**
- * Normalize SQL string: trim whitespace, convert to uppercase for keywords
+ * Skip to just past the closing quote (p is just past the opening one)
  */
-static char *sql_normalize(const char *query) {
-    if (!query) return NULL;
+static const char *lex_quoted(const char *p, const char *end, char close, int backslash) {
+    while (p < end) {
+        if (backslash && *p == '\\' && p + 1 < end) {
+            p += 2;
+        } else if (*p == close) {
+            if (close != ']' && p + 1 < end && p[1] == close) {
+                p += 2;
+            } else {
+                return p + 1;
+            }
+        } else {
+            p++;
+        }
+    }
+    return end;
+}
+
+static Token lex_next(Lexer *lx) {
+    lex_skip(lx);
     
-    size_t len = strlen(query);
-    char *normalized = (char *)malloc(len + 1);
-    if (!normalized) return NULL;
+    Token tok = { TOK_END, lx->p, 0 };
+    if (lx->p >= lx->end) return tok;
     
-    int write_idx = 0;
-    int in_string = 0;
-    char string_char = 0;
+    const char *p = lx->p;
+    const char *end = lx->end;
+    unsigned char c = (unsigned char)*p;
     
-    for (size_t i = 0; i < len; i++) {
-        char c = query[i];
-        
-        // Handle string literals
-        if ((c == '\'' || c == '"' || c == '`') && (i == 0 || query[i-1] != '\\')) {
-            if (!in_string) {
-                in_string = 1;
-                string_char = c;
-            } else if (c == string_char) {
-                in_string = 0;
-            }
-            normalized[write_idx++] = c;
+    if (c == '\'') {
+        tok.type = TOK_STRING;
+        p = lex_quoted(p + 1, end, '\'', 1);
+    } else if (strchr("NnXxEeBb", c) && p + 1 < end && p[1] == '\'') {
+        tok.type = TOK_STRING;
+        p = lex_quoted(p + 2, end, '\'', 1);
+    } else if (c == '"' || c == '`') {
+        tok.type = TOK_QUOTED;
+        p = lex_quoted(p + 1, end, (char)c, 0);
+    } else if (c == '[') {
+        tok.type = TOK_QUOTED;
+        p = lex_quoted(p + 1, end, ']', 0);
+    } else if (is_word_start(c)) {
+        tok.type = TOK_WORD;
+        while (p < end && is_word_char((unsigned char)*p)) p++;
+    } else if (isdigit(c) || (c == '.' && p + 1 < end && isdigit((unsigned char)p[1]))) {
+        tok.type = TOK_NUMBER;
+        p++;
+        while (p < end && (isalnum((unsigned char)*p) || *p == '.' ||
+                           ((*p == '+' || *p == '-') && (p[-1] == 'e' || p[-1] == 'E')))) {
+            p++;
+        }
+    } else if (c == '?') {
+        tok.type = TOK_PARAM;
+        p++;
+        while (p < end && isdigit((unsigned char)*p)) p++;
+    } else if ((c == ':' || c == '@' || c == '$') && p + 1 < end && is_word_char((unsigned char)p[1])) {
+        tok.type = TOK_PARAM;
+        p++;
+        while (p < end && is_word_char((unsigned char)*p)) p++;
+    } else {
+        tok.type = TOK_SYMBOL;
+        p++;
+    }
+    
+    tok.len = (size_t)(p - tok.start);
+    lx->p = p;
+    return tok;
+}
+
+static inline int tok_is(const Token *t, const char *keyword) {
+    size_t len = strlen(keyword);
+    return t->type == TOK_WORD && t->len == len && strncasecmp(t->start, keyword, len) == 0;
+}
+
+static inline int tok_sym(const Token *t, char c) {
+    return t->type == TOK_SYMBOL && t->start[0] == c;
+}
+
+static inline int tok_is_name(const Token *t) {
+    return t->type == TOK_WORD || t->type == TOK_QUOTED;
+}
+
+/**
+ * Skip to just past the ')' closing a group whose '(' was just read
+ */
+static void skip_group(Lexer *lx) {
+    for (int depth = 1; depth > 0;) {
+        Token t = lex_next(lx);
+        if (t.type == TOK_END) return;
+        if (tok_sym(&t, '(')) depth++;
+        else if (tok_sym(&t, ')')) depth--;
+    }
+}
+
+/**
+ * Statement fingerprint: FNV-1a over the token stream with keywords
+ * case-folded and every literal and parameter hashed alike, so the same
+ * statement with different values, spacing or comments hashes the same.
+ * Lists of literals ("IN (1, 2, 3)") hash as one literal.
+ */
+static inline uint64_t fnv_byte(uint64_t hash, unsigned char c) {
+    return (hash ^ c) * 0x100000001b3ULL;
+}
+
+static uint64_t sql_fingerprint(const char *query, size_t len) {
+    Lexer lx = { query, query + len };
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    int after_literal = 0;
+    int comma_pending = 0;
+    
+    for (Token t = lex_next(&lx); t.type != TOK_END; t = lex_next(&lx)) {
+        int literal = t.type == TOK_STRING || t.type == TOK_NUMBER || t.type == TOK_PARAM;
+        if (literal && after_literal) {
+            comma_pending = 0;              // ", ?" continuing a literal list
             continue;
         }
+        if (after_literal && !comma_pending && tok_sym(&t, ',')) {
+            comma_pending = 1;
+            continue;
+        }
+        if (comma_pending) {
+            hash = fnv_byte(fnv_byte(hash, TOK_SYMBOL), ',');
+            comma_pending = 0;
+        }
+        after_literal = literal;
         
-        if (in_string) {
-            normalized[write_idx++] = c;
+        if (literal) {
+            hash = fnv_byte(fnv_byte(hash, TOK_PARAM), '?');
             continue;
         }
+        hash = fnv_byte(hash, (unsigned char)t.type);
+        for (size_t i = 0; i < t.len; i++) {
+            unsigned char c = (unsigned char)t.start[i];
+            hash = fnv_byte(hash, t.type == TOK_WORD && c >= 'a' && c <= 'z' ? c - 32 : c);
+        }
+    }
+    return hash;
+}
+
+/**
+ * Copy query into out with whitespace and comments between tokens
+ * collapsed to one space (out needs len bytes plus the NUL)
+ * 
+ * Returns:
+ *   Length written
+ */
+static size_t sql_normalize_into(const char *query, size_t len, char *out) {
+    Lexer lx = { query, query + len };
+    size_t used = 0;
+    const char *prev_end = NULL;
+    
+    for (Token t = lex_next(&lx); t.type != TOK_END; t = lex_next(&lx)) {
+        if (prev_end && t.start > prev_end) {
+            out[used++] = ' ';
+        }
+        memcpy(out + used, t.start, t.len);
+        used += t.len;
+        prev_end = t.start + t.len;
+    }
+    out[used] = '\0';
+    return used;
+}
+
+/* ============================================================================
+ * STATEMENT PARSER
+ * ============================================================================
+ *
+ * Finds the operation, the target table and the affected columns of one
+ * statement by walking its tokens. Names go into a fixed buffer in the
+ * SQLParse, unquoted; nothing is allocated.
+ *
+ * - INSERT / REPLACE [OR ...] INTO t [(cols)] VALUES (...), (...) | SELECT
+ * - UPDATE [OR ...] t [alias] SET a = ..., (b, c) = (...) [FROM | WHERE ...]
+ * - DELETE FROM t
+ * - SELECT items FROM t | (subquery), first table only
+ * - A leading WITH [RECURSIVE] name AS (...), ... is skipped
+ */
+
+#define SQL_MAX_COLUMNS 100                 // Columns kept per statement
+#define SQL_PARSE_TEXT 4096                 // Name bytes per statement
+#define SQL_NO_NAME UINT32_MAX
+
+typedef struct {
+    SQLOperation operation;
+    uint32_t table;                         // Offset of the table name in text, or SQL_NO_NAME
+    uint32_t column_count;
+    uint32_t columns[SQL_MAX_COLUMNS];      // Offsets of column names in text
+    uint32_t used;
+    char text[SQL_PARSE_TEXT];
+} SQLParse;
+
+static void name_put(SQLParse *ps, uint32_t start, const char *s, size_t len) {
+    /* Truncate to the identifier limit, and leave the buffer room for a NUL */
+    if (ps->used >= SQL_PARSE_TEXT - 1) return;
+    size_t room = (MAX_COLUMN_NAME - 1) - (ps->used - start);
+    if (room > SQL_PARSE_TEXT - 1 - ps->used) room = SQL_PARSE_TEXT - 1 - ps->used;
+    if (len > room) len = room;
+    memcpy(ps->text + ps->used, s, len);
+    ps->used += (uint32_t)len;
+}
+
+static void name_put_token(SQLParse *ps, uint32_t start, const Token *t) {
+    if (t->type != TOK_QUOTED) {
+        name_put(ps, start, t->start, t->len);
+        return;
+    }
+    
+    /* Strip the quotes, undouble embedded ones */
+    char close = t->start[0] == '[' ? ']' : t->start[0];
+    const char *p = t->start + 1;
+    const char *end = t->start + t->len;
+    if (end > p && end[-1] == close) end--;
+    while (p < end) {
+        const char *run = p;
+        while (p < end && *p != close) p++;
+        if (p < end) p++;
+        name_put(ps, start, run, (size_t)(p - run));
+        if (p < end && *p == close) p++;
+    }
+}
+
+static uint32_t name_end(SQLParse *ps, uint32_t start) {
+    if (ps->used == SQL_PARSE_TEXT) {
+        return SQL_PARSE_TEXT - 1;          // Buffer full: the last NUL, an empty name
+    }
+    ps->text[ps->used++] = '\0';
+    return start;
+}
+
+static void add_column(SQLParse *ps, uint32_t name) {
+    if (ps->column_count < SQL_MAX_COLUMNS && ps->text[name]) {
+        ps->columns[ps->column_count++] = name;
+    }
+}
+
+static void add_star(SQLParse *ps) {
+    uint32_t start = ps->used;
+    name_put(ps, start, "*", 1);
+    add_column(ps, name_end(ps, start));
+}
+
+/**
+ * Read a possibly qualified name starting at tok into ps
+ * 
+ * Args:
+ *   last_part - Keep only the last part (columns) instead of the dotted path (tables)
+ * 
+ * Returns:
+ *   The token after the name
+ */
+static Token read_name(Lexer *lx, Token tok, SQLParse *ps, uint32_t *out, int last_part) {
+    uint32_t start = ps->used;
+    name_put_token(ps, start, &tok);
+    
+    Token next = lex_next(lx);
+    while (tok_sym(&next, '.')) {
+        Lexer mark = *lx;
+        Token part = lex_next(lx);
+        if (!tok_is_name(&part)) {
+            *lx = mark;                     // t.* : leave the '*' for the caller
+            break;
+        }
+        if (last_part) {
+            ps->used = start;
+        } else {
+            name_put(ps, start, ".", 1);
+        }
+        name_put_token(ps, start, &part);
+        next = lex_next(lx);
+    }
+    
+    *out = name_end(ps, start);
+    return next;
+}
+
+static Token skip_words(Lexer *lx, Token t, const char *const *words) {
+    for (;;) {
+        const char *const *w = words;
+        while (*w && !tok_is(&t, *w)) w++;
+        if (!*w) return t;
+        t = lex_next(lx);
+    }
+}
+
+static const char *const insert_modifiers[] = {
+    "OR", "REPLACE", "ROLLBACK", "ABORT", "FAIL", "IGNORE",
+    "LOW_PRIORITY", "DELAYED", "HIGH_PRIORITY", "ONLY", NULL
+};
+
+static Token skip_ctes(Lexer *lx) {
+    Token t = lex_next(lx);
+    if (tok_is(&t, "RECURSIVE")) t = lex_next(lx);
+    
+    for (;;) {
+        /* name [(columns)] AS [NOT] [MATERIALIZED] (query) */
+        if (!tok_is_name(&t)) return t;
+        t = lex_next(lx);
+        if (tok_sym(&t, '(')) {
+            skip_group(lx);
+            t = lex_next(lx);
+        }
+        if (!tok_is(&t, "AS")) return t;
+        t = lex_next(lx);
+        if (tok_is(&t, "NOT")) t = lex_next(lx);
+        if (tok_is(&t, "MATERIALIZED")) t = lex_next(lx);
+        if (!tok_sym(&t, '(')) return t;
+        skip_group(lx);
+        t = lex_next(lx);
+        if (!tok_sym(&t, ',')) return t;
+        t = lex_next(lx);
+    }
+}
+
+static void parse_insert(Lexer *lx, SQLParse *ps) {
+    ps->operation = SQL_INSERT;
+    
+    Token t = skip_words(lx, lex_next(lx), insert_modifiers);
+    if (tok_is(&t, "INTO")) t = lex_next(lx);
+    if (!tok_is_name(&t)) return;
+    t = read_name(lx, t, ps, &ps->table, 0);
+    if (tok_is(&t, "AS")) {
+        lex_next(lx);
+        t = lex_next(lx);
+    }
+    
+    if (tok_sym(&t, '(')) {
+        Token first = lex_next(lx);
+        if (tok_is(&first, "SELECT") || tok_is(&first, "WITH")) {
+            skip_group(lx);                 // INSERT INTO t (SELECT ...)
+        } else {
+            t = first;
+            while (tok_is_name(&t)) {
+                uint32_t column;
+                t = read_name(lx, t, ps, &column, 1);
+                add_column(ps, column);
+                if (!tok_sym(&t, ',')) break;
+                t = lex_next(lx);
+            }
+            if (!tok_sym(&t, ')')) skip_group(lx);
+        }
+    }
+    
+    /* No column list: every column; VALUES tuples need no parsing */
+    if (ps->column_count == 0) add_star(ps);
+}
+
+static void parse_update(Lexer *lx, SQLParse *ps) {
+    ps->operation = SQL_UPDATE;
+    
+    Token t = skip_words(lx, lex_next(lx), insert_modifiers);
+    if (!tok_is_name(&t)) return;
+    t = read_name(lx, t, ps, &ps->table, 0);
+    if (tok_is(&t, "AS")) {
+        lex_next(lx);
+        t = lex_next(lx);
+    } else if (tok_is_name(&t) && !tok_is(&t, "SET")) {
+        t = lex_next(lx);                   // Alias
+    }
+    if (!tok_is(&t, "SET")) return;
+    t = lex_next(lx);
+    
+    for (;;) {
+        /* Target: column, t.column or (a, b) */
+        if (tok_sym(&t, '(')) {
+            t = lex_next(lx);
+            while (tok_is_name(&t)) {
+                uint32_t column;
+                t = read_name(lx, t, ps, &column, 1);
+                add_column(ps, column);
+                if (!tok_sym(&t, ',')) break;
+                t = lex_next(lx);
+            }
+            if (tok_sym(&t, ')')) t = lex_next(lx);
+        } else if (tok_is_name(&t)) {
+            uint32_t column;
+            t = read_name(lx, t, ps, &column, 1);
+            add_column(ps, column);
+        } else {
+            return;
+        }
         
-        // Skip extra whitespace outside strings
-        if (isspace(c)) {
-            if (write_idx > 0 && normalized[write_idx - 1] != ' ') {
-                normalized[write_idx++] = ' ';
+        /* Value: up to the next top-level ',' or clause */
+        for (int depth = 0;; t = lex_next(lx)) {
+            if (t.type == TOK_END || (depth == 0 && tok_sym(&t, ';'))) return;
+            if (tok_sym(&t, '(')) {
+                depth++;
+            } else if (tok_sym(&t, ')')) {
+                if (depth-- == 0) return;
+            } else if (depth == 0 && (tok_sym(&t, ',') || tok_is(&t, "WHERE") || tok_is(&t, "FROM") ||
+                                      tok_is(&t, "RETURNING") || tok_is(&t, "ORDER") ||
+                                      tok_is(&t, "LIMIT") || tok_is(&t, "OUTPUT"))) {
+                break;
             }
+        }
+        if (!tok_sym(&t, ',')) return;
+        t = lex_next(lx);
+    }
+}
+
+static void parse_delete(Lexer *lx, SQLParse *ps) {
+    static const char *const modifiers[] = { "LOW_PRIORITY", "QUICK", "IGNORE", NULL };
+    ps->operation = SQL_DELETE;
+    
+    Token t = skip_words(lx, lex_next(lx), modifiers);
+    if (tok_is(&t, "FROM")) t = lex_next(lx);
+    if (tok_is(&t, "ONLY")) t = lex_next(lx);
+    if (tok_is_name(&t)) {
+        read_name(lx, t, ps, &ps->table, 0);
+    }
+    add_star(ps);
+}
+
+/**
+ * Name one SELECT item: the column of a plain [t.]col, its alias if it
+ * has one, otherwise its normalized text
+ * 
+ * Returns:
+ *   The token that ended the item (',' or the end of the item list)
+ */
+static Token parse_select_item(Lexer *lx, Token t, SQLParse *ps) {
+    const char *item_start = t.start;
+    const char *item_end = t.start;
+    int path = 1;                           // Still [name .]* name | *
+    int want_part = 1;
+    int star = 0;
+    Token last = t;
+    Token alias = { TOK_END, NULL, 0 };
+    int implicit = 0;                       // alias without AS, void if more follows
+    int after_group = 0;
+    
+    for (int depth = 0;; t = lex_next(lx)) {
+        if (t.type == TOK_END || (depth == 0 && tok_sym(&t, ';'))) break;
+        if (depth == 0 && (tok_sym(&t, ',') || tok_is(&t, "FROM") || tok_is(&t, "INTO") ||
+                           tok_is(&t, "UNION") || tok_is(&t, "WHERE") || tok_sym(&t, ')'))) {
+            break;
+        }
+        if (alias.type != TOK_END) {
+            path = 0;                       // Something after the alias
+            if (implicit) alias.type = TOK_END;
+        } else if (depth == 0 && tok_is(&t, "AS")) {
+            t = lex_next(lx);
+            if (tok_is_name(&t)) alias = t;
+            item_end = t.start + t.len;
+            continue;
+        } else if (path && (tok_is_name(&t) || tok_sym(&t, '*')) && want_part) {
+            star = tok_sym(&t, '*');
+            last = t;
+            want_part = 0;
+        } else if (path && !want_part && !star && tok_sym(&t, '.')) {
+            want_part = 1;
+        } else if (path && !want_part && tok_is_name(&t)) {
+            alias = t;                      // col alias
+        } else if (!path && after_group && depth == 0 && tok_is_name(&t)) {
+            alias = t;                      // count(*) alias
+            implicit = 1;
+        } else {
+            path = 0;
+        }
+        if (tok_sym(&t, '(')) depth++;
+        else if (tok_sym(&t, ')')) depth--;
+        after_group = tok_sym(&t, ')');
+        item_end = t.start + t.len;
+    }
+    
+    uint32_t start = ps->used;
+    if (path && !want_part) {
+        if (star) {
+            name_put(ps, start, "*", 1);
+        } else {
+            name_put_token(ps, start, &last);
+        }
+    } else if (alias.type != TOK_END) {
+        name_put_token(ps, start, &alias);
+    } else {
+        Lexer item = { item_start, item_end };
+        const char *prev_end = NULL;
+        for (Token it = lex_next(&item); it.type != TOK_END; it = lex_next(&item)) {
+            if (prev_end && it.start > prev_end) name_put(ps, start, " ", 1);
+            name_put(ps, start, it.start, it.len);
+            prev_end = it.start + it.len;
+        }
+    }
+    add_column(ps, name_end(ps, start));
+    return t;
+}
+
+static void parse_select(Lexer *lx, SQLParse *ps) {
+    ps->operation = SQL_SELECT;
+    
+    Token t = lex_next(lx);
+    if (tok_is(&t, "DISTINCT") || tok_is(&t, "ALL")) {
+        t = lex_next(lx);
+        if (tok_is(&t, "ON")) {
+            t = lex_next(lx);
+            if (tok_sym(&t, '(')) skip_group(lx);
+            t = lex_next(lx);
+        }
+    }
+    
+    while (t.type != TOK_END && !tok_is(&t, "FROM")) {
+        t = parse_select_item(lx, t, ps);
+        if (!tok_sym(&t, ',')) break;
+        t = lex_next(lx);
+    }
+    if (ps->column_count == 0) add_star(ps);
+    
+    /* SELECT ... INTO x FROM t */
+    while (t.type != TOK_END && !tok_is(&t, "FROM") && !tok_sym(&t, ';')) {
+        t = lex_next(lx);
+    }
+    if (!tok_is(&t, "FROM")) return;
+    t = lex_next(lx);
+    
+    /* A derived table names the first table it reads */
+    if (tok_sym(&t, '(')) {
+        for (Token prev = t; t.type != TOK_END; prev = t) {
+            t = lex_next(lx);
+            if (tok_is(&prev, "FROM") && tok_is_name(&t)) break;
+        }
+    }
+    if (tok_is_name(&t)) {
+        read_name(lx, t, ps, &ps->table, 0);
+    }
+}
+
+static void sql_parse(const char *query, size_t len, SQLParse *ps) {
+    ps->operation = SQL_UNKNOWN;
+    ps->table = SQL_NO_NAME;
+    ps->column_count = 0;
+    ps->used = 0;
+    
+    Lexer lx = { query, query + len };
+    Token t = lex_next(&lx);
+    while (tok_sym(&t, '(')) t = lex_next(&lx);
+    if (tok_is(&t, "WITH")) t = skip_ctes(&lx);
+    
+    if (tok_is(&t, "INSERT") || tok_is(&t, "REPLACE") || tok_is(&t, "UPSERT")) {
+        parse_insert(&lx, ps);
+    } else if (tok_is(&t, "UPDATE")) {
+        parse_update(&lx, ps);
+    } else if (tok_is(&t, "DELETE")) {
+        parse_delete(&lx, ps);
+    } else if (tok_is(&t, "SELECT")) {
+        parse_select(&lx, ps);
+    }
+}
+
+/* ============================================================================
+ * CHANGE STORAGE
+ * ============================================================================
+ *
+ * A tracked query becomes one statement record in a bump arena holding
+ * everything its columns share: timestamp, table, database, rows, the
+ * normalized query and both values at their real length. Each column
+ * change is then a 16-byte SQLChangeRecord {statement, column ID} in a
+ * ring. Table, column and database names are interned once to 32-bit IDs.
+ *
+ * Statements and changes are appended in the same order, so in retention
+ * ring mode the oldest change always belongs to the oldest arena chunk;
+ * a chunk is freed once the last change referencing it rotates out.
+ */
+
+#define SQL_CHUNK_SIZE (64 * 1024)          // Arena chunk size (larger statements get their own)
+#define SQL_NAME_SLOTS 64                   // Initial name hash table size
+
+struct SQLChunk {
+    struct SQLChunk *next;
+    size_t size;
+    size_t used;
+    size_t live;                            // Changes referencing statements here
+    char data[];
+};
+
+struct SQLName {
+    const char *text;
+    uint32_t len;
+    uint32_t hash;
+};
+
+struct SQLStatement {
+    uint64_t timestamp_ns;
+    uint32_t table_id;
+    uint32_t database_id;
+    int32_t rows_affected;
+    uint32_t operation;
+    uint32_t query_len;
+    uint32_t old_len;
+    uint32_t new_len;
+    char text[];                            // Query, old value, new value, each NUL-terminated
+};
+
+static struct SQLChunk *chunk_new(size_t need) {
+    size_t size = need > SQL_CHUNK_SIZE ? need : SQL_CHUNK_SIZE;
+    struct SQLChunk *chunk = (struct SQLChunk *)malloc(sizeof(struct SQLChunk) + size);
+    if (!chunk) return NULL;
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+    chunk->live = 0;
+    return chunk;
+}
+
+static void chunk_free_all(struct SQLChunk *chunk) {
+    while (chunk) {
+        struct SQLChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+}
+
+/**
+ * Name table: names[id] holds the text, slots[] maps a hash to an ID
+ */
+static int names_init(SQLNameTable *t) {
+    memset(t, 0, sizeof(*t));
+    t->capacity = 16;
+    t->names = (struct SQLName *)calloc(t->capacity, sizeof(struct SQLName));
+    t->num_slots = SQL_NAME_SLOTS;
+    t->slots = (uint32_t *)calloc(t->num_slots, sizeof(uint32_t));
+    if (!t->names || !t->slots) {
+        free(t->names);
+        free(t->slots);
+        return -1;
+    }
+    t->names[0].text = "";
+    t->count = 1;
+    return 0;
+}
+
+static void names_free(SQLNameTable *t) {
+    free(t->names);
+    free(t->slots);
+    chunk_free_all(t->chunks);
+    memset(t, 0, sizeof(*t));
+}
+
+static uint32_t names_find(const SQLNameTable *t, const char *text, size_t len, uint32_t hash) {
+    uint32_t mask = t->num_slots - 1;
+    for (uint32_t i = hash & mask;; i = (i + 1) & mask) {
+        uint32_t id = t->slots[i];
+        if (id == 0) return 0;
+        const struct SQLName *name = &t->names[id];
+        if (name->hash == hash && name->len == len && memcmp(name->text, text, len) == 0) {
+            return id;
+        }
+    }
+}
+
+static int names_grow(SQLNameTable *t) {
+    uint32_t num_slots = t->num_slots * 2;
+    uint32_t *slots = (uint32_t *)calloc(num_slots, sizeof(uint32_t));
+    if (!slots) return -1;
+    for (uint32_t id = 1; id < t->count; id++) {
+        uint32_t i = t->names[id].hash & (num_slots - 1);
+        while (slots[i]) i = (i + 1) & (num_slots - 1);
+        slots[i] = id;
+    }
+    free(t->slots);
+    t->slots = slots;
+    t->num_slots = num_slots;
+    return 0;
+}
+
+/**
+ * Intern len bytes of text
+ * 
+ * Returns:
+ *   0 on success with *id set (0 for an empty name), -1 if out of memory
+ */
+static int sql_intern_len(SQLNameTable *t, const char *text, size_t len, uint32_t *id) {
+    if (len == 0) {
+        *id = 0;
+        return 0;
+    }
+    
+    uint32_t hash = (uint32_t)mw_hash64(text, len);
+    *id = names_find(t, text, len, hash);
+    if (*id) return 0;
+    
+    if ((t->count + 1) * 4 > t->num_slots * 3 && names_grow(t) < 0) return -1;
+    if (t->count == t->capacity) {
+        struct SQLName *names = (struct SQLName *)realloc(t->names, t->capacity * 2 * sizeof(struct SQLName));
+        if (!names) return -1;
+        t->names = names;
+        t->capacity *= 2;
+    }
+    
+    struct SQLChunk *chunk = t->chunks;
+    if (!chunk || chunk->size - chunk->used < len + 1) {
+        chunk = chunk_new(len + 1);
+        if (!chunk) return -1;
+        chunk->next = t->chunks;
+        t->chunks = chunk;
+    }
+    char *copy = chunk->data + chunk->used;
+    memcpy(copy, text, len);
+    copy[len] = '\0';
+    chunk->used += len + 1;
+    
+    *id = t->count++;
+    t->names[*id] = (struct SQLName){ copy, (uint32_t)len, hash };
+    uint32_t mask = t->num_slots - 1;
+    uint32_t i = hash & mask;
+    while (t->slots[i]) i = (i + 1) & mask;
+    t->slots[i] = *id;
+    return 0;
+}
+
+/**
+ * Intern a NUL-terminated name, truncated to limit - 1 bytes
+ */
+static int sql_intern(SQLNameTable *t, const char *text, size_t limit, uint32_t *id) {
+    return sql_intern_len(t, text, text ? strnlen(text, limit - 1) : 0, id);
+}
+
+/**
+ * Free arena chunks no retained change refers to (never the newest)
+ */
+static void sql_release_chunks(SQLTracker *tracker) {
+    while (tracker->oldest != tracker->newest && tracker->oldest->live == 0) {
+        struct SQLChunk *chunk = tracker->oldest;
+        tracker->oldest = chunk->next;
+        tracker->arena_bytes -= sizeof(struct SQLChunk) + chunk->size;
+        free(chunk);
+    }
+}
+
+static struct SQLStatement *sql_statement_alloc(SQLTracker *tracker, size_t text_len) {
+    size_t need = (sizeof(struct SQLStatement) + text_len + 7) & ~(size_t)7;
+    struct SQLChunk *chunk = tracker->newest;
+    
+    if (!chunk || chunk->size - chunk->used < need) {
+        chunk = chunk_new(need);
+        if (!chunk) return NULL;
+        if (tracker->newest) {
+            tracker->newest->next = chunk;
+        } else {
+            tracker->oldest = chunk;
+        }
+        tracker->newest = chunk;
+        tracker->arena_bytes += sizeof(struct SQLChunk) + chunk->size;
+        sql_release_chunks(tracker);
+    }
+    
+    struct SQLStatement *stmt = (struct SQLStatement *)(chunk->data + chunk->used);
+    chunk->used += need;
+    return stmt;
+}
+
+/**
+ * Shrink the statement just allocated to text_len bytes of text
+ */
+static void sql_statement_trim(SQLTracker *tracker, struct SQLStatement *stmt, size_t text_len) {
+    size_t need = (sizeof(struct SQLStatement) + text_len + 7) & ~(size_t)7;
+    tracker->newest->used = (size_t)((char *)stmt - tracker->newest->data) + need;
+}
+
+/**
+ * Make room in the ring for n more changes (up to max_changes)
+ */
+static int sql_reserve(SQLTracker *tracker, size_t n) {
+    size_t target = (size_t)tracker->change_count + n;
+    if (tracker->max_changes && target > (size_t)tracker->max_changes) {
+        target = (size_t)tracker->max_changes;
+    }
+    if (target <= tracker->capacity) return 0;
+    
+    /* The ring only wraps once full, so until then it grows in place */
+    size_t capacity = tracker->capacity ? tracker->capacity * 2 : 64;
+    if (capacity < target) capacity = target;
+    if (tracker->max_changes && capacity > (size_t)tracker->max_changes) {
+        capacity = (size_t)tracker->max_changes;
+    }
+    SQLChangeRecord *changes = (SQLChangeRecord *)realloc(tracker->changes, capacity * sizeof(SQLChangeRecord));
+    if (!changes) return -1;
+    tracker->changes = changes;
+    tracker->capacity = capacity;
+    return 0;
+}
+
+static const SQLChangeRecord *sql_record(const SQLTracker *tracker, int index) {
+    return &tracker->changes[(tracker->head + (size_t)index) % tracker->capacity];
+}
+
+static const SQLChangeRecord *sql_record_seq(const SQLTracker *tracker, uint32_t seq) {
+    return sql_record(tracker, (int)(seq - tracker->first_seq));
+}
+
+static void sql_view(const SQLTracker *tracker, const SQLChangeRecord *rec, SQLChange *out) {
+    const struct SQLStatement *stmt = rec->stmt;
+    const struct SQLName *names = tracker->names.names;
+    
+    out->timestamp_ns = stmt->timestamp_ns;
+    out->table_name = names[stmt->table_id].text;
+    out->column_name = names[rec->column_id].text;
+    out->operation = (SQLOperation)stmt->operation;
+    out->full_query = stmt->text;
+    out->old_value = stmt->text + stmt->query_len + 1;
+    out->new_value = out->old_value + stmt->old_len + 1;
+    out->rows_affected = stmt->rows_affected;
+    out->database = names[stmt->database_id].text;
+    out->table_id = stmt->table_id;
+    out->column_id = rec->column_id;
+    out->database_id = stmt->database_id;
+    out->old_value_len = stmt->old_len;
+    out->new_value_len = stmt->new_len;
+    out->query_len = stmt->query_len;
+}
+
+/* ============================================================================
+ * CHANGE INDEX
+ * ============================================================================
+ *
+ * Every change gets a 32-bit sequence number; the ring holds first_seq ..
+ * first_seq + change_count - 1 in timestamp order, so a time range over
+ * it is a binary search. Secondary indexes are posting lists of sequence
+ * numbers per table, per (table, column) and per operation: a filtered
+ * query walks only its matches, and can binary-search them by time too.
+ *
+ * The indexes are built by the first query and kept current on every
+ * insert from then on. A change rotating out of the ring is the oldest
+ * one, so it is always at the front of each of its lists.
+ */
+
+struct SQLPostings {
+    uint32_t *seqs;
+    uint32_t start;                         // First live entry
+    uint32_t end;
+    uint32_t capacity;
+};
+
+struct SQLPairSlot {
+    uint64_t key;                           // table_id << 32 | column_id, 0 if free
+    struct SQLPostings list;
+};
+
+static int postings_push(struct SQLPostings *list, uint32_t seq) {
+    if (list->end == list->capacity) {
+        if (list->start && list->start >= list->capacity / 2) {
+            /* Mostly rotated out: slide the live entries down */
+            uint32_t live = list->end - list->start;
+            memmove(list->seqs, list->seqs + list->start, live * sizeof(uint32_t));
+            list->start = 0;
+            list->end = live;
+        } else {
+            uint32_t capacity = list->capacity ? list->capacity * 2 : 8;
+            uint32_t *seqs = (uint32_t *)realloc(list->seqs, capacity * sizeof(uint32_t));
+            if (!seqs) return -1;
+            list->seqs = seqs;
+            list->capacity = capacity;
+        }
+    }
+    list->seqs[list->end++] = seq;
+    return 0;
+}
+
+static void postings_pop(struct SQLPostings *list, uint32_t seq) {
+    if (list->start < list->end && list->seqs[list->start] == seq) {
+        list->start++;
+    }
+    if (list->start == list->end) {
+        list->start = list->end = 0;
+    }
+}
+
+static uint32_t pair_slot(const SQLChangeIndex *ix, uint64_t key) {
+    uint32_t mask = ix->pair_slots - 1;
+    uint32_t i = (uint32_t)((key * 0x9e3779b97f4a7c15ULL) >> 32) & mask;
+    while (ix->by_column[i].key && ix->by_column[i].key != key) i = (i + 1) & mask;
+    return i;
+}
+
+static int pairs_grow(SQLChangeIndex *ix) {
+    uint32_t old_slots = ix->pair_slots;
+    struct SQLPairSlot *old = ix->by_column;
+    uint32_t slots = old_slots ? old_slots * 2 : 64;
+    
+    ix->by_column = (struct SQLPairSlot *)calloc(slots, sizeof(struct SQLPairSlot));
+    if (!ix->by_column) {
+        ix->by_column = old;
+        return -1;
+    }
+    ix->pair_slots = slots;
+    for (uint32_t i = 0; i < old_slots; i++) {
+        if (old[i].key) ix->by_column[pair_slot(ix, old[i].key)] = old[i];
+    }
+    free(old);
+    return 0;
+}
+
+/**
+ * Posting list of a (table, column) pair, created if asked for
+ */
+static struct SQLPostings *index_pair(SQLChangeIndex *ix, uint32_t table_id, uint32_t column_id, int create) {
+    uint64_t key = (uint64_t)table_id << 32 | column_id;
+    
+    if (create && (ix->num_pairs + 1) * 4 > ix->pair_slots * 3 && pairs_grow(ix) < 0) return NULL;
+    if (!ix->pair_slots) return NULL;
+    
+    uint32_t i = pair_slot(ix, key);
+    if (!ix->by_column[i].key) {
+        if (!create) return NULL;
+        ix->by_column[i].key = key;
+        ix->num_pairs++;
+    }
+    return &ix->by_column[i].list;
+}
+
+static struct SQLPostings *index_table(SQLChangeIndex *ix, uint32_t table_id, int create) {
+    if (table_id >= ix->num_tables) {
+        if (!create) return NULL;
+        uint32_t count = ix->num_tables ? ix->num_tables * 2 : 64;
+        if (count <= table_id) count = table_id + 1;
+        struct SQLPostings *tables = (struct SQLPostings *)realloc(ix->by_table, count * sizeof(struct SQLPostings));
+        if (!tables) return NULL;
+        memset(tables + ix->num_tables, 0, (count - ix->num_tables) * sizeof(struct SQLPostings));
+        ix->by_table = tables;
+        ix->num_tables = count;
+    }
+    return &ix->by_table[table_id];
+}
+
+static void index_free(SQLChangeIndex *ix) {
+    for (uint32_t i = 0; i < ix->num_tables; i++) {
+        free(ix->by_table[i].seqs);
+    }
+    for (uint32_t i = 0; i < ix->pair_slots; i++) {
+        free(ix->by_column[i].list.seqs);
+    }
+    if (ix->by_operation) {
+        for (int op = 0; op <= SQL_SELECT; op++) {
+            free(ix->by_operation[op].seqs);
+        }
+    }
+    free(ix->by_table);
+    free(ix->by_column);
+    free(ix->by_operation);
+    memset(ix, 0, sizeof(SQLChangeIndex));
+}
+
+static int index_add(SQLChangeIndex *ix, const SQLChangeRecord *rec, uint32_t seq) {
+    struct SQLPostings *table = index_table(ix, rec->stmt->table_id, 1);
+    struct SQLPostings *pair = index_pair(ix, rec->stmt->table_id, rec->column_id, 1);
+    if (!table || !pair) return -1;
+    
+    if (postings_push(table, seq) < 0 || postings_push(pair, seq) < 0 ||
+        postings_push(&ix->by_operation[rec->stmt->operation], seq) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static void index_drop(SQLChangeIndex *ix, const SQLChangeRecord *rec, uint32_t seq) {
+    postings_pop(index_table(ix, rec->stmt->table_id, 0), seq);
+    postings_pop(index_pair(ix, rec->stmt->table_id, rec->column_id, 0), seq);
+    postings_pop(&ix->by_operation[rec->stmt->operation], seq);
+}
+
+/**
+ * Index the retained changes, once
+ * 
+ * Returns:
+ *   0 when the indexes are current, -1 if out of memory
+ */
+static int index_build(SQLTracker *tracker) {
+    SQLChangeIndex *ix = &tracker->index;
+    if (ix->built) return 0;
+    
+    ix->by_operation = (struct SQLPostings *)calloc(SQL_SELECT + 1, sizeof(struct SQLPostings));
+    if (!ix->by_operation) return -1;
+    for (int i = 0; i < tracker->change_count; i++) {
+        if (index_add(ix, sql_record(tracker, i), tracker->first_seq + (uint32_t)i) < 0) {
+            index_free(ix);
+            return -1;
+        }
+    }
+    ix->built = 1;
+    return 0;
+}
+
+static void sql_push(SQLTracker *tracker, const struct SQLStatement *stmt, uint32_t column_id) {
+    if (tracker->max_changes && tracker->change_count == tracker->max_changes) {
+        /* Retention ring: the oldest change lives in the oldest chunk */
+        const SQLChangeRecord *oldest = &tracker->changes[tracker->head];
+        tracker->operation_counts[oldest->stmt->operation]--;
+        if (tracker->index.built) {
+            index_drop(&tracker->index, oldest, tracker->first_seq);
+        }
+        tracker->first_seq++;
+        tracker->oldest->live--;
+        tracker->head = (tracker->head + 1) % tracker->capacity;
+        tracker->change_count--;
+        tracker->dropped++;
+        sql_release_chunks(tracker);
+    }
+    
+    size_t slot = (tracker->head + (size_t)tracker->change_count) % tracker->capacity;
+    tracker->changes[slot].stmt = stmt;
+    tracker->changes[slot].column_id = column_id;
+    tracker->newest->live++;
+    tracker->operation_counts[stmt->operation]++;
+    
+    /* Out of memory extending an index: drop them, the next query rebuilds */
+    if (tracker->index.built &&
+        index_add(&tracker->index, &tracker->changes[slot], tracker->first_seq + (uint32_t)tracker->change_count) < 0) {
+        index_free(&tracker->index);
+    }
+    tracker->change_count++;
+}
+
+/**
+ * Store a statement and its column changes, applying capacity and
+ * retention
+ * 
+ * Args:
+ *   proto - Statement fields; query_len, old_len and new_len give the
+ *           lengths of query (raw, normalized here), old_value and new_value
+ * 
+ * Returns:
+ *   Number of changes created
+ */
+static int sql_store(SQLTracker *tracker, const struct SQLStatement *proto, const uint32_t *column_ids,
+                     uint32_t column_count, const char *query, const char *old_value, const char *new_value) {
+    if (proto->timestamp_ns > tracker->last_timestamp_ns) {
+        tracker->last_timestamp_ns = proto->timestamp_ns;
+    }
+    
+    // Columns that fit: everything in ring mode, what is left of the capacity otherwise
+    int created_count = (int)column_count;
+    if (tracker->retention == SQL_RETAIN_FIRST && tracker->max_changes &&
+        created_count > tracker->max_changes - tracker->change_count) {
+        created_count = tracker->max_changes - tracker->change_count;
+    }
+    tracker->dropped += (uint64_t)((int)column_count - created_count);
+    if (created_count <= 0 || sql_reserve(tracker, (size_t)created_count) < 0) {
+        return 0;
+    }
+    
+    // One statement record holds what the columns share; the query is
+    // normalized straight into it and the unused tail handed back
+    size_t old_len = proto->old_len;
+    size_t new_len = proto->new_len;
+    struct SQLStatement *stmt = sql_statement_alloc(tracker, proto->query_len + old_len + new_len + 3);
+    if (!stmt) return 0;
+    
+    stmt->timestamp_ns = proto->timestamp_ns;
+    stmt->table_id = proto->table_id;
+    stmt->database_id = proto->database_id;
+    stmt->rows_affected = proto->rows_affected;
+    stmt->operation = proto->operation;
+    
+    char *text = stmt->text;
+    size_t query_len = sql_normalize_into(query, proto->query_len, text);
+    stmt->query_len = (uint32_t)query_len;
+    stmt->old_len = (uint32_t)old_len;
+    stmt->new_len = (uint32_t)new_len;
+    text += query_len + 1;
+    if (old_len) memcpy(text, old_value, old_len);
+    text[old_len] = '\0';
+    text += old_len + 1;
+    if (new_len) memcpy(text, new_value, new_len);
+    text[new_len] = '\0';
+    sql_statement_trim(tracker, stmt, query_len + old_len + new_len + 3);
+    
+    for (int i = 0; i < created_count; i++) {
+        sql_push(tracker, stmt, column_ids[i]);
+    }
+    return created_count;
+}
+
+/**
+ * First position in [lo, hi) of seqs (ring positions if NULL) at or after ns
+ */
+static uint32_t sql_lower_bound(const SQLTracker *tracker, const uint32_t *seqs,
+                                uint32_t lo, uint32_t hi, uint64_t ns) {
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        const SQLChangeRecord *rec = seqs ? sql_record_seq(tracker, seqs[mid]) : sql_record(tracker, (int)mid);
+        if (rec->stmt->timestamp_ns < ns) {
+            lo = mid + 1;
         } else {
-            normalized[write_idx++] = c;
+            hi = mid;
         }
     }
+    return lo;
+}
+
+/* ============================================================================
+ * STATEMENT CACHE
+ * ============================================================================
+ *
+ * Applications run the same few statements with different values, so the
+ * parse result (operation, table and column IDs) is cached per tracker
+ * under the statement fingerprint. A repeat costs the fingerprint pass and
+ * one hash lookup; unparseable statements are cached too, as negative
+ * entries. Plans live in a fixed array, allocated on first use, chained by
+ * fingerprint bucket and kept in LRU order for eviction.
+ */
+
+#define SQL_CACHE_ENTRIES 256              // Default plans per tracker
+#define SQL_NO_PLAN UINT32_MAX
+
+struct SQLPlan {
+    uint64_t fingerprint;
+    uint32_t prev;                          // LRU neighbours, most recent at head
+    uint32_t next;
+    uint32_t chain;                         // Next plan in the same bucket
+    uint32_t operation;
+    uint32_t table_id;
+    uint32_t column_count;
+    uint32_t *column_ids;
+};
+
+static int cache_alloc(SQLStatementCache *c) {
+    uint32_t buckets = 16;
+    while (buckets < c->capacity) buckets *= 2;
+    
+    c->plans = (struct SQLPlan *)malloc(c->capacity * sizeof(struct SQLPlan));
+    c->buckets = (uint32_t *)malloc(buckets * sizeof(uint32_t));
+    if (!c->plans || !c->buckets) {
+        free(c->plans);
+        free(c->buckets);
+        c->plans = NULL;
+        c->buckets = NULL;
+        return -1;
+    }
+    memset(c->buckets, 0xff, buckets * sizeof(uint32_t));
+    c->num_buckets = buckets;
+    c->head = c->tail = SQL_NO_PLAN;
+    return 0;
+}
+
+static void cache_free(SQLStatementCache *c) {
+    for (uint32_t i = 0; i < c->count; i++) {
+        free(c->plans[i].column_ids);
+    }
+    free(c->plans);
+    free(c->buckets);
+}
+
+static void lru_unlink(SQLStatementCache *c, uint32_t i) {
+    struct SQLPlan *plan = &c->plans[i];
+    if (plan->prev != SQL_NO_PLAN) c->plans[plan->prev].next = plan->next;
+    else c->head = plan->next;
+    if (plan->next != SQL_NO_PLAN) c->plans[plan->next].prev = plan->prev;
+    else c->tail = plan->prev;
+}
+
+static void lru_push_front(SQLStatementCache *c, uint32_t i) {
+    c->plans[i].prev = SQL_NO_PLAN;
+    c->plans[i].next = c->head;
+    if (c->head != SQL_NO_PLAN) c->plans[c->head].prev = i;
+    c->head = i;
+    if (c->tail == SQL_NO_PLAN) c->tail = i;
+}
+
+static const struct SQLPlan *cache_find(SQLStatementCache *c, uint64_t fingerprint) {
+    if (!c->plans) return NULL;
+    
+    for (uint32_t i = c->buckets[fingerprint & (c->num_buckets - 1)]; i != SQL_NO_PLAN; i = c->plans[i].chain) {
+        if (c->plans[i].fingerprint == fingerprint) {
+            if (c->head != i) {
+                lru_unlink(c, i);
+                lru_push_front(c, i);
+            }
+            return &c->plans[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Cache a copy of plan, evicting the least recently used one when full
+ * 
+ * Returns:
+ *   The cached plan, or NULL if the cache is off or out of memory
+ */
+static const struct SQLPlan *cache_insert(SQLStatementCache *c, const struct SQLPlan *plan) {
+    if (c->capacity == 0 || (!c->plans && cache_alloc(c) < 0)) return NULL;
+    
+    uint32_t *column_ids = NULL;
+    if (plan->column_count) {
+        column_ids = (uint32_t *)malloc(plan->column_count * sizeof(uint32_t));
+        if (!column_ids) return NULL;
+        memcpy(column_ids, plan->column_ids, plan->column_count * sizeof(uint32_t));
+    }
+    
+    uint32_t i;
+    if (c->count < c->capacity) {
+        i = c->count++;
+    } else {
+        i = c->tail;
+        lru_unlink(c, i);
+        uint32_t *link = &c->buckets[c->plans[i].fingerprint & (c->num_buckets - 1)];
+        while (*link != i) link = &c->plans[*link].chain;
+        *link = c->plans[i].chain;
+        free(c->plans[i].column_ids);
+        c->evictions++;
+    }
+    
+    struct SQLPlan *slot = &c->plans[i];
+    *slot = *plan;
+    slot->column_ids = column_ids;
+    uint32_t *bucket = &c->buckets[plan->fingerprint & (c->num_buckets - 1)];
+    slot->chain = *bucket;
+    *bucket = i;
+    lru_push_front(c, i);
+    return slot;
+}
+
+/**
+ * Parse a statement and intern its names into plan (column_ids has
+ * room for SQL_MAX_COLUMNS)
+ * 
+ * Returns:
+ *   0 on success, -1 if out of memory
+ */
+static int sql_plan_build(SQLTracker *tracker, const char *query, size_t len, struct SQLPlan *plan) {
+    SQLParse parse;
+    sql_parse(query, len, &parse);
+    
+    plan->operation = (uint32_t)parse.operation;
+    plan->table_id = 0;
+    plan->column_count = 0;
+    if (parse.operation == SQL_UNKNOWN || parse.table == SQL_NO_NAME) return 0;
+    
+    if (sql_intern(&tracker->names, parse.text + parse.table, MAX_TABLE_NAME, &plan->table_id) < 0) return -1;
+    for (uint32_t i = 0; i < parse.column_count; i++) {
+        if (sql_intern(&tracker->names, parse.text + parse.columns[i], MAX_COLUMN_NAME,
+                       &plan->column_ids[plan->column_count]) < 0) {
+            return -1;
+        }
+        plan->column_count++;
+    }
+    return 0;
+}
+
+/* ============================================================================
+ * CHANGE LOG
+ * ============================================================================
+ *
+ * With a storage_path every tracked statement is appended to a binary
+ * change log. The tracking call only copies one length-prefixed record
+ * into a single-producer ring; a writer thread batches records into
+ * blocks of up to SQL_LOG_BLOCK bytes, optionally LZ4-compresses them and
+ * writes each with one write(). A full ring drops the record (counted)
+ * rather than stall the caller. In the lite and deep compression modes a
+ * block is compressed with the last 64 KB of the block before it as its
+ * dictionary (a "linked" block), so the statements that open a block can
+ * refer back to the ones that closed the previous; the first block after
+ * an open or a failed write never is.
+ *
+ * File:    "MWSQLLOG", u32 version, u32 flags, then blocks
+ * Block:   SQLLogBlock, payload (LZ4 unless stored_len == raw_len)
+ * Record:  u32 len (whole record), u32 type, body
+ *   SEGMENT    the log was reopened: the name IDs seen so far are void
+ *   NAME       u32 id, text: an interned name, ahead of its first use
+ *   STATEMENT  SQLLogStatement, column IDs, raw query, old and new value
+ *
+ * Opening a log replays it into the tracker. A torn or corrupt tail (a
+ * crash mid-write) is cut back to the last intact block.
+ */
+
+#define SQL_LOG_MAGIC "MWSQLLOG"
+#define SQL_LOG_VERSION 1
+#define SQL_LOG_BLOCK_MAGIC 0x4b4c4253u     // "SBLK"
+#define SQL_LOG_LINKED_MAGIC 0x4c4c4253u    // "SBLL": previous block is the dictionary
+#define SQL_LOG_RING (4u << 20)             // Bytes queued for the writer (power of 2)
+#define SQL_LOG_BLOCK (256u << 10)          // Raw bytes per block (a larger record gets its own)
+#define SQL_LOG_IDLE_MS 50                  // Writer wake-up interval when idle
+
+enum {
+    SQL_LOG_SEGMENT = 1,
+    SQL_LOG_NAME = 2,
+    SQL_LOG_STATEMENT = 3
+};
+
+struct SQLLogHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+};
+
+struct SQLLogBlock {
+    uint32_t magic;
+    uint32_t raw_len;
+    uint32_t stored_len;
+    uint32_t crc;                           // CRC-32C of the stored payload
+};
+
+struct SQLLogRecord {
+    uint32_t len;
+    uint32_t type;
+};
+
+struct SQLLogStatement {
+    uint64_t timestamp_ns;
+    uint32_t table_id;
+    uint32_t database_id;
+    int32_t rows_affected;
+    uint32_t operation;
+    uint32_t column_count;
+    uint32_t query_len;
+    uint32_t old_len;
+    uint32_t new_len;
+};
+
+struct SQLLog {
+    int fd;
+    int compress;
+    char *ring;
+    _Atomic uint64_t head;                  // Consumed by the writer
+    _Atomic uint64_t tail;                  // Published by the tracker
+    uint32_t names_logged;                  // Names already in this segment (tracker side)
+    
+    pthread_t writer;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t drained;
+    _Atomic int sleeping;
+    _Atomic int stop;
+    _Atomic int error;                      // errno of a failed write
     
-    normalized[write_idx] = '\0';
-    return normalized;
+    char *block;                            // Writer buffers
+    size_t block_capacity;
+    char *packed;
+    size_t packed_capacity;
+    char *prev;                             // Tail of the last block written (linked modes)
+    size_t prev_len;
+    mw_lz4_dict_t *dict;
+    
+    _Atomic uint64_t records;
+    _Atomic uint64_t dropped;
+    _Atomic uint64_t blocks;
+    _Atomic uint64_t raw_bytes;
+    _Atomic uint64_t written_bytes;
+    _Atomic uint64_t compress_ns;
+    uint64_t loaded;
+};
+
+static void log_copy_in(struct SQLLog *log, uint64_t pos, const void *data, size_t len) {
+    size_t off = (size_t)(pos & (SQL_LOG_RING - 1));
+    size_t first = len < SQL_LOG_RING - off ? len : SQL_LOG_RING - off;
+    memcpy(log->ring + off, data, first);
+    memcpy(log->ring, (const char *)data + first, len - first);
+}
+
+static void log_copy_out(const struct SQLLog *log, uint64_t pos, void *data, size_t len) {
+    size_t off = (size_t)(pos & (SQL_LOG_RING - 1));
+    size_t first = len < SQL_LOG_RING - off ? len : SQL_LOG_RING - off;
+    memcpy(data, log->ring + off, first);
+    memcpy((char *)data + first, log->ring, len - first);
+}
+
+static uint64_t log_put(struct SQLLog *log, uint64_t pos, uint32_t type, size_t body_len,
+                        const void *a, size_t a_len) {
+    struct SQLLogRecord rec = { (uint32_t)(sizeof(rec) + body_len), type };
+    log_copy_in(log, pos, &rec, sizeof(rec));
+    if (a_len) log_copy_in(log, pos + sizeof(rec), a, a_len);
+    return pos + sizeof(rec) + a_len;
+}
+
+static void log_wake(struct SQLLog *log) {
+    pthread_mutex_lock(&log->lock);
+    pthread_cond_signal(&log->wake);
+    pthread_mutex_unlock(&log->lock);
 }
 
 /**
- * Extract SQL operation type from query
+ * Queue a statement, preceded by any names interned since the last one
+ * 
+ * Returns:
+ *   0 if queued, -1 if the ring had no room (the statement is dropped)
  */
-static SQLOperation detect_operation(const char *query) {
-    if (!query) return SQL_UNKNOWN;
-    
-    char *upper = (char *)malloc(strlen(query) + 1);
-    if (!upper) return SQL_UNKNOWN;
+static int sql_log_statement(SQLTracker *tracker, const struct SQLStatement *proto, const uint32_t *column_ids,
+                             uint32_t column_count, const char *query, const char *old_value,
+                             const char *new_value) {
+    struct SQLLog *log = tracker->log;
+    const SQLNameTable *names = &tracker->names;
     
-    for (size_t i = 0; query[i]; i++) {
-        upper[i] = toupper(query[i]);
+    size_t body = sizeof(struct SQLLogStatement) + column_count * sizeof(uint32_t) +
+                  proto->query_len + proto->old_len + proto->new_len;
+    size_t need = sizeof(struct SQLLogRecord) + body;
+    for (uint32_t id = log->names_logged; id < names->count; id++) {
+        need += sizeof(struct SQLLogRecord) + sizeof(uint32_t) + names->names[id].len;
     }
-    upper[strlen(query)] = '\0';
     
-    SQLOperation op = SQL_UNKNOWN;
+    uint64_t tail = atomic_load_explicit(&log->tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&log->head, memory_order_acquire);
+    if (need > SQL_LOG_RING - (tail - head)) {
+        atomic_fetch_add_explicit(&log->dropped, 1, memory_order_relaxed);
+        return -1;
+    }
     
-    if (strstr(upper, "INSERT") == upper || strstr(upper, "INSERT ") != NULL) {
-        op = SQL_INSERT;
-    } else if (strstr(upper, "UPDATE") == upper || strstr(upper, "UPDATE ") != NULL) {
-        op = SQL_UPDATE;
-    } else if (strstr(upper, "DELETE") == upper || strstr(upper, "DELETE ") != NULL) {
-        op = SQL_DELETE;
-    } else if (strstr(upper, "SELECT") == upper || strstr(upper, "SELECT ") != NULL) {
-        op = SQL_SELECT;
+    /* Names and statement are published together, so never split */
+    for (uint32_t id = log->names_logged; id < names->count; id++) {
+        const struct SQLName *name = &names->names[id];
+        uint64_t pos = log_put(log, tail, SQL_LOG_NAME, sizeof(uint32_t) + name->len, &id, sizeof(id));
+        log_copy_in(log, pos, name->text, name->len);
+        tail = pos + name->len;
     }
     
-    free(upper);
-    return op;
+    struct SQLLogStatement rec = {
+        proto->timestamp_ns, proto->table_id, proto->database_id, proto->rows_affected,
+        proto->operation, column_count, proto->query_len, proto->old_len, proto->new_len
+    };
+    uint64_t pos = log_put(log, tail, SQL_LOG_STATEMENT, body, &rec, sizeof(rec));
+    log_copy_in(log, pos, column_ids, column_count * sizeof(uint32_t));
+    pos += column_count * sizeof(uint32_t);
+    log_copy_in(log, pos, query, proto->query_len);
+    pos += proto->query_len;
+    if (proto->old_len) log_copy_in(log, pos, old_value, proto->old_len);
+    pos += proto->old_len;
+    if (proto->new_len) log_copy_in(log, pos, new_value, proto->new_len);
+    pos += proto->new_len;
+    
+    atomic_store_explicit(&log->tail, pos, memory_order_release);
+    log->names_logged = names->count;
+    atomic_fetch_add_explicit(&log->records, 1, memory_order_relaxed);
+    
+    /* The writer polls; only a filling ring is worth waking it early */
+    if (pos - head > SQL_LOG_RING / 2 && atomic_exchange_explicit(&log->sleeping, 0, memory_order_acq_rel)) {
+        log_wake(log);
+    }
+    return 0;
+}
+
+static int write_all(int fd, const char *data, size_t len) {
+    while (len) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int grow_buffer(char **buffer, size_t *capacity, size_t need) {
+    if (need <= *capacity) return 0;
+    char *grown = (char *)realloc(*buffer, need);
+    if (!grown) return -1;
+    *buffer = grown;
+    *capacity = need;
+    return 0;
 }
 
 /**
- * Extract table name from query using regex
+ * Write queued records from head up to tail as one block
+ * 
+ * Returns:
+ *   The new head
  */
-static char *extract_table_name(const char *query, SQLOperation op) {
-    if (!query) return NULL;
-    
-    char *table_name = (char *)malloc(256);
-    if (!table_name) return NULL;
+static uint64_t log_write_block(struct SQLLog *log, uint64_t head, uint64_t tail) {
+    size_t used = 0;
+    uint64_t start = head;
     
-    const char *search_str = NULL;
-    const char *start_pos = NULL;
+    while (head < tail) {
+        struct SQLLogRecord rec;
+        log_copy_out(log, head, &rec, sizeof(rec));
+        if (used && used + rec.len > SQL_LOG_BLOCK) break;
+        if (grow_buffer(&log->block, &log->block_capacity, used + rec.len) < 0) break;
+        log_copy_out(log, head, log->block + used, rec.len);
+        used += rec.len;
+        head += rec.len;
+    }
+    if (used == 0) {
+        /* Out of memory for the block: lose the records rather than spin */
+        atomic_fetch_add_explicit(&log->dropped, 1, memory_order_relaxed);
+        struct SQLLogRecord rec;
+        log_copy_out(log, head, &rec, sizeof(rec));
+        return head + rec.len;
+    }
     
-    switch (op) {
-        case SQL_INSERT:
-            search_str = "INSERT INTO";
-            start_pos = strstr(query, search_str);
-            if (start_pos) {
-                start_pos += strlen(search_str);
-                while (*start_pos && isspace(*start_pos)) start_pos++;
-                
-                int i = 0;
-                while (*start_pos && !isspace(*start_pos) && *start_pos != '(' && i < 255) {
-                    if (*start_pos != '`' && *start_pos != '"' && *start_pos != '\'') {
-                        table_name[i++] = *start_pos;
-                    }
-                    start_pos++;
-                }
-                table_name[i] = '\0';
-            }
-            break;
-            
-        case SQL_UPDATE:
-            search_str = "UPDATE";
-            start_pos = strstr(query, search_str);
-            if (start_pos) {
-                start_pos += strlen(search_str);
-                while (*start_pos && isspace(*start_pos)) start_pos++;
-                
-                int i = 0;
-                while (*start_pos && !isspace(*start_pos) && *start_pos != '(' && i < 255) {
-                    if (*start_pos != '`' && *start_pos != '"' && *start_pos != '\'') {
-                        table_name[i++] = *start_pos;
-                    }
-                    start_pos++;
-                }
-                table_name[i] = '\0';
+    struct SQLLogBlock block = { SQL_LOG_BLOCK_MAGIC, (uint32_t)used, (uint32_t)used, 0 };
+    size_t bound = sizeof(block) + mw_lz4_bound(used);
+    if (grow_buffer(&log->packed, &log->packed_capacity, bound) == 0 && !atomic_load(&log->error)) {
+        char *payload = log->packed + sizeof(block);
+        size_t stored = 0;
+        if (log->compress != MW_COMPRESS_OFF) {
+            struct timespec t0, t1;
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            if (log->dict && log->prev_len) {
+                stored = mw_lz4_compress_dict(log->dict, log->block, used, payload, used - 1);
+                if (stored) block.magic = SQL_LOG_LINKED_MAGIC;
+            } else {
+                stored = mw_lz4_compress(log->block, used, payload, used - 1);
             }
-            break;
-            
-        case SQL_DELETE:
-            search_str = "FROM";
-            start_pos = strstr(query, search_str);
-            if (start_pos) {
-                start_pos += strlen(search_str);
-                while (*start_pos && isspace(*start_pos)) start_pos++;
-                
-                int i = 0;
-                while (*start_pos && !isspace(*start_pos) && *start_pos != '(' && i < 255) {
-                    if (*start_pos != '`' && *start_pos != '"' && *start_pos != '\'') {
-                        table_name[i++] = *start_pos;
-                    }
-                    start_pos++;
-                }
-                table_name[i] = '\0';
-            }
-            break;
-            
-        case SQL_SELECT:
-            search_str = "FROM";
-            start_pos = strstr(query, search_str);
-            if (start_pos) {
-                start_pos += strlen(search_str);
-                while (*start_pos && isspace(*start_pos)) start_pos++;
-                
-                int i = 0;
-                while (*start_pos && !isspace(*start_pos) && *start_pos != '(' && i < 255) {
-                    if (*start_pos != '`' && *start_pos != '"' && *start_pos != '\'') {
-                        table_name[i++] = *start_pos;
-                    }
-                    start_pos++;
-                }
-                table_name[i] = '\0';
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            atomic_fetch_add_explicit(&log->compress_ns, (uint64_t)(t1.tv_sec - t0.tv_sec) * 1000000000ULL +
+                                      (uint64_t)t1.tv_nsec - (uint64_t)t0.tv_nsec, memory_order_relaxed);
+        }
+        if (stored == 0) {
+            memcpy(payload, log->block, used);
+            stored = used;
+        }
+        block.stored_len = (uint32_t)stored;
+        block.crc = mw_crc32c(0, payload, stored);
+        memcpy(log->packed, &block, sizeof(block));
+        
+        if (write_all(log->fd, log->packed, sizeof(block) + stored) == 0) {
+            if (log->dict) {
+                size_t keep = used < MW_LZ4_DICT_MAX ? used : MW_LZ4_DICT_MAX;
+                memcpy(log->prev, log->block + used - keep, keep);
+                log->prev_len = keep;
+                mw_lz4_dict_load(log->dict, log->prev, keep);
             }
-            break;
-            
-        default:
-            free(table_name);
-            return NULL;
+            atomic_fetch_add_explicit(&log->blocks, 1, memory_order_relaxed);
+            atomic_fetch_add_explicit(&log->raw_bytes, used, memory_order_relaxed);
+            atomic_fetch_add_explicit(&log->written_bytes, sizeof(block) + stored, memory_order_relaxed);
+            return head;
+        }
+        atomic_store(&log->error, errno);
     }
+    log->prev_len = 0;                      // The next block must stand alone
     
-    if (strlen(table_name) == 0) {
-        free(table_name);
-        return NULL;
+    /* A failed write loses the block's statements */
+    for (uint64_t pos = start; pos < head;) {
+        struct SQLLogRecord rec;
+        log_copy_out(log, pos, &rec, sizeof(rec));
+        if (rec.type == SQL_LOG_STATEMENT) {
+            atomic_fetch_add_explicit(&log->dropped, 1, memory_order_relaxed);
+        }
+        pos += rec.len;
     }
+    return head;
+}
+
+static void *sql_log_writer(void *arg) {
+    struct SQLLog *log = (struct SQLLog *)arg;
     
-    return table_name;
+    for (;;) {
+        uint64_t head = atomic_load_explicit(&log->head, memory_order_relaxed);
+        uint64_t tail = atomic_load_explicit(&log->tail, memory_order_acquire);
+        
+        if (head == tail) {
+            pthread_mutex_lock(&log->lock);
+            pthread_cond_broadcast(&log->drained);
+            if (atomic_load(&log->stop)) {
+                pthread_mutex_unlock(&log->lock);
+                break;
+            }
+            atomic_store(&log->sleeping, 1);
+            if (atomic_load_explicit(&log->tail, memory_order_acquire) == head) {
+                struct timespec deadline;
+                clock_gettime(CLOCK_MONOTONIC, &deadline);
+                deadline.tv_nsec += SQL_LOG_IDLE_MS * 1000000L;
+                if (deadline.tv_nsec >= 1000000000L) {
+                    deadline.tv_sec++;
+                    deadline.tv_nsec -= 1000000000L;
+                }
+                pthread_cond_timedwait(&log->wake, &log->lock, &deadline);
+            }
+            atomic_store(&log->sleeping, 0);
+            pthread_mutex_unlock(&log->lock);
+            continue;
+        }
+        
+        head = log_write_block(log, head, tail);
+        atomic_store_explicit(&log->head, head, memory_order_release);
+        
+        pthread_mutex_lock(&log->lock);
+        pthread_cond_broadcast(&log->drained);
+        pthread_mutex_unlock(&log->lock);
+    }
+    return NULL;
 }
 
+typedef void (*SQLLogVisitor)(void *ctx, uint32_t type, const char *body, size_t len);
+
 /**
- * Extract columns from UPDATE SET clause
+ * Walk the records of a change log
+ * 
+ * Returns:
+ *   Offset just past the last intact block, or -1 with errno set if the
+ *   file is not a change log
  */
-static char **extract_update_columns(const char *query, int *column_count) {
-    char **columns = (char **)malloc(sizeof(char *) * 100);
-    if (!columns) return NULL;
-    
-    *column_count = 0;
-    
-    const char *set_pos = strstr(query, "SET");
-    if (!set_pos) {
-        return columns;
+static off_t sql_log_read(int fd, SQLLogVisitor visit, void *ctx) {
+    struct stat st;
+    if (fstat(fd, &st) < 0) return -1;
+    size_t size = (size_t)st.st_size;
+    if (size < sizeof(struct SQLLogHeader)) {
+        errno = EINVAL;
+        return -1;
     }
     
-    set_pos += 3;
+    const char *map = (const char *)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) return -1;
+    madvise((void *)map, size, MADV_SEQUENTIAL);
     
-    // Find WHERE or end of query
-    const char *end_pos = strstr(set_pos, "WHERE");
-    if (!end_pos) {
-        end_pos = set_pos + strlen(set_pos);
+    struct SQLLogHeader header;
+    memcpy(&header, map, sizeof(header));
+    if (memcmp(header.magic, SQL_LOG_MAGIC, sizeof(header.magic)) != 0 || header.version != SQL_LOG_VERSION) {
+        munmap((void *)map, size);
+        errno = EINVAL;
+        return -1;
     }
     
-    char buffer[256];
-    int buffer_idx = 0;
-    
-    for (const char *p = set_pos; p < end_pos && *column_count < 100; p++) {
-        if (*p == '=' || *p == ',' || *p == ' ' || p == end_pos - 1) {
-            if (buffer_idx > 0) {
-                if (p == end_pos - 1 && *p != '=' && *p != ',') {
-                    buffer[buffer_idx++] = *p;
-                }
-                
-                // Trim whitespace
-                int start = 0;
-                while (start < buffer_idx && isspace(buffer[start])) start++;
-                int end = buffer_idx - 1;
-                while (end >= start && isspace(buffer[end])) end--;
-                
-                if (end >= start) {
-                    char *column = (char *)malloc(end - start + 2);
-                    if (column) {
-                        strncpy(column, buffer + start, end - start + 1);
-                        column[end - start + 1] = '\0';
-                        
-                        // Remove quotes if present
-                        if ((column[0] == '`' || column[0] == '"' || column[0] == '\'') &&
-                            (column[strlen(column) - 1] == '`' || column[strlen(column) - 1] == '"' || column[strlen(column) - 1] == '\'')) {
-                            memmove(column, column + 1, strlen(column) - 2);
-                            column[strlen(column) - 2] = '\0';
-                        }
-                        
-                        columns[*column_count] = column;
-                        (*column_count)++;
-                    }
-                }
-                buffer_idx = 0;
+    char *raw = NULL;
+    size_t raw_capacity = 0;
+    char prev[MW_LZ4_DICT_MAX];
+    size_t prev_len = 0;
+    size_t pos = sizeof(header);
+    while (size - pos >= sizeof(struct SQLLogBlock)) {
+        struct SQLLogBlock block;
+        memcpy(&block, map + pos, sizeof(block));
+        const char *payload = map + pos + sizeof(block);
+        int linked = block.magic == SQL_LOG_LINKED_MAGIC;
+        if ((block.magic != SQL_LOG_BLOCK_MAGIC && !linked) || block.stored_len > size - pos - sizeof(block) ||
+            block.stored_len > block.raw_len || mw_crc32c(0, payload, block.stored_len) != block.crc) {
+            break;
+        }
+        
+        const char *data = payload;
+        if (block.stored_len != block.raw_len) {
+            long got = -1;
+            if (grow_buffer(&raw, &raw_capacity, block.raw_len) == 0) {
+                got = linked ? mw_lz4_decompress_dict(prev, prev_len, payload, block.stored_len, raw, block.raw_len)
+                             : mw_lz4_decompress(payload, block.stored_len, raw, block.raw_len);
             }
-        } else if (!isspace(*p)) {
-            buffer[buffer_idx++] = *p;
+            if (got != (long)block.raw_len) break;
+            data = raw;
+        }
+        
+        /* Check the whole block first: a bad one is not replayed at all */
+        size_t off = 0;
+        while (block.raw_len - off >= sizeof(struct SQLLogRecord)) {
+            struct SQLLogRecord rec;
+            memcpy(&rec, data + off, sizeof(rec));
+            if (rec.len < sizeof(rec) || rec.len > block.raw_len - off) break;
+            off += rec.len;
+        }
+        if (off != block.raw_len) break;
+        for (off = 0; off < block.raw_len;) {
+            struct SQLLogRecord rec;
+            memcpy(&rec, data + off, sizeof(rec));
+            visit(ctx, rec.type, data + off + sizeof(rec), rec.len - sizeof(rec));
+            off += rec.len;
         }
+        prev_len = block.raw_len < sizeof(prev) ? block.raw_len : sizeof(prev);
+        memcpy(prev, data + block.raw_len - prev_len, prev_len);
+        pos += sizeof(block) + block.stored_len;
     }
     
-    return columns;
+    free(raw);
+    munmap((void *)map, size);
+    return (off_t)pos;
 }
 
 /**
- * Extract columns from INSERT column list
+ * Check a STATEMENT body and locate its parts
+ * 
+ * Returns:
+ *   0 if it is well formed
  */
-static char **extract_insert_columns(const char *query, int *column_count) {
-    char **columns = (char **)malloc(sizeof(char *) * 100);
-    if (!columns) return NULL;
-    
-    *column_count = 0;
-    
-    const char *open_paren = strchr(query, '(');
-    if (!open_paren) {
-        // No column list specified, use *
-        columns[0] = (char *)malloc(2);
-        strcpy(columns[0], "*");
-        *column_count = 1;
-        return columns;
-    }
-    
-    const char *close_paren = strchr(open_paren, ')');
-    if (!close_paren) {
-        columns[0] = (char *)malloc(2);
-        strcpy(columns[0], "*");
-        *column_count = 1;
-        return columns;
-    }
-    
-    // Skip "INSERT INTO table_name ("
-    const char *start = open_paren + 1;
-    
-    char buffer[256];
-    int buffer_idx = 0;
+static int log_statement_parts(const char *body, size_t len, struct SQLLogStatement *rec,
+                               const char **columns, const char **text) {
+    if (len < sizeof(*rec)) return -1;
+    memcpy(rec, body, sizeof(*rec));
+    uint64_t need = sizeof(*rec) + (uint64_t)rec->column_count * sizeof(uint32_t) +
+                    (uint64_t)rec->query_len + rec->old_len + rec->new_len;
+    if (need != len) return -1;
+    *columns = body + sizeof(*rec);
+    *text = *columns + rec->column_count * sizeof(uint32_t);
+    return 0;
+}
+
+/* Replay: log name IDs map to this tracker's IDs, per segment */
+struct SQLLogReplay {
+    SQLTracker *tracker;
+    uint32_t *ids;
+    uint32_t num_ids;
+};
+
+static void replay_visit(void *ctx, uint32_t type, const char *body, size_t len) {
+    struct SQLLogReplay *replay = (struct SQLLogReplay *)ctx;
+    SQLTracker *tracker = replay->tracker;
     
-    for (const char *p = start; p < close_paren && *column_count < 100; p++) {
-        if (*p == ',' || p == close_paren - 1) {
-            if (p == close_paren - 1 && *p != ',') {
-                buffer[buffer_idx++] = *p;
-            }
-            
-            if (buffer_idx > 0) {
-                // Trim whitespace
-                int trim_start = 0;
-                while (trim_start < buffer_idx && isspace(buffer[trim_start])) trim_start++;
-                int trim_end = buffer_idx - 1;
-                while (trim_end >= trim_start && isspace(buffer[trim_end])) trim_end--;
-                
-                if (trim_end >= trim_start) {
-                    char *column = (char *)malloc(trim_end - trim_start + 2);
-                    if (column) {
-                        strncpy(column, buffer + trim_start, trim_end - trim_start + 1);
-                        column[trim_end - trim_start + 1] = '\0';
-                        
-                        columns[*column_count] = column;
-                        (*column_count)++;
-                    }
-                }
-                buffer_idx = 0;
-            }
-        } else {
-            buffer[buffer_idx++] = *p;
+    if (type == SQL_LOG_SEGMENT) {
+        if (replay->ids) memset(replay->ids, 0, replay->num_ids * sizeof(uint32_t));
+    } else if (type == SQL_LOG_NAME && len >= sizeof(uint32_t)) {
+        uint32_t log_id;
+        memcpy(&log_id, body, sizeof(log_id));
+        if (log_id >= replay->num_ids) {
+            uint32_t count = replay->num_ids ? replay->num_ids : 64;
+            while (count <= log_id) count *= 2;
+            uint32_t *ids = (uint32_t *)realloc(replay->ids, count * sizeof(uint32_t));
+            if (!ids) return;
+            memset(ids + replay->num_ids, 0, (count - replay->num_ids) * sizeof(uint32_t));
+            replay->ids = ids;
+            replay->num_ids = count;
         }
+        size_t name_len = len - sizeof(uint32_t);
+        if (name_len > MAX_COLUMN_NAME - 1) name_len = MAX_COLUMN_NAME - 1;
+        sql_intern_len(&tracker->names, body + sizeof(uint32_t), name_len, &replay->ids[log_id]);
+    } else if (type == SQL_LOG_STATEMENT) {
+        struct SQLLogStatement rec;
+        const char *columns;
+        const char *text;
+        if (log_statement_parts(body, len, &rec, &columns, &text) < 0) return;
+        
+        uint32_t column_ids[SQL_MAX_COLUMNS];
+        uint32_t count = rec.column_count < SQL_MAX_COLUMNS ? rec.column_count : SQL_MAX_COLUMNS;
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t log_id;
+            memcpy(&log_id, columns + i * sizeof(uint32_t), sizeof(log_id));
+            column_ids[i] = log_id < replay->num_ids ? replay->ids[log_id] : 0;
+        }
+        
+        struct SQLStatement proto = { 0 };
+        proto.timestamp_ns = rec.timestamp_ns;
+        proto.table_id = rec.table_id < replay->num_ids ? replay->ids[rec.table_id] : 0;
+        proto.database_id = rec.database_id < replay->num_ids ? replay->ids[rec.database_id] : 0;
+        proto.rows_affected = rec.rows_affected;
+        proto.operation = rec.operation <= SQL_SELECT ? rec.operation : SQL_UNKNOWN;
+        proto.query_len = rec.query_len;
+        proto.old_len = rec.old_len;
+        proto.new_len = rec.new_len;
+        if (!proto.table_id || proto.timestamp_ns < tracker->last_timestamp_ns) return;
+        
+        sql_store(tracker, &proto, column_ids, count, text, text + rec.query_len,
+                  text + rec.query_len + rec.old_len);
+        tracker->log->loaded++;
     }
+}
+
+static void sql_log_close(struct SQLLog *log) {
+    pthread_mutex_lock(&log->lock);
+    atomic_store(&log->stop, 1);
+    pthread_cond_signal(&log->wake);
+    pthread_mutex_unlock(&log->lock);
+    pthread_join(log->writer, NULL);
     
-    if (*column_count == 0) {
-        columns[0] = (char *)malloc(2);
-        strcpy(columns[0], "*");
-        *column_count = 1;
-    }
-    
-    return columns;
+    fdatasync(log->fd);
+    close(log->fd);
+    pthread_mutex_destroy(&log->lock);
+    pthread_cond_destroy(&log->wake);
+    pthread_cond_destroy(&log->drained);
+    free(log->ring);
+    free(log->block);
+    free(log->packed);
+    free(log->prev);
+    free(log->dict);
+    free(log);
 }
 
 /**
- * Extract columns from SELECT clause
+ * Open (or create) the change log, replay it, and start its writer
+ * 
+ * Returns:
+ *   0 on success, -1 with errno set
  */
-static char **extract_select_columns(const char *query, int *column_count) {
-    char **columns = (char **)malloc(sizeof(char *) * 100);
-    if (!columns) return NULL;
-    
-    *column_count = 0;
+static int sql_log_open(SQLTracker *tracker, const char *path, int compress) {
+    struct SQLLog *log = (struct SQLLog *)calloc(1, sizeof(struct SQLLog));
+    if (!log) return -1;
+    log->compress = compress;
+    if (compress == MW_COMPRESS_LITE || compress == MW_COMPRESS_DEEP) {
+        log->prev = (char *)malloc(MW_LZ4_DICT_MAX);
+        log->dict = (mw_lz4_dict_t *)malloc(sizeof(mw_lz4_dict_t));
+        if (!log->prev || !log->dict) {
+            free(log->prev);
+            free(log->dict);
+            log->prev = NULL;
+            log->dict = NULL;
+        }
+    }
+    log->ring = (char *)malloc(SQL_LOG_RING);
+    log->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (!log->ring || log->fd < 0) {
+        int saved = errno;
+        if (log->fd >= 0) close(log->fd);
+        free(log->ring);
+        free(log->prev);
+        free(log->dict);
+        free(log);
+        errno = saved;
+        return -1;
+    }
+    tracker->log = log;
     
-    const char *select_pos = strstr(query, "SELECT");
-    if (!select_pos) {
-        columns[0] = (char *)malloc(2);
-        strcpy(columns[0], "*");
-        *column_count = 1;
-        return columns;
+    struct stat st;
+    off_t end = 0;
+    if (fstat(log->fd, &st) == 0 && st.st_size == 0) {
+        struct SQLLogHeader header = { SQL_LOG_MAGIC, SQL_LOG_VERSION, 0 };
+        end = write_all(log->fd, (const char *)&header, sizeof(header)) == 0 ? (off_t)sizeof(header) : -1;
+    } else {
+        struct SQLLogReplay replay = { tracker, NULL, 0 };
+        end = sql_log_read(log->fd, replay_visit, &replay);
+        free(replay.ids);
+        if (end >= 0 && end < st.st_size && ftruncate(log->fd, end) < 0) end = -1;
     }
     
-    select_pos += 6;
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&log->lock, NULL);
+    pthread_cond_init(&log->wake, &attr);
+    pthread_cond_init(&log->drained, NULL);
+    pthread_condattr_destroy(&attr);
     
-    // Find FROM
-    const char *from_pos = strstr(select_pos, "FROM");
-    if (!from_pos) {
-        from_pos = select_pos + strlen(select_pos);
+    if (end < 0 || lseek(log->fd, end, SEEK_SET) < 0 ||
+        (errno = pthread_create(&log->writer, NULL, sql_log_writer, log)) != 0) {
+        int saved = errno;
+        close(log->fd);
+        pthread_mutex_destroy(&log->lock);
+        pthread_cond_destroy(&log->wake);
+        pthread_cond_destroy(&log->drained);
+        free(log->ring);
+        free(log->prev);
+        free(log->dict);
+        free(log);
+        tracker->log = NULL;
+        errno = saved;
+        return -1;
     }
     
-    char buffer[256];
-    int buffer_idx = 0;
-    
-    for (const char *p = select_pos; p < from_pos && *column_count < 100; p++) {
-        if (*p == ',' || p == from_pos - 1) {
-            if (p == from_pos - 1 && *p != ',') {
-                buffer[buffer_idx++] = *p;
-            }
-            
-            if (buffer_idx > 0) {
-                int trim_start = 0;
-                while (trim_start < buffer_idx && isspace(buffer[trim_start])) trim_start++;
-                int trim_end = buffer_idx - 1;
-                while (trim_end >= trim_start && isspace(buffer[trim_end])) trim_end--;
-                
-                if (trim_end >= trim_start) {
-                    char *column = (char *)malloc(trim_end - trim_start + 2);
-                    if (column) {
-                        strncpy(column, buffer + trim_start, trim_end - trim_start + 1);
-                        column[trim_end - trim_start + 1] = '\0';
-                        
-                        columns[*column_count] = column;
-                        (*column_count)++;
-                    }
-                }
-                buffer_idx = 0;
-            }
-        } else if (*p != ' ' || buffer_idx > 0) {
-            buffer[buffer_idx++] = *p;
+    /* New segment: this tracker's name IDs, sent again as they are used */
+    log_put(log, 0, SQL_LOG_SEGMENT, 0, NULL, 0);
+    log->names_logged = 1;
+    atomic_store_explicit(&log->tail, sizeof(struct SQLLogRecord), memory_order_release);
+    return 0;
+}
+
+/* Export: one JSON line per column, names kept per segment */
+struct SQLLogExport {
+    FILE *out;
+    char **names;
+    uint32_t num_names;
+    long lines;
+};
+
+static void json_string(FILE *out, const char *s, size_t len) {
+    fputc('"', out);
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c == '"' || c == '\\') {
+            fputc('\\', out);
+            fputc(c, out);
+        } else if (c == '\n') {
+            fputs("\\n", out);
+        } else if (c == '\t') {
+            fputs("\\t", out);
+        } else if (c == '\r') {
+            fputs("\\r", out);
+        } else if (c < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
         }
     }
+    fputc('"', out);
+}
+
+static void json_name(FILE *out, const struct SQLLogExport *ex, uint32_t id) {
+    const char *name = id < ex->num_names && ex->names[id] ? ex->names[id] : "";
+    json_string(out, name, strlen(name));
+}
+
+static void export_visit(void *ctx, uint32_t type, const char *body, size_t len) {
+    struct SQLLogExport *ex = (struct SQLLogExport *)ctx;
     
-    if (*column_count == 0) {
-        columns[0] = (char *)malloc(2);
-        strcpy(columns[0], "*");
-        *column_count = 1;
+    if (type == SQL_LOG_SEGMENT) {
+        for (uint32_t i = 0; i < ex->num_names; i++) {
+            free(ex->names[i]);
+            ex->names[i] = NULL;
+        }
+    } else if (type == SQL_LOG_NAME && len >= sizeof(uint32_t)) {
+        uint32_t id;
+        memcpy(&id, body, sizeof(id));
+        if (id >= ex->num_names) {
+            uint32_t count = ex->num_names ? ex->num_names : 64;
+            while (count <= id) count *= 2;
+            char **names = (char **)realloc(ex->names, count * sizeof(char *));
+            if (!names) return;
+            memset(names + ex->num_names, 0, (count - ex->num_names) * sizeof(char *));
+            ex->names = names;
+            ex->num_names = count;
+        }
+        free(ex->names[id]);
+        ex->names[id] = strndup(body + sizeof(uint32_t), len - sizeof(uint32_t));
+    } else if (type == SQL_LOG_STATEMENT) {
+        struct SQLLogStatement rec;
+        const char *columns;
+        const char *text;
+        if (log_statement_parts(body, len, &rec, &columns, &text) < 0) return;
+        
+        char *query = (char *)malloc(rec.query_len + 1);
+        if (!query) return;
+        size_t query_len = sql_normalize_into(text, rec.query_len, query);
+        SQLOperation op = rec.operation <= SQL_SELECT ? (SQLOperation)rec.operation : SQL_UNKNOWN;
+        
+        for (uint32_t i = 0; i < rec.column_count; i++) {
+            uint32_t column_id;
+            memcpy(&column_id, columns + i * sizeof(uint32_t), sizeof(column_id));
+            fprintf(ex->out, "{\"timestamp_ns\":%llu,\"table_name\":", (unsigned long long)rec.timestamp_ns);
+            json_name(ex->out, ex, rec.table_id);
+            fputs(",\"column_name\":", ex->out);
+            json_name(ex->out, ex, column_id);
+            fprintf(ex->out, ",\"operation\":\"%s\",\"old_value\":", sql_operation_to_string(op));
+            json_string(ex->out, text + rec.query_len, rec.old_len);
+            fputs(",\"new_value\":", ex->out);
+            json_string(ex->out, text + rec.query_len + rec.old_len, rec.new_len);
+            fprintf(ex->out, ",\"rows_affected\":%d,\"database\":", rec.rows_affected);
+            json_name(ex->out, ex, rec.database_id);
+            fputs(",\"full_query\":", ex->out);
+            json_string(ex->out, query, query_len);
+            fputs("}\n", ex->out);
+            ex->lines++;
+        }
+        free(query);
     }
-    
-    return columns;
 }
 
 /**
  * Initialize SQL tracker
  */
 SQLTracker *sql_tracker_init(const char *storage_path) {
-    SQLTracker *tracker = (SQLTracker *)malloc(sizeof(SQLTracker));
+    SQLTrackerConfig config = { storage_path, MAX_CHANGES, SQL_RETAIN_FIRST, 0, 0 };
+    return sql_tracker_init_ex(&config);
+}
+
+SQLTracker *sql_tracker_init_ex(const SQLTrackerConfig *config) {
+    if (!config || config->max_changes < 0 || config->cache_entries < -1 ||
+        (config->retention != SQL_RETAIN_FIRST && config->retention != SQL_RETAIN_LATEST)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    SQLTracker *tracker = (SQLTracker *)calloc(1, sizeof(SQLTracker));
     if (!tracker) return NULL;
     
-    tracker->changes = (SQLChange *)malloc(sizeof(SQLChange) * MAX_CHANGES);
-    if (!tracker->changes) {
+    if (names_init(&tracker->names) < 0) {
         free(tracker);
         return NULL;
     }
     
-    tracker->change_count = 0;
-    tracker->max_changes = MAX_CHANGES;
+    tracker->max_changes = config->max_changes;
+    tracker->retention = config->retention;
+    tracker->cache.capacity = config->cache_entries == 0 ? SQL_CACHE_ENTRIES :
+                              config->cache_entries < 0 ? 0 : (uint32_t)config->cache_entries;
     
-    if (storage_path) {
-        tracker->storage_path = (char *)malloc(strlen(storage_path) + 1);
+    if (config->storage_path) {
+        tracker->storage_path = (char *)malloc(strlen(config->storage_path) + 1);
         if (tracker->storage_path) {
-            strcpy(tracker->storage_path, storage_path);
+            strcpy(tracker->storage_path, config->storage_path);
+        }
+        if (sql_log_open(tracker, config->storage_path, config->compress_log) < 0) {
+            int saved = errno;
+            sql_tracker_free(tracker);
+            errno = saved;
+            return NULL;
         }
-    } else {
-        tracker->storage_path = NULL;
     }
     
     g_tracker = tracker;
@@ -430,110 +2049,54 @@ int sql_tracker_track_query(SQLTracker *tracker, const char *query, int rows_aff
                             const char *database, const char *old_value, const char *new_value) {
     if (!tracker || !query) return 0;
     
-    char *normalized = sql_normalize(query);
-    if (!normalized) return 0;
+    size_t query_len = strlen(query);
+    uint64_t fingerprint = sql_fingerprint(query, query_len);
     
-    SQLOperation op = detect_operation(normalized);
-    if (op == SQL_UNKNOWN) {
-        free(normalized);
-        return 0;
+    // Parse only statements the cache has not seen
+    const struct SQLPlan *plan = cache_find(&tracker->cache, fingerprint);
+    struct SQLPlan parsed;
+    uint32_t parsed_ids[SQL_MAX_COLUMNS];
+    if (plan) {
+        tracker->cache.hits++;
+    } else {
+        tracker->cache.misses++;
+        parsed.fingerprint = fingerprint;
+        parsed.column_ids = parsed_ids;
+        if (sql_plan_build(tracker, query, query_len, &parsed) < 0) return 0;
+        plan = cache_insert(&tracker->cache, &parsed);
+        if (!plan) plan = &parsed;
     }
     
-    char *table_name = extract_table_name(normalized, op);
-    if (!table_name) {
-        free(normalized);
+    if (plan->operation == SQL_UNKNOWN || plan->table_id == 0 || plan->column_count == 0) {
         return 0;
     }
     
-    char **columns = NULL;
-    int column_count = 0;
-    
-    switch (op) {
-        case SQL_UPDATE:
-            columns = extract_update_columns(normalized, &column_count);
-            break;
-        case SQL_INSERT:
-            columns = extract_insert_columns(normalized, &column_count);
-            break;
-        case SQL_SELECT:
-            columns = extract_select_columns(normalized, &column_count);
-            break;
-        case SQL_DELETE:
-            columns = (char **)malloc(sizeof(char *));
-            if (columns) {
-                columns[0] = (char *)malloc(2);
-                if (columns[0]) {
-                    strcpy(columns[0], "*");
-                    column_count = 1;
-                }
-            }
-            break;
-        default:
-            break;
-    }
-    
-    if (!columns || column_count == 0) {
-        free(table_name);
-        free(normalized);
+    uint32_t database_id = 0;
+    if (sql_intern(&tracker->names, database, MAX_DATABASE_NAME, &database_id) < 0) {
         return 0;
     }
     
-    // Create change entries for each column
-    int created_count = 0;
+    // Wall-clock timestamps, never going backwards so the ring stays sorted
     struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    uint64_t timestamp_ns = (uint64_t)ts.tv_sec * 1000000000UL + (uint64_t)ts.tv_nsec;
-    
-    for (int i = 0; i < column_count && tracker->change_count < tracker->max_changes; i++) {
-        SQLChange *change = &tracker->changes[tracker->change_count];
-        
-        change->timestamp_ns = timestamp_ns;
-        strncpy(change->table_name, table_name, sizeof(change->table_name) - 1);
-        change->table_name[sizeof(change->table_name) - 1] = '\0';
-        
-        strncpy(change->column_name, columns[i], sizeof(change->column_name) - 1);
-        change->column_name[sizeof(change->column_name) - 1] = '\0';
-        
-        change->operation = op;
-        change->rows_affected = rows_affected;
-        
-        if (old_value) {
-            strncpy(change->old_value, old_value, sizeof(change->old_value) - 1);
-            change->old_value[sizeof(change->old_value) - 1] = '\0';
-        } else {
-            change->old_value[0] = '\0';
-        }
-        
-        if (new_value) {
-            strncpy(change->new_value, new_value, sizeof(change->new_value) - 1);
-            change->new_value[sizeof(change->new_value) - 1] = '\0';
-        } else {
-            change->new_value[0] = '\0';
-        }
-        
-        if (database) {
-            strncpy(change->database, database, sizeof(change->database) - 1);
-            change->database[sizeof(change->database) - 1] = '\0';
-        } else {
-            change->database[0] = '\0';
-        }
-        
-        strncpy(change->full_query, normalized, sizeof(change->full_query) - 1);
-        change->full_query[sizeof(change->full_query) - 1] = '\0';
-        
-        tracker->change_count++;
-        created_count++;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    struct SQLStatement proto = { 0 };
+    proto.timestamp_ns = (uint64_t)ts.tv_sec * 1000000000UL + (uint64_t)ts.tv_nsec;
+    if (proto.timestamp_ns < tracker->last_timestamp_ns) {
+        proto.timestamp_ns = tracker->last_timestamp_ns;
     }
+    proto.table_id = plan->table_id;
+    proto.database_id = database_id;
+    proto.rows_affected = rows_affected;
+    proto.operation = plan->operation;
+    proto.query_len = (uint32_t)query_len;
+    proto.old_len = old_value ? (uint32_t)strlen(old_value) : 0;
+    proto.new_len = new_value ? (uint32_t)strlen(new_value) : 0;
     
-    // Cleanup
-    for (int i = 0; i < column_count; i++) {
-        if (columns[i]) free(columns[i]);
+    // The log records every statement, whatever the ring keeps of it
+    if (tracker->log) {
+        sql_log_statement(tracker, &proto, plan->column_ids, plan->column_count, query, old_value, new_value);
     }
-    free(columns);
-    free(table_name);
-    free(normalized);
-    
-    return created_count;
+    return sql_store(tracker, &proto, plan->column_ids, plan->column_count, query, old_value, new_value);
 }
 
 /**
@@ -549,31 +2112,83 @@ SQLTracker *sql_tracker_get_global(void) {
 void sql_tracker_summary(SQLTracker *tracker, SQLTrackerSummary *summary) {
     if (!tracker || !summary) return;
     
-    memset(summary, 0, sizeof(SQLTrackerSummary));
-    
+    // Counters are kept current by every insert and rotation
     summary->total_changes = tracker->change_count;
+    summary->insert_count = tracker->operation_counts[SQL_INSERT];
+    summary->update_count = tracker->operation_counts[SQL_UPDATE];
+    summary->delete_count = tracker->operation_counts[SQL_DELETE];
+    summary->select_count = tracker->operation_counts[SQL_SELECT];
+}
+
+/**
+ * Get one change by position
+ */
+int sql_tracker_get_change(SQLTracker *tracker, int index, SQLChange *out) {
+    if (!tracker || !out || index < 0 || index >= tracker->change_count) return -1;
+    sql_view(tracker, sql_record(tracker, index), out);
+    return 0;
+}
+
+/**
+ * Look up interned names
+ */
+uint32_t sql_tracker_name_id(SQLTracker *tracker, const char *name) {
+    if (!tracker || !name || !*name) return 0;
+    size_t len = strlen(name);
+    return names_find(&tracker->names, name, len, (uint32_t)mw_hash64(name, len));
+}
+
+const char *sql_tracker_name(SQLTracker *tracker, uint32_t id) {
+    if (!tracker || id >= tracker->names.count) return NULL;
+    return tracker->names.names[id].text;
+}
+
+/**
+ * Memory held by the tracker
+ */
+size_t sql_tracker_memory_usage(SQLTracker *tracker) {
+    if (!tracker) return 0;
     
-    for (int i = 0; i < tracker->change_count; i++) {
-        SQLChange *change = &tracker->changes[i];
-        
-        // Count by operation
-        switch (change->operation) {
-            case SQL_INSERT:
-                summary->insert_count++;
-                break;
-            case SQL_UPDATE:
-                summary->update_count++;
-                break;
-            case SQL_DELETE:
-                summary->delete_count++;
-                break;
-            case SQL_SELECT:
-                summary->select_count++;
-                break;
-            default:
-                break;
+    size_t bytes = sizeof(SQLTracker) + tracker->capacity * sizeof(SQLChangeRecord) + tracker->arena_bytes;
+    bytes += tracker->names.capacity * sizeof(struct SQLName) + tracker->names.num_slots * sizeof(uint32_t);
+    for (const struct SQLChunk *chunk = tracker->names.chunks; chunk; chunk = chunk->next) {
+        bytes += sizeof(struct SQLChunk) + chunk->size;
+    }
+    const SQLChangeIndex *ix = &tracker->index;
+    if (ix->built) {
+        bytes += ix->num_tables * sizeof(struct SQLPostings) + ix->pair_slots * sizeof(struct SQLPairSlot) +
+                 (SQL_SELECT + 1) * sizeof(struct SQLPostings);
+        for (uint32_t i = 0; i < ix->num_tables; i++) {
+            bytes += ix->by_table[i].capacity * sizeof(uint32_t);
+        }
+        for (uint32_t i = 0; i < ix->pair_slots; i++) {
+            bytes += ix->by_column[i].list.capacity * sizeof(uint32_t);
+        }
+        for (int op = 0; op <= SQL_SELECT; op++) {
+            bytes += ix->by_operation[op].capacity * sizeof(uint32_t);
         }
     }
+    if (tracker->cache.plans) {
+        bytes += tracker->cache.capacity * sizeof(struct SQLPlan) + tracker->cache.num_buckets * sizeof(uint32_t);
+        for (uint32_t i = 0; i < tracker->cache.count; i++) {
+            bytes += tracker->cache.plans[i].column_count * sizeof(uint32_t);
+        }
+    }
+    return bytes;
+}
+
+/**
+ * Statement cache counters
+ */
+void sql_tracker_cache_stats(SQLTracker *tracker, uint64_t *hits, uint64_t *misses, uint64_t *evictions) {
+    if (!tracker) return;
+    if (hits) *hits = tracker->cache.hits;
+    if (misses) *misses = tracker->cache.misses;
+    if (evictions) *evictions = tracker->cache.evictions;
+}
+
+uint64_t sql_tracker_fingerprint(const char *query) {
+    return query ? sql_fingerprint(query, strlen(query)) : 0;
 }
 
 /**
@@ -582,9 +2197,15 @@ void sql_tracker_summary(SQLTracker *tracker, SQLTrackerSummary *summary) {
 void sql_tracker_free(SQLTracker *tracker) {
     if (!tracker) return;
     
-    if (tracker->changes) {
-        free(tracker->changes);
+    // The writer drains the ring before it exits
+    if (tracker->log) {
+        sql_log_close(tracker->log);
     }
+    free(tracker->changes);
+    chunk_free_all(tracker->oldest);
+    names_free(&tracker->names);
+    cache_free(&tracker->cache);
+    index_free(&tracker->index);
     if (tracker->storage_path) {
         free(tracker->storage_path);
     }
@@ -596,58 +2217,208 @@ void sql_tracker_free(SQLTracker *tracker) {
 }
 
 /**
- * Get changes by filter
+ * Wait for the change log to reach the disk
  */
-int sql_tracker_get_changes(SQLTracker *tracker, const char *table_filter,
-                            const char *column_filter, const char *operation_filter,
-                            SQLChange **out_changes) {
-    if (!tracker || !out_changes) return 0;
+int sql_tracker_flush(SQLTracker *tracker) {
+    if (!tracker) {
+        errno = EINVAL;
+        return -1;
+    }
+    struct SQLLog *log = tracker->log;
+    if (!log) return 0;
     
-    int count = 0;
-    *out_changes = (SQLChange *)malloc(sizeof(SQLChange) * tracker->change_count);
+    uint64_t target = atomic_load_explicit(&log->tail, memory_order_acquire);
+    pthread_mutex_lock(&log->lock);
+    pthread_cond_signal(&log->wake);
+    while (atomic_load_explicit(&log->head, memory_order_acquire) < target) {
+        pthread_cond_wait(&log->drained, &log->lock);
+    }
+    pthread_mutex_unlock(&log->lock);
     
-    if (!*out_changes) return 0;
+    int error = atomic_load(&log->error);
+    if (error) {
+        errno = error;
+        return -1;
+    }
+    return fdatasync(log->fd);
+}
+
+/**
+ * Get change log counters
+ */
+int sql_tracker_log_stats(SQLTracker *tracker, SQLLogStats *stats) {
+    if (!tracker || !stats || !tracker->log) {
+        errno = EINVAL;
+        return -1;
+    }
+    struct SQLLog *log = tracker->log;
+    stats->records = atomic_load(&log->records);
+    stats->dropped = atomic_load(&log->dropped);
+    stats->blocks = atomic_load(&log->blocks);
+    stats->raw_bytes = atomic_load(&log->raw_bytes);
+    stats->written_bytes = atomic_load(&log->written_bytes);
+    stats->compress_ns = atomic_load(&log->compress_ns);
+    stats->loaded = log->loaded;
+    stats->error = atomic_load(&log->error);
+    return 0;
+}
+
+/**
+ * Convert a change log to JSON lines
+ */
+long sql_tracker_export_jsonl(const char *log_path, const char *jsonl_path) {
+    if (!log_path) {
+        errno = EINVAL;
+        return -1;
+    }
+    int fd = open(log_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    FILE *out = jsonl_path ? fopen(jsonl_path, "w") : stdout;
+    if (!out) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
     
-    for (int i = 0; i < tracker->change_count; i++) {
-        SQLChange *change = &tracker->changes[i];
-        int match = 1;
-        
-        if (table_filter && strcmp(change->table_name, table_filter) != 0) {
-            match = 0;
-        }
+    struct SQLLogExport ex = { out, NULL, 0, 0 };
+    off_t end = sql_log_read(fd, export_visit, &ex);
+    int saved = errno;
+    for (uint32_t i = 0; i < ex.num_names; i++) {
+        free(ex.names[i]);
+    }
+    free(ex.names);
+    close(fd);
+    if (fflush(out) != 0 && end >= 0) {
+        end = -1;
+        saved = errno;
+    }
+    if (jsonl_path) fclose(out);
+    
+    if (end < 0) {
+        errno = saved;
+        return -1;
+    }
+    return ex.lines;
+}
+
+/**
+ * Start a query over the retained changes
+ */
+int sql_tracker_query(SQLTracker *tracker, const SQLChangeQuery *query, SQLCursor *cursor) {
+    if (!tracker || !query || !cursor || query->operation < SQL_UNKNOWN || query->operation > SQL_SELECT) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    memset(cursor, 0, sizeof(SQLCursor));
+    cursor->tracker = tracker;
+    
+    // Filters compare interned IDs; a name never seen matches nothing
+    uint32_t table_id = query->table ? sql_tracker_name_id(tracker, query->table) : 0;
+    uint32_t column_id = query->column ? sql_tracker_name_id(tracker, query->column) : 0;
+    if ((query->table && !table_id) || (query->column && !column_id)) {
+        return 0;
+    }
+    cursor->table_id = table_id;
+    cursor->column_id = column_id;
+    cursor->operation = query->operation;
+    
+    // Walk the shortest posting list that covers a filter, else the ring
+    const struct SQLPostings *list = NULL;
+    if ((table_id || query->operation) && index_build(tracker) == 0) {
+        static const struct SQLPostings empty;
+        SQLChangeIndex *ix = &tracker->index;
         
-        if (column_filter && strcmp(change->column_name, column_filter) != 0) {
-            match = 0;
+        if (table_id) {
+            list = column_id ? index_pair(ix, table_id, column_id, 0) : index_table(ix, table_id, 0);
+            if (!list) list = &empty;
+            cursor->table_id = 0;
+            if (column_id) cursor->column_id = 0;
         }
-        
-        if (operation_filter) {
-            const char *op_str = NULL;
-            switch (change->operation) {
-                case SQL_INSERT:
-                    op_str = "INSERT";
-                    break;
-                case SQL_UPDATE:
-                    op_str = "UPDATE";
-                    break;
-                case SQL_DELETE:
-                    op_str = "DELETE";
-                    break;
-                case SQL_SELECT:
-                    op_str = "SELECT";
-                    break;
-                default:
-                    op_str = "UNKNOWN";
-                    break;
-            }
-            if (strcmp(op_str, operation_filter) != 0) {
-                match = 0;
+        const struct SQLPostings *by_op = &ix->by_operation[query->operation];
+        if (query->operation && (!list || by_op->end - by_op->start < list->end - list->start)) {
+            if (list) {
+                cursor->table_id = table_id;
+                cursor->column_id = column_id;
             }
+            list = by_op;
+            cursor->operation = SQL_UNKNOWN;
+        } else if (query->operation == SQL_UNKNOWN) {
+            cursor->operation = SQL_UNKNOWN;
         }
-        
-        if (match) {
-            (*out_changes)[count++] = *change;
+    }
+    
+    uint32_t lo = 0;
+    uint32_t hi = (uint32_t)tracker->change_count;
+    if (list) {
+        cursor->seqs = list->seqs;
+        lo = list->start;
+        hi = list->end;
+    }
+    if (query->until_ns) {
+        hi = sql_lower_bound(tracker, cursor->seqs, lo, hi, query->until_ns);
+    }
+    if (query->since_ns) {
+        lo = sql_lower_bound(tracker, cursor->seqs, lo, hi, query->since_ns);
+    }
+    cursor->pos = lo;
+    cursor->end = hi;
+    return 0;
+}
+
+/**
+ * Next change of a query
+ */
+int sql_cursor_next(SQLCursor *cursor, SQLChange *out) {
+    if (!cursor || !out || !cursor->tracker) return 0;
+    
+    const SQLTracker *tracker = cursor->tracker;
+    while (cursor->pos < cursor->end) {
+        uint32_t pos = cursor->pos++;
+        const SQLChangeRecord *rec = cursor->seqs ? sql_record_seq(tracker, cursor->seqs[pos])
+                                                  : sql_record(tracker, (int)pos);
+        if ((cursor->table_id && rec->stmt->table_id != cursor->table_id) ||
+            (cursor->column_id && rec->column_id != cursor->column_id) ||
+            (cursor->operation && rec->stmt->operation != (uint32_t)cursor->operation)) {
+            continue;
+        }
+        sql_view(tracker, rec, out);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Get changes by filter
+ */
+int sql_tracker_get_changes(SQLTracker *tracker, const char *table_filter,
+                            const char *column_filter, const char *operation_filter,
+                            SQLChange **out_changes) {
+    if (!tracker || !out_changes) return 0;
+    
+    SQLChangeQuery query = { table_filter, column_filter, SQL_UNKNOWN, 0, 0 };
+    SQLCursor cursor = { 0 };
+    if (operation_filter) {
+        for (int op = SQL_INSERT; op <= SQL_SELECT; op++) {
+            if (strcmp(sql_operation_to_string((SQLOperation)op), operation_filter) == 0) {
+                query.operation = (SQLOperation)op;
+            }
         }
     }
+    if ((!operation_filter || query.operation != SQL_UNKNOWN) &&
+        sql_tracker_query(tracker, &query, &cursor) < 0) {
+        return 0;
+    }
     
+    // The cursor's span bounds the matches
+    uint32_t span = cursor.end - cursor.pos;
+    *out_changes = (SQLChange *)malloc(sizeof(SQLChange) * (span ? span : 1));
+    if (!*out_changes) return 0;
+    
+    int count = 0;
+    while (sql_cursor_next(&cursor, &(*out_changes)[count])) {
+        count++;
+    }
     return count;
 }
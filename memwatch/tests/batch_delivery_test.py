@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+"""
+Batch Delivery Test - memwatch
+
+Changes delivered as EventBatch buffers instead of one dict per event.
+Verifies that:
+1. A burst of writes arrives in far fewer callbacks than events
+2. Records expose the documented layout through the buffer protocol
+3. Value bytes are zero-copy slices of batch.values and outlive the callback
+4. max_batch bounds the records per batch
+5. Clearing the batch callback restores per-event delivery
+"""
+
+import sys
+import os
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', 'python'))
+
+from memwatch import MemoryWatcher, ChangeEvent, BATCH_RECORD, decode_batch
+import time
+
+NUM_BUFFERS = 64
+
+def main():
+    print("=== memwatch Batch Delivery Test ===\n")
+
+    batches = []
+    events_received = []
+
+    def on_batch(batch):
+        batches.append(batch)  # keep it: values must stay valid
+
+    def on_change(event: ChangeEvent):
+        events_received.append(event)
+
+    watcher = MemoryWatcher()
+    watcher.set_callback(on_change)
+    try:
+        watcher.set_batch_callback(on_batch, max_batch=1024, max_latency_us=20000)
+    except RuntimeError:
+        print("Native backend unavailable - skipping\n")
+        return 0
+
+    # One page each, so every write is its own change
+    buffers = []
+    region_ids = {}
+    for i in range(NUM_BUFFERS):
+        buf = bytearray(4096)
+        region_ids[watcher.watch(buf, name=f"buf_{i}")] = i
+        buffers.append(buf)
+    time.sleep(0.2)  # Let worker settle
+
+    ok = True
+
+    # Test 1: Burst -> few batches
+    print(f"Test 1: {NUM_BUFFERS} writes in one burst")
+    for i, buf in enumerate(buffers):
+        buf[0] = i + 1
+    time.sleep(0.3)
+    records = sum(len(b) for b in batches)
+    print(f"✓ {records} records in {len(batches)} batches, {len(events_received)} dict events")
+    if records == NUM_BUFFERS and len(batches) < NUM_BUFFERS // 4 and not events_received:
+        print("✅ PASS: Burst delivered in batches\n")
+    else:
+        print("❌ FAIL: Unexpected delivery\n")
+        ok = False
+
+    # Test 2: Buffer layout
+    print("Test 2: Record layout")
+    view = memoryview(batches[0]) if batches else None
+    if view is not None and view.itemsize == BATCH_RECORD.size and view.readonly:
+        print(f"✓ format: {view.format[:40]}...")
+        print("✅ PASS: Records exported as read-only structured buffer\n")
+    else:
+        print("❌ FAIL: Unexpected buffer\n")
+        ok = False
+
+    # Test 3: Zero-copy values that outlive the callback
+    print("Test 3: Values from batch.values")
+    first = batches[:]
+    for i, buf in enumerate(buffers):  # more batches reuse pooled buffers
+        buf[1] = 0xEE
+    time.sleep(0.3)
+    good = 0
+    for batch in first:
+        values = batch.values
+        for record in BATCH_RECORD.iter_unpack(memoryview(batch).cast('B')):
+            seq, region_id, _, _, _, flags, how_big, off, length = record[:9]
+            value = values[off:off + length]
+            i = region_ids.get(region_id)
+            if i is not None and isinstance(value, memoryview) and value[0] == i + 1:
+                good += 1
+    print(f"✓ {good}/{NUM_BUFFERS} values intact after later batches")
+    if good == NUM_BUFFERS:
+        print("✅ PASS: Values are memoryviews that stay valid\n")
+    else:
+        print("❌ FAIL: Values missing or overwritten\n")
+        ok = False
+
+    # Test 4: max_batch
+    print("Test 4: max_batch=8")
+    batches.clear()
+    watcher.set_batch_callback(on_batch, max_batch=8, max_latency_us=20000)
+    for buf in buffers:
+        buf[2] = 0x42
+    time.sleep(0.3)
+    sizes = [len(b) for b in batches]
+    print(f"✓ batch sizes: {sizes}")
+    if sum(sizes) == NUM_BUFFERS and max(sizes, default=0) <= 8:
+        print("✅ PASS: Batches bounded\n")
+    else:
+        print("❌ FAIL: Batch bound not respected\n")
+        ok = False
+
+    decoded = [e for b in batches for e in decode_batch(b)]
+    if not all(e.new_value and e.new_value[2] == 0x42 for e in decoded):
+        print("❌ FAIL: decode_batch returned unexpected events\n")
+        ok = False
+
+    # Test 5: Back to per-event delivery
+    print("Test 5: Per-event delivery restored")
+    watcher.set_batch_callback(None)
+    batches.clear()
+    buffers[0][3] = 7
+    time.sleep(0.3)
+    if events_received and not batches:
+        print("✅ PASS: ChangeEvent delivered\n")
+    else:
+        print("❌ FAIL: Still batching\n")
+        ok = False
+
+    print("=== Final Statistics ===")
+    for key, value in watcher.get_stats().items():
+        print(f"{key}: {value}")
+
+    watcher.stop_all()
+
+    print("\n=== Test Summary ===")
+    print("✅ All batch delivery checks passed" if ok else "❌ Some checks failed")
+    return 0 if ok else 1
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,148 @@
+#!/usr/bin/env python3
+"""
+Block Diff Test - memwatch
+
+Large regions keep a block hash tree. Verifies that:
+1. A one-byte write to a large buffer reports only the block it touched
+2. The event carries only the changed bytes (delta), not the region prefix
+3. The worker rehashes a page's worth of blocks, not the whole region
+4. Writes on separate pages are reported as separate ranges
+5. Small regions still report new_value as before
+"""
+
+import sys
+import os
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', 'python'))
+
+from memwatch import MemoryWatcher, ChangeEvent
+import time
+
+LARGE_SIZE = 4 * 1024 * 1024   # block diff tier
+HUGE_SIZE = 16 * 1024 * 1024   # fingerprint tier
+
+def main():
+    print("=== memwatch Block Diff Test ===\n")
+
+    events_received = []
+
+    def on_change(event: ChangeEvent):
+        events_received.append(event)
+
+    watcher = MemoryWatcher()
+    watcher.set_callback(on_change)
+
+    large = bytearray(LARGE_SIZE)
+    large_id = watcher.watch(large, name="large", max_value_bytes=-1)
+    time.sleep(0.2)  # Let worker settle
+
+    ok = True
+    native = 'hashed_bytes' in watcher.get_stats()
+    if not native:
+        print("Native backend unavailable - block tracking not active, skipping\n")
+        watcher.stop_all()
+        return 0
+
+    # Test 1: One byte in the middle of a 4 MB buffer
+    print("Test 1: One-byte write to a 4 MB region")
+    offset = 1_000_003
+    before = watcher.get_stats()['hashed_bytes']
+    large[offset] = 0x5A
+    time.sleep(0.3)
+    hashed = watcher.get_stats()['hashed_bytes'] - before
+
+    events = [e for e in events_received if e.region_id == large_id]
+    if len(events) != 1 or not events[0].ranges:
+        print(f"❌ FAIL: Expected one event with ranges, got {len(events)}\n")
+        return 1
+
+    event = events[0]
+    print(f"✓ ranges: {event.ranges}")
+    print(f"✓ delta: {len(event.delta or b'')} bytes, fingerprint: {event.fingerprint:#x}")
+    print(f"✓ hashed: {hashed} bytes for a {LARGE_SIZE} byte region")
+
+    (start, length), = event.ranges
+    if start <= offset < start + length and length <= 4096:
+        print("✅ PASS: Range covers only the written block\n")
+    else:
+        print("❌ FAIL: Range does not match the write\n")
+        ok = False
+
+    # Test 2: Only changed bytes are shipped
+    print("Test 2: Delta holds the changed block")
+    if (event.new_value is None and event.delta is not None and
+            len(event.delta) == length and event.delta[offset - start] == 0x5A):
+        print("✅ PASS: Delta is the changed block only\n")
+    else:
+        print("❌ FAIL: Unexpected delta/new_value\n")
+        ok = False
+
+    # Test 3: Rehash cost bounded by the touched page
+    print("Test 3: Rehash cost")
+    if 0 < hashed < 64 * 1024:
+        print(f"✅ PASS: {LARGE_SIZE // hashed}x less hashing than a full rehash\n")
+    else:
+        print(f"❌ FAIL: Hashed {hashed} bytes\n")
+        ok = False
+
+    # Test 4: Writes on two distant pages
+    print("Test 4: Two writes, two pages")
+    events_received.clear()
+    large[10] = 1
+    large[LARGE_SIZE - 10] = 2
+    time.sleep(0.3)
+    ranges = sorted(r for e in events_received if e.region_id == large_id
+                    for r in (e.ranges or []))
+    print(f"✓ ranges: {ranges}")
+    if (len(ranges) == 2 and ranges[0][0] <= 10 < sum(ranges[0]) and
+            ranges[1][0] <= LARGE_SIZE - 10 < sum(ranges[1]) and
+            sum(ranges[1]) == LARGE_SIZE):
+        print("✅ PASS: Each write reported at its own offset\n")
+    else:
+        print("❌ FAIL: Unexpected ranges\n")
+        ok = False
+
+    # Test 5: Fingerprint tier uses page-sized blocks, delta capped by max_value_bytes
+    print("Test 5: 16 MB region, max_value_bytes=64")
+    huge = bytearray(HUGE_SIZE)
+    huge_id = watcher.watch(huge, name="huge", max_value_bytes=64)
+    time.sleep(0.2)
+    events_received.clear()
+    huge[HUGE_SIZE // 2 + 100] = 7
+    time.sleep(0.3)
+    events = [e for e in events_received if e.region_id == huge_id]
+    if (len(events) == 1 and events[0].ranges and events[0].ranges[0][1] <= 4096 and
+            len(events[0].delta) == 64):
+        print(f"✓ ranges: {events[0].ranges}")
+        print("✅ PASS: Page-sized block reported, delta capped\n")
+    else:
+        print("❌ FAIL: Unexpected fingerprint-tier event\n")
+        ok = False
+
+    # Test 6: Small regions are unchanged
+    print("Test 6: Small region keeps new_value")
+    small = bytearray(1024)
+    small_id = watcher.watch(small, name="small")
+    time.sleep(0.2)
+    events_received.clear()
+    small[0] = 9
+    time.sleep(0.3)
+    events = [e for e in events_received if e.region_id == small_id]
+    if len(events) == 1 and events[0].ranges is None and events[0].new_value[0] == 9:
+        print("✅ PASS: Whole-region event as before\n")
+    else:
+        print("❌ FAIL: Unexpected small-region event\n")
+        ok = False
+
+    # Statistics
+    print("=== Final Statistics ===")
+    for key, value in watcher.get_stats().items():
+        print(f"{key}: {value}")
+
+    watcher.stop_all()
+
+    print("\n=== Test Summary ===")
+    print("✅ All block diff checks passed" if ok else "❌ Some checks failed")
+    return 0 if ok else 1
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,328 @@
+#!/usr/bin/env python3
+"""
+Compression Test - memwatch
+
+memwatch_compress stores value snapshots LZ4 compressed against a
+dictionary of their group's recent bytes, and the SQL change log links
+each compressed block to the one before. Verifies that:
+1. LZ4 dictionary blocks round-trip (random data, dictionaries, sizes)
+2. Small similar snapshots compress far better with dictionaries than
+   with plain LZ4, per mode
+3. Incompressible data is stored raw and soon not even tried
+4. Values read back after reopening the store; dictionaries load on demand
+5. Linked change log blocks are smaller and replay the same changes
+6. The Python API stores and reads compressed values
+"""
+
+import sys
+import os
+import re
+import subprocess
+import tempfile
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+sys.path.insert(0, os.path.join(ROOT, 'python'))
+sys.path.insert(0, os.path.join(ROOT, 'bindings'))
+
+PROGRAM = r'''
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include "memwatch_lz4.h"
+#include "memwatch_compress.h"
+
+#define MB (1024 * 1024)
+#define GROUPS 8
+#define SNAPS 3000            /* over all groups */
+#define SNAP 512
+#define NOISE 200             /* random values in one more group */
+#define NOISE_SIZE 4096
+
+static uint64_t rng = 88172645463325252ULL;
+static uint64_t next(void) {
+    rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+    return rng;
+}
+
+static int fuzz(int cases) {
+    static uint8_t dict[MW_LZ4_DICT_MAX + 4096], src[70000], out[70000], packed[80000];
+    static mw_lz4_dict_t prepared;
+    int bad = 0;
+    for (int i = 0; i < cases; i++) {
+        size_t dict_len = next() % sizeof(dict), len = next() % sizeof(src);
+        int alphabet = 1 + (int)(next() % 255);
+        for (size_t j = 0; j < dict_len; j++) dict[j] = (uint8_t)(next() % alphabet);
+        for (size_t j = 0; j < len; j++) {
+            /* copies out of the dictionary, runs and noise */
+            if (dict_len > 64 && next() % 4 == 0) {
+                size_t take = 1 + next() % 64, from = next() % (dict_len - take);
+                if (take > len - j) take = len - j;
+                memcpy(src + j, dict + from, take);
+                j += take - 1;
+            } else {
+                src[j] = (uint8_t)(next() % alphabet);
+            }
+        }
+        mw_lz4_dict_load(&prepared, dict, dict_len);
+        size_t n = mw_lz4_compress_dict(&prepared, src, len, packed, sizeof(packed));
+        long back = n ? mw_lz4_decompress_dict(dict, dict_len, packed, n, out, sizeof(out)) : -1;
+        if (back != (long)len || memcmp(src, out, len) != 0) bad++;
+        /* truncated blocks and short outputs fail cleanly */
+        if (n > 1 && mw_lz4_decompress_dict(dict, dict_len, packed, n - 1, out, sizeof(out)) == (long)len &&
+            memcmp(src, out, len) == 0 && len > 0) bad++;
+        if (len > 1 && n && mw_lz4_decompress_dict(dict, dict_len, packed, n, out, len - 1) != -1) bad++;
+    }
+    printf("cases=%d bad=%d\n", cases, bad);
+    return 0;
+}
+
+/* 32 records of an id, a counter, a name and a reading; a counter ticks
+ * every 32 snapshots, a reading every 7 to 38 */
+static void snapshot(uint32_t group, uint32_t step, uint8_t *out) {
+    for (uint32_t r = 0; r < SNAP / 16; r++) {
+        uint32_t id = group * 1000 + r, count = (step + r * 7) / 32;
+        uint32_t reading = (r * 2654435761u + group) ^ (step / (7 + r));
+        memcpy(out + r * 16, &id, 4);
+        memcpy(out + r * 16 + 4, &count, 4);
+        memcpy(out + r * 16 + 8, "sensor", 6);
+        out[r * 16 + 14] = (uint8_t)('a' + (r + group) % 26);
+        out[r * 16 + 15] = (uint8_t)(r % 3);
+        if (r % 4 == 0) memcpy(out + r * 16 + 8, &reading, 4);
+    }
+}
+
+static int store(const char *path, int mode) {
+    static uint8_t snaps[SNAPS][SNAP], noise[NOISE][NOISE_SIZE], out[NOISE_SIZE];
+    FastStorage *fs = faststorage_create(path, 64 * MB);
+    mw_zstore_t *z = mw_zstore_open(fs, (mw_compress_mode_t)mode);
+    if (!fs || !z) return 1;
+    char key[64];
+    for (uint32_t i = 0; i < SNAPS; i++) {
+        snapshot(i % GROUPS, i / GROUPS, snaps[i]);
+        snprintf(key, sizeof(key), "snap.%u", i);
+        if (mw_zstore_put(z, key, i % GROUPS, snaps[i], SNAP) != 0) return 2;
+    }
+    mw_compress_stats_t s;
+    mw_zstore_stats(z, &s);
+    printf("ratio=%llu nsper=%llu dicts=%llu withdict=%llu compressed=%llu\n",
+           (unsigned long long)(s.stored_bytes * 1000 / s.raw_bytes),
+           (unsigned long long)(s.compress_ns / s.values), (unsigned long long)s.dicts,
+           (unsigned long long)s.with_dict, (unsigned long long)s.compressed);
+
+    mw_compress_stats_t before = s;
+    for (uint32_t i = 0; i < NOISE; i++) {
+        for (size_t j = 0; j < NOISE_SIZE; j += 8) {
+            uint64_t r = next();
+            memcpy(noise[i] + j, &r, 8);
+        }
+        snprintf(key, sizeof(key), "noise.%u", i);
+        if (mw_zstore_put(z, key, 99, noise[i], NOISE_SIZE) != 0) return 3;
+    }
+    mw_zstore_stats(z, &s);
+    printf("tried=%llu skipped=%llu noisecompressed=%llu noiseoverhead=%llu noisens=%llu\n",
+           (unsigned long long)(s.incompressible - before.incompressible),
+           (unsigned long long)(s.skipped - before.skipped),
+           (unsigned long long)(s.compressed - before.compressed),
+           (unsigned long long)((s.stored_bytes - before.stored_bytes) - NOISE * NOISE_SIZE),
+           (unsigned long long)((s.compress_ns - before.compress_ns) / NOISE));
+    mw_zstore_close(z);
+    faststorage_destroy(fs);
+
+    /* Reopen in another mode: reading never depends on it */
+    fs = faststorage_create(path, 64 * MB);
+    z = mw_zstore_open(fs, MW_COMPRESS_OFF);
+    if (!fs || !z) return 4;
+    int bad = 0;
+    size_t len;
+    for (uint32_t i = 0; i < SNAPS; i++) {
+        snprintf(key, sizeof(key), "snap.%u", i);
+        if (mw_zstore_size(z, key) != SNAP) bad++;
+        if (mw_zstore_get(z, key, out, sizeof(out), &len) != 0 || len != SNAP ||
+            memcmp(out, snaps[i], SNAP) != 0) bad++;
+    }
+    for (uint32_t i = 0; i < NOISE; i++) {
+        snprintf(key, sizeof(key), "noise.%u", i);
+        if (mw_zstore_get(z, key, out, sizeof(out), &len) != 0 || len != NOISE_SIZE ||
+            memcmp(out, noise[i], NOISE_SIZE) != 0) bad++;
+    }
+    mw_zstore_stats(z, &s);
+    int missing = mw_zstore_get(z, "snap.none", out, sizeof(out), &len) == -1 && errno == ENOENT;
+    len = 0;
+    int small = mw_zstore_get(z, "snap.5", out, 100, &len) == -1 && errno == ENOBUFS && len == SNAP;
+    faststorage_write(fs, "plain", "not compressed", 14);
+    int foreign = mw_zstore_get(z, "plain", out, sizeof(out), &len) == -1 && errno == EBADMSG;
+    printf("bad=%d reads=%llu missing=%d small=%d foreign=%d\n", bad,
+           (unsigned long long)s.reads, missing, small, foreign);
+    mw_zstore_close(z);
+    faststorage_destroy(fs);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (strcmp(argv[1], "fuzz") == 0) return fuzz(atoi(argv[2]));
+    return store(argv[2], atoi(argv[3]));
+}
+'''
+
+MODES = [('off', 0), ('balanced', 1), ('lite', 2), ('deep', 3)]
+
+def values(stdout):
+    out = {}
+    for line in stdout.splitlines():
+        for key, value in re.findall(r'([a-z]+)=(-?\d+)', line):
+            out.setdefault(key, int(value))
+    return out
+
+def log_run(path, mode, rows):
+    """Track rows UPDATEs, flushing often so the log holds many small blocks"""
+    from sql_tracker_python import SQLTracker
+    tracker = SQLTracker(path, compress_log=mode)
+    for i in range(rows):
+        tracker.track_query(f"UPDATE accounts SET balance = {i * 7}, status = 'active' WHERE id = {i % 50}",
+                            1, "bank", f"{(i - 1) * 7}", f"{i * 7}")
+        if i % 20 == 19:
+            tracker.flush()
+    tracker.flush()
+    stats = tracker.log_stats()
+    del tracker
+    reloaded = SQLTracker(path)
+    changes = [(c.table_name, c.column_name, c.old_value, c.new_value) for c in reloaded.get_changes()]
+    return stats, changes
+
+def main():
+    print("=== memwatch Compression Test ===\n")
+
+    ok = True
+    with tempfile.TemporaryDirectory() as tmp:
+        source = os.path.join(tmp, 'compress_prog.c')
+        binary = os.path.join(tmp, 'compress_prog')
+        with open(source, 'w') as f:
+            f.write(PROGRAM)
+        build = subprocess.run(['gcc', '-O2', '-I', os.path.join(ROOT, 'include'), source,
+                                os.path.join(ROOT, 'src/memwatch_compress.c'),
+                                os.path.join(ROOT, 'src/memwatch_lz4.c'),
+                                os.path.join(ROOT, 'src/faststorage_fast.c'),
+                                os.path.join(ROOT, 'src/memwatch_hash.c'), '-o', binary,
+                                '-lpthread'], capture_output=True, text=True)
+        if build.returncode != 0:
+            print("compression program did not build - skipping\n")
+            print(build.stderr[-500:])
+            return 0
+
+        # Test 1: dictionary block round trip
+        print("Test 1: LZ4 dictionary round trip")
+        v = values(subprocess.run([binary, 'fuzz', '2000'], capture_output=True, text=True, timeout=300).stdout)
+        print(f"✓ {v.get('cases')} random blocks and dictionaries, {v.get('bad')} bad round trips")
+        if v.get('cases') == 2000 and v.get('bad') == 0:
+            print("✅ PASS: Dictionary blocks decode exactly\n")
+        else:
+            print("❌ FAIL: Dictionary round trip broken\n")
+            ok = False
+
+        runs = {}
+        for name, mode in MODES:
+            run = subprocess.run([binary, 'store', os.path.join(tmp, f'{name}.fs'), str(mode)],
+                                 capture_output=True, text=True, timeout=300)
+            runs[name] = values(run.stdout)
+            if run.returncode != 0:
+                print(f"{name} run failed ({run.returncode}): {run.stderr[-300:]}")
+
+        # Test 2: ratio per mode
+        print("Test 2: Snapshot ratio per mode")
+        for name, _ in MODES:
+            r = runs[name]
+            print(f"✓ {name:8}: stored/raw {r.get('ratio', 0) / 1000:.3f}, {r.get('nsper')} ns per value, "
+                  f"{r.get('dicts')} dictionaries, {r.get('withdict')} values against one")
+        off, plain, lite, deep = (runs[m].get('ratio', 10 ** 6) for m in ('off', 'balanced', 'lite', 'deep'))
+        if off > 1000 and plain < off and lite * 2 < plain and deep * 2 < plain and \
+                runs['lite'].get('dicts', 0) >= 8 and runs['deep'].get('dicts', 0) > runs['lite'].get('dicts', 0) and \
+                runs['balanced'].get('dicts') == 0:
+            print("✅ PASS: Dictionaries more than halve what plain LZ4 stores\n")
+        else:
+            print("❌ FAIL: Dictionary modes do not pay off\n")
+            ok = False
+
+        # Test 3: incompressible fast path
+        print("Test 3: Incompressible values")
+        for name in ('balanced', 'deep'):
+            r = runs[name]
+            print(f"✓ {name:8}: of 200 random 4 KB values, {r.get('tried')} tried, {r.get('skipped')} skipped, "
+                  f"{r.get('noisecompressed')} compressed, {r.get('noiseoverhead')} header bytes, "
+                  f"{r.get('noisens')} ns each")
+        if all(runs[m].get('noisecompressed') == 0 and
+               0 < runs[m].get('tried', 0) < 40 and runs[m].get('skipped', 0) > 150 and
+               runs[m].get('noiseoverhead') == 200 * 16 for m in ('balanced', 'deep')):
+            print("✅ PASS: Random data stored raw, mostly untried\n")
+        else:
+            print("❌ FAIL: Incompressible data handled badly\n")
+            ok = False
+
+        # Test 4: reopen and read back
+        print("Test 4: Read back after reopening")
+        for name, _ in MODES:
+            r = runs[name]
+            print(f"✓ {name:8}: {r.get('reads')} reads, {r.get('bad')} bad; "
+                  f"missing={r.get('missing')} short buffer={r.get('small')} foreign value={r.get('foreign')}")
+        if all(runs[m].get('bad') == 0 and runs[m].get('reads', 0) >= 3200 and
+               runs[m].get('missing') == runs[m].get('small') == runs[m].get('foreign') == 1
+               for m, _ in MODES):
+            print("✅ PASS: Every value reads back in any mode\n")
+        else:
+            print("❌ FAIL: Values lost on reopen\n")
+            ok = False
+
+        # Test 5: linked change log blocks
+        print("Test 5: Linked change log blocks")
+        plain_stats, plain_changes = log_run(os.path.join(tmp, 'plain.log'), 'balanced', 2000)
+        linked_stats, linked_changes = log_run(os.path.join(tmp, 'linked.log'), 'lite', 2000)
+        print(f"✓ plain : {plain_stats['blocks']} blocks, {plain_stats['written_bytes']} of "
+              f"{plain_stats['raw_bytes']} bytes")
+        print(f"✓ linked: {linked_stats['blocks']} blocks, {linked_stats['written_bytes']} of "
+              f"{linked_stats['raw_bytes']} bytes, {linked_stats['compress_ns'] // 1000} us compressing")
+        if linked_stats['written_bytes'] * 10 < plain_stats['written_bytes'] * 9 and \
+                len(linked_changes) == len(plain_changes) == 4000 and \
+                [c for c in linked_changes] == [c for c in plain_changes] and linked_stats['compress_ns'] > 0:
+            print("✅ PASS: Linked blocks are smaller and replay the same changes\n")
+        else:
+            print("❌ FAIL: Linked change log wrong\n")
+            ok = False
+
+        # Test 6: Python API
+        print("Test 6: Python API")
+        from memwatch.faststorage import FastStorage
+        from memwatch.compress import CompressedStore
+        path = os.path.join(tmp, 'python.fs')
+        with FastStorage(path, 16 << 20) as store:
+            with CompressedStore(store, 'lite') as values_:
+                for i in range(200):
+                    values_.put(f"region.{i % 4}.{i}", i % 4, b"state:" + bytes([i % 4]) * 200 + str(i).encode())
+                stats = values_.stats
+        with FastStorage(path, 16 << 20) as store:
+            with CompressedStore(store) as values_:
+                ok_reads = all(values_.get(f"region.{i % 4}.{i}") ==
+                               b"state:" + bytes([i % 4]) * 200 + str(i).encode() for i in range(200))
+                size, missing = values_.size("region.1.1"), values_.get("region.9.9")
+        try:
+            CompressedStore(None, 'ultra')
+            refused = False
+        except ValueError:
+            refused = True
+        print(f"✓ stored/raw {stats['stored_bytes'] / stats['raw_bytes']:.3f} with {stats['dicts']} dictionaries, "
+              f"read back={ok_reads}, size={size}, missing={missing}, unknown mode refused={refused}")
+        if ok_reads and size == 207 and missing is None and refused and stats['with_dict'] > 0:
+            print("✅ PASS: CompressedStore works\n")
+        else:
+            print("❌ FAIL: Python API results wrong\n")
+            ok = False
+
+    print("=== Test Summary ===")
+    if ok:
+        print("✅ All compression checks passed")
+        return 0
+    print("❌ Some compression checks failed")
+    return 1
+
+if __name__ == '__main__':
+    sys.exit(main())
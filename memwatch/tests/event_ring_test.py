@@ -0,0 +1,299 @@
+#!/usr/bin/env python3
+"""
+Event Ring Test - memwatch
+
+`memwatch run --shm-ring <name>` publishes 64-byte packed events to a
+shared-memory ring with an eventfd doorbell, and `--user-lib foo.so` calls
+a plugin in process. Verifies that:
+1. A Python consumer maps the ring and reads every event in order
+2. A C consumer in another process wakes within microseconds
+3. A full ring drops and counts events instead of blocking
+4. Closing ends the stream; a second producer cannot take the name
+5. The CLI loads --user-lib plugins and serves --shm-ring while tracking
+"""
+
+import sys
+import os
+import re
+import statistics
+import subprocess
+import tempfile
+import time
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+sys.path.insert(0, os.path.join(ROOT, 'bindings'))
+
+from memwatch_ring import EventRing
+
+PROGRAM = r'''
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include "memwatch_event_ring.h"
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void wait_go(void) {
+    char line[16];
+    printf("ready\n");
+    fflush(stdout);
+    if (!fgets(line, sizeof(line), stdin)) exit(3);
+}
+
+int main(int argc, char **argv) {
+    const char *mode = argv[1];
+    const char *name = argv[2];
+    mw_ring_t ring;
+
+    if (strcmp(mode, "produce") == 0 || strcmp(mode, "ping") == 0 || strcmp(mode, "full") == 0) {
+        int count = atoi(argv[3]);
+        if (mw_ring_create(&ring, name, strcmp(mode, "full") == 0 ? 64 : 1 << 17) != 0) return 1;
+        mw_ring_t again;
+        int second = mw_ring_create(&again, name, 0);
+        printf("second=%d errno=%d\n", second, errno);
+        wait_go();
+        int failed = 0;
+        for (int i = 0; i < count; i++) {
+            event_packed_t e = {0};
+            e.timestamp_sec = (uint32_t)i;
+            e.var_id = (uint16_t)i;
+            e.thread_id = 7;
+            if (strcmp(mode, "ping") == 0) {
+                usleep(2000);
+                uint64_t t = now_ns();
+                e.old_value = (int32_t)(uint32_t)t;
+                e.new_value = (int32_t)(uint32_t)(t >> 32);
+            } else {
+                e.old_value = i;
+                e.new_value = -i;
+            }
+            snprintf(e.metadata, sizeof(e.metadata), "var_%d", i);
+            e.metadata_len = (uint16_t)strlen(e.metadata);
+            if (mw_ring_publish(&ring, &e) != 0) failed++;
+        }
+        printf("failed=%d\ndropped=%llu\n", failed, (unsigned long long)ring.hdr->dropped);
+        fflush(stdout);
+        if (strcmp(mode, "full") == 0) wait_go();
+        mw_ring_destroy(&ring);
+    } else if (strcmp(mode, "consume") == 0) {
+        if (mw_ring_attach(&ring, name) != 0) return 1;
+        event_packed_t events[64];
+        uint64_t latencies[4096];
+        int n = 0, total = 0;
+        for (;;) {
+            int got = mw_ring_consume(&ring, events, 64, 5000);
+            uint64_t now = now_ns();
+            if (got < 0) break;
+            for (int i = 0; i < got; i++) {
+                uint64_t sent = (uint64_t)(uint32_t)events[i].old_value |
+                                ((uint64_t)(uint32_t)events[i].new_value << 32);
+                if (n < 4096) latencies[n++] = now - sent;
+            }
+            total += got;
+        }
+        printf("consumed=%d errno=%d\n", total, errno);
+        for (int i = 0; i < n; i++) printf("lat=%llu\n", (unsigned long long)latencies[i]);
+        mw_ring_detach(&ring);
+    }
+    return 0;
+}
+'''
+
+PLUGIN = r'''
+#include <stdio.h>
+#include "memwatch_unified.h"
+
+void *memwatch_plugin_init(void) {
+    printf("plugin_init\n");
+    fflush(stdout);
+    return (void *)0x1234;
+}
+
+#ifndef NO_CALLBACK
+void memwatch_callback(const memwatch_change_event_t *event, void *ctx) {
+    (void)event; (void)ctx;
+}
+#endif
+
+void memwatch_plugin_fini(void *ctx) {
+    printf("plugin_fini ctx=%p\n", ctx);
+    fflush(stdout);
+}
+'''
+
+CLI_SOURCES = ['src/memwatch_cli.c', 'src/memwatch_core_minimal.c', 'src/memwatch_backend.c',
+               'src/memwatch_sqlite_sink.c', 'src/memwatch_event_ring.c', 'src/memwatch_trace.c',
+               'src/memwatch_stats.c', 'src/faststorage_fast.c', 'src/memwatch_hash.c',
+               'src/memwatch_export.c', 'src/memwatch_lz4.c']
+
+def values(stdout):
+    out = {}
+    for line in stdout.splitlines():
+        for key, value in re.findall(r'([a-z]+)=(-?\d+)', line):
+            out.setdefault(key, int(value))
+    return out
+
+def main():
+    print("=== memwatch Event Ring Test ===\n")
+
+    ok = True
+    tag = f"test{os.getpid()}"
+    with tempfile.TemporaryDirectory() as tmp:
+        source = os.path.join(tmp, 'ring_prog.c')
+        binary = os.path.join(tmp, 'ring_prog')
+        with open(source, 'w') as f:
+            f.write(PROGRAM)
+        build = subprocess.run(['gcc', '-O2', '-I', os.path.join(ROOT, 'include'), source,
+                                os.path.join(ROOT, 'src/memwatch_event_ring.c'), '-o', binary,
+                                '-lpthread', '-lrt'], capture_output=True, text=True)
+        if build.returncode != 0:
+            print("ring program did not build - skipping\n")
+            print(build.stderr[-500:])
+            return 0
+
+        def producer(mode, name, count):
+            proc = subprocess.Popen([binary, mode, name, str(count)], stdin=subprocess.PIPE,
+                                    stdout=subprocess.PIPE, text=True)
+            first = proc.stdout.readline()
+            ready = proc.stdout.readline()
+            return proc, first, ready.strip() == 'ready'
+
+        # Test 1: Python consumer
+        print("Test 1: Python consumer, 100000 events")
+        proc, first, ready = producer('produce', tag + 'a', 100000)
+        events = []
+        if ready:
+            with EventRing(tag + 'a') as ring:
+                proc.stdin.write('go\n')
+                proc.stdin.flush()
+                for event in ring:
+                    events.append(event)
+        rest = proc.communicate(timeout=60)[0]
+        v = values(first + rest)
+        in_order = all(e.timestamp == i and e.old_value == i and e.new_value == -i and
+                       e.variable == f"var_{i}" and e.var_id == i & 0xffff for i, e in enumerate(events))
+        print(f"✓ {len(events)} events read, in order: {in_order}, producer failed={v.get('failed')}")
+        if len(events) == 100000 and in_order and v.get('failed') == 0:
+            print("✅ PASS: Events read straight from the mapping\n")
+        else:
+            print("❌ FAIL: Events lost or garbled\n")
+            ok = False
+
+        # Test 2: C consumer wake-up latency
+        print("Test 2: Wake-up latency (C consumer, one event every 2 ms)")
+        proc, first, ready = producer('ping', tag + 'b', 500)
+        consumer = subprocess.Popen([binary, 'consume', tag + 'b'], stdout=subprocess.PIPE, text=True)
+        time.sleep(0.2)
+        proc.stdin.write('go\n')
+        proc.stdin.flush()
+        proc.communicate(timeout=60)
+        out = consumer.communicate(timeout=60)[0]
+        lat = [int(x) / 1000 for x in re.findall(r'lat=(\d+)', out)]
+        cv = values(out)
+        median = statistics.median(lat) if lat else float('inf')
+        p99 = sorted(lat)[int(len(lat) * 0.99)] if lat else float('inf')
+        print(f"✓ {cv.get('consumed')} events, median {median:.1f} us, p99 {p99:.1f} us, "
+              f"end errno={cv.get('errno')}")
+        if cv.get('consumed') == 500 and cv.get('errno') == 32 and median < 1000:
+            print("✅ PASS: Doorbell wakes the consumer\n")
+        else:
+            print("❌ FAIL: Consumer missed events or woke slowly\n")
+            ok = False
+
+        # Test 3: Full ring
+        print("Test 3: 100 events into 64 slots, nobody reading")
+        proc, first, ready = producer('full', tag + 'c', 100)
+        proc.stdin.write('go\n')
+        proc.stdin.flush()
+        line = proc.stdout.readline() + proc.stdout.readline()
+        with EventRing(tag + 'c') as ring:
+            dropped = ring.dropped
+            proc.stdin.write('go\n')
+            proc.stdin.flush()
+            got = [e.var_id for e in ring]
+        proc.communicate(timeout=60)
+        v = values(line)
+        print(f"✓ failed={v.get('failed')}, header dropped={dropped}, {len(got)} kept")
+        if v.get('failed') == 36 and dropped == 36 and got == list(range(64)):
+            print("✅ PASS: Oldest events kept, overflow counted\n")
+        else:
+            print("❌ FAIL: Overflow handling wrong\n")
+            ok = False
+
+        # Test 4: Close and exclusive names
+        print("Test 4: End of stream and name ownership")
+        v = values(first)
+        gone = not os.path.exists(f"/dev/shm/memwatch-{tag}a")
+        print(f"✓ second producer -> {v.get('second')} (errno {v.get('errno')}), ring unlinked: {gone}")
+        if v.get('second') == -1 and v.get('errno') == 17 and gone:
+            print("✅ PASS: One producer per name, ring removed on close\n")
+        else:
+            print("❌ FAIL: Name or cleanup handling wrong\n")
+            ok = False
+
+        # Test 5: CLI
+        print("Test 5: memwatch run --user-lib / --shm-ring")
+        cli = os.path.join(tmp, 'memwatch_cli')
+        plugin_src = os.path.join(tmp, 'plugin.c')
+        plugin = os.path.join(tmp, 'plugin.so')
+        no_callback = os.path.join(tmp, 'no_callback.so')
+        with open(plugin_src, 'w') as f:
+            f.write(PLUGIN)
+        build = subprocess.run(['gcc', '-O2', '-I', os.path.join(ROOT, 'include')] +
+                               [os.path.join(ROOT, s) for s in CLI_SOURCES] +
+                               ['-o', cli, '-lsqlite3', '-lpthread', '-ldl', '-lrt'],
+                               capture_output=True, text=True)
+        build_plugin = subprocess.run(['gcc', '-shared', '-fPIC', '-I', os.path.join(ROOT, 'include'),
+                                       plugin_src, '-o', plugin], capture_output=True, text=True)
+        subprocess.run(['gcc', '-shared', '-fPIC', '-DNO_CALLBACK', '-I', os.path.join(ROOT, 'include'),
+                        plugin_src, '-o', no_callback], capture_output=True, text=True)
+        if build.returncode != 0 or build_plugin.returncode != 0:
+            print("❌ FAIL: CLI or plugin did not build\n")
+            print((build.stderr + build_plugin.stderr)[-800:])
+            ok = False
+        else:
+            run = subprocess.run([cli, 'run', 'true', '--user-lib', plugin], capture_output=True,
+                                 text=True, timeout=60)
+            loaded = 'plugin_init' in run.stdout and 'plugin_fini ctx=0x1234' in run.stdout
+            bad = subprocess.run([cli, 'run', 'true', '--user-lib', no_callback], capture_output=True,
+                                 text=True, timeout=60)
+            rejected = bad.returncode != 0 and 'memwatch_callback' in bad.stderr
+
+            proc = subprocess.Popen([cli, 'run', 'sleep', '1', '--shm-ring', tag + 'd'],
+                                    stdout=subprocess.PIPE, stderr=subprocess.DEVNULL, text=True)
+            attached = ended = False
+            path = f"/dev/shm/memwatch-{tag}d"
+            for _ in range(100):
+                if os.path.exists(path):
+                    break
+                time.sleep(0.01)
+            try:
+                with EventRing(tag + 'd') as ring:
+                    attached = ring.producer_pid == proc.pid
+                    ended = ring.read(timeout=10) is None
+            except OSError as e:
+                print(f"  attach failed: {e}")
+            proc.communicate(timeout=60)
+            print(f"✓ plugin init/fini: {loaded}, missing callback rejected: {rejected}, "
+                  f"ring attached: {attached}, stream ended: {ended}")
+            if loaded and rejected and attached and ended:
+                print("✅ PASS: CLI delivery modes work\n")
+            else:
+                print("❌ FAIL: CLI delivery modes broken\n")
+                print(run.stdout[-500:], bad.stderr[-300:])
+                ok = False
+
+    print("=== Test Summary ===")
+    print("✅ All event ring checks passed" if ok else "❌ Some checks failed")
+    return 0 if ok else 1
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,384 @@
+#!/usr/bin/env python3
+"""
+Export Test - memwatch
+
+memwatch_export streams batched, LZ4-compressed event frames to
+memwatch_collector, which stores them in a sharded FastStorage store and
+acknowledges each. Verifies that:
+1. Events arrive intact over a unix socket, compressed
+2. With the collector down, frames spill to disk and are all delivered,
+   exactly once, once it comes up
+3. A spill file left by a closed exporter is sent first by the next one,
+   under the same source id
+4. Killing the collector (SIGKILL) mid-stream and restarting it loses and
+   duplicates nothing
+5. Eight sources stream over TCP at once into a 4-shard store
+6. Without a spill file a downed collector costs drops, counted, never a
+   blocked producer; `memwatch run --export` reports its stats
+"""
+
+import sys
+import os
+import json
+import re
+import signal
+import socket
+import subprocess
+import tempfile
+import time
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+COLLECTOR = os.path.join(ROOT, 'build', 'memwatch_collector')
+
+PROGRAM = r'''
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include "memwatch_export.h"
+
+#define BASE_NS 1000000000000ULL
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* export_prog <endpoint> <first> <count> <flush_ms> <max_queued> <spill|-> */
+int main(int argc, char **argv) {
+    if (argc != 7) return 2;
+    uint64_t first = strtoull(argv[2], NULL, 10);
+    uint64_t count = strtoull(argv[3], NULL, 10);
+    int flush_ms = atoi(argv[4]);
+    int pace_us = getenv("EXPORT_PACE_US") ? atoi(getenv("EXPORT_PACE_US")) : 0;
+    mw_export_config_t config = {
+        .endpoint = argv[1],
+        .max_queued_bytes = strtoull(argv[5], NULL, 10),
+        .spill_path = strcmp(argv[6], "-") ? argv[6] : NULL,
+        .close_timeout_ms = flush_ms > 0 ? (uint32_t)flush_ms : 1,
+    };
+    mw_exporter_t *x = mw_export_open(&config);
+    if (!x) {
+        printf("open failed errno=%d\n", errno);
+        return 1;
+    }
+
+    uint64_t start = now_ns();
+    for (uint64_t i = first; i < first + count; i++) {
+        char name[16];
+        uint64_t old_value = i - 1, new_value = i;
+        int len = snprintf(name, sizeof(name), "var%u", (unsigned)(i % 16));
+        mw_export_event_t ev = {
+            .timestamp_ns = BASE_NS + i * 1000,
+            .region_id = (uint32_t)(i % 16),
+            .thread_id = (uint32_t)(i % 4),
+            .name = name, .name_len = (uint32_t)len,
+            .old_value = &old_value, .old_len = 8,
+            .new_value = &new_value, .new_len = 8,
+        };
+        if (mw_export_event(x, &ev) != 0) {
+            printf("event failed errno=%d\n", errno);
+            return 1;
+        }
+        if (pace_us && i % 1000 == 0) usleep(pace_us);
+    }
+    uint64_t produced = now_ns() - start;
+
+    int rc = mw_export_flush(x, flush_ms);
+    int err = rc ? errno : 0;
+    mw_export_stats_t s;
+    mw_export_stats(x, &s);
+    mw_export_close(x);
+
+    printf("events=%llu frames=%llu raw=%llu stored=%llu acked=%llu sent=%llu\n",
+           (unsigned long long)s.events, (unsigned long long)s.frames,
+           (unsigned long long)s.raw_bytes, (unsigned long long)s.stored_bytes,
+           (unsigned long long)s.frames_acked, (unsigned long long)s.frames_sent);
+    printf("spilled=%llu dropped=%llu dropevents=%llu connects=%llu\n",
+           (unsigned long long)s.frames_spilled, (unsigned long long)s.frames_dropped,
+           (unsigned long long)s.events_dropped, (unsigned long long)s.connects);
+    printf("flush=%d err=%d produceus=%llu\n", rc, err, (unsigned long long)(produced / 1000));
+    return 0;
+}
+'''
+
+CLI_SOURCES = ['src/memwatch_cli.c', 'src/memwatch_core_minimal.c', 'src/memwatch_backend.c',
+               'src/memwatch_sqlite_sink.c', 'src/memwatch_event_ring.c', 'src/memwatch_trace.c',
+               'src/memwatch_stats.c', 'src/faststorage_fast.c', 'src/memwatch_hash.c',
+               'src/memwatch_export.c', 'src/memwatch_lz4.c']
+
+BASE_NS = 1000000000000
+
+
+def values(stdout):
+    out = {}
+    for line in stdout.splitlines():
+        for key, value in re.findall(r'([a-z]+)=(-?\d+)', line):
+            out.setdefault(key, int(value))
+    return out
+
+
+def start_collector(store, endpoints, shards=4):
+    args = [COLLECTOR, '--store', store, '--shards', str(shards)]
+    for endpoint in endpoints:
+        args += ['--listen', endpoint]
+    proc = subprocess.Popen(args, stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True)
+    for endpoint in endpoints:
+        deadline = time.time() + 10
+        while time.time() < deadline:
+            try:
+                if endpoint.startswith('unix:'):
+                    s = socket.socket(socket.AF_UNIX)
+                    s.connect(endpoint[5:])
+                else:
+                    host, port = endpoint[4:].rsplit(':', 1)
+                    s = socket.create_connection((host or '127.0.0.1', int(port)))
+                s.close()
+                break
+            except OSError:
+                time.sleep(0.02)
+    return proc
+
+
+def stop_collector(proc):
+    proc.send_signal(signal.SIGINT)
+    _, err = proc.communicate(timeout=30)
+    return err
+
+
+def dump(store, shards=4):
+    result = subprocess.run([COLLECTOR, '--dump', '--store', store, '--shards', str(shards),
+                             '--format', 'json'], capture_output=True, text=True, timeout=300)
+    sources = {}
+    for line in result.stdout.splitlines():
+        ev = json.loads(line)
+        sources.setdefault(ev['source'], []).append(ev)
+    return sources, result.returncode
+
+
+def check_events(events, first, count):
+    """Every event of first..first+count exactly once, in order, intact"""
+    if len(events) != count:
+        return False
+    for n, ev in enumerate(events):
+        i = first + n
+        if ev['timestamp_ns'] != BASE_NS + i * 1000 or ev['region_id'] != i % 16 or \
+                ev['thread_id'] != i % 4 or ev['name'] != f'var{i % 16}' or \
+                ev['new'] != i.to_bytes(8, 'little').hex() or \
+                ev['old'] != ((i - 1) % (1 << 64)).to_bytes(8, 'little').hex():
+            return False
+    return True
+
+
+def free_port():
+    s = socket.socket()
+    s.bind(('127.0.0.1', 0))
+    port = s.getsockname()[1]
+    s.close()
+    return port
+
+
+def main():
+    print("=== memwatch Export Test ===\n")
+
+    if not os.path.exists(COLLECTOR):
+        print("build/memwatch_collector missing (make build-collector) - skipping\n")
+        return 0
+
+    ok = True
+    with tempfile.TemporaryDirectory() as tmp:
+        source = os.path.join(tmp, 'export_prog.c')
+        prog = os.path.join(tmp, 'export_prog')
+        with open(source, 'w') as f:
+            f.write(PROGRAM)
+        build = subprocess.run(['gcc', '-O2', '-I', os.path.join(ROOT, 'include'), source,
+                                os.path.join(ROOT, 'src/memwatch_export.c'),
+                                os.path.join(ROOT, 'src/memwatch_lz4.c'),
+                                os.path.join(ROOT, 'src/memwatch_hash.c'), '-o', prog,
+                                '-lpthread'], capture_output=True, text=True)
+        if build.returncode != 0:
+            print("export program did not build - skipping\n")
+            print(build.stderr[-500:])
+            return 0
+
+        def export(endpoint, first, count, flush_ms=30000, max_queued=0, spill='-', pace_us=0):
+            return subprocess.Popen([prog, endpoint, str(first), str(count), str(flush_ms),
+                                     str(max_queued), spill], stdout=subprocess.PIPE, text=True,
+                                    env=dict(os.environ, EXPORT_PACE_US=str(pace_us)))
+
+        # Test 1: end to end over a unix socket
+        print("Test 1: Unix socket round trip")
+        store = os.path.join(tmp, 's1.store')
+        endpoint = 'unix:' + os.path.join(tmp, 'c1.sock')
+        collector = start_collector(store, [endpoint])
+        started = time.time()
+        out, _ = export(endpoint, 0, 200000).communicate(timeout=120)
+        elapsed = time.time() - started
+        stats = stop_collector(collector)
+        v = values(out)
+        sources, rc = dump(store)
+        events = next(iter(sources.values()), [])
+        intact = len(sources) == 1 and check_events(events, 0, 200000)
+        ratio = v.get('raw', 0) / max(v.get('stored', 1), 1)
+        print(f"✓ {v.get('events')} events in {v.get('frames')} frames, {len(events)} stored, "
+              f"intact={intact}, {v.get('raw', 0) // 1024} KB -> {v.get('stored', 0) // 1024} KB "
+              f"({ratio:.1f}x), {200000 / elapsed:.0f} events/s")
+        if intact and v.get('flush') == 0 and v.get('acked') == v.get('frames') and ratio > 2 and rc == 0:
+            print("✅ PASS: Events delivered compressed and intact\n")
+        else:
+            print("❌ FAIL: Round trip lost or damaged events\n")
+            print(out, stats[-400:])
+            ok = False
+
+        # Test 2: collector down, frames spill, then everything arrives once
+        print("Test 2: Spill while the collector is down")
+        store = os.path.join(tmp, 's2.store')
+        endpoint = 'unix:' + os.path.join(tmp, 'c2.sock')
+        spill = os.path.join(tmp, 'x2.spill')
+        producer = export(endpoint, 0, 150000, max_queued=64 * 1024, spill=spill)
+        time.sleep(1.0)
+        collector = start_collector(store, [endpoint])
+        out, _ = producer.communicate(timeout=120)
+        stop_collector(collector)
+        v = values(out)
+        sources, _ = dump(store)
+        events = next(iter(sources.values()), [])
+        once = len(sources) == 1 and check_events(events, 0, 150000)
+        print(f"✓ {v.get('spilled')} frames spilled, {v.get('acked')} acked of {v.get('frames')}, "
+              f"{len(events)} events stored, exactly once={once}, spill left {os.path.getsize(spill)} bytes")
+        if once and v.get('spilled', 0) > 0 and v.get('flush') == 0 and v.get('dropped') == 0 and \
+                os.path.getsize(spill) == 32:
+            print("✅ PASS: Spilled frames delivered in order\n")
+        else:
+            print("❌ FAIL: Spill lost or duplicated frames\n")
+            print(out)
+            ok = False
+
+        # Test 3: a spill left by a closed exporter is resent by the next
+        print("Test 3: Exporter restart resumes its spill")
+        store = os.path.join(tmp, 's3.store')
+        endpoint = 'unix:' + os.path.join(tmp, 'c3.sock')
+        spill = os.path.join(tmp, 'x3.spill')
+        out1, _ = export(endpoint, 0, 50000, flush_ms=200, max_queued=32 * 1024, spill=spill).communicate(timeout=60)
+        kept = os.path.getsize(spill)
+        collector = start_collector(store, [endpoint])
+        out2, _ = export(endpoint, 50000, 50000, spill=spill).communicate(timeout=120)
+        stop_collector(collector)
+        v1, v2 = values(out1), values(out2)
+        sources, _ = dump(store)
+        events = next(iter(sources.values()), [])
+        resumed = len(sources) == 1 and check_events(events, 0, 100000)
+        print(f"✓ first run: flush={v1.get('flush')}, {kept} bytes kept; second run acked "
+              f"{v2.get('acked')} frames, single source={len(sources) == 1}, all 100000 in order={resumed}")
+        if resumed and v1.get('flush') == -1 and kept > 32 and v2.get('flush') == 0:
+            print("✅ PASS: Second run delivered the first run's frames first\n")
+        else:
+            print("❌ FAIL: Leftover spill not resumed\n")
+            print(out1, out2)
+            ok = False
+
+        # Test 4: SIGKILL of the collector mid-stream
+        print("Test 4: Collector killed mid-stream")
+        store = os.path.join(tmp, 's4.store')
+        endpoint = 'unix:' + os.path.join(tmp, 'c4.sock')
+        spill = os.path.join(tmp, 'x4.spill')
+        collector = start_collector(store, [endpoint])
+        producer = export(endpoint, 0, 400000, max_queued=256 * 1024, spill=spill, pace_us=5000)
+        time.sleep(0.6)
+        collector.kill()
+        collector.wait()
+        time.sleep(0.5)
+        collector = start_collector(store, [endpoint])
+        out, _ = producer.communicate(timeout=180)
+        stats = stop_collector(collector)
+        v = values(out)
+        sources, _ = dump(store)
+        events = next(iter(sources.values()), [])
+        exact = len(sources) == 1 and check_events(events, 0, 400000)
+        print(f"✓ {v.get('connects')} connections, {v.get('sent')} sends for {v.get('frames')} frames, "
+              f"{len(events)} events stored, no loss or duplicates={exact}")
+        if exact and v.get('connects', 0) >= 2 and v.get('flush') == 0:
+            print("✅ PASS: Restarted collector deduplicates resends\n")
+        else:
+            print("❌ FAIL: Crash lost or duplicated events\n")
+            print(out, stats[-400:])
+            ok = False
+
+        # Test 5: eight TCP sources at once
+        print("Test 5: Parallel TCP sources")
+        store = os.path.join(tmp, 's5.store')
+        port = free_port()
+        endpoint = f'tcp:127.0.0.1:{port}'
+        collector = start_collector(store, [endpoint], shards=4)
+        started = time.time()
+        producers = [export(endpoint, k * 1000000, 50000) for k in range(8)]
+        outs = [p.communicate(timeout=180)[0] for p in producers]
+        elapsed = time.time() - started
+        stop_collector(collector)
+        flushed = all(values(o).get('flush') == 0 for o in outs)
+        sources, _ = dump(store)
+        firsts = sorted((events[0]['timestamp_ns'] - BASE_NS) // 1000 for events in sources.values())
+        intact = len(sources) == 8 and firsts == [k * 1000000 for k in range(8)] and \
+            all(check_events(events, (events[0]['timestamp_ns'] - BASE_NS) // 1000, 50000)
+                for events in sources.values())
+        print(f"✓ {len(sources)} sources, all flushed={flushed}, all intact={intact}, "
+              f"{8 * 50000 / elapsed:.0f} events/s together")
+        if intact and flushed:
+            print("✅ PASS: Sources stream in parallel\n")
+        else:
+            print("❌ FAIL: Parallel sources wrong\n")
+            ok = False
+
+        # Test 6: no spill, no collector
+        print("Test 6: Drops without a spill file")
+        endpoint = 'unix:' + os.path.join(tmp, 'nobody.sock')
+        started = time.time()
+        out, _ = export(endpoint, 0, 300000, flush_ms=200, max_queued=64 * 1024).communicate(timeout=60)
+        elapsed = time.time() - started
+        v = values(out)
+        print(f"✓ {v.get('dropped')} frames ({v.get('dropevents')} events) dropped, produced in "
+              f"{v.get('produceus', 0) / 1000:.1f} ms, whole run {elapsed:.2f} s, flush err={v.get('err')}")
+        nonblocking = v.get('dropped', 0) > 0 and v.get('flush') == -1 and v.get('acked') == 0 and \
+            elapsed < 10
+        cli_ok = True
+        cli = os.path.join(tmp, 'memwatch_cli')
+        build = subprocess.run(['gcc', '-O2', '-I', os.path.join(ROOT, 'include'), '-o', cli] +
+                               [os.path.join(ROOT, s) for s in CLI_SOURCES] +
+                               ['-lsqlite3', '-lpthread', '-ldl', '-lrt'], capture_output=True, text=True)
+        if build.returncode != 0:
+            print("CLI did not build - skipping the CLI check")
+            print(build.stderr[-500:])
+        else:
+            store = os.path.join(tmp, 's6.store')
+            endpoint = 'unix:' + os.path.join(tmp, 'c6.sock')
+            collector = start_collector(store, [endpoint])
+            run = subprocess.run([cli, 'run', 'true', '--export', endpoint], capture_output=True,
+                                 text=True, timeout=60)
+            stop_collector(collector)
+            bad = subprocess.run([cli, 'run', 'true', '--export', 'carrier-pigeon'],
+                                 capture_output=True, text=True, timeout=60)
+            cli_ok = run.returncode == 0 and 'Export: 0 events' in run.stdout and \
+                bad.returncode == 1 and 'Cannot export' in bad.stderr
+            print(f"✓ memwatch run --export reported stats={run.returncode == 0 and 'Export:' in run.stdout}, "
+                  f"bad endpoint rejected={bad.returncode == 1}")
+        if nonblocking and cli_ok:
+            print("✅ PASS: Producer never blocks; drops are counted\n")
+        else:
+            print("❌ FAIL: Exporter blocked or miscounted\n")
+            print(out)
+            ok = False
+
+    print("=== Test Summary ===")
+    if ok:
+        print("✅ All export checks passed")
+        return 0
+    print("❌ Some export checks failed")
+    return 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,183 @@
+#!/usr/bin/env python3
+"""
+FastStorage Compaction Test - memwatch
+
+Records are appended into 1 MB segments; a background thread empties mostly
+dead segments and punches them out of the file. Verifies that:
+1. Rewriting the same keys keeps the file near its live size
+2. Readers see the latest value of every key while segments move
+3. faststorage_compact() after mass deletes returns disk blocks
+4. A reopened compacted file is intact and writable
+"""
+
+import sys
+import os
+import ctypes
+import subprocess
+import tempfile
+import threading
+import time
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+LIBRARY = os.path.join(ROOT, 'build', 'libfaststorage.so')
+
+MB = 1024 * 1024
+NUM_KEYS = 200
+ROUNDS = 1000
+VALUE_SIZE = 1024
+
+class FastStorageStats(ctypes.Structure):
+    _fields_ = [(name, ctypes.c_uint64) for name in (
+        'total_reads', 'total_writes', 'total_deletes', 'cache_hits',
+        'cache_misses', 'compactions', 'growth_count', 'rehash_count',
+        'reclaimed_bytes', 'sync_count', 'dropped_records')]
+
+def load():
+    lib = ctypes.CDLL(LIBRARY)
+    lib.faststorage_create.restype = ctypes.c_void_p
+    lib.faststorage_create.argtypes = [ctypes.c_char_p, ctypes.c_size_t]
+    lib.faststorage_destroy.argtypes = [ctypes.c_void_p]
+    lib.faststorage_write.argtypes = [ctypes.c_void_p, ctypes.c_char_p,
+                                      ctypes.c_char_p, ctypes.c_size_t]
+    lib.faststorage_read.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_char_p,
+                                     ctypes.POINTER(ctypes.c_size_t)]
+    lib.faststorage_delete.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+    lib.faststorage_compact.argtypes = [ctypes.c_void_p]
+    lib.faststorage_flush.argtypes = [ctypes.c_void_p]
+    lib.faststorage_count.restype = ctypes.c_size_t
+    lib.faststorage_count.argtypes = [ctypes.c_void_p]
+    lib.faststorage_capacity.restype = ctypes.c_size_t
+    lib.faststorage_capacity.argtypes = [ctypes.c_void_p]
+    lib.faststorage_get_stats.argtypes = [ctypes.c_void_p, ctypes.POINTER(FastStorageStats)]
+    return lib
+
+def read(lib, fs, key):
+    buf = ctypes.create_string_buffer(2 * VALUE_SIZE)
+    size = ctypes.c_size_t(len(buf))
+    if lib.faststorage_read(fs, key.encode(), buf, ctypes.byref(size)) != 0:
+        return None
+    return buf.raw[:size.value]
+
+def write(lib, fs, key, value):
+    return lib.faststorage_write(fs, key.encode(), value, len(value))
+
+def stats(lib, fs):
+    s = FastStorageStats()
+    lib.faststorage_get_stats(fs, ctypes.byref(s))
+    return s
+
+def value_of(key, round_):
+    return (b'%d:%d:' % (key, round_)).ljust(VALUE_SIZE, b'#')
+
+def disk_bytes(path):
+    return os.stat(path).st_blocks * 512
+
+def main():
+    print("=== FastStorage Compaction Test ===\n")
+
+    if not os.path.exists(LIBRARY):
+        subprocess.run(['make', '-C', ROOT, 'build-faststorage'], capture_output=True)
+    if not os.path.exists(LIBRARY):
+        print("libfaststorage.so not built (make build-faststorage) - skipping\n")
+        return 0
+
+    lib = load()
+    ok = True
+    with tempfile.TemporaryDirectory() as tmp:
+        path = os.path.join(tmp, 'compact.fs')
+        fs = lib.faststorage_create(path.encode(), MB)
+
+        # Test 1 + 2: Hot rewrites with concurrent readers
+        written = NUM_KEYS * ROUNDS * VALUE_SIZE
+        print(f"Test 1: {written // MB} MB of rewrites over {NUM_KEYS} keys")
+        latest = [0] * NUM_KEYS
+        stop = threading.Event()
+        bad = []
+        def reader():
+            while not stop.is_set():
+                for k in range(0, NUM_KEYS, 13):
+                    floor = latest[k]
+                    value = read(lib, fs, f"key_{k}")
+                    if value is None:
+                        continue
+                    key, round_ = map(int, value.split(b':')[:2])
+                    if key != k or round_ < floor or value != value_of(k, round_):
+                        bad.append((k, value[:20]))
+        readers = [threading.Thread(target=reader) for _ in range(2)]
+        for t in readers:
+            t.start()
+        failures = 0
+        for r in range(ROUNDS):
+            for k in range(NUM_KEYS):
+                failures += write(lib, fs, f"key_{k}", value_of(k, r)) != 0
+                latest[k] = r
+        stop.set()
+        for t in readers:
+            t.join()
+        capacity = lib.faststorage_capacity(fs)
+        s = stats(lib, fs)
+        print(f"✓ {failures} failed writes, capacity {capacity / MB:.0f} MB, "
+              f"{s.compactions} segments compacted")
+        if failures == 0 and capacity <= 16 * MB and s.compactions > 0:
+            print("✅ PASS: File stays near its live size\n")
+        else:
+            print("❌ FAIL: Dead records not reclaimed\n")
+            ok = False
+
+        print("Test 2: Readers during compaction")
+        stale = sum(read(lib, fs, f"key_{k}") != value_of(k, ROUNDS - 1)
+                    for k in range(NUM_KEYS))
+        print(f"✓ {s.total_reads} concurrent reads, {len(bad)} inconsistent, {stale} stale keys")
+        if not bad and stale == 0:
+            print("✅ PASS: Every read saw a whole, current record\n")
+        else:
+            print("❌ FAIL: Reader saw moved or torn data\n")
+            ok = False
+
+        # Test 3: Deletes + explicit compaction
+        print("Test 3: Delete bulk keys, then faststorage_compact()")
+        blob = b'b' * VALUE_SIZE
+        for i in range(8000):
+            write(lib, fs, f"bulk_{i}", blob)
+        lib.faststorage_flush(fs)
+        before = disk_bytes(path)
+        for i in range(8000):
+            lib.faststorage_delete(fs, f"bulk_{i}".encode())
+        result = lib.faststorage_compact(fs)
+        after = disk_bytes(path)
+        s = stats(lib, fs)
+        print(f"✓ compact() -> {result}, disk {before / MB:.1f} MB -> {after / MB:.1f} MB, "
+              f"{s.reclaimed_bytes // MB} MB reclaimed")
+        if result == 0 and after < before - 4 * MB:
+            print("✅ PASS: Freed segments returned to the file system\n")
+        else:
+            print("❌ FAIL: Disk usage did not drop\n")
+            ok = False
+        lib.faststorage_destroy(fs)
+
+        # Test 4: Reopen
+        print("Test 4: Reopen the compacted file")
+        fs = lib.faststorage_create(path.encode(), MB)
+        intact = all(read(lib, fs, f"key_{k}") == value_of(k, ROUNDS - 1)
+                     for k in range(NUM_KEYS))
+        gone = all(read(lib, fs, f"bulk_{i}") is None for i in range(0, 8000, 97))
+        for k in range(NUM_KEYS):
+            write(lib, fs, f"key_{k}", value_of(k, ROUNDS))
+        time.sleep(0.05)
+        rewritten = all(read(lib, fs, f"key_{k}") == value_of(k, ROUNDS)
+                        for k in range(NUM_KEYS))
+        print(f"✓ {lib.faststorage_count(fs)} entries, intact={intact} "
+              f"deleted_gone={gone} rewritable={rewritten}")
+        if intact and gone and rewritten and lib.faststorage_count(fs) == NUM_KEYS:
+            print("✅ PASS: Compacted file reopened intact\n")
+        else:
+            print("❌ FAIL: Data lost after compaction\n")
+            ok = False
+        lib.faststorage_destroy(fs)
+
+    print("=== Test Summary ===")
+    print("✅ All compaction checks passed" if ok else "❌ Some checks failed")
+    return 0 if ok else 1
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,258 @@
+#!/usr/bin/env python3
+"""
+FastStorage Durability Test - memwatch
+
+Records carry a CRC-32C, the header checksum doubles as a clean-shutdown
+mark, and a store opened without it is checked and cut back to its last
+intact record. Writes can be batched, and durability is selectable: none,
+async writeback, group commit or a sync per call. Verifies that:
+1. Every record's checksum covers its header, key and value
+2. faststorage_write_batch() stores entries in order and stops on a bad one
+3. Group commit makes sync() wait for a flush round; SYNC mode syncs per call
+4. A store copied mid-session reopens cut back to before its first bad record
+5. The header checksum is 0 while open and valid after a clean close
+6. Batches and durability modes work through a sharded handle
+"""
+
+import sys
+import os
+import ctypes
+import shutil
+import struct
+import subprocess
+import tempfile
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+LIBRARY = os.path.join(ROOT, 'build', 'libfaststorage.so')
+sys.path.insert(0, os.path.join(ROOT, 'python'))
+
+MB = 1024 * 1024
+NONE, ASYNC, GROUP, SYNC = range(4)
+RECORD_HEADER = 16
+HEADER_CRC = 40
+
+class FastStorageStats(ctypes.Structure):
+    _fields_ = [(name, ctypes.c_uint64) for name in (
+        'total_reads', 'total_writes', 'total_deletes', 'cache_hits',
+        'cache_misses', 'compactions', 'growth_count', 'rehash_count',
+        'reclaimed_bytes', 'sync_count', 'dropped_records')]
+
+class BatchEntry(ctypes.Structure):
+    _fields_ = [('key', ctypes.c_char_p), ('value', ctypes.c_char_p), ('value_len', ctypes.c_size_t)]
+
+def load():
+    lib = ctypes.CDLL(LIBRARY, use_errno=True)
+    lib.faststorage_create.restype = ctypes.c_void_p
+    lib.faststorage_create.argtypes = [ctypes.c_char_p, ctypes.c_size_t]
+    lib.faststorage_create_sharded.restype = ctypes.c_void_p
+    lib.faststorage_create_sharded.argtypes = [ctypes.c_char_p, ctypes.c_size_t, ctypes.c_uint32]
+    lib.faststorage_destroy.argtypes = [ctypes.c_void_p]
+    lib.faststorage_write.argtypes = [ctypes.c_void_p, ctypes.c_char_p,
+                                      ctypes.c_char_p, ctypes.c_size_t]
+    lib.faststorage_write_batch.argtypes = [ctypes.c_void_p, ctypes.POINTER(BatchEntry), ctypes.c_size_t]
+    lib.faststorage_read.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_char_p,
+                                     ctypes.POINTER(ctypes.c_size_t)]
+    lib.faststorage_delete.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+    lib.faststorage_set_durability.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_uint32]
+    lib.faststorage_sync.argtypes = [ctypes.c_void_p]
+    lib.faststorage_flush.argtypes = [ctypes.c_void_p]
+    lib.faststorage_count.restype = ctypes.c_size_t
+    lib.faststorage_count.argtypes = [ctypes.c_void_p]
+    lib.faststorage_get_stats.argtypes = [ctypes.c_void_p, ctypes.POINTER(FastStorageStats)]
+    lib.faststorage_reset_stats.argtypes = [ctypes.c_void_p]
+    lib.mw_crc32c.restype = ctypes.c_uint32
+    lib.mw_crc32c.argtypes = [ctypes.c_uint32, ctypes.c_char_p, ctypes.c_size_t]
+    return lib
+
+def read(lib, fs, key, capacity=512 * 1024):
+    buf = ctypes.create_string_buffer(capacity)
+    size = ctypes.c_size_t(capacity)
+    if lib.faststorage_read(fs, key.encode(), buf, ctypes.byref(size)) != 0:
+        return None
+    return buf.raw[:size.value]
+
+def write(lib, fs, key, value):
+    return lib.faststorage_write(fs, key.encode(), value, len(value))
+
+def batch(lib, fs, items):
+    entries = (BatchEntry * len(items))()
+    for e, (key, value) in zip(entries, items):
+        e.key, e.value, e.value_len = key.encode(), value, len(value)
+    return lib.faststorage_write_batch(fs, entries, len(items))
+
+def stats(lib, fs):
+    s = FastStorageStats()
+    lib.faststorage_get_stats(fs, ctypes.byref(s))
+    return s
+
+def value_of(i, size=48):
+    return bytes((i * 13 + j) & 0xFF for j in range(size))
+
+def find_record(data, key):
+    """Offset of the inline record holding key"""
+    at = data.find(key.encode() + b'\0')
+    return at - RECORD_HEADER
+
+def record_crc(lib, data, offset):
+    magic, key_len, value_len, crc = struct.unpack_from('<4I', data, offset)
+    body = data[offset:offset + 12] + data[offset + RECORD_HEADER:offset + RECORD_HEADER + key_len + value_len]
+    return crc, lib.mw_crc32c(0, body, len(body)) or 0xFFFFFFFF
+
+def header_crc(lib, path):
+    with open(path, 'rb') as f:
+        header = f.read(48)
+    return struct.unpack_from('<I', header, HEADER_CRC)[0], lib.mw_crc32c(0, header[:HEADER_CRC], HEADER_CRC) or 0xFFFFFFFF
+
+def main():
+    print("=== FastStorage Durability Test ===\n")
+
+    if not os.path.exists(LIBRARY):
+        subprocess.run(['make', '-C', ROOT, 'build-faststorage'], capture_output=True)
+    if not os.path.exists(LIBRARY):
+        print("libfaststorage.so not built (make build-faststorage) - skipping\n")
+        return 0
+
+    lib = load()
+    ok = True
+    with tempfile.TemporaryDirectory() as tmp:
+        path = os.path.join(tmp, 'store.fs')
+        fs = lib.faststorage_create(path.encode(), 4 * MB)
+
+        # Test 1: Record checksums
+        print("Test 1: Record checksums")
+        for i in range(50):
+            write(lib, fs, f"rec_{i}", value_of(i))
+        lib.faststorage_flush(fs)
+        with open(path, 'rb') as f:
+            data = f.read()
+        checked = [record_crc(lib, data, find_record(data, f"rec_{i}")) for i in range(50)]
+        good = sum(stored == computed and stored != 0 for stored, computed in checked)
+        print(f"✓ {good}/50 records carry a matching CRC-32C")
+        if good == 50:
+            print("✅ PASS: Records are checksummed\n")
+        else:
+            print("❌ FAIL: Record checksum mismatch\n")
+            ok = False
+
+        # Test 2: Batches
+        print("Test 2: faststorage_write_batch")
+        items = [(f"batch_{i}", value_of(i, 32 + i)) for i in range(200)]
+        items.append(("batch_big", value_of(7, 300 * 1024)))
+        items.append(("batch_0", b'overwritten'))
+        first = batch(lib, fs, items)
+        stored = sum(read(lib, fs, k) == v for k, v in items[1:])
+        bad = [("after_0", b'a'), ("k" * 300, b'x'), ("after_1", b'b')]
+        second = batch(lib, fs, bad)
+        errno = ctypes.get_errno()
+        partial = (read(lib, fs, "after_0"), read(lib, fs, "after_1"))
+        print(f"✓ batch={first}, {stored}/{len(items) - 1} read back, "
+              f"bad batch={second} (errno {errno}), partial={partial}")
+        if first == 0 and stored == len(items) - 1 and second == -1 and partial == (b'a', None):
+            print("✅ PASS: Batches apply in order and stop at a bad entry\n")
+        else:
+            print("❌ FAIL: Batch results wrong\n")
+            ok = False
+
+        # Test 3: Durability modes
+        print("Test 3: Group commit and per-call sync")
+        lib.faststorage_set_durability(fs, GROUP, 5)
+        lib.faststorage_reset_stats(fs)
+        for i in range(100):
+            write(lib, fs, f"group_{i}", value_of(i))
+        group_sync = lib.faststorage_sync(fs)
+        group_syncs = stats(lib, fs).sync_count
+        lib.faststorage_set_durability(fs, SYNC, 0)
+        lib.faststorage_reset_stats(fs)
+        for i in range(10):
+            write(lib, fs, f"sync_{i}", value_of(i))
+        batch(lib, fs, [(f"sync_batch_{i}", value_of(i)) for i in range(50)])
+        sync_syncs = stats(lib, fs).sync_count
+        bad_mode = lib.faststorage_set_durability(fs, 9, 0)
+        lib.faststorage_set_durability(fs, NONE, 0)
+        print(f"✓ group: sync()={group_sync}, {group_syncs} syncs for 100 writes; "
+              f"sync mode: {sync_syncs} syncs for 10 writes + 1 batch; bad mode={bad_mode}")
+        if group_sync == 0 and 1 <= group_syncs < 100 and sync_syncs == 11 and bad_mode == -1:
+            print("✅ PASS: Durability modes sync as configured\n")
+        else:
+            print("❌ FAIL: Unexpected sync counts\n")
+            ok = False
+
+        # Test 4: Crash recovery
+        print("Test 4: Reopen after a crash")
+        for i in range(20):
+            write(lib, fs, f"crash_{i}", value_of(i, 200))
+        lib.faststorage_flush(fs)
+        crashed = os.path.join(tmp, 'crashed.fs')
+        shutil.copyfile(path, crashed)
+        live_count = lib.faststorage_count(fs)
+        with open(crashed, 'r+b') as f:
+            data = bytearray(f.read())
+            damaged = find_record(data, "crash_5")
+            data[damaged + RECORD_HEADER + 40] ^= 0xFF
+            data_end = struct.unpack_from('<Q', data, 16)[0]
+            # A record header whose body never made it to disk
+            magic = struct.unpack_from('<I', data, 0)[0]
+            torn = struct.pack('<4I', magic, 9, 64, 0x12345678) + b'torn_key\0'
+            data[data_end:data_end + len(torn)] = torn
+            f.seek(0)
+            f.write(data)
+        reopened = lib.faststorage_create(crashed.encode(), 4 * MB)
+        count = lib.faststorage_count(reopened)
+        kept = sum(read(lib, reopened, f"crash_{i}") == value_of(i, 200) for i in range(5))
+        lost = sum(read(lib, reopened, f"crash_{i}") is not None for i in range(5, 20))
+        earlier = all(read(lib, reopened, f"batch_{i}") == value_of(i, 32 + i) for i in range(1, 200))
+        dropped = stats(lib, reopened).dropped_records
+        writable = write(lib, reopened, "after_crash", b'ok') == 0 and read(lib, reopened, "after_crash") == b'ok'
+        lib.faststorage_destroy(reopened)
+        print(f"✓ {count}/{live_count} entries after reopen, {kept}/5 before the damage intact, "
+              f"{lost}/15 from it on kept, earlier keys intact={earlier}, dropped={dropped}, "
+              f"writable={writable}")
+        if (kept == 5 and lost == 0 and earlier and dropped == 15 and writable
+                and count == live_count - 15):
+            print("✅ PASS: Log is cut at the first bad record\n")
+        else:
+            print("❌ FAIL: Recovery kept bad data or lost good data\n")
+            ok = False
+
+        # Test 5: Clean-shutdown mark
+        print("Test 5: Header checksum marks a clean close")
+        open_crc, _ = header_crc(lib, path)
+        lib.faststorage_destroy(fs)
+        closed_crc, expected = header_crc(lib, path)
+        fs = lib.faststorage_create(path.encode(), 4 * MB)
+        clean_dropped = stats(lib, fs).dropped_records
+        reopened_crc, _ = header_crc(lib, path)
+        lib.faststorage_destroy(fs)
+        print(f"✓ open crc={open_crc:#x}, closed crc={closed_crc:#x} (expected {expected:#x}), "
+              f"reopened crc={reopened_crc:#x}, dropped on clean reopen={clean_dropped}")
+        if open_crc == 0 and closed_crc == expected and reopened_crc == 0 and clean_dropped == 0:
+            print("✅ PASS: Checksum is written only on clean shutdown\n")
+        else:
+            print("❌ FAIL: Clean-shutdown mark wrong\n")
+            ok = False
+
+        # Test 6: Sharded handle
+        print("Test 6: Batches and durability through shards")
+        sharded = os.path.join(tmp, 'sharded.fs')
+        fs = lib.faststorage_create_sharded(sharded.encode(), 4 * MB, 4)
+        lib.faststorage_set_durability(fs, GROUP, 5)
+        items = [(f"shard_{i}", value_of(i)) for i in range(400)]
+        result = batch(lib, fs, items)
+        synced = lib.faststorage_sync(fs)
+        stored = sum(read(lib, fs, k) == v for k, v in items)
+        count = lib.faststorage_count(fs)
+        syncs = stats(lib, fs).sync_count
+        lib.faststorage_destroy(fs)
+        print(f"✓ batch={result}, sync={synced}, {stored}/400 read back, count={count}, {syncs} syncs")
+        if result == 0 and synced == 0 and stored == 400 and count == 400 and syncs >= 1:
+            print("✅ PASS: Sharded batches and group commit work\n")
+        else:
+            print("❌ FAIL: Sharded durability broken\n")
+            ok = False
+
+    print("=== Test Summary ===")
+    print("✅ All durability checks passed" if ok else "❌ Some checks failed")
+    return 0 if ok else 1
+
+if __name__ == '__main__':
+    sys.exit(main())
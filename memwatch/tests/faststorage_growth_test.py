@@ -0,0 +1,182 @@
+#!/usr/bin/env python3
+"""
+FastStorage Growth Test - memwatch
+
+The mmap store grows its file and its hash table online. Verifies that:
+1. Writing past the initial capacity grows the file in 2 MB extents
+2. Passing the load factor rehashes and keeps every key reachable
+3. Overwrites don't inflate the count; deletes keep probe chains intact
+4. A reopened file still holds everything
+5. Readers on other threads stay consistent while the writer remaps
+"""
+
+import sys
+import os
+import ctypes
+import subprocess
+import tempfile
+import threading
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+LIBRARY = os.path.join(ROOT, 'build', 'libfaststorage.so')
+
+MB = 1024 * 1024
+INITIAL_SLOTS = 16384
+NUM_KEYS = 40000
+
+class FastStorageStats(ctypes.Structure):
+    _fields_ = [(name, ctypes.c_uint64) for name in (
+        'total_reads', 'total_writes', 'total_deletes', 'cache_hits',
+        'cache_misses', 'compactions', 'growth_count', 'rehash_count',
+        'reclaimed_bytes', 'sync_count', 'dropped_records')]
+
+def load():
+    lib = ctypes.CDLL(LIBRARY)
+    lib.faststorage_create.restype = ctypes.c_void_p
+    lib.faststorage_create.argtypes = [ctypes.c_char_p, ctypes.c_size_t]
+    lib.faststorage_destroy.argtypes = [ctypes.c_void_p]
+    lib.faststorage_write.argtypes = [ctypes.c_void_p, ctypes.c_char_p,
+                                      ctypes.c_char_p, ctypes.c_size_t]
+    lib.faststorage_read.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_char_p,
+                                     ctypes.POINTER(ctypes.c_size_t)]
+    lib.faststorage_delete.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+    lib.faststorage_count.restype = ctypes.c_size_t
+    lib.faststorage_count.argtypes = [ctypes.c_void_p]
+    lib.faststorage_capacity.restype = ctypes.c_size_t
+    lib.faststorage_capacity.argtypes = [ctypes.c_void_p]
+    lib.faststorage_get_stats.argtypes = [ctypes.c_void_p, ctypes.POINTER(FastStorageStats)]
+    return lib
+
+def read(lib, fs, key):
+    buf = ctypes.create_string_buffer(4096)
+    size = ctypes.c_size_t(len(buf))
+    if lib.faststorage_read(fs, key.encode(), buf, ctypes.byref(size)) != 0:
+        return None
+    return buf.raw[:size.value]
+
+def write(lib, fs, key, value):
+    return lib.faststorage_write(fs, key.encode(), value, len(value))
+
+def stats(lib, fs):
+    s = FastStorageStats()
+    lib.faststorage_get_stats(fs, ctypes.byref(s))
+    return s
+
+def value_of(i):
+    return (b'v%d:' % i).ljust(40, b'.')
+
+def main():
+    print("=== FastStorage Growth Test ===\n")
+
+    if not os.path.exists(LIBRARY):
+        subprocess.run(['make', '-C', ROOT, 'build-faststorage'], capture_output=True)
+    if not os.path.exists(LIBRARY):
+        print("libfaststorage.so not built (make build-faststorage) - skipping\n")
+        return 0
+
+    lib = load()
+    ok = True
+    with tempfile.TemporaryDirectory() as tmp:
+        path = os.path.join(tmp, 'growth.fs').encode()
+        fs = lib.faststorage_create(path, MB)
+
+        # Test 1: File growth
+        print("Test 1: 3 MB of values into a 1 MB store")
+        big = b'x' * 2000
+        failures = sum(write(lib, fs, f"big_{i}", big) != 0 for i in range(1500))
+        capacity = lib.faststorage_capacity(fs)
+        growths = stats(lib, fs).growth_count
+        intact = all(read(lib, fs, f"big_{i}") == big for i in range(1500))
+        print(f"✓ {failures} failed writes, capacity {capacity / MB:.0f} MB, {growths} growths")
+        if failures == 0 and intact and capacity >= 3 * MB and capacity % (2 * MB) == 0 \
+                and 0 < growths <= 3:
+            print("✅ PASS: File grew geometrically in 2 MB extents\n")
+        else:
+            print("❌ FAIL: Growth broken\n")
+            ok = False
+
+        # Test 2: Rehash
+        print(f"Test 2: {NUM_KEYS} keys into {INITIAL_SLOTS} initial slots")
+        failures = sum(write(lib, fs, f"key_{i}", value_of(i)) != 0 for i in range(NUM_KEYS))
+        missing = sum(read(lib, fs, f"key_{i}") != value_of(i) for i in range(NUM_KEYS))
+        rehashes = stats(lib, fs).rehash_count
+        print(f"✓ {failures} failed writes, {missing} missing, {rehashes} rehashes")
+        if failures == 0 and missing == 0 and rehashes >= 2:
+            print("✅ PASS: Table resized online\n")
+        else:
+            print("❌ FAIL: Keys lost across rehash\n")
+            ok = False
+
+        # Test 3: Overwrite and delete
+        print("Test 3: Overwrites and deletes")
+        before = lib.faststorage_count(fs)
+        for i in range(0, NUM_KEYS, 2):
+            write(lib, fs, f"key_{i}", value_of(i + 1))
+        same_count = lib.faststorage_count(fs) == before
+        for i in range(0, NUM_KEYS, 3):
+            lib.faststorage_delete(fs, f"key_{i}".encode())
+        wrong = 0
+        for i in range(NUM_KEYS):
+            expect = None if i % 3 == 0 else value_of(i + 1 if i % 2 == 0 else i)
+            wrong += read(lib, fs, f"key_{i}") != expect
+        expected_count = 1500 + NUM_KEYS - len(range(0, NUM_KEYS, 3))
+        count = lib.faststorage_count(fs)
+        print(f"✓ count {before} -> {count}, {wrong} wrong lookups")
+        if same_count and wrong == 0 and count == expected_count:
+            print("✅ PASS: Overwrites in place, tombstones keep chains\n")
+        else:
+            print("❌ FAIL: Count or lookups wrong\n")
+            ok = False
+        lib.faststorage_destroy(fs)
+
+        # Test 4: Reopen
+        print("Test 4: Reopen the grown file")
+        fs = lib.faststorage_create(path, MB)
+        count = lib.faststorage_count(fs)
+        sample = [i for i in range(1, NUM_KEYS, 7) if i % 3 != 0]
+        reopened = all(read(lib, fs, f"key_{i}") == value_of(i + 1 if i % 2 == 0 else i)
+                       for i in sample)
+        print(f"✓ {count} entries after reopen")
+        if count == expected_count and reopened:
+            print("✅ PASS: Grown file reopened intact\n")
+        else:
+            print("❌ FAIL: Data lost on reopen\n")
+            ok = False
+        lib.faststorage_destroy(fs)
+
+        # Test 5: Concurrent readers
+        print("Test 5: Readers while the writer grows and rehashes")
+        fs = lib.faststorage_create(os.path.join(tmp, 'concurrent.fs').encode(), MB)
+        for i in range(100):
+            write(lib, fs, f"stable_{i}", value_of(i))
+        stop = threading.Event()
+        bad = []
+        def reader():
+            while not stop.is_set():
+                for i in range(0, 100, 9):
+                    if read(lib, fs, f"stable_{i}") != value_of(i):
+                        bad.append(i)
+        readers = [threading.Thread(target=reader) for _ in range(3)]
+        for t in readers:
+            t.start()
+        for i in range(30000):
+            write(lib, fs, f"churn_{i}", big[:100])
+        stop.set()
+        for t in readers:
+            t.join()
+        s = stats(lib, fs)
+        print(f"✓ {s.growth_count} growths, {s.rehash_count} rehashes, "
+              f"{s.total_reads} reads, {len(bad)} inconsistent")
+        if not bad and s.growth_count > 0 and s.rehash_count > 0:
+            print("✅ PASS: Readers never saw a moving mapping\n")
+        else:
+            print("❌ FAIL: Reader saw bad data\n")
+            ok = False
+        lib.faststorage_destroy(fs)
+
+    print("=== Test Summary ===")
+    print("✅ All growth checks passed" if ok else "❌ Some checks failed")
+    return 0 if ok else 1
+
+if __name__ == '__main__':
+    sys.exit(main())
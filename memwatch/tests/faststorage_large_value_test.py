@@ -0,0 +1,230 @@
+#!/usr/bin/env python3
+"""
+FastStorage Large Value Test - memwatch
+
+Format version 3 has 64-bit offsets and stores values over 100 KB as chunk
+records listed by a blob record. Verifies that:
+1. A version 2 file opens, upgrades, and keeps its data
+2. A 64 MB value streams in and out one 256 KB chunk at a time
+3. faststorage_write/read/size handle multi-MB values transparently
+4. An aborted stream keeps the old value
+5. Compaction moves blob chunks without corrupting the value
+6. Large values survive a reopen
+"""
+
+import sys
+import os
+import ctypes
+import struct
+import subprocess
+import tempfile
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+LIBRARY = os.path.join(ROOT, 'build', 'libfaststorage.so')
+
+MB = 1024 * 1024
+CHUNK = 256 * 1024
+STREAM_SIZE = 64 * MB
+
+SOURCE = ctypes.CFUNCTYPE(ctypes.c_ssize_t, ctypes.c_void_p, ctypes.c_void_p, ctypes.c_size_t)
+SINK = ctypes.CFUNCTYPE(ctypes.c_int, ctypes.c_void_p, ctypes.c_void_p, ctypes.c_size_t)
+
+class FastStorageStats(ctypes.Structure):
+    _fields_ = [(name, ctypes.c_uint64) for name in (
+        'total_reads', 'total_writes', 'total_deletes', 'cache_hits',
+        'cache_misses', 'compactions', 'growth_count', 'rehash_count',
+        'reclaimed_bytes', 'sync_count', 'dropped_records')]
+
+def load():
+    lib = ctypes.CDLL(LIBRARY)
+    lib.faststorage_create.restype = ctypes.c_void_p
+    lib.faststorage_create.argtypes = [ctypes.c_char_p, ctypes.c_size_t]
+    lib.faststorage_destroy.argtypes = [ctypes.c_void_p]
+    lib.faststorage_write.argtypes = [ctypes.c_void_p, ctypes.c_char_p,
+                                      ctypes.c_char_p, ctypes.c_size_t]
+    lib.faststorage_read.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_char_p,
+                                     ctypes.POINTER(ctypes.c_size_t)]
+    lib.faststorage_size.restype = ctypes.c_ssize_t
+    lib.faststorage_size.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+    lib.faststorage_write_stream.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_uint64,
+                                             SOURCE, ctypes.c_void_p]
+    lib.faststorage_read_stream.argtypes = [ctypes.c_void_p, ctypes.c_char_p, SINK, ctypes.c_void_p]
+    lib.faststorage_compact.argtypes = [ctypes.c_void_p]
+    lib.faststorage_count.restype = ctypes.c_size_t
+    lib.faststorage_count.argtypes = [ctypes.c_void_p]
+    lib.faststorage_get_stats.argtypes = [ctypes.c_void_p, ctypes.POINTER(FastStorageStats)]
+    lib.mw_hash64.restype = ctypes.c_uint64
+    lib.mw_hash64.argtypes = [ctypes.c_char_p, ctypes.c_size_t]
+    return lib
+
+def read(lib, fs, key, capacity=4096):
+    buf = ctypes.create_string_buffer(capacity)
+    size = ctypes.c_size_t(capacity)
+    if lib.faststorage_read(fs, key.encode(), buf, ctypes.byref(size)) != 0:
+        return None
+    return buf.raw[:size.value]
+
+def pattern(seed, size):
+    block = bytes((seed * 31 + i * 7) & 0xFF for i in range(4096))
+    return (block * (size // len(block) + 1))[:size]
+
+def write_v2_file(lib, path, items):
+    """Lay out a version 2 file by hand: 48-byte header, 8-byte slots"""
+    num_slots = 16384
+    table = bytearray(num_slots * 8)
+    data = bytearray()
+    data_start = 48 + len(table)
+    for key, value in items:
+        raw_key = key.encode() + b'\0'
+        h = lib.mw_hash64(key.encode(), len(key))
+        h = (h ^ (h >> 32)) & 0xFFFFFFFF
+        index = h % num_slots
+        while struct.unpack_from('<I', table, index * 8)[0]:
+            index = (index + 1) % num_slots
+        struct.pack_into('<II', table, index * 8, data_start + len(data), h)
+        data += struct.pack('<IIII', 0xFDB20024, len(raw_key), len(value), 0) + raw_key + value
+    data_end = data_start + len(data)
+    header = struct.pack('<IIQQIIQII', 0xFDB20024, 2, MB, data_end, len(items),
+                         num_slots, 48, 0, 0)
+    with open(path, 'wb') as f:
+        f.write(header + table + data)
+        f.truncate(MB)
+
+def main():
+    print("=== FastStorage Large Value Test ===\n")
+
+    if not os.path.exists(LIBRARY):
+        subprocess.run(['make', '-C', ROOT, 'build-faststorage'], capture_output=True)
+    if not os.path.exists(LIBRARY):
+        print("libfaststorage.so not built (make build-faststorage) - skipping\n")
+        return 0
+
+    lib = load()
+    ok = True
+    with tempfile.TemporaryDirectory() as tmp:
+        # Test 1: Version 2 upgrade
+        print("Test 1: Open a version 2 file")
+        path = os.path.join(tmp, 'v2.fs')
+        items = [(f"old_{i}", b'value-%d' % i) for i in range(500)]
+        write_v2_file(lib, path, items)
+        fs = lib.faststorage_create(path.encode(), MB)
+        with open(path, 'rb') as f:
+            version = struct.unpack('<II', f.read(8))[1]
+        intact = fs and all(read(lib, fs, k) == v for k, v in items)
+        print(f"✓ opened={bool(fs)} version on disk {version}, "
+              f"{lib.faststorage_count(fs) if fs else 0} entries intact={intact}")
+        if fs and version == 3 and intact:
+            print("✅ PASS: Upgraded in place\n")
+        else:
+            print("❌ FAIL: Version 2 file not usable\n")
+            ok = False
+            return 1
+
+        # Test 2: Streaming
+        print(f"Test 2: Stream a {STREAM_SIZE // MB} MB value in and out")
+        block = pattern(7, MB)
+        produced = [0]
+        largest_request = [0]
+        def source(ctx, buf, length):
+            largest_request[0] = max(largest_request[0], length)
+            n = min(length, STREAM_SIZE - produced[0], MB - produced[0] % MB)
+            start = produced[0] % MB
+            ctypes.memmove(buf, block[start:start + n], n)
+            produced[0] += n
+            return n
+        result = lib.faststorage_write_stream(fs, b'tensor', STREAM_SIZE, SOURCE(source), None)
+        received = [0, 0, True]     # bytes, largest piece, matches
+        def sink(ctx, data, length):
+            piece = ctypes.string_at(data, length)
+            start = received[0] % MB
+            received[2] &= piece == (block[start:] + block)[:length]
+            received[0] += length
+            received[1] = max(received[1], length)
+            return 0
+        read_result = lib.faststorage_read_stream(fs, b'tensor', SINK(sink), None)
+        size = lib.faststorage_size(fs, b'tensor')
+        print(f"✓ write {result}, read {read_result}, size {size // MB} MB, "
+              f"source asked ≤{largest_request[0] // 1024} KB, sink got ≤{received[1] // 1024} KB")
+        if result == 0 and read_result == 0 and size == STREAM_SIZE and \
+                received[0] == STREAM_SIZE and received[2] and \
+                largest_request[0] <= CHUNK and received[1] <= CHUNK:
+            print("✅ PASS: Value never buffered beyond one chunk\n")
+        else:
+            print("❌ FAIL: Streamed value wrong\n")
+            ok = False
+
+        # Test 3: Plain write/read of big values
+        print("Test 3: faststorage_write/read of 3 MB values")
+        bigs = {f"big_{i}": pattern(i, 3 * MB + i) for i in range(4)}
+        failures = sum(lib.faststorage_write(fs, k.encode(), v, len(v)) != 0
+                       for k, v in bigs.items())
+        matches = sum(read(lib, fs, k, 4 * MB) == v for k, v in bigs.items())
+        small_buffer = read(lib, fs, "big_0", MB) is None
+        print(f"✓ {failures} failed writes, {matches}/4 read back, "
+              f"short buffer rejected={small_buffer}")
+        if failures == 0 and matches == 4 and small_buffer:
+            print("✅ PASS: Chunking transparent to the plain API\n")
+        else:
+            print("❌ FAIL: Large values broken\n")
+            ok = False
+
+        # Test 4: Aborted stream
+        print("Test 4: Source aborts halfway")
+        def failing(ctx, buf, length):
+            failing.sent += length
+            return length if failing.sent < 2 * MB else 0
+        failing.sent = 0
+        result = lib.faststorage_write_stream(fs, b'big_1', 4 * MB, SOURCE(failing), None)
+        kept = read(lib, fs, "big_1", 4 * MB) == bigs["big_1"]
+        print(f"✓ stream -> {result}, old value kept={kept}")
+        if result == -1 and kept:
+            print("✅ PASS: Failed stream left the key alone\n")
+        else:
+            print("❌ FAIL: Aborted stream changed the key\n")
+            ok = False
+
+        # Test 5: Compaction of chunks
+        print("Test 5: Overwrite blobs and compact")
+        for r in range(6):
+            for k in ("big_2", "big_3"):
+                v = pattern(r + 100, 2 * MB + r)
+                lib.faststorage_write(fs, k.encode(), v, len(v))
+                bigs[k] = v
+        lib.faststorage_compact(fs)
+        s = FastStorageStats()
+        lib.faststorage_get_stats(fs, ctypes.byref(s))
+        matches = sum(read(lib, fs, k, 4 * MB) == v for k, v in bigs.items())
+        received[:] = [0, 0, True]
+        stream_ok = lib.faststorage_read_stream(fs, b'tensor', SINK(sink), None) == 0 and \
+            received[0] == STREAM_SIZE and received[2]
+        print(f"✓ {s.compactions} segments compacted, {matches}/4 blobs intact, "
+              f"stream intact={stream_ok}")
+        if s.compactions > 0 and matches == 4 and stream_ok:
+            print("✅ PASS: Chunks moved safely\n")
+        else:
+            print("❌ FAIL: Compaction corrupted a blob\n")
+            ok = False
+        lib.faststorage_destroy(fs)
+
+        # Test 6: Reopen
+        print("Test 6: Reopen")
+        fs = lib.faststorage_create(path.encode(), MB)
+        matches = sum(read(lib, fs, k, 4 * MB) == v for k, v in bigs.items())
+        received[:] = [0, 0, True]
+        stream_ok = lib.faststorage_read_stream(fs, b'tensor', SINK(sink), None) == 0 and \
+            received[0] == STREAM_SIZE and received[2]
+        old = all(read(lib, fs, k) == v for k, v in items)
+        print(f"✓ {matches}/4 blobs, stream intact={stream_ok}, v2 keys intact={old}")
+        if matches == 4 and stream_ok and old:
+            print("✅ PASS: Large values persisted\n")
+        else:
+            print("❌ FAIL: Data lost on reopen\n")
+            ok = False
+        lib.faststorage_destroy(fs)
+
+    print("=== Test Summary ===")
+    print("✅ All large value checks passed" if ok else "❌ Some checks failed")
+    return 0 if ok else 1
+
+if __name__ == '__main__':
+    sys.exit(main())
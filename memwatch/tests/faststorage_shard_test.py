@@ -0,0 +1,260 @@
+#!/usr/bin/env python3
+"""
+FastStorage Shard Test - memwatch
+
+faststorage_create_sharded() spreads keys by hash over independent store
+files, and plain reads take no lock, retrying when a write overlapped
+them. Verifies that:
+1. Every call routes to the key's shard, and keys spread evenly
+2. Count, stats and maintenance calls cover all shards
+3. A sharded store reopens intact, and only with its own shard count
+4. Views taken through the sharded handle release through it
+5. Lock-free readers never see a torn value under concurrent writers
+6. The Python binding opens sharded stores
+"""
+
+import sys
+import os
+import ctypes
+import struct
+import subprocess
+import tempfile
+import threading
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+LIBRARY = os.path.join(ROOT, 'build', 'libfaststorage.so')
+sys.path.insert(0, os.path.join(ROOT, 'python'))
+
+MB = 1024 * 1024
+SHARDS = 8
+NUM_KEYS = 4000
+ROUNDS = 30
+
+class FastStorageStats(ctypes.Structure):
+    _fields_ = [(name, ctypes.c_uint64) for name in (
+        'total_reads', 'total_writes', 'total_deletes', 'cache_hits',
+        'cache_misses', 'compactions', 'growth_count', 'rehash_count',
+        'reclaimed_bytes', 'sync_count', 'dropped_records')]
+
+class View(ctypes.Structure):
+    _fields_ = [('ptr', ctypes.c_void_p), ('len', ctypes.c_size_t), ('token', ctypes.c_uint64)]
+
+def load():
+    lib = ctypes.CDLL(LIBRARY)
+    lib.faststorage_create.restype = ctypes.c_void_p
+    lib.faststorage_create.argtypes = [ctypes.c_char_p, ctypes.c_size_t]
+    lib.faststorage_create_sharded.restype = ctypes.c_void_p
+    lib.faststorage_create_sharded.argtypes = [ctypes.c_char_p, ctypes.c_size_t, ctypes.c_uint32]
+    lib.faststorage_destroy.argtypes = [ctypes.c_void_p]
+    lib.faststorage_write.argtypes = [ctypes.c_void_p, ctypes.c_char_p,
+                                      ctypes.c_char_p, ctypes.c_size_t]
+    lib.faststorage_read.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_char_p,
+                                     ctypes.POINTER(ctypes.c_size_t)]
+    lib.faststorage_size.restype = ctypes.c_ssize_t
+    lib.faststorage_size.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+    lib.faststorage_exists.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+    lib.faststorage_delete.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+    lib.faststorage_get_view.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.POINTER(View)]
+    lib.faststorage_release_view.argtypes = [ctypes.c_void_p, ctypes.POINTER(View)]
+    lib.faststorage_compact.argtypes = [ctypes.c_void_p]
+    lib.faststorage_flush.argtypes = [ctypes.c_void_p]
+    lib.faststorage_count.restype = ctypes.c_size_t
+    lib.faststorage_count.argtypes = [ctypes.c_void_p]
+    lib.faststorage_capacity.restype = ctypes.c_size_t
+    lib.faststorage_capacity.argtypes = [ctypes.c_void_p]
+    lib.faststorage_get_stats.argtypes = [ctypes.c_void_p, ctypes.POINTER(FastStorageStats)]
+    lib.faststorage_reset_stats.argtypes = [ctypes.c_void_p]
+    return lib
+
+def read(lib, fs, key, capacity=4096):
+    buf = ctypes.create_string_buffer(capacity)
+    size = ctypes.c_size_t(capacity)
+    if lib.faststorage_read(fs, key.encode(), buf, ctypes.byref(size)) != 0:
+        return None
+    return buf.raw[:size.value]
+
+def write(lib, fs, key, value):
+    return lib.faststorage_write(fs, key.encode(), value, len(value))
+
+def stats(lib, fs):
+    s = FastStorageStats()
+    lib.faststorage_get_stats(fs, ctypes.byref(s))
+    return s
+
+def value_of(key, round_):
+    """Self-describing value: a torn read can't pass for a whole one"""
+    head = b'%d:%d:' % (key, round_)
+    return head + bytes((key * 31 + round_ * 7 + i) & 0xFF for i in range(64 + (key + round_) % 700))
+
+def intact(key, value):
+    try:
+        k, r = map(int, value.split(b':')[:2])
+    except ValueError:
+        return False
+    return k == key and value == value_of(k, r)
+
+def shard_header(path, i):
+    """(num_entries, shards) from a shard file's header"""
+    with open(f"{path}.{i}", 'rb') as f:
+        header = f.read(48)
+    return struct.unpack_from('<I', header, 24)[0], struct.unpack_from('<I', header, 44)[0]
+
+def main():
+    print("=== FastStorage Shard Test ===\n")
+
+    if not os.path.exists(LIBRARY):
+        subprocess.run(['make', '-C', ROOT, 'build-faststorage'], capture_output=True)
+    if not os.path.exists(LIBRARY):
+        print("libfaststorage.so not built (make build-faststorage) - skipping\n")
+        return 0
+
+    lib = load()
+    ok = True
+    with tempfile.TemporaryDirectory() as tmp:
+        path = os.path.join(tmp, 'sharded.fs')
+        fs = lib.faststorage_create_sharded(path.encode(), SHARDS * MB, SHARDS)
+
+        # Test 1: Routing
+        print(f"Test 1: {NUM_KEYS} keys over {SHARDS} shards")
+        failures = sum(write(lib, fs, f"key_{k}", value_of(k, 0)) != 0 for k in range(NUM_KEYS))
+        matches = sum(read(lib, fs, f"key_{k}") == value_of(k, 0) for k in range(NUM_KEYS))
+        sized = all(lib.faststorage_size(fs, f"key_{k}".encode()) == len(value_of(k, 0))
+                    for k in range(0, NUM_KEYS, 7))
+        deleted = all(lib.faststorage_delete(fs, f"key_{k}".encode()) == 0 for k in range(0, NUM_KEYS, 10))
+        exists = [lib.faststorage_exists(fs, f"key_{k}".encode()) for k in (0, 1)]
+        live = NUM_KEYS - len(range(0, NUM_KEYS, 10))
+        lib.faststorage_flush(fs)
+        per_shard = [shard_header(path, i)[0] for i in range(SHARDS)]
+        even = min(per_shard) > live / SHARDS / 2 and max(per_shard) < live / SHARDS * 2
+        print(f"✓ {failures} failed writes, {matches}/{NUM_KEYS} read back, sizes ok={sized}, "
+              f"exists after delete {exists}, per shard {per_shard}")
+        if failures == 0 and matches == NUM_KEYS and sized and deleted and exists == [0, 1] and \
+                sum(per_shard) == live and even:
+            print("✅ PASS: Keys routed to one shard each, evenly\n")
+        else:
+            print("❌ FAIL: Routing broken\n")
+            ok = False
+
+        # Test 2: Whole-store calls
+        print("Test 2: count / capacity / stats / compact over all shards")
+        lib.faststorage_reset_stats(fs)
+        for r in range(1, 6):
+            for k in range(1, NUM_KEYS, 10):
+                write(lib, fs, f"key_{k}", value_of(k, r))
+        reads = sum(read(lib, fs, f"key_{k}") is not None for k in range(1, NUM_KEYS, 10))
+        compact = lib.faststorage_compact(fs)
+        s = stats(lib, fs)
+        count = lib.faststorage_count(fs)
+        capacity = lib.faststorage_capacity(fs)
+        print(f"✓ count {count}, capacity {capacity // MB} MB, {s.total_writes} writes, "
+              f"{s.total_reads} reads counted, compact -> {compact}")
+        if count == live and capacity >= SHARDS * MB and s.total_writes == 5 * len(range(1, NUM_KEYS, 10)) \
+                and s.total_reads == reads and compact == 0:
+            print("✅ PASS: Aggregates cover every shard\n")
+        else:
+            print("❌ FAIL: Aggregates wrong\n")
+            ok = False
+        lib.faststorage_destroy(fs)
+
+        # Test 3: Reopen
+        print("Test 3: Reopen with the same and with other shard counts")
+        fs = lib.faststorage_create_sharded(path.encode(), SHARDS * MB, SHARDS)
+        expect = {k: value_of(k, 5 if k % 10 == 1 else 0) for k in range(NUM_KEYS) if k % 10}
+        kept = fs and all(read(lib, fs, f"key_{k}") == v for k, v in expect.items())
+        recorded = {shard_header(path, i)[1] for i in range(SHARDS)}
+        other = lib.faststorage_create_sharded(path.encode(), SHARDS * MB, SHARDS // 2)
+        plain = lib.faststorage_create(f"{path}.0".encode(), MB)
+        print(f"✓ reopened intact={kept}, shard count on disk {recorded}, "
+              f"{SHARDS // 2}-shard open refused={not other}, plain open refused={not plain}")
+        if kept and recorded == {SHARDS} and not other and not plain:
+            print("✅ PASS: Shard set reopened, mismatches refused\n")
+        else:
+            print("❌ FAIL: Shard set not persistent\n")
+            ok = False
+        for handle in (other, plain):
+            if handle:
+                lib.faststorage_destroy(handle)
+
+        # Test 4: Views
+        print("Test 4: Views through the sharded handle")
+        views = []
+        for k in range(1, 200, 10):
+            v = View()
+            if lib.faststorage_get_view(fs, f"key_{k}".encode(), ctypes.byref(v)) == 0:
+                views.append((k, v))
+        shards_seen = {(v.token >> 24) & 0xFF for _, v in views}
+        contents_ok = all(ctypes.string_at(v.ptr, v.len) == expect[k] for k, v in views)
+        token = views[0][1].token
+        released = all(lib.faststorage_release_view(fs, ctypes.byref(v)) == 0 for _, v in views)
+        stale = View(0, 0, token)
+        again = lib.faststorage_release_view(fs, ctypes.byref(stale))
+        print(f"✓ {len(views)} views over shards {sorted(shards_seen)}, intact={contents_ok}, "
+              f"released={released}, stale release -> {again}")
+        if len(views) == 20 and len(shards_seen) > 1 and contents_ok and released and again == -1:
+            print("✅ PASS: View tokens carry their shard\n")
+        else:
+            print("❌ FAIL: Sharded views broken\n")
+            ok = False
+
+        # Test 5: Concurrent readers and writers
+        print(f"Test 5: 2 writers x {ROUNDS} rounds against 3 lock-free readers")
+        stop = threading.Event()
+        torn = []
+        seen = [0]
+        def reader():
+            while not stop.is_set():
+                for k in range(1, NUM_KEYS, 3):
+                    value = read(lib, fs, f"key_{k}")
+                    if value is None:
+                        continue
+                    seen[0] += 1
+                    if not intact(k, value):
+                        torn.append((k, value[:16]))
+        def writer(first):
+            for r in range(1, ROUNDS + 1):
+                for k in range(first, NUM_KEYS, 2):
+                    write(lib, fs, f"key_{k}", value_of(k, r))
+        readers = [threading.Thread(target=reader) for _ in range(3)]
+        writers = [threading.Thread(target=writer, args=(i,)) for i in range(2)]
+        for t in readers + writers:
+            t.start()
+        for t in writers:
+            t.join()
+        stop.set()
+        for t in readers:
+            t.join()
+        final = sum(read(lib, fs, f"key_{k}") == value_of(k, ROUNDS) for k in range(NUM_KEYS))
+        s = stats(lib, fs)
+        print(f"✓ {seen[0]} concurrent reads, {len(torn)} torn, {final}/{NUM_KEYS} final values, "
+              f"{s.compactions} compactions, {s.growth_count} growths")
+        if not torn and final == NUM_KEYS and seen[0] > 0:
+            print("✅ PASS: Every read saw a whole value\n")
+        else:
+            print("❌ FAIL: Torn or lost values\n")
+            ok = False
+        lib.faststorage_destroy(fs)
+
+        # Test 6: Python binding
+        print("Test 6: memwatch.faststorage with shards")
+        os.environ.setdefault('MEMWATCH_FASTSTORAGE_LIB', LIBRARY)
+        from memwatch.faststorage import FastStorage
+        py_path = os.path.join(tmp, 'py.fs')
+        with FastStorage(py_path, 4 * MB, shards=4) as store:
+            for i in range(100):
+                store.write(f"frame_{i}", b'%d' % i * 10)
+            count = len(store)
+            back = all(store.read(f"frame_{i}") == b'%d' % i * 10 for i in range(100))
+        files = sorted(f for f in os.listdir(tmp) if f.startswith('py.fs.'))
+        print(f"✓ {count} entries, read back={back}, files {files}")
+        if count == 100 and back and files == [f"py.fs.{i}" for i in range(4)]:
+            print("✅ PASS: Python opens sharded stores\n")
+        else:
+            print("❌ FAIL: Python sharding broken\n")
+            ok = False
+
+    print("=== Test Summary ===")
+    print("✅ All shard checks passed" if ok else "❌ Some checks failed")
+    return 0 if ok else 1
+
+if __name__ == '__main__':
+    sys.exit(main())
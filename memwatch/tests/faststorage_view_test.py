@@ -0,0 +1,240 @@
+#!/usr/bin/env python3
+"""
+FastStorage View Test - memwatch
+
+faststorage_get_view() returns a pointer straight into the store; epochs
+keep that memory in place until the view is released. Verifies that:
+1. Inline and chunked values are viewed in place (file-backed pages, no copy)
+2. A view outlives overwrites and the compaction of its segment
+3. A view outlives a growth that has to move the mapping
+4. Held-back segments are freed after release
+5. Views can't be released twice
+6. The Python binding exposes views as read-only memoryviews
+"""
+
+import sys
+import os
+import ctypes
+import mmap
+import struct
+import subprocess
+import tempfile
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+LIBRARY = os.path.join(ROOT, 'build', 'libfaststorage.so')
+sys.path.insert(0, os.path.join(ROOT, 'python'))
+
+MB = 1024 * 1024
+NUM_KEYS = 200
+VALUE_SIZE = 1024
+PROT_NONE = 0
+MAP_FIXED_NOREPLACE = 0x100000
+
+class FastStorageStats(ctypes.Structure):
+    _fields_ = [(name, ctypes.c_uint64) for name in (
+        'total_reads', 'total_writes', 'total_deletes', 'cache_hits',
+        'cache_misses', 'compactions', 'growth_count', 'rehash_count',
+        'reclaimed_bytes', 'sync_count', 'dropped_records')]
+
+class View(ctypes.Structure):
+    _fields_ = [('ptr', ctypes.c_void_p), ('len', ctypes.c_size_t), ('token', ctypes.c_uint64)]
+
+class StoreHead(ctypes.Structure):
+    """Leading fields of FastStorageImpl"""
+    _fields_ = [('fd', ctypes.c_int), ('mmap_ptr', ctypes.c_void_p), ('file_size', ctypes.c_size_t)]
+
+def load():
+    lib = ctypes.CDLL(LIBRARY)
+    lib.faststorage_create.restype = ctypes.c_void_p
+    lib.faststorage_create.argtypes = [ctypes.c_char_p, ctypes.c_size_t]
+    lib.faststorage_destroy.argtypes = [ctypes.c_void_p]
+    lib.faststorage_write.argtypes = [ctypes.c_void_p, ctypes.c_char_p,
+                                      ctypes.c_char_p, ctypes.c_size_t]
+    lib.faststorage_get_view.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.POINTER(View)]
+    lib.faststorage_release_view.argtypes = [ctypes.c_void_p, ctypes.POINTER(View)]
+    lib.faststorage_compact.argtypes = [ctypes.c_void_p]
+    lib.faststorage_get_stats.argtypes = [ctypes.c_void_p, ctypes.POINTER(FastStorageStats)]
+    lib.faststorage_reset_stats.argtypes = [ctypes.c_void_p]
+    return lib
+
+def get_view(lib, fs, key):
+    view = View()
+    if lib.faststorage_get_view(fs, key.encode(), ctypes.byref(view)) != 0:
+        return None
+    return view
+
+def contents(view):
+    return ctypes.string_at(view.ptr, view.len) if view.len else b''
+
+def write(lib, fs, key, value):
+    return lib.faststorage_write(fs, key.encode(), value, len(value))
+
+def stats(lib, fs):
+    s = FastStorageStats()
+    lib.faststorage_get_stats(fs, ctypes.byref(s))
+    return s
+
+def mapping_of(address):
+    """(start, end, path) of the mapping holding address"""
+    with open('/proc/self/maps') as f:
+        for line in f:
+            fields = line.split()
+            start, end = (int(x, 16) for x in fields[0].split('-'))
+            if start <= address < end:
+                return start, end, fields[5] if len(fields) > 5 else ''
+    return None
+
+def value_of(key, round_):
+    return (b'%d:%d:' % (key, round_)).ljust(VALUE_SIZE, b'#')
+
+def pattern(seed, size):
+    block = bytes((seed * 31 + i * 7) & 0xFF for i in range(4096))
+    return (block * (size // len(block) + 1))[:size]
+
+def main():
+    print("=== FastStorage View Test ===\n")
+
+    if not os.path.exists(LIBRARY):
+        subprocess.run(['make', '-C', ROOT, 'build-faststorage'], capture_output=True)
+    if not os.path.exists(LIBRARY):
+        print("libfaststorage.so not built (make build-faststorage) - skipping\n")
+        return 0
+
+    lib = load()
+    ok = True
+    with tempfile.TemporaryDirectory() as tmp:
+        path = os.path.join(tmp, 'view.fs')
+        fs = lib.faststorage_create(path.encode(), MB)
+
+        # Test 1: In-place views
+        print("Test 1: View an inline and a 3 MB chunked value")
+        small = b'replay frame 0'
+        big = pattern(3, 3 * MB + 123)
+        write(lib, fs, "small", small)
+        write(lib, fs, "big", big)
+        inline, blob = get_view(lib, fs, "small"), get_view(lib, fs, "big")
+        missing = get_view(lib, fs, "nope") is None
+        in_file = [mapping_of(v.ptr)[2] == os.path.realpath(path) for v in (inline, blob)]
+        print(f"✓ inline {contents(inline) == small}, blob {contents(blob) == big}, "
+              f"file-backed {in_file}, missing key -> None {missing}")
+        if contents(inline) == small and contents(blob) == big and all(in_file) and missing:
+            print("✅ PASS: Views point at the stored pages\n")
+        else:
+            print("❌ FAIL: Views wrong or copied\n")
+            ok = False
+
+        # Test 2: Overwrite + compaction under live views
+        print("Test 2: Rewrite every key 300 times while views are held")
+        lib.faststorage_reset_stats(fs)
+        for k in range(NUM_KEYS):
+            write(lib, fs, f"key_{k}", value_of(k, 0))
+        held = [get_view(lib, fs, f"key_{k}") for k in range(0, NUM_KEYS, 10)]
+        for r in range(1, 300):
+            for k in range(NUM_KEYS):
+                write(lib, fs, f"key_{k}", value_of(k, r))
+        write(lib, fs, "big", pattern(4, 2 * MB))
+        write(lib, fs, "small", b'replay frame 1')
+        lib.faststorage_compact(fs)
+        s = stats(lib, fs)
+        intact = all(contents(v) == value_of(k, 0) for v, k in zip(held, range(0, NUM_KEYS, 10)))
+        print(f"✓ {s.compactions} segments compacted, {s.reclaimed_bytes} bytes punched, "
+              f"held views intact={intact}, blob intact={contents(blob) == big}, "
+              f"inline intact={contents(inline) == small}")
+        if s.compactions > 0 and s.reclaimed_bytes == 0 and intact and \
+                contents(blob) == big and contents(inline) == small:
+            print("✅ PASS: Compaction retired segments instead of punching them\n")
+        else:
+            print("❌ FAIL: A view saw its bytes move\n")
+            ok = False
+
+        # Test 3: Growth that must move the mapping
+        print("Test 3: Grow the file with the address space behind it taken")
+        head = StoreHead.from_address(fs)
+        old_base, old_size = head.mmap_ptr, head.file_size
+        libc = ctypes.CDLL(None, use_errno=True)
+        libc.mmap.restype = ctypes.c_void_p
+        libc.mmap.argtypes = [ctypes.c_void_p, ctypes.c_size_t, ctypes.c_int, ctypes.c_int,
+                              ctypes.c_int, ctypes.c_long]
+        libc.munmap.argtypes = [ctypes.c_void_p, ctypes.c_size_t]
+        blocker = libc.mmap(old_base + old_size, mmap.PAGESIZE, PROT_NONE,
+                            mmap.MAP_PRIVATE | mmap.MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0)
+        inline_old = get_view(lib, fs, "small")       # points into the current mapping
+        i = 0
+        while head.mmap_ptr == old_base and i < 2 * old_size // VALUE_SIZE:
+            write(lib, fs, f"fill_{i}", value_of(i, 0))
+            i += 1
+        moved = head.mmap_ptr != old_base
+        old_mapped = mapping_of(old_base) is not None
+        print(f"✓ mapping moved={moved}, {head.file_size // MB} MB, old mapping kept={old_mapped}, "
+              f"view intact={contents(inline_old) == b'replay frame 1'}")
+        if moved and old_mapped and contents(inline_old) == b'replay frame 1':
+            print("✅ PASS: Old mapping kept, not unmapped\n")
+        else:
+            print("❌ FAIL: Growth invalidated a view\n")
+            ok = False
+
+        # Test 4: Release frees what the views held
+        print("Test 4: Release every view, then compact")
+        for v in held + [inline, blob, inline_old]:
+            lib.faststorage_release_view(fs, ctypes.byref(v))
+        lib.faststorage_compact(fs)
+        s = stats(lib, fs)
+        print(f"✓ {s.reclaimed_bytes // MB} MB punched")
+        if s.reclaimed_bytes >= s.compactions * MB and s.reclaimed_bytes > 0:
+            print("✅ PASS: Retired memory reclaimed\n")
+        else:
+            print("❌ FAIL: Retired memory leaked\n")
+            ok = False
+        if blocker not in (None, ctypes.c_void_p(-1).value):
+            libc.munmap(blocker, mmap.PAGESIZE)
+
+        # Test 5: Double release
+        print("Test 5: Release a view twice")
+        v = get_view(lib, fs, "key_0")
+        token = v.token
+        first = lib.faststorage_release_view(fs, ctypes.byref(v))
+        v.token = token
+        second = lib.faststorage_release_view(fs, ctypes.byref(v))
+        print(f"✓ first -> {first}, second -> {second}")
+        if first == 0 and second == -1:
+            print("✅ PASS: Stale token rejected\n")
+        else:
+            print("❌ FAIL: View released twice\n")
+            ok = False
+        lib.faststorage_destroy(fs)
+
+        # Test 6: Python binding
+        print("Test 6: memwatch.faststorage memoryviews")
+        os.environ.setdefault('MEMWATCH_FASTSTORAGE_LIB', LIBRARY)
+        from memwatch.faststorage import FastStorage
+        with FastStorage(os.path.join(tmp, 'py.fs')) as store:
+            store.write("frame", b'pixels' * 1000)
+            store.write("tensor", pattern(9, MB))
+            view = store.view("frame")
+            readonly = view.memory.readonly
+            head = bytes(view.memory[:6])
+            reader = struct.iter_unpack('6s', view.memory)
+            try:
+                view.release()
+                busy = False
+            except BufferError:
+                busy = True
+            first = next(reader)[0]
+            del reader
+            view.release()
+            with store.view("tensor") as memory:
+                tensor_ok = memory == pattern(9, MB)
+            print(f"✓ readonly={readonly} head={head!r} release while exported refused={busy} "
+                  f"tensor intact={tensor_ok} missing={store.view('nope')}")
+            if readonly and head == b'pixels' == first and busy and tensor_ok and store.view('nope') is None:
+                print("✅ PASS: Zero-copy memoryviews\n")
+            else:
+                print("❌ FAIL: Python views broken\n")
+                ok = False
+
+    print("=== Test Summary ===")
+    print("✅ All view checks passed" if ok else "❌ Some checks failed")
+    return 0 if ok else 1
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,292 @@
+#!/usr/bin/env python3
+"""
+Overhead Governor Test - memwatch
+
+MEMWATCH_MODE / MemoryWatcher(mode=...) sets a CPU budget (lite 5%,
+balanced 30%, deep 100% of one CPU) that the governor enforces by moving
+the costliest regions down a ladder - preview, hash, longer writable
+windows, periodic sampling - and back up once they cool. Verifies that:
+1. A region over budget is demoted level by level until the total fits
+2. A cooled region climbs back to full, one level per cool period
+3. A region demoted again right after a promotion waits twice as long
+4. Mode off returns every region to full at once, and the log keeps the
+   last decisions oldest first
+5. End to end: hot pages in lite mode are demoted within budget, keep
+   reporting changes, and are promoted once writes stop
+6. set_mode('off') restores full tracing; unknown modes are rejected
+"""
+
+import sys
+import os
+import re
+import subprocess
+import tempfile
+import time
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+sys.path.insert(0, os.path.join(ROOT, 'python'))
+
+TICK_PROGRAM = r'''
+#include <stdio.h>
+#include <string.h>
+#include "memwatch_governor.h"
+
+#define MS 1000000ULL
+#define QUIET 3
+
+static mw_governor_t g;
+static mw_gov_region_t hot, quiet[QUIET];
+static mw_gov_ref_t refs[QUIET + 1];
+static unsigned applied;
+
+static void on_apply(uint32_t id, mw_gov_region_t *s, mw_gov_level_t from, void *ctx) {
+    (void)id; (void)s; (void)from; (void)ctx;
+    applied++;
+}
+
+/* One interval: the hot region is written 5000 times a window-length apart */
+static size_t tick(int hot_writes, uint64_t *now) {
+    if (hot_writes) {
+        if (mw_gov_sampled((mw_gov_level_t)hot.level)) {
+            mw_gov_charge(&hot, 1, 20000);  /* one changed sample */
+        } else {
+            uint64_t period = mw_gov_window_ns((mw_gov_level_t)hot.level, g.window_ns);
+            uint32_t faults = (uint32_t)(5000 * g.window_ns / period);
+            mw_gov_charge(&hot, faults, faults * g.fault_cost_ns);
+        }
+    }
+    for (int i = 0; i < QUIET; i++) mw_gov_charge(&quiet[i], 10, 10 * g.fault_cost_ns + 1000);
+    refs[0] = (mw_gov_ref_t){ &hot, 1 };
+    for (int i = 0; i < QUIET; i++) refs[i + 1] = (mw_gov_ref_t){ &quiet[i], (uint32_t)(i + 2) };
+    *now += 100 * MS;
+    return mw_governor_tick(&g, refs, QUIET + 1, *now, on_apply, NULL);
+}
+
+int main(void) {
+    uint64_t now = 0;
+    mw_governor_init(&g, MW_GOV_LITE, 100 * MS, 5 * MS, 4000);
+    printf("budget=%llu\n", (unsigned long long)g.budget_ns);
+
+    /* Hot until the total fits */
+    int ticks = 0;
+    while (g.last_cost_ns == 0 || g.last_cost_ns > g.budget_ns) {
+        tick(1, &now);
+        if (++ticks > 20) break;
+    }
+    tick(1, &now);
+    int quiet_demoted = 0;
+    for (int i = 0; i < QUIET; i++) quiet_demoted += quiet[i].level != MW_GOV_FULL;
+    printf("hot_level=%u demote_ticks=%d within=%d quiet_demoted=%d demotions=%llu applied=%u\n",
+           hot.level, ticks, g.last_cost_ns <= g.budget_ns, quiet_demoted,
+           (unsigned long long)g.demotions, applied);
+
+    /* Cool: one level per cool_needed intervals */
+    unsigned start = hot.level;
+    int cool_ticks = 0;
+    while (hot.level != MW_GOV_FULL && cool_ticks < 1000) {
+        tick(0, &now);
+        cool_ticks++;
+    }
+    printf("promote_ticks=%d levels=%u promotions=%llu cool_needed=%u\n", cool_ticks, start,
+           (unsigned long long)g.promotions, hot.cool_needed);
+
+    /* Hot again right after the promotion: the next cool-down doubles */
+    tick(1, &now);
+    printf("redemoted=%u cool_needed2=%u\n", hot.level, hot.cool_needed);
+
+    /* Mode off: straight back to full */
+    for (int i = 0; i < 3; i++) tick(1, &now);
+    unsigned before_off = hot.level;
+    mw_governor_set_mode(&g, MW_GOV_OFF);
+    size_t reset = tick(1, &now);
+    printf("before_off=%u reset=%zu after_off=%u demoted=%u budget_off=%llu\n", before_off, reset,
+           hot.level, g.demoted, (unsigned long long)g.budget_ns);
+
+    mw_gov_decision_t log[MW_GOV_LOG_SIZE];
+    size_t n = mw_governor_decisions(&g, log, MW_GOV_LOG_SIZE);
+    int ordered = 1;
+    for (size_t i = 1; i < n; i++) ordered &= log[i].time_ns >= log[i - 1].time_ns;
+    printf("logged=%zu total=%llu ordered=%d last_reason=%d\n", n,
+           (unsigned long long)g.logged, ordered, n ? log[n - 1].reason : -1);
+
+    mw_gov_mode_t mode;
+    int lite = mw_gov_mode_parse("lite", &mode) == 0 && mode == MW_GOV_LITE;
+    int none = mw_gov_mode_parse(NULL, &mode) == 0 && mode == MW_GOV_OFF;
+    int bad = mw_gov_mode_parse("turbo", &mode);
+    printf("parse_lite=%d parse_null=%d parse_bad=%d cap_full=%d cap_preview=%d cap_hash=%d\n",
+           lite, none, bad,
+           mw_gov_capture(MW_GOV_FULL, -1), mw_gov_capture(MW_GOV_PREVIEW, -1),
+           mw_gov_capture(MW_GOV_HASH, 64));
+    return 0;
+}
+'''
+
+def values(stdout):
+    out = {}
+    for line in stdout.splitlines():
+        for key, value in re.findall(r'([a-z_0-9]+)=(-?\d+)', line):
+            out.setdefault(key, int(value))
+    return out
+
+def check_python():
+    try:
+        from memwatch import MemoryWatcher
+        import memwatch
+    except ImportError:
+        return None
+    if not getattr(memwatch, '_native', None):
+        return None
+    return MemoryWatcher, memwatch._native
+
+def hammer(buffers, seconds):
+    deadline = time.time() + seconds
+    rounds = 0
+    while time.time() < deadline:
+        for buf in buffers:
+            buf[0] = (buf[0] + 1) & 0xff
+        rounds += 1
+    return rounds
+
+def main():
+    print("=== memwatch Overhead Governor Test ===\n")
+
+    ok = True
+    with tempfile.TemporaryDirectory() as tmp:
+        source = os.path.join(tmp, 'tick.c')
+        binary = os.path.join(tmp, 'tick')
+        with open(source, 'w') as f:
+            f.write(TICK_PROGRAM)
+        build = subprocess.run(['gcc', '-O2', '-Wall', '-I', os.path.join(ROOT, 'include'), '-o', binary,
+                                source, os.path.join(ROOT, 'src/memwatch_governor.c')],
+                               capture_output=True, text=True)
+        if build.returncode != 0:
+            print("❌ FAIL: governor program did not build\n")
+            print(build.stderr[-800:])
+            return 1
+        v = values(subprocess.run([binary], capture_output=True, text=True, timeout=60).stdout)
+
+    # Test 1: Demotion
+    print("Test 1: One region at 4x the lite budget")
+    print(f"✓ budget={v.get('budget')} ns, hot at level {v.get('hot_level')} after "
+          f"{v.get('demote_ticks')} intervals, {v.get('demotions')} demotions")
+    if v.get('budget') == 5000000 and v.get('within') == 1 and v.get('quiet_demoted') == 0 and \
+            v.get('hot_level', 0) >= 3 and v.get('demotions') == v.get('hot_level') and \
+            v.get('applied') == v.get('demotions'):
+        print("✅ PASS: Only the hot region stepped down, total within budget\n")
+    else:
+        print("❌ FAIL: Unexpected demotions\n")
+        ok = False
+
+    # Test 2: Promotion
+    print("Test 2: Writes stop")
+    print(f"✓ back to full after {v.get('promote_ticks')} intervals from level {v.get('levels')}")
+    if v.get('promotions') == v.get('levels') and \
+            v.get('promote_ticks') == v.get('levels', 0) * v.get('cool_needed', 0) and \
+            v.get('cool_needed') == 10:
+        print("✅ PASS: One level per 10 cool intervals\n")
+    else:
+        print("❌ FAIL: Unexpected promotions\n")
+        ok = False
+
+    # Test 3: Backoff
+    print("Test 3: Hot again right after the promotion")
+    print(f"✓ level {v.get('redemoted')}, cool_needed {v.get('cool_needed2')}")
+    if v.get('redemoted') == 1 and v.get('cool_needed2') == 20:
+        print("✅ PASS: Cool-down doubled\n")
+    else:
+        print("❌ FAIL: No backoff\n")
+        ok = False
+
+    # Test 4: Mode off, decision log, helpers
+    print("Test 4: Mode off and the decision log")
+    print(f"✓ level {v.get('before_off')} -> {v.get('after_off')} in {v.get('reset')} decision(s); "
+          f"log {v.get('logged')} of {v.get('total')}")
+    if v.get('before_off', 0) > 0 and v.get('reset') == 1 and v.get('after_off') == 0 and \
+            v.get('demoted') == 0 and v.get('budget_off') == 0 and \
+            v.get('logged') == min(v.get('total', 0), 64) and v.get('ordered') == 1 and \
+            v.get('last_reason') == 2 and v.get('parse_lite') == 1 and v.get('parse_null') == 1 and \
+            v.get('parse_bad') == -1 and v.get('cap_full') == -1 and v.get('cap_preview') == 256 and \
+            v.get('cap_hash') == 0:
+        print("✅ PASS: Reset to full, log oldest first\n")
+    else:
+        print("❌ FAIL: Mode off or log wrong\n")
+        ok = False
+
+    # Tests 5-6: the Python core
+    found = check_python()
+    if found is None:
+        print("Native module unavailable - skipping Tests 5-6\n")
+    else:
+        MemoryWatcher, native = found
+        events = []
+        watcher = MemoryWatcher(mode='lite')
+        watcher.set_callback(events.append)
+        buffers = [bytearray(4096) for _ in range(256)]  # one page each
+        for i, buf in enumerate(buffers):
+            watcher.watch(buf, name=f'hot_{i}')
+
+        print("Test 5: 256 hot pages in lite mode")
+        rounds = hammer(buffers, 2.0)
+        gov = watcher.get_stats()['governor']
+        loaded = len(events)
+        over = [d for d in gov['decisions'] if d['reason'] == 'over_budget']
+        print(f"✓ {rounds} rounds, {loaded} events, {gov['demotions']} demotions, "
+              f"overhead {gov['overhead_pct']:.1f}% of {gov['budget_pct']}%")
+        print(f"  levels: { {k: n for k, n in gov['levels'].items() if n} }")
+        demoted_ok = gov['mode'] == 'lite' and gov['demoted_regions'] > 0 and over and \
+            gov['overhead_pct'] <= 2 * gov['budget_pct'] and loaded > 0
+        hammer(buffers, 0.3)
+        time.sleep(0.3)
+        still_reported = len(events) > loaded
+
+        # Cooling: every region climbs back to full
+        deadline = time.time() + 20
+        while time.time() < deadline:
+            gov = watcher.get_stats()['governor']
+            if gov['demoted_regions'] == 0:
+                break
+            time.sleep(0.2)
+        cooled = [d for d in gov['decisions'] if d['reason'] == 'cooled']
+        print(f"✓ after cooling: {gov['demoted_regions']} demoted, {gov['promotions']} promotions, "
+              f"full={gov['levels']['full']}")
+        if demoted_ok and still_reported and gov['demoted_regions'] == 0 and cooled and \
+                gov['promotions'] == gov['demotions'] and gov['levels']['full'] == 256:
+            print("✅ PASS: Demoted under load, still reporting, promoted once cool\n")
+        else:
+            print("❌ FAIL: Governor did not hold the budget or never promoted\n")
+            ok = False
+
+        print("Test 6: set_mode('off') while demoted")
+        hammer(buffers, 1.0)
+        demoted = watcher.get_stats()['governor']['demoted_regions']
+        watcher.set_mode('off')
+        time.sleep(0.3)
+        gov = watcher.get_stats()['governor']
+        reset = [d for d in gov['decisions'] if d['reason'] == 'mode_off']
+        try:
+            watcher.set_mode('turbo')
+            rejected = False
+        except ValueError:
+            rejected = True
+        before = len(events)
+        buffers[0][1] = 7
+        time.sleep(0.1)
+        print(f"✓ {demoted} demoted -> {gov['demoted_regions']}, mode {gov['mode']}, "
+              f"{len(reset)} reset decisions")
+        if demoted > 0 and gov['demoted_regions'] == 0 and gov['mode'] == 'off' and reset and \
+                rejected and len(events) > before:
+            print("✅ PASS: Full tracing restored, bad mode rejected\n")
+        else:
+            print("❌ FAIL: Mode off did not restore full tracing\n")
+            ok = False
+        watcher.stop_all()
+
+    print("=== Test Summary ===")
+    if ok:
+        print("✅ All governor checks passed")
+        return 0
+    print("❌ Some governor checks failed")
+    return 1
+
+if __name__ == '__main__':
+    sys.exit(main())
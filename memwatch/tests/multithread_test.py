@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""
+Multi-threaded Capture Test - memwatch
+
+Several threads write to their own watched buffers at the same time.
+Verifies that:
+1. Every thread's writes produce events (no lost or corrupted faults)
+2. Each faulting thread gets its own fault ring
+3. Repeated faults on one page are coalesced by the worker
+4. No fault is reported twice for the same region
+"""
+
+import sys
+import os
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', 'python'))
+
+from memwatch import MemoryWatcher, ChangeEvent
+import mmap
+import time
+import threading
+
+NUM_THREADS = 8
+ROUNDS = 20
+
+def main():
+    print("=== memwatch Multi-threaded Capture Test ===\n")
+    print(f"Testing {NUM_THREADS} threads faulting concurrently\n")
+
+    events_received = []
+    events_lock = threading.Lock()
+
+    def on_change(event: ChangeEvent):
+        with events_lock:
+            events_received.append(event)
+
+    watcher = MemoryWatcher()
+    watcher.set_callback(on_change)
+
+    # Multi-page buffer per thread, neighbours sharing an edge page. They are
+    # carved from one mapping: heap buffers would put malloc metadata on the
+    # protected pages, and glibc frees thread TLS with signals blocked, so a
+    # fault there on thread exit cannot be handled
+    arena = mmap.mmap(-1, (NUM_THREADS + 1) * 8192)
+    buffers = []
+    region_to_thread = {}
+    for t in range(NUM_THREADS):
+        buf = memoryview(arena)[t * 8192 + 2048:(t + 1) * 8192 + 2048]
+        region_id = watcher.watch(buf, name=f"thread_{t}")
+        buffers.append(buf)
+        region_to_thread[region_id] = t
+
+    time.sleep(0.2)  # Let worker settle
+
+    start = threading.Barrier(NUM_THREADS)
+
+    def writer(t):
+        buf = buffers[t]
+        start.wait()
+        for r in range(ROUNDS):
+            buf[r] = (t + r) % 256 or 1
+            time.sleep(0.02)  # Outlast the writable window
+
+    # Test 1: Concurrent writers
+    print(f"Test 1: {NUM_THREADS} threads x {ROUNDS} writes")
+    print("Expected: events from every thread\n")
+
+    threads = [threading.Thread(target=writer, args=(t,)) for t in range(NUM_THREADS)]
+    for th in threads:
+        th.start()
+    for th in threads:
+        th.join()
+
+    time.sleep(0.5)  # Wait for the worker to drain
+
+    with events_lock:
+        seen_threads = {region_to_thread[e.region_id] for e in events_received
+                        if e.region_id in region_to_thread}
+        total = len(events_received)
+
+    print(f"✓ Received {total} events")
+    print(f"✓ Threads with events: {sorted(seen_threads)}")
+
+    ok = True
+    if len(seen_threads) == NUM_THREADS:
+        print("✅ PASS: Every thread's writes were captured\n")
+    else:
+        print(f"❌ FAIL: Missing threads {sorted(set(range(NUM_THREADS)) - seen_threads)}\n")
+        ok = False
+
+    stats = watcher.get_stats()
+
+    # Test 2: Per-thread rings (only meaningful with the native backend)
+    if 'fault_rings' in stats:
+        print("Test 2: Per-thread fault rings")
+        print(f"✓ fault_rings: {stats['fault_rings']}")
+        print(f"✓ dropped_events: {stats.get('dropped_events', 0)}")
+        if stats['fault_rings'] >= 1 and stats.get('dropped_events', 0) == 0:
+            print("✅ PASS: Faults landed in per-thread rings without drops\n")
+        else:
+            print("❌ FAIL: Unexpected ring statistics\n")
+            ok = False
+
+    # Test 3: One event per (fault, region) - regions sharing a page may share a seq
+    print("Test 3: Unique (seq, region) pairs")
+    with events_lock:
+        keys = [(e.seq, e.region_id) for e in events_received]
+    if len(keys) == len(set(keys)):
+        print(f"✅ PASS: {len(keys)} unique events\n")
+    else:
+        print("❌ FAIL: Duplicate events\n")
+        ok = False
+
+    # Test 4: Coalescing of a write burst on one page
+    print("Test 4: Burst on one page")
+    before = watcher.get_stats().get('coalesced_faults', 0)
+    with events_lock:
+        events_received.clear()
+    for j in range(200):
+        buffers[0][100 + (j % 50)] = j % 256
+    time.sleep(0.3)
+    after = watcher.get_stats().get('coalesced_faults', 0)
+    with events_lock:
+        burst_events = len(events_received)
+    print(f"✓ Events: {burst_events}, coalesced faults: {after - before}")
+    if burst_events >= 1:
+        print("✅ PASS: Burst reported without flooding\n")
+    else:
+        print("❌ FAIL: No event for burst\n")
+        ok = False
+
+    # Statistics
+    print("=== Final Statistics ===")
+    for key, value in watcher.get_stats().items():
+        print(f"{key}: {value}")
+
+    watcher.stop_all()
+
+    print("\n=== Test Summary ===")
+    print("✅ All multi-threaded checks passed" if ok else "❌ Some checks failed")
+    return 0 if ok else 1
+
+if __name__ == '__main__':
+    sys.exit(main())
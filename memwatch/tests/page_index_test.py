@@ -0,0 +1,203 @@
+#!/usr/bin/env python3
+"""
+Page Index Churn Test - memwatch
+
+Tracking and untracking pages leaves tombstones in the page index; once
+they fill half the table it is rebuilt, and the old table must be freed
+as soon as no lock-free reader can still be on it. Verifies that:
+1. Put/remove cycles with nothing live keep the index at one table
+2. Repeated fill-and-drain waves settle at the size the peak needs
+3. Readers hammering the index during rebuilds always find a pinned page,
+   and the old tables are still freed (built with AddressSanitizer when
+   the compiler has it, so a table freed under a reader aborts the run)
+"""
+
+import sys
+import os
+import re
+import subprocess
+import tempfile
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+
+CHURN_PROGRAM = r'''
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "memwatch_page_index.h"
+
+#define PAGE 4096ULL
+#define BASE 0x7f0000000000ULL
+#define CYCLES 200000
+#define WAVES 20
+#define WAVE_PAGES 8192
+#define READERS 4
+
+static mw_page_index_t idx;
+static int pinned_value;
+static const uintptr_t pinned = BASE - PAGE;
+static atomic_bool stop;
+static atomic_ulong lookups, misses;
+
+static void *reader(void *arg) {
+    unsigned long n = 0, missed = 0;
+    uintptr_t page = BASE + (uintptr_t)arg * PAGE;
+    while (!atomic_load(&stop)) {
+        missed += mw_page_index_get(&idx, pinned) != &pinned_value;
+        mw_page_index_get(&idx, page + (n % 4096) * PAGE);  /* churned pages, hit or miss */
+        n++;
+    }
+    atomic_fetch_add(&lookups, n);
+    atomic_fetch_add(&misses, missed);
+    return NULL;
+}
+
+/* One put and one remove per cycle, every cycle a new page: only tombstones pile up */
+static size_t churn(uintptr_t first, size_t cycles) {
+    size_t max = mw_page_index_memory_bytes(&idx);
+    for (size_t i = 0; i < cycles; i++) {
+        uintptr_t page = first + i * PAGE;
+        mw_page_index_put(&idx, page, &pinned_value + 1);
+        mw_page_index_remove(&idx, page);
+        size_t bytes = mw_page_index_memory_bytes(&idx);
+        if (bytes > max) max = bytes;
+    }
+    return max;
+}
+
+int main(void) {
+    /* 1. Churn with nothing live */
+    mw_page_index_init(&idx, MW_PAGE_INDEX_MIN_CAPACITY);
+    size_t initial = mw_page_index_memory_bytes(&idx);
+    size_t max = churn(BASE, CYCLES);
+    printf("churn_initial=%zu churn_max=%zu churn_final=%zu churn_rebuilds=%zu churn_live=%zu\n",
+           initial, max, mw_page_index_memory_bytes(&idx), (size_t)atomic_load(&idx.grow_count),
+           mw_page_index_count(&idx));
+    mw_page_index_destroy(&idx);
+
+    /* 2. Fill and drain in waves */
+    mw_page_index_init(&idx, MW_PAGE_INDEX_MIN_CAPACITY);
+    size_t first_peak = 0, last_peak = 0;
+    for (int w = 0; w < WAVES; w++) {
+        uintptr_t base = BASE + (uintptr_t)w * WAVE_PAGES * PAGE;
+        size_t peak = 0;
+        for (size_t i = 0; i < WAVE_PAGES; i++) {
+            mw_page_index_put(&idx, base + i * PAGE, &pinned_value + 1);
+            size_t bytes = mw_page_index_memory_bytes(&idx);
+            if (bytes > peak) peak = bytes;
+        }
+        for (size_t i = 0; i < WAVE_PAGES; i++) {
+            mw_page_index_remove(&idx, base + i * PAGE);
+        }
+        if (w == 0) first_peak = peak;
+        last_peak = peak;
+    }
+    printf("wave_first_peak=%zu wave_last_peak=%zu wave_final=%zu wave_live=%zu\n",
+           first_peak, last_peak, mw_page_index_memory_bytes(&idx), mw_page_index_count(&idx));
+    mw_page_index_destroy(&idx);
+
+    /* 3. The same churn under concurrent readers */
+    mw_page_index_init(&idx, MW_PAGE_INDEX_MIN_CAPACITY);
+    mw_page_index_put(&idx, pinned, &pinned_value);
+    pthread_t threads[READERS];
+    for (long i = 0; i < READERS; i++) {
+        pthread_create(&threads[i], NULL, reader, (void *)i);
+    }
+    size_t rebuilds_before = atomic_load(&idx.grow_count);
+    max = churn(BASE, CYCLES);
+    atomic_store(&stop, true);
+    for (int i = 0; i < READERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    printf("conc_max=%zu conc_final=%zu conc_rebuilds=%zu conc_lookups=%lu conc_misses=%lu\n",
+           max, mw_page_index_memory_bytes(&idx),
+           (size_t)atomic_load(&idx.grow_count) - rebuilds_before,
+           atomic_load(&lookups), atomic_load(&misses));
+    mw_page_index_destroy(&idx);
+    return 0;
+}
+'''
+
+def values(stdout):
+    out = {}
+    for line in stdout.splitlines():
+        for key, value in re.findall(r'([a-z_0-9]+)=(-?\d+)', line):
+            out.setdefault(key, int(value))
+    return out
+
+def build(source, binary):
+    """With AddressSanitizer if the toolchain has it, plain otherwise"""
+    base = ['gcc', '-O2', '-Wall', '-pthread', '-I', os.path.join(ROOT, 'include'), '-o', binary,
+            source, os.path.join(ROOT, 'src/memwatch_page_index.c')]
+    for extra in (['-fsanitize=address,undefined', '-g'], []):
+        result = subprocess.run(base + extra, capture_output=True, text=True)
+        if result.returncode == 0:
+            return bool(extra), None
+    return False, result.stderr
+
+def main():
+    print("=== memwatch Page Index Churn Test ===\n")
+
+    with tempfile.TemporaryDirectory() as tmp:
+        source = os.path.join(tmp, 'churn.c')
+        binary = os.path.join(tmp, 'churn')
+        with open(source, 'w') as f:
+            f.write(CHURN_PROGRAM)
+        sanitized, error = build(source, binary)
+        if error is not None:
+            print("❌ FAIL: churn program did not build\n")
+            print(error[-800:])
+            return 1
+        run = subprocess.run([binary], capture_output=True, text=True, timeout=300)
+        v = values(run.stdout)
+        if run.returncode != 0:
+            print(f"❌ FAIL: churn program exited with {run.returncode}\n")
+            print(run.stderr[-2000:])
+            return 1
+
+    ok = True
+
+    # Test 1: Churn with nothing live
+    print("Test 1: 200k put/remove cycles, no page left live")
+    print(f"✓ {v.get('churn_rebuilds')} rebuilds, memory {v.get('churn_initial')} -> "
+          f"max {v.get('churn_max')}, final {v.get('churn_final')} bytes")
+    if v.get('churn_rebuilds', 0) > 0 and v.get('churn_live') == 0 and \
+            v.get('churn_max') == v.get('churn_initial') and v.get('churn_final') == v.get('churn_initial'):
+        print("✅ PASS: Rebuilt in place of the old table, never more than one\n")
+    else:
+        print("❌ FAIL: Index memory grew with churn\n")
+        ok = False
+
+    # Test 2: Waves
+    print("Test 2: 20 waves of 8192 pages tracked, then untracked")
+    print(f"✓ peak {v.get('wave_first_peak')} bytes in the first wave, "
+          f"{v.get('wave_last_peak')} in the last, {v.get('wave_final')} after")
+    if v.get('wave_live') == 0 and v.get('wave_last_peak', 1 << 62) <= v.get('wave_first_peak', 0) and \
+            v.get('wave_final', 1 << 62) <= v.get('wave_first_peak', 0):
+        print("✅ PASS: Peak memory does not creep up across waves\n")
+    else:
+        print("❌ FAIL: Each wave left memory behind\n")
+        ok = False
+
+    # Test 3: Concurrent readers
+    print(f"Test 3: The same churn under 4 reader threads{' (ASan)' if sanitized else ''}")
+    print(f"✓ {v.get('conc_lookups')} lookups across {v.get('conc_rebuilds')} rebuilds, "
+          f"{v.get('conc_misses')} missed the pinned page, max {v.get('conc_max')} bytes")
+    if v.get('conc_rebuilds', 0) > 0 and v.get('conc_lookups', 0) > 0 and v.get('conc_misses') == 0 and \
+            v.get('conc_max') == v.get('churn_initial') and v.get('conc_final') == v.get('churn_initial'):
+        print("✅ PASS: Readers never lost the page, old tables still freed\n")
+    else:
+        print("❌ FAIL: Lookups failed or tables were kept\n")
+        ok = False
+
+    print("=== Test Summary ===")
+    if ok:
+        print("✅ All page index checks passed")
+        return 0
+    print("❌ Some page index checks failed")
+    return 1
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,174 @@
+#!/usr/bin/env python3
+"""
+Preload Arena Test - memwatch
+
+LD_PRELOAD=libmemwatch.so with MEMWATCH_AUTO_TRACK=1 serves selected heap
+allocations from a page-isolated arena. Verifies that:
+1. Selected allocations are page aligned
+2. A write to a tracked allocation is reported
+3. free() untracks, so alloc/free cycles reuse tracker slots
+4. realloc() and calloc() keep their contents / zero fill
+5. MEMWATCH_TRACK_SAMPLE tracks one allocation in N
+6. Writing past a tracked block hits its guard page
+"""
+
+import sys
+import os
+import subprocess
+import tempfile
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+LIBRARY = os.path.join(ROOT, 'build', 'libmemwatch.so')
+
+PROGRAM = r'''
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+static int aligned(const void *p) { return ((uintptr_t)p % getpagesize()) == 0; }
+
+int main(int argc, char **argv) {
+    size_t ps = getpagesize();
+    setvbuf(stdout, NULL, _IONBF, 0);
+
+    if (argc > 1 && strcmp(argv[1], "overrun") == 0) {
+        volatile char *block = malloc(ps);
+        block[ps + 8] = 1;          /* one page past a one-page block */
+        return 0;
+    }
+
+    char *big = malloc(2 * ps + 100);
+    char *small = malloc(64);
+    printf("big_aligned=%d\n", aligned(big));
+    usleep(50000);
+    uint64_t marker = 0x1122334455667788ULL;
+    memcpy(big + 64, &marker, sizeof(marker));
+    usleep(100000);
+
+    int cycles_aligned = 0;
+    for (int i = 0; i < 1000; i++) {
+        char *p = malloc(3 * ps);
+        cycles_aligned += aligned(p);
+        p[0] = 1;
+        free(p);
+    }
+    printf("cycles_aligned=%d\n", cycles_aligned);
+
+    big[2 * ps + 99] = 0x5A;
+    char *moved = realloc(big, 6 * ps);
+    printf("realloc_ok=%d\n", aligned(moved) && moved[2 * ps + 99] == 0x5A &&
+           memcmp(moved + 64, &marker, sizeof(marker)) == 0);
+
+    char *zeroed = calloc(3, ps);
+    memset(zeroed, 0xFF, 3 * ps);
+    free(zeroed);
+    zeroed = calloc(3, ps);         /* reuses the dirty slot */
+    int zero = 1;
+    for (size_t i = 0; i < 3 * ps; i++) zero &= zeroed[i] == 0;
+    printf("calloc_zero=%d\n", zero);
+
+    free(zeroed);
+    free(moved);
+    free(small);
+    return 0;
+}
+'''
+
+def run(binary, args=(), **env):
+    full_env = dict(os.environ, LD_PRELOAD=LIBRARY, MEMWATCH_AUTO_TRACK='1', **env)
+    proc = subprocess.run([binary, *args], capture_output=True, text=True,
+                          env=full_env, timeout=60)
+    values = {}
+    for line in proc.stdout.splitlines():
+        key, _, value = line.partition('=')
+        if value.isdigit():
+            values[key] = int(value)
+    return proc, values
+
+def main():
+    print("=== memwatch Preload Arena Test ===\n")
+
+    if not os.path.exists(LIBRARY):
+        subprocess.run(['make', '-C', ROOT, 'build-preload'], capture_output=True)
+    if not os.path.exists(LIBRARY):
+        print("libmemwatch.so not built (make build-preload) - skipping\n")
+        return 0
+
+    ok = True
+    with tempfile.TemporaryDirectory() as tmp:
+        source = os.path.join(tmp, 'arena_prog.c')
+        binary = os.path.join(tmp, 'arena_prog')
+        with open(source, 'w') as f:
+            f.write(PROGRAM)
+        subprocess.run(['gcc', '-O1', source, '-o', binary], check=True)
+        db = os.path.join(tmp, 'arena.db')
+
+        proc, values = run(binary, MEMWATCH_DB=db)
+
+        # Test 1: Placement
+        print("Test 1: Page-aligned placement")
+        print(f"✓ big_aligned={values.get('big_aligned')}")
+        if values.get('big_aligned') == 1:
+            print("✅ PASS: Tracked allocation owns its pages\n")
+        else:
+            print("❌ FAIL: Tracked allocation not page aligned\n")
+            print(proc.stderr[-500:])
+            ok = False
+
+        # Test 2: Change reported
+        print("Test 2: Write to a tracked allocation")
+        reported = [l for l in proc.stdout.splitlines()
+                    if '[TRACKED]' in l and '[64]' in l and '0x1122334455667788' in l]
+        print(f"✓ {len(reported)} matching change lines")
+        if reported:
+            print("✅ PASS: Change detected\n")
+        else:
+            print("❌ FAIL: Change not reported\n")
+            ok = False
+
+        # Test 3: free() untracks
+        print("Test 3: 1000 alloc/free cycles (slots reused)")
+        print(f"✓ cycles_aligned={values.get('cycles_aligned')}")
+        if values.get('cycles_aligned') == 1000:
+            print("✅ PASS: Regions released on free\n")
+        else:
+            print("❌ FAIL: Region table leaked\n")
+            ok = False
+
+        # Test 4: realloc / calloc
+        print("Test 4: realloc() and calloc()")
+        print(f"✓ realloc_ok={values.get('realloc_ok')} calloc_zero={values.get('calloc_zero')}")
+        if values.get('realloc_ok') == 1 and values.get('calloc_zero') == 1:
+            print("✅ PASS: Contents preserved, reuse zero-filled\n")
+        else:
+            print("❌ FAIL: realloc/calloc semantics broken\n")
+            ok = False
+
+        # Test 5: Sampling
+        print("Test 5: MEMWATCH_TRACK_SAMPLE=4")
+        _, values = run(binary, MEMWATCH_DB=db, MEMWATCH_TRACK_SAMPLE='4')
+        print(f"✓ cycles_aligned={values.get('cycles_aligned')}")
+        if 240 <= values.get('cycles_aligned', 0) <= 260:
+            print("✅ PASS: One in four tracked\n")
+        else:
+            print("❌ FAIL: Sampling rate not applied\n")
+            ok = False
+
+        # Test 6: Guard page
+        print("Test 6: Overrun past a tracked block")
+        proc, _ = run(binary, ['overrun'], MEMWATCH_DB=db)
+        print(f"✓ exit status {proc.returncode}")
+        if proc.returncode == -11:
+            print("✅ PASS: Guard page caught the overrun\n")
+        else:
+            print("❌ FAIL: Overrun not caught\n")
+            ok = False
+
+    print("=== Test Summary ===")
+    print("✅ All preload arena checks passed" if ok else "❌ Some checks failed")
+    return 0 if ok else 1
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,233 @@
+#!/usr/bin/env python3
+"""
+SQL Tracker Arena Test - memwatch
+
+Changes are 16-byte records pointing at one arena statement per tracked
+query, with table, column and database names interned to 32-bit IDs.
+Verifies that:
+1. A change costs tens of bytes, and nothing is preallocated
+2. Names intern to stable IDs that resolve both ways
+3. The query text is stored once per statement, values at their real length
+4. A retention ring keeps the newest changes in bounded memory
+5. Capacity-limited trackers keep the first changes; filters and summary agree
+6. The Python binding reads changes back from the native tracker
+"""
+
+import sys
+import os
+import ctypes
+import subprocess
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+LIBRARY = os.path.join(ROOT, 'build', 'libsql_tracker.so')
+sys.path.insert(0, os.path.join(ROOT, 'bindings'))
+
+RETAIN_FIRST, RETAIN_LATEST = 0, 1
+INSERT, UPDATE, DELETE, SELECT = 1, 2, 3, 4
+OLD_CHANGE_SIZE = 6928  # sizeof(SQLChange) with fixed arrays
+
+class SQLChange(ctypes.Structure):
+    _fields_ = [('timestamp_ns', ctypes.c_uint64),
+                ('table_name', ctypes.c_char_p),
+                ('column_name', ctypes.c_char_p),
+                ('operation', ctypes.c_int),
+                ('old_value', ctypes.c_void_p),
+                ('new_value', ctypes.c_void_p),
+                ('rows_affected', ctypes.c_int),
+                ('database', ctypes.c_char_p),
+                ('full_query', ctypes.c_void_p),
+                ('table_id', ctypes.c_uint32),
+                ('column_id', ctypes.c_uint32),
+                ('database_id', ctypes.c_uint32),
+                ('old_value_len', ctypes.c_uint32),
+                ('new_value_len', ctypes.c_uint32),
+                ('query_len', ctypes.c_uint32)]
+
+class Config(ctypes.Structure):
+    _fields_ = [('storage_path', ctypes.c_char_p),
+                ('max_changes', ctypes.c_int),
+                ('retention', ctypes.c_int),
+                ('cache_entries', ctypes.c_int),
+                ('compress_log', ctypes.c_int)]
+
+class Summary(ctypes.Structure):
+    _fields_ = [(name, ctypes.c_int) for name in (
+        'total_changes', 'insert_count', 'update_count', 'delete_count', 'select_count')]
+
+class TrackerHead(ctypes.Structure):
+    _fields_ = [('changes', ctypes.c_void_p), ('change_count', ctypes.c_int), ('max_changes', ctypes.c_int)]
+
+def load():
+    lib = ctypes.CDLL(LIBRARY)
+    lib.sql_tracker_init.restype = ctypes.c_void_p
+    lib.sql_tracker_init.argtypes = [ctypes.c_char_p]
+    lib.sql_tracker_init_ex.restype = ctypes.c_void_p
+    lib.sql_tracker_init_ex.argtypes = [ctypes.POINTER(Config)]
+    lib.sql_tracker_track_query.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_int,
+                                            ctypes.c_char_p, ctypes.c_char_p, ctypes.c_char_p]
+    lib.sql_tracker_get_change.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.POINTER(SQLChange)]
+    lib.sql_tracker_get_changes.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_char_p,
+                                            ctypes.c_char_p, ctypes.POINTER(ctypes.c_void_p)]
+    lib.sql_tracker_name_id.restype = ctypes.c_uint32
+    lib.sql_tracker_name_id.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+    lib.sql_tracker_name.restype = ctypes.c_char_p
+    lib.sql_tracker_name.argtypes = [ctypes.c_void_p, ctypes.c_uint32]
+    lib.sql_tracker_memory_usage.restype = ctypes.c_size_t
+    lib.sql_tracker_memory_usage.argtypes = [ctypes.c_void_p]
+    lib.sql_tracker_summary.argtypes = [ctypes.c_void_p, ctypes.POINTER(Summary)]
+    lib.sql_tracker_free.argtypes = [ctypes.c_void_p]
+    return lib
+
+def create(lib, max_changes, retention):
+    config = Config(None, max_changes, retention, 0)
+    return lib.sql_tracker_init_ex(ctypes.byref(config))
+
+def count(tracker):
+    return TrackerHead.from_address(tracker).change_count
+
+def change(lib, tracker, index):
+    c = SQLChange()
+    return c if lib.sql_tracker_get_change(tracker, index, ctypes.byref(c)) == 0 else None
+
+def insert(lib, tracker, i, new_value=None):
+    query = b"INSERT INTO orders (id, customer, total) VALUES (%d, 'c%d', %d)" % (i, i % 97, i * 3)
+    return lib.sql_tracker_track_query(tracker, query, 1, b"shop", None, new_value)
+
+def main():
+    print("=== SQL Tracker Arena Test ===\n")
+
+    if not os.path.exists(LIBRARY):
+        subprocess.run(['make', '-C', ROOT, 'build-sql-tracker'], capture_output=True)
+    if not os.path.exists(LIBRARY):
+        print("libsql_tracker.so not built (make build-sql-tracker) - skipping\n")
+        return 0
+
+    lib = load()
+    libc = ctypes.CDLL(None)
+    libc.free.argtypes = [ctypes.c_void_p]
+    ok = True
+
+    # Test 1: Memory per change
+    print("Test 1: Memory per change")
+    tracker = create(lib, 0, RETAIN_FIRST)
+    empty = lib.sql_tracker_memory_usage(tracker)
+    for i in range(30000):
+        insert(lib, tracker, i)
+    n = count(tracker)
+    per_change = (lib.sql_tracker_memory_usage(tracker) - empty) / n
+    print(f"✓ {empty} bytes empty, {n} changes at {per_change:.1f} bytes each "
+          f"(was {OLD_CHANGE_SIZE})")
+    if empty < 4096 and n == 90000 and per_change < 64:
+        print("✅ PASS: Changes take tens of bytes\n")
+    else:
+        print("❌ FAIL: Changes still expensive\n")
+        ok = False
+
+    # Test 2: Interning
+    print("Test 2: Interned names")
+    first, last = change(lib, tracker, 0), change(lib, tracker, n - 1)
+    table_id = lib.sql_tracker_name_id(tracker, b"orders")
+    customer_id = lib.sql_tracker_name_id(tracker, b"customer")
+    same = first.table_id == last.table_id == table_id and first.database_id == last.database_id
+    resolved = (lib.sql_tracker_name(tracker, table_id), lib.sql_tracker_name(tracker, customer_id),
+                lib.sql_tracker_name(tracker, 0), lib.sql_tracker_name_id(tracker, b"nope"))
+    columns = [change(lib, tracker, i).column_name for i in range(3)]
+    print(f"✓ orders={table_id}, customer={customer_id}, resolved={resolved}, columns={columns}")
+    if same and table_id and resolved == (b"orders", b"customer", b"", 0) and \
+            columns == [b"id", b"customer", b"total"] and first.database == b"shop":
+        print("✅ PASS: Names intern to shared IDs\n")
+    else:
+        print("❌ FAIL: Interning broken\n")
+        ok = False
+    lib.sql_tracker_free(tracker)
+
+    # Test 3: Shared query text, real-length values
+    print("Test 3: Query stored once, values at real length")
+    tracker = create(lib, 0, RETAIN_FIRST)
+    big = bytes(ord('a') + i % 26 for i in range(5000))
+    insert(lib, tracker, 1, new_value=big)
+    views = [change(lib, tracker, i) for i in range(3)]
+    shared = len({v.full_query for v in views}) == 1
+    value = ctypes.string_at(views[0].new_value, views[0].new_value_len)
+    query = ctypes.string_at(views[0].full_query, views[0].query_len)
+    old_empty = views[0].old_value_len == 0 and ctypes.string_at(views[0].old_value) == b""
+    print(f"✓ query shared={shared}, value {len(value)} bytes intact={value == big}, "
+          f"query={query[:40]!r}..., old value empty={old_empty}")
+    if shared and value == big and query.startswith(b"INSERT INTO orders") and old_empty:
+        print("✅ PASS: Statement holds the shared text once\n")
+    else:
+        print("❌ FAIL: Statement text wrong\n")
+        ok = False
+    lib.sql_tracker_free(tracker)
+
+    # Test 4: Retention ring
+    print("Test 4: Retention ring")
+    tracker = create(lib, 3000, RETAIN_LATEST)
+    for i in range(2000):
+        insert(lib, tracker, i)
+    early = lib.sql_tracker_memory_usage(tracker)
+    for i in range(2000, 40000):
+        insert(lib, tracker, i)
+    late = lib.sql_tracker_memory_usage(tracker)
+    oldest = ctypes.string_at(change(lib, tracker, 0).full_query)
+    newest = ctypes.string_at(change(lib, tracker, count(tracker) - 1).full_query)
+    print(f"✓ {count(tracker)} retained, {early} -> {late} bytes, oldest from "
+          f"{oldest[46:58]!r}, newest from {newest[46:58]!r}")
+    if count(tracker) == 3000 and late < early * 1.5 and b"(39000," in oldest and b"(39999," in newest:
+        print("✅ PASS: Ring keeps the newest changes in bounded memory\n")
+    else:
+        print("❌ FAIL: Retention ring wrong\n")
+        ok = False
+    lib.sql_tracker_free(tracker)
+
+    # Test 5: Capacity, filters and summary
+    print("Test 5: Capacity, filters and summary")
+    tracker = lib.sql_tracker_init(None)
+    for i in range(4000):
+        insert(lib, tracker, i)
+    capped = count(tracker)
+    lib.sql_tracker_free(tracker)
+    tracker = create(lib, 0, RETAIN_FIRST)
+    lib.sql_tracker_track_query(tracker, b"INSERT INTO users (name, email) VALUES ('a', 'b')", 1, None, None, None)
+    lib.sql_tracker_track_query(tracker, b"SELECT name, email FROM users WHERE id = 1", 1, None, None, None)
+    lib.sql_tracker_track_query(tracker, b"DELETE FROM sessions WHERE id = 2", 1, None, None, None)
+    out = ctypes.c_void_p()
+    users = lib.sql_tracker_get_changes(tracker, b"users", None, None, ctypes.byref(out))
+    libc.free(out)
+    emails = lib.sql_tracker_get_changes(tracker, b"users", b"email", b"SELECT", ctypes.byref(out))
+    libc.free(out)
+    unknown = lib.sql_tracker_get_changes(tracker, b"missing", None, None, ctypes.byref(out))
+    libc.free(out)
+    summary = Summary()
+    lib.sql_tracker_summary(tracker, ctypes.byref(summary))
+    totals = (summary.total_changes, summary.insert_count, summary.select_count, summary.delete_count)
+    print(f"✓ default capacity kept {capped}, users={users}, users.email SELECT={emails}, "
+          f"missing={unknown}, summary={totals}")
+    if capped == 10000 and users == 4 and emails == 1 and unknown == 0 and totals == (5, 2, 2, 1):
+        print("✅ PASS: Capacity, filters and summary agree\n")
+    else:
+        print("❌ FAIL: Query results wrong\n")
+        ok = False
+    lib.sql_tracker_free(tracker)
+
+    # Test 6: Python binding
+    print("Test 6: Python binding")
+    from sql_tracker_python import SQLTracker
+    py = SQLTracker()
+    created = py.track_query("INSERT INTO users (name, email) VALUES ('a', 'b')", 1, "app", None, "b")
+    names = [(c.table_name, c.column_name, c.database, c.new_value) for c in created]
+    filtered = py.get_changes(table_filter="users", column_filter="email")
+    print(f"✓ {names}, filtered={len(filtered)}, total={py.summary()['total']}")
+    if names == [("users", "name", "app", "b"), ("users", "email", "app", "b")] and \
+            len(filtered) == 1 and py.summary()['total'] == 2:
+        print("✅ PASS: Binding reads native changes\n")
+    else:
+        print("❌ FAIL: Binding results wrong\n")
+        ok = False
+
+    print("=== Test Summary ===")
+    print("✅ All SQL arena checks passed" if ok else "❌ Some checks failed")
+    return 0 if ok else 1
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,262 @@
+#!/usr/bin/env python3
+"""
+SQL Tracker Index Test - memwatch
+
+Changes are indexed per table, per (table, column) and per operation,
+kept in timestamp order, and read back through a cursor. Verifies that:
+1. Summary counters stay exact across retention ring rotation
+2. Indexed queries return the same changes as a full scan
+3. Time ranges binary-search to the right changes
+4. Cursors hand out views of the stored changes, not copies
+5. An indexed query on a rare table skips the rest of the ring
+6. The Python binding iterates through the cursor
+"""
+
+import sys
+import os
+import time
+import ctypes
+import random
+import subprocess
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+LIBRARY = os.path.join(ROOT, 'build', 'libsql_tracker.so')
+sys.path.insert(0, os.path.join(ROOT, 'bindings'))
+
+RETAIN_FIRST, RETAIN_LATEST = 0, 1
+UNKNOWN, INSERT, UPDATE, DELETE, SELECT = range(5)
+
+class SQLChange(ctypes.Structure):
+    _fields_ = [('timestamp_ns', ctypes.c_uint64),
+                ('table_name', ctypes.c_char_p),
+                ('column_name', ctypes.c_char_p),
+                ('operation', ctypes.c_int),
+                ('old_value', ctypes.c_void_p),
+                ('new_value', ctypes.c_void_p),
+                ('rows_affected', ctypes.c_int),
+                ('database', ctypes.c_char_p),
+                ('full_query', ctypes.c_void_p),
+                ('table_id', ctypes.c_uint32),
+                ('column_id', ctypes.c_uint32),
+                ('database_id', ctypes.c_uint32),
+                ('old_value_len', ctypes.c_uint32),
+                ('new_value_len', ctypes.c_uint32),
+                ('query_len', ctypes.c_uint32)]
+
+class Config(ctypes.Structure):
+    _fields_ = [('storage_path', ctypes.c_char_p),
+                ('max_changes', ctypes.c_int),
+                ('retention', ctypes.c_int),
+                ('cache_entries', ctypes.c_int),
+                ('compress_log', ctypes.c_int)]
+
+class Query(ctypes.Structure):
+    _fields_ = [('table', ctypes.c_char_p),
+                ('column', ctypes.c_char_p),
+                ('operation', ctypes.c_int),
+                ('since_ns', ctypes.c_uint64),
+                ('until_ns', ctypes.c_uint64)]
+
+class Cursor(ctypes.Structure):
+    _fields_ = [('tracker', ctypes.c_void_p),
+                ('seqs', ctypes.c_void_p),
+                ('pos', ctypes.c_uint32),
+                ('end', ctypes.c_uint32),
+                ('table_id', ctypes.c_uint32),
+                ('column_id', ctypes.c_uint32),
+                ('operation', ctypes.c_int)]
+
+class Summary(ctypes.Structure):
+    _fields_ = [(name, ctypes.c_int) for name in (
+        'total_changes', 'insert_count', 'update_count', 'delete_count', 'select_count')]
+
+class TrackerHead(ctypes.Structure):
+    _fields_ = [('changes', ctypes.c_void_p), ('change_count', ctypes.c_int), ('max_changes', ctypes.c_int)]
+
+def load():
+    lib = ctypes.CDLL(LIBRARY)
+    lib.sql_tracker_init_ex.restype = ctypes.c_void_p
+    lib.sql_tracker_init_ex.argtypes = [ctypes.POINTER(Config)]
+    lib.sql_tracker_track_query.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_int,
+                                            ctypes.c_char_p, ctypes.c_char_p, ctypes.c_char_p]
+    lib.sql_tracker_get_change.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.POINTER(SQLChange)]
+    lib.sql_tracker_query.argtypes = [ctypes.c_void_p, ctypes.POINTER(Query), ctypes.POINTER(Cursor)]
+    lib.sql_cursor_next.argtypes = [ctypes.POINTER(Cursor), ctypes.POINTER(SQLChange)]
+    lib.sql_tracker_summary.argtypes = [ctypes.c_void_p, ctypes.POINTER(Summary)]
+    lib.sql_tracker_free.argtypes = [ctypes.c_void_p]
+    return lib
+
+STATEMENTS = [
+    "INSERT INTO users (name, email) VALUES ('n%d', 'e')",
+    "UPDATE users SET email = 'x%d' WHERE id = 1",
+    "SELECT name, email FROM users WHERE id = %d",
+    "INSERT INTO orders (user_id, total) VALUES (%d, 5)",
+    "UPDATE orders SET total = %d",
+    "DELETE FROM sessions WHERE id = %d",
+    "SELECT token FROM sessions WHERE id = %d",
+]
+
+def fill(lib, max_changes, retention, count, seed=1):
+    tracker = lib.sql_tracker_init_ex(ctypes.byref(Config(None, max_changes, retention, 0)))
+    rng = random.Random(seed)
+    for i in range(count):
+        lib.sql_tracker_track_query(tracker, (rng.choice(STATEMENTS) % i).encode(), 1, None, None, None)
+    return tracker
+
+def scan(lib, tracker):
+    rows = []
+    for i in range(TrackerHead.from_address(tracker).change_count):
+        c = SQLChange()
+        lib.sql_tracker_get_change(tracker, i, ctypes.byref(c))
+        rows.append((c.timestamp_ns, c.table_name, c.column_name, c.operation, c.full_query))
+    return rows
+
+def query(lib, tracker, table=None, column=None, operation=UNKNOWN, since=0, until=0):
+    q = Query(table, column, operation, since, until)
+    cursor = Cursor()
+    assert lib.sql_tracker_query(tracker, ctypes.byref(q), ctypes.byref(cursor)) == 0
+    rows, c = [], SQLChange()
+    while lib.sql_cursor_next(ctypes.byref(cursor), ctypes.byref(c)):
+        rows.append((c.timestamp_ns, c.table_name, c.column_name, c.operation, c.full_query))
+    return rows
+
+def expected(rows, table=None, column=None, operation=UNKNOWN, since=0, until=0):
+    return [r for r in rows if (table is None or r[1] == table) and (column is None or r[2] == column) and
+            (not operation or r[3] == operation) and r[0] >= since and (not until or r[0] < until)]
+
+def main():
+    print("=== SQL Tracker Index Test ===\n")
+
+    if not os.path.exists(LIBRARY):
+        subprocess.run(['make', '-C', ROOT, 'build-sql-tracker'], capture_output=True)
+    if not os.path.exists(LIBRARY):
+        print("libsql_tracker.so not built (make build-sql-tracker) - skipping\n")
+        return 0
+
+    lib = load()
+    ok = True
+
+    # Test 1: Summary counters
+    print("Test 1: Summary counters across rotation")
+    tracker = fill(lib, 3000, RETAIN_LATEST, 8000)
+    rows = scan(lib, tracker)
+    summary = Summary()
+    lib.sql_tracker_summary(tracker, ctypes.byref(summary))
+    got = (summary.total_changes, summary.insert_count, summary.update_count,
+           summary.delete_count, summary.select_count)
+    want = (len(rows),) + tuple(sum(1 for r in rows if r[3] == op) for op in (INSERT, UPDATE, DELETE, SELECT))
+    print(f"✓ counters={got}, scan={want}")
+    if got == want and got[0] == 3000:
+        print("✅ PASS: Counters match the retained changes\n")
+    else:
+        print("❌ FAIL: Counters drifted\n")
+        ok = False
+
+    # Test 2: Indexed queries match a scan, before and after more rotation
+    print("Test 2: Indexed queries")
+    filters = [dict(table=b"users"), dict(table=b"users", column=b"email"), dict(operation=DELETE),
+               dict(table=b"orders", operation=UPDATE), dict(column=b"token"),
+               dict(table=b"users", column=b"email", operation=SELECT), dict(table=b"missing"),
+               dict(table=b"sessions", column=b"email"), dict()]
+    mismatches = []
+    for phase in range(2):
+        rows = scan(lib, tracker)
+        for f in filters:
+            if query(lib, tracker, **f) != expected(rows, **f):
+                mismatches.append((phase, f))
+        rng = random.Random(2)
+        for i in range(5000):
+            lib.sql_tracker_track_query(tracker, (rng.choice(STATEMENTS) % i).encode(), 1, None, None, None)
+    sizes = [len(query(lib, tracker, **f)) for f in filters]
+    print(f"✓ {len(filters)} filters x 2 phases, result sizes {sizes}, mismatches={mismatches}")
+    if not mismatches and sizes[-1] == 3000 and sizes[6] == 0 and sizes[7] == 0:
+        print("✅ PASS: Indexes agree with the ring\n")
+    else:
+        print("❌ FAIL: Indexed results differ\n")
+        ok = False
+
+    # Test 3: Time ranges
+    print("Test 3: Time ranges")
+    rows = scan(lib, tracker)
+    stamps = sorted({r[0] for r in rows})
+    bad = 0
+    rng = random.Random(3)
+    for _ in range(50):
+        since, until = sorted(rng.sample(stamps, 2))
+        for f in (dict(), dict(table=b"orders"), dict(table=b"users", column=b"name"), dict(operation=SELECT)):
+            if query(lib, tracker, since=since, until=until, **f) != expected(rows, since=since, until=until, **f):
+                bad += 1
+    ordered = [r[0] for r in rows] == sorted(r[0] for r in rows)
+    tail = query(lib, tracker, since=stamps[-1])
+    print(f"✓ 200 ranged queries, mismatches={bad}, ring in time order={ordered}, "
+          f"since newest={len(tail)}")
+    if bad == 0 and ordered and tail == expected(rows, since=stamps[-1]):
+        print("✅ PASS: Ranges match\n")
+    else:
+        print("❌ FAIL: Range queries wrong\n")
+        ok = False
+
+    # Test 4: No copies
+    print("Test 4: Cursor views")
+    cursor, view, stored = Cursor(), SQLChange(), SQLChange()
+    lib.sql_tracker_query(tracker, ctypes.byref(Query(b"orders", b"total", 0, 0, 0)), ctypes.byref(cursor))
+    lib.sql_cursor_next(ctypes.byref(cursor), ctypes.byref(view))
+    index = next(i for i, r in enumerate(rows) if r[1] == b"orders" and r[2] == b"total")
+    lib.sql_tracker_get_change(tracker, index, ctypes.byref(stored))
+    same = view.full_query == stored.full_query and view.new_value == stored.new_value
+    print(f"✓ cursor view query at {view.full_query:#x}, stored at {stored.full_query:#x}")
+    if same:
+        print("✅ PASS: Cursor points into the tracker\n")
+    else:
+        print("❌ FAIL: Cursor copied the change\n")
+        ok = False
+    lib.sql_tracker_free(tracker)
+
+    # Test 5: Selectivity
+    print("Test 5: Rare table lookup")
+    tracker = lib.sql_tracker_init_ex(ctypes.byref(Config(None, 0, RETAIN_FIRST, 0)))
+    for i in range(100000):
+        lib.sql_tracker_track_query(tracker, b"UPDATE events SET seen = %d" % i, 1, None, None, None)
+        if i % 10000 == 0:
+            lib.sql_tracker_track_query(tracker, b"UPDATE audit SET note = %d" % i, 1, None, None, None)
+    query(lib, tracker, table=b"audit")
+    cursor = Cursor()
+    start = time.perf_counter()
+    for _ in range(200):
+        lib.sql_tracker_query(tracker, ctypes.byref(Query(b"audit", None, 0, 0, 0)), ctypes.byref(cursor))
+    indexed = (time.perf_counter() - start) / 200
+    span = cursor.end - cursor.pos
+    start = time.perf_counter()
+    scanned = query(lib, tracker, column=b"note")
+    full = time.perf_counter() - start
+    print(f"✓ audit: cursor span {span} of {TrackerHead.from_address(tracker).change_count}, "
+          f"{indexed * 1e6:.1f} us indexed vs {full * 1e3:.2f} ms scanning, scan found {len(scanned)}")
+    if span == 10 and len(scanned) == 10 and indexed * 20 < full:
+        print("✅ PASS: Index walks only the matches\n")
+    else:
+        print("❌ FAIL: Lookup not selective\n")
+        ok = False
+    lib.sql_tracker_free(tracker)
+
+    # Test 6: Python binding
+    print("Test 6: Python binding")
+    from sql_tracker_python import SQLTracker
+    py = SQLTracker()
+    for i in range(6):
+        py.track_query("UPDATE users SET email = 'e%d'" % i if i % 2 else "DELETE FROM users WHERE id = %d" % i)
+    stamps = [c.timestamp_ns for c in py.iter_changes()]
+    updates = list(py.iter_changes(table="users", operation="UPDATE"))
+    later = list(py.iter_changes(table="users", since_ns=stamps[3]))
+    print(f"✓ {len(stamps)} changes, {len(updates)} updates, {len(later)} since the 4th")
+    if len(stamps) == 6 and [c.column_name for c in updates] == ["email"] * 3 and len(later) == 3:
+        print("✅ PASS: Binding iterates the cursor\n")
+    else:
+        print("❌ FAIL: Binding results wrong\n")
+        ok = False
+
+    print("=== Test Summary ===")
+    print("✅ All SQL index checks passed" if ok else "❌ Some checks failed")
+    return 0 if ok else 1
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,272 @@
+#!/usr/bin/env python3
+"""
+SQL Tracker Change Log Test - memwatch
+
+With a storage_path, tracked statements go to a binary append-only log:
+the tracking call queues a record, a writer thread batches records into
+(optionally LZ4-compressed) CRC-checked blocks. Verifies that:
+1. A reopened tracker replays the log into the same changes
+2. Compressed logs are smaller and replay identically
+3. A torn tail is cut back to the last intact block, then appended to
+4. sql_log_to_jsonl converts a log to one JSON line per change
+5. Logging adds little to the tracking call and drops nothing
+6. Files that are not change logs are refused
+7. The Python binding flushes, reports and exports the log
+"""
+
+import sys
+import os
+import json
+import time
+import ctypes
+import tempfile
+import subprocess
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+LIBRARY = os.path.join(ROOT, 'build', 'libsql_tracker.so')
+TOOL = os.path.join(ROOT, 'build', 'sql_log_to_jsonl')
+sys.path.insert(0, os.path.join(ROOT, 'bindings'))
+
+RETAIN_FIRST = 0
+HEADER_SIZE = 16
+
+class SQLChange(ctypes.Structure):
+    _fields_ = [('timestamp_ns', ctypes.c_uint64),
+                ('table_name', ctypes.c_char_p),
+                ('column_name', ctypes.c_char_p),
+                ('operation', ctypes.c_int),
+                ('old_value', ctypes.c_char_p),
+                ('new_value', ctypes.c_char_p),
+                ('rows_affected', ctypes.c_int),
+                ('database', ctypes.c_char_p),
+                ('full_query', ctypes.c_char_p),
+                ('table_id', ctypes.c_uint32),
+                ('column_id', ctypes.c_uint32),
+                ('database_id', ctypes.c_uint32),
+                ('old_value_len', ctypes.c_uint32),
+                ('new_value_len', ctypes.c_uint32),
+                ('query_len', ctypes.c_uint32)]
+
+class Config(ctypes.Structure):
+    _fields_ = [('storage_path', ctypes.c_char_p),
+                ('max_changes', ctypes.c_int),
+                ('retention', ctypes.c_int),
+                ('cache_entries', ctypes.c_int),
+                ('compress_log', ctypes.c_int)]
+
+class LogStats(ctypes.Structure):
+    _fields_ = [(name, ctypes.c_uint64) for name in (
+        'records', 'dropped', 'blocks', 'raw_bytes', 'written_bytes', 'loaded')] + [
+        ('error', ctypes.c_int), ('compress_ns', ctypes.c_uint64)]
+
+class TrackerHead(ctypes.Structure):
+    _fields_ = [('changes', ctypes.c_void_p), ('change_count', ctypes.c_int), ('max_changes', ctypes.c_int)]
+
+def load():
+    lib = ctypes.CDLL(LIBRARY)
+    lib.sql_tracker_init_ex.restype = ctypes.c_void_p
+    lib.sql_tracker_init_ex.argtypes = [ctypes.POINTER(Config)]
+    lib.sql_tracker_track_query.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_int,
+                                            ctypes.c_char_p, ctypes.c_char_p, ctypes.c_char_p]
+    lib.sql_tracker_get_change.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.POINTER(SQLChange)]
+    lib.sql_tracker_flush.argtypes = [ctypes.c_void_p]
+    lib.sql_tracker_log_stats.argtypes = [ctypes.c_void_p, ctypes.POINTER(LogStats)]
+    lib.sql_tracker_export_jsonl.restype = ctypes.c_long
+    lib.sql_tracker_export_jsonl.argtypes = [ctypes.c_char_p, ctypes.c_char_p]
+    lib.sql_tracker_free.argtypes = [ctypes.c_void_p]
+    return lib
+
+def create(lib, path, compress=0):
+    config = Config(path.encode() if path else None, 0, RETAIN_FIRST, 0, compress)
+    return lib.sql_tracker_init_ex(ctypes.byref(config))
+
+def stats(lib, tracker):
+    s = LogStats()
+    lib.sql_tracker_log_stats(tracker, ctypes.byref(s))
+    return s
+
+def track(lib, tracker, start, count):
+    for i in range(start, start + count):
+        query = b"UPDATE accounts SET balance = %d, note = 'n%d' WHERE id = %d" % (i * 7, i % 13, i)
+        lib.sql_tracker_track_query(tracker, query, 1, b"bank" if i % 2 else None,
+                                    b"old%d" % i, b"new\n%d" % i if i % 3 else None)
+
+def scan(lib, tracker):
+    rows = []
+    for i in range(TrackerHead.from_address(tracker).change_count):
+        c = SQLChange()
+        lib.sql_tracker_get_change(tracker, i, ctypes.byref(c))
+        rows.append((c.timestamp_ns, c.table_name, c.column_name, c.operation, c.old_value,
+                     c.new_value, c.rows_affected, c.database, c.full_query))
+    return rows
+
+def written(lib, path, count, compress=0):
+    tracker = create(lib, path, compress)
+    track(lib, tracker, 0, count)
+    lib.sql_tracker_flush(tracker)
+    rows = scan(lib, tracker)
+    lib.sql_tracker_free(tracker)
+    return rows
+
+def main():
+    print("=== SQL Tracker Change Log Test ===\n")
+
+    if not os.path.exists(LIBRARY) or not os.path.exists(TOOL):
+        subprocess.run(['make', '-C', ROOT, 'build-sql-tracker'], capture_output=True)
+    if not os.path.exists(LIBRARY):
+        print("libsql_tracker.so not built (make build-sql-tracker) - skipping\n")
+        return 0
+
+    lib = load()
+    ok = True
+    tmp = tempfile.mkdtemp(prefix='sql_log_test_')
+    plain, packed = os.path.join(tmp, 'plain.log'), os.path.join(tmp, 'packed.log')
+
+    # Test 1: Replay
+    print("Test 1: Reopen replays the log")
+    before = written(lib, plain, 20000)
+    tracker = create(lib, plain)
+    loaded = stats(lib, tracker).loaded
+    after = scan(lib, tracker)
+    track(lib, tracker, 20000, 100)
+    lib.sql_tracker_flush(tracker)
+    lib.sql_tracker_free(tracker)
+    tracker = create(lib, plain)
+    again = scan(lib, tracker)
+    lib.sql_tracker_free(tracker)
+    print(f"✓ {len(before)} changes written, {loaded} statements replayed, "
+          f"identical={after == before}, second session kept={len(again)}")
+    if loaded == 20000 and after == before and len(again) == 40200 and again[:40000] == before:
+        print("✅ PASS: Changes survive a restart\n")
+    else:
+        print("❌ FAIL: Replay differs\n")
+        ok = False
+
+    # Test 2: Compression
+    print("Test 2: Compressed log")
+    before = written(lib, packed, 20000, compress=1)
+    tracker = create(lib, packed, compress=1)
+    after = scan(lib, tracker)
+    lib.sql_tracker_free(tracker)
+    tracker = create(lib, plain)
+    plain_rows = scan(lib, tracker)[:40000]
+    lib.sql_tracker_free(tracker)
+    ratio = os.path.getsize(plain) / 2 / os.path.getsize(packed)
+    same = [r[1:] for r in after] == [r[1:] for r in plain_rows[:40000]]
+    print(f"✓ {os.path.getsize(packed)} bytes compressed, {ratio:.1f}x smaller, "
+          f"replay identical={after == before}, same content as plain={same}")
+    if ratio > 2 and after == before and same:
+        print("✅ PASS: LZ4 blocks shrink the log\n")
+    else:
+        print("❌ FAIL: Compressed log wrong\n")
+        ok = False
+
+    # Test 3: Torn tail
+    print("Test 3: Torn tail recovery")
+    torn = os.path.join(tmp, 'torn.log')
+    complete = written(lib, torn, 20000, compress=1)
+    size = os.path.getsize(torn)
+    with open(torn, 'r+b') as f:
+        f.truncate(size - 1000)
+        f.seek(0, os.SEEK_END)
+        f.write(b'\xde\xad' * 300)
+    tracker = create(lib, torn, compress=1)
+    survived = scan(lib, tracker)
+    cut = os.path.getsize(torn)
+    track(lib, tracker, 50000, 10)
+    lib.sql_tracker_flush(tracker)
+    lib.sql_tracker_free(tracker)
+    tracker = create(lib, torn, compress=1)
+    resumed = scan(lib, tracker)
+    lib.sql_tracker_free(tracker)
+    print(f"✓ {len(survived)}/{len(complete)} changes survived, file cut to {cut}/{size} bytes, "
+          f"{len(resumed) - len(survived)} appended after recovery")
+    if 0 < len(survived) < len(complete) and survived == complete[:len(survived)] and cut < size - 1000 and \
+            resumed[:len(survived)] == survived and len(resumed) == len(survived) + 20:
+        print("✅ PASS: Damage costs only the last block\n")
+    else:
+        print("❌ FAIL: Recovery wrong\n")
+        ok = False
+
+    # Test 4: JSONL export
+    print("Test 4: JSONL export")
+    out = os.path.join(tmp, 'changes.jsonl')
+    result = subprocess.run([TOOL, packed, out], capture_output=True, text=True)
+    lines = [json.loads(l) for l in open(out)] if result.returncode == 0 else []
+    first = lines[0] if lines else {}
+    expected = {'table_name': 'accounts', 'column_name': 'balance', 'operation': 'UPDATE',
+                'old_value': 'old0', 'new_value': '', 'rows_affected': 1, 'database': '',
+                'full_query': "UPDATE accounts SET balance = 0, note = 'n0' WHERE id = 0"}
+    piped = subprocess.run([TOOL, plain], capture_output=True, text=True).stdout.count('\n')
+    print(f"✓ {len(lines)} lines, stdout {piped} lines, first={first}")
+    if len(lines) == 40000 and all(first.get(k) == v for k, v in expected.items()) and \
+            lines[5]['new_value'] == 'new\n2' and lines[3]['database'] == 'bank' and \
+            first['timestamp_ns'] == before[0][0] and piped == 40200:
+        print("✅ PASS: Log converts to JSON lines\n")
+    else:
+        print(f"❌ FAIL: Export wrong ({result.stderr.strip()})\n")
+        ok = False
+
+    # Test 5: Hot path cost
+    print("Test 5: Tracking cost with a log")
+    timings = {}
+    for label, path in (('memory', None), ('logged', os.path.join(tmp, 'hot.log'))):
+        tracker = create(lib, path, compress=1)
+        start = time.perf_counter()
+        track(lib, tracker, 0, 50000)
+        timings[label] = time.perf_counter() - start
+        if path:
+            lib.sql_tracker_flush(tracker)
+            hot = stats(lib, tracker)
+        lib.sql_tracker_free(tracker)
+    overhead = timings['logged'] / timings['memory']
+    print(f"✓ {timings['memory'] * 1e6 / 50000:.2f} us/query in memory, "
+          f"{timings['logged'] * 1e6 / 50000:.2f} us/query logged ({overhead:.2f}x), "
+          f"records={hot.records}, dropped={hot.dropped}, blocks={hot.blocks}")
+    if overhead < 1.5 and hot.records == 50000 and hot.dropped == 0 and hot.blocks < hot.records / 100:
+        print("✅ PASS: Logging stays off the tracking path\n")
+    else:
+        print("❌ FAIL: Logging slows tracking\n")
+        ok = False
+
+    # Test 6: Foreign files
+    print("Test 6: Not a change log")
+    foreign = os.path.join(tmp, 'foreign.jsonl')
+    with open(foreign, 'w') as f:
+        f.write('{"table_name": "users"}\n')
+    refused = create(lib, foreign)
+    exported = lib.sql_tracker_export_jsonl(foreign.encode(), None)
+    print(f"✓ init={refused}, export={exported}, file untouched={open(foreign).read().startswith('{')}")
+    if not refused and exported == -1 and open(foreign).read() == '{"table_name": "users"}\n':
+        print("✅ PASS: Other files are refused, not overwritten\n")
+    else:
+        print("❌ FAIL: Foreign file accepted\n")
+        ok = False
+
+    # Test 7: Python binding
+    print("Test 7: Python binding")
+    from sql_tracker_python import SQLTracker
+    path = os.path.join(tmp, 'binding.log')
+    py = SQLTracker(path, compress_log=True)
+    py.track_query("INSERT INTO users (name, email) VALUES ('a', 'b')", 1, "app", None, "b")
+    py.flush()
+    written_stats = py.log_stats()
+    del py
+    py = SQLTracker(path)
+    names = [(c.table_name, c.column_name, c.database, c.new_value) for c in py.get_changes()]
+    lines = SQLTracker.export_jsonl(path, os.path.join(tmp, 'binding.jsonl'))
+    print(f"✓ stats={written_stats}, reloaded={names}, exported={lines}, "
+          f"no log={SQLTracker().log_stats()}")
+    if written_stats['records'] == 1 and names == [("users", "name", "app", "b"), ("users", "email", "app", "b")] \
+            and py.log_stats()['loaded'] == 1 and lines == 2 and SQLTracker().log_stats() is None:
+        print("✅ PASS: Binding drives the change log\n")
+    else:
+        print("❌ FAIL: Binding results wrong\n")
+        ok = False
+
+    print("=== Test Summary ===")
+    print("✅ All change log checks passed" if ok else "❌ Some checks failed")
+    return 0 if ok else 1
+
+if __name__ == '__main__':
+    sys.exit(main())
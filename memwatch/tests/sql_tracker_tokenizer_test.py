@@ -0,0 +1,235 @@
+#!/usr/bin/env python3
+"""
+SQL Tracker Tokenizer Test - memwatch
+
+Statements are parsed by a single-pass tokenizer, and the parse result is
+cached under a fingerprint that ignores literal values. Verifies that:
+1. UPDATE assignments yield their target columns, never the values
+2. Quoted identifiers and multi-row INSERT parse correctly
+3. CTEs, comments and keywords inside strings do not confuse the parser
+4. Fingerprints ignore literals, case, whitespace and comments
+5. Repeats hit the statement cache, which evicts least recently used plans
+6. The Python binding reports cache counters
+"""
+
+import sys
+import os
+import ctypes
+import subprocess
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+LIBRARY = os.path.join(ROOT, 'build', 'libsql_tracker.so')
+sys.path.insert(0, os.path.join(ROOT, 'bindings'))
+
+RETAIN_FIRST = 0
+OPERATIONS = {1: 'INSERT', 2: 'UPDATE', 3: 'DELETE', 4: 'SELECT'}
+
+class SQLChange(ctypes.Structure):
+    _fields_ = [('timestamp_ns', ctypes.c_uint64),
+                ('table_name', ctypes.c_char_p),
+                ('column_name', ctypes.c_char_p),
+                ('operation', ctypes.c_int),
+                ('old_value', ctypes.c_void_p),
+                ('new_value', ctypes.c_void_p),
+                ('rows_affected', ctypes.c_int),
+                ('database', ctypes.c_char_p),
+                ('full_query', ctypes.c_char_p),
+                ('table_id', ctypes.c_uint32),
+                ('column_id', ctypes.c_uint32),
+                ('database_id', ctypes.c_uint32),
+                ('old_value_len', ctypes.c_uint32),
+                ('new_value_len', ctypes.c_uint32),
+                ('query_len', ctypes.c_uint32)]
+
+class Config(ctypes.Structure):
+    _fields_ = [('storage_path', ctypes.c_char_p),
+                ('max_changes', ctypes.c_int),
+                ('retention', ctypes.c_int),
+                ('cache_entries', ctypes.c_int),
+                ('compress_log', ctypes.c_int)]
+
+class TrackerHead(ctypes.Structure):
+    _fields_ = [('changes', ctypes.c_void_p), ('change_count', ctypes.c_int), ('max_changes', ctypes.c_int)]
+
+def load():
+    lib = ctypes.CDLL(LIBRARY)
+    lib.sql_tracker_init_ex.restype = ctypes.c_void_p
+    lib.sql_tracker_init_ex.argtypes = [ctypes.POINTER(Config)]
+    lib.sql_tracker_track_query.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_int,
+                                            ctypes.c_char_p, ctypes.c_char_p, ctypes.c_char_p]
+    lib.sql_tracker_get_change.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.POINTER(SQLChange)]
+    lib.sql_tracker_cache_stats.restype = None
+    lib.sql_tracker_cache_stats.argtypes = [ctypes.c_void_p] + [ctypes.POINTER(ctypes.c_uint64)] * 3
+    lib.sql_tracker_fingerprint.restype = ctypes.c_uint64
+    lib.sql_tracker_fingerprint.argtypes = [ctypes.c_char_p]
+    lib.sql_tracker_free.argtypes = [ctypes.c_void_p]
+    return lib
+
+def create(lib, cache_entries=0):
+    config = Config(None, 0, RETAIN_FIRST, cache_entries)
+    return lib.sql_tracker_init_ex(ctypes.byref(config))
+
+def parse(lib, tracker, query):
+    """(operation, table, [columns]) of the changes one query created"""
+    before = TrackerHead.from_address(tracker).change_count
+    created = lib.sql_tracker_track_query(tracker, query.encode(), 1, None, None, None)
+    if created == 0:
+        return None
+    views = []
+    for i in range(before, before + created):
+        c = SQLChange()
+        lib.sql_tracker_get_change(tracker, i, ctypes.byref(c))
+        views.append(c)
+    return (OPERATIONS[views[0].operation], views[0].table_name.decode(),
+            [v.column_name.decode() for v in views])
+
+def cache_stats(lib, tracker):
+    counters = [ctypes.c_uint64() for _ in range(3)]
+    lib.sql_tracker_cache_stats(tracker, *[ctypes.byref(c) for c in counters])
+    return tuple(c.value for c in counters)
+
+def check(lib, tracker, cases):
+    ok = True
+    for query, expected in cases:
+        got = parse(lib, tracker, query)
+        mark = "✓" if got == expected else "✗"
+        print(f"{mark} {query[:60]!r} -> {got}")
+        ok = ok and got == expected
+    return ok
+
+def main():
+    print("=== SQL Tracker Tokenizer Test ===\n")
+
+    if not os.path.exists(LIBRARY):
+        subprocess.run(['make', '-C', ROOT, 'build-sql-tracker'], capture_output=True)
+    if not os.path.exists(LIBRARY):
+        print("libsql_tracker.so not built (make build-sql-tracker) - skipping\n")
+        return 0
+
+    lib = load()
+    ok = True
+
+    # Test 1: UPDATE targets
+    print("Test 1: UPDATE assignments")
+    tracker = create(lib)
+    if check(lib, tracker, [
+        ("UPDATE users SET name = 'Bob', age = 1 WHERE id = 3", ('UPDATE', 'users', ['name', 'age'])),
+        ("update users u set u.email='a, b = c', score = score + (1, 2) where id=1",
+         ('UPDATE', 'users', ['email', 'score'])),
+        ("UPDATE t SET (a, b) = (1, 2), c = DEFAULT FROM x WHERE t.id = x.id", ('UPDATE', 't', ['a', 'b', 'c'])),
+        ("UPDATE OR IGNORE main.items SET qty = qty - 1 RETURNING qty", ('UPDATE', 'main.items', ['qty'])),
+    ]):
+        print("✅ PASS: Only assignment targets become columns\n")
+    else:
+        print("❌ FAIL: UPDATE parsed wrong\n")
+        ok = False
+    lib.sql_tracker_free(tracker)
+
+    # Test 2: Quoted identifiers, multi-row INSERT
+    print("Test 2: Quoted identifiers and multi-row INSERT")
+    tracker = create(lib)
+    if check(lib, tracker, [
+        ('INSERT INTO "order items" ("first ""x""", `b`, [c d]) VALUES (1, 2, 3), (4, 5, 6)',
+         ('INSERT', 'order items', ['first "x"', 'b', 'c d'])),
+        ("INSERT INTO t VALUES (1, 'a'), (2, 'b'), (3, 'c')", ('INSERT', 't', ['*'])),
+        ("insert or replace into main.t(a, b) select a, b from s", ('INSERT', 'main.t', ['a', 'b'])),
+        ('SELECT "Total", u."Name" FROM "Users" u', ('SELECT', 'Users', ['Total', 'Name'])),
+    ]):
+        print("✅ PASS: Quoting and row tuples handled\n")
+    else:
+        print("❌ FAIL: INSERT or quoting parsed wrong\n")
+        ok = False
+    lib.sql_tracker_free(tracker)
+
+    # Test 3: CTEs, comments, strings
+    print("Test 3: CTEs, comments and strings")
+    tracker = create(lib)
+    if check(lib, tracker, [
+        ("WITH recent AS (SELECT * FROM orders WHERE ts > 5), x(a) AS (SELECT 1) "
+         "SELECT id, count(*) n, sum(a + b) FROM recent", ('SELECT', 'recent', ['id', 'n', 'sum(a + b)'])),
+        ("WITH RECURSIVE c AS (SELECT 1 UNION SELECT 2) UPDATE accounts SET balance = 0",
+         ('UPDATE', 'accounts', ['balance'])),
+        ("-- UPDATE fake SET x = 1\n/* DELETE FROM fake */ DELETE FROM sessions WHERE id = ?",
+         ('DELETE', 'sessions', ['*'])),
+        ("SELECT note FROM posts WHERE body = 'it''s FROM x -- not a comment'", ('SELECT', 'posts', ['note'])),
+        ("SELECT * FROM (SELECT x FROM inner_t) q", ('SELECT', 'inner_t', ['*'])),
+        ("CREATE TABLE x (a int)", None),
+        ("SELECT 1", None),
+    ]):
+        print("✅ PASS: Statement found behind CTEs and comments\n")
+    else:
+        print("❌ FAIL: Tokenizer confused\n")
+        ok = False
+    lib.sql_tracker_free(tracker)
+
+    # Test 4: Fingerprints
+    print("Test 4: Fingerprints")
+    fp = lambda q: lib.sql_tracker_fingerprint(q.encode())
+    same = [fp("SELECT a FROM t WHERE id = 1 AND name = 'x'"),
+            fp("select  a from t -- lookup\n where id = ?  and name = :name"),
+            fp("SELECT a FROM t WHERE id = 42 AND name = 'it''s'")]
+    lists = fp("SELECT a FROM t WHERE id IN (1, 2, 3)") == fp("SELECT a FROM t WHERE id IN (?)")
+    different = len({fp("SELECT a FROM t WHERE id = 1"), fp("SELECT b FROM t WHERE id = 1"),
+                     fp("SELECT a FROM u WHERE id = 1"), fp('SELECT a FROM "T" WHERE id = 1')})
+    print(f"✓ literal variants equal={len(set(same)) == 1}, IN lists equal={lists}, "
+          f"distinct statements={different}/4")
+    if len(set(same)) == 1 and lists and different == 4:
+        print("✅ PASS: Fingerprints strip literals only\n")
+    else:
+        print("❌ FAIL: Fingerprint wrong\n")
+        ok = False
+
+    # Test 5: Statement cache
+    print("Test 5: Statement cache")
+    tracker = create(lib)
+    for i in range(1000):
+        lib.sql_tracker_track_query(tracker, b"UPDATE users SET name = 'n%d' WHERE id = %d" % (i, i),
+                                    1, None, None, None)
+    repeats = cache_stats(lib, tracker)
+    columns = {parse(lib, tracker, "UPDATE users SET name = 'z' WHERE id = 7")[2][0]}
+    lib.sql_tracker_free(tracker)
+
+    tracker = create(lib, cache_entries=4)
+    statements = ["UPDATE t%d SET c%d = 1" % (i, i) for i in range(5)]
+    for q in statements[:4] + statements[:4]:
+        parse(lib, tracker, q)
+    warm = cache_stats(lib, tracker)
+    results = [parse(lib, tracker, q) for q in statements + statements[1:]]
+    cycled = cache_stats(lib, tracker)
+    lib.sql_tracker_free(tracker)
+
+    tracker = create(lib, cache_entries=-1)
+    off = [parse(lib, tracker, q) for q in statements[:2] * 2]
+    disabled = cache_stats(lib, tracker)
+    lib.sql_tracker_free(tracker)
+
+    print(f"✓ 1000 repeats (hits, misses, evictions)={repeats}, column={columns}")
+    print(f"✓ 4-entry cache warm={warm}, after a fifth statement={cycled}, off={disabled}")
+    expected = [('UPDATE', 't%d' % i, ['c%d' % i]) for i in list(range(5)) + list(range(1, 5))]
+    if repeats == (999, 1, 0) and columns == {'name'} and warm == (4, 4, 0) and \
+            cycled[2] >= 1 and results == expected and disabled[0] == 0 and off == expected[:2] * 2:
+        print("✅ PASS: Repeats skip the parser, LRU evicts\n")
+    else:
+        print("❌ FAIL: Cache behaved wrong\n")
+        ok = False
+
+    # Test 6: Python binding
+    print("Test 6: Python binding")
+    from sql_tracker_python import SQLTracker
+    py = SQLTracker()
+    for i in range(10):
+        py.track_query("INSERT INTO logs (level, msg) VALUES (%d, 'm%d')" % (i, i))
+    stats = py.cache_stats()
+    print(f"✓ {stats}, {len(py)} changes")
+    if stats == {'hits': 9, 'misses': 1, 'evictions': 0} and len(py) == 20:
+        print("✅ PASS: Binding reports cache counters\n")
+    else:
+        print("❌ FAIL: Binding counters wrong\n")
+        ok = False
+
+    print("=== Test Summary ===")
+    print("✅ All tokenizer checks passed" if ok else "❌ Some checks failed")
+    return 0 if ok else 1
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,259 @@
+#!/usr/bin/env python3
+"""
+SQLite Sink Test - memwatch
+
+memwatch_sqlite_sink queues rows from capture threads and stores them on
+its own writer thread, one transaction per batch, with cached statements.
+Verifies that:
+1. The database is in WAL mode and every value type round-trips
+2. Rows from several threads are all stored, in few transactions
+3. A full queue makes producers wait (and drop, with drop_when_full)
+4. The sink is much faster than a prepare/step/finalize per row
+5. Tracker SQL queries are bound, so quotes are stored as written
+"""
+
+import sys
+import os
+import re
+import sqlite3
+import subprocess
+import tempfile
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+SOURCES = ['src/memwatch_tracker.c', 'src/memwatch_backend.c', 'src/memwatch_diff.c', 'src/memwatch_sqlite_sink.c']
+
+PROGRAM = r'''
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <sqlite3.h>
+#include "memwatch_sqlite_sink.h"
+#include "memwatch_tracker.h"
+
+#define SCHEMA "CREATE TABLE IF NOT EXISTS t (a INTEGER, b TEXT, c REAL, d BLOB, e TEXT)"
+#define INSERT "INSERT INTO t (a, b, c, d, e) VALUES (?, ?, ?, ?, ?)"
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void stats(mw_sink_t *sink) {
+    mw_sink_stats_t s;
+    mw_sink_stats(sink, &s);
+    printf("queued=%llu\nwritten=%llu\ndropped=%llu\nfailed=%llu\nbatches=%llu\nwaits=%llu\n",
+           (unsigned long long)s.rows_queued, (unsigned long long)s.rows_written,
+           (unsigned long long)s.rows_dropped, (unsigned long long)s.rows_failed,
+           (unsigned long long)s.batches, (unsigned long long)s.waits);
+}
+
+static mw_sink_t *g_sink;
+static int g_stmt;
+static int g_rows;
+
+static void *producer(void *arg) {
+    long id = (long)arg;
+    char text[64];
+    for (int i = 0; i < g_rows; i++) {
+        snprintf(text, sizeof(text), "thread %ld row %d", id, i);
+        mw_sink_value_t row[] = { MW_SINK_I64(id * 1000000 + i), MW_SINK_STR(text) };
+        mw_sink_write(g_sink, g_stmt, row, 2);
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    const char *mode = argv[1];
+    const char *db = argv[2];
+
+    if (strcmp(mode, "types") == 0) {
+        mw_sink_t *sink = mw_sink_open(db, SCHEMA, NULL);
+        if (!sink) return 1;
+        int stmt = mw_sink_prepare(sink, INSERT);
+        const uint8_t blob[4] = { 0, 1, 0xfe, 0xff };
+        mw_sink_value_t row[] = {
+            MW_SINK_I64(INT64_MIN), MW_SINK_STR("it's \"quoted\"; DROP TABLE t;--"),
+            MW_SINK_F64(2.5), MW_SINK_BLOBN(blob, 4), MW_SINK_STR(NULL),
+        };
+        if (mw_sink_write(sink, stmt, row, 5) != 0) return 2;
+        mw_sink_value_t bad = MW_SINK_I64(1);
+        printf("bad_stmt=%d\n", mw_sink_write(sink, stmt + 1, &bad, 1));
+        printf("bad_sql=%d\n", mw_sink_prepare(sink, "INSERT INTO missing VALUES (?)"));
+        printf("flush=%d\n", mw_sink_flush(sink));
+        stats(sink);
+        mw_sink_close(sink);
+    } else if (strcmp(mode, "threads") == 0) {
+        g_sink = mw_sink_open(db, "CREATE TABLE IF NOT EXISTS t (a INTEGER, b TEXT)", NULL);
+        if (!g_sink) return 1;
+        g_stmt = mw_sink_prepare(g_sink, "INSERT INTO t (a, b) VALUES (?, ?)");
+        g_rows = 50000;
+        pthread_t threads[4];
+        uint64_t start = now_ns();
+        for (long i = 0; i < 4; i++) pthread_create(&threads[i], NULL, producer, (void *)i);
+        for (int i = 0; i < 4; i++) pthread_join(threads[i], NULL);
+        uint64_t queued = now_ns();
+        mw_sink_flush(g_sink);
+        uint64_t stored = now_ns();
+        printf("queue_us=%llu\nstore_us=%llu\n", (unsigned long long)((queued - start) / 1000),
+               (unsigned long long)((stored - start) / 1000));
+        stats(g_sink);
+        mw_sink_close(g_sink);
+    } else if (strcmp(mode, "full") == 0 || strcmp(mode, "drop") == 0) {
+        mw_sink_config_t config = { .buffer_bytes = 4096, .flush_interval_ms = 1000,
+                                    .drop_when_full = strcmp(mode, "drop") == 0 };
+        g_sink = mw_sink_open(db, "CREATE TABLE IF NOT EXISTS t (a INTEGER, b TEXT)", &config);
+        if (!g_sink) return 1;
+        g_stmt = mw_sink_prepare(g_sink, "INSERT INTO t (a, b) VALUES (?, ?)");
+        g_rows = 20000;
+        producer((void *)0);
+        char big[8192];
+        memset(big, 'x', sizeof(big) - 1);
+        big[sizeof(big) - 1] = '\0';
+        mw_sink_value_t row[] = { MW_SINK_I64(-1), MW_SINK_STR(big) };
+        printf("too_big=%d\n", mw_sink_write(g_sink, g_stmt, row, 2));
+        mw_sink_flush(g_sink);
+        stats(g_sink);
+        mw_sink_close(g_sink);
+    } else if (strcmp(mode, "baseline") == 0) {
+        /* What the tracker did before: one prepare/step/finalize per row, no transaction */
+        sqlite3 *conn;
+        sqlite3_open(db, &conn);
+        sqlite3_exec(conn, "CREATE TABLE IF NOT EXISTS t (a INTEGER, b TEXT)", NULL, NULL, NULL);
+        uint64_t start = now_ns();
+        for (int i = 0; i < 2000; i++) {
+            sqlite3_stmt *stmt;
+            sqlite3_prepare_v2(conn, "INSERT INTO t (a, b) VALUES (?, ?)", -1, &stmt, NULL);
+            sqlite3_bind_int(stmt, 1, i);
+            sqlite3_bind_text(stmt, 2, "row", -1, SQLITE_STATIC);
+            sqlite3_step(stmt);
+            sqlite3_finalize(stmt);
+        }
+        printf("baseline_us=%llu\n", (unsigned long long)((now_ns() - start) / 1000));
+        sqlite3_close(conn);
+    } else if (strcmp(mode, "tracker") == 0) {
+        if (tracker_init(db, false, true, false, "both") != 0) return 1;
+        tracker_log_sql_query("UPDATE users SET name = 'O''Brien' WHERE id = 1");
+        tracker_log_sql_query("SELECT 'a'');--'");
+        mw_sink_stats_t s;
+        tracker_get_sink_stats(&s);
+        printf("tracker_queued=%llu\n", (unsigned long long)s.rows_queued);
+        tracker_close();
+    }
+    return 0;
+}
+'''
+
+def values(stdout):
+    out = {}
+    for line in stdout.splitlines():
+        key, sep, value = line.partition('=')
+        if sep and re.fullmatch(r'[a-z_]+', key):
+            out[key] = int(value) if re.fullmatch(r'-?\d+', value) else value
+    return out
+
+def main():
+    print("=== memwatch SQLite Sink Test ===\n")
+
+    ok = True
+    with tempfile.TemporaryDirectory() as tmp:
+        source = os.path.join(tmp, 'sink_prog.c')
+        binary = os.path.join(tmp, 'sink_prog')
+        with open(source, 'w') as f:
+            f.write(PROGRAM)
+        build = subprocess.run(['gcc', '-O2', '-I', os.path.join(ROOT, 'include'), source] +
+                               [os.path.join(ROOT, s) for s in SOURCES] +
+                               ['-o', binary, '-lpthread', '-lsqlite3', '-ldl'],
+                               capture_output=True, text=True)
+        if build.returncode != 0:
+            print("sink program did not build (needs sqlite3 headers) - skipping\n")
+            print(build.stderr[-500:])
+            return 0
+
+        def run(mode):
+            db = os.path.join(tmp, f'{mode}.db')
+            proc = subprocess.run([binary, mode, db], capture_output=True, text=True, timeout=120)
+            return proc, values(proc.stdout), db
+
+        # Test 1: WAL and value types
+        print("Test 1: WAL mode and value round-trip")
+        proc, v, db = run('types')
+        conn = sqlite3.connect(db)
+        mode = conn.execute("PRAGMA journal_mode").fetchone()[0]
+        rows = conn.execute("SELECT a, b, c, d, e FROM t").fetchall()
+        expected = [(-2 ** 63, 'it\'s "quoted"; DROP TABLE t;--', 2.5, b'\x00\x01\xfe\xff', None)]
+        print(f"✓ journal_mode={mode}, rows={rows}, bad stmt/sql -> {v.get('bad_stmt')}/{v.get('bad_sql')}")
+        if proc.returncode == 0 and mode == 'wal' and rows == expected and \
+                v.get('bad_stmt') == -1 and v.get('bad_sql') == -1 and v.get('flush') == 0:
+            print("✅ PASS: WAL database, values stored exactly\n")
+        else:
+            print("❌ FAIL: Values or journal mode wrong\n")
+            print(proc.stderr[-500:])
+            ok = False
+
+        # Test 2: Several producer threads
+        print("Test 2: 4 threads x 50000 rows")
+        proc, v, db = run('threads')
+        count, distinct = sqlite3.connect(db).execute("SELECT COUNT(*), COUNT(DISTINCT a) FROM t").fetchone()
+        rate = 200000 / max(v.get('store_us', 1), 1) * 1e6
+        print(f"✓ {count} rows ({distinct} distinct) in {v.get('batches')} transactions, "
+              f"queued in {v.get('queue_us', 0) / 1000:.1f} ms, stored at {rate:,.0f} rows/s")
+        threads = rate
+        if proc.returncode == 0 and count == distinct == 200000 and v.get('written') == 200000 and \
+                0 < v.get('batches', 0) < 2000:
+            print("✅ PASS: Every row stored, batched into transactions\n")
+        else:
+            print("❌ FAIL: Rows lost or not batched\n")
+            ok = False
+
+        # Test 3: Backpressure
+        print("Test 3: Full queue (4 KB halves)")
+        proc, v, db = run('full')
+        count = sqlite3.connect(db).execute("SELECT COUNT(*) FROM t").fetchone()[0]
+        print(f"✓ wait mode: {count} rows stored, {v.get('waits')} waits, too-large row -> {v.get('too_big')}")
+        waited = proc.returncode == 0 and count == 20000 and v.get('waits', 0) > 0 and \
+            v.get('too_big') == -1 and v.get('dropped') == 1
+        proc, v, db = run('drop')
+        count = sqlite3.connect(db).execute("SELECT COUNT(*) FROM t").fetchone()[0]
+        print(f"✓ drop mode: {count} rows stored, {v.get('dropped')} dropped, {v.get('waits')} waits")
+        dropped = proc.returncode == 0 and v.get('waits') == 0 and v.get('dropped', 0) > 1 and \
+            count == v.get('written') and count + v.get('dropped', 0) == 20001
+        if waited and dropped:
+            print("✅ PASS: Producers wait, or drop and count it\n")
+        else:
+            print("❌ FAIL: Backpressure accounting wrong\n")
+            ok = False
+
+        # Test 4: Against one prepare per row
+        print("Test 4: Throughput vs per-row prepare/finalize")
+        proc, v, db = run('baseline')
+        before = 2000 / max(v.get('baseline_us', 1), 1) * 1e6
+        print(f"✓ per-row: {before:,.0f} rows/s, sink: {threads:,.0f} rows/s ({threads / before:.0f}x)")
+        if proc.returncode == 0 and threads > 5 * before:
+            print("✅ PASS: Batched transactions are faster\n")
+        else:
+            print("❌ FAIL: Sink not faster than per-row inserts\n")
+            ok = False
+
+        # Test 5: Tracker SQL log
+        print("Test 5: Tracker SQL queries with quotes")
+        proc, v, db = run('tracker')
+        rows = sqlite3.connect(db).execute("SELECT query_text, query_type FROM sql_queries ORDER BY id").fetchall()
+        print(f"✓ {rows}")
+        if proc.returncode == 0 and rows == [("UPDATE users SET name = 'O''Brien' WHERE id = 1", 'UPDATE'),
+                                             ("SELECT 'a'');--'", 'SELECT')]:
+            print("✅ PASS: Queries stored verbatim\n")
+        else:
+            print("❌ FAIL: Query text altered or lost\n")
+            print(proc.stderr[-500:])
+            ok = False
+
+    print("=== Test Summary ===")
+    print("✅ All SQLite sink checks passed" if ok else "❌ Some checks failed")
+    return 0 if ok else 1
+
+if __name__ == '__main__':
+    sys.exit(main())
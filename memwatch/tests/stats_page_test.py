@@ -0,0 +1,304 @@
+#!/usr/bin/env python3
+"""
+Stats Page Test - memwatch
+
+With $MEMWATCH_STATS=<name> (or `memwatch run --stats <name>`) the engine
+publishes stage latencies and per-region/page counters to
+/dev/shm/memwatch-stats-<name>; `memwatch top` and `memwatch metrics` read
+it without touching the tracer. Verifies that:
+1. Histograms from many threads keep every sample, percentiles within a bucket
+2. `memwatch top --once` shows a live minimal-engine tracer, false faults included
+3. `memwatch metrics` prints Prometheus text, and serves it with --listen
+4. The page is unlinked on shutdown and a second tracer cannot take the name
+5. The Python core reports per-stage latencies in get_stats()
+"""
+
+import sys
+import os
+import re
+import subprocess
+import tempfile
+import time
+import urllib.request
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+sys.path.insert(0, os.path.join(ROOT, 'python'))
+
+HIST_PROGRAM = r'''
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "memwatch_stats.h"
+
+#define THREADS 24
+#define SAMPLES 100000
+
+static mw_stats_t stats;
+
+static void *record(void *arg) {
+    (void)arg;
+    for (uint64_t i = 1; i <= SAMPLES; i++) mw_stats_record(&stats, MW_STAGE_DIFF, i * 10);
+    return NULL;
+}
+
+int main(void) {
+    if (mw_stats_open(&stats, NULL, "test", "none") != 0) return 1;
+    pthread_t tids[THREADS];
+    for (int t = 0; t < THREADS; t++) pthread_create(&tids[t], NULL, record, NULL);
+    for (int t = 0; t < THREADS; t++) pthread_join(tids[t], NULL);
+
+    mw_stats_hist_t hist;
+    mw_stats_hist(&stats, MW_STAGE_DIFF, &hist);
+    printf("count=%llu max=%llu sum=%llu\n", (unsigned long long)hist.count,
+           (unsigned long long)hist.max_ns, (unsigned long long)hist.sum_ns);
+    printf("p50=%llu p90=%llu p99=%llu\n", (unsigned long long)mw_stats_hist_percentile(&hist, 50),
+           (unsigned long long)mw_stats_hist_percentile(&hist, 90),
+           (unsigned long long)mw_stats_hist_percentile(&hist, 99));
+    mw_stats_hist(&stats, MW_STAGE_CALLBACK, &hist);
+    printf("empty=%llu\n", (unsigned long long)mw_stats_hist_percentile(&hist, 99));
+    mw_stats_close(&stats);
+    return 0;
+}
+'''
+
+TRACER_PROGRAM = r'''
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "memwatch_unified.h"
+#include "memwatch_stats.h"
+
+static void on_change(const memwatch_change_event_t *event, void *ctx) {
+    (void)event; (void)ctx;
+    memwatch_record_stage(MW_STAGE_STORAGE, 5000);
+}
+
+int main(int argc, char **argv) {
+    int writes = atoi(argv[2]);
+    if (memwatch_init_backend(argv[1]) != 0) {
+        printf("init failed\n");
+        return 2;
+    }
+    memwatch_set_callback(on_change, NULL);
+    volatile uint64_t *page = mmap(NULL, 4096, PROT_READ | PROT_WRITE,
+                                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    page[0] = 1;
+    memwatch_watch((uint64_t)(uintptr_t)&page[0], 8, "counter", NULL);
+    memwatch_watch((uint64_t)(uintptr_t)&page[8], 8, "neighbour", NULL);
+    for (int i = 0; i < writes; i++) {
+        page[0] = (uint64_t)i + 2;
+        usleep(3000);
+    }
+    usleep(300000);   /* one publish period */
+
+    mw_stats_t again;
+    int second = mw_stats_open(&again, getenv("MEMWATCH_STATS"), "test", "none");
+    printf("second=%d errno=%d\nready\n", second, errno);
+    fflush(stdout);
+    char line[16];
+    if (!fgets(line, sizeof(line), stdin)) return 3;
+    memwatch_shutdown();
+    printf("done\n");
+    return 0;
+}
+'''
+
+CLI_SOURCES = ['src/memwatch_cli.c', 'src/memwatch_core_minimal.c', 'src/memwatch_backend.c',
+               'src/memwatch_sqlite_sink.c', 'src/memwatch_event_ring.c', 'src/memwatch_trace.c',
+               'src/memwatch_stats.c', 'src/faststorage_fast.c', 'src/memwatch_hash.c',
+               'src/memwatch_export.c', 'src/memwatch_lz4.c']
+CORE_SOURCES = ['src/memwatch_core_minimal.c', 'src/memwatch_backend.c', 'src/memwatch_stats.c']
+
+def values(stdout):
+    out = {}
+    for line in stdout.splitlines():
+        for key, value in re.findall(r'([a-z0-9]+)=(-?\d+)', line):
+            out.setdefault(key, int(value))
+    return out
+
+def build(sources, binary, extra=()):
+    return subprocess.run(['gcc', '-O2', '-I', os.path.join(ROOT, 'include'), '-o', binary] +
+                          list(sources) + list(extra) + ['-lpthread', '-lrt'],
+                          capture_output=True, text=True)
+
+def metric(text, name, labels=''):
+    m = re.search(r'^' + re.escape(name + labels) + r' (\S+)$', text, re.M)
+    return float(m.group(1)) if m else None
+
+def check_python():
+    try:
+        from memwatch import MemoryWatcher
+        import memwatch
+    except ImportError:
+        return None
+    if not getattr(memwatch, '_native', None):
+        return None
+    watcher = MemoryWatcher()
+    data = bytearray(4096 * 2)
+    events = []
+    watcher.set_callback(events.append)
+    watcher.watch(data, name='data')
+    for i in range(10):
+        data[0] = i + 1
+        time.sleep(0.015)
+    time.sleep(0.05)
+    stats = watcher.get_stats()
+    watcher.stop_all()
+    return stats, len(events)
+
+def main():
+    print("=== memwatch Stats Page Test ===\n")
+
+    ok = True
+    name = f"test{os.getpid()}"
+    with tempfile.TemporaryDirectory() as tmp:
+        # Test 1: Histograms
+        print("Test 1: 24 threads x 100000 samples of 10..1000000 ns")
+        source = os.path.join(tmp, 'hist.c')
+        binary = os.path.join(tmp, 'hist')
+        with open(source, 'w') as f:
+            f.write(HIST_PROGRAM)
+        result = build([source, os.path.join(ROOT, 'src/memwatch_stats.c')], binary)
+        if result.returncode != 0:
+            print("❌ FAIL: histogram program did not build\n")
+            print(result.stderr[-800:])
+            return 1
+        v = values(subprocess.run([binary], capture_output=True, text=True, timeout=60).stdout)
+        close = all(abs(v.get(f'p{p}', 0) - p * 10000) <= p * 10000 * 0.125 for p in (50, 90, 99))
+        print(f"✓ count={v.get('count')} max={v.get('max')} p50={v.get('p50')} p90={v.get('p90')} "
+              f"p99={v.get('p99')} empty={v.get('empty')}")
+        if v.get('count') == 2400000 and v.get('max') == 1000000 and \
+                v.get('sum') == 24 * 10 * 100000 * 100001 // 2 and close and v.get('empty') == 0:
+            print("✅ PASS: No sample lost, percentiles within 12.5%\n")
+        else:
+            print("❌ FAIL: Histogram lost samples or percentiles are off\n")
+            ok = False
+
+        # Tests 2-4 share one tracer and the CLI
+        cli = os.path.join(tmp, 'memwatch_cli')
+        tracer = os.path.join(tmp, 'tracer')
+        tracer_src = os.path.join(tmp, 'tracer.c')
+        with open(tracer_src, 'w') as f:
+            f.write(TRACER_PROGRAM)
+        build_cli = build([os.path.join(ROOT, s) for s in CLI_SOURCES], cli, ['-lsqlite3', '-ldl'])
+        build_tracer = build([tracer_src] + [os.path.join(ROOT, s) for s in CORE_SOURCES], tracer)
+        if build_cli.returncode != 0 or build_tracer.returncode != 0:
+            print("❌ FAIL: CLI or tracer did not build\n")
+            print((build_cli.stderr + build_tracer.stderr)[-800:])
+            return 1
+
+        env = dict(os.environ, MEMWATCH_STATS=name)
+        backend = 'uffd'
+        proc = subprocess.Popen([tracer, backend, '50'], stdin=subprocess.PIPE, stdout=subprocess.PIPE,
+                                text=True, env=env)
+        first = proc.stdout.readline()
+        if first.startswith('init failed'):
+            proc.communicate(timeout=60)
+            backend = 'mprotect'
+            print("(uffd unavailable, using mprotect)")
+            proc = subprocess.Popen([tracer, backend, '0'], stdin=subprocess.PIPE,
+                                    stdout=subprocess.PIPE, text=True, env=env)
+            first = proc.stdout.readline()
+        ready = proc.stdout.readline().strip() == 'ready'
+        writes = 50 if backend == 'uffd' else 0
+
+        print(f"Test 2: memwatch top --once ({backend}, {writes} writes next to a neighbour)")
+        top = subprocess.run([cli, 'top', '--once'], capture_output=True, text=True, timeout=60)
+        out = top.stdout
+        print(out)
+        counter = re.search(r'^\s+\d+\s+counter\s+0x[0-9a-f]+\s+8\s+(\d+)\s+([\d.]+)%\s+(\d+)', out, re.M)
+        neighbour = re.search(r'^\s+\d+\s+neighbour\s+0x[0-9a-f]+\s+8\s+(\d+)\s+([\d.]+)%\s+(\d+)', out, re.M)
+        storage = re.search(r'^\s+storage\s+(\d+)', out, re.M)
+        callbacks = re.search(r'^\s+callback\s+(\d+)', out, re.M)
+        live = re.search(rf'pid {proc.pid} \(minimal, {backend}\S*\) live', out) is not None
+        if writes:
+            # Both regions share the page: every fault checks both, and the callback runs for both
+            good = (ready and live and counter and neighbour and storage and callbacks and
+                    int(counter.group(1)) >= writes and float(counter.group(2)) == 0.0 and
+                    int(neighbour.group(1)) == int(counter.group(1)) and
+                    float(neighbour.group(2)) == 100.0 and
+                    int(storage.group(1)) == int(callbacks.group(1)) == 2 * int(counter.group(1)))
+        else:
+            good = ready and live and storage is not None
+        if top.returncode == 0 and good:
+            print("✅ PASS: Live counters, false faults and storage stage shown\n")
+        else:
+            print("❌ FAIL: top output wrong\n")
+            ok = False
+
+        print("Test 3: memwatch metrics, on stdout and over HTTP")
+        text = subprocess.run([cli, 'metrics', name], capture_output=True, text=True, timeout=60).stdout
+        server = subprocess.Popen([cli, 'metrics', name, '--listen', '127.0.0.1:0'],
+                                  stdout=subprocess.PIPE, text=True)
+        url = re.search(r'(http://\S+)', server.stdout.readline())
+        served = ''
+        missing = 0
+        if url:
+            served = urllib.request.urlopen(url.group(1), timeout=10).read().decode()
+            try:
+                urllib.request.urlopen(url.group(1).replace('/metrics', '/nope'), timeout=10)
+            except urllib.error.HTTPError as e:
+                missing = e.code
+        server.terminate()
+        server.wait(timeout=10)
+        up = metric(text, 'memwatch_up', f'{{pid="{proc.pid}",engine="minimal",backend="{backend}-wp"}}'
+                    if backend == 'uffd' else f'{{pid="{proc.pid}",engine="minimal",backend="{backend}"}}')
+        faults = metric(text, 'memwatch_faults_total')
+        false_faults = metric(served, 'memwatch_false_faults_total')
+        stored = metric(served, 'memwatch_stage_seconds_count', '{stage="storage"}')
+        typed = '# TYPE memwatch_stage_seconds summary' in text
+        print(f"✓ up={up} faults={faults} false={false_faults} storage={stored} "
+              f"summary typed: {typed}, unknown path -> {missing}")
+        if up == 1 and typed and missing == 404 and \
+                (not writes or (faults >= writes and false_faults == faults and stored == 2 * faults)):
+            print("✅ PASS: Prometheus text on stdout and GET /metrics\n")
+        else:
+            print("❌ FAIL: metrics output wrong\n")
+            print(text[:1500])
+            ok = False
+
+        print("Test 4: Name ownership and unlink on shutdown")
+        v = values(first)
+        proc.stdin.write('go\n')
+        proc.stdin.flush()
+        done = proc.communicate(timeout=60)[0].strip() == 'done'
+        gone = not os.path.exists(f"/dev/shm/memwatch-stats-{name}")
+        after = subprocess.run([cli, 'top', name, '--once'], capture_output=True, text=True, timeout=60)
+        print(f"✓ second tracer -> {v.get('second')} (errno {v.get('errno')}), unlinked: {gone}, "
+              f"top afterwards -> {after.returncode}")
+        if v.get('second') == -1 and v.get('errno') == 17 and done and gone and after.returncode == 1:
+            print("✅ PASS: One tracer per name, page removed on shutdown\n")
+        else:
+            print("❌ FAIL: Name or cleanup handling wrong\n")
+            ok = False
+
+    # Test 5: Python core
+    print("Test 5: get_stats() stages from the Python core")
+    result = check_python()
+    if result is None:
+        print("native module not built - skipping\n")
+    else:
+        stats, events = result
+        stages = stats.get('stages', {})
+        print(f"✓ {events} events, faults={stats.get('faults')}, " +
+              ", ".join(f"{k}={s['count']}" for k, s in stages.items()))
+        if events and set(stages) == {'enqueue', 'queue_wait', 'diff', 'callback', 'storage'} and \
+                stages['queue_wait']['count'] > 0 and stages['callback']['count'] >= events and \
+                stages['diff']['p99_ns'] >= stages['diff']['p50_ns'] > 0 and \
+                stats.get('stats_page') is None:
+            print("✅ PASS: Stage latencies reported\n")
+        else:
+            print("❌ FAIL: Stage latencies missing\n")
+            ok = False
+
+    print("=== Test Summary ===")
+    print("✅ All stats page checks passed" if ok else "❌ Some stats page checks failed")
+    return 0 if ok else 1
+
+if __name__ == '__main__':
+    sys.exit(main())
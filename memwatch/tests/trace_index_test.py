@@ -0,0 +1,479 @@
+#!/usr/bin/env python3
+"""
+Trace Index Test - memwatch
+
+memwatch_trace keeps a keyframe of each region every keyframe_interval
+changes and the deltas in between, in a FastStorage store. Verifies that:
+1. state_at() matches a full replay at random times, applying at most
+   keyframe_interval deltas, across segments and index chunks
+2. Cursors step forward and back through every change, undoing exactly
+3. The trace survives closing and reopening the store
+4. state_at() costs the same on long and short traces (replay grows
+   linearly); MEMWATCH_TRACE_EVENTS sets the long trace's length
+5. The Python API records ChangeEvents and travels through them
+6. `memwatch state` lists regions and walks one from a point in time
+"""
+
+import sys
+import os
+import json
+import random
+import re
+import subprocess
+import tempfile
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+LIBRARY = os.path.join(ROOT, 'build', 'libfaststorage.so')
+sys.path.insert(0, os.path.join(ROOT, 'python'))
+
+BENCH_EVENTS = int(os.environ.get('MEMWATCH_TRACE_EVENTS', 2000000))
+
+PROGRAM = r'''
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "memwatch_trace.h"
+
+#define NREG 4
+#define MB (1024 * 1024)
+
+static uint64_t rng = 88172645463325252ULL;
+static uint64_t next(void) {
+    rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+    return rng;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+typedef struct {
+    uint64_t ts;
+    uint32_t region, offset, len;
+    uint64_t data;             /* into pool */
+} logrec_t;
+
+static const size_t sizes[NREG] = { 8, 100, 4096, 120000 };
+static uint8_t *init[NREG];
+static logrec_t *log_;
+static uint8_t *pool;
+static size_t nlog;
+
+static void replay(uint32_t r, uint64_t t, uint8_t *out) {
+    memcpy(out, init[r], sizes[r]);
+    for (size_t i = 0; i < nlog && log_[i].ts <= t; i++) {
+        if (log_[i].region == r) memcpy(out + log_[i].offset, pool + log_[i].data, log_[i].len);
+    }
+}
+
+static int verify(const char *path, int events, uint32_t interval) {
+    FastStorage *fs = faststorage_create(path, 64 * MB);
+    mw_trace_writer_t *w = mw_trace_writer_open(fs, interval);
+    uint8_t *shadow[NREG];
+    uint8_t *history[2];          /* regions 0 and 1 after each change */
+    size_t changes[NREG] = { 0 };
+    for (int r = 0; r < NREG; r++) {
+        init[r] = malloc(sizes[r]);
+        shadow[r] = malloc(sizes[r]);
+        for (size_t i = 0; i < sizes[r]; i++) init[r][i] = (uint8_t)next();
+        memcpy(shadow[r], init[r], sizes[r]);
+        char name[16];
+        snprintf(name, sizeof(name), "var_%d", r);
+        if (mw_trace_add_region(w, 10 + r, name, init[r], sizes[r], 1000) != 0) return 1;
+    }
+    printf("duplicate=%d\n", mw_trace_add_region(w, 10, "again", init[0], 8, 0));
+    for (int r = 0; r < 2; r++) {
+        history[r] = malloc(sizes[r] * (events + 1));
+        memcpy(history[r], init[r], sizes[r]);
+    }
+    log_ = malloc(sizeof(logrec_t) * events);
+    pool = malloc((size_t)events * 32);
+
+    int noops = 0;
+    for (int i = 0; i < events; i++) {
+        /* The big region gets few writes: each keyframe of it is 120 KB */
+        uint32_t r = next() % 64 == 0 ? NREG - 1 : next() % (NREG - 1);
+        uint32_t len = 1 + next() % (sizes[r] < 32 ? sizes[r] : 32);
+        uint32_t offset = next() % (sizes[r] - len + 1);
+        uint8_t *data = pool + (size_t)i * 32;
+        if (next() % 10 == 0) {
+            memcpy(data, shadow[r] + offset, len);
+            noops++;
+        } else {
+            for (uint32_t j = 0; j < len; j++) data[j] = (uint8_t)next();
+        }
+        uint64_t ts = 2000 + (uint64_t)(i / 3) * 10;
+        if (mw_trace_record(w, 10 + r, ts, offset, data, len) != 0) return 2;
+        bool changed = memcmp(shadow[r] + offset, data, len) != 0;
+        memcpy(shadow[r] + offset, data, len);
+        log_[nlog++] = (logrec_t){ ts, r, offset, len, (uint64_t)i * 32 };
+        if (changed && r < 2) {
+            changes[r]++;
+            memcpy(history[r] + changes[r] * sizes[r], shadow[r], sizes[r]);
+        }
+        if (i == events / 2) mw_trace_writer_flush(w);
+    }
+    printf("outside=%d\n", mw_trace_record(w, 10, 0, 4, pool, 8));
+    mw_trace_writer_flush(w);
+    mw_trace_stats_t stats;
+    mw_trace_writer_stats(w, &stats);
+    printf("events=%llu skipped=%llu noops=%d segments=%llu\n", (unsigned long long)stats.events,
+           (unsigned long long)stats.skipped, noops, (unsigned long long)stats.segments);
+
+    mw_trace_t *t = mw_trace_open(fs);
+    uint64_t last = log_[nlog - 1].ts;
+    uint8_t *got = malloc(sizes[NREG - 1]), *want = malloc(sizes[NREG - 1]);
+    int mismatches = 0, max_applied = 0;
+    for (int q = 0; q < 600; q++) {
+        uint32_t r = next() % NREG;
+        uint64_t at = next() % (last + 1000);
+        int applied = mw_trace_state_at(t, 10 + r, at, got, sizes[r]);
+        replay(r, at, want);
+        if (applied < 0 || memcmp(got, want, sizes[r]) != 0) mismatches++;
+        if (applied > max_applied) max_applied = applied;
+    }
+    printf("mismatches=%d maxapplied=%d small=%d\n", mismatches, max_applied,
+           mw_trace_state_at(t, 13, 0, got, 10));
+
+    /* Walk regions 0 and 1 from random points */
+    int cursor_bad = 0, steps = 0;
+    for (int s = 0; s < 40; s++) {
+        uint32_t r = s % 2;
+        uint64_t at = s < 2 ? 0 : next() % (last + 1000);
+        mw_trace_cursor_t *c = mw_trace_seek(t, 10 + r, at);
+        mw_trace_position_t pos;
+        size_t len;
+        mw_trace_cursor_position(c, &pos);
+        replay(r, at, want);
+        if (memcmp(mw_trace_cursor_state(c, &len), want, sizes[r]) != 0 || len != sizes[r]) cursor_bad++;
+        for (int k = 0; k < 300; k++) {
+            int moved = k < 200 ? mw_trace_step_forward(c) : mw_trace_step_back(c);
+            mw_trace_cursor_position(c, &pos);
+            if (moved < 0 || pos.seq > changes[r] ||
+                memcmp(mw_trace_cursor_state(c, NULL), history[r] + pos.seq * sizes[r], sizes[r]) != 0) {
+                cursor_bad++;
+            }
+            steps += moved == 1;
+        }
+        /* Rewind to the start; the initial bytes come back */
+        while (mw_trace_step_back(c) == 1) steps++;
+        mw_trace_cursor_position(c, &pos);
+        if (pos.seq != 0 || pos.timestamp_ns != 1000 || memcmp(mw_trace_cursor_state(c, NULL), init[r], sizes[r]) != 0) {
+            cursor_bad++;
+        }
+        mw_trace_cursor_free(c);
+    }
+    printf("cursorbad=%d steps=%d\n", cursor_bad, steps);
+
+    mw_trace_close(t);
+    mw_trace_writer_close(w);
+    faststorage_destroy(fs);
+
+    fs = faststorage_create(path, 64 * MB);
+    t = mw_trace_open(fs);
+    int reopened = t != NULL;
+    mw_trace_region_t regions[8];
+    int count = t ? mw_trace_regions(t, regions, 8) : 0;
+    for (int r = 0; r < NREG && t; r++) {
+        if (mw_trace_state_at(t, 10 + r, UINT64_MAX, got, sizes[r]) < 0 ||
+            memcmp(got, shadow[r], sizes[r]) != 0 || regions[r].id != (uint32_t)(10 + r) ||
+            regions[r].size != sizes[r] || strncmp(regions[r].name, "var_", 4) != 0) {
+            reopened = 0;
+        }
+    }
+    printf("reopen=%d regions=%d\n", reopened, count);
+    mw_trace_close(t);
+    faststorage_destroy(fs);
+    return 0;
+}
+
+static int bench(const char *path, long events, uint32_t interval) {
+    const size_t size = 4096;
+    const long kept = events < 4000000 ? events : 4000000;
+    FastStorage *fs = faststorage_create(path, 64 * MB);
+    mw_trace_writer_t *w = mw_trace_writer_open(fs, interval);
+    uint8_t *state = calloc(1, size), *got = malloc(size);
+    mw_trace_add_region(w, 1, "buffer", state, size, 0);
+    logrec_t *log = malloc(sizeof(logrec_t) * kept);
+    uint64_t *values = malloc(sizeof(uint64_t) * kept);
+
+    uint64_t start = now_ns();
+    for (long i = 0; i < events; i++) {
+        uint64_t v = next() | 1;
+        uint32_t offset = (uint32_t)(next() % (size / 8)) * 8;
+        mw_trace_record(w, 1, 1000 + (uint64_t)i * 1000, offset, &v, 8);
+        if (i < kept) {
+            log[i] = (logrec_t){ 1000 + (uint64_t)i * 1000, 1, offset, 8, (uint64_t)i };
+            values[i] = v;
+        }
+    }
+    mw_trace_writer_flush(w);
+    uint64_t record_ns = now_ns() - start;
+
+    mw_trace_t *t = mw_trace_open(fs);
+    enum { Q = 2000 };
+    static uint64_t lat[Q];
+    int max_applied = 0;
+    for (int q = 0; q < Q; q++) {
+        uint64_t at = next() % (1000 + (uint64_t)events * 1000);
+        uint64_t t0 = now_ns();
+        int applied = mw_trace_state_at(t, 1, at, got, size);
+        lat[q] = now_ns() - t0;
+        if (applied > max_applied) max_applied = applied;
+    }
+    qsort(lat, Q, sizeof(uint64_t), cmp_u64);
+
+    /* Linear replay of the whole trace, the alternative to the index */
+    start = now_ns();
+    memset(state, 0, size);
+    for (long i = 0; i < kept; i++) memcpy(state + log[i].offset, &values[i], 8);
+    uint64_t replay_ns = (uint64_t)((double)(now_ns() - start) * events / kept);
+    volatile uint8_t sink = state[0];
+    (void)sink;
+
+    mw_trace_cursor_t *c = mw_trace_seek(t, 1, (uint64_t)events * 500);
+    start = now_ns();
+    int moved = 0;
+    for (int i = 0; i < 100000; i++) moved += mw_trace_step_forward(c);
+    for (int i = 0; i < 100000; i++) moved += mw_trace_step_back(c);
+    uint64_t step_ns = (now_ns() - start) / (moved ? moved : 1);
+    mw_trace_cursor_free(c);
+
+    struct stat st;
+    stat(path, &st);
+    printf("rate=%llu query=%llu pninetynine=%llu replay=%llu step=%llu maxapplied=%d storemb=%lld\n",
+           (unsigned long long)(events * 1e9 / record_ns), (unsigned long long)lat[Q / 2],
+           (unsigned long long)lat[Q * 99 / 100], (unsigned long long)replay_ns,
+           (unsigned long long)step_ns, max_applied, (long long)(st.st_size / MB));
+    mw_trace_close(t);
+    mw_trace_writer_close(w);
+    faststorage_destroy(fs);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (strcmp(argv[1], "verify") == 0) return verify(argv[2], atoi(argv[3]), (uint32_t)atoi(argv[4]));
+    return bench(argv[2], atol(argv[3]), (uint32_t)atoi(argv[4]));
+}
+'''
+
+CLI_SOURCES = ['src/memwatch_cli.c', 'src/memwatch_core_minimal.c', 'src/memwatch_backend.c',
+               'src/memwatch_sqlite_sink.c', 'src/memwatch_event_ring.c', 'src/memwatch_trace.c',
+               'src/memwatch_stats.c', 'src/faststorage_fast.c', 'src/memwatch_hash.c',
+               'src/memwatch_export.c', 'src/memwatch_lz4.c']
+
+def values(stdout):
+    out = {}
+    for line in stdout.splitlines():
+        for key, value in re.findall(r'([a-z]+)=(-?\d+)', line):
+            out.setdefault(key, int(value))
+    return out
+
+def main():
+    print("=== memwatch Trace Index Test ===\n")
+
+    ok = True
+    with tempfile.TemporaryDirectory() as tmp:
+        source = os.path.join(tmp, 'trace_prog.c')
+        binary = os.path.join(tmp, 'trace_prog')
+        with open(source, 'w') as f:
+            f.write(PROGRAM)
+        build = subprocess.run(['gcc', '-O2', '-I', os.path.join(ROOT, 'include'), source,
+                                os.path.join(ROOT, 'src/memwatch_trace.c'),
+                                os.path.join(ROOT, 'src/faststorage_fast.c'),
+                                os.path.join(ROOT, 'src/memwatch_hash.c'), '-o', binary,
+                                '-lpthread'], capture_output=True, text=True)
+        if build.returncode != 0:
+            print("trace program did not build - skipping\n")
+            print(build.stderr[-500:])
+            return 0
+
+        # Tests 1-3: one run, checked three ways
+        interval = 4
+        run = subprocess.run([binary, 'verify', os.path.join(tmp, 'verify.fs'), '60000', str(interval)],
+                             capture_output=True, text=True, timeout=600)
+        v = values(run.stdout)
+        if run.returncode != 0:
+            print(f"verify run failed ({run.returncode}): {run.stderr[-300:]}")
+
+        print(f"Test 1: state_at() against full replay (interval {interval})")
+        print(f"✓ {v.get('events')} changes in {v.get('segments')} segments, "
+              f"{v.get('skipped')} no-op writes skipped of {v.get('noops')}; "
+              f"600 queries: {v.get('mismatches')} mismatches, at most {v.get('maxapplied')} deltas applied")
+        print(f"✓ duplicate region -> {v.get('duplicate')}, write outside region -> {v.get('outside')}, "
+              f"short buffer -> {v.get('small')}")
+        if v.get('mismatches') == 0 and 0 < v.get('maxapplied', 0) <= interval and \
+                v.get('segments', 0) > 2048 and v.get('skipped', 0) >= v.get('noops', 1) and \
+                v.get('duplicate') == v.get('outside') == v.get('small') == -1:
+            print("✅ PASS: Keyframe + bounded deltas reproduce every state\n")
+        else:
+            print("❌ FAIL: Reconstructed state differs\n")
+            ok = False
+
+        print("Test 2: Cursor steps")
+        print(f"✓ {v.get('steps')} steps across segment boundaries, {v.get('cursorbad')} wrong states")
+        if v.get('cursorbad') == 0 and v.get('steps', 0) > 10000:
+            print("✅ PASS: Forward and back are exact inverses\n")
+        else:
+            print("❌ FAIL: Cursor lost its place\n")
+            ok = False
+
+        print("Test 3: Reopen the store")
+        print(f"✓ reopened={v.get('reopen')}, regions={v.get('regions')}")
+        if v.get('reopen') == 1 and v.get('regions') == 4:
+            print("✅ PASS: Trace persisted\n")
+        else:
+            print("❌ FAIL: Trace lost on reopen\n")
+            ok = False
+
+        # Test 4: cost against trace length
+        print(f"Test 4: {BENCH_EVENTS // 10} vs {BENCH_EVENTS} changes to one 4 KB region")
+        results = []
+        for events in (BENCH_EVENTS // 10, BENCH_EVENTS):
+            store = os.path.join(tmp, f'bench{events}.fs')
+            run = subprocess.run([binary, 'bench', store, str(events), '256'],
+                                 capture_output=True, text=True, timeout=3600)
+            os.unlink(store)
+            b = values(run.stdout)
+            results.append(b)
+            print(f"✓ {events}: record {b.get('rate', 0) / 1e6:.2f} M/s, state_at median "
+                  f"{b.get('query', 0) / 1000:.1f} us (p99 {b.get('pninetynine', 0) / 1000:.1f} us, "
+                  f"<= {b.get('maxapplied')} deltas), full replay {b.get('replay', 0) / 1e6:.1f} ms, "
+                  f"step {b.get('step')} ns, store {b.get('storemb')} MB")
+        short, long_ = results
+        growth = long_.get('query', 1) / max(short.get('query', 1), 1)
+        print(f"✓ 10x the events: state_at x{growth:.2f}, "
+              f"replay x{long_.get('replay', 0) / max(short.get('replay', 1), 1):.1f}")
+        if growth < 3 and long_.get('maxapplied', 999) <= 256 and \
+                long_.get('query', 0) * 10 < long_.get('replay', 0):
+            print("✅ PASS: Reconstruction cost doesn't grow with the trace\n")
+        else:
+            print("❌ FAIL: state_at() scales with trace length\n")
+            ok = False
+
+        # Test 5: Python API
+        print("Test 5: memwatch.trace from Python")
+        os.environ.setdefault('MEMWATCH_FASTSTORAGE_LIB', LIBRARY)
+        if not os.path.exists(LIBRARY):
+            subprocess.run(['make', '-C', ROOT, 'build-faststorage'], capture_output=True)
+        from memwatch.faststorage import FastStorage
+        from memwatch.trace import TraceWriter, Trace
+        from memwatch import ChangeEvent
+        rand = random.Random(7)
+        small = bytearray(rand.randbytes(64))
+        large = bytearray(rand.randbytes(200000))
+        initial = {1: bytes(small), 2: bytes(large)}
+        history = {1: [(100, bytes(small))], 2: [(100, bytes(large))]}
+        store_path = os.path.join(tmp, 'py.trace')
+        with FastStorage(store_path, 64 << 20) as store:
+            writer = TraceWriter(store, keyframe_interval=16)
+            first = ChangeEvent.from_dict({'region_id': 1, 'timestamp_ns': 100, 'variable_name': 'small',
+                                           'old_value': bytes(small), 'new_value': bytes(small)})
+            writer.record_event(first)
+            writer.add_region(2, large, 'large', 100)
+            for i in range(3000):
+                ts = 200 + i * 10
+                if i % 2:
+                    offset = rand.randrange(64)
+                    small[offset] = (small[offset] + 1 + rand.randrange(255)) % 256
+                    event = ChangeEvent.from_dict({'region_id': 1, 'timestamp_ns': ts,
+                                                   'new_value': bytes(small)})
+                    history[1].append((ts, bytes(small)))
+                else:
+                    ranges = []
+                    delta = b''
+                    for _ in range(2):
+                        offset = rand.randrange(len(large) - 16)
+                        chunk = rand.randbytes(16)
+                        large[offset:offset + 16] = chunk
+                        ranges.append((offset, 16))
+                        delta += chunk
+                    event = ChangeEvent.from_dict({'region_id': 2, 'timestamp_ns': ts,
+                                                   'ranges': ranges, 'delta': delta})
+                    history[2].append((ts, bytes(large)))
+                writer.record_event(event)
+            stats = writer.stats
+            writer.close()
+
+            trace = Trace(store)
+            regions = {r.id: r for r in trace.regions()}
+            bad = 0
+            for _ in range(200):
+                region = rand.choice((1, 2))
+                at = rand.randrange(100, 31000)
+                want = [s for ts, s in history[region] if ts <= at][-1]
+                bad += trace.state_at(region, at) != want
+            with trace.cursor(1, 10000) as cursor:
+                seq = cursor.seq
+                at_ok = cursor.state == history[1][seq][1]
+                forward = cursor.forward(5)
+                fwd_ok = cursor.state == history[1][seq + 5][1] and cursor.timestamp_ns == history[1][seq + 5][0]
+                back = cursor.back(10)
+                back_ok = cursor.state == history[1][seq - 5][1]
+                rewound = cursor.back(100000)
+                start_ok = cursor.state == initial[1] and cursor.seq == 0
+            trace.close()
+            print(f"✓ regions {sorted(regions)} ({regions[1].name}, {regions[2].name}), {stats['events']} changes, "
+                  f"200 random state_at(): {bad} wrong")
+            print(f"✓ cursor at seq {seq}: state ok={at_ok}, forward {forward} ok={fwd_ok}, "
+                  f"back {back} ok={back_ok}, rewound {rewound} to the initial bytes={start_ok}")
+            if bad == 0 and at_ok and fwd_ok and back_ok and start_ok and forward == 5 and \
+                    regions[1].name == 'small' and regions[2].events == 3000:
+                print("✅ PASS: Python records and travels\n")
+            else:
+                print("❌ FAIL: Python API wrong\n")
+                ok = False
+
+            with Trace(store) as trace:
+                expected = trace.state_at(1, 10000)
+
+        # Test 6: memwatch state
+        print("Test 6: memwatch state")
+        cli = os.path.join(tmp, 'memwatch_cli')
+        build = subprocess.run(['gcc', '-O2', '-I', os.path.join(ROOT, 'include'), '-o', cli] +
+                               [os.path.join(ROOT, s) for s in CLI_SOURCES] +
+                               ['-lsqlite3', '-lpthread', '-ldl', '-lrt'], capture_output=True, text=True)
+        if build.returncode != 0:
+            print("CLI did not build - skipping\n")
+            print(build.stderr[-500:])
+        else:
+            listing = subprocess.run([cli, 'state', store_path], capture_output=True, text=True, timeout=60)
+            walk = subprocess.run([cli, 'state', store_path, '--region', '1', '--at', '10000',
+                                   '--forward', '2', '--back', '1', '--format', 'json'],
+                                  capture_output=True, text=True, timeout=60)
+            steps = [json.loads(line) for line in walk.stdout.splitlines() if line.startswith('{')]
+            missing = subprocess.run([cli, 'state', os.path.join(tmp, 'nope.trace')],
+                                     capture_output=True, text=True, timeout=60)
+            listed = 'Total regions: 2' in listing.stdout and '[2] large' in listing.stdout
+            walked = len(steps) == 4 and steps[0]['state'] == expected[:64].hex() and \
+                steps[0]['timestamp_ns'] <= 10000 and steps[3]['seq'] == steps[0]['seq'] + 1 and \
+                steps[2]['seq'] == steps[0]['seq'] + 2
+            print(f"✓ listed regions={listed}, {len(steps)} states printed, walk consistent={walked}, "
+                  f"missing trace exit={missing.returncode}")
+            if listed and walked and missing.returncode == 1 and not os.path.exists(os.path.join(tmp, 'nope.trace')):
+                print("✅ PASS: CLI time travel works\n")
+            else:
+                print("❌ FAIL: memwatch state output wrong\n")
+                print(listing.stdout[-400:], walk.stdout[-400:], walk.stderr[-200:])
+                ok = False
+
+    print("=== Test Summary ===")
+    if ok:
+        print("✅ All trace index checks passed")
+        return 0
+    print("❌ Some trace index checks failed")
+    return 1
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,242 @@
+#!/usr/bin/env python3
+"""
+Tracker Scan Test - memwatch
+
+memwatch_tracker's monitor thread diffs each region's snapshot in place
+with the shared SIMD kernels and spreads regions over a scan pool with
+per-region locks. Verifies that:
+1. Every diff kernel reports the same changed ranges as the scalar one
+2. Changes are reported with exact offsets and values, past 256 regions
+3. A multi-threaded scan pool finds the same changes
+4. Large unchanged regions sweep quickly and report nothing
+5. watch/unwatch does not wait for a sweep of other regions
+6. Bursts beyond one event buffer are printed and stored in full
+"""
+
+import sys
+import os
+import re
+import sqlite3
+import subprocess
+import tempfile
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+SOURCES = ['src/memwatch_tracker.c', 'src/memwatch_backend.c', 'src/memwatch_diff.c', 'src/memwatch_sqlite_sink.c']
+
+PROGRAM = r'''
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "memwatch_tracker.h"
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void stats(void) {
+    tracker_scan_stats_t s;
+    tracker_get_scan_stats(&s);
+    printf("sweeps=%llu\nlast_sweep_us=%llu\nbytes_compared=%llu\nchanges=%llu\nthreads=%d\nkernel=%s\n",
+           (unsigned long long)s.sweeps, (unsigned long long)(s.last_sweep_ns / 1000),
+           (unsigned long long)s.bytes_compared, (unsigned long long)s.changes,
+           s.scan_threads, s.diff_kernel);
+}
+
+int main(int argc, char **argv) {
+    const char *mode = argv[1];
+    if (tracker_init(argv[2], true, false, false, "both") != 0) return 1;
+
+    if (strcmp(mode, "many") == 0) {
+        /* 1000 regions of 200 bytes; every 100th gets two words changed */
+        static uint8_t blocks[1000][200];
+        for (int i = 0; i < 1000; i++) {
+            char name[32];
+            snprintf(name, sizeof(name), "r%d", i);
+            if (tracker_watch((uint64_t)(uintptr_t)blocks[i], sizeof(blocks[i]), name) != i) return 2;
+        }
+        usleep(50000);
+        for (int i = 0; i < 1000; i += 100) {
+            uint64_t a = 0x1000 + i, b = 0xB0000000 + i;
+            memcpy(blocks[i] + 8 * (i % 24), &a, 8);
+            memcpy(blocks[i] + 192, &b, 8);      /* last (partial-line) word */
+        }
+        usleep(100000);
+    } else if (strcmp(mode, "large") == 0) {
+        /* 64 MB over 8 regions, untouched but for one word */
+        size_t size = 8u << 20;
+        uint8_t *big[8];
+        for (int i = 0; i < 8; i++) {
+            big[i] = calloc(1, size);
+            char name[32];
+            snprintf(name, sizeof(name), "big%d", i);
+            tracker_watch((uint64_t)(uintptr_t)big[i], size, name);
+        }
+        usleep(100000);
+        big[5][size - 8] = 0x42;
+        usleep(100000);
+        stats();
+        tracker_close();
+        return 0;
+    } else if (strcmp(mode, "churn") == 0) {
+        /* Watch/unwatch small buffers while 64 MB is being swept */
+        size_t size = 64u << 20;
+        uint8_t *big = calloc(1, size);
+        tracker_watch((uint64_t)(uintptr_t)big, size, "big");
+        static uint8_t small[4096];
+        uint64_t worst = 0, total = 0;
+        int rounds = 2000;
+        for (int i = 0; i < rounds; i++) {
+            uint64_t t0 = now_ns();
+            int id = tracker_watch((uint64_t)(uintptr_t)small, sizeof(small), "small");
+            tracker_unwatch(id);
+            uint64_t t = now_ns() - t0;
+            total += t;
+            if (t > worst) worst = t;
+            if (i % 100 == 0) usleep(1000);
+        }
+        printf("churn_mean_us=%llu\nchurn_worst_us=%llu\n",
+               (unsigned long long)(total / rounds / 1000), (unsigned long long)(worst / 1000));
+    } else if (strcmp(mode, "burst") == 0) {
+        /* 5000 changed words in one region: more than one event buffer */
+        static uint64_t words[5000];
+        tracker_watch((uint64_t)(uintptr_t)words, sizeof(words), "burst");
+        usleep(50000);
+        for (int i = 0; i < 5000; i++) words[i] = 0xC000000000000000ULL | i;
+        usleep(200000);
+    }
+
+    stats();
+    tracker_close();
+    return 0;
+}
+'''
+
+def values(stdout):
+    out = {}
+    for line in stdout.splitlines():
+        key, sep, value = line.partition('=')
+        if sep and re.fullmatch(r'[a-z_]+', key):
+            out[key] = int(value) if value.isdigit() else value
+    return out
+
+def tracked(stdout):
+    return re.findall(r'\[TRACKED\] (\S+)\[(\d+)\]: 0x([0-9a-f]+) -> 0x([0-9a-f]+)', stdout)
+
+def main():
+    print("=== memwatch Tracker Scan Test ===\n")
+
+    ok = True
+    with tempfile.TemporaryDirectory() as tmp:
+        source = os.path.join(tmp, 'scan_prog.c')
+        binary = os.path.join(tmp, 'scan_prog')
+        with open(source, 'w') as f:
+            f.write(PROGRAM)
+        build = subprocess.run(['gcc', '-O2', '-I', os.path.join(ROOT, 'include'), source] +
+                               [os.path.join(ROOT, s) for s in SOURCES] +
+                               ['-o', binary, '-lpthread', '-lsqlite3', '-ldl'],
+                               capture_output=True, text=True)
+        if build.returncode != 0:
+            print("tracker program did not build (needs sqlite3 headers) - skipping\n")
+            print(build.stderr[-500:])
+            return 0
+
+        def run(mode, **env):
+            db = os.path.join(tmp, f'{mode}.db')
+            if os.path.exists(db):
+                os.unlink(db)
+            proc = subprocess.run([binary, mode, db], capture_output=True, text=True,
+                                  env=dict(os.environ, **env), timeout=120)
+            return proc, db
+
+        # Test 1: Kernels
+        print("Test 1: Diff kernels agree")
+        bench = subprocess.run(['make', '-C', ROOT, '-s', 'bench-diff'], capture_output=True, text=True)
+        rows = [l for l in bench.stdout.splitlines() if re.match(r'(scalar|sse2|avx2|avx512|neon) ', l)]
+        for row in rows:
+            print(f"  {row}")
+        if bench.returncode == 0 and rows:
+            print(f"✅ PASS: {len(rows)} kernels match the scalar ranges\n")
+        else:
+            print(f"❌ FAIL: Kernel mismatch\n{bench.stderr[-500:]}\n")
+            ok = False
+
+        # Test 2: Many regions
+        print("Test 2: 1000 regions, exact changes")
+        proc, db = run('many', MEMWATCH_SCAN_THREADS='1')
+        expected = set()
+        for i in range(0, 1000, 100):
+            expected.add((f'r{i}', str(8 * (i % 24)), '0', f'{0x1000 + i:x}'))
+            expected.add((f'r{i}', '192', '0', f'{0xB0000000 + i:x}'))
+        found = set(tracked(proc.stdout))
+        single = found
+        print(f"✓ {len(found)} changes reported, expected {len(expected)}, exit={proc.returncode}")
+        if found == expected and proc.returncode == 0:
+            print("✅ PASS: Offsets and values exact beyond the old 256-region cap\n")
+        else:
+            print(f"❌ FAIL: Wrong changes: missing {sorted(expected - found)[:4]}, "
+                  f"extra {sorted(found - expected)[:4]}\n")
+            ok = False
+
+        # Test 3: Scan pool
+        print("Test 3: Scan pool")
+        proc, db = run('many', MEMWATCH_SCAN_THREADS='3')
+        v = values(proc.stdout)
+        pooled = set(tracked(proc.stdout))
+        print(f"✓ threads={v.get('threads')}, {len(pooled)} changes, same as one thread={pooled == single}")
+        if v.get('threads') == 3 and pooled == expected:
+            print("✅ PASS: Pool finds the same changes\n")
+        else:
+            print("❌ FAIL: Pool results differ\n")
+            ok = False
+
+        # Test 4: Large regions
+        print("Test 4: 64 MB tracked")
+        proc, db = run('large')
+        v = values(proc.stdout)
+        found = tracked(proc.stdout)
+        print(f"✓ kernel={v.get('kernel')}, {v.get('sweeps')} sweeps, last {v.get('last_sweep_us')} us, "
+              f"{v.get('bytes_compared', 0) >> 20} MB compared, changes={found}")
+        if found == [('big5', str((8 << 20) - 8), '0', '42')] and v.get('sweeps', 0) > 0 and \
+                v.get('last_sweep_us', 10 ** 9) < 100000:
+            print("✅ PASS: Unchanged lines skipped, one change found\n")
+        else:
+            print("❌ FAIL: Large sweep wrong\n")
+            ok = False
+
+        # Test 5: Churn
+        print("Test 5: watch/unwatch during sweeps")
+        proc, db = run('churn')
+        v = values(proc.stdout)
+        print(f"✓ watch+unwatch mean {v.get('churn_mean_us')} us, worst {v.get('churn_worst_us')} us, "
+              f"sweep {v.get('last_sweep_us')} us")
+        if proc.returncode == 0 and v.get('churn_mean_us', 10 ** 9) < 1000:
+            print("✅ PASS: Region updates skip the sweep lock\n")
+        else:
+            print("❌ FAIL: watch/unwatch blocked by sweeps\n")
+            ok = False
+
+        # Test 6: Burst
+        print("Test 6: 5000-change burst")
+        proc, db = run('burst')
+        found = tracked(proc.stdout)
+        offsets = sorted(int(f[1]) for f in found)
+        rows = sqlite3.connect(db).execute(
+            "SELECT COUNT(*), COUNT(DISTINCT offset) FROM memory_changes_detailed").fetchone()
+        print(f"✓ {len(found)} lines printed, {rows[0]} rows stored ({rows[1]} distinct offsets)")
+        if offsets == [8 * i for i in range(5000)] and rows == (5000, 5000):
+            print("✅ PASS: Nothing lost across buffer swaps\n")
+        else:
+            print("❌ FAIL: Burst events lost\n")
+            ok = False
+
+    print("=== Test Summary ===")
+    print("✅ All tracker scan checks passed" if ok else "❌ Some checks failed")
+    return 0 if ok else 1
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,141 @@
+#!/usr/bin/env python3
+"""
+Bulk Registration Test - memwatch
+
+watch_many() registers a whole batch with one native call. Verifies that:
+1. Thousands of buffers get distinct ids and inferred names
+2. Every batch-watched buffer reports its writes
+3. Slices sharing pages of one buffer are protected together and all report
+4. watch_many() is faster than calling watch() in a loop
+5. all() picks up buffer-capable locals through the batch path
+"""
+
+import sys
+import os
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', 'python'))
+
+from memwatch import MemoryWatcher, ChangeEvent
+import time
+
+NUM_BUFFERS = 2000
+PAGE_SIZE = 4096
+
+def main():
+    print("=== memwatch Bulk Registration Test ===\n")
+
+    events_received = []
+
+    def on_change(event: ChangeEvent):
+        events_received.append(event)
+
+    watcher = MemoryWatcher()
+    watcher.set_callback(on_change)
+
+    ok = True
+
+    # Test 1: Many buffers in one call
+    print(f"Test 1: watch_many() on {NUM_BUFFERS} buffers")
+    buffers = [bytearray(64) for _ in range(NUM_BUFFERS)]
+    start = time.perf_counter()
+    ids = watcher.watch_many({f"buf_{i}": b for i, b in enumerate(buffers)})
+    elapsed = time.perf_counter() - start
+    first, second = buffers[0], buffers[1]
+    named = watcher.watch_many([first, second])
+    names = [watcher._tracked_objects[r][1]['variable_name'] for r in named]
+    print(f"✓ {len(set(ids))} distinct ids in {elapsed * 1000:.1f} ms, inferred {names}")
+    if len(set(ids)) == NUM_BUFFERS and all(ids) and names == ['first', 'second']:
+        print("✅ PASS: Batch registered\n")
+    else:
+        print("❌ FAIL: Missing ids or names\n")
+        ok = False
+    for r in named:
+        watcher.unwatch(r)
+    time.sleep(0.1)
+
+    # Test 2: Writes to batch-watched buffers
+    print("Test 2: Writes to every 100th buffer")
+    events_received.clear()
+    for i in range(0, NUM_BUFFERS, 100):
+        buffers[i][0] = 0x5A
+    time.sleep(0.3)
+    seen = {e.region_id for e in events_received}
+    expected = {ids[i] for i in range(0, NUM_BUFFERS, 100)}
+    print(f"✓ {len(expected & seen)}/{len(expected)} written buffers reported")
+    if expected <= seen:
+        print("✅ PASS: Batch-watched buffers tracked\n")
+    else:
+        print("❌ FAIL: Writes missed\n")
+        ok = False
+
+    # Test 3: Adjacent pages of one buffer
+    print("Test 3: Page-sized slices of one buffer")
+    big = bytearray(16 * PAGE_SIZE)
+    view = memoryview(big)
+    slices = [view[i * PAGE_SIZE:(i + 1) * PAGE_SIZE] for i in range(16)]
+    slice_ids = watcher.watch_many({f"slice_{i}": s for i, s in enumerate(slices)})
+    time.sleep(0.1)
+    events_received.clear()
+    for i in range(16):
+        big[i * PAGE_SIZE + 100] = i + 1
+    time.sleep(0.3)
+    seen = {e.region_id for e in events_received}
+    print(f"✓ {sum(1 for r in slice_ids if r in seen)}/16 slices reported, "
+          f"arm_failures={watcher.get_stats()['arm_failures']}")
+    if all(r in seen for r in slice_ids):
+        print("✅ PASS: Coalesced protection covers every slice\n")
+    else:
+        print("❌ FAIL: Slices missed\n")
+        ok = False
+
+    # Test 4: Faster than a loop of watch()
+    print("Test 4: watch() loop vs watch_many() on page-sized buffers (best of 3)")
+    loop_time = batch_time = float('inf')
+    keep = []
+    for _ in range(3):
+        loop_buffers = [bytearray(PAGE_SIZE) for _ in range(NUM_BUFFERS)]
+        start = time.perf_counter()
+        for i, b in enumerate(loop_buffers):
+            watcher.watch(b, name=f"loop_{i}")
+        loop_time = min(loop_time, time.perf_counter() - start)
+        batch_buffers = {f"many_{i}": bytearray(PAGE_SIZE) for i in range(NUM_BUFFERS)}
+        start = time.perf_counter()
+        watcher.watch_many(batch_buffers)
+        batch_time = min(batch_time, time.perf_counter() - start)
+        keep.append((loop_buffers, batch_buffers))
+    print(f"✓ loop {loop_time * 1000:.1f} ms, batch {batch_time * 1000:.1f} ms")
+    if batch_time < loop_time:
+        print("✅ PASS: Batch registration is faster\n")
+    else:
+        print("❌ FAIL: Batch no faster than a loop\n")
+        ok = False
+
+    # Test 5: all()
+    print("Test 5: all() uses the batch path")
+    def scope():
+        local_a = bytearray(32)
+        local_b = bytearray(32)
+        not_a_buffer = 42
+        before = watcher.get_stats()['tracked_regions']
+        watcher.all()
+        return watcher.get_stats()['tracked_regions'] - before
+    added = scope()
+    print(f"✓ all() added {added} regions")
+    if added == 2:
+        print("✅ PASS: Buffer locals watched\n")
+    else:
+        print("❌ FAIL: Unexpected locals watched\n")
+        ok = False
+
+    stats = watcher.get_stats()
+    print("=== Final Statistics ===")
+    for key in ('tracked_regions', 'arm_failures', 'total_events', 'backend'):
+        print(f"{key}: {stats.get(key)}")
+
+    watcher.stop_all()
+
+    print("\n=== Test Summary ===")
+    print("✅ All bulk registration checks passed" if ok else "❌ Some checks failed")
+    return 0 if ok else 1
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+"""
+Hardware Watchpoint Test - memwatch
+
+Regions of 8 bytes or less go on CPU debug registers instead of page
+protection. Verifies that:
+1. A small region is reported through a watchpoint
+2. Writes to unwatched neighbours on the same page cost nothing
+3. Writes from threads started before and after watch() are seen
+4. Regions beyond the debug-register budget fall back to pages
+5. unwatch() frees the register for the next region
+"""
+
+import sys
+import os
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', 'python'))
+
+from memwatch import MemoryWatcher, ChangeEvent
+import ctypes
+import threading
+import time
+
+PAGE_SIZE = 4096
+
+def address_of(buf) -> int:
+    return ctypes.addressof((ctypes.c_char * len(buf)).from_buffer(buf))
+
+def main():
+    print("=== memwatch Hardware Watchpoint Test ===\n")
+
+    events_received = []
+
+    def on_change(event: ChangeEvent):
+        events_received.append(event)
+
+    watcher = MemoryWatcher()
+    watcher.set_callback(on_change)
+
+    # A thread that exists before any watchpoint is armed
+    early_go = threading.Event()
+    early_target = []
+    def early_writer():
+        early_go.wait()
+        early_target[0][0] = 0x11
+    early = threading.Thread(target=early_writer)
+    early.start()
+
+    # The counter shares its page with hot, unwatched data
+    page = bytearray(3 * PAGE_SIZE)
+    base = -address_of(page) % PAGE_SIZE + PAGE_SIZE
+    counter = memoryview(page)[base + 64:base + 72]
+    counter_id = watcher.watch(counter, name="counter")
+    time.sleep(0.1)
+
+    stats = watcher.get_stats()
+    if stats.get('watchpoints', 0) == 0:
+        print("Hardware watchpoints unavailable (no perf breakpoints) - skipping\n")
+        early_go.set()
+        early_target.append(bytearray(1))
+        early.join()
+        watcher.stop_all()
+        return 0
+
+    ok = True
+
+    # Test 1: Exact-address detection
+    print("Test 1: Writes to an 8-byte counter")
+    for i in range(3):
+        counter[0] = i + 1
+        time.sleep(0.03)
+    time.sleep(0.1)
+    events = [e for e in events_received if e.region_id == counter_id]
+    hits = watcher.get_stats()['watchpoint_hits']
+    print(f"✓ {len(events)} events, {hits} watchpoint hits")
+    if len(events) == 3 and events[-1].new_value[0] == 3 and hits >= 3:
+        print("✅ PASS: Counter tracked by watchpoint\n")
+    else:
+        print("❌ FAIL: Unexpected events\n")
+        ok = False
+
+    # Test 2: Hot neighbours on the same page
+    print("Test 2: Writes to unwatched data on the counter's page")
+    neighbours = [base, base + 8, base + 72, base + PAGE_SIZE - 1]
+    before = watcher.get_stats()
+    for i in range(1000):
+        for offset in neighbours:
+            page[offset] = i & 0xFF
+    time.sleep(0.1)
+    after = watcher.get_stats()
+    wakeups = after['worker_wakeups'] - before['worker_wakeups']
+    bp_hits = after['watchpoint_hits'] - before['watchpoint_hits']
+    print(f"✓ {len(neighbours) * 1000} neighbour writes, "
+          f"{wakeups} worker wakeups, {bp_hits} watchpoint hits")
+    if wakeups == 0 and bp_hits == 0:
+        print("✅ PASS: No false faults from page neighbours\n")
+    else:
+        print("❌ FAIL: Neighbour writes were trapped\n")
+        ok = False
+
+    # Test 3: Threads
+    print("Test 3: Writes from other threads")
+    shared = bytearray(4)
+    shared_id = watcher.watch(shared, name="shared")
+    early_target.append(shared)
+    early_go.set()
+    early.join()
+    time.sleep(0.05)
+    def late_writer():
+        time.sleep(0.05)  # watchpoints reach new threads within one rescan
+        shared[1] = 0x22
+    late = threading.Thread(target=late_writer)
+    late.start()
+    late.join()
+    time.sleep(0.1)
+    values = [bytes(e.new_value) for e in events_received if e.region_id == shared_id]
+    print(f"✓ values seen: {values}")
+    if b'\x11\x00\x00\x00' in values and b'\x11\x22\x00\x00' in values:
+        print("✅ PASS: Existing and new threads covered\n")
+    else:
+        print("❌ FAIL: Thread writes missed\n")
+        ok = False
+
+    # Test 4: Budget exhausted -> page protection
+    print("Test 4: More small regions than debug registers")
+    flags = [bytearray(2) for _ in range(6)]
+    flag_ids = [watcher.watch(f, name=f"flag_{i}") for i, f in enumerate(flags)]
+    time.sleep(0.1)
+    in_use = watcher.get_stats()['watchpoints']
+    for i, f in enumerate(flags):
+        f[0] = i + 1
+    time.sleep(0.2)
+    seen = {e.region_id for e in events_received}
+    print(f"✓ {in_use} watchpoints in use, "
+          f"{sum(1 for r in flag_ids if r in seen)}/{len(flags)} flags reported")
+    if in_use <= 4 and all(r in seen for r in flag_ids):
+        print("✅ PASS: Overflow regions fall back to pages\n")
+    else:
+        print("❌ FAIL: Regions lost past the budget\n")
+        ok = False
+
+    # Test 5: Unwatch frees the register
+    print("Test 5: unwatch() releases the watchpoint")
+    watcher.unwatch(counter_id)
+    released = watcher.get_stats()['watchpoints']
+    extra = bytearray(8)
+    watcher.watch(extra, name="extra")
+    reused = watcher.get_stats()['watchpoints']
+    print(f"✓ {in_use} -> {released} -> {reused}")
+    if released == in_use - 1 and reused == in_use:
+        print("✅ PASS: Register reused\n")
+    else:
+        print("❌ FAIL: Register not released\n")
+        ok = False
+
+    print("=== Final Statistics ===")
+    for key, value in watcher.get_stats().items():
+        print(f"{key}: {value}")
+
+    watcher.stop_all()
+
+    print("\n=== Test Summary ===")
+    print("✅ All watchpoint checks passed" if ok else "❌ Some checks failed")
+    return 0 if ok else 1
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -26,6 +26,8 @@
 #include <errno.h>
 #include <stdbool.h>
 
+#include "memwatch_hash.h"
+
 #ifdef __linux__
 #include <linux/falloc.h>
 #include <sys/syscall.h>
@@ -110,79 +112,12 @@ typedef struct CACHE_ALIGNED {
 } fast_storage_t;
 
 /* ============================================================================
- * High-Performance Hash Function (XXHash-inspired)
+ * Hash Function - shared XXH3-class kernel (memwatch/src/memwatch_hash.c)
  * ============================================================================ */
 
-#define XXH_PRIME64_1 0x9E3779B185EBCA87ULL
-#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
-#define XXH_PRIME64_3 0x165667B19E3779F9ULL
-#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
-#define XXH_PRIME64_5 0x27D4EB2F165667C5ULL
-
-static ALWAYS_INLINE uint64_t rotl64(uint64_t x, int r) {
-    return (x << r) | (x >> (64 - r));
-}
-
-static HOT uint64_t fast_hash(const char *key, size_t len) {
-    const uint8_t *p = (const uint8_t *)key;
-    const uint8_t *end = p + len;
-    uint64_t h;
-    
-    if (LIKELY(len >= 32)) {
-        const uint8_t *limit = end - 32;
-        uint64_t v1 = XXH_PRIME64_1 + XXH_PRIME64_2;
-        uint64_t v2 = XXH_PRIME64_2;
-        uint64_t v3 = 0;
-        uint64_t v4 = -XXH_PRIME64_1;
-        
-        do {
-            /* Process 32 bytes per iteration */
-            v1 += *(uint64_t *)p * XXH_PRIME64_2; v1 = rotl64(v1, 31); v1 *= XXH_PRIME64_1; p += 8;
-            v2 += *(uint64_t *)p * XXH_PRIME64_2; v2 = rotl64(v2, 31); v2 *= XXH_PRIME64_1; p += 8;
-            v3 += *(uint64_t *)p * XXH_PRIME64_2; v3 = rotl64(v3, 31); v3 *= XXH_PRIME64_1; p += 8;
-            v4 += *(uint64_t *)p * XXH_PRIME64_2; v4 = rotl64(v4, 31); v4 *= XXH_PRIME64_1; p += 8;
-        } while (p <= limit);
-        
-        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
-        
-        v1 *= XXH_PRIME64_2; v1 = rotl64(v1, 31); v1 *= XXH_PRIME64_1; h ^= v1; h = h * XXH_PRIME64_1 + XXH_PRIME64_4;
-        v2 *= XXH_PRIME64_2; v2 = rotl64(v2, 31); v2 *= XXH_PRIME64_1; h ^= v2; h = h * XXH_PRIME64_1 + XXH_PRIME64_4;
-        v3 *= XXH_PRIME64_2; v3 = rotl64(v3, 31); v3 *= XXH_PRIME64_1; h ^= v3; h = h * XXH_PRIME64_1 + XXH_PRIME64_4;
-        v4 *= XXH_PRIME64_2; v4 = rotl64(v4, 31); v4 *= XXH_PRIME64_1; h ^= v4; h = h * XXH_PRIME64_1 + XXH_PRIME64_4;
-    } else {
-        h = XXH_PRIME64_5;
-    }
-    
-    h += len;
-    
-    /* Process remaining bytes */
-    while (p + 8 <= end) {
-        uint64_t k1 = *(uint64_t *)p;
-        k1 *= XXH_PRIME64_2; k1 = rotl64(k1, 31); k1 *= XXH_PRIME64_1;
-        h ^= k1; h = rotl64(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
-        p += 8;
-    }
-    
-    if (p + 4 <= end) {
-        h ^= (uint64_t)(*(uint32_t *)p) * XXH_PRIME64_1;
-        h = rotl64(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
-        p += 4;
-    }
-    
-    while (p < end) {
-        h ^= (*p) * XXH_PRIME64_5;
-        h = rotl64(h, 11) * XXH_PRIME64_1;
-        p++;
-    }
-    
-    /* Avalanche */
-    h ^= h >> 33;
-    h *= XXH_PRIME64_2;
-    h ^= h >> 29;
-    h *= XXH_PRIME64_3;
-    h ^= h >> 32;
-    
-    return h;
+static ALWAYS_INLINE uint64_t fast_hash(const char *key, size_t len) {
+    /* SIMD kernel chosen once per process via CPUID dispatch */
+    return mw_hash64(key, len);
 }
 
 /* ============================================================================